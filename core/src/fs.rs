@@ -5,6 +5,7 @@
 use alloc::{string::String, vec::Vec};
 
 use crate::hal::HalServices; // To access storage devices
+use crate::hal::LblBootInfoRaw;
 use crate::logger;
 
 // Filesystem driver implementations
@@ -20,6 +21,7 @@ pub mod btrfs; // Placeholder
 // Filesystem plugin manager and generic interface
 pub mod interface;
 pub mod manager;
+pub mod preload; // Files handed over in memory by Stage 1
 
 /// Represents a mounted filesystem volume.
 #[cfg(feature = "with_alloc")]
@@ -51,21 +53,35 @@ pub struct Volume {
 
 
 /// Initializes the filesystem subsystem.
-/// This primarily means setting up the FilesystemDriverManager.
-pub fn initialize_manager(
+/// This primarily means setting up the FilesystemDriverManager. Files Stage 1
+/// preloaded (`boot_info` modules record) are mounted first, so lookups hit
+/// memory before any driver touches a disk.
+///
+/// # Safety
+/// `boot_info` must come from Stage 1, see `FilesystemManager::mount_preloaded`.
+pub unsafe fn initialize_manager(
     hal_services: &HalServices,
+    boot_info: Option<&'static LblBootInfoRaw>,
     // plugin_paths: &[&str] // Paths to .lblfs plugin files, to be loaded by manager
 ) -> manager::FilesystemManager {
     logger::info!("[FS] Initializing Filesystem Manager...");
     let mut fs_manager = manager::FilesystemManager::new(hal_services);
 
+    #[cfg(feature = "with_alloc")]
+    if let Some(boot_info) = boot_info {
+        unsafe { fs_manager.mount_preloaded(boot_info) };
+    }
+    #[cfg(not(feature = "with_alloc"))]
+    let _ = boot_info;
+
     // Register built-in filesystem drivers based on features
     #[cfg(all(feature = "fs_fat32", feature = "with_alloc"))]
     {
         logger::info!("[FS] Registering built-in FAT32 driver...");
-        // The FAT32 driver would implement the `FileSystemDriver` trait.
-        // fs_manager.register_driver(Box::new(fat32::Fat32Driver::new()));
-        // For now, this is conceptual until `fat32.rs` provides `Fat32Driver`.
+        // On BIOS boots the driver reads the sectors Stage 2 cached without a disk access.
+        let sector_cache = boot_info
+            .and_then(|boot_info| unsafe { crate::hal::sector_cache::WarmSectorCache::from_boot_info(boot_info) });
+        fs_manager.register_driver(alloc::boxed::Box::new(fat32::Fat32Driver::with_sector_cache(sector_cache)));
     }
     #[cfg(all(feature = "fs_ext4", feature = "with_alloc"))]
     {
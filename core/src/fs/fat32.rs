@@ -8,6 +8,7 @@ use alloc::{boxed::Box, string::String, vec::Vec};
 use crate::fs::interface::{
     DirectoryEntry, EntryType, FileMetadata, FileSystemDriver, FileSystemInstance, FilesystemError,
 };
+use crate::hal::sector_cache::WarmSectorCache;
 use crate::hal::Device as HalDevice;
 use crate::logger;
 
@@ -18,11 +19,38 @@ use crate::logger;
 //     fn sector_size(&self) -> u32;
 // }
 
-pub struct Fat32Driver;
+/// Sector reads for the driver: the sectors BIOS Stage 2 left in the warm cache
+/// (boot sector, FSInfo, the start of the FAT and root directory) are served
+/// from memory; only a miss goes to the device.
+#[derive(Clone, Copy)]
+struct SectorReader {
+    cache: Option<WarmSectorCache>,
+}
+
+impl SectorReader {
+    fn read(&self, device: &HalDevice, lba: u64, buffer: &mut [u8]) -> Result<(), FilesystemError> {
+        if let Some(cache) = &self.cache {
+            if device.id == cache.drive() as u64 && cache.read(lba, buffer) {
+                return Ok(());
+            }
+        }
+        // TODO: read through the device's BlockIo (see `interface::BlockIo`) on a miss.
+        Err(FilesystemError::NotImplemented)
+    }
+}
+
+pub struct Fat32Driver {
+    sectors: SectorReader,
+}
 
 impl Fat32Driver {
     pub fn new() -> Self {
-        Fat32Driver
+        Self::with_sector_cache(None)
+    }
+
+    /// A driver that checks `cache` (see `hal::sector_cache`) before reading the device.
+    pub fn with_sector_cache(cache: Option<WarmSectorCache>) -> Self {
+        Fat32Driver { sectors: SectorReader { cache } }
     }
 }
 
@@ -35,17 +63,14 @@ impl FileSystemDriver for Fat32Driver {
     /// This usually involves reading the first sector (Boot Sector) and checking signatures.
     fn detect(&self, device: &HalDevice /*, block_io: &dyn BlockIo */) -> bool {
         logger::debug!("[FAT32 Driver] Detecting on device: {}", device.name);
-        // TODO: Implement actual FAT32 detection logic
-        // 1. Get a BlockIo interface for the device.
-        // 2. Read the first sector (LBA 0).
-        // 3. Parse the Boot Parameter Block (BPB).
-        // 4. Check for FAT32 specific signatures/values:
-        //    - Bytes 510-511 should be 0x55 0xAA.
-        //    - FileSystemType string at offset 0x52 (for FAT32) should be "FAT32   ".
-        //    - Check other BPB sanity.
-        // For this stub, let's assume it's not FAT32 by default.
-        // In a test environment, you might make it always return true for a specific device name.
-        false // Stub: always returns false
+        // Read the first sector (LBA 0) and check the FAT32 signatures:
+        // bytes 510-511 are 0x55 0xAA, FileSystemType at 0x52 is "FAT32   ".
+        // TODO: Check other BPB sanity.
+        let mut sector = [0u8; 512];
+        if self.sectors.read(device, 0, &mut sector).is_err() {
+            return false; // Not cached and no device read yet
+        }
+        sector[510] == 0x55 && sector[511] == 0xAA && &sector[0x52..0x5A] == b"FAT32   "
     }
 
     /// Mounts a FAT32 filesystem from the given device.
@@ -13,6 +13,10 @@ use crate::fs::interface::{
     DirectoryEntry, FileMetadata, FileSystemDriver, FileSystemInstance, FilesystemError,
 };
 use crate::hal::{Device as HalDevice, HalServices};
+#[cfg(feature = "with_alloc")]
+use crate::hal::{LblBootInfoRaw, LblModuleEntry};
+#[cfg(feature = "with_alloc")]
+use crate::fs::preload::{self, PreloadVolume, PRELOAD_VOLUME_ID};
 use crate::logger;
 
 // Placeholder for BlockIo when we define it.
@@ -26,6 +30,7 @@ pub struct FilesystemManager<'a> {
     drivers: Vec<Box<dyn FileSystemDriver>>,
     mounted_volumes: BTreeMap<String, MountedVolumeInfo>,
     next_volume_numeric_id: u32,
+    preloaded: &'static [LblModuleEntry], // Stage 1 module table, see `mount_preloaded`
 }
 
 #[cfg(feature = "with_alloc")]
@@ -44,9 +49,52 @@ impl<'a> FilesystemManager<'a> {
             drivers: Vec::new(),
             mounted_volumes: BTreeMap::new(),
             next_volume_numeric_id: 1,
+            preloaded: &[],
         }
     }
 
+    /// Mounts the files Stage 1 preloaded (if any) as the `PRELOAD_VOLUME_ID` volume.
+    /// Volumes are kept sorted by ID and "preload" sorts before the "vol-" IDs, so
+    /// searches over `list_mounted_volumes` try memory before any disk.
+    ///
+    /// # Safety
+    /// `boot_info` must come from Stage 1 and the module pages must not be reused
+    /// while this manager lives.
+    pub unsafe fn mount_preloaded(&mut self, boot_info: &'static LblBootInfoRaw) -> Option<crate::fs::Volume> {
+        let modules = unsafe { boot_info.modules()? };
+        if modules.is_empty() {
+            return None;
+        }
+        logger::info!("[FS Manager] {} file(s) preloaded by Stage 1.", modules.len());
+        self.preloaded = modules;
+        let lbl_volume_info = crate::fs::Volume {
+            id: PRELOAD_VOLUME_ID.to_string(),
+            fs_type: "PRELOAD".to_string(),
+            label: None,
+            device_path: String::new(),
+            mount_point: None,
+            capacity_bytes: modules.iter().map(|m| m.size).sum(),
+            free_space_bytes: 0,
+            is_read_only: true,
+        };
+        let instance = Box::new(unsafe { PreloadVolume::new(modules) });
+        self.mounted_volumes.insert(
+            PRELOAD_VOLUME_ID.to_string(),
+            MountedVolumeInfo { instance, lbl_volume_info: lbl_volume_info.clone() },
+        );
+        Some(lbl_volume_info)
+    }
+
+    /// A preloaded file in place, without the copy `read_file` makes. Matches paths
+    /// like FAT does (case-insensitive, either separator).
+    pub fn preloaded_file(&self, path: &str) -> Option<&'static [u8]> {
+        self.preloaded
+            .iter()
+            .find(|m| preload::path_matches(m.name(), path))
+            // Safety: guaranteed by `mount_preloaded`.
+            .map(|m| unsafe { m.data() })
+    }
+
     /// Registers a new filesystem driver.
     pub fn register_driver(&mut self, driver: Box<dyn FileSystemDriver>) {
         logger::info!("[FS Manager] Registering driver: {}", driver.name());
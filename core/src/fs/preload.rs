@@ -0,0 +1,102 @@
+// Lionbootloader Core - Preloaded Files
+// File: core/src/fs/preload.rs
+
+//! Files Stage 1 read from the core's volume in the same session as the core
+//! (its preload manifest, `\LBL\CORE\preload.lst`), handed over as a module table
+//! in the boot info. Mounted as the "preload" volume so that config, kernel and
+//! initrd lookups hit memory first and the boot volume need not be mounted again.
+
+#![cfg(feature = "with_alloc")]
+
+use alloc::{
+    string::{String, ToString},
+    vec::Vec,
+};
+
+use crate::fs::interface::{DirectoryEntry, EntryType, FileMetadata, FileSystemInstance, FilesystemError};
+use crate::hal::LblModuleEntry;
+use crate::logger;
+
+/// Volume ID the manager gives the preloaded files.
+pub const PRELOAD_VOLUME_ID: &str = "preload";
+
+/// Compares a manifest name with a lookup path the way FAT would: ASCII
+/// case-insensitive, '/' and '\' equivalent, leading separator optional.
+pub fn path_matches(name: &[u8], path: &str) -> bool {
+    fn trim(p: &[u8]) -> &[u8] {
+        match p.first() {
+            Some(b'/') | Some(b'\\') => &p[1..],
+            _ => p,
+        }
+    }
+    let (a, b) = (trim(name), trim(path.as_bytes()));
+    a.len() == b.len()
+        && a.iter().zip(b).all(|(&x, &y)| {
+            let sep = |c: u8| c == b'/' || c == b'\\';
+            (sep(x) && sep(y)) || x.eq_ignore_ascii_case(&y)
+        })
+}
+
+pub struct PreloadVolume {
+    modules: &'static [LblModuleEntry],
+}
+
+impl PreloadVolume {
+    /// # Safety
+    /// The module pages must stay mapped and unused for as long as the volume lives.
+    pub unsafe fn new(modules: &'static [LblModuleEntry]) -> Self {
+        PreloadVolume { modules }
+    }
+
+    fn find(&self, path: &str) -> Option<&LblModuleEntry> {
+        self.modules.iter().find(|m| path_matches(m.name(), path))
+    }
+
+    /// The file contents in place, without a copy.
+    pub fn file(&self, path: &str) -> Option<&'static [u8]> {
+        // Safety: guaranteed by `new`.
+        self.find(path).map(|m| unsafe { m.data() })
+    }
+}
+
+impl FileSystemInstance for PreloadVolume {
+    fn volume_id(&self) -> &str {
+        PRELOAD_VOLUME_ID
+    }
+
+    fn read_file(&self, path: &str) -> Result<Vec<u8>, FilesystemError> {
+        logger::trace!("[Preload] Reading file: {}", path);
+        self.file(path).map(|data| data.to_vec()).ok_or(FilesystemError::NotFound)
+    }
+
+    /// Only the root is listed, with every preloaded path as one flat entry.
+    fn list_directory(&self, path: &str) -> Result<Vec<DirectoryEntry>, FilesystemError> {
+        if !(path.is_empty() || path == "/") {
+            return Err(FilesystemError::NotFound);
+        }
+        Ok(self
+            .modules
+            .iter()
+            .map(|m| DirectoryEntry {
+                name: String::from_utf8_lossy(m.name()).to_string(),
+                entry_type: EntryType::File,
+            })
+            .collect())
+    }
+
+    fn metadata(&self, path: &str) -> Result<FileMetadata, FilesystemError> {
+        let module = self.find(path).ok_or(FilesystemError::NotFound)?;
+        Ok(FileMetadata {
+            name: String::from_utf8_lossy(module.name()).to_string(),
+            entry_type: EntryType::File,
+            size: module.size,
+            created_time: None,
+            modified_time: None,
+            accessed_time: None,
+        })
+    }
+
+    fn is_read_only(&self) -> bool {
+        true
+    }
+}
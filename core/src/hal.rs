@@ -9,6 +9,10 @@ use crate::logger; // Assuming logger is available for HAL messages
 // Sub-modules for different HAL functionalities
 pub mod async_probe;
 pub mod device_manager;
+pub mod early_console;
+pub mod mem_ops;
+pub mod mp;
+pub mod sector_cache;
 // pub mod memory; // For memory map parsing and management
 // pub mod cpu;    // For CPU specific features, mode switching (if not done by Stage1)
 // pub mod pci;    // For PCI device enumeration
@@ -48,7 +52,7 @@ impl BootInfo {
 #[cfg(feature = "with_alloc")]
 #[derive(Debug, Clone)]
 pub struct Device {
-    pub id: u64, // Unique device ID
+    pub id: u64, // Unique device ID; a BIOS disk uses its INT 13h drive number
     pub name: alloc::string::String,
     pub device_type: DeviceType,
     // pub resources: Vec<Resource>, // e.g., memory regions, I/O ports, IRQs
@@ -164,12 +168,20 @@ pub unsafe fn initialize(boot_info_ptr: *const u8) -> Result<HalServices, HalErr
 }
 
 /// Starts the asynchronous device probing process.
-/// This will spawn tasks to detect storage, network, GPU, input, etc.
+/// This will spawn tasks to detect storage, network, GPU, input, etc. When the
+/// boot info reports APs that Stage 1 parked, the probes run on them in parallel.
+///
+/// # Safety
+/// `boot_info` must come from Stage 1, see `mp::ApPool::from_boot_info`.
 #[cfg(feature = "with_alloc")] // Async probing typically needs allocation for tasks/futures
-pub fn start_async_device_probes(hal: &mut HalServices) -> async_probe::ProbeHandle {
+pub unsafe fn start_async_device_probes(
+    hal: &mut HalServices,
+    boot_info: Option<&'static LblBootInfoRaw>,
+) -> async_probe::ProbeHandle {
     logger::info!("[HAL] Starting asynchronous device probing...");
+    let pool = boot_info.and_then(|boot_info| unsafe { mp::ApPool::from_boot_info(boot_info) });
     // The async_probe module will use other HAL services (PCI, USB, ACPI) to find devices.
-    async_probe::start_probes(&mut hal.device_manager /*, &hal.pci_services, &hal.usb_services etc */)
+    async_probe::start_probes(&mut hal.device_manager /*, &hal.pci_services, &hal.usb_services etc */, pool.as_ref())
 }
 
 
@@ -213,29 +225,708 @@ pub struct LblBootInfoRaw {
     pub core_load_addr: u64,
     pub core_size: u64,
     pub core_entry_offset: u64,
-
-    pub memory_map_buffer: *const EfiMemoryDescriptorRaw, // Pointer to raw EFI descriptors
+    pub core_load_alignment: u64,
+    pub core_compressed_size: u64,
+    pub core_decompress_ticks: u64,
+    pub core_sha256: [u8; 32],
+    pub core_verify_flags: u32,
+    pub reserved_verify: u32,
+    pub core_manifest_addr: u64,
+    pub core_manifest_size: u64,
+    pub core_heap_addr: u64, // 2 MiB-aligned arena for the global allocator (0 = none)
+    pub core_heap_size: u64,
+
+    pub memory_map_buffer: *const EfiMemoryDescriptorRaw, // Pointer to raw EFI descriptors (null on BIOS: use compact_memory_map())
     pub memory_map_size: usize, // UEFI UINTN maps to Rust usize on same-arch
     pub memory_map_key: usize,
     pub memory_descriptor_size: usize,
     pub memory_descriptor_version: u32,
+    pub exit_boot_services_retries: u32,
 
     pub framebuffer_addr: u64,
     pub framebuffer_size: u64,
     pub framebuffer_width: u32,
     pub framebuffer_height: u32,
-    pub framebuffer_pitch: u32, // Assuming bytes per scan line
+    pub framebuffer_pitch: u32, // Bytes per scan line
     pub framebuffer_bpp: u8,
-    pub framebuffer_pixel_format_info: u8,
+    pub framebuffer_pixel_format_info: u8, // FB_FORMAT_*
     pub reserved_graphics: u16,
+    pub framebuffer_red_shift: u8,
+    pub framebuffer_red_size: u8,
+    pub framebuffer_green_shift: u8,
+    pub framebuffer_green_size: u8,
+    pub framebuffer_blue_shift: u8,
+    pub framebuffer_blue_size: u8,
+    pub framebuffer_reserved_shift: u8,
+    pub framebuffer_reserved_size: u8,
+    pub framebuffer_flags: u32, // FB_FLAG_*
+    pub reserved_graphics2: u32,
 
     pub acpi_rsdp_ptr: u64,
-    pub efi_system_table_ptr: u64,
+    pub smbios_entry_ptr: u64,
+    pub efi_system_table_ptr: u64, // 0 when booted through boot_32 (BIOS)
+
+    pub stage1_log_addr: u64, // *const LblStage1LogRing
+    pub stage1_log_size: u32,
+    pub reserved_log: u32,
+
+    pub page_table_root: u64, // PML4 in CR3 at entry (0 = firmware tables)
+    pub page_table_top: u64,
+    pub higher_half_base: u64,
+    pub page_table_pages: u32,
+    pub page_table_flags: u32, // PAGING_FLAG_*
     
     pub reserved1: u64,
     pub reserved2: u64,
 }
 
+impl LblBootInfoRaw {
+    pub const MAGIC: u64 = 0x4C42_4C42_494E_464F; // LBL_BOOT_INFO_MAGIC_VALUE ("LBLBINFO")
+    /// First LBL_BOOT_INFO_VERSION with header_size/total_size and appended records.
+    pub const VERSION_RECORDS: u32 = 0x0001_0001;
+
+    /// The boot info behind the pointer `lbl_core_entry` received, if it has the magic.
+    ///
+    /// # Safety
+    /// A non-null `ptr` must point to readable memory of at least the header size.
+    pub unsafe fn from_ptr(ptr: *const u8) -> Option<&'static LblBootInfoRaw> {
+        let boot_info = ptr as *const LblBootInfoRaw;
+        if boot_info.is_null() || unsafe { (*boot_info).magic } != Self::MAGIC {
+            return None;
+        }
+        Some(unsafe { &*boot_info })
+    }
+
+    // LblBootRecordHeader::record_type (LBL_BOOT_RECORD_* in LblUefi.h)
+    pub const BOOT_RECORD_ALIGN: usize = 8;
+    pub const BOOT_RECORD_TIMELINE: u32 = 1;
+    pub const BOOT_RECORD_MEMORY_MAP: u32 = 2;
+    pub const BOOT_RECORD_CONFIG_TABLES: u32 = 3;
+    pub const BOOT_RECORD_ACPI_INDEX: u32 = 4;
+    pub const BOOT_RECORD_MP: u32 = 5;
+    pub const BOOT_RECORD_MODULES: u32 = 6;
+    pub const BOOT_RECORD_SECTOR_CACHE: u32 = 7;
+    pub const BOOT_RECORD_CORE_SEGMENTS: u32 = 8;
+    pub const BOOT_RECORD_MEM_OPS: u32 = 9;
+    pub const BOOT_RECORD_CORE_SLOT: u32 = 10;
+    pub const BOOT_RECORD_EARLY_CONSOLE: u32 = 11;
+
+    // core_verify_flags (LBL_CORE_VERIFY_* in LblUefi.h)
+    pub const CORE_VERIFY_DIGEST: u32 = 0x1;
+    pub const CORE_VERIFY_MANIFEST_MATCH: u32 = 0x2;
+    pub const CORE_VERIFY_ACCELERATED: u32 = 0x4;
+
+    // page_table_flags (LBL_PAGING_FLAG_* in LblUefi.h)
+    pub const PAGING_FLAG_1G_PAGES: u32 = 0x1;
+    pub const PAGING_FLAG_WC_FRAMEBUFFER: u32 = 0x2;
+
+    // framebuffer_pixel_format_info / framebuffer_flags (LBL_FB_* in LblUefi.h)
+    pub const FB_FORMAT_NONE: u8 = 0;
+    pub const FB_FORMAT_RGBX8888: u8 = 1;
+    pub const FB_FORMAT_BGRX8888: u8 = 2;
+    pub const FB_FORMAT_BITMASK: u8 = 3;
+    pub const FB_FLAG_WRITE_COMBINING: u32 = 0x1;
+
+    /// Pixel layout of the framebuffer, so a blitter can pick a fast path for the
+    /// two 32 bpp byte orders and only use per-channel shifts for the rest.
+    pub fn framebuffer_layout(&self) -> Option<LblPixelLayout> {
+        if self.framebuffer_addr == 0 || self.framebuffer_pixel_format_info == Self::FB_FORMAT_NONE {
+            return None;
+        }
+        Some(LblPixelLayout {
+            format: self.framebuffer_pixel_format_info,
+            bytes_per_pixel: self.framebuffer_bpp / 8,
+            red: (self.framebuffer_red_shift, self.framebuffer_red_size),
+            green: (self.framebuffer_green_shift, self.framebuffer_green_size),
+            blue: (self.framebuffer_blue_shift, self.framebuffer_blue_size),
+            reserved: (self.framebuffer_reserved_shift, self.framebuffer_reserved_size),
+        })
+    }
+
+    /// SHA-256 of lbl_core.bin as Stage 1 read it, if Stage 1 computed one.
+    /// Reuse this instead of rehashing the core image in memory.
+    pub fn core_digest(&self) -> Option<&[u8; 32]> {
+        if self.core_verify_flags & Self::CORE_VERIFY_DIGEST != 0 {
+            Some(&self.core_sha256)
+        } else {
+            None
+        }
+    }
+
+    /// The core manifest (header + detached signature) Stage 1 matched the digest
+    /// against. Its signature still has to be checked by the core.
+    ///
+    /// # Safety
+    /// The boot info must come from Stage 1, which keeps the manifest in LoaderData memory.
+    pub unsafe fn core_manifest(&self) -> Option<&[u8]> {
+        if self.core_manifest_addr == 0 || self.core_manifest_size == 0 {
+            return None;
+        }
+        Some(unsafe {
+            core::slice::from_raw_parts(self.core_manifest_addr as *const u8, self.core_manifest_size as usize)
+        })
+    }
+
+    /// Finds the first record of `record_type` that Stage 1 appended after the header.
+    /// Returns None for older Stage 1 builds, a missing record, or a malformed chain.
+    ///
+    /// # Safety
+    /// `self` must be the boot info Stage 1 handed over, with `total_size` bytes
+    /// mapped from its start.
+    pub unsafe fn find_record(&self, record_type: u32) -> Option<*mut LblBootRecordHeader> {
+        let header_len = core::mem::size_of::<LblBootRecordHeader>();
+        if self.magic != Self::MAGIC || self.version < Self::VERSION_RECORDS {
+            return None;
+        }
+        let base = self as *const Self as usize;
+        let end = self.total_size as usize;
+        let mut offset = self.header_size as usize;
+        while offset + header_len <= end {
+            let record = (base + offset) as *mut LblBootRecordHeader;
+            let size = unsafe { (*record).size } as usize;
+            if size < header_len || offset + size > end {
+                return None;
+            }
+            if unsafe { (*record).record_type } == record_type {
+                return Some(record);
+            }
+            offset = (offset + size + Self::BOOT_RECORD_ALIGN - 1) & !(Self::BOOT_RECORD_ALIGN - 1);
+        }
+        None
+    }
+
+    /// Stage 1's buffered log (LBL_UEFI_LOG_RING), if it handed one over.
+    ///
+    /// # Safety
+    /// The boot info must come from Stage 1; the ring lives in the Stage 1 image,
+    /// which must not have been reclaimed yet.
+    pub unsafe fn stage1_log(&self) -> Option<&LblStage1LogRing> {
+        let header_len = core::mem::size_of::<LblStage1LogRing>();
+        if self.stage1_log_addr == 0 || (self.stage1_log_size as usize) < header_len {
+            return None;
+        }
+        let ring = unsafe { &*(self.stage1_log_addr as *const LblStage1LogRing) };
+        if (ring.capacity as usize) > self.stage1_log_size as usize - header_len
+            || !ring.capacity.is_power_of_two()
+        {
+            return None;
+        }
+        Some(ring)
+    }
+
+    /// The compact memory map (sorted by base, neighbours of the same type merged),
+    /// if Stage 1 appended a complete one. Fall back to the raw map otherwise.
+    ///
+    /// # Safety
+    /// Same as [`Self::find_record`].
+    pub unsafe fn compact_memory_map(&self) -> Option<&[LblMemoryRange]> {
+        let record = unsafe { self.find_record(Self::BOOT_RECORD_MEMORY_MAP)? } as *const LblCompactMemoryMapRecord;
+        let header_len = core::mem::size_of::<LblCompactMemoryMapRecord>();
+        let (size, count, capacity) = unsafe { ((*record).header.size as usize, (*record).count, (*record).capacity) };
+        if count == 0 || count > capacity
+            || header_len + capacity as usize * core::mem::size_of::<LblMemoryRange>() > size
+        {
+            return None;
+        }
+        Some(unsafe { core::slice::from_raw_parts(record.add(1) as *const LblMemoryRange, count as usize) })
+    }
+
+    /// Firmware configuration tables Stage 1 collected (ACPI, SMBIOS, DTB, ...).
+    ///
+    /// # Safety
+    /// Same as [`Self::find_record`].
+    pub unsafe fn config_tables(&self) -> Option<&LblConfigTablesRecord> {
+        let record = unsafe { self.find_record(Self::BOOT_RECORD_CONFIG_TABLES)? };
+        if (unsafe { (*record).size } as usize) < core::mem::size_of::<LblConfigTablesRecord>() {
+            return None;
+        }
+        Some(unsafe { &*(record as *const LblConfigTablesRecord) })
+    }
+
+    /// Address and version of one configuration table (`LblConfigTableEntry::*`).
+    ///
+    /// # Safety
+    /// Same as [`Self::find_record`].
+    pub unsafe fn config_table(&self, table_type: u32) -> Option<(u64, u32)> {
+        let tables = unsafe { self.config_tables()? };
+        tables.entries().iter().find(|e| e.table_type == table_type).map(|e| (e.address, e.version))
+    }
+
+    /// Processor topology (BSP included) and, if Stage 1 started the APs, where
+    /// their mailboxes are. See `mp::ApPool`.
+    ///
+    /// # Safety
+    /// Same as [`Self::find_record`].
+    pub unsafe fn mp(&self) -> Option<(&LblMpRecord, &[LblCpuEntry])> {
+        let record = unsafe { self.find_record(Self::BOOT_RECORD_MP)? } as *const LblMpRecord;
+        let header_len = core::mem::size_of::<LblMpRecord>();
+        let (size, count) = unsafe { ((*record).header.size as usize, (*record).count as usize) };
+        if header_len + count * core::mem::size_of::<LblCpuEntry>() > size {
+            return None;
+        }
+        Some(unsafe { (&*record, core::slice::from_raw_parts(record.add(1) as *const LblCpuEntry, count)) })
+    }
+
+    /// Files Stage 1 preloaded from the core's volume (see `fs::preload`).
+    ///
+    /// # Safety
+    /// Same as [`Self::find_record`].
+    pub unsafe fn modules(&self) -> Option<&[LblModuleEntry]> {
+        let record = unsafe { self.find_record(Self::BOOT_RECORD_MODULES)? } as *const LblModulesRecord;
+        let header_len = core::mem::size_of::<LblModulesRecord>();
+        let (size, count) = unsafe { ((*record).header.size as usize, (*record).count as usize) };
+        if header_len + count * core::mem::size_of::<LblModuleEntry>() > size {
+            return None;
+        }
+        Some(unsafe { core::slice::from_raw_parts(record.add(1) as *const LblModuleEntry, count) })
+    }
+
+    /// BIOS only: the sector cache Stage 2 filled, see `hal::sector_cache`.
+    pub unsafe fn sector_cache(&self) -> Option<&LblSectorCacheRecord> {
+        let record = unsafe { self.find_record(Self::BOOT_RECORD_SECTOR_CACHE)? } as *const LblSectorCacheRecord;
+        if unsafe { (*record).header.size as usize } < core::mem::size_of::<LblSectorCacheRecord>() {
+            return None;
+        }
+        Some(unsafe { &*record })
+    }
+
+    /// Stage 1's dispatched copy / fill / compare routines, see `hal::mem_ops`.
+    ///
+    /// # Safety
+    /// Same as [`Self::find_record`].
+    pub unsafe fn mem_ops(&self) -> Option<&mem_ops::LblMemOps> {
+        let record = unsafe { self.find_record(Self::BOOT_RECORD_MEM_OPS)? };
+        let size = core::mem::size_of::<LblBootRecordHeader>() + core::mem::size_of::<mem_ops::LblMemOps>();
+        if unsafe { (*record).size as usize } < size {
+            return None;
+        }
+        Some(unsafe { &*(record.add(1) as *const mem_ops::LblMemOps) })
+    }
+
+    /// Stage 1's text console state, see `hal::early_console`. Mutable: the
+    /// console keeps its cursor in the record.
+    ///
+    /// # Safety
+    /// Same as [`Self::find_record`].
+    pub unsafe fn early_console(&self) -> Option<*mut early_console::LblEarlyConsole> {
+        let record = unsafe { self.find_record(Self::BOOT_RECORD_EARLY_CONSOLE)? };
+        let size = core::mem::size_of::<LblBootRecordHeader>() + core::mem::size_of::<early_console::LblEarlyConsole>();
+        if unsafe { (*record).size as usize } < size {
+            return None;
+        }
+        Some(unsafe { record.add(1) as *mut early_console::LblEarlyConsole })
+    }
+
+    /// UEFI only: the A/B slot this core was loaded from and why earlier slots
+    /// were passed over. A boot counted against an unconfirmed slot is confirmed
+    /// by setting `confirmed` (fourth byte) in the LblCoreSlot variable.
+    ///
+    /// # Safety
+    /// Same as [`Self::find_record`].
+    pub unsafe fn core_slot(&self) -> Option<&LblCoreSlotRecord> {
+        let record = unsafe { self.find_record(Self::BOOT_RECORD_CORE_SLOT)? } as *const LblCoreSlotRecord;
+        if unsafe { (*record).header.size as usize } < core::mem::size_of::<LblCoreSlotRecord>() {
+            return None;
+        }
+        Some(unsafe { &*record })
+    }
+
+    /// The core's own segments when Stage 1 loaded it from an ELF64 / PE32+ image,
+    /// in address order; offsets are from `core_load_addr`. None for a flat core.
+    ///
+    /// # Safety
+    /// Same as [`Self::find_record`].
+    pub unsafe fn core_segments(&self) -> Option<(&LblCoreSegmentsRecord, &[LblCoreSegment])> {
+        let record = unsafe { self.find_record(Self::BOOT_RECORD_CORE_SEGMENTS)? } as *const LblCoreSegmentsRecord;
+        let header_len = core::mem::size_of::<LblCoreSegmentsRecord>();
+        let (size, count) = unsafe { ((*record).header.size as usize, (*record).count as usize) };
+        if header_len + count * core::mem::size_of::<LblCoreSegment>() > size {
+            return None;
+        }
+        Some(unsafe { (&*record, core::slice::from_raw_parts(record.add(1) as *const LblCoreSegment, count)) })
+    }
+
+    /// Stage 1's checksummed ACPI table index, sorted by (signature, address).
+    ///
+    /// # Safety
+    /// Same as [`Self::find_record`].
+    pub unsafe fn acpi_tables(&self) -> Option<&[LblAcpiTableEntry]> {
+        let record = unsafe { self.find_record(Self::BOOT_RECORD_ACPI_INDEX)? } as *const LblAcpiIndexRecord;
+        let header_len = core::mem::size_of::<LblAcpiIndexRecord>();
+        let (size, count) = unsafe { ((*record).header.size as usize, (*record).count as usize) };
+        if header_len + count * core::mem::size_of::<LblAcpiTableEntry>() > size {
+            return None;
+        }
+        Some(unsafe { core::slice::from_raw_parts(record.add(1) as *const LblAcpiTableEntry, count) })
+    }
+
+    /// The boot timeline record, if Stage 1 appended one.
+    ///
+    /// # Safety
+    /// Same as [`Self::find_record`].
+    pub unsafe fn timeline(&self) -> Option<*mut LblTimelineRecord> {
+        let record = unsafe { self.find_record(Self::BOOT_RECORD_TIMELINE)? };
+        if (unsafe { (*record).size } as usize) < core::mem::size_of::<LblTimelineRecord>() {
+            return None;
+        }
+        Some(record as *mut LblTimelineRecord)
+    }
+}
+
+/// One firmware configuration table (LBL_CONFIG_TABLE_ENTRY).
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LblConfigTableEntry {
+    pub table_type: u32,
+    pub version: u32,
+    pub address: u64,
+}
+
+impl LblConfigTableEntry {
+    // LBL_CFG_* in LblUefi.h
+    pub const ACPI: u32 = 1; // version 2 = XSDT-capable RSDP
+    pub const SMBIOS: u32 = 2;
+    pub const SMBIOS3: u32 = 3;
+    pub const DEVICE_TREE: u32 = 4;
+    pub const MEMORY_ATTRIBUTES: u32 = 5;
+    pub const TYPE_COUNT: usize = 5;
+}
+
+/// Configuration table record (LBL_CONFIG_TABLES_RECORD).
+#[repr(C)]
+#[derive(Debug)]
+pub struct LblConfigTablesRecord {
+    pub header: LblBootRecordHeader,
+    pub count: u32,
+    pub rng_seed_size: u32,
+    pub rng_seed: [u8; 32],
+    pub entries: [LblConfigTableEntry; LblConfigTableEntry::TYPE_COUNT],
+}
+
+impl LblConfigTablesRecord {
+    pub fn entries(&self) -> &[LblConfigTableEntry] {
+        &self.entries[..(self.count as usize).min(LblConfigTableEntry::TYPE_COUNT)]
+    }
+
+    /// Firmware RNG output, for seeding the core's own generator.
+    pub fn rng_seed(&self) -> Option<&[u8]> {
+        match self.rng_seed_size as usize {
+            0 => None,
+            n => Some(&self.rng_seed[..n.min(self.rng_seed.len())]),
+        }
+    }
+}
+
+/// One CPU as reported by EFI_MP_SERVICES (LBL_CPU_ENTRY).
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LblCpuEntry {
+    pub apic_id: u32,
+    pub package: u32,
+    pub core: u32,
+    pub thread: u32,
+    pub flags: u32, // FLAG_*
+    pub mailbox: u32, // Index into the park block, or NO_MAILBOX
+}
+
+impl LblCpuEntry {
+    pub const FLAG_BSP: u32 = 0x1;
+    pub const FLAG_ENABLED: u32 = 0x2;
+    pub const FLAG_HEALTHY: u32 = 0x4;
+    pub const NO_MAILBOX: u32 = 0xFFFF_FFFF;
+}
+
+/// MP record header (LBL_MP_RECORD); `count` LblCpuEntry follow.
+#[repr(C)]
+#[derive(Debug)]
+pub struct LblMpRecord {
+    pub header: LblBootRecordHeader,
+    pub count: u32,
+    pub parked: u32,
+    pub park_block: u64, // *const mp::LblMpParkBlock (0 = APs not started)
+    pub stacks: u64,
+    pub stack_size: u32,
+    pub reserved: u32,
+}
+
+/// One preloaded file (LBL_MODULE_ENTRY).
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LblModuleEntry {
+    pub address: u64, // Page-aligned, 0 for an empty file
+    pub size: u64,
+    pub flags: u32,
+    pub name_length: u32,
+    pub name: [u8; LblModuleEntry::NAME_MAX],
+}
+
+impl LblModuleEntry {
+    pub const NAME_MAX: usize = 96;
+
+    /// The path as written in Stage 1's preload manifest.
+    pub fn name(&self) -> &[u8] {
+        &self.name[..(self.name_length as usize).min(Self::NAME_MAX - 1)]
+    }
+
+    /// The file contents.
+    ///
+    /// # Safety
+    /// The module pages must still be mapped and not reused.
+    pub unsafe fn data(&self) -> &'static [u8] {
+        if self.address == 0 {
+            return &[];
+        }
+        unsafe { core::slice::from_raw_parts(self.address as *const u8, self.size as usize) }
+    }
+}
+
+/// Module table header (LBL_MODULES_RECORD); `count` LblModuleEntry follow.
+#[repr(C)]
+#[derive(Debug)]
+pub struct LblModulesRecord {
+    pub header: LblBootRecordHeader,
+    pub count: u32,
+    pub skipped: u32, // Manifest lines Stage 1 could not load
+}
+
+/// LBL_SECTOR_CACHE_RECORD: where Stage 2 left its sector cache.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LblSectorCacheRecord {
+    pub header: LblBootRecordHeader,
+    pub region_addr: u64, // LblSectorCacheHeader; LBL_MEM_LOADER in the memory map
+    pub region_size: u64,
+}
+
+/// Boot slot report (LBL_CORE_SLOT_RECORD).
+#[repr(C)]
+#[derive(Debug)]
+pub struct LblCoreSlotRecord {
+    pub header: LblBootRecordHeader,
+    pub slot: u32,      // LblCoreSlotRecord::SLOT_*
+    pub preferred: u32, // LblCoreSlot variable as read, this boot counted if FLAG_COUNTED
+    pub attempts: u32,
+    pub max_attempts: u32,
+    pub flags: u32,         // LblCoreSlotRecord::FLAG_*
+    pub failures: [u32; 3], // LblCoreSlotRecord::FAILURE_* per SLOT_*
+}
+
+impl LblCoreSlotRecord {
+    pub const SLOT_A: u32 = 0;
+    pub const SLOT_B: u32 = 1;
+    pub const SLOT_SINGLE: u32 = 2;
+    pub const FLAG_DEMOTED: u32 = 0x1;
+    pub const FLAG_COUNTED: u32 = 0x2;
+    pub const FLAG_CONFIRMED: u32 = 0x4;
+    pub const FAILURE_NONE: u32 = 0;
+    pub const FAILURE_NOT_FOUND: u32 = 1;
+    pub const FAILURE_READ: u32 = 2;
+    pub const FAILURE_HEADER: u32 = 3;
+    pub const FAILURE_DIGEST: u32 = 4;
+    pub const FAILURE_MEMORY: u32 = 5;
+}
+
+/// Segment table header (LBL_CORE_SEGMENTS_RECORD); `count` LblCoreSegment follow.
+#[repr(C)]
+#[derive(Debug)]
+pub struct LblCoreSegmentsRecord {
+    pub header: LblBootRecordHeader,
+    pub format: u32, // LblCoreSegmentsRecord::FORMAT_*
+    pub count: u32,
+}
+
+impl LblCoreSegmentsRecord {
+    pub const FORMAT_ELF64: u32 = 1;
+    pub const FORMAT_PE32PLUS: u32 = 2;
+}
+
+/// One loaded core segment (LBL_CORE_SEGMENT).
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LblCoreSegment {
+    pub offset: u64, // From core_load_addr
+    pub size: u64,   // In memory, .bss included
+    pub flags: u32,  // LblCoreSegment::READ / WRITE / EXEC
+    pub reserved: u32,
+}
+
+impl LblCoreSegment {
+    pub const READ: u32 = 0x1;
+    pub const WRITE: u32 = 0x2;
+    pub const EXEC: u32 = 0x4;
+}
+
+/// One indexed ACPI table (LBL_ACPI_TABLE_ENTRY).
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LblAcpiTableEntry {
+    pub signature: u32, // ASCII bytes as little-endian u32, see `signature()`
+    pub length: u32,
+    pub address: u64,
+}
+
+impl LblAcpiTableEntry {
+    pub const fn signature(name: &[u8; 4]) -> u32 {
+        u32::from_le_bytes(*name)
+    }
+
+    /// All tables with `name` (several for SSDT), by binary search over the index.
+    pub fn find<'a>(tables: &'a [LblAcpiTableEntry], name: &[u8; 4]) -> &'a [LblAcpiTableEntry] {
+        let key = Self::signature(name);
+        let start = tables.partition_point(|t| t.signature < key);
+        let end = start + tables[start..].partition_point(|t| t.signature == key);
+        &tables[start..end]
+    }
+}
+
+/// ACPI index record header (LBL_ACPI_INDEX_RECORD); `count` entries follow.
+#[repr(C)]
+#[derive(Debug)]
+pub struct LblAcpiIndexRecord {
+    pub header: LblBootRecordHeader,
+    pub count: u32,
+    pub dropped: u32,
+    pub root: u64,
+}
+
+/// Decoded framebuffer pixel layout (see `LblBootInfoRaw::framebuffer_layout`).
+/// Channels are `(shift, size)` within a little-endian pixel of `bytes_per_pixel`.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct LblPixelLayout {
+    pub format: u8, // LblBootInfoRaw::FB_FORMAT_*
+    pub bytes_per_pixel: u8,
+    pub red: (u8, u8),
+    pub green: (u8, u8),
+    pub blue: (u8, u8),
+    pub reserved: (u8, u8),
+}
+
+impl LblPixelLayout {
+    /// Packs an 0x00RRGGBB colour into this layout, scaling each channel to its size.
+    pub fn pack_rgb(&self, rgb: u32) -> u32 {
+        match self.format {
+            LblBootInfoRaw::FB_FORMAT_BGRX8888 => rgb & 0x00FF_FFFF,
+            LblBootInfoRaw::FB_FORMAT_RGBX8888 => {
+                ((rgb >> 16) & 0xFF) | (rgb & 0xFF00) | ((rgb & 0xFF) << 16)
+            }
+            _ => {
+                let chan = |value: u32, (shift, size): (u8, u8)| -> u32 {
+                    if size == 0 {
+                        0
+                    } else if size >= 8 {
+                        (value << (size - 8)) << shift
+                    } else {
+                        (value >> (8 - size)) << shift
+                    }
+                };
+                chan((rgb >> 16) & 0xFF, self.red) | chan((rgb >> 8) & 0xFF, self.green) | chan(rgb & 0xFF, self.blue)
+            }
+        }
+    }
+}
+
+/// Header of Stage 1's log ring (LBL_UEFI_LOG_RING); `capacity` data bytes follow.
+/// Each line is one level byte (log::LevelFilter value), ASCII text and b'\n'.
+#[repr(C)]
+pub struct LblStage1LogRing {
+    pub written: u64, // Bytes ever appended; the ring keeps the last `capacity`
+    pub flushed: u64, // Bytes Stage 1 already sent to its console
+    pub capacity: u32,
+    pub record_level: u8,
+    pub console_level: u8,
+    pub reserved: u16,
+}
+
+impl LblStage1LogRing {
+    /// Byte at absolute stream position `pos` (must be within the last `capacity`).
+    ///
+    /// # Safety
+    /// `self` must be followed by its `capacity` data bytes.
+    pub unsafe fn byte_at(&self, pos: u64) -> u8 {
+        let data = unsafe { (self as *const Self).add(1) as *const u8 };
+        unsafe { *data.add((pos & (self.capacity as u64 - 1)) as usize) }
+    }
+}
+
+/// One compact memory map entry (LBL_MEMORY_RANGE).
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct LblMemoryRange {
+    pub base: u64,
+    pub pages: u32, // 4 KiB pages
+    pub range_type: u32, // LblMemoryRange::USABLE ...
+}
+
+impl LblMemoryRange {
+    // LBL_MEM_* in LblUefi.h
+    pub const USABLE: u32 = 1;
+    pub const LOADER: u32 = 2;
+    pub const RESERVED: u32 = 3;
+    pub const ACPI_RECLAIM: u32 = 4;
+    pub const ACPI_NVS: u32 = 5;
+    pub const RUNTIME: u32 = 6;
+    pub const MMIO: u32 = 7;
+    pub const PERSISTENT: u32 = 8;
+    pub const CORE_HEAP: u32 = 9;
+
+    pub const PAGE_SIZE: u64 = 4096;
+
+    pub fn end(&self) -> u64 {
+        self.base + self.pages as u64 * Self::PAGE_SIZE
+    }
+
+    /// Binary search of a compact map for the range containing `addr`.
+    pub fn find(map: &[LblMemoryRange], addr: u64) -> Option<&LblMemoryRange> {
+        let index = map.partition_point(|range| range.base <= addr);
+        if index == 0 {
+            return None;
+        }
+        let range = &map[index - 1];
+        if addr < range.end() { Some(range) } else { None }
+    }
+}
+
+/// Compact memory map record header (LBL_COMPACT_MEMORY_MAP_RECORD); `capacity`
+/// LblMemoryRange slots follow, the first `count` of them used.
+#[repr(C)]
+pub struct LblCompactMemoryMapRecord {
+    pub header: LblBootRecordHeader,
+    pub count: u32,
+    pub capacity: u32,
+}
+
+/// Header of each record appended after LblBootInfoRaw (LBL_BOOT_RECORD_HEADER).
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LblBootRecordHeader {
+    pub record_type: u32,
+    pub size: u32, // Including this header
+}
+
+/// One boot timeline event (LBL_TIMELINE_EVENT).
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LblTimelineEvent {
+    pub ticks: u64, // TSC / CNTVCT_EL0
+    pub id: u32,    // LBL_TL_* (Stage 1) or logger::timeline::* (core)
+    pub arg: u32,
+}
+
+pub const LBL_TIMELINE_CAPACITY: usize = 64;
+
+/// Boot timeline record (LBL_TIMELINE_RECORD). Stage 1 fills the first events and
+/// the core keeps appending (see `logger::timeline_mark`).
+#[repr(C)]
+pub struct LblTimelineRecord {
+    pub header: LblBootRecordHeader,
+    pub version: u32,
+    pub capacity: u32,
+    pub count: u32,
+    pub dropped: u32,
+    pub ticks_per_second: u64, // 0 = not calibrated
+    pub events: [LblTimelineEvent; LBL_TIMELINE_CAPACITY],
+}
+
 // Rust equivalent of EFI_MEMORY_DESCRIPTOR would also be needed with #[repr(C)]
 #[repr(C)]
 pub struct EfiMemoryDescriptorRaw {
@@ -5,6 +5,7 @@
 use alloc::{boxed::Box, vec::Vec};
 
 use crate::hal::device_manager::{DeviceManager, DiscoveredDeviceCallback};
+use crate::hal::mp::{ApJob, ApPool, WorkQueue};
 use crate::hal::DeviceType;
 use crate::logger;
 
@@ -43,33 +44,95 @@ pub enum ProbeError {
     OtherStatic(&'static str),
 }
 
+// --- Probe bodies ---
+// Shared by the AP path and the future-based path. On the AP path they run on
+// any CPU (64 KiB stack, interrupts off) at the same time, so they must not log:
+// the logger has a single writer, the BSP. Devices go out through `report`.
+
+fn probe_storage(_report: &DiscoveredDeviceCallback) {
+    // TODO: Implement actual storage probing logic (e.g., scan PCI for AHCI/NVMe, USB for MSC)
+    // For SATA/AHCI: enumerate PCI for AHCI controllers, then scan ports.
+    // For NVMe: enumerate PCI for NVMe controllers.
+    // For USB Mass Storage: requires USB controller and hub enumeration.
+    // Report discovered devices:
+    // _report(Device { id: 1, name: "SATA SSD".to_string(), device_type: DeviceType::Storage });
+    // _report(Device { id: 2, name: "NVMe Drive".to_string(), device_type: DeviceType::Storage });
+}
+
+fn probe_network(_report: &DiscoveredDeviceCallback) {
+    // TODO: Implement network probing (e.g., scan PCI for Ethernet controllers)
+    // _report(Device { id: 3, name: "Ethernet Controller".to_string(), device_type: DeviceType::Network });
+}
+
+fn probe_gpu(_report: &DiscoveredDeviceCallback) {
+    // TODO: Implement GPU probing (typically PCI, could also be platform-specific like Raspberry Pi GPU)
+    // _report(Device { id: 4, name: "Integrated GPU".to_string(), device_type: DeviceType::Gpu });
+}
+
+fn probe_input(_report: &DiscoveredDeviceCallback) {
+    // TODO: Implement input device probing
+    // Legacy: PS/2 controller. Modern: USB HID.
+    // _report(Device { id: 5, name: "USB Keyboard".to_string(), device_type: DeviceType::InputKeyboard });
+    // _report(Device { id: 6, name: "USB Mouse".to_string(), device_type: DeviceType::InputMouse });
+}
+
+// AP job wrappers: `arg` is the `&DiscoveredDeviceCallback` `run_on_aps` passes.
+macro_rules! probe_job {
+    ($job:ident, $probe:ident) => {
+        extern "sysv64" fn $job(arg: u64) {
+            $probe(unsafe { &*(arg as *const DiscoveredDeviceCallback) });
+        }
+    };
+}
+probe_job!(probe_storage_job, probe_storage);
+probe_job!(probe_network_job, probe_network);
+probe_job!(probe_gpu_job, probe_gpu);
+probe_job!(probe_input_job, probe_input);
+
+/// Runs every probe at once on the BSP and the APs Stage 1 parked (`mp::ApPool`)
+/// and returns the number of probes, all finished.
+fn run_on_aps(pool: &ApPool, report: &DiscoveredDeviceCallback) -> usize {
+    let arg = report as *const DiscoveredDeviceCallback as u64;
+    let jobs: [(ApJob, u64); 4] = [
+        (probe_storage_job, arg),
+        (probe_network_job, arg),
+        (probe_gpu_job, arg),
+        (probe_input_job, arg),
+    ];
+    logger::info!("[HAL_PROBE] Running {} probes on the BSP and {} parked AP(s)...", jobs.len(), pool.len());
+    pool.run(&WorkQueue::new(&jobs));
+    jobs.len()
+}
+
 /// Initializes and starts the asynchronous device probing tasks.
 ///
 /// `device_manager_callback` is a way for probe tasks to report discovered devices.
 /// In a more complex system, probe tasks might interact directly with a shared `DeviceManager`
 /// instance, using appropriate synchronization (e.g., Mutex from `spin` crate).
+/// With parked APs (`pool`) the probes run in parallel right away and the
+/// handle is complete on return; otherwise they become futures polled on the BSP.
 #[cfg(feature = "with_alloc")]
 pub fn start_probes(
     device_manager_callback: DiscoveredDeviceCallback,
+    pool: Option<&ApPool>,
     // Other necessary HAL services like PciService, UsbService would be passed here
     // pci: &'static PciService, // Example: needs to be 'static if futures are 'static
     // acpi: &'static AcpiService,
 ) -> ProbeHandle {
     logger::info!("[HAL_PROBE] Starting specific device probes...");
 
+    if let Some(pool) = pool.filter(|pool| !pool.is_empty()) {
+        let total_tasks = run_on_aps(pool, &device_manager_callback);
+        return ProbeHandle { tasks: Vec::new(), total_tasks, completed_tasks: total_tasks };
+    }
+
     let mut tasks = Vec::new();
 
     // --- Storage Devices Probe ---
     let cb_storage = device_manager_callback.clone();
     tasks.push(Box::pin(async move {
         logger::info!("[HAL_PROBE] Probing storage devices...");
-        // TODO: Implement actual storage probing logic (e.g., scan PCI for AHCI/NVMe, USB for MSC)
-        // For SATA/AHCI: enumerate PCI for AHCI controllers, then scan ports.
-        // For NVMe: enumerate PCI for NVMe controllers.
-        // For USB Mass Storage: requires USB controller and hub enumeration.
-        // Report discovered devices:
-        // cb_storage(Device { id: 1, name: "SATA SSD".to_string(), device_type: DeviceType::Storage });
-        // cb_storage(Device { id: 2, name: "NVMe Drive".to_string(), device_type: DeviceType::Storage });
+        probe_storage(&cb_storage);
         core::future::ready(Ok(())).await // Placeholder for actual async work
     }) as BoxFuture<'static, Result<(), ProbeError>>);
 
@@ -77,8 +140,7 @@ pub fn start_probes(
     let cb_network = device_manager_callback.clone();
     tasks.push(Box::pin(async move {
         logger::info!("[HAL_PROBE] Probing network devices...");
-        // TODO: Implement network probing (e.g., scan PCI for Ethernet controllers)
-        // cb_network(Device { id: 3, name: "Ethernet Controller".to_string(), device_type: DeviceType::Network });
+        probe_network(&cb_network);
         core::future::ready(Ok(())).await
     }) as BoxFuture<'static, Result<(), ProbeError>>);
 
@@ -86,8 +148,7 @@ pub fn start_probes(
     let cb_gpu = device_manager_callback.clone();
     tasks.push(Box::pin(async move {
         logger::info!("[HAL_PROBE] Probing GPU...");
-        // TODO: Implement GPU probing (typically PCI, could also be platform-specific like Raspberry Pi GPU)
-        // cb_gpu(Device { id: 4, name: "Integrated GPU".to_string(), device_type: DeviceType::Gpu });
+        probe_gpu(&cb_gpu);
         core::future::ready(Ok(())).await
     }) as BoxFuture<'static, Result<(), ProbeError>>);
 
@@ -95,10 +156,7 @@ pub fn start_probes(
     let cb_input = device_manager_callback.clone();
     tasks.push(Box::pin(async move {
         logger::info!("[HAL_PROBE] Probing input devices (KB, Mouse)...");
-        // TODO: Implement input device probing
-        // Legacy: PS/2 controller. Modern: USB HID.
-        // cb_input(Device { id: 5, name: "USB Keyboard".to_string(), device_type: DeviceType::InputKeyboard });
-        // cb_input(Device { id: 6, name: "USB Mouse".to_string(), device_type: DeviceType::InputMouse });
+        probe_input(&cb_input);
         core::future::ready(Ok(())).await
     }) as BoxFuture<'static, Result<(), ProbeError>>);
 
@@ -114,9 +172,22 @@ pub fn start_probes(
 
 #[cfg(not(feature = "with_alloc"))]
 pub fn start_probes(
-    _device_manager_callback: DiscoveredDeviceCallback, // Callback might be harder without alloc
+    device_manager_callback: DiscoveredDeviceCallback, // Callback might be harder without alloc
+    pool: Option<&ApPool>,
 ) -> ProbeHandle {
     logger::info!("[HAL_PROBE] Starting specific device probes (no_alloc mode)...");
+
+    if let Some(pool) = pool.filter(|pool| !pool.is_empty()) {
+        let total_tasks = run_on_aps(pool, &device_manager_callback);
+        return ProbeHandle {
+            probing_storage: false,
+            probing_network: false,
+            probing_gpu: false,
+            probing_input: false,
+            total_tasks,
+            completed_tasks: total_tasks,
+        };
+    }
     // In no_alloc mode, "async" is more conceptual. We might just sequentially
     // call blocking probe functions here, or have functions that do a small piece of work
     // and return quickly, to be called repeatedly.
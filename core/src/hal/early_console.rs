@@ -0,0 +1,252 @@
+// Lionbootloader Core - HAL Early Console
+// File: core/src/hal/early_console.rs
+
+//! Stage 1's framebuffer / serial text console (stage1/common/stage1_fbcon.h),
+//! carried on from the same cursor. It needs nothing but the framebuffer, the
+//! glyph cache Stage 1 expanded into native pixels and, on x86, COM1, so the
+//! log has somewhere to go from the first instruction of the core until the GUI
+//! owns the screen. Stage 1's own last line (the "Entering LBL Core" message)
+//! stays on screen above the core's first one.
+
+use core::fmt;
+
+use crate::hal::mem_ops::MemOps;
+use crate::hal::LblBootInfoRaw;
+use crate::logger::LogWriter;
+
+const CONSOLE_VERSION: u32 = 1; // LBL_FBCON_VERSION
+
+const GLYPH_WIDTH: usize = 8;
+const GLYPH_HEIGHT: usize = 16;
+const FIRST_GLYPH: u8 = 0x20;
+const BOX_GLYPH: u32 = 95; // LBL_FBCON_GLYPH_COUNT - 1
+const TAB_WIDTH: u32 = 8;
+const SERIAL_SPIN: u32 = 100_000; // LBL_FBCON_SERIAL_SPIN
+
+// LBL_FBCON_FLAG_*
+pub const FLAG_FRAMEBUFFER: u32 = 0x1;
+pub const FLAG_SERIAL: u32 = 0x2;
+pub const FLAG_STARTED: u32 = 0x4;
+
+/// LBL_FBCON, right behind the record header. Shared with Stage 1: the cursor
+/// and flags are updated in place.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LblEarlyConsole {
+    pub version: u32,
+    pub flags: u32, // FLAG_*
+    pub framebuffer: u64,
+    pub glyph_cache: u64, // [u64; 95 + 1][16][4] native pixel pairs, left one low
+    pub pitch: u32,
+    pub height: u32,
+    pub columns: u32,
+    pub rows: u32,
+    pub column: u32,
+    pub row: u32,
+    pub foreground: u32,
+    pub background: u32,
+    pub scroll_rows: u32,
+    pub serial_port: u16,
+    pub reserved: u16,
+}
+
+/// Writer over the console state in the boot record.
+pub struct EarlyConsole {
+    state: &'static mut LblEarlyConsole,
+}
+
+#[cfg(any(target_arch = "x86_64", target_arch = "x86"))]
+mod serial {
+    use core::arch::asm;
+
+    unsafe fn outb(port: u16, value: u8) {
+        unsafe {
+            asm!("out dx, al", in("dx") port, in("al") value, options(nomem, nostack, preserves_flags))
+        };
+    }
+
+    unsafe fn inb(port: u16) -> u8 {
+        let value: u8;
+        unsafe {
+            asm!("in al, dx", out("al") value, in("dx") port, options(nomem, nostack, preserves_flags))
+        };
+        value
+    }
+
+    /// 115200 baud, 8N1, FIFOs on, interrupts off (as lbl_fbcon_serial_start).
+    pub unsafe fn start(port: u16) {
+        unsafe {
+            outb(port + 1, 0x00);
+            outb(port + 3, 0x80);
+            outb(port, 0x01);
+            outb(port + 1, 0x00);
+            outb(port + 3, 0x03);
+            outb(port + 2, 0xC7);
+            outb(port + 4, 0x03);
+        }
+    }
+
+    /// Sends a byte once the transmitter is empty; false if it never was.
+    pub unsafe fn put(port: u16, byte: u8) -> bool {
+        for _ in 0..super::SERIAL_SPIN {
+            if unsafe { inb(port + 5) } & 0x20 != 0 {
+                unsafe { outb(port, byte) };
+                return true;
+            }
+        }
+        false
+    }
+}
+
+#[cfg(not(any(target_arch = "x86_64", target_arch = "x86")))]
+mod serial {
+    pub unsafe fn start(_port: u16) {}
+
+    pub unsafe fn put(_port: u16, _byte: u8) -> bool {
+        false
+    }
+}
+
+impl EarlyConsole {
+    /// Takes over Stage 1's console, if it handed one over.
+    ///
+    /// # Safety
+    /// `boot_info` must come from Stage 1; the record, the glyph cache and the
+    /// framebuffer must stay mapped, and no other `EarlyConsole` may be live.
+    pub unsafe fn from_boot_info(boot_info: &'static LblBootInfoRaw) -> Option<Self> {
+        let state = unsafe { boot_info.early_console()? };
+        unsafe { Self::from_raw(state) }
+    }
+
+    /// # Safety
+    /// Same as [`Self::from_boot_info`], for a pointer taken from the record.
+    pub unsafe fn from_raw(state: *mut LblEarlyConsole) -> Option<Self> {
+        if state.is_null() {
+            return None;
+        }
+        let state = unsafe { &mut *state };
+        if state.version != CONSOLE_VERSION || state.flags & (FLAG_FRAMEBUFFER | FLAG_SERIAL) == 0 {
+            return None;
+        }
+        Some(EarlyConsole { state })
+    }
+
+    pub fn flags(&self) -> u32 {
+        self.state.flags
+    }
+
+    fn start(&mut self) {
+        let s = &mut *self.state;
+        if s.flags & FLAG_FRAMEBUFFER != 0 {
+            let words = s.height as usize * s.pitch as usize / 4;
+            // Safety: the framebuffer spans height * pitch bytes (checked by Stage 1).
+            let pixels = unsafe { core::slice::from_raw_parts_mut(s.framebuffer as usize as *mut u32, words) };
+            MemOps::current().fill32(pixels, s.background);
+        }
+        if s.flags & FLAG_SERIAL != 0 {
+            unsafe { serial::start(s.serial_port) };
+        }
+        s.flags |= FLAG_STARTED;
+    }
+
+    /// Copies a glyph from the cache into a text cell, one 32-byte row at a time.
+    fn draw(&self, glyph: u32, column: u32, row: u32) {
+        let s = &*self.state;
+        let row_bytes = GLYPH_WIDTH * 4;
+        let mut src =
+            (s.glyph_cache as usize + glyph as usize * GLYPH_HEIGHT * row_bytes) as *const u64;
+        let mut line = s.framebuffer as usize
+            + row as usize * GLYPH_HEIGHT * s.pitch as usize
+            + column as usize * row_bytes;
+        for _ in 0..GLYPH_HEIGHT {
+            let dst = line as *mut u64;
+            // Safety: the cell lies inside the framebuffer and the glyph inside the cache.
+            unsafe {
+                for i in 0..row_bytes / 8 {
+                    core::ptr::write_volatile(dst.add(i), *src.add(i));
+                }
+                src = src.add(row_bytes / 8);
+            }
+            line += s.pitch as usize;
+        }
+    }
+
+    /// Moves the text up by `scroll_rows` rows in one memmove (reads from the
+    /// framebuffer are slow) and clears the rows that become free, both with
+    /// Stage 1's routines when it published them (`hal::mem_ops`).
+    fn scroll(&mut self) {
+        let s = &mut *self.state;
+        let ops = MemOps::current();
+        let base = s.framebuffer as usize as *mut u8;
+        let row_bytes = GLYPH_HEIGHT * s.pitch as usize;
+        let by = s.scroll_rows.clamp(1, s.rows) as usize;
+        let keep = (s.rows as usize - by) * row_bytes;
+        // Safety: both ranges lie in the rows * row_bytes bytes of text area.
+        unsafe {
+            ops.move_raw(base, base.add(by * row_bytes), keep);
+            let freed = core::slice::from_raw_parts_mut(base.add(keep) as *mut u32, by * row_bytes / 4);
+            ops.fill32(freed, s.background);
+        }
+        s.row = s.row.saturating_sub(by as u32);
+    }
+
+    fn newline(&mut self) {
+        self.state.column = 0;
+        self.state.row += 1;
+        if self.state.row >= self.state.rows {
+            self.scroll();
+        }
+    }
+
+    fn serial_byte(&mut self, byte: u8) {
+        let port = self.state.serial_port;
+        let sent =
+            unsafe { (byte != b'\n' || serial::put(port, b'\r')) && serial::put(port, byte) };
+        if !sent {
+            self.state.flags &= !FLAG_SERIAL; // Stuck transmitter: stop paying the timeout
+        }
+    }
+
+    pub fn write_bytes(&mut self, bytes: &[u8]) {
+        if self.state.flags & FLAG_STARTED == 0 {
+            self.start();
+        }
+        for &byte in bytes {
+            if self.state.flags & FLAG_SERIAL != 0 {
+                self.serial_byte(byte);
+            }
+            if self.state.flags & FLAG_FRAMEBUFFER == 0 {
+                continue;
+            }
+            match byte {
+                b'\n' => self.newline(),
+                b'\r' => self.state.column = 0,
+                b'\t' => {
+                    let next = (self.state.column + TAB_WIDTH) & !(TAB_WIDTH - 1);
+                    self.state.column = next.min(self.state.columns);
+                }
+                0x08 => self.state.column = self.state.column.saturating_sub(1),
+                _ => {
+                    if self.state.column >= self.state.columns {
+                        self.newline();
+                    }
+                    let glyph = match byte {
+                        FIRST_GLYPH..=0x7E => (byte - FIRST_GLYPH) as u32,
+                        _ => BOX_GLYPH,
+                    };
+                    self.draw(glyph, self.state.column, self.state.row);
+                    self.state.column += 1;
+                }
+            }
+        }
+    }
+}
+
+impl fmt::Write for EarlyConsole {
+    fn write_str(&mut self, s: &str) -> fmt::Result {
+        self.write_bytes(s.as_bytes());
+        Ok(())
+    }
+}
+
+impl LogWriter for EarlyConsole {}
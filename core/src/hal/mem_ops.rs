@@ -0,0 +1,202 @@
+// Lionbootloader Core - HAL Stage 1 Memory Routines
+// File: core/src/hal/mem_ops.rs
+
+//! The copy / fill / compare routines Stage 1 already dispatched for this CPU
+//! (stage1/common/stage1_mem.h): REP MOVSB with ERMS / FSRM, SSE2 / AVX
+//! non-temporal stores for blocks of `stream_threshold` bytes and more, NEON on
+//! AArch64. Bulk work such as placing a kernel, relocating modules or clearing
+//! the framebuffer goes through here instead of byte loops; without the record
+//! (the BIOS loader never publishes one) every call falls back to `core::ptr`.
+//! `lbl_core_entry` installs the table once, and `MemOps::current` hands it to
+//! callers such as the early console; `core::ptr::copy` and the compiler's own
+//! memcpy calls are not redirected. The code lives in the Stage 1 image, so its
+//! memory must stay reserved while this table is in use.
+
+use core::cmp::Ordering;
+use core::sync::atomic::{self, AtomicPtr};
+
+use crate::hal::LblBootInfoRaw;
+
+const OPS_VERSION: u32 = 1; // LBL_MEM_OPS_VERSION
+
+// LBL_MEM_FEATURE_*
+pub const FEATURE_ERMS: u32 = 0x01;
+pub const FEATURE_FSRM: u32 = 0x02;
+pub const FEATURE_SSE2: u32 = 0x04;
+pub const FEATURE_AVX: u32 = 0x08;
+pub const FEATURE_NEON: u32 = 0x10;
+
+// LBL_MEM_ABI: System V on x86_64 whatever the loader's own convention.
+#[cfg(target_arch = "x86_64")]
+mod abi {
+    pub type CopyFn = unsafe extern "sysv64" fn(*mut u8, *const u8, usize) -> *mut u8;
+    pub type SetFn = unsafe extern "sysv64" fn(*mut u8, i32, usize) -> *mut u8;
+    pub type Fill32Fn = unsafe extern "sysv64" fn(*mut u32, u32, usize);
+    pub type CompareFn = unsafe extern "sysv64" fn(*const u8, *const u8, usize) -> i32;
+}
+#[cfg(not(target_arch = "x86_64"))]
+mod abi {
+    pub type CopyFn = unsafe extern "C" fn(*mut u8, *const u8, usize) -> *mut u8;
+    pub type SetFn = unsafe extern "C" fn(*mut u8, i32, usize) -> *mut u8;
+    pub type Fill32Fn = unsafe extern "C" fn(*mut u32, u32, usize);
+    pub type CompareFn = unsafe extern "C" fn(*const u8, *const u8, usize) -> i32;
+}
+
+/// LBL_MEM_OPS, right behind the record header.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LblMemOps {
+    pub version: u32,
+    pub features: u32, // FEATURE_*
+    pub stream_threshold: u32,
+    pub reserved: u32,
+    pub copy: u64,
+    pub move_: u64,
+    pub set: u64,
+    pub fill32: u64,
+    pub compare: u64,
+}
+
+#[derive(Clone, Copy)]
+pub struct MemOps {
+    features: u32,
+    stream_threshold: usize,
+    copy: Option<abi::CopyFn>,
+    move_: Option<abi::CopyFn>,
+    set: Option<abi::SetFn>,
+    fill32: Option<abi::Fill32Fn>,
+    compare: Option<abi::CompareFn>,
+}
+
+// The table `install` adopted; null means the fallbacks.
+static INSTALLED: AtomicPtr<LblMemOps> = AtomicPtr::new(core::ptr::null_mut());
+
+/// Makes Stage 1's table, if it published a usable one, what `MemOps::current` returns.
+///
+/// # Safety
+/// Same as [`MemOps::from_boot_info`], for as long as the core runs.
+pub unsafe fn install(boot_info: &'static LblBootInfoRaw) {
+    if let Some(ops) = unsafe { boot_info.mem_ops() } {
+        if ops.version == OPS_VERSION {
+            INSTALLED.store(ops as *const LblMemOps as *mut LblMemOps, atomic::Ordering::Release);
+        }
+    }
+}
+
+fn entry<F: Copy>(addr: u64) -> Option<F> {
+    if addr == 0 || addr > usize::MAX as u64 {
+        return None;
+    }
+    // Safety: F is one of the fn pointer aliases above (pointer sized).
+    Some(unsafe { core::mem::transmute_copy(&(addr as usize)) })
+}
+
+impl MemOps {
+    /// Routines used when Stage 1 published none.
+    pub const FALLBACK: MemOps = MemOps {
+        features: 0,
+        stream_threshold: usize::MAX,
+        copy: None,
+        move_: None,
+        set: None,
+        fill32: None,
+        compare: None,
+    };
+
+    /// Adopts Stage 1's table, or the `core::ptr` fallbacks if there is none.
+    ///
+    /// # Safety
+    /// `boot_info` must come from Stage 1 and its image must not be reused while
+    /// the returned value lives.
+    pub unsafe fn from_boot_info(boot_info: &'static LblBootInfoRaw) -> Self {
+        match unsafe { boot_info.mem_ops() } {
+            Some(ops) if ops.version == OPS_VERSION => Self::from_table(ops),
+            _ => Self::FALLBACK,
+        }
+    }
+
+    /// The routines `install` adopted, or the fallbacks before that.
+    pub fn current() -> Self {
+        let ops = INSTALLED.load(atomic::Ordering::Acquire);
+        if ops.is_null() {
+            return Self::FALLBACK;
+        }
+        // Safety: `install` only stores a checked table that outlives the core.
+        Self::from_table(unsafe { &*ops })
+    }
+
+    fn from_table(ops: &LblMemOps) -> Self {
+        MemOps {
+            features: ops.features,
+            stream_threshold: ops.stream_threshold as usize,
+            copy: entry(ops.copy),
+            move_: entry(ops.move_),
+            set: entry(ops.set),
+            fill32: entry(ops.fill32),
+            compare: entry(ops.compare),
+        }
+    }
+
+    /// FEATURE_* the routines were dispatched for.
+    pub fn features(&self) -> u32 {
+        self.features
+    }
+
+    /// Copies and fills this large bypass the cache.
+    pub fn stream_threshold(&self) -> usize {
+        self.stream_threshold
+    }
+
+    pub fn copy(&self, dst: &mut [u8], src: &[u8]) {
+        let len = dst.len().min(src.len());
+        match self.copy {
+            // Safety: both slices hold `len` bytes and cannot overlap.
+            Some(copy) => unsafe {
+                copy(dst.as_mut_ptr(), src.as_ptr(), len);
+            },
+            None => dst[..len].copy_from_slice(&src[..len]),
+        }
+    }
+
+    /// memmove: copies `len` bytes between ranges that may overlap.
+    ///
+    /// # Safety
+    /// Both ranges must be valid for `len` bytes.
+    pub unsafe fn move_raw(&self, dst: *mut u8, src: *const u8, len: usize) {
+        match self.move_ {
+            Some(move_) => unsafe {
+                move_(dst, src, len);
+            },
+            None => unsafe { core::ptr::copy(src, dst, len) },
+        }
+    }
+
+    pub fn fill(&self, dst: &mut [u8], value: u8) {
+        match self.set {
+            Some(set) => unsafe {
+                set(dst.as_mut_ptr(), value as i32, dst.len());
+            },
+            None => dst.fill(value),
+        }
+    }
+
+    /// Fills whole pixels with non-temporal stores (framebuffer clears).
+    pub fn fill32(&self, dst: &mut [u32], pattern: u32) {
+        match self.fill32 {
+            Some(fill32) => unsafe {
+                fill32(dst.as_mut_ptr(), pattern, dst.len());
+            },
+            None => dst.fill(pattern),
+        }
+    }
+
+    /// Compares the common prefix of `a` and `b`, then their lengths.
+    pub fn compare(&self, a: &[u8], b: &[u8]) -> Ordering {
+        let len = a.len().min(b.len());
+        let prefix = match self.compare {
+            Some(compare) => unsafe { compare(a.as_ptr(), b.as_ptr(), len).cmp(&0) },
+            None => a[..len].cmp(&b[..len]),
+        };
+        prefix.then(a.len().cmp(&b.len()))
+    }
+}
@@ -0,0 +1,148 @@
+// Lionbootloader Core - HAL Application Processors
+// File: core/src/hal/mp.rs
+
+//! APs parked by Stage 1 (stage1/common/stage1_mp.h). Each AP spins (PAUSE or
+//! MONITOR/MWAIT) on its own cache-line mailbox; the BSP hands it a job by writing
+//! `job` / `arg` and then setting `state` to `RUN`. Only the BSP dispatches.
+
+use core::sync::atomic::{AtomicU32, AtomicU64, AtomicUsize, Ordering};
+
+use crate::hal::{LblBootInfoRaw, LblCpuEntry};
+
+// LBL_AP_STATE_*
+pub const AP_STATE_OFFLINE: u32 = 0;
+pub const AP_STATE_PARKED: u32 = 1;
+pub const AP_STATE_RUN: u32 = 2;
+pub const AP_STATE_BUSY: u32 = 3;
+pub const AP_STATE_DISABLED: u32 = 4;
+
+const PARK_MAGIC: u32 = 0x4B52_504C; // LBL_MP_PARK_MAGIC ("LPRK")
+
+/// A job as APs call it: on a 64 KiB stack, interrupts disabled.
+pub type ApJob = extern "sysv64" fn(u64);
+
+/// LBL_AP_MAILBOX.
+#[repr(C, align(64))]
+pub struct LblApMailbox {
+    pub state: AtomicU32,
+    pub apic_id: u32,
+    pub job: AtomicU64,
+    pub arg: AtomicU64,
+    pub completed: AtomicU64,
+    pub stack_top: u64,
+    reserved: [u8; 24],
+}
+
+/// LBL_MP_PARK_BLOCK header; `count` mailboxes follow.
+#[repr(C, align(64))]
+pub struct LblMpParkBlock {
+    pub magic: u32,
+    pub count: u32,
+    pub use_mwait: u32,
+    pub reserved: u32,
+    pub pat: u64,
+}
+
+/// The parked APs, as handed over by Stage 1.
+pub struct ApPool {
+    mailboxes: &'static [LblApMailbox],
+    cpus: &'static [LblCpuEntry],
+}
+
+impl ApPool {
+    /// # Safety
+    /// `boot_info` must come from Stage 1 and its LoaderData/LoaderCode pages (park
+    /// block, AP stacks, trampoline, Stage 1 image) must not have been reused.
+    pub unsafe fn from_boot_info(boot_info: &'static LblBootInfoRaw) -> Option<ApPool> {
+        let (record, cpus) = unsafe { boot_info.mp()? };
+        if record.park_block == 0 {
+            return None;
+        }
+        let block = unsafe { &*(record.park_block as *const LblMpParkBlock) };
+        if block.magic != PARK_MAGIC {
+            return None;
+        }
+        let first = unsafe { (block as *const LblMpParkBlock).add(1) as *const LblApMailbox };
+        let mailboxes = unsafe { core::slice::from_raw_parts(first, block.count as usize) };
+        Some(ApPool { mailboxes, cpus })
+    }
+
+    pub fn len(&self) -> usize {
+        self.mailboxes.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.mailboxes.is_empty()
+    }
+
+    /// Topology of the AP behind mailbox `index`, for placing jobs next to their device.
+    pub fn cpu(&self, index: usize) -> Option<&LblCpuEntry> {
+        self.cpus.iter().find(|c| c.mailbox as usize == index)
+    }
+
+    pub fn is_parked(&self, index: usize) -> bool {
+        self.mailboxes[index].state.load(Ordering::Acquire) == AP_STATE_PARKED
+    }
+
+    /// Starts `job(arg)` on AP `index`. Returns false if that AP is not parked.
+    pub fn dispatch(&self, index: usize, job: ApJob, arg: u64) -> bool {
+        let mb = &self.mailboxes[index];
+        if mb.state.load(Ordering::Acquire) != AP_STATE_PARKED {
+            return false;
+        }
+        mb.job.store(job as usize as u64, Ordering::Relaxed);
+        mb.arg.store(arg, Ordering::Relaxed);
+        mb.state.store(AP_STATE_RUN, Ordering::Release); // Also wakes MWAIT
+        true
+    }
+
+    /// Runs every job in `queue` on the BSP and all parked APs together and returns
+    /// once all jobs are done and every AP has let go of the queue.
+    pub fn run(&self, queue: &WorkQueue) {
+        for index in 0..self.len() {
+            self.dispatch(index, WorkQueue::worker, queue as *const WorkQueue as u64);
+        }
+        queue.drain();
+        while queue.done.load(Ordering::Acquire) < queue.jobs.len() {
+            core::hint::spin_loop();
+        }
+        // An AP still in RUN (not yet picked up) or BUSY (draining) holds `queue`.
+        for mb in self.mailboxes {
+            while matches!(mb.state.load(Ordering::Acquire), AP_STATE_RUN | AP_STATE_BUSY) {
+                core::hint::spin_loop();
+            }
+        }
+    }
+}
+
+/// Jobs shared by the BSP and the APs. Every worker claims the next unclaimed job
+/// with one `fetch_add` and keeps going until none are left, so idle CPUs take
+/// over work that would otherwise queue behind a slow probe.
+pub struct WorkQueue<'a> {
+    jobs: &'a [(ApJob, u64)],
+    next: AtomicUsize,
+    done: AtomicUsize,
+}
+
+impl<'a> WorkQueue<'a> {
+    pub fn new(jobs: &'a [(ApJob, u64)]) -> Self {
+        WorkQueue { jobs, next: AtomicUsize::new(0), done: AtomicUsize::new(0) }
+    }
+
+    fn drain(&self) {
+        loop {
+            let index = self.next.fetch_add(1, Ordering::Relaxed);
+            if index >= self.jobs.len() {
+                return;
+            }
+            let (job, arg) = self.jobs[index];
+            job(arg);
+            self.done.fetch_add(1, Ordering::Release);
+        }
+    }
+
+    extern "sysv64" fn worker(queue: u64) {
+        let queue = unsafe { &*(queue as *const WorkQueue) };
+        queue.drain();
+    }
+}
@@ -0,0 +1,122 @@
+// Lionbootloader Core - HAL Warm Sector Cache
+// File: core/src/hal/sector_cache.rs
+
+//! Boot drive sectors BIOS Stage 2 already read (stage1_loader_utils.h, "Sector
+//! Cache"): the MBR, the FAT32 boot sector, FSInfo, the start of the FAT and the
+//! root directory, plus whatever read-ahead pulled in. The block layer asks here
+//! first and only falls back to INT 13h thunks on a miss. Read-only: the core
+//! never adds lines, so the region can be reclaimed once the volume is mounted.
+
+use crate::hal::LblBootInfoRaw;
+
+const CACHE_MAGIC: u32 = 0x4843_4353; // LBL_SECTOR_CACHE_MAGIC ("SCCH")
+const TAG_VALID: u32 = 0x1;           // LBL_SECTOR_CACHE_TAG_VALID
+
+/// LBL_SECTOR_CACHE_HEADER, at the start of the region.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LblSectorCacheHeader {
+    pub magic: u32,
+    pub sector_size: u32,
+    pub sets: u32, // Power of two: sector `lba` lives in set `lba & (sets - 1)`
+    pub ways: u32,
+    pub drive: u32, // BIOS drive number
+    pub stamp: u32,
+    pub tags_addr: u64, // LblSectorCacheTag[sets * ways], set by set
+    pub data_addr: u64, // Line of tag i at data_addr + i * sector_size
+    pub hits: u64,
+    pub misses: u64,
+    pub read_ahead: u64,
+}
+
+/// LBL_SECTOR_CACHE_TAG.
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct LblSectorCacheTag {
+    pub lba: u64,
+    pub flags: u32,
+    pub stamp: u32,
+}
+
+#[derive(Clone, Copy)]
+pub struct WarmSectorCache {
+    header: &'static LblSectorCacheHeader,
+    tags: &'static [LblSectorCacheTag],
+    data: *const u8,
+}
+
+// Safety: the region is only read, and nothing writes it once Stage 2 has jumped.
+unsafe impl Send for WarmSectorCache {}
+unsafe impl Sync for WarmSectorCache {}
+
+impl WarmSectorCache {
+    /// Adopts the cache described by the boot info, after checking that its tags
+    /// and lines lie inside the recorded region.
+    ///
+    /// # Safety
+    /// `boot_info` must come from Stage 2 and the region must not be reused while
+    /// the cache lives.
+    pub unsafe fn from_boot_info(boot_info: &'static LblBootInfoRaw) -> Option<Self> {
+        let record = unsafe { boot_info.sector_cache()? };
+        let start = record.region_addr;
+        let end = start.checked_add(record.region_size)?;
+        if record.region_size < core::mem::size_of::<LblSectorCacheHeader>() as u64 {
+            return None;
+        }
+        let header = unsafe { &*(start as *const LblSectorCacheHeader) };
+        if header.magic != CACHE_MAGIC || !header.sets.is_power_of_two() || header.ways == 0 || header.sector_size == 0 {
+            return None;
+        }
+        let lines = header.sets as u64 * header.ways as u64;
+        let tags_end = header.tags_addr.checked_add(lines * core::mem::size_of::<LblSectorCacheTag>() as u64)?;
+        let data_end = header.data_addr.checked_add(lines * header.sector_size as u64)?;
+        if header.tags_addr < start || tags_end > end || header.data_addr < start || data_end > end {
+            return None;
+        }
+        let tags = unsafe { core::slice::from_raw_parts(header.tags_addr as *const LblSectorCacheTag, lines as usize) };
+        Some(WarmSectorCache { header, tags, data: header.data_addr as *const u8 })
+    }
+
+    /// BIOS drive number the cached sectors belong to.
+    pub fn drive(&self) -> u32 {
+        self.header.drive
+    }
+
+    pub fn sector_size(&self) -> usize {
+        self.header.sector_size as usize
+    }
+
+    /// The cached copy of sector `lba`, if Stage 2 read it.
+    pub fn lookup(&self, lba: u64) -> Option<&'static [u8]> {
+        let ways = self.header.ways as usize;
+        let first = (lba & (self.header.sets as u64 - 1)) as usize * ways;
+        let line = (first..first + ways)
+            .find(|&i| self.tags[i].flags & TAG_VALID != 0 && self.tags[i].lba == lba)?;
+        // Safety: the line lies inside the region, checked in `from_boot_info`.
+        Some(unsafe { core::slice::from_raw_parts(self.data.add(line * self.sector_size()), self.sector_size()) })
+    }
+
+    /// Fills `buffer` from consecutive sectors starting at `lba` if every one of
+    /// them is cached; otherwise leaves it untouched and returns false.
+    pub fn read(&self, lba: u64, buffer: &mut [u8]) -> bool {
+        let size = self.sector_size();
+        if buffer.len() % size != 0 {
+            return false;
+        }
+        let count = (buffer.len() / size) as u64;
+        if !(lba..lba + count).all(|sector| self.lookup(sector).is_some()) {
+            return false;
+        }
+        for (chunk, sector) in buffer.chunks_exact_mut(size).zip(lba..) {
+            if let Some(data) = self.lookup(sector) {
+                chunk.copy_from_slice(data);
+            }
+        }
+        true
+    }
+
+    /// Valid lines, i.e. sectors the block layer will not have to read.
+    pub fn cached_sectors(&self) -> usize {
+        self.tags.iter().filter(|tag| tag.flags & TAG_VALID != 0).count()
+    }
+}
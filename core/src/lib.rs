@@ -15,25 +15,101 @@ extern crate alloc;
 static ALLOCATOR: wee_alloc::WeeAlloc = wee_alloc::WeeAlloc::INIT;
 */
 
-// Or a dummy allocator for now if you haven't chosen one:
+// Heap arena allocator: Stage 1 reserves one contiguous, 2 MiB-aligned arena and
+// passes it in the boot info (core_heap_addr / core_heap_size), so allocation works
+// from the first instruction of `lbl_core_entry`, before the memory map is parsed.
+// Allocation is a lock-free bump of `next`; only the most recent allocation can be
+// freed (or grown) in place, everything else is reclaimed when the OS takes over.
 #[cfg(feature = "with_alloc")]
-mod dummy_allocator {
+pub mod arena_allocator {
     use alloc::alloc::{GlobalAlloc, Layout};
     use core::ptr;
+    use core::sync::atomic::{AtomicUsize, Ordering};
 
-    pub struct Dummy;
+    pub struct ArenaAllocator {
+        next: AtomicUsize,
+        end: AtomicUsize,
+    }
+
+    impl ArenaAllocator {
+        pub const fn new() -> Self {
+            ArenaAllocator { next: AtomicUsize::new(0), end: AtomicUsize::new(0) }
+        }
+
+        /// Hands the arena to the allocator. Allocations fail until this is called.
+        ///
+        /// # Safety
+        /// `[base, base + size)` must be unused RAM owned by the core from now on.
+        pub unsafe fn init(&self, base: usize, size: usize) {
+            self.end.store(base.saturating_add(size), Ordering::Relaxed);
+            self.next.store(base, Ordering::Release);
+        }
+
+        /// Bytes still available in the arena.
+        pub fn remaining(&self) -> usize {
+            self.end.load(Ordering::Relaxed).saturating_sub(self.next.load(Ordering::Relaxed))
+        }
+    }
+
+    unsafe impl GlobalAlloc for ArenaAllocator {
+        unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+            let end = self.end.load(Ordering::Relaxed);
+            let mut next = self.next.load(Ordering::Acquire);
+            loop {
+                if next == 0 {
+                    return ptr::null_mut(); // No arena yet
+                }
+                let start = match next.checked_add(layout.align() - 1) {
+                    Some(v) => v & !(layout.align() - 1),
+                    None => return ptr::null_mut(),
+                };
+                let new_next = match start.checked_add(layout.size()) {
+                    Some(v) if v <= end => v,
+                    _ => return ptr::null_mut(),
+                };
+                match self.next.compare_exchange_weak(next, new_next, Ordering::AcqRel, Ordering::Acquire) {
+                    Ok(_) => return start as *mut u8,
+                    Err(current) => next = current,
+                }
+            }
+        }
 
-    unsafe impl GlobalAlloc for Dummy {
-        unsafe fn alloc(&self, _layout: Layout) -> *mut u8 {
-            ptr::null_mut() // Always fail to allocate
+        unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+            // Roll back only if this was the last allocation (common for temporaries).
+            let start = ptr as usize;
+            let _ = self.next.compare_exchange(start + layout.size(), start, Ordering::AcqRel, Ordering::Relaxed);
         }
-        unsafe fn dealloc(&self, _ptr: *mut u8, _layout: Layout) {
-            // Do nothing
+
+        unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+            // The last allocation grows or shrinks in place by moving `next`; its
+            // alignment is unchanged. Anything else is moved to a new block.
+            let start = ptr as usize;
+            let end = self.end.load(Ordering::Relaxed);
+            if let Some(new_next) = start.checked_add(new_size) {
+                if new_next <= end
+                    && self
+                        .next
+                        .compare_exchange(start + layout.size(), new_next, Ordering::AcqRel, Ordering::Relaxed)
+                        .is_ok()
+                {
+                    return ptr;
+                }
+            }
+            let new_layout = match Layout::from_size_align(new_size, layout.align()) {
+                Ok(new_layout) => new_layout,
+                Err(_) => return ptr::null_mut(),
+            };
+            let new_ptr = self.alloc(new_layout);
+            if !new_ptr.is_null() {
+                ptr::copy_nonoverlapping(ptr, new_ptr, core::cmp::min(layout.size(), new_size));
+                self.dealloc(ptr, layout);
+            }
+            new_ptr
         }
     }
 
     #[global_allocator]
-    static DUMMY_ALLOCATOR: Dummy = Dummy;
+    pub static ALLOCATOR: ArenaAllocator = ArenaAllocator::new();
 
     #[alloc_error_handler]
     fn alloc_error_handler(layout: Layout) -> ! {
@@ -116,14 +192,48 @@ fn panic(info: &PanicInfo) -> ! {
 /// containing essential information for the core engine to start.
 #[no_mangle]
 pub unsafe extern "C" fn lbl_core_entry(boot_info_ptr: *const u8) -> ! {
+    // 0. Start the heap on the arena Stage 1 reserved, before anything can allocate.
+    #[cfg(feature = "with_alloc")]
+    {
+        let boot_info = boot_info_ptr as *const hal::LblBootInfoRaw;
+        if !boot_info.is_null() && unsafe { (*boot_info).magic } == hal::LblBootInfoRaw::MAGIC {
+            let (base, size) = unsafe { ((*boot_info).core_heap_addr, (*boot_info).core_heap_size) };
+            if base != 0 && size != 0 {
+                unsafe { arena_allocator::ALLOCATOR.init(base as usize, size as usize) };
+            }
+        }
+    }
+
     // 1. Initialize critical subsystems (e.g., logging, basic error handling output)
     //    If a serial port or framebuffer is available from Stage1, initialize it for logging.
     //    The `logger` module should provide a basic init function.
     //    Example: logger::init(boot_info_ptr_for_logger);
     //    For now, we assume some form of console output might be available later.
 
+    let boot_info = unsafe { hal::LblBootInfoRaw::from_ptr(boot_info_ptr) };
+    // Continue Stage 1's boot timeline (no-op if it did not hand one over).
+    unsafe { logger::attach_boot_timeline(boot_info_ptr as *const hal::LblBootInfoRaw) };
+    logger::timeline_mark(logger::timeline::CORE_ENTRY, 0);
+    // Bulk copies and fills (console scrolling first) use Stage 1's dispatched routines.
+    if let Some(boot_info) = boot_info {
+        unsafe { hal::mem_ops::install(boot_info) };
+    }
+    // Log to Stage 1's framebuffer / serial console until the GUI takes the screen.
+    unsafe { logger::attach_early_console(boot_info_ptr as *const hal::LblBootInfoRaw) };
+
     // Replace with actual logger init
     // logger::init_early_logging(); // Example for very early logs
+    let _ = logger::init_global_logger(log::LevelFilter::Info);
+    // Stage 1's buffered messages come first, so the log reads in boot order.
+    unsafe { logger::replay_stage1_log(boot_info_ptr as *const hal::LblBootInfoRaw) };
+
+    // Check the core image Stage 1 hashed before anything else it loaded is trusted.
+    if let Some(boot_info) = boot_info {
+        if let Err(e) = security::SecurityManager::verify_core(boot_info) {
+            logger::error!("Core verification failed: {:?}. Halting.", e);
+            loop {}
+        }
+    }
 
     // log::info!("Lionbootloader Core Engine started.");
     // log::info!("Boot info pointer: {:?}", boot_info_ptr);
@@ -132,6 +242,7 @@ pub unsafe extern "C" fn lbl_core_entry(boot_info_ptr: *const u8) -> ! {
     //    This will involve parsing `boot_info_ptr` to understand memory map,
     //    available devices passed by Stage1, etc.
     //    let hal_services = hal::initialize(boot_info_ptr);
+    //    let probes = unsafe { hal::start_async_device_probes(&mut hal_services, boot_info) }; // On parked APs if any
     //    log::info!("HAL initialized.");
 
     // 3. Initialize Allocator (if `with_alloc` is enabled and not using a static dummy)
@@ -145,7 +256,7 @@ pub unsafe extern "C" fn lbl_core_entry(boot_info_ptr: *const u8) -> ! {
 
 
     // 4. Initialize Filesystem Manager and load FS plugins
-    //    let fs_manager = fs::initialize_manager(&hal_services);
+    //    let fs_manager = unsafe { fs::initialize_manager(&hal_services, boot_info) }; // Mounts Stage 1's preloaded files first
     //    log::info!("Filesystem manager initialized.");
 
     // 5. Load Configuration
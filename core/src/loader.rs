@@ -228,6 +228,9 @@ fn load_and_execute_kernel(
     // This involves setting up page tables, passing boot parameters (cmdline, memory map, initrd location),
     // and ensuring the CPU is in the correct state.
     logger::info!("[Loader] Preparing architecture and jumping to kernel...");
+    logger::timeline_mark(logger::timeline::KERNEL_JUMP, 0);
+    // The kernel owns the framebuffer from here, and may reuse Stage 1's memory.
+    logger::detach_early_console();
     arch_adapter::prepare_and_jump_to_kernel(
         hal,
         kernel_info,
@@ -2,8 +2,12 @@
 // File: core/src/logger.rs
 
 use core::fmt;
+use core::sync::atomic::{AtomicPtr, Ordering};
 use log::{Level, LevelFilter, Log, Metadata, Record, SetLoggerError};
 
+use crate::hal::early_console::{EarlyConsole, LblEarlyConsole};
+use crate::hal::{LblBootInfoRaw, LblTimelineRecord};
+
 #[cfg(feature = "with_alloc")]
 use alloc::string::String;
 
@@ -185,36 +189,33 @@ pub trait LogWriter: core::fmt::Write {
 }
 
 
-// Example: A dummy writer that does nothing for now.
-// In `hal::console`, you'd create a real `SerialWriter` or `FramebufferWriter`.
-struct DummyWriter;
-impl core::fmt::Write for DummyWriter {
-    fn write_str(&mut self, s: &str) -> core::fmt::Result {
-        // On host for testing, could use std::eprint!("{}", s);
-        // Here, it would write to serial/framebuffer.
-        // For now, we can't do much without HAL.
-        // To avoid unused 's', we can do a dummy operation.
-        let _ = s.len(); 
-        Ok(())
+// Until the GUI owns the screen, log lines go to Stage 1's early console
+// (framebuffer and, on x86, COM1). Without one they are dropped.
+static EARLY_CONSOLE: AtomicPtr<LblEarlyConsole> = AtomicPtr::new(core::ptr::null_mut());
+
+/// Sends log output to the console Stage 1 handed over (no-op without one).
+///
+/// # Safety
+/// `boot_info` must be null or the boot info Stage 1 handed over; the console
+/// record, its glyph cache and the framebuffer must stay mapped until
+/// [`detach_early_console`].
+pub unsafe fn attach_early_console(boot_info: *const LblBootInfoRaw) {
+    if boot_info.is_null() {
+        return;
+    }
+    if let Some(console) = unsafe { (*boot_info).early_console() } {
+        EARLY_CONSOLE.store(console, Ordering::Release);
     }
 }
-impl LogWriter for DummyWriter {}
-
-// This function needs to be called by HAL console initialization to set the actual writer.
-// pub fn set_global_writer(writer: impl LogWriter + 'static + Send) {
-//     unsafe {
-//         // This is unsafe if called multiple times or from multiple threads without sync.
-//         // GLOBAL_WRITER_INSTANCE = Some(Box::new(writer)); // Requires alloc for Box<dyn>
-//         // For a static type known at compile time:
-//         // GLOBAL_WRITER_INSTANCE = Some(writer_instance_of_known_type);
-//     }
-// }
 
-// A function to get a mutable reference to the writer. Very simplified.
-// Needs proper synchronization (e.g. spin::Mutex) in a real scenario.
+/// Stops drawing log output, once something else owns the screen: called when
+/// the GUI renderer is up and right before the jump to a kernel.
+pub fn detach_early_console() {
+    EARLY_CONSOLE.store(core::ptr::null_mut(), Ordering::Release);
+}
+
+// Single-threaded until the core starts APs, so one writer at a time.
 fn try_get_global_writer() -> Option<impl LogWriter> {
-    // In a real system, this would return a locked guard to the actual writer.
-    // For now, let's return a dummy that does nothing or prints to host if testing.
     #[cfg(all(test, feature = "std"))]
     {
         struct TestWriter;
@@ -224,7 +225,151 @@ fn try_get_global_writer() -> Option<impl LogWriter> {
     }
     #[cfg(not(all(test, feature = "std")))]
     {
-        Some(DummyWriter) // Does nothing on target by default
+        unsafe { EarlyConsole::from_raw(EARLY_CONSOLE.load(Ordering::Acquire)) }
+    }
+}
+
+
+// --- Boot Timeline ---
+// Stage 1 hands over a timeline record holding its milestones (firmware entry up
+// to the jump into the core). The core appends to the same record, so one
+// timeline covers firmware to kernel. Ticks are raw TSC / CNTVCT_EL0 values;
+// the record's `ticks_per_second` converts them.
+
+/// Core timeline event ids (Stage 1 uses ids below `CORE_FIRST`, see LblUefi.h).
+pub mod timeline {
+    pub const CORE_FIRST: u32 = 0x1000;
+    pub const CORE_ENTRY: u32 = CORE_FIRST;
+    pub const HAL_READY: u32 = CORE_FIRST + 1;
+    pub const CONFIG_LOADED: u32 = CORE_FIRST + 2;
+    pub const KERNEL_LOADED: u32 = CORE_FIRST + 3;
+    pub const KERNEL_JUMP: u32 = CORE_FIRST + 4;
+}
+
+static BOOT_TIMELINE: AtomicPtr<LblTimelineRecord> = AtomicPtr::new(core::ptr::null_mut());
+
+/// Reads the same cycle counter Stage 1 stamps its events with.
+#[inline]
+pub fn read_cycle_counter() -> u64 {
+    #[cfg(target_arch = "x86_64")]
+    {
+        unsafe { core::arch::x86_64::_rdtsc() }
+    }
+    #[cfg(target_arch = "aarch64")]
+    {
+        let ticks: u64;
+        unsafe { core::arch::asm!("isb", "mrs {}, cntvct_el0", out(reg) ticks, options(nostack)) };
+        ticks
+    }
+    #[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+    {
+        0
+    }
+}
+
+/// Continues the boot timeline Stage 1 appended to its boot info. Without one
+/// (older Stage 1, BIOS path) later marks are ignored.
+///
+/// # Safety
+/// `boot_info` must be null or the boot info Stage 1 handed over; its pages must
+/// stay mapped and writable while marks are recorded.
+pub unsafe fn attach_boot_timeline(boot_info: *const LblBootInfoRaw) {
+    if boot_info.is_null() {
+        return;
+    }
+    if let Some(record) = unsafe { (*boot_info).timeline() } {
+        BOOT_TIMELINE.store(record, Ordering::Release);
+    }
+}
+
+/// Appends a timestamped event to the boot timeline, if one is attached.
+pub fn timeline_mark(id: u32, arg: u32) {
+    let ticks = read_cycle_counter();
+    let record = BOOT_TIMELINE.load(Ordering::Acquire);
+    if record.is_null() {
+        return;
+    }
+    // Single-threaded until the core starts APs; the record is only written here.
+    let record = unsafe { &mut *record };
+    let capacity = core::cmp::min(record.capacity as usize, record.events.len());
+    let index = record.count as usize;
+    if index >= capacity {
+        record.dropped = record.dropped.saturating_add(1);
+        return;
+    }
+    let event = &mut record.events[index];
+    event.ticks = ticks;
+    event.id = id;
+    event.arg = arg;
+    record.count += 1;
+}
+
+/// The attached boot timeline, for reporting or for handing on to the kernel.
+pub fn boot_timeline() -> Option<&'static LblTimelineRecord> {
+    let record = BOOT_TIMELINE.load(Ordering::Acquire);
+    if record.is_null() { None } else { Some(unsafe { &*record }) }
+}
+
+
+// --- Stage 1 Log Replay ---
+// Stage 1 buffers its messages in a ring (see LblStage1LogRing) and only echoes
+// warnings/errors to its console. Replaying the ring here puts the whole firmware
+// phase into the core's log, including anything logged around ExitBootServices.
+
+const STAGE1_LINE_MAX: usize = 256;
+
+/// Re-emits every complete line still held in Stage 1's log ring through the
+/// `log` facade (target "stage1"), at the level Stage 1 recorded it with.
+///
+/// # Safety
+/// `boot_info` must be null or the boot info Stage 1 handed over.
+pub unsafe fn replay_stage1_log(boot_info: *const LblBootInfoRaw) {
+    if boot_info.is_null() {
+        return;
+    }
+    let ring = match unsafe { (*boot_info).stage1_log() } {
+        Some(ring) => ring,
+        None => return,
+    };
+    let end = ring.written;
+    let mut pos = end.saturating_sub(ring.capacity as u64);
+    if pos != 0 {
+        // Oldest bytes were overwritten: start at the first whole line.
+        while pos < end && unsafe { ring.byte_at(pos) } != b'\n' {
+            pos += 1;
+        }
+        pos += 1;
+    }
+
+    let mut line = [0u8; STAGE1_LINE_MAX];
+    let mut len = 0usize;
+    let mut level: Option<Level> = None;
+    let mut line_start = true;
+    while pos < end {
+        let byte = unsafe { ring.byte_at(pos) };
+        pos += 1;
+        if line_start {
+            level = match byte as usize {
+                LEVEL_FILTER_ERROR_USIZE => Some(Level::Error),
+                LEVEL_FILTER_WARN_USIZE => Some(Level::Warn),
+                LEVEL_FILTER_INFO_USIZE => Some(Level::Info),
+                LEVEL_FILTER_DEBUG_USIZE => Some(Level::Debug),
+                LEVEL_FILTER_TRACE_USIZE => Some(Level::Trace),
+                _ => None,
+            };
+            line_start = false;
+            len = 0;
+            continue;
+        }
+        if byte == b'\n' {
+            if let (Some(level), Ok(text)) = (level, core::str::from_utf8(&line[..len])) {
+                log::log!(target: "stage1", level, "{}", text);
+            }
+            line_start = true;
+        } else if len < line.len() {
+            line[len] = byte;
+            len += 1;
+        }
     }
 }
 
@@ -191,6 +191,49 @@ impl SecurityManager {
         Ok(())
     }
 
+    /// Checks the LBL core image through the SHA-256 Stage 1 computed while
+    /// reading it. If Stage 1 also matched it against a manifest, the manifest's
+    /// signature is verified here; Stage 1 has no public-key code. Until
+    /// `signature` has a real backend the manifest is only reported as
+    /// unverified, never as valid. Needs no HAL, so `lbl_core_entry` runs it
+    /// before anything else Stage 1 loaded is used.
+    /// The digest is not extended into a PCR yet: the TPM module has no command
+    /// transport; `LblBootInfoRaw::core_digest()` keeps the digest for when it has one.
+    pub fn verify_core(boot_info: &crate::hal::LblBootInfoRaw) -> Result<(), SecurityError> {
+        if boot_info.core_digest().is_none() {
+            logger::warn!("[SecurityManager] Stage 1 provided no core digest; core is unverified.");
+            return Ok(());
+        }
+        if boot_info.core_verify_flags & crate::hal::LblBootInfoRaw::CORE_VERIFY_MANIFEST_MATCH == 0 {
+            logger::warn!("[SecurityManager] Core digest matched no manifest; core is unverified.");
+            return Ok(());
+        }
+
+        // SAFETY: the boot info was produced by Stage 1 and the manifest lives in LoaderData.
+        let manifest = match unsafe { boot_info.core_manifest() } {
+            Some(manifest) => manifest,
+            None => return Err(SecurityError::SignatureVerificationFailed("core manifest missing".into())),
+        };
+        const MANIFEST_HEADER_SIZE_OFFSET: usize = 8;
+        if manifest.len() < MANIFEST_HEADER_SIZE_OFFSET + 4 {
+            return Err(SecurityError::SignatureVerificationFailed("core manifest".into()));
+        }
+        if signature::BACKEND_IS_STUB {
+            logger::warn!("[SecurityManager] Core matches its manifest; manifest signature unverified (no signature backend).");
+            return Ok(());
+        }
+        let mut size_bytes = [0u8; 4];
+        size_bytes.copy_from_slice(&manifest[MANIFEST_HEADER_SIZE_OFFSET..MANIFEST_HEADER_SIZE_OFFSET + 4]);
+        let header_size = (u32::from_le_bytes(size_bytes) as usize).min(manifest.len());
+        let (signed, signature_data) = manifest.split_at(header_size);
+        match signature::verify_signature(signed, signature_data, &signature::KeyStore::new()) {
+            Ok(true) => logger::info!("[SecurityManager] Core manifest signature is VALID."),
+            Ok(false) => return Err(SecurityError::SignatureVerificationFailed("core manifest".into())),
+            Err(e) => return Err(e),
+        }
+        Ok(())
+    }
+
     // Placeholder for checking Secure Boot status (would use UEFI services)
     // pub fn is_secure_boot_active(&self) -> bool {
     //     self.secure_boot_active
@@ -9,6 +9,10 @@ use super::SecurityError; // Parent module's error type
 // use some_crypto_lib_no_std::{sha256, rsa, pkcs1v15};
 
 
+/// True while `verify_signature` is the stub below, which accepts any input.
+/// Callers must not report a signature as checked while this is set.
+pub const BACKEND_IS_STUB: bool = true;
+
 /// Represents a store of trusted public keys.
 /// In a real system, this would be loaded from a secure location or embedded.
 pub struct KeyStore {
@@ -105,7 +105,11 @@ pub fn init_gui(context: &GuiContext) -> Result<(), GuiInitError> {
     //    This involves getting framebuffer info from `context.hal_services.boot_info`
     //    and setting up the chosen rendering backend (e.g., mapping framebuffer, initializing NanoVG).
     match renderer::init_renderer(&context.hal_services.boot_info) {
-        Ok(_) => lionbootloader_core_lib::logger::info!("[GUI] Renderer initialized successfully."),
+        Ok(_) => {
+            lionbootloader_core_lib::logger::info!("[GUI] Renderer initialized successfully.");
+            // The screen is ours now: stop Stage 1's console drawing log lines over it.
+            lionbootloader_core_lib::logger::detach_early_console();
+        }
         Err(e) => {
             lionbootloader_core_lib::logger::error!("[GUI] Renderer initialization failed: {:?}", e);
             return Err(GuiInitError::RendererInitFailed(e));
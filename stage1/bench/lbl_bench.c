@@ -0,0 +1,583 @@
+// Lionbootloader - Stage 1 - Host Benchmark Harness
+// File: stage1/bench/lbl_bench.c
+//
+// Runs the UEFI load path (FindAndLoadLBLCore, lbl_uefi_load_file_from_device,
+// lbl_uefi_get_memory_map, the ExitBootServices loop) natively against the mock
+// firmware in lbl_mock_efi.c, one scenario per child process, and reports what
+// each one cost: firmware calls, allocations, bytes moved and projected wall time.
+//
+// LblUefi.c is included rather than linked so the scenarios can reach its
+// file-scope state (the async core read, the slot selection) the way efi_main does.
+//
+// Usage: lbl_bench_host [-v] [-n HANDLES] [-s CORE_MIB] [-x EXTENTS] [-c CHURN] [-m DESCRIPTORS]
+//                       [-L latency=ns]... [scenario...]
+
+#include "../uefi/LblUefi.c"
+#include "lbl_mock_efi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define LBL_BENCH_CONFIG_PATH       L"\\LBL\\CONFIG\\lbl.json"
+#define LBL_BENCH_CORE_URL          "http://192.0.2.10/lbl/" // TEST-NET-1: nothing answers
+
+// Scenario shape; each -option overrides one of these.
+typedef struct {
+    UINT32 handles;                 // SimpleFileSystem volumes on the machine
+    UINT64 core_size;               // "large" scenarios; the others use a 2 MiB core
+    UINT32 extents;                 // Runs the core is scattered over
+    UINT32 churn_rounds;            // exit-churn: stale map keys before ExitBootServices succeeds
+    UINT32 map_descriptors;         // memory-map / exit-churn: firmware map size
+    BOOLEAN verbose;                // Replay the Stage 1 log ring after each scenario
+    LBL_MOCK_CONFIG Mock;
+} LBL_BENCH_OPTIONS;
+
+typedef struct {
+    CONST CHAR8* name;
+    CONST CHAR8* summary;
+    VOID (*configure)(LBL_MOCK_CONFIG* config);     // Optional
+    EFI_STATUS (*setup)(VOID);                      // Builds the machine; not measured
+    EFI_STATUS (*run)(VOID);                        // Measured
+    VOID (*teardown)(VOID);                         // Releases what run kept; optional
+} LBL_BENCH_SCENARIO;
+
+// Sent from the scenario process to the parent.
+typedef struct {
+    EFI_STATUS status;
+    LBL_MOCK_STATS stats;
+    UINT64 live_after_teardown;     // Loader allocations nothing released
+    BOOLEAN setup_failed;           // `status` is the setup's; nothing was measured
+} LBL_BENCH_RESULT;
+
+static LBL_BENCH_OPTIONS LblBench;
+static LBL_CORE_IMAGE LblBenchCore;
+static VOID* LblBenchBuffer;
+static UINTN LblBenchBufferSize;
+static LBL_UEFI_MEMORY_MAP LblBenchMap;
+static EFI_HANDLE LblBenchTarget;           // Volume that holds the core
+static UINT32 LblBenchVolumeCount;
+
+static CONST LBL_MOCK_VOLUME_CONFIG LblBenchEsp = { LblMockVolumeLocalEsp, FALSE, TRUE, TRUE, FALSE };
+static CONST LBL_MOCK_VOLUME_CONFIG LblBenchDisk = { LblMockVolumeLocalDisk, FALSE, TRUE, TRUE, FALSE };
+static CONST LBL_MOCK_VOLUME_CONFIG LblBenchUsb = { LblMockVolumeRemovable, FALSE, TRUE, TRUE, FALSE };
+
+// --- Machine building blocks ---
+
+static EFI_HANDLE LblBenchAddVolume(CONST LBL_MOCK_VOLUME_CONFIG* Config, BOOLEAN Boot) {
+    EFI_HANDLE Volume = lbl_mock_add_volume(Config, Boot);
+
+    LblBenchVolumeCount += Volume != NULL;
+    return Volume;
+}
+
+/**
+ * @brief Deterministic core contents. A flat image: the first bytes match none
+ * of the LZ4 / LBL / ELF / PE magics, so the loader takes the raw-image path.
+ */
+static UINT8* LblBenchCoreBytes(UINT64 Size) {
+    UINT8* Data = malloc((size_t)Size);
+    UINT64 State = 0x9E3779B97F4A7C15ull;
+    UINT64 i;
+
+    if (Data == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < Size; i++) {
+        State ^= State << 13;
+        State ^= State >> 7;
+        State ^= State << 17;
+        Data[i] = (UINT8)State;
+    }
+    Data[0] = 0xFA; // cli
+    Data[1] = 0xF4; // hlt
+    return Data;
+}
+
+/**
+ * @brief Stores a core (and, for extents > 1 or `with_map`, its extent map) in
+ * the single-image slot of a volume.
+ */
+static EFI_STATUS LblBenchPlaceCore(EFI_HANDLE Volume, UINT64 Size, UINT32 Extents, BOOLEAN WithMap) {
+    EFI_STATUS Status;
+    UINT8* Data = LblBenchCoreBytes(Size);
+
+    if (Data == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+    }
+    Status = lbl_mock_add_file(Volume, LBL_CORE_BIN_PATH, Data, Size, Extents);
+    free(Data);
+    if (!EFI_ERROR(Status) && WithMap) {
+        Status = lbl_mock_add_extent_map(Volume, LBL_CORE_BIN_PATH, LBL_CORE_EXTENT_MAP_PATH);
+    }
+    LblBenchTarget = Volume;
+    return Status;
+}
+
+/**
+ * @brief Adds volumes that hold no core (a couple of other fixed-disk partitions,
+ * the rest USB sticks) until `Reserve` more make LblBench.handles.
+ */
+static EFI_STATUS LblBenchAddFillerVolumes(UINT32 Reserve) {
+    UINT32 i;
+
+    for (i = 0; LblBenchVolumeCount + Reserve < LblBench.handles; i++) {
+        if (LblBenchAddVolume(i < 2 ? &LblBenchDisk : &LblBenchUsb, FALSE) == NULL) {
+            return EFI_OUT_OF_RESOURCES;
+        }
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Points LBL_NV_CORE_DEVICE_PATH at a volume, as a previous boot would have.
+ */
+static EFI_STATUS LblBenchCacheDevice(EFI_HANDLE Volume) {
+    EFI_DEVICE_PATH* Path = DevicePathFromHandle(Volume);
+
+    return lbl_mock_set_variable(LBL_NV_CORE_DEVICE_PATH, &LblVendorGuid, Path, DevicePathSize(Path));
+}
+
+// --- Scenarios ---
+
+static EFI_STATUS LblBenchLoadCore(VOID) {
+    return FindAndLoadLBLCore(&LblBenchCore);
+}
+
+static VOID LblBenchFreeCore(VOID) {
+    LblFreeCoreImage(&LblBenchCore);
+}
+
+static EFI_STATUS LblBenchSetupColdScan(VOID) {
+    EFI_STATUS Status;
+
+    // Booted from a USB stick that only carries BOOTX64.EFI; the core is on the
+    // internal ESP, which the ranked scan reaches after the boot device.
+    if (LblBenchAddVolume(&LblBenchUsb, TRUE) == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+    }
+    Status = LblBenchAddFillerVolumes(1);
+    if (!EFI_ERROR(Status)) {
+        Status = LblBenchPlaceCore(LblBenchAddVolume(&LblBenchEsp, FALSE), 2 << 20, 1, FALSE);
+    }
+    return Status;
+}
+
+static EFI_STATUS LblBenchSetupBootDevice(VOID) {
+    EFI_STATUS Status = LblBenchPlaceCore(LblBenchAddVolume(&LblBenchEsp, TRUE), 2 << 20, 1, FALSE);
+
+    return EFI_ERROR(Status) ? Status : LblBenchAddFillerVolumes(0);
+}
+
+static EFI_STATUS LblBenchSetupNvramHit(VOID) {
+    EFI_STATUS Status = LblBenchSetupColdScan();
+
+    return EFI_ERROR(Status) ? Status : LblBenchCacheDevice(LblBenchTarget);
+}
+
+static EFI_STATUS LblBenchSetupNvramStale(VOID) {
+    EFI_HANDLE Cached;
+
+    // The cached volume is still there but the core was reinstalled elsewhere.
+    Cached = LblBenchAddVolume(&LblBenchDisk, FALSE);
+    if (Cached == NULL || EFI_ERROR(LblBenchCacheDevice(Cached))) {
+        return EFI_OUT_OF_RESOURCES;
+    }
+    return LblBenchSetupBootDevice();
+}
+
+static EFI_STATUS LblBenchSetupLargeCore(CONST LBL_MOCK_VOLUME_CONFIG* Config, UINT32 Extents, BOOLEAN WithMap) {
+    EFI_HANDLE Volume = LblBenchAddVolume(Config, TRUE);
+    EFI_STATUS Status = LblBenchPlaceCore(Volume, LblBench.core_size, Extents, WithMap);
+
+    return EFI_ERROR(Status) ? Status : LblBenchCacheDevice(Volume);
+}
+
+static EFI_STATUS LblBenchSetupLargeFs(VOID) {
+    return LblBenchSetupLargeCore(&LblBenchEsp, LblBench.extents, FALSE);
+}
+
+static EFI_STATUS LblBenchSetupLargeReadEx(VOID) {
+    LBL_MOCK_VOLUME_CONFIG Config = LblBenchEsp;
+
+    Config.read_ex = TRUE;
+    return LblBenchSetupLargeCore(&Config, LblBench.extents, FALSE);
+}
+
+static EFI_STATUS LblBenchSetupExtentDiskIo(VOID) {
+    return LblBenchSetupLargeCore(&LblBenchEsp, LblBench.extents, TRUE);
+}
+
+static EFI_STATUS LblBenchSetupExtentDiskIo2(VOID) {
+    LBL_MOCK_VOLUME_CONFIG Config = LblBenchEsp;
+
+    Config.disk_io2 = TRUE;
+    return LblBenchSetupLargeCore(&Config, LblBench.extents, TRUE);
+}
+
+static EFI_STATUS LblBenchLoadCoreAsync(VOID) {
+    EFI_STATUS Status = FindAndLoadLBLCore(&LblBenchCore);
+
+    // efi_main reaps the read in PrepareBootInfoForCore, after the GOP and ACPI
+    // work it overlaps with; nothing overlaps it here, so this is the worst case.
+    return EFI_ERROR(Status) ? Status : LblCompleteCoreLoad(&LblBenchCore);
+}
+
+static EFI_STATUS LblBenchSetupHttpRefused(VOID) {
+    static CONST LBL_MOCK_NIC_CONFIG Nic = { EFI_ACCESS_DENIED };
+
+    // Diskless: the only source is LBL_NV_CORE_URL, and its server refuses every connection.
+    if (lbl_mock_add_nic(&Nic) == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+    }
+    return lbl_mock_set_variable(LBL_NV_CORE_URL, &LblVendorGuid, LBL_BENCH_CORE_URL,
+                                 sizeof(LBL_BENCH_CORE_URL) - 1);
+}
+
+/**
+ * @brief Passes when the load gives up with EFI_NOT_FOUND; the fault count and
+ * the live bytes show whether it cleaned up after itself.
+ */
+static EFI_STATUS LblBenchLoadCoreUnreachable(VOID) {
+    EFI_STATUS Status = FindAndLoadLBLCore(&LblBenchCore);
+
+    if (!EFI_ERROR(Status)) {
+        LblFreeCoreImage(&LblBenchCore);
+        return EFI_ABORTED;
+    }
+    return Status == EFI_NOT_FOUND ? EFI_SUCCESS : Status;
+}
+
+static EFI_STATUS LblBenchSetupConfigFile(VOID) {
+    EFI_HANDLE Volume = LblBenchAddVolume(&LblBenchEsp, TRUE);
+    UINT8* Data = LblBenchCoreBytes(64 << 10);
+    EFI_STATUS Status;
+
+    if (Volume == NULL || Data == NULL) {
+        free(Data);
+        return EFI_OUT_OF_RESOURCES;
+    }
+    Status = lbl_mock_add_file(Volume, LBL_BENCH_CONFIG_PATH, Data, 64 << 10, LblBench.extents);
+    free(Data);
+    LblBenchTarget = Volume;
+    return Status;
+}
+
+static EFI_STATUS LblBenchLoadConfigFile(VOID) {
+    return lbl_uefi_load_file_from_device(LblBenchTarget, LBL_BENCH_CONFIG_PATH, &LblBenchBuffer, &LblBenchBufferSize);
+}
+
+static VOID LblBenchFreeBuffer(VOID) {
+    if (LblBenchBuffer != NULL) {
+        BS->FreePool(LblBenchBuffer);
+        LblBenchBuffer = NULL;
+    }
+}
+
+static VOID LblBenchConfigureMap(LBL_MOCK_CONFIG* Config) {
+    Config->MemoryMap.base_descriptors = LblBench.map_descriptors;
+}
+
+static VOID LblBenchConfigureChurn(LBL_MOCK_CONFIG* Config) {
+    LblBenchConfigureMap(Config);
+    Config->MemoryMap.churn_rounds = LblBench.churn_rounds;
+    Config->MemoryMap.churn_growth = 3;
+}
+
+static EFI_STATUS LblBenchSetupNothing(VOID) {
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS LblBenchGetMemoryMap(VOID) {
+    UINTN MapSize = 0, MapKey, DescriptorSize;
+    UINT32 DescriptorVersion;
+
+    return lbl_uefi_get_memory_map((EFI_MEMORY_DESCRIPTOR**)&LblBenchBuffer, &MapSize, &MapKey,
+                                   &DescriptorSize, &DescriptorVersion);
+}
+
+static EFI_STATUS LblBenchExitBootServices(VOID) {
+    EFI_STATUS Status = lbl_uefi_memory_map_prepare(&LblBenchMap);
+
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+    Status = lbl_uefi_exit_boot_services(IH, &LblBenchMap, LBL_UEFI_EXIT_BOOT_SERVICES_ATTEMPTS);
+    if (EFI_ERROR(Status)) {
+        BS->FreePool(LblBenchMap.buffer);
+    }
+    return Status;
+}
+
+static CONST LBL_BENCH_SCENARIO LblBenchScenarios[] = {
+    { "cold-scan", "no NVRAM hint, boot device empty, ranked scan of every volume",
+      NULL, LblBenchSetupColdScan, LblBenchLoadCore, LblBenchFreeCore },
+    { "boot-device", "no NVRAM hint, core on the volume Stage 1 was loaded from",
+      NULL, LblBenchSetupBootDevice, LblBenchLoadCore, LblBenchFreeCore },
+    { "nvram-hit", "LblCoreDevicePath resolves straight to the core volume",
+      NULL, LblBenchSetupNvramHit, LblBenchLoadCore, LblBenchFreeCore },
+    { "nvram-stale", "LblCoreDevicePath names a volume that lost the core",
+      NULL, LblBenchSetupNvramStale, LblBenchLoadCore, LblBenchFreeCore },
+    { "large-core-fs", "large core streamed through File.Read",
+      NULL, LblBenchSetupLargeFs, LblBenchLoadCore, LblBenchFreeCore },
+    { "large-core-readex", "large core streamed through File.ReadEx",
+      NULL, LblBenchSetupLargeReadEx, LblBenchLoadCore, LblBenchFreeCore },
+    { "extent-diskio", "large core read raw through its extent map (Disk I/O)",
+      NULL, LblBenchSetupExtentDiskIo, LblBenchLoadCore, LblBenchFreeCore },
+    { "extent-diskio2", "large core read raw through its extent map (Disk I/O 2), then reaped",
+      NULL, LblBenchSetupExtentDiskIo2, LblBenchLoadCoreAsync, LblBenchFreeCore },
+    { "http-refused", "diskless, LblCoreUrl set, every HTTP connect refused: clean failure",
+      NULL, LblBenchSetupHttpRefused, LblBenchLoadCoreUnreachable, NULL },
+    { "config-file", "64 KiB file through lbl_uefi_load_file_from_device",
+      NULL, LblBenchSetupConfigFile, LblBenchLoadConfigFile, LblBenchFreeBuffer },
+    { "memory-map", "one lbl_uefi_get_memory_map",
+      LblBenchConfigureMap, LblBenchSetupNothing, LblBenchGetMemoryMap, LblBenchFreeBuffer },
+    { "exit-churn", "map prepare + ExitBootServices while firmware callbacks allocate",
+      LblBenchConfigureChurn, LblBenchSetupNothing, LblBenchExitBootServices, NULL },
+};
+
+#define LBL_BENCH_SCENARIO_COUNT (sizeof(LblBenchScenarios) / sizeof(LblBenchScenarios[0]))
+
+// --- Running and reporting ---
+
+/**
+ * @brief Child side: builds the machine, measures the scenario, and writes an
+ * LBL_BENCH_RESULT to `fd`.
+ */
+static VOID LblBenchRunChild(CONST LBL_BENCH_SCENARIO* Scenario, int fd) {
+    LBL_MOCK_CONFIG Config = LblBench.Mock;
+    LBL_BENCH_RESULT Result;
+    LBL_MOCK_STATS After;
+    EFI_HANDLE Image;
+
+    memset(&Result, 0, sizeof(Result));
+    if (Scenario->configure != NULL) {
+        Scenario->configure(&Config);
+    }
+    Config.echo_console = LblBench.verbose;
+    lbl_mock_reset(&Config, &Image);
+    InitializeLib(Image, ST);
+    // Everything is recorded, as on a real boot; nothing reaches ConOut until a flush.
+    LblLoadLogLevels();
+
+    Result.status = Scenario->setup();
+    Result.setup_failed = EFI_ERROR(Result.status);
+    if (!Result.setup_failed) {
+        lbl_mock_begin();
+        Result.status = Scenario->run();
+        lbl_mock_end(&Result.stats);
+        if (!EFI_ERROR(Result.status) && Scenario->teardown != NULL) {
+            Scenario->teardown();
+        }
+        lbl_mock_end(&After);
+        Result.live_after_teardown = After.live_bytes;
+        if (LblBench.verbose) {
+            fprintf(stderr, "--- %s: Stage 1 log ---\n", Scenario->name);
+            lbl_uefi_log_flush(LBL_LOG_LEVEL_TRACE);
+        }
+    }
+    if (write(fd, &Result, sizeof(Result)) != (ssize_t)sizeof(Result)) {
+        _exit(2);
+    }
+    _exit(0);
+}
+
+static BOOLEAN LblBenchRun(CONST LBL_BENCH_SCENARIO* Scenario, LBL_BENCH_RESULT* Result) {
+    int fds[2];
+    pid_t pid;
+    int wstatus = 0;
+    ssize_t got;
+
+    fflush(stdout);
+    if (pipe(fds) != 0 || (pid = fork()) < 0) {
+        perror("lbl_bench_host");
+        return FALSE;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        LblBenchRunChild(Scenario, fds[1]);
+    }
+    close(fds[1]);
+    got = read(fds[0], Result, sizeof(*Result));
+    close(fds[0]);
+    waitpid(pid, &wstatus, 0);
+    if (got != (ssize_t)sizeof(*Result)) {
+        fprintf(stderr, "%s: scenario process died (wait status 0x%x)\n", Scenario->name, wstatus);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static VOID LblBenchFormat(CHAR16* Text, UINTN Size, CONST CHAR16* Format, ...) {
+    va_list Args;
+
+    va_start(Args, Format);
+    VSPrint(Text, Size, Format, Args);
+    va_end(Args);
+}
+
+static VOID LblBenchPrintStatus(EFI_STATUS Status) {
+    CHAR16 Text[64];
+    UINTN i;
+
+    LblBenchFormat(Text, sizeof(Text), L"%r", Status); // Same names the loader logs
+    for (i = 0; Text[i] != 0; i++) {
+        putchar((int)Text[i]);
+    }
+}
+
+static VOID LblBenchReport(CONST LBL_BENCH_SCENARIO* Scenario, CONST LBL_BENCH_RESULT* Result) {
+    CONST LBL_MOCK_STATS* s = &Result->stats;
+    UINT64 total = s->io_ns + s->wait_ns + s->cpu_ns;
+    UINT32 call;
+
+    printf("%-18s %s\n", Scenario->name, Scenario->summary);
+    if (Result->setup_failed) {
+        printf("  setup     ");
+        LblBenchPrintStatus(Result->status);
+        printf(" (machine does not fit the mock limits)\n\n");
+        return;
+    }
+    printf("  status    ");
+    LblBenchPrintStatus(Result->status);
+    printf("%s\n", s->faults != 0 ? "  (firmware faults, see stderr)" : "");
+    printf("  time      %10.3f ms  (firmware %.3f, waiting %.3f, loader %.3f)\n",
+           total / 1e6, s->io_ns / 1e6, s->wait_ns / 1e6, s->cpu_ns / 1e6);
+    printf("  memory    %llu page alloc(s) / %llu KiB, %llu pool alloc(s) / %llu KiB, peak %llu KiB, "
+           "live after teardown %llu B\n",
+           (unsigned long long)s->page_allocations, (unsigned long long)(s->page_bytes >> 10),
+           (unsigned long long)s->pool_allocations, (unsigned long long)(s->pool_bytes >> 10),
+           (unsigned long long)(s->peak_bytes >> 10), (unsigned long long)Result->live_after_teardown);
+    printf("  bytes     %llu from devices, %llu through CopyMem, %llu console chars\n",
+           (unsigned long long)s->device_bytes, (unsigned long long)s->copy_bytes,
+           (unsigned long long)s->console_chars);
+    if (s->exit_attempts != 0) {
+        printf("  exit      %llu ExitBootServices attempt(s)\n", (unsigned long long)s->exit_attempts);
+    }
+    printf("  calls    ");
+    for (call = 0; call < LblMockCallCount; call++) {
+        if (s->calls[call] != 0) {
+            printf(" %s=%llu", lbl_mock_call_name((LBL_MOCK_CALL)call), (unsigned long long)s->calls[call]);
+        }
+    }
+    printf("\n\n");
+}
+
+// -L names, for configuring firmware latency from the command line.
+static CONST struct {
+    CONST CHAR8* name;
+    UINTN offset;
+} LblBenchLatencyFields[] = {
+#define LBL_BENCH_LATENCY_FIELD(f) { #f, offsetof(LBL_MOCK_LATENCY, f) }
+    LBL_BENCH_LATENCY_FIELD(call_ns),
+    LBL_BENCH_LATENCY_FIELD(handle_protocol_ns),
+    LBL_BENCH_LATENCY_FIELD(locate_ns_per_handle),
+    LBL_BENCH_LATENCY_FIELD(alloc_ns),
+    LBL_BENCH_LATENCY_FIELD(memory_map_ns_per_descriptor),
+    LBL_BENCH_LATENCY_FIELD(exit_boot_services_ns),
+    LBL_BENCH_LATENCY_FIELD(nvram_read_ns),
+    LBL_BENCH_LATENCY_FIELD(nvram_write_ns),
+    LBL_BENCH_LATENCY_FIELD(console_ns_per_char),
+    LBL_BENCH_LATENCY_FIELD(open_volume_ns),
+    LBL_BENCH_LATENCY_FIELD(fs_open_ns),
+    LBL_BENCH_LATENCY_FIELD(fs_read_op_ns),
+    LBL_BENCH_LATENCY_FIELD(fs_ns_per_mib),
+    LBL_BENCH_LATENCY_FIELD(disk_op_ns),
+    LBL_BENCH_LATENCY_FIELD(disk_ns_per_mib),
+    LBL_BENCH_LATENCY_FIELD(http_connect_ns),
+#undef LBL_BENCH_LATENCY_FIELD
+};
+
+static BOOLEAN LblBenchSetLatency(CONST char* Assignment) {
+    CONST char* Equals = strchr(Assignment, '=');
+    UINTN i;
+
+    for (i = 0; Equals != NULL && i < sizeof(LblBenchLatencyFields) / sizeof(LblBenchLatencyFields[0]); i++) {
+        if (strlen(LblBenchLatencyFields[i].name) == (size_t)(Equals - Assignment) &&
+            strncmp(LblBenchLatencyFields[i].name, Assignment, (size_t)(Equals - Assignment)) == 0) {
+            *(UINT64*)((UINT8*)&LblBench.Mock.Latency + LblBenchLatencyFields[i].offset) =
+                strtoull(Equals + 1, NULL, 0);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static int LblBenchUsage(VOID) {
+    UINTN i;
+
+    fprintf(stderr, "usage: lbl_bench_host [-v] [-n handles] [-s core_mib] [-x extents] [-c churn_rounds]\n"
+                    "                      [-m map_descriptors] [-L latency=ns]... [scenario...]\n"
+                    "scenarios:");
+    for (i = 0; i < LBL_BENCH_SCENARIO_COUNT; i++) {
+        fprintf(stderr, " %s", LblBenchScenarios[i].name);
+    }
+    fprintf(stderr, "\nlatencies:");
+    for (i = 0; i < sizeof(LblBenchLatencyFields) / sizeof(LblBenchLatencyFields[0]); i++) {
+        fprintf(stderr, " %s", LblBenchLatencyFields[i].name);
+    }
+    fprintf(stderr, "\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    UINT32 failures = 0;
+    UINTN i;
+    int opt;
+
+    LblBench.handles = 16;
+    LblBench.core_size = 32ull << 20;
+    LblBench.extents = 8;
+    LblBench.churn_rounds = 3;
+    LblBench.map_descriptors = 400;
+    lbl_mock_default_config(&LblBench.Mock);
+
+    while ((opt = getopt(argc, argv, "vn:s:x:c:m:L:")) != -1) {
+        switch (opt) {
+        case 'v': LblBench.verbose = TRUE; break;
+        case 'n': LblBench.handles = (UINT32)strtoul(optarg, NULL, 0); break;
+        case 's': LblBench.core_size = strtoull(optarg, NULL, 0) << 20; break;
+        case 'x': LblBench.extents = (UINT32)strtoul(optarg, NULL, 0); break;
+        case 'c': LblBench.churn_rounds = (UINT32)strtoul(optarg, NULL, 0); break;
+        case 'm': LblBench.map_descriptors = (UINT32)strtoul(optarg, NULL, 0); break;
+        case 'L':
+            if (!LblBenchSetLatency(optarg)) {
+                return LblBenchUsage();
+            }
+            break;
+        default:
+            return LblBenchUsage();
+        }
+    }
+    if (LblBench.handles < 2 || LblBench.handles > LBL_MOCK_MAX_VOLUMES || LblBench.core_size == 0 ||
+        LblBench.extents == 0 || LblBench.extents > LBL_MOCK_MAX_FILE_EXTENTS) {
+        return LblBenchUsage();
+    }
+
+    printf("Stage 1 load path on mock firmware: %u volumes, %llu MiB large core in %u run(s), "
+           "%u map descriptors, %u churn round(s)\n\n",
+           LblBench.handles, (unsigned long long)(LblBench.core_size >> 20), LblBench.extents,
+           LblBench.map_descriptors, LblBench.churn_rounds);
+    for (i = 0; i < LBL_BENCH_SCENARIO_COUNT; i++) {
+        CONST LBL_BENCH_SCENARIO* Scenario = &LblBenchScenarios[i];
+        LBL_BENCH_RESULT Result;
+        int arg;
+        BOOLEAN selected = optind >= argc;
+
+        for (arg = optind; arg < argc; arg++) {
+            selected |= strcmp(argv[arg], Scenario->name) == 0;
+        }
+        if (!selected) {
+            continue;
+        }
+        if (!LblBenchRun(Scenario, &Result)) {
+            failures++;
+            continue;
+        }
+        LblBenchReport(Scenario, &Result);
+        failures += EFI_ERROR(Result.status) || Result.stats.faults != 0;
+    }
+    return failures != 0;
+}
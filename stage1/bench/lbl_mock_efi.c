@@ -0,0 +1,1834 @@
+// Lionbootloader - Stage 1 - Host Benchmark Mock Firmware
+// File: stage1/bench/lbl_mock_efi.c
+//
+// See lbl_mock_efi.h. The machine is a set of file-scope tables reset by
+// lbl_mock_reset(); nothing here is thread safe, and nothing needs to be: each
+// benchmark scenario runs in its own process.
+
+#define _GNU_SOURCE
+#include "lbl_mock_efi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LBL_MOCK_MAX_VARIABLES      32
+#define LBL_MOCK_MAX_VARIABLE_SIZE  1024
+#define LBL_MOCK_MAX_PAGE_BLOCKS    1024
+#define LBL_MOCK_MAX_POOLS          8192
+#define LBL_MOCK_MAX_PATH           64
+#define LBL_MOCK_DEVICE_PATH_MAX    96
+#define LBL_MOCK_DESCRIPTOR_SIZE    48      // Wider than EFI_MEMORY_DESCRIPTOR, as on most firmware
+#define LBL_MOCK_MAX_HTTP_CHILDREN  8
+#define LBL_MOCK_EVENT_MAGIC        0x4C424C45u
+#define LBL_MOCK_NEVER              UINT64_MAX
+
+EFI_GUID gEfiBlockIoProtocolGuid =
+    { 0x964e5b21, 0x6459, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiDiskIoProtocolGuid =
+    { 0xce345171, 0xba0b, 0x11d2, { 0x8e, 0x4f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiFileInfoGuid =
+    { 0x09576e92, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiGraphicsOutputProtocolGuid =
+    { 0x9042a9de, 0x23dc, 0x4a38, { 0x96, 0xfb, 0x7a, 0xde, 0xd0, 0x80, 0x51, 0x6a } };
+EFI_GUID gEfiLoadedImageProtocolGuid =
+    { 0x5b1b31a1, 0x9562, 0x11d2, { 0x8e, 0x3f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiSimpleFileSystemProtocolGuid =
+    { 0x964e5b22, 0x6459, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+
+static EFI_GUID lbl_mock_disk_io2_guid =
+    { 0x151c8eae, 0x7f2c, 0x472c, { 0x9e, 0x54, 0x98, 0x28, 0x19, 0x4f, 0x6a, 0x88 } };
+static EFI_GUID lbl_mock_esp_type_guid =
+    { 0xc12a7328, 0xf81f, 0x11d2, { 0xba, 0x4b, 0x00, 0xa0, 0xc9, 0x3e, 0xc9, 0x3b } };
+static EFI_GUID lbl_mock_http_service_binding_guid =
+    { 0xbdc8e6af, 0xd9bc, 0x4379, { 0xa7, 0x2a, 0xe0, 0xc4, 0xe7, 0x5d, 0xae, 0x1c } };
+static EFI_GUID lbl_mock_http_guid =
+    { 0x7a59b29b, 0x910b, 0x4171, { 0x82, 0x42, 0xa8, 0x5a, 0x0d, 0xf2, 0x5b, 0x5b } };
+
+// --- The machine ---
+
+typedef struct {
+    UINT64 lba;
+    UINT64 blocks;
+} LBL_MOCK_RUN;
+
+typedef struct {
+    CHAR16 path[LBL_MOCK_MAX_PATH];
+    UINT64 size;
+    UINT32 run_count;
+    LBL_MOCK_RUN runs[LBL_MOCK_MAX_FILE_EXTENTS];
+} LBL_MOCK_FILE;
+
+typedef struct LBL_MOCK_VOLUME LBL_MOCK_VOLUME;
+
+// An open file; `file` is NULL for the root directory.
+typedef struct {
+    EFI_FILE_PROTOCOL protocol;     // First: the loader's EFI_FILE_PROTOCOL* points here
+    LBL_MOCK_VOLUME* volume;
+    LBL_MOCK_FILE* file;
+    UINT64 position;
+} LBL_MOCK_OPEN_FILE;
+
+struct LBL_MOCK_VOLUME {
+    LBL_MOCK_VOLUME_CONFIG config;
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL fs;
+    EFI_BLOCK_IO block_io;
+    EFI_BLOCK_IO_MEDIA media;
+    EFI_DISK_IO disk_io;
+    EFI_DISK_IO2 disk_io2;
+    UINT8 device_path[LBL_MOCK_DEVICE_PATH_MAX];
+    UINT8* disk;                    // Backing blocks
+    UINT64 disk_blocks;
+    UINT64 busy_until;              // Simulated time the device finishes its queued work
+    UINT32 file_count;
+    LBL_MOCK_FILE files[LBL_MOCK_MAX_FILES];
+};
+
+typedef struct {
+    CHAR16 name[LBL_MOCK_MAX_PATH];
+    EFI_GUID guid;
+    UINT32 attributes;
+    UINTN size;
+    UINT8 data[LBL_MOCK_MAX_VARIABLE_SIZE];
+} LBL_MOCK_VARIABLE;
+
+typedef struct {
+    UINT64 base;
+    UINTN pages;
+    UINTN live_pages;               // Head and tail may be handed back separately
+    VOID* host;
+} LBL_MOCK_PAGE_BLOCK;
+
+typedef struct {
+    VOID* host;
+    UINTN size;
+} LBL_MOCK_POOL;
+
+typedef struct {
+    UINT32 magic;
+    UINT64 signal_at;               // Simulated time it fires, or LBL_MOCK_NEVER
+} LBL_MOCK_EVENT;
+
+// Same layout as LBL_SERVICE_BINDING_PROTOCOL / LBL_HTTP_PROTOCOL in LblUefi.h;
+// the configuration and tokens are never looked into.
+typedef struct LBL_MOCK_SERVICE_BINDING LBL_MOCK_SERVICE_BINDING;
+struct LBL_MOCK_SERVICE_BINDING {
+    EFI_STATUS (EFIAPI *CreateChild)(LBL_MOCK_SERVICE_BINDING* This, EFI_HANDLE* ChildHandle);
+    EFI_STATUS (EFIAPI *DestroyChild)(LBL_MOCK_SERVICE_BINDING* This, EFI_HANDLE ChildHandle);
+};
+
+typedef struct LBL_MOCK_HTTP LBL_MOCK_HTTP;
+struct LBL_MOCK_HTTP {
+    VOID* GetModeData;
+    EFI_STATUS (EFIAPI *Configure)(LBL_MOCK_HTTP* This, VOID* HttpConfigData);
+    EFI_STATUS (EFIAPI *Request)(LBL_MOCK_HTTP* This, VOID* Token);
+    EFI_STATUS (EFIAPI *Cancel)(LBL_MOCK_HTTP* This, VOID* Token);
+    EFI_STATUS (EFIAPI *Response)(LBL_MOCK_HTTP* This, VOID* Token);
+    EFI_STATUS (EFIAPI *Poll)(LBL_MOCK_HTTP* This);
+};
+
+// An HTTP child; the handle and the protocol pointer are both its address.
+typedef struct {
+    LBL_MOCK_HTTP http;             // First member
+    BOOLEAN live;
+    BOOLEAN configured;
+} LBL_MOCK_HTTP_CHILD;
+
+typedef struct {
+    BOOLEAN present;
+    LBL_MOCK_NIC_CONFIG config;
+    LBL_MOCK_SERVICE_BINDING binding;
+    LBL_MOCK_HTTP_CHILD children[LBL_MOCK_MAX_HTTP_CHILDREN];
+} LBL_MOCK_NIC;
+
+static LBL_MOCK_CONFIG lbl_mock_config;
+static LBL_MOCK_STATS lbl_mock_stats;
+static EFI_SYSTEM_TABLE lbl_mock_system_table;
+static EFI_BOOT_SERVICES lbl_mock_boot_services;
+static EFI_RUNTIME_SERVICES lbl_mock_runtime_services;
+static SIMPLE_TEXT_OUTPUT_INTERFACE lbl_mock_con_out;
+static EFI_LOADED_IMAGE lbl_mock_loaded_image;
+static UINT8 lbl_mock_image_handle;  // Only its address is used
+
+static LBL_MOCK_VOLUME lbl_mock_volumes[LBL_MOCK_MAX_VOLUMES];
+static UINT32 lbl_mock_volume_count;
+static LBL_MOCK_VARIABLE lbl_mock_variables[LBL_MOCK_MAX_VARIABLES];
+static LBL_MOCK_PAGE_BLOCK lbl_mock_page_blocks[LBL_MOCK_MAX_PAGE_BLOCKS];
+static UINT32 lbl_mock_page_block_count;
+static LBL_MOCK_POOL lbl_mock_pools[LBL_MOCK_MAX_POOLS];
+static UINT32 lbl_mock_pool_count;
+static LBL_MOCK_EVENT* lbl_mock_free_events; // Reused via signal_at as a link
+static LBL_MOCK_NIC lbl_mock_nic;    // Its address is the NIC handle
+
+static UINTN lbl_mock_map_key;
+static UINT32 lbl_mock_churn_descriptors;
+static UINT32 lbl_mock_churn_left;
+static BOOLEAN lbl_mock_exited;      // ExitBootServices succeeded
+static BOOLEAN lbl_mock_exit_failed; // ...or failed: only GetMemoryMap/ExitBootServices allowed now
+
+static BOOLEAN lbl_mock_running;     // Between lbl_mock_begin and lbl_mock_end
+static UINT64 lbl_mock_host_mark;    // Host time the loader last got control back
+
+extern EFI_SYSTEM_TABLE* ST;
+extern EFI_BOOT_SERVICES* BS;
+extern EFI_RUNTIME_SERVICES* RS;
+extern EFI_HANDLE IH;
+
+static CONST CHAR8* lbl_mock_call_names[LblMockCallCount] = {
+    "AllocatePages", "FreePages", "GetMemoryMap", "AllocatePool", "FreePool",
+    "CreateEvent", "SetTimer", "WaitForEvent", "CloseEvent", "CheckEvent",
+    "HandleProtocol", "LocateDevicePath", "ExitBootServices", "Stall",
+    "LocateHandleBuffer", "LocateProtocol", "CalculateCrc32", "CopyMem", "SetMem",
+    "GetVariable", "SetVariable", "ResetSystem", "OutputString", "OpenVolume",
+    "File.Open", "File.Close", "File.Read", "File.ReadEx", "File.GetInfo",
+    "File.SetPosition", "File.GetPosition", "ReadBlocks", "ReadDisk", "ReadDiskEx",
+    "CreateChild", "DestroyChild", "Http.Configure", "Http.Request", "Http.Cancel",
+    "Http.Response", "Http.Poll",
+};
+
+// --- Clock ---
+
+static UINT64 lbl_mock_host_ns(VOID) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000000000ull + (UINT64)ts.tv_nsec;
+}
+
+static UINT64 lbl_mock_now(VOID) {
+    return lbl_mock_stats.io_ns + lbl_mock_stats.wait_ns + lbl_mock_stats.cpu_ns;
+}
+
+static VOID lbl_mock_fault(CONST CHAR8* what) {
+    lbl_mock_stats.faults++;
+    fprintf(stderr, "mock firmware: %s\n", what);
+}
+
+/**
+ * @brief Firmware entry: charges the loader time since the last call, counts the
+ * call and checks it is still allowed. Pair with lbl_mock_leave().
+ */
+static VOID lbl_mock_enter(LBL_MOCK_CALL call) {
+    UINT64 host = lbl_mock_host_ns();
+
+    if (lbl_mock_running) {
+        lbl_mock_stats.cpu_ns += host - lbl_mock_host_mark;
+    }
+    lbl_mock_stats.calls[call]++;
+    lbl_mock_stats.io_ns += lbl_mock_config.Latency.call_ns;
+    if (call > LblMockSetMem && call != LblMockOutputString) {
+        return; // Runtime services and protocols outlive the checks below
+    }
+    if (lbl_mock_exited) {
+        lbl_mock_fault("boot service called after ExitBootServices");
+    } else if (lbl_mock_exit_failed && call != LblMockGetMemoryMap && call != LblMockExitBootServices) {
+        lbl_mock_fault("boot service other than GetMemoryMap called after a failed ExitBootServices");
+    }
+}
+
+static VOID lbl_mock_leave(VOID) {
+    lbl_mock_host_mark = lbl_mock_host_ns();
+}
+
+static VOID lbl_mock_charge(UINT64 ns) {
+    lbl_mock_stats.io_ns += ns;
+}
+
+static UINT64 lbl_mock_transfer_ns(UINT64 bytes, UINT64 ns_per_mib) {
+    return (bytes * ns_per_mib) >> 20;
+}
+
+/**
+ * @brief A blocking transfer on a volume's device: waits for queued work,
+ * then takes `ns` of device time.
+ */
+static VOID lbl_mock_device_sync(LBL_MOCK_VOLUME* volume, UINT64 ns) {
+    UINT64 now = lbl_mock_now();
+
+    if (volume->busy_until > now) {
+        lbl_mock_stats.wait_ns += volume->busy_until - now;
+    }
+    lbl_mock_charge(ns);
+    volume->busy_until = lbl_mock_now();
+}
+
+/**
+ * @brief Queues a transfer of `ns` device time behind the device's earlier work.
+ * @return The simulated time it completes.
+ */
+static UINT64 lbl_mock_device_async(LBL_MOCK_VOLUME* volume, UINT64 ns) {
+    UINT64 now = lbl_mock_now();
+    UINT64 start = volume->busy_until > now ? volume->busy_until : now;
+
+    volume->busy_until = start + ns;
+    return volume->busy_until;
+}
+
+// --- Allocations ---
+
+static VOID lbl_mock_account(INT64 bytes) {
+    lbl_mock_stats.live_bytes += (UINT64)bytes;
+    if (lbl_mock_stats.live_bytes > lbl_mock_stats.peak_bytes) {
+        lbl_mock_stats.peak_bytes = lbl_mock_stats.live_bytes;
+    }
+    lbl_mock_map_key++;
+}
+
+static VOID* lbl_mock_pool_alloc(UINTN size) {
+    VOID* host;
+
+    if (lbl_mock_pool_count == LBL_MOCK_MAX_POOLS || (host = malloc(size ? size : 1)) == NULL) {
+        return NULL;
+    }
+    memset(host, 0xAF, size); // Pool memory is not zeroed
+    lbl_mock_pools[lbl_mock_pool_count].host = host;
+    lbl_mock_pools[lbl_mock_pool_count].size = size;
+    lbl_mock_pool_count++;
+    lbl_mock_stats.pool_allocations++;
+    lbl_mock_stats.pool_bytes += size;
+    lbl_mock_account((INT64)size);
+    return host;
+}
+
+static EFI_STATUS lbl_mock_pool_free(VOID* host) {
+    UINT32 i;
+
+    for (i = 0; i < lbl_mock_pool_count; i++) {
+        if (lbl_mock_pools[i].host == host) {
+            lbl_mock_account(-(INT64)lbl_mock_pools[i].size);
+            free(host);
+            lbl_mock_pools[i] = lbl_mock_pools[--lbl_mock_pool_count];
+            return EFI_SUCCESS;
+        }
+    }
+    lbl_mock_fault("FreePool of a buffer that is not allocated");
+    return EFI_INVALID_PARAMETER;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_allocate_pages(EFI_ALLOCATE_TYPE Type, EFI_MEMORY_TYPE MemoryType, UINTN Pages,
+                                                 EFI_PHYSICAL_ADDRESS* Memory) {
+    EFI_STATUS status = EFI_SUCCESS;
+    VOID* host = NULL;
+    UINTN bytes = Pages * EFI_PAGE_SIZE;
+
+    (VOID)MemoryType;
+    lbl_mock_enter(LblMockAllocatePages);
+    lbl_mock_charge(lbl_mock_config.Latency.alloc_ns);
+    if (Pages == 0 || Memory == NULL) {
+        status = EFI_INVALID_PARAMETER;
+    } else if (Type == AllocateAddress) {
+        status = EFI_NOT_FOUND; // Host memory cannot be placed at a fixed physical address
+    } else if (lbl_mock_page_block_count == LBL_MOCK_MAX_PAGE_BLOCKS ||
+               posix_memalign(&host, EFI_PAGE_SIZE, bytes) != 0) {
+        status = EFI_OUT_OF_RESOURCES;
+    } else {
+        // AllocateMaxAddress limits are not honoured: host addresses are wherever
+        // the host allocator puts them. The loader only ever dereferences them.
+        LBL_MOCK_PAGE_BLOCK* block = &lbl_mock_page_blocks[lbl_mock_page_block_count++];
+        memset(host, 0xAF, bytes);
+        block->base = (UINT64)(UINTN)host;
+        block->pages = Pages;
+        block->live_pages = Pages;
+        block->host = host;
+        *Memory = block->base;
+        lbl_mock_stats.page_allocations++;
+        lbl_mock_stats.page_bytes += bytes;
+        lbl_mock_account((INT64)bytes);
+    }
+    lbl_mock_leave();
+    return status;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_free_pages(EFI_PHYSICAL_ADDRESS Memory, UINTN Pages) {
+    EFI_STATUS status = EFI_NOT_FOUND;
+    UINT32 i;
+
+    lbl_mock_enter(LblMockFreePages);
+    lbl_mock_charge(lbl_mock_config.Latency.alloc_ns);
+    for (i = 0; i < lbl_mock_page_block_count; i++) {
+        LBL_MOCK_PAGE_BLOCK* block = &lbl_mock_page_blocks[i];
+        if (Memory >= block->base && Memory + EFI_PAGES_TO_SIZE((UINT64)Pages) <= block->base +
+            EFI_PAGES_TO_SIZE((UINT64)block->pages) && Pages <= block->live_pages) {
+            block->live_pages -= Pages;
+            lbl_mock_account(-(INT64)EFI_PAGES_TO_SIZE((UINT64)Pages));
+            if (block->live_pages == 0) {
+                free(block->host);
+                *block = lbl_mock_page_blocks[--lbl_mock_page_block_count];
+            }
+            status = EFI_SUCCESS;
+            break;
+        }
+    }
+    if (EFI_ERROR(status)) {
+        lbl_mock_fault("FreePages of a range that is not allocated");
+    }
+    lbl_mock_leave();
+    return status;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_allocate_pool(EFI_MEMORY_TYPE PoolType, UINTN Size, VOID** Buffer) {
+    EFI_STATUS status = EFI_SUCCESS;
+
+    (VOID)PoolType;
+    lbl_mock_enter(LblMockAllocatePool);
+    lbl_mock_charge(lbl_mock_config.Latency.alloc_ns);
+    if (Buffer == NULL) {
+        status = EFI_INVALID_PARAMETER;
+    } else if ((*Buffer = lbl_mock_pool_alloc(Size)) == NULL) {
+        status = EFI_OUT_OF_RESOURCES;
+    }
+    lbl_mock_leave();
+    return status;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_free_pool(VOID* Buffer) {
+    EFI_STATUS status;
+
+    lbl_mock_enter(LblMockFreePool);
+    lbl_mock_charge(lbl_mock_config.Latency.alloc_ns);
+    status = lbl_mock_pool_free(Buffer);
+    lbl_mock_leave();
+    return status;
+}
+
+// --- Memory map ---
+
+static UINT32 lbl_mock_descriptor_count(VOID) {
+    // Every live allocation splits a free range; pools share pages, 16 to a range.
+    return lbl_mock_config.MemoryMap.base_descriptors + lbl_mock_churn_descriptors +
+           lbl_mock_page_block_count + (lbl_mock_pool_count + 15) / 16;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_get_memory_map(UINTN* MemoryMapSize, EFI_MEMORY_DESCRIPTOR* MemoryMap,
+                                                 UINTN* MapKey, UINTN* DescriptorSize, UINT32* DescriptorVersion) {
+    EFI_STATUS status = EFI_SUCCESS;
+    UINT32 count = lbl_mock_descriptor_count();
+    UINTN needed = (UINTN)count * LBL_MOCK_DESCRIPTOR_SIZE;
+    UINT64 address = 0;
+    UINT32 i;
+
+    lbl_mock_enter(LblMockGetMemoryMap);
+    if (MemoryMapSize == NULL || MapKey == NULL || DescriptorSize == NULL || DescriptorVersion == NULL) {
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER;
+    }
+    *DescriptorSize = LBL_MOCK_DESCRIPTOR_SIZE;
+    *DescriptorVersion = EFI_MEMORY_DESCRIPTOR_VERSION;
+    if (*MemoryMapSize < needed || MemoryMap == NULL) {
+        *MemoryMapSize = needed;
+        lbl_mock_leave();
+        return EFI_BUFFER_TOO_SMALL;
+    }
+
+    lbl_mock_charge((UINT64)count * lbl_mock_config.Latency.memory_map_ns_per_descriptor);
+    for (i = 0; i < count; i++) {
+        EFI_MEMORY_DESCRIPTOR* d = (EFI_MEMORY_DESCRIPTOR*)((UINT8*)MemoryMap + (UINTN)i * LBL_MOCK_DESCRIPTOR_SIZE);
+        static CONST UINT32 types[] = { EfiConventionalMemory, EfiBootServicesData, EfiLoaderData,
+                                        EfiBootServicesCode, EfiConventionalMemory, EfiACPIReclaimMemory,
+                                        EfiRuntimeServicesData, EfiConventionalMemory };
+        memset(d, 0, LBL_MOCK_DESCRIPTOR_SIZE);
+        d->Type = types[i % (sizeof(types) / sizeof(types[0]))];
+        d->PhysicalStart = address;
+        d->NumberOfPages = 16 + (i % 7) * 64;
+        d->Attribute = EFI_MEMORY_UC | EFI_MEMORY_WC | EFI_MEMORY_WT | EFI_MEMORY_WB;
+        if (d->Type == EfiRuntimeServicesData) {
+            d->Attribute |= EFI_MEMORY_RUNTIME;
+        }
+        address += EFI_PAGES_TO_SIZE(d->NumberOfPages);
+    }
+    *MemoryMapSize = needed;
+    *MapKey = lbl_mock_map_key;
+
+    // A firmware callback that runs right after this snapshot: the key just
+    // returned is stale and the map a little larger.
+    if (lbl_mock_churn_left > 0) {
+        lbl_mock_churn_left--;
+        lbl_mock_churn_descriptors += lbl_mock_config.MemoryMap.churn_growth;
+        lbl_mock_map_key++;
+    }
+    lbl_mock_leave();
+    return status;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_exit_boot_services(EFI_HANDLE ImageHandle, UINTN MapKey) {
+    EFI_STATUS status = EFI_SUCCESS;
+
+    lbl_mock_enter(LblMockExitBootServices);
+    lbl_mock_stats.exit_attempts++;
+    lbl_mock_charge(lbl_mock_config.Latency.exit_boot_services_ns);
+    if (ImageHandle != (EFI_HANDLE)&lbl_mock_image_handle || MapKey != lbl_mock_map_key) {
+        status = EFI_INVALID_PARAMETER;
+        lbl_mock_exit_failed = TRUE;
+    } else {
+        lbl_mock_exited = TRUE;
+    }
+    lbl_mock_leave();
+    return status;
+}
+
+// --- Events ---
+
+static LBL_MOCK_EVENT* lbl_mock_event(EFI_EVENT Event) {
+    LBL_MOCK_EVENT* event = (LBL_MOCK_EVENT*)Event;
+    if (event == NULL || event->magic != LBL_MOCK_EVENT_MAGIC) {
+        lbl_mock_fault("event is not open");
+        return NULL;
+    }
+    return event;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_create_event(UINT32 Type, EFI_TPL NotifyTpl, EFI_EVENT_NOTIFY NotifyFunction,
+                                               VOID* NotifyContext, EFI_EVENT* Event) {
+    LBL_MOCK_EVENT* event;
+
+    (VOID)Type;
+    (VOID)NotifyTpl;
+    (VOID)NotifyContext;
+    lbl_mock_enter(LblMockCreateEvent);
+    if (Event == NULL || NotifyFunction != NULL) {
+        lbl_mock_leave();
+        return NotifyFunction != NULL ? EFI_UNSUPPORTED : EFI_INVALID_PARAMETER;
+    }
+    event = calloc(1, sizeof(*event));
+    if (event == NULL) {
+        lbl_mock_leave();
+        return EFI_OUT_OF_RESOURCES;
+    }
+    event->magic = LBL_MOCK_EVENT_MAGIC;
+    event->signal_at = LBL_MOCK_NEVER;
+    *Event = event;
+    lbl_mock_leave();
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_close_event(EFI_EVENT Event) {
+    LBL_MOCK_EVENT* event;
+
+    lbl_mock_enter(LblMockCloseEvent);
+    event = lbl_mock_event(Event);
+    if (event != NULL) {
+        event->magic = 0;
+        free(event);
+    }
+    lbl_mock_leave();
+    return event != NULL ? EFI_SUCCESS : EFI_INVALID_PARAMETER;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_set_timer(EFI_EVENT Event, EFI_TIMER_DELAY Type, UINT64 TriggerTime) {
+    LBL_MOCK_EVENT* event;
+
+    lbl_mock_enter(LblMockSetTimer);
+    event = lbl_mock_event(Event);
+    if (event != NULL) {
+        // Periodic timers fire like relative ones here: nothing waits on one twice.
+        event->signal_at = Type == TimerCancel ? LBL_MOCK_NEVER : lbl_mock_now() + TriggerTime * 100;
+    }
+    lbl_mock_leave();
+    return event != NULL ? EFI_SUCCESS : EFI_INVALID_PARAMETER;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_wait_for_event(UINTN NumberOfEvents, EFI_EVENT* Event, UINTN* Index) {
+    LBL_MOCK_EVENT* first = NULL;
+    UINTN first_index = 0;
+    UINTN i;
+    UINT64 now;
+
+    lbl_mock_enter(LblMockWaitForEvent);
+    for (i = 0; i < NumberOfEvents; i++) {
+        LBL_MOCK_EVENT* event = lbl_mock_event(Event[i]);
+        if (event != NULL && (first == NULL || event->signal_at < first->signal_at)) {
+            first = event;
+            first_index = i;
+        }
+    }
+    if (first == NULL || first->signal_at == LBL_MOCK_NEVER) {
+        lbl_mock_fault("WaitForEvent on events that never fire (real firmware hangs here)");
+        lbl_mock_leave();
+        return EFI_DEVICE_ERROR;
+    }
+    now = lbl_mock_now();
+    if (first->signal_at > now) {
+        lbl_mock_stats.wait_ns += first->signal_at - now;
+    }
+    first->signal_at = LBL_MOCK_NEVER; // Waiting consumes the signal
+    if (Index != NULL) {
+        *Index = first_index;
+    }
+    lbl_mock_leave();
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_check_event(EFI_EVENT Event) {
+    EFI_STATUS status = EFI_NOT_READY;
+    LBL_MOCK_EVENT* event;
+
+    lbl_mock_enter(LblMockCheckEvent);
+    event = lbl_mock_event(Event);
+    if (event == NULL) {
+        status = EFI_INVALID_PARAMETER;
+    } else if (event->signal_at <= lbl_mock_now()) {
+        event->signal_at = LBL_MOCK_NEVER;
+        status = EFI_SUCCESS;
+    }
+    lbl_mock_leave();
+    return status;
+}
+
+static VOID lbl_mock_signal_at(EFI_EVENT Event, UINT64 when) {
+    LBL_MOCK_EVENT* event = lbl_mock_event(Event);
+    if (event != NULL) {
+        event->signal_at = when;
+    }
+}
+
+static EFI_STATUS EFIAPI lbl_mock_stall(UINTN Microseconds) {
+    lbl_mock_enter(LblMockStall);
+    lbl_mock_stats.wait_ns += (UINT64)Microseconds * 1000;
+    lbl_mock_leave();
+    return EFI_SUCCESS;
+}
+
+// --- Handles ---
+
+static LBL_MOCK_VOLUME* lbl_mock_volume(EFI_HANDLE Handle) {
+    LBL_MOCK_VOLUME* volume = (LBL_MOCK_VOLUME*)Handle;
+
+    if (volume < lbl_mock_volumes || volume >= lbl_mock_volumes + lbl_mock_volume_count) {
+        return NULL;
+    }
+    return volume;
+}
+
+static LBL_MOCK_HTTP_CHILD* lbl_mock_http_child(EFI_HANDLE Handle) {
+    LBL_MOCK_HTTP_CHILD* child = (LBL_MOCK_HTTP_CHILD*)Handle;
+
+    if (child < lbl_mock_nic.children || child >= lbl_mock_nic.children + LBL_MOCK_MAX_HTTP_CHILDREN ||
+        !child->live) {
+        return NULL;
+    }
+    return child;
+}
+
+static BOOLEAN lbl_mock_guid_is(CONST EFI_GUID* a, CONST EFI_GUID* b) {
+    return memcmp(a, b, sizeof(EFI_GUID)) == 0;
+}
+
+/**
+ * @brief The protocol interface a handle carries, or NULL.
+ */
+static VOID* lbl_mock_interface(EFI_HANDLE Handle, CONST EFI_GUID* Protocol) {
+    LBL_MOCK_VOLUME* volume = lbl_mock_volume(Handle);
+    LBL_MOCK_HTTP_CHILD* child = lbl_mock_http_child(Handle);
+
+    if (Handle == (EFI_HANDLE)&lbl_mock_image_handle) {
+        return lbl_mock_guid_is(Protocol, &gEfiLoadedImageProtocolGuid) ? &lbl_mock_loaded_image : NULL;
+    }
+    if (Handle == (EFI_HANDLE)&lbl_mock_nic) {
+        return lbl_mock_nic.present && lbl_mock_guid_is(Protocol, &lbl_mock_http_service_binding_guid) ?
+               &lbl_mock_nic.binding : NULL;
+    }
+    if (child != NULL) {
+        return lbl_mock_guid_is(Protocol, &lbl_mock_http_guid) ? &child->http : NULL;
+    }
+    if (volume == NULL) {
+        return NULL;
+    }
+    if (lbl_mock_guid_is(Protocol, &gEfiSimpleFileSystemProtocolGuid)) {
+        return &volume->fs;
+    }
+    if (lbl_mock_guid_is(Protocol, &gEfiBlockIoProtocolGuid) && volume->config.block_io) {
+        return &volume->block_io;
+    }
+    if (lbl_mock_guid_is(Protocol, &gEfiDiskIoProtocolGuid) && volume->config.block_io && volume->config.disk_io) {
+        return &volume->disk_io;
+    }
+    if (lbl_mock_guid_is(Protocol, &lbl_mock_disk_io2_guid) && volume->config.block_io && volume->config.disk_io2) {
+        return &volume->disk_io2;
+    }
+    if (lbl_mock_guid_is(Protocol, &lbl_mock_esp_type_guid) && volume->config.kind == LblMockVolumeLocalEsp) {
+        return &volume->media; // Marker protocol: any non-NULL interface
+    }
+    return NULL;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_handle_protocol(EFI_HANDLE Handle, EFI_GUID* Protocol, VOID** Interface) {
+    VOID* found;
+
+    lbl_mock_enter(LblMockHandleProtocol);
+    lbl_mock_charge(lbl_mock_config.Latency.handle_protocol_ns);
+    if (Protocol == NULL || Interface == NULL) {
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER;
+    }
+    found = lbl_mock_interface(Handle, Protocol);
+    *Interface = found;
+    lbl_mock_leave();
+    return found != NULL ? EFI_SUCCESS : EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_locate_handle_buffer(EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID* Protocol,
+                                                       VOID* SearchKey, UINTN* NoHandles, EFI_HANDLE** Buffer) {
+    UINTN count = 0;
+    UINT32 i;
+
+    (VOID)SearchKey;
+    lbl_mock_enter(LblMockLocateHandleBuffer);
+    lbl_mock_charge((UINT64)(lbl_mock_volume_count + 1) * lbl_mock_config.Latency.locate_ns_per_handle);
+    if (SearchType != ByProtocol || Protocol == NULL || NoHandles == NULL || Buffer == NULL) {
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER;
+    }
+    for (i = 0; i < lbl_mock_volume_count; i++) {
+        count += lbl_mock_interface(&lbl_mock_volumes[i], Protocol) != NULL;
+    }
+    count += lbl_mock_interface(&lbl_mock_nic, Protocol) != NULL;
+    *NoHandles = 0;
+    *Buffer = NULL;
+    if (count == 0) {
+        lbl_mock_leave();
+        return EFI_NOT_FOUND;
+    }
+    // The loader frees this with FreePool, so it is a loader allocation.
+    *Buffer = lbl_mock_pool_alloc(count * sizeof(EFI_HANDLE));
+    if (*Buffer == NULL) {
+        lbl_mock_leave();
+        return EFI_OUT_OF_RESOURCES;
+    }
+    for (i = 0; i < lbl_mock_volume_count; i++) {
+        if (lbl_mock_interface(&lbl_mock_volumes[i], Protocol) != NULL) {
+            (*Buffer)[(*NoHandles)++] = &lbl_mock_volumes[i];
+        }
+    }
+    if (lbl_mock_interface(&lbl_mock_nic, Protocol) != NULL) {
+        (*Buffer)[(*NoHandles)++] = &lbl_mock_nic;
+    }
+    lbl_mock_leave();
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_locate_device_path(EFI_GUID* Protocol, EFI_DEVICE_PATH** DevicePath,
+                                                     EFI_HANDLE* Device) {
+    LBL_MOCK_VOLUME* best = NULL;
+    UINTN best_length = 0;
+    UINT32 i;
+
+    lbl_mock_enter(LblMockLocateDevicePath);
+    lbl_mock_charge((UINT64)(lbl_mock_volume_count + 1) * lbl_mock_config.Latency.locate_ns_per_handle);
+    if (Protocol == NULL || DevicePath == NULL || *DevicePath == NULL || Device == NULL) {
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER;
+    }
+    // Longest handle path (without its end node) that prefixes the one asked for.
+    for (i = 0; i < lbl_mock_volume_count; i++) {
+        LBL_MOCK_VOLUME* volume = &lbl_mock_volumes[i];
+        UINTN length = DevicePathSize((EFI_DEVICE_PATH*)volume->device_path) - sizeof(EFI_DEVICE_PATH);
+        if (lbl_mock_interface(volume, Protocol) != NULL && length > best_length &&
+            DevicePathSize(*DevicePath) >= length + sizeof(EFI_DEVICE_PATH) &&
+            memcmp(volume->device_path, *DevicePath, length) == 0) {
+            best = volume;
+            best_length = length;
+        }
+    }
+    if (best == NULL) {
+        lbl_mock_leave();
+        return EFI_NOT_FOUND;
+    }
+    *Device = best;
+    *DevicePath = (EFI_DEVICE_PATH*)((UINT8*)*DevicePath + best_length);
+    lbl_mock_leave();
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_locate_protocol(EFI_GUID* Protocol, VOID* Registration, VOID** Interface) {
+    (VOID)Protocol;
+    (VOID)Registration;
+    lbl_mock_enter(LblMockLocateProtocol);
+    lbl_mock_charge(lbl_mock_config.Latency.handle_protocol_ns);
+    if (Interface != NULL) {
+        *Interface = NULL;
+    }
+    lbl_mock_leave();
+    return EFI_NOT_FOUND; // No GOP, MP, RNG or network stack on this machine
+}
+
+// --- CPU-bound services: counted, but run and timed as loader code ---
+
+static CONST UINT32* lbl_mock_crc_table(VOID) {
+    static UINT32 table[256];
+    static BOOLEAN ready;
+    UINT32 i, j;
+
+    if (!ready) {
+        for (i = 0; i < 256; i++) {
+            UINT32 c = i;
+            for (j = 0; j < 8; j++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        ready = TRUE;
+    }
+    return table;
+}
+
+static UINT32 lbl_mock_crc32(CONST VOID* data, UINTN size) {
+    CONST UINT32* table = lbl_mock_crc_table();
+    CONST UINT8* bytes = (CONST UINT8*)data;
+    UINT32 crc = 0xFFFFFFFFu;
+
+    while (size--) {
+        crc = table[(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_calculate_crc32(VOID* Data, UINTN DataSize, UINT32* Crc32) {
+    lbl_mock_stats.calls[LblMockCalculateCrc32]++;
+    if (Data == NULL || DataSize == 0 || Crc32 == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    *Crc32 = lbl_mock_crc32(Data, DataSize);
+    return EFI_SUCCESS;
+}
+
+static VOID EFIAPI lbl_mock_copy_mem(VOID* Destination, VOID* Source, UINTN Length) {
+    lbl_mock_stats.calls[LblMockCopyMem]++;
+    lbl_mock_stats.copy_bytes += Length;
+    memmove(Destination, Source, Length);
+}
+
+static VOID EFIAPI lbl_mock_set_mem(VOID* Buffer, UINTN Size, UINT8 Value) {
+    lbl_mock_stats.calls[LblMockSetMem]++;
+    memset(Buffer, Value, Size);
+}
+
+// --- Runtime services ---
+
+static UINTN lbl_mock_str_len(CONST CHAR16* s) {
+    UINTN n = 0;
+    while (s[n] != 0) {
+        n++;
+    }
+    return n;
+}
+
+static BOOLEAN lbl_mock_str_eq(CONST CHAR16* a, CONST CHAR16* b, BOOLEAN fold) {
+    for (;; a++, b++) {
+        CHAR16 x = *a, y = *b;
+        if (fold) {
+            x = (x >= 'a' && x <= 'z') ? (CHAR16)(x - 32) : x;
+            y = (y >= 'a' && y <= 'z') ? (CHAR16)(y - 32) : y;
+        }
+        if (x != y) {
+            return FALSE;
+        }
+        if (x == 0) {
+            return TRUE;
+        }
+    }
+}
+
+static LBL_MOCK_VARIABLE* lbl_mock_find_variable(CONST CHAR16* name, CONST EFI_GUID* guid) {
+    UINT32 i;
+
+    for (i = 0; i < LBL_MOCK_MAX_VARIABLES; i++) {
+        LBL_MOCK_VARIABLE* v = &lbl_mock_variables[i];
+        if (v->name[0] != 0 && lbl_mock_str_eq(v->name, name, FALSE) && lbl_mock_guid_is(&v->guid, guid)) {
+            return v;
+        }
+    }
+    return NULL;
+}
+
+static EFI_STATUS lbl_mock_store_variable(CONST CHAR16* name, CONST EFI_GUID* guid, UINT32 attributes,
+                                          CONST VOID* data, UINTN size) {
+    LBL_MOCK_VARIABLE* v = lbl_mock_find_variable(name, guid);
+    UINT32 i;
+
+    if (lbl_mock_str_len(name) >= LBL_MOCK_MAX_PATH || size > LBL_MOCK_MAX_VARIABLE_SIZE) {
+        return EFI_OUT_OF_RESOURCES;
+    }
+    if (size == 0 || attributes == 0) {
+        if (v == NULL) {
+            return EFI_NOT_FOUND;
+        }
+        memset(v, 0, sizeof(*v));
+        return EFI_SUCCESS;
+    }
+    for (i = 0; v == NULL && i < LBL_MOCK_MAX_VARIABLES; i++) {
+        if (lbl_mock_variables[i].name[0] == 0) {
+            v = &lbl_mock_variables[i];
+        }
+    }
+    if (v == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+    }
+    memcpy(v->name, name, (lbl_mock_str_len(name) + 1) * sizeof(CHAR16));
+    v->guid = *guid;
+    v->attributes = attributes;
+    v->size = size;
+    memcpy(v->data, data, size);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_get_variable_service(CHAR16* VariableName, EFI_GUID* VendorGuid,
+                                                       UINT32* Attributes, UINTN* DataSize, VOID* Data) {
+    LBL_MOCK_VARIABLE* v;
+    EFI_STATUS status = EFI_SUCCESS;
+
+    lbl_mock_enter(LblMockGetVariable);
+    lbl_mock_charge(lbl_mock_config.Latency.nvram_read_ns);
+    if (VariableName == NULL || VendorGuid == NULL || DataSize == NULL) {
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER;
+    }
+    v = lbl_mock_find_variable(VariableName, VendorGuid);
+    if (v == NULL) {
+        status = EFI_NOT_FOUND;
+    } else if (*DataSize < v->size || Data == NULL) {
+        *DataSize = v->size;
+        status = EFI_BUFFER_TOO_SMALL;
+    } else {
+        memcpy(Data, v->data, v->size);
+        *DataSize = v->size;
+        if (Attributes != NULL) {
+            *Attributes = v->attributes;
+        }
+    }
+    lbl_mock_leave();
+    return status;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_set_variable_service(CHAR16* VariableName, EFI_GUID* VendorGuid,
+                                                       UINT32 Attributes, UINTN DataSize, VOID* Data) {
+    EFI_STATUS status;
+
+    lbl_mock_enter(LblMockSetVariable);
+    lbl_mock_charge(lbl_mock_config.Latency.nvram_write_ns);
+    if (VariableName == NULL || VendorGuid == NULL || (DataSize != 0 && Data == NULL)) {
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER;
+    }
+    status = lbl_mock_store_variable(VariableName, VendorGuid, Attributes, Data, DataSize);
+    lbl_mock_leave();
+    return status;
+}
+
+static VOID EFIAPI lbl_mock_reset_system(EFI_RESET_TYPE ResetType, EFI_STATUS ResetStatus, UINTN DataSize,
+                                         VOID* ResetData) {
+    (VOID)DataSize;
+    (VOID)ResetData;
+    lbl_mock_enter(LblMockResetSystem);
+    fprintf(stderr, "mock firmware: ResetSystem(%d, 0x%llx)\n", (int)ResetType, (unsigned long long)ResetStatus);
+    exit(3);
+}
+
+static EFI_STATUS EFIAPI lbl_mock_output_string(SIMPLE_TEXT_OUTPUT_INTERFACE* This, CHAR16* String) {
+    UINTN n;
+
+    (VOID)This;
+    lbl_mock_enter(LblMockOutputString);
+    n = lbl_mock_str_len(String);
+    lbl_mock_stats.console_chars += n;
+    lbl_mock_charge((UINT64)n * lbl_mock_config.Latency.console_ns_per_char);
+    if (lbl_mock_config.echo_console) {
+        UINTN i;
+        for (i = 0; i < n; i++) {
+            fputc(String[i] < 0x80 ? (int)String[i] : '?', stderr);
+        }
+    }
+    lbl_mock_leave();
+    return EFI_SUCCESS;
+}
+
+// --- Block devices ---
+
+static CONST UINT8* lbl_mock_block(LBL_MOCK_VOLUME* volume, UINT64 lba) {
+    return volume->disk + lba * LBL_MOCK_BLOCK_SIZE;
+}
+
+static LBL_MOCK_VOLUME* lbl_mock_volume_of(VOID* interface, UINTN offset) {
+    return (LBL_MOCK_VOLUME*)((UINT8*)interface - offset);
+}
+
+static EFI_STATUS lbl_mock_check_disk_read(LBL_MOCK_VOLUME* volume, UINT32 MediaId, UINT64 Offset, UINTN Size,
+                                           VOID* Buffer) {
+    if (MediaId != volume->media.MediaId) {
+        return EFI_MEDIA_CHANGED;
+    }
+    if (Buffer == NULL || Offset + Size > volume->disk_blocks * LBL_MOCK_BLOCK_SIZE || Offset + Size < Offset) {
+        return EFI_INVALID_PARAMETER;
+    }
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_read_blocks(EFI_BLOCK_IO* This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize,
+                                              VOID* Buffer) {
+    LBL_MOCK_VOLUME* volume = lbl_mock_volume_of(This, offsetof(LBL_MOCK_VOLUME, block_io));
+    EFI_STATUS status;
+
+    lbl_mock_enter(LblMockReadBlocks);
+    if (BufferSize % LBL_MOCK_BLOCK_SIZE != 0) {
+        lbl_mock_leave();
+        return EFI_BAD_BUFFER_SIZE;
+    }
+    if (volume->media.IoAlign > 1 && (UINTN)Buffer % volume->media.IoAlign != 0) {
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER;
+    }
+    status = lbl_mock_check_disk_read(volume, MediaId, Lba * LBL_MOCK_BLOCK_SIZE, BufferSize, Buffer);
+    if (!EFI_ERROR(status)) {
+        memcpy(Buffer, lbl_mock_block(volume, Lba), BufferSize);
+        lbl_mock_stats.device_bytes += BufferSize;
+        lbl_mock_device_sync(volume, lbl_mock_config.Latency.disk_op_ns +
+                                     lbl_mock_transfer_ns(BufferSize, lbl_mock_config.Latency.disk_ns_per_mib));
+    }
+    lbl_mock_leave();
+    return status;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_read_disk(EFI_DISK_IO* This, UINT32 MediaId, UINT64 Offset, UINTN BufferSize,
+                                            VOID* Buffer) {
+    LBL_MOCK_VOLUME* volume = lbl_mock_volume_of(This, offsetof(LBL_MOCK_VOLUME, disk_io));
+    EFI_STATUS status;
+
+    lbl_mock_enter(LblMockReadDisk);
+    status = lbl_mock_check_disk_read(volume, MediaId, Offset, BufferSize, Buffer);
+    if (!EFI_ERROR(status)) {
+        memcpy(Buffer, volume->disk + Offset, BufferSize);
+        lbl_mock_stats.device_bytes += BufferSize;
+        lbl_mock_device_sync(volume, lbl_mock_config.Latency.disk_op_ns +
+                                     lbl_mock_transfer_ns(BufferSize, lbl_mock_config.Latency.disk_ns_per_mib));
+    }
+    lbl_mock_leave();
+    return status;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_read_disk_ex(EFI_DISK_IO2* This, UINT32 MediaId, UINT64 Offset,
+                                               EFI_DISK_IO2_TOKEN* Token, UINTN BufferSize, VOID* Buffer) {
+    LBL_MOCK_VOLUME* volume = lbl_mock_volume_of(This, offsetof(LBL_MOCK_VOLUME, disk_io2));
+    UINT64 cost = lbl_mock_config.Latency.disk_op_ns +
+                  lbl_mock_transfer_ns(BufferSize, lbl_mock_config.Latency.disk_ns_per_mib);
+    EFI_STATUS status;
+
+    lbl_mock_enter(LblMockReadDiskEx);
+    status = lbl_mock_check_disk_read(volume, MediaId, Offset, BufferSize, Buffer);
+    if (!EFI_ERROR(status)) {
+        // The data lands now; the loader may only rely on it once the event fires.
+        memcpy(Buffer, volume->disk + Offset, BufferSize);
+        lbl_mock_stats.device_bytes += BufferSize;
+        if (Token != NULL && Token->Event != NULL) {
+            Token->TransactionStatus = EFI_SUCCESS;
+            lbl_mock_signal_at(Token->Event, lbl_mock_device_async(volume, cost));
+        } else {
+            lbl_mock_device_sync(volume, cost);
+        }
+    }
+    lbl_mock_leave();
+    return status;
+}
+
+// --- Files ---
+
+static EFI_STATUS EFIAPI lbl_mock_file_open(EFI_FILE_PROTOCOL* File, EFI_FILE_PROTOCOL** NewHandle,
+                                            CHAR16* FileName, UINT64 OpenMode, UINT64 Attributes);
+static EFI_STATUS EFIAPI lbl_mock_file_close(EFI_FILE_PROTOCOL* File);
+static EFI_STATUS EFIAPI lbl_mock_file_read(EFI_FILE_PROTOCOL* File, UINTN* BufferSize, VOID* Buffer);
+static EFI_STATUS EFIAPI lbl_mock_file_read_ex(EFI_FILE_PROTOCOL* File, EFI_FILE_IO_TOKEN* Token);
+static EFI_STATUS EFIAPI lbl_mock_file_get_info(EFI_FILE_PROTOCOL* File, EFI_GUID* InformationType,
+                                                UINTN* BufferSize, VOID* Buffer);
+static EFI_STATUS EFIAPI lbl_mock_file_set_position(EFI_FILE_PROTOCOL* File, UINT64 Position);
+static EFI_STATUS EFIAPI lbl_mock_file_get_position(EFI_FILE_PROTOCOL* File, UINT64* Position);
+
+static EFI_FILE_PROTOCOL* lbl_mock_open_handle(LBL_MOCK_VOLUME* volume, LBL_MOCK_FILE* file) {
+    LBL_MOCK_OPEN_FILE* open = calloc(1, sizeof(*open));
+
+    if (open == NULL) {
+        return NULL;
+    }
+    open->protocol.Revision = volume->config.read_ex ? EFI_FILE_PROTOCOL_REVISION2 : EFI_FILE_PROTOCOL_REVISION;
+    open->protocol.Open = lbl_mock_file_open;
+    open->protocol.Close = lbl_mock_file_close;
+    open->protocol.Read = lbl_mock_file_read;
+    open->protocol.GetInfo = lbl_mock_file_get_info;
+    open->protocol.SetPosition = lbl_mock_file_set_position;
+    open->protocol.GetPosition = lbl_mock_file_get_position;
+    open->protocol.ReadEx = volume->config.read_ex ? lbl_mock_file_read_ex : NULL;
+    open->volume = volume;
+    open->file = file;
+    return &open->protocol;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_open_volume(EFI_SIMPLE_FILE_SYSTEM_PROTOCOL* This, EFI_FILE_PROTOCOL** Root) {
+    LBL_MOCK_VOLUME* volume = lbl_mock_volume_of(This, offsetof(LBL_MOCK_VOLUME, fs));
+
+    lbl_mock_enter(LblMockOpenVolume);
+    lbl_mock_device_sync(volume, lbl_mock_config.Latency.open_volume_ns);
+    *Root = lbl_mock_open_handle(volume, NULL);
+    lbl_mock_leave();
+    return *Root != NULL ? EFI_SUCCESS : EFI_OUT_OF_RESOURCES;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_file_open(EFI_FILE_PROTOCOL* File, EFI_FILE_PROTOCOL** NewHandle,
+                                            CHAR16* FileName, UINT64 OpenMode, UINT64 Attributes) {
+    LBL_MOCK_OPEN_FILE* dir = (LBL_MOCK_OPEN_FILE*)File;
+    LBL_MOCK_FILE* found = NULL;
+    UINT32 i;
+
+    (VOID)Attributes;
+    lbl_mock_enter(LblMockFileOpen);
+    lbl_mock_device_sync(dir->volume, lbl_mock_config.Latency.fs_open_ns);
+    if (NewHandle == NULL || FileName == NULL || dir->file != NULL) {
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER; // Only absolute opens from the root are modelled
+    }
+    if (OpenMode != EFI_FILE_MODE_READ) {
+        lbl_mock_leave();
+        return EFI_WRITE_PROTECTED;
+    }
+    for (i = 0; i < dir->volume->file_count; i++) {
+        if (lbl_mock_str_eq(dir->volume->files[i].path, FileName, TRUE)) {
+            found = &dir->volume->files[i];
+            break;
+        }
+    }
+    if (found == NULL) {
+        lbl_mock_leave();
+        return EFI_NOT_FOUND;
+    }
+    *NewHandle = lbl_mock_open_handle(dir->volume, found);
+    lbl_mock_leave();
+    return *NewHandle != NULL ? EFI_SUCCESS : EFI_OUT_OF_RESOURCES;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_file_close(EFI_FILE_PROTOCOL* File) {
+    lbl_mock_enter(LblMockFileClose);
+    free(File);
+    lbl_mock_leave();
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Copies file bytes out of the blocks they are scattered over.
+ */
+static VOID lbl_mock_copy_file(LBL_MOCK_VOLUME* volume, CONST LBL_MOCK_FILE* file, UINT64 offset, UINT8* dst,
+                               UINTN length) {
+    UINT64 run_start = 0;
+    UINT32 i;
+
+    for (i = 0; i < file->run_count && length != 0; i++) {
+        UINT64 run_bytes = file->runs[i].blocks * LBL_MOCK_BLOCK_SIZE;
+        if (offset < run_start + run_bytes) {
+            UINT64 within = offset - run_start;
+            UINTN n = (UINTN)((run_bytes - within) < length ? (run_bytes - within) : length);
+            memcpy(dst, lbl_mock_block(volume, file->runs[i].lba) + within, n);
+            dst += n;
+            offset += n;
+            length -= n;
+        }
+        run_start += run_bytes;
+    }
+}
+
+/**
+ * @brief Reads at the file position; returns the device time the read costs.
+ */
+static UINT64 lbl_mock_file_transfer(LBL_MOCK_OPEN_FILE* open, UINTN* size, VOID* buffer) {
+    UINT64 left = open->file->size > open->position ? open->file->size - open->position : 0;
+    UINTN n = *size < left ? *size : (UINTN)left;
+
+    lbl_mock_copy_file(open->volume, open->file, open->position, buffer, n);
+    open->position += n;
+    *size = n;
+    lbl_mock_stats.device_bytes += n;
+    return lbl_mock_config.Latency.fs_read_op_ns + lbl_mock_transfer_ns(n, lbl_mock_config.Latency.fs_ns_per_mib);
+}
+
+static EFI_STATUS EFIAPI lbl_mock_file_read(EFI_FILE_PROTOCOL* File, UINTN* BufferSize, VOID* Buffer) {
+    LBL_MOCK_OPEN_FILE* open = (LBL_MOCK_OPEN_FILE*)File;
+
+    lbl_mock_enter(LblMockFileRead);
+    if (open->file == NULL || BufferSize == NULL || (Buffer == NULL && *BufferSize != 0)) {
+        lbl_mock_leave();
+        return open->file == NULL ? EFI_UNSUPPORTED : EFI_INVALID_PARAMETER; // Directory listing not modelled
+    }
+    lbl_mock_device_sync(open->volume, lbl_mock_file_transfer(open, BufferSize, Buffer));
+    lbl_mock_leave();
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_file_read_ex(EFI_FILE_PROTOCOL* File, EFI_FILE_IO_TOKEN* Token) {
+    LBL_MOCK_OPEN_FILE* open = (LBL_MOCK_OPEN_FILE*)File;
+    UINT64 cost;
+
+    lbl_mock_enter(LblMockFileReadEx);
+    if (open->file == NULL || Token == NULL || Token->Buffer == NULL) {
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER;
+    }
+    cost = lbl_mock_file_transfer(open, &Token->BufferSize, Token->Buffer);
+    Token->Status = EFI_SUCCESS;
+    if (Token->Event != NULL) {
+        lbl_mock_signal_at(Token->Event, lbl_mock_device_async(open->volume, cost));
+    } else {
+        lbl_mock_device_sync(open->volume, cost);
+    }
+    lbl_mock_leave();
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_file_get_info(EFI_FILE_PROTOCOL* File, EFI_GUID* InformationType,
+                                                UINTN* BufferSize, VOID* Buffer) {
+    LBL_MOCK_OPEN_FILE* open = (LBL_MOCK_OPEN_FILE*)File;
+    EFI_FILE_INFO* info = (EFI_FILE_INFO*)Buffer;
+    CONST CHAR16* name;
+    UINTN name_bytes, needed;
+
+    lbl_mock_enter(LblMockFileGetInfo);
+    lbl_mock_charge(lbl_mock_config.Latency.fs_read_op_ns);
+    if (InformationType == NULL || BufferSize == NULL || !lbl_mock_guid_is(InformationType, &gEfiFileInfoGuid)) {
+        lbl_mock_leave();
+        return EFI_UNSUPPORTED;
+    }
+    name = open->file != NULL ? open->file->path : L"\\";
+    name_bytes = (lbl_mock_str_len(name) + 1) * sizeof(CHAR16);
+    needed = offsetof(EFI_FILE_INFO, FileName) + name_bytes;
+    if (*BufferSize < needed || Buffer == NULL) {
+        *BufferSize = needed;
+        lbl_mock_leave();
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    memset(info, 0, needed);
+    info->Size = needed;
+    info->FileSize = open->file != NULL ? open->file->size : 0;
+    info->PhysicalSize = (info->FileSize + LBL_MOCK_BLOCK_SIZE - 1) & ~(UINT64)(LBL_MOCK_BLOCK_SIZE - 1);
+    info->Attribute = open->file != NULL ? EFI_FILE_READ_ONLY : EFI_FILE_DIRECTORY;
+    memcpy(info->FileName, name, name_bytes);
+    *BufferSize = needed;
+    lbl_mock_leave();
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_file_set_position(EFI_FILE_PROTOCOL* File, UINT64 Position) {
+    LBL_MOCK_OPEN_FILE* open = (LBL_MOCK_OPEN_FILE*)File;
+
+    lbl_mock_enter(LblMockFileSetPosition);
+    if (open->file != NULL) {
+        open->position = Position == UINT64_MAX ? open->file->size : Position;
+    }
+    lbl_mock_leave();
+    return open->file != NULL || Position == 0 ? EFI_SUCCESS : EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_file_get_position(EFI_FILE_PROTOCOL* File, UINT64* Position) {
+    LBL_MOCK_OPEN_FILE* open = (LBL_MOCK_OPEN_FILE*)File;
+
+    lbl_mock_enter(LblMockFileGetPosition);
+    *Position = open->position;
+    lbl_mock_leave();
+    return open->file != NULL ? EFI_SUCCESS : EFI_UNSUPPORTED;
+}
+
+// --- HTTP ---
+
+static EFI_STATUS EFIAPI lbl_mock_http_configure(LBL_MOCK_HTTP* This, VOID* HttpConfigData);
+static EFI_STATUS EFIAPI lbl_mock_http_request(LBL_MOCK_HTTP* This, VOID* Token);
+static EFI_STATUS EFIAPI lbl_mock_http_cancel(LBL_MOCK_HTTP* This, VOID* Token);
+static EFI_STATUS EFIAPI lbl_mock_http_response(LBL_MOCK_HTTP* This, VOID* Token);
+static EFI_STATUS EFIAPI lbl_mock_http_poll(LBL_MOCK_HTTP* This);
+
+static EFI_STATUS EFIAPI lbl_mock_create_child(LBL_MOCK_SERVICE_BINDING* This, EFI_HANDLE* ChildHandle) {
+    UINT32 i;
+
+    lbl_mock_enter(LblMockCreateChild);
+    lbl_mock_charge(lbl_mock_config.Latency.alloc_ns);
+    if (This != &lbl_mock_nic.binding || ChildHandle == NULL) {
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER;
+    }
+    for (i = 0; i < LBL_MOCK_MAX_HTTP_CHILDREN; i++) {
+        LBL_MOCK_HTTP_CHILD* child = &lbl_mock_nic.children[i];
+        if (!child->live) {
+            memset(child, 0, sizeof(*child));
+            child->live = TRUE;
+            child->http.Configure = lbl_mock_http_configure;
+            child->http.Request = lbl_mock_http_request;
+            child->http.Cancel = lbl_mock_http_cancel;
+            child->http.Response = lbl_mock_http_response;
+            child->http.Poll = lbl_mock_http_poll;
+            *ChildHandle = child;
+            lbl_mock_leave();
+            return EFI_SUCCESS;
+        }
+    }
+    lbl_mock_leave();
+    return EFI_OUT_OF_RESOURCES;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_destroy_child(LBL_MOCK_SERVICE_BINDING* This, EFI_HANDLE ChildHandle) {
+    LBL_MOCK_HTTP_CHILD* child = lbl_mock_http_child(ChildHandle);
+
+    lbl_mock_enter(LblMockDestroyChild);
+    lbl_mock_charge(lbl_mock_config.Latency.alloc_ns);
+    if (This != &lbl_mock_nic.binding || child == NULL) {
+        lbl_mock_fault("DestroyChild of a handle that is not a live HTTP child");
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER;
+    }
+    child->live = FALSE;
+    lbl_mock_leave();
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_http_configure(LBL_MOCK_HTTP* This, VOID* HttpConfigData) {
+    LBL_MOCK_HTTP_CHILD* child = lbl_mock_http_child(This);
+
+    lbl_mock_enter(LblMockHttpConfigure);
+    if (child == NULL) {
+        lbl_mock_fault("HTTP call on a destroyed child");
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER;
+    }
+    child->configured = HttpConfigData != NULL;
+    lbl_mock_leave();
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_http_request(LBL_MOCK_HTTP* This, VOID* Token) {
+    LBL_MOCK_HTTP_CHILD* child = lbl_mock_http_child(This);
+    EFI_STATUS status;
+
+    lbl_mock_enter(LblMockHttpRequest);
+    if (child == NULL || Token == NULL) {
+        lbl_mock_leave();
+        return EFI_INVALID_PARAMETER;
+    }
+    if (!child->configured) {
+        lbl_mock_leave();
+        return EFI_NOT_STARTED;
+    }
+    // HttpDxe connects inside Request, so a dead server fails it synchronously.
+    lbl_mock_stats.wait_ns += lbl_mock_config.Latency.http_connect_ns;
+    status = lbl_mock_nic.config.connect_status;
+    lbl_mock_leave();
+    return status;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_http_cancel(LBL_MOCK_HTTP* This, VOID* Token) {
+    (VOID)This;
+    (VOID)Token;
+    lbl_mock_enter(LblMockHttpCancel);
+    lbl_mock_leave();
+    return EFI_NOT_FOUND; // No request ever got through
+}
+
+static EFI_STATUS EFIAPI lbl_mock_http_response(LBL_MOCK_HTTP* This, VOID* Token) {
+    (VOID)This;
+    (VOID)Token;
+    lbl_mock_enter(LblMockHttpResponse);
+    lbl_mock_leave();
+    return EFI_NOT_STARTED;
+}
+
+static EFI_STATUS EFIAPI lbl_mock_http_poll(LBL_MOCK_HTTP* This) {
+    (VOID)This;
+    lbl_mock_enter(LblMockHttpPoll);
+    lbl_mock_leave();
+    return EFI_NOT_STARTED;
+}
+
+// --- Building the machine ---
+
+VOID lbl_mock_default_config(LBL_MOCK_CONFIG* config) {
+    memset(config, 0, sizeof(*config));
+    config->Latency.call_ns = 150;
+    config->Latency.handle_protocol_ns = 400;
+    config->Latency.locate_ns_per_handle = 250;
+    config->Latency.alloc_ns = 1500;
+    config->Latency.memory_map_ns_per_descriptor = 60;
+    config->Latency.exit_boot_services_ns = 2000000;
+    config->Latency.nvram_read_ns = 20000;
+    config->Latency.nvram_write_ns = 4000000;
+    config->Latency.console_ns_per_char = 87000;           // 10 bits at 115200 baud
+    config->Latency.open_volume_ns = 300000;
+    config->Latency.fs_open_ns = 60000;
+    config->Latency.fs_read_op_ns = 25000;
+    config->Latency.fs_ns_per_mib = 4000000;               // ~250 MiB/s through the FAT driver
+    config->Latency.disk_op_ns = 15000;
+    config->Latency.disk_ns_per_mib = 600000;              // ~1.6 GiB/s raw
+    config->Latency.http_connect_ns = 3000000;             // SYN sent, RST back from the server
+    config->MemoryMap.base_descriptors = 96;
+}
+
+static VOID lbl_mock_free_machine(VOID) {
+    UINT32 i;
+
+    for (i = 0; i < lbl_mock_volume_count; i++) {
+        free(lbl_mock_volumes[i].disk);
+    }
+    for (i = 0; i < lbl_mock_page_block_count; i++) {
+        free(lbl_mock_page_blocks[i].host);
+    }
+    for (i = 0; i < lbl_mock_pool_count; i++) {
+        free(lbl_mock_pools[i].host);
+    }
+    (VOID)lbl_mock_free_events;
+}
+
+EFI_SYSTEM_TABLE* lbl_mock_reset(CONST LBL_MOCK_CONFIG* config, EFI_HANDLE* image_handle) {
+    lbl_mock_free_machine();
+    memset(lbl_mock_volumes, 0, sizeof(lbl_mock_volumes));
+    memset(lbl_mock_variables, 0, sizeof(lbl_mock_variables));
+    memset(&lbl_mock_nic, 0, sizeof(lbl_mock_nic));
+    memset(&lbl_mock_stats, 0, sizeof(lbl_mock_stats));
+    lbl_mock_volume_count = 0;
+    lbl_mock_page_block_count = 0;
+    lbl_mock_pool_count = 0;
+    lbl_mock_config = *config;
+    lbl_mock_map_key = 1;
+    lbl_mock_churn_descriptors = 0;
+    lbl_mock_churn_left = config->MemoryMap.churn_rounds;
+    lbl_mock_exited = FALSE;
+    lbl_mock_exit_failed = FALSE;
+    lbl_mock_running = FALSE;
+
+    memset(&lbl_mock_boot_services, 0, sizeof(lbl_mock_boot_services));
+    lbl_mock_boot_services.AllocatePages = lbl_mock_allocate_pages;
+    lbl_mock_boot_services.FreePages = lbl_mock_free_pages;
+    lbl_mock_boot_services.GetMemoryMap = lbl_mock_get_memory_map;
+    lbl_mock_boot_services.AllocatePool = lbl_mock_allocate_pool;
+    lbl_mock_boot_services.FreePool = lbl_mock_free_pool;
+    lbl_mock_boot_services.CreateEvent = lbl_mock_create_event;
+    lbl_mock_boot_services.SetTimer = lbl_mock_set_timer;
+    lbl_mock_boot_services.WaitForEvent = lbl_mock_wait_for_event;
+    lbl_mock_boot_services.CloseEvent = lbl_mock_close_event;
+    lbl_mock_boot_services.CheckEvent = lbl_mock_check_event;
+    lbl_mock_boot_services.HandleProtocol = lbl_mock_handle_protocol;
+    lbl_mock_boot_services.LocateDevicePath = lbl_mock_locate_device_path;
+    lbl_mock_boot_services.ExitBootServices = lbl_mock_exit_boot_services;
+    lbl_mock_boot_services.Stall = lbl_mock_stall;
+    lbl_mock_boot_services.LocateHandleBuffer = lbl_mock_locate_handle_buffer;
+    lbl_mock_boot_services.LocateProtocol = lbl_mock_locate_protocol;
+    lbl_mock_boot_services.CalculateCrc32 = lbl_mock_calculate_crc32;
+    lbl_mock_boot_services.CopyMem = lbl_mock_copy_mem;
+    lbl_mock_boot_services.SetMem = lbl_mock_set_mem;
+
+    memset(&lbl_mock_runtime_services, 0, sizeof(lbl_mock_runtime_services));
+    lbl_mock_runtime_services.GetVariable = lbl_mock_get_variable_service;
+    lbl_mock_runtime_services.SetVariable = lbl_mock_set_variable_service;
+    lbl_mock_runtime_services.ResetSystem = lbl_mock_reset_system;
+
+    memset(&lbl_mock_con_out, 0, sizeof(lbl_mock_con_out));
+    lbl_mock_con_out.OutputString = lbl_mock_output_string;
+
+    memset(&lbl_mock_system_table, 0, sizeof(lbl_mock_system_table));
+    lbl_mock_system_table.ConOut = &lbl_mock_con_out;
+    lbl_mock_system_table.BootServices = &lbl_mock_boot_services;
+    lbl_mock_system_table.RuntimeServices = &lbl_mock_runtime_services;
+
+    memset(&lbl_mock_loaded_image, 0, sizeof(lbl_mock_loaded_image));
+    lbl_mock_loaded_image.SystemTable = &lbl_mock_system_table;
+
+    ST = &lbl_mock_system_table;
+    BS = &lbl_mock_boot_services;
+    RS = &lbl_mock_runtime_services;
+    IH = (EFI_HANDLE)&lbl_mock_image_handle;
+    if (image_handle != NULL) {
+        *image_handle = IH;
+    }
+    return &lbl_mock_system_table;
+}
+
+static UINT8* lbl_mock_put_node(UINT8* at, UINT8 type, UINT8 sub_type, UINT16 length) {
+    memset(at, 0, length);
+    at[0] = type;
+    at[1] = sub_type;
+    at[2] = (UINT8)length;
+    at[3] = (UINT8)(length >> 8);
+    return at + length;
+}
+
+EFI_HANDLE lbl_mock_add_volume(CONST LBL_MOCK_VOLUME_CONFIG* config, BOOLEAN boot) {
+    LBL_MOCK_VOLUME* volume;
+    UINT32 index = lbl_mock_volume_count;
+    UINT8* at;
+
+    if (lbl_mock_volume_count == LBL_MOCK_MAX_VOLUMES) {
+        return NULL;
+    }
+    volume = &lbl_mock_volumes[lbl_mock_volume_count++];
+    volume->config = *config;
+    volume->fs.Revision = 0x00010000;
+    volume->fs.OpenVolume = lbl_mock_open_volume;
+    volume->media.MediaId = 0x100 + index;
+    volume->media.RemovableMedia = config->kind == LblMockVolumeRemovable;
+    volume->media.MediaPresent = TRUE;
+    volume->media.LogicalPartition = TRUE;
+    volume->media.ReadOnly = TRUE;
+    volume->media.BlockSize = LBL_MOCK_BLOCK_SIZE;
+    volume->media.IoAlign = 4;
+    volume->block_io.Revision = 0x00010000;
+    volume->block_io.Media = &volume->media;
+    volume->block_io.ReadBlocks = lbl_mock_read_blocks;
+    volume->disk_io.Revision = 0x00010000;
+    volume->disk_io.ReadDisk = lbl_mock_read_disk;
+    volume->disk_io2.Revision = 0x00020000;
+    volume->disk_io2.ReadDiskEx = lbl_mock_read_disk_ex;
+
+    // PciRoot(0)/Pci(index,0)/[Sata|USB]/HD(partition) - unique per volume.
+    at = lbl_mock_put_node(volume->device_path, ACPI_DEVICE_PATH, ACPI_DP, 12);
+    volume->device_path[4] = 0xD0; // EISA PNP0A03
+    volume->device_path[5] = 0x41;
+    volume->device_path[6] = 0x03;
+    volume->device_path[7] = 0x0A;
+    at = lbl_mock_put_node(at, HARDWARE_DEVICE_PATH, HW_PCI_DP, 6);
+    at[-1] = (UINT8)(index / 8);
+    at[-2] = (UINT8)(index % 8);
+    if (config->kind == LblMockVolumeRemovable) {
+        at = lbl_mock_put_node(at, MESSAGING_DEVICE_PATH, MSG_USB_DP, 6);
+    } else {
+        at = lbl_mock_put_node(at, MESSAGING_DEVICE_PATH, MSG_SATA_DP, 10);
+    }
+    at = lbl_mock_put_node(at, MEDIA_DEVICE_PATH, MEDIA_HARDDRIVE_DP, 42);
+    at[-42 + 4] = (UINT8)(1 + index);
+    lbl_mock_put_node(at, END_DEVICE_PATH_TYPE, END_ENTIRE_DEVICE_PATH_SUBTYPE, 4);
+
+    if (boot && lbl_mock_loaded_image.DeviceHandle == NULL) {
+        lbl_mock_loaded_image.DeviceHandle = volume;
+        lbl_mock_loaded_image.FilePath = (EFI_DEVICE_PATH*)volume->device_path;
+    }
+    return volume;
+}
+
+EFI_HANDLE lbl_mock_add_nic(CONST LBL_MOCK_NIC_CONFIG* nic) {
+    if (lbl_mock_nic.present) {
+        return NULL;
+    }
+    lbl_mock_nic.present = TRUE;
+    lbl_mock_nic.config = *nic;
+    lbl_mock_nic.binding.CreateChild = lbl_mock_create_child;
+    lbl_mock_nic.binding.DestroyChild = lbl_mock_destroy_child;
+    return &lbl_mock_nic;
+}
+
+static UINT64 lbl_mock_grow_disk(LBL_MOCK_VOLUME* volume, UINT64 blocks) {
+    UINT64 lba = volume->disk_blocks;
+    UINT8* disk = realloc(volume->disk, (size_t)((lba + blocks) * LBL_MOCK_BLOCK_SIZE));
+
+    if (disk == NULL) {
+        return UINT64_MAX;
+    }
+    memset(disk + lba * LBL_MOCK_BLOCK_SIZE, 0, (size_t)(blocks * LBL_MOCK_BLOCK_SIZE));
+    volume->disk = disk;
+    volume->disk_blocks = lba + blocks;
+    volume->media.LastBlock = volume->disk_blocks - 1;
+    return lba;
+}
+
+EFI_STATUS lbl_mock_add_file(EFI_HANDLE Volume, CONST CHAR16* path, CONST VOID* data, UINT64 size, UINT32 extents) {
+    LBL_MOCK_VOLUME* volume = lbl_mock_volume(Volume);
+    LBL_MOCK_FILE* file;
+    UINT64 blocks = (size + LBL_MOCK_BLOCK_SIZE - 1) / LBL_MOCK_BLOCK_SIZE;
+    UINT64 placed = 0;
+    UINT32 i;
+
+    if (volume == NULL || volume->file_count == LBL_MOCK_MAX_FILES || lbl_mock_str_len(path) >= LBL_MOCK_MAX_PATH ||
+        extents == 0 || extents > LBL_MOCK_MAX_FILE_EXTENTS) {
+        return EFI_OUT_OF_RESOURCES;
+    }
+    if (blocks < extents) {
+        extents = blocks != 0 ? (UINT32)blocks : 1;
+    }
+    file = &volume->files[volume->file_count];
+    memset(file, 0, sizeof(*file));
+    memcpy(file->path, path, (lbl_mock_str_len(path) + 1) * sizeof(CHAR16));
+    file->size = size;
+    // Equal runs with a free block after each, so no two of them are adjacent.
+    for (i = 0; i < extents && blocks != 0; i++) {
+        UINT64 run = i + 1 == extents ? blocks - placed : blocks / extents;
+        UINT64 lba = lbl_mock_grow_disk(volume, run + 1);
+        if (lba == UINT64_MAX) {
+            return EFI_OUT_OF_RESOURCES;
+        }
+        file->runs[i].lba = lba;
+        file->runs[i].blocks = run;
+        memcpy(volume->disk + lba * LBL_MOCK_BLOCK_SIZE, (CONST UINT8*)data + placed * LBL_MOCK_BLOCK_SIZE,
+               (size_t)((placed + run) * LBL_MOCK_BLOCK_SIZE <= size ? run * LBL_MOCK_BLOCK_SIZE
+                                                                     : size - placed * LBL_MOCK_BLOCK_SIZE));
+        placed += run;
+        file->run_count++;
+    }
+    volume->file_count++;
+    return EFI_SUCCESS;
+}
+
+// Same layout as LBL_EXTENT_MAP_HEADER / LBL_EXTENT in stage1_loader_utils.h.
+typedef struct {
+    UINT64 magic;
+    UINT32 header_size;
+    UINT32 block_size;
+    UINT64 file_size;
+    UINT32 extent_count;
+    UINT32 file_crc32;
+    UINT32 map_crc32;
+    UINT32 reserved;
+} LBL_MOCK_EXTENT_MAP_HEADER;
+
+EFI_STATUS lbl_mock_add_extent_map(EFI_HANDLE Volume, CONST CHAR16* file_path, CONST CHAR16* map_path) {
+    LBL_MOCK_VOLUME* volume = lbl_mock_volume(Volume);
+    LBL_MOCK_EXTENT_MAP_HEADER* header;
+    LBL_MOCK_FILE* file = NULL;
+    UINT8* contents;
+    UINT8* map;
+    UINTN map_size;
+    EFI_STATUS status;
+    UINT32 i;
+
+    for (i = 0; volume != NULL && i < volume->file_count; i++) {
+        if (lbl_mock_str_eq(volume->files[i].path, file_path, TRUE)) {
+            file = &volume->files[i];
+        }
+    }
+    if (file == NULL) {
+        return EFI_NOT_FOUND;
+    }
+    map_size = sizeof(*header) + file->run_count * sizeof(LBL_MOCK_RUN);
+    map = calloc(1, map_size);
+    contents = malloc(file->size ? (size_t)file->size : 1);
+    if (map == NULL || contents == NULL) {
+        free(map);
+        free(contents);
+        return EFI_OUT_OF_RESOURCES;
+    }
+    lbl_mock_copy_file(volume, file, 0, contents, (UINTN)file->size);
+    header = (LBL_MOCK_EXTENT_MAP_HEADER*)map;
+    header->magic = 0x4C424C4558544D31ull; // LBL_EXTENT_MAP_MAGIC
+    header->header_size = sizeof(*header);
+    header->block_size = LBL_MOCK_BLOCK_SIZE;
+    header->file_size = file->size;
+    header->extent_count = file->run_count;
+    header->file_crc32 = lbl_mock_crc32(contents, (UINTN)file->size);
+    memcpy(map + sizeof(*header), file->runs, file->run_count * sizeof(LBL_MOCK_RUN));
+    header->map_crc32 = lbl_mock_crc32(map, map_size);
+    status = lbl_mock_add_file(Volume, map_path, map, map_size, 1);
+    free(map);
+    free(contents);
+    return status;
+}
+
+EFI_STATUS lbl_mock_set_variable(CONST CHAR16* name, CONST EFI_GUID* guid, CONST VOID* data, UINTN size) {
+    return lbl_mock_store_variable(name, guid, EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS, data,
+                                   size);
+}
+
+UINTN lbl_mock_get_variable(CONST CHAR16* name, CONST EFI_GUID* guid, VOID* data, UINTN size) {
+    LBL_MOCK_VARIABLE* v = lbl_mock_find_variable(name, guid);
+
+    if (v == NULL) {
+        return 0;
+    }
+    memcpy(data, v->data, v->size < size ? v->size : size);
+    return v->size;
+}
+
+VOID lbl_mock_begin(VOID) {
+    UINT64 live = lbl_mock_stats.live_bytes;
+
+    memset(&lbl_mock_stats, 0, sizeof(lbl_mock_stats));
+    lbl_mock_stats.live_bytes = live; // Whatever the setup left allocated stays accounted
+    lbl_mock_stats.peak_bytes = live;
+    lbl_mock_running = TRUE;
+    lbl_mock_host_mark = lbl_mock_host_ns();
+}
+
+VOID lbl_mock_end(LBL_MOCK_STATS* stats) {
+    if (lbl_mock_running) {
+        lbl_mock_stats.cpu_ns += lbl_mock_host_ns() - lbl_mock_host_mark;
+        lbl_mock_running = FALSE;
+    }
+    *stats = lbl_mock_stats;
+}
+
+CONST CHAR8* lbl_mock_call_name(LBL_MOCK_CALL call) {
+    return call < LblMockCallCount ? lbl_mock_call_names[call] : "?";
+}
+
+// --- gnu-efi library ---
+
+VOID InitializeLib(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE* SystemTable) {
+    (VOID)ImageHandle;
+    (VOID)SystemTable;
+}
+
+INTN CompareMem(CONST VOID* Dest, CONST VOID* Src, UINTN Len) {
+    return memcmp(Dest, Src, Len);
+}
+
+INTN CompareGuid(CONST EFI_GUID* Guid1, CONST EFI_GUID* Guid2) {
+    // Non-zero if equal, as LblUefi.c uses it (gnu-efi 4 / EDK2 semantics).
+    return memcmp(Guid1, Guid2, sizeof(EFI_GUID)) == 0;
+}
+
+EFI_DEVICE_PATH* DevicePathFromHandle(EFI_HANDLE Handle) {
+    LBL_MOCK_VOLUME* volume = lbl_mock_volume(Handle);
+
+    lbl_mock_enter(LblMockHandleProtocol); // gnu-efi asks for the DevicePath protocol
+    lbl_mock_charge(lbl_mock_config.Latency.handle_protocol_ns);
+    lbl_mock_leave();
+    return volume != NULL ? (EFI_DEVICE_PATH*)volume->device_path : NULL;
+}
+
+UINTN DevicePathSize(CONST EFI_DEVICE_PATH* DevPath) {
+    CONST EFI_DEVICE_PATH* node = DevPath;
+
+    while (!IsDevicePathEnd(node)) {
+        node = NextDevicePathNode(node);
+    }
+    return (UINTN)((CONST UINT8*)node - (CONST UINT8*)DevPath) + sizeof(EFI_DEVICE_PATH);
+}
+
+static CONST CHAR8* lbl_mock_status_text(EFI_STATUS status) {
+    static CONST CHAR8* errors[] = {
+        "Success", "Load Error", "Invalid Parameter", "Unsupported", "Bad Buffer Size", "Buffer Too Small",
+        "Not Ready", "Device Error", "Write Protected", "Out of Resources", "Volume Corrupt", "Volume Full",
+        "No Media", "Media changed", "Not Found", "Access Denied", "No Response", "No mapping", "Time out",
+        "Not started", "Already started", "Aborted", "ICMP Error", "TFTP Error", "Protocol Error",
+        "Incompatible Version", "Security Violation", "CRC Error", "End of Media", "Reserved (29)",
+        "Reserved (30)", "End of File", "Invalid Language", "Compromised Data", "Reserved (34)", "HTTP Error",
+    };
+    UINTN code = status & ~EFI_MAX_BIT;
+
+    if (status == EFI_SUCCESS) {
+        return errors[0];
+    }
+    if (EFI_ERROR(status) && code < sizeof(errors) / sizeof(errors[0])) {
+        return errors[code];
+    }
+    return EFI_ERROR(status) ? "Unknown error" : "Warning";
+}
+
+typedef struct {
+    CHAR16* out;
+    UINTN used;
+    UINTN capacity;                 // CHAR16s, NUL included
+} LBL_MOCK_PRINT;
+
+static VOID lbl_mock_print_char(LBL_MOCK_PRINT* p, CHAR16 c) {
+    if (p->used + 1 < p->capacity) {
+        p->out[p->used++] = c;
+    }
+}
+
+static VOID lbl_mock_print_padded(LBL_MOCK_PRINT* p, CONST CHAR8* text, UINTN width, CHAR8 pad, BOOLEAN left) {
+    UINTN n = strlen(text);
+
+    while (!left && n < width--) {
+        lbl_mock_print_char(p, (CHAR16)pad);
+    }
+    while (*text) {
+        lbl_mock_print_char(p, (CHAR16)(UINT8)*text++);
+    }
+    while (left && n < width--) {
+        lbl_mock_print_char(p, L' ');
+    }
+}
+
+UINTN VSPrint(CHAR16* Str, UINTN StrSize, CONST CHAR16* Format, va_list Args) {
+    LBL_MOCK_PRINT p = { Str, 0, StrSize / sizeof(CHAR16) };
+    CHAR8 text[32];
+
+    if (Str == NULL || p.capacity == 0) {
+        return 0;
+    }
+    while (*Format) {
+        BOOLEAN is_long = FALSE, left = FALSE;
+        CHAR8 pad = ' ';
+        UINTN width = 0;
+
+        if (*Format != L'%') {
+            lbl_mock_print_char(&p, *Format++);
+            continue;
+        }
+        Format++;
+        if (*Format == L'-') {
+            left = TRUE;
+            Format++;
+        }
+        if (*Format == L'0') {
+            pad = '0';
+            Format++;
+        }
+        while (*Format >= L'0' && *Format <= L'9') {
+            width = width * 10 + (*Format++ - L'0');
+        }
+        if (*Format == L'l') {
+            is_long = TRUE;
+            Format++;
+        }
+        switch (*Format) {
+        case L'd':
+            if (is_long) {
+                snprintf(text, sizeof(text), "%lld", (long long)va_arg(Args, INT64));
+            } else {
+                snprintf(text, sizeof(text), "%d", (int)va_arg(Args, INT32));
+            }
+            lbl_mock_print_padded(&p, text, width, pad, left);
+            break;
+        case L'u':
+        case L'x':
+        case L'X': {
+            // As gnu-efi: 32 bits unless 'l' is given.
+            UINT64 value = is_long ? va_arg(Args, UINT64) : va_arg(Args, UINT32);
+            snprintf(text, sizeof(text), *Format == L'u' ? "%llu" : (*Format == L'x' ? "%llx" : "%llX"),
+                     (unsigned long long)value);
+            lbl_mock_print_padded(&p, text, width, pad, left);
+            break;
+        }
+        case L'c':
+            lbl_mock_print_char(&p, (CHAR16)va_arg(Args, int));
+            break;
+        case L's': {
+            CONST CHAR16* s = va_arg(Args, CONST CHAR16*);
+            for (s = s ? s : L"(null)"; *s; s++) {
+                lbl_mock_print_char(&p, *s);
+            }
+            break;
+        }
+        case L'a': {
+            CONST CHAR8* s = va_arg(Args, CONST CHAR8*);
+            lbl_mock_print_padded(&p, s ? s : "(null)", width, ' ', left);
+            break;
+        }
+        case L'r':
+            lbl_mock_print_padded(&p, lbl_mock_status_text(va_arg(Args, EFI_STATUS)), width, ' ', left);
+            break;
+        case L'%':
+            lbl_mock_print_char(&p, L'%');
+            break;
+        case 0:
+            Format--; // Trailing '%'
+            break;
+        default:
+            lbl_mock_print_char(&p, L'%');
+            lbl_mock_print_char(&p, *Format);
+            break;
+        }
+        Format++;
+    }
+    p.out[p.used] = 0;
+    return p.used;
+}
+
+UINTN Print(CONST CHAR16* Format, ...) {
+    CHAR16 line[512];
+    va_list args;
+    UINTN n;
+
+    va_start(args, Format);
+    n = VSPrint(line, sizeof(line), Format, args);
+    va_end(args);
+    if (ST != NULL && ST->ConOut != NULL) {
+        ST->ConOut->OutputString(ST->ConOut, line);
+    }
+    return n;
+}
@@ -0,0 +1,210 @@
+// Lionbootloader - Stage 1 - Host Benchmark Mock Firmware
+// File: stage1/bench/lbl_mock_efi.h
+//
+// A simulated UEFI machine for measuring the Stage 1 load path on the host:
+// boot and runtime services, SimpleFileSystem volumes backed by an in-memory
+// disk with Block I/O, Disk I/O and Disk I/O 2 on the same blocks, NVRAM
+// variables, a NIC with an HTTP service binding and a synthetic memory map.
+// The loader code runs natively; every
+// firmware call is counted and charged a configured latency on a simulated
+// clock, and the host time spent in the loader between calls is added to it,
+// which gives the projected wall time of a scenario on that firmware.
+
+#ifndef LBL_MOCK_EFI_H
+#define LBL_MOCK_EFI_H
+
+#include <efi.h>
+#include <efilib.h>
+
+#define LBL_MOCK_MAX_VOLUMES        64
+#define LBL_MOCK_MAX_FILES          16      // Per volume
+#define LBL_MOCK_MAX_FILE_EXTENTS   64      // Runs a file may be scattered over
+#define LBL_MOCK_BLOCK_SIZE         512
+
+// Firmware timing. Calls that are pure CPU work on real firmware too (CopyMem,
+// SetMem, CalculateCrc32) are not modelled: they run on the host and are timed
+// as loader time. Latencies are in nanoseconds; throughputs in ns per MiB.
+typedef struct {
+    UINT64 call_ns;                 // Floor charged for every boot/runtime service call
+    UINT64 handle_protocol_ns;
+    UINT64 locate_ns_per_handle;    // LocateHandleBuffer / LocateDevicePath, per handle searched
+    UINT64 alloc_ns;                // AllocatePages / AllocatePool / Free*
+    UINT64 memory_map_ns_per_descriptor;
+    UINT64 exit_boot_services_ns;
+    UINT64 nvram_read_ns;
+    UINT64 nvram_write_ns;          // Flash writes: the slow one
+    UINT64 console_ns_per_char;     // ConOut (often a serial port behind it)
+    UINT64 open_volume_ns;
+    UINT64 fs_open_ns;              // Per Open, i.e. per directory walk in the FAT driver
+    UINT64 fs_read_op_ns;           // Per File.Read / ReadEx request
+    UINT64 fs_ns_per_mib;           // FAT driver throughput
+    UINT64 disk_op_ns;              // Per ReadDisk / ReadDiskEx / ReadBlocks request
+    UINT64 disk_ns_per_mib;         // Raw device throughput
+    UINT64 http_connect_ns;         // Per HTTP Request: the TCP connect it fails on
+} LBL_MOCK_LATENCY;
+
+// Memory map shape. Every page or pool allocation changes the map key and
+// grows the map, as on real firmware; churn models timer / USB / network
+// callbacks allocating between the loader's GetMemoryMap and ExitBootServices.
+typedef struct {
+    UINT32 base_descriptors;        // Descriptors before the loader allocates anything
+    UINT32 churn_rounds;            // First GetMemoryMap calls followed by a firmware allocation
+    UINT32 churn_growth;            // Descriptors each churn round adds
+} LBL_MOCK_MEMORY_MAP;
+
+typedef enum {
+    LblMockVolumeLocalEsp = 0,      // SATA disk partition with the ESP type GUID
+    LblMockVolumeLocalDisk,         // Same, other partition type
+    LblMockVolumeRemovable,         // USB stick
+} LBL_MOCK_VOLUME_KIND;
+
+typedef struct {
+    LBL_MOCK_VOLUME_KIND kind;
+    BOOLEAN read_ex;                // File protocol revision 2 (ReadEx)
+    BOOLEAN block_io;               // Block I/O on the partition (required by Disk I/O*)
+    BOOLEAN disk_io;
+    BOOLEAN disk_io2;
+} LBL_MOCK_VOLUME_CONFIG;
+
+// The NIC has no server behind it: every HTTP Request fails the way a TCP
+// connect does (EFI_TIMEOUT for no answer, EFI_ACCESS_DENIED for a refusal).
+typedef struct {
+    EFI_STATUS connect_status;
+} LBL_MOCK_NIC_CONFIG;
+
+typedef struct {
+    LBL_MOCK_LATENCY Latency;
+    LBL_MOCK_MEMORY_MAP MemoryMap;
+    BOOLEAN echo_console;           // Also print ConOut output to stderr
+} LBL_MOCK_CONFIG;
+
+// Call counters, one per firmware entry point.
+typedef enum {
+    LblMockAllocatePages,
+    LblMockFreePages,
+    LblMockGetMemoryMap,
+    LblMockAllocatePool,
+    LblMockFreePool,
+    LblMockCreateEvent,
+    LblMockSetTimer,
+    LblMockWaitForEvent,
+    LblMockCloseEvent,
+    LblMockCheckEvent,
+    LblMockHandleProtocol,
+    LblMockLocateDevicePath,
+    LblMockExitBootServices,
+    LblMockStall,
+    LblMockLocateHandleBuffer,
+    LblMockLocateProtocol,
+    LblMockCalculateCrc32,
+    LblMockCopyMem,
+    LblMockSetMem,
+    LblMockGetVariable,
+    LblMockSetVariable,
+    LblMockResetSystem,
+    LblMockOutputString,
+    LblMockOpenVolume,
+    LblMockFileOpen,
+    LblMockFileClose,
+    LblMockFileRead,
+    LblMockFileReadEx,
+    LblMockFileGetInfo,
+    LblMockFileSetPosition,
+    LblMockFileGetPosition,
+    LblMockReadBlocks,
+    LblMockReadDisk,
+    LblMockReadDiskEx,
+    LblMockCreateChild,
+    LblMockDestroyChild,
+    LblMockHttpConfigure,
+    LblMockHttpRequest,
+    LblMockHttpCancel,
+    LblMockHttpResponse,
+    LblMockHttpPoll,
+    LblMockCallCount
+} LBL_MOCK_CALL;
+
+typedef struct {
+    UINT64 calls[LblMockCallCount];
+    UINT64 page_allocations;        // Successful AllocatePages
+    UINT64 page_bytes;              // ...and their size
+    UINT64 pool_allocations;
+    UINT64 pool_bytes;
+    UINT64 live_bytes;              // Loader allocations not yet freed
+    UINT64 peak_bytes;
+    UINT64 device_bytes;            // Delivered by File.Read*/ReadDisk*/ReadBlocks
+    UINT64 copy_bytes;              // BS->CopyMem
+    UINT64 console_chars;
+    UINT64 exit_attempts;
+    UINT64 faults;                  // Calls real firmware would hang or fail on (see stderr)
+    UINT64 io_ns;                   // Simulated clock: modelled firmware time...
+    UINT64 wait_ns;                 // ...idle time in WaitForEvent / Stall...
+    UINT64 cpu_ns;                  // ...and host time spent in the loader
+} LBL_MOCK_STATS;
+
+/**
+ * @brief Typical desktop firmware: NVMe-class disk behind a FAT driver that
+ * costs a few µs per call, a 115200 baud console, on the order of 100 map entries.
+ */
+VOID lbl_mock_default_config(LBL_MOCK_CONFIG* config);
+
+/**
+ * @brief Resets the machine: no volumes, no variables, boot services up.
+ * Sets ST/BS/RS/IH and returns the system table and image handle efi_main would get.
+ */
+EFI_SYSTEM_TABLE* lbl_mock_reset(CONST LBL_MOCK_CONFIG* config, EFI_HANDLE* image_handle);
+
+/**
+ * @brief Adds a partition handle. The image's LoadedImage.DeviceHandle is the
+ * first volume added with `boot` set (none by default).
+ * @return The handle, or NULL if LBL_MOCK_MAX_VOLUMES is reached.
+ */
+EFI_HANDLE lbl_mock_add_volume(CONST LBL_MOCK_VOLUME_CONFIG* volume, BOOLEAN boot);
+
+/**
+ * @brief Adds the NIC handle: HTTP service binding, children with the HTTP
+ * protocol. There is one NIC at most.
+ * @return The handle, or NULL if there already is one.
+ */
+EFI_HANDLE lbl_mock_add_nic(CONST LBL_MOCK_NIC_CONFIG* nic);
+
+/**
+ * @brief Stores a file on a volume, scattered over `extents` runs of blocks
+ * (1 = contiguous) with a gap between runs. `data` is copied.
+ * @return EFI_OUT_OF_RESOURCES if a limit is reached.
+ */
+EFI_STATUS lbl_mock_add_file(EFI_HANDLE volume, CONST CHAR16* path, CONST VOID* data, UINT64 size, UINT32 extents);
+
+/**
+ * @brief Writes the LBL_EXTENT_MAP sidecar for a file added before, at `map_path`.
+ */
+EFI_STATUS lbl_mock_add_extent_map(EFI_HANDLE volume, CONST CHAR16* file_path, CONST CHAR16* map_path);
+
+/**
+ * @brief Sets an NVRAM variable without charging it to the scenario.
+ */
+EFI_STATUS lbl_mock_set_variable(CONST CHAR16* name, CONST EFI_GUID* guid, CONST VOID* data, UINTN size);
+
+/**
+ * @brief Copies a variable out (e.g. to check what the loader wrote).
+ * @return The variable's size, or 0 if it does not exist.
+ */
+UINTN lbl_mock_get_variable(CONST CHAR16* name, CONST EFI_GUID* guid, VOID* data, UINTN size);
+
+/**
+ * @brief Zeroes the counters and the simulated clock; starts the host clock.
+ */
+VOID lbl_mock_begin(VOID);
+
+/**
+ * @brief Stops the clock (charging the loader time since the last call) and
+ * returns the counters.
+ */
+VOID lbl_mock_end(LBL_MOCK_STATS* stats);
+
+/**
+ * @brief Display name of a counter.
+ */
+CONST CHAR8* lbl_mock_call_name(LBL_MOCK_CALL call);
+
+#endif // LBL_MOCK_EFI_H
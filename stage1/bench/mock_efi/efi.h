@@ -0,0 +1,578 @@
+// Lionbootloader - Stage 1 - Host Benchmark Mock Firmware
+// File: stage1/bench/mock_efi/efi.h
+//
+// Stand-in for gnu-efi's <efi.h> when Stage 1 is built as a host program
+// (make bench_host). Declares only what LblUefi.c and the UEFI branch of
+// stage1_loader_utils.c use, with gnu-efi's names and layouts. Every service is
+// implemented by lbl_mock_efi.c, which counts the calls and charges them to a
+// simulated firmware clock. Requires -fshort-wchar so L"" literals are CHAR16.
+
+#ifndef LBL_MOCK_GNU_EFI_H
+#define LBL_MOCK_GNU_EFI_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Base types ---
+typedef uint8_t     UINT8;
+typedef int8_t      INT8;
+typedef uint16_t    UINT16;
+typedef int16_t     INT16;
+typedef uint32_t    UINT32;
+typedef int32_t     INT32;
+typedef uint64_t    UINT64;
+typedef int64_t     INT64;
+typedef uintptr_t   UINTN;
+typedef intptr_t    INTN;
+typedef uint8_t     BOOLEAN;
+typedef char        CHAR8;
+typedef uint16_t    CHAR16;
+typedef void        VOID;
+
+#define CONST       const
+#define IN
+#define OUT
+#define OPTIONAL
+#define EFIAPI
+#define TRUE        ((BOOLEAN)1)
+#define FALSE       ((BOOLEAN)0)
+#ifndef NULL
+#define NULL        ((VOID*)0)
+#endif
+
+typedef UINTN       EFI_STATUS;
+typedef VOID*       EFI_HANDLE;
+typedef VOID*       EFI_EVENT;
+typedef UINTN       EFI_TPL;
+typedef UINT64      EFI_LBA;
+typedef UINT64      EFI_PHYSICAL_ADDRESS;
+typedef UINT64      EFI_VIRTUAL_ADDRESS;
+
+typedef struct {
+    UINT32 Data1;
+    UINT16 Data2;
+    UINT16 Data3;
+    UINT8  Data4[8];
+} EFI_GUID;
+
+typedef struct {
+    UINT8 Addr[4];
+} EFI_IPv4_ADDRESS;
+
+typedef struct {
+    UINT8 Addr[16];
+} EFI_IPv6_ADDRESS;
+
+typedef union {
+    UINT32           Addr[4];
+    EFI_IPv4_ADDRESS v4;
+    EFI_IPv6_ADDRESS v6;
+} EFI_IP_ADDRESS;
+
+typedef struct {
+    UINT8 Addr[32];
+} EFI_MAC_ADDRESS;
+
+typedef struct {
+    UINT16 Year;
+    UINT8  Month, Day, Hour, Minute, Second, Pad1;
+    UINT32 Nanosecond;
+    INT16  TimeZone;
+    UINT8  Daylight, Pad2;
+} EFI_TIME;
+
+// --- Status codes ---
+#define EFI_MAX_BIT             ((UINTN)1 << (sizeof(UINTN) * 8 - 1))
+#define EFIERR(a)               (EFI_MAX_BIT | (a))
+#define EFI_ERROR(a)            (((INTN)(a)) < 0)
+
+#define EFI_SUCCESS             0
+#define EFI_LOAD_ERROR          EFIERR(1)
+#define EFI_INVALID_PARAMETER   EFIERR(2)
+#define EFI_UNSUPPORTED         EFIERR(3)
+#define EFI_BAD_BUFFER_SIZE     EFIERR(4)
+#define EFI_BUFFER_TOO_SMALL    EFIERR(5)
+#define EFI_NOT_READY           EFIERR(6)
+#define EFI_DEVICE_ERROR        EFIERR(7)
+#define EFI_WRITE_PROTECTED     EFIERR(8)
+#define EFI_OUT_OF_RESOURCES    EFIERR(9)
+#define EFI_VOLUME_CORRUPTED    EFIERR(10)
+#define EFI_VOLUME_FULL         EFIERR(11)
+#define EFI_NO_MEDIA            EFIERR(12)
+#define EFI_MEDIA_CHANGED       EFIERR(13)
+#define EFI_NOT_FOUND           EFIERR(14)
+#define EFI_ACCESS_DENIED       EFIERR(15)
+#define EFI_NO_RESPONSE         EFIERR(16)
+#define EFI_NO_MAPPING          EFIERR(17)
+#define EFI_TIMEOUT             EFIERR(18)
+#define EFI_NOT_STARTED         EFIERR(19)
+#define EFI_ALREADY_STARTED     EFIERR(20)
+#define EFI_ABORTED             EFIERR(21)
+#define EFI_ICMP_ERROR          EFIERR(22)
+#define EFI_TFTP_ERROR          EFIERR(23)
+#define EFI_PROTOCOL_ERROR      EFIERR(24)
+#define EFI_INCOMPATIBLE_VERSION EFIERR(25)
+#define EFI_SECURITY_VIOLATION  EFIERR(26)
+#define EFI_CRC_ERROR           EFIERR(27)
+#define EFI_END_OF_MEDIA        EFIERR(28)
+#define EFI_END_OF_FILE         EFIERR(31)
+#define EFI_INVALID_LANGUAGE    EFIERR(32)
+#define EFI_COMPROMISED_DATA    EFIERR(33)
+#define EFI_HTTP_ERROR          EFIERR(35)
+
+#define EFI_WARN_UNKNOWN_GLYPH  1
+#define EFI_WARN_DELETE_FAILURE 2
+#define EFI_WARN_WRITE_FAILURE  3
+#define EFI_WARN_BUFFER_TOO_SMALL 4
+
+// --- Memory ---
+#define EFI_PAGE_SIZE           4096
+#define EFI_PAGE_MASK           0xFFF
+#define EFI_PAGE_SHIFT          12
+#define EFI_SIZE_TO_PAGES(a)    (((a) >> EFI_PAGE_SHIFT) + (((a) & EFI_PAGE_MASK) ? 1 : 0))
+#define EFI_PAGES_TO_SIZE(a)    ((a) << EFI_PAGE_SHIFT)
+
+typedef enum {
+    AllocateAnyPages,
+    AllocateMaxAddress,
+    AllocateAddress,
+    MaxAllocateType
+} EFI_ALLOCATE_TYPE;
+
+typedef enum {
+    EfiReservedMemoryType,
+    EfiLoaderCode,
+    EfiLoaderData,
+    EfiBootServicesCode,
+    EfiBootServicesData,
+    EfiRuntimeServicesCode,
+    EfiRuntimeServicesData,
+    EfiConventionalMemory,
+    EfiUnusableMemory,
+    EfiACPIReclaimMemory,
+    EfiACPIMemoryNVS,
+    EfiMemoryMappedIO,
+    EfiMemoryMappedIOPortSpace,
+    EfiPalCode,
+    EfiPersistentMemory,
+    EfiUnacceptedMemoryType,
+    EfiMaxMemoryType
+} EFI_MEMORY_TYPE;
+
+#define EFI_MEMORY_UC           0x0000000000000001ULL
+#define EFI_MEMORY_WC           0x0000000000000002ULL
+#define EFI_MEMORY_WT           0x0000000000000004ULL
+#define EFI_MEMORY_WB           0x0000000000000008ULL
+#define EFI_MEMORY_UCE          0x0000000000000010ULL
+#define EFI_MEMORY_WP           0x0000000000001000ULL
+#define EFI_MEMORY_RP           0x0000000000002000ULL
+#define EFI_MEMORY_XP           0x0000000000004000ULL
+#define EFI_MEMORY_RO           0x0000000000020000ULL
+#define EFI_MEMORY_RUNTIME      0x8000000000000000ULL
+
+#define EFI_MEMORY_DESCRIPTOR_VERSION 1
+typedef struct {
+    UINT32               Type;
+    UINT32               Pad;
+    EFI_PHYSICAL_ADDRESS PhysicalStart;
+    EFI_VIRTUAL_ADDRESS  VirtualStart;
+    UINT64               NumberOfPages;
+    UINT64               Attribute;
+} EFI_MEMORY_DESCRIPTOR;
+
+typedef struct {
+    UINT32 Version;
+    UINT32 NumberOfEntries;
+    UINT32 DescriptorSize;
+    UINT32 Reserved;
+    // EFI_MEMORY_DESCRIPTOR Entry[NumberOfEntries] follows
+} EFI_MEMORY_ATTRIBUTES_TABLE;
+
+// --- Device paths ---
+typedef struct _EFI_DEVICE_PATH {
+    UINT8 Type;
+    UINT8 SubType;
+    UINT8 Length[2];
+} EFI_DEVICE_PATH;
+typedef EFI_DEVICE_PATH EFI_DEVICE_PATH_PROTOCOL;
+
+#define HARDWARE_DEVICE_PATH        0x01
+#define ACPI_DEVICE_PATH            0x02
+#define MESSAGING_DEVICE_PATH       0x03
+#define MEDIA_DEVICE_PATH           0x04
+#define BBS_DEVICE_PATH             0x05
+#define END_DEVICE_PATH_TYPE        0x7F
+#define END_ENTIRE_DEVICE_PATH_SUBTYPE 0xFF
+#define END_INSTANCE_DEVICE_PATH_SUBTYPE 0x01
+
+#define HW_PCI_DP                   0x01
+#define ACPI_DP                     0x01
+#define MSG_ATAPI_DP                0x01
+#define MSG_SCSI_DP                 0x02
+#define MSG_USB_DP                  0x05
+#define MSG_MAC_ADDR_DP             0x0B
+#define MSG_IPv4_DP                 0x0C
+#define MSG_IPv6_DP                 0x0D
+#define MSG_USB_CLASS_DP            0x0F
+#define MSG_SATA_DP                 0x12
+#define MSG_NVME_NAMESPACE_DP       0x17
+#define MEDIA_HARDDRIVE_DP          0x01
+#define MEDIA_CDROM_DP              0x02
+#define MEDIA_FILEPATH_DP           0x04
+
+// --- Events and timers ---
+#define EVT_TIMER                   0x80000000
+#define EVT_RUNTIME                 0x40000000
+#define EVT_NOTIFY_WAIT             0x00000100
+#define EVT_NOTIFY_SIGNAL           0x00000200
+#define TPL_APPLICATION             4
+#define TPL_CALLBACK                8
+#define TPL_NOTIFY                  16
+#define TPL_HIGH_LEVEL              31
+
+typedef VOID (EFIAPI *EFI_EVENT_NOTIFY)(EFI_EVENT Event, VOID* Context);
+
+typedef enum {
+    TimerCancel,
+    TimerPeriodic,
+    TimerRelative
+} EFI_TIMER_DELAY;
+
+typedef enum {
+    AllHandles,
+    ByRegisterNotify,
+    ByProtocol
+} EFI_LOCATE_SEARCH_TYPE;
+
+typedef enum {
+    EfiResetCold,
+    EfiResetWarm,
+    EfiResetShutdown,
+    EfiResetPlatformSpecific
+} EFI_RESET_TYPE;
+
+#define EFI_VARIABLE_NON_VOLATILE       0x00000001
+#define EFI_VARIABLE_BOOTSERVICE_ACCESS 0x00000002
+#define EFI_VARIABLE_RUNTIME_ACCESS     0x00000004
+
+// --- Tables ---
+typedef struct {
+    UINT64 Signature;
+    UINT32 Revision;
+    UINT32 HeaderSize;
+    UINT32 CRC32;
+    UINT32 Reserved;
+} EFI_TABLE_HEADER;
+
+typedef struct _EFI_BOOT_SERVICES EFI_BOOT_SERVICES;
+typedef struct _EFI_RUNTIME_SERVICES EFI_RUNTIME_SERVICES;
+typedef struct _SIMPLE_TEXT_OUTPUT_INTERFACE SIMPLE_TEXT_OUTPUT_INTERFACE;
+typedef SIMPLE_TEXT_OUTPUT_INTERFACE EFI_SIMPLE_TEXT_OUT_PROTOCOL;
+
+struct _SIMPLE_TEXT_OUTPUT_INTERFACE {
+    EFI_STATUS (EFIAPI *Reset)(SIMPLE_TEXT_OUTPUT_INTERFACE* This, BOOLEAN ExtendedVerification);
+    EFI_STATUS (EFIAPI *OutputString)(SIMPLE_TEXT_OUTPUT_INTERFACE* This, CHAR16* String);
+};
+
+typedef struct {
+    EFI_GUID VendorGuid;
+    VOID*    VendorTable;
+} EFI_CONFIGURATION_TABLE;
+
+typedef struct {
+    EFI_TABLE_HEADER              Hdr;
+    CHAR16*                       FirmwareVendor;
+    UINT32                        FirmwareRevision;
+    EFI_HANDLE                    ConsoleInHandle;
+    VOID*                         ConIn;
+    EFI_HANDLE                    ConsoleOutHandle;
+    SIMPLE_TEXT_OUTPUT_INTERFACE* ConOut;
+    EFI_HANDLE                    StandardErrorHandle;
+    SIMPLE_TEXT_OUTPUT_INTERFACE* StdErr;
+    EFI_RUNTIME_SERVICES*         RuntimeServices;
+    EFI_BOOT_SERVICES*            BootServices;
+    UINTN                         NumberOfTableEntries;
+    EFI_CONFIGURATION_TABLE*      ConfigurationTable;
+} EFI_SYSTEM_TABLE;
+
+struct _EFI_BOOT_SERVICES {
+    EFI_TABLE_HEADER Hdr;
+    EFI_TPL (EFIAPI *RaiseTPL)(EFI_TPL NewTpl);
+    VOID (EFIAPI *RestoreTPL)(EFI_TPL OldTpl);
+    EFI_STATUS (EFIAPI *AllocatePages)(EFI_ALLOCATE_TYPE Type, EFI_MEMORY_TYPE MemoryType, UINTN Pages,
+                                       EFI_PHYSICAL_ADDRESS* Memory);
+    EFI_STATUS (EFIAPI *FreePages)(EFI_PHYSICAL_ADDRESS Memory, UINTN Pages);
+    EFI_STATUS (EFIAPI *GetMemoryMap)(UINTN* MemoryMapSize, EFI_MEMORY_DESCRIPTOR* MemoryMap, UINTN* MapKey,
+                                      UINTN* DescriptorSize, UINT32* DescriptorVersion);
+    EFI_STATUS (EFIAPI *AllocatePool)(EFI_MEMORY_TYPE PoolType, UINTN Size, VOID** Buffer);
+    EFI_STATUS (EFIAPI *FreePool)(VOID* Buffer);
+    EFI_STATUS (EFIAPI *CreateEvent)(UINT32 Type, EFI_TPL NotifyTpl, EFI_EVENT_NOTIFY NotifyFunction,
+                                     VOID* NotifyContext, EFI_EVENT* Event);
+    EFI_STATUS (EFIAPI *SetTimer)(EFI_EVENT Event, EFI_TIMER_DELAY Type, UINT64 TriggerTime);
+    EFI_STATUS (EFIAPI *WaitForEvent)(UINTN NumberOfEvents, EFI_EVENT* Event, UINTN* Index);
+    EFI_STATUS (EFIAPI *SignalEvent)(EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *CloseEvent)(EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *CheckEvent)(EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *HandleProtocol)(EFI_HANDLE Handle, EFI_GUID* Protocol, VOID** Interface);
+    EFI_STATUS (EFIAPI *LocateDevicePath)(EFI_GUID* Protocol, EFI_DEVICE_PATH** DevicePath, EFI_HANDLE* Device);
+    EFI_STATUS (EFIAPI *ExitBootServices)(EFI_HANDLE ImageHandle, UINTN MapKey);
+    EFI_STATUS (EFIAPI *Stall)(UINTN Microseconds);
+    EFI_STATUS (EFIAPI *LocateHandleBuffer)(EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID* Protocol, VOID* SearchKey,
+                                            UINTN* NoHandles, EFI_HANDLE** Buffer);
+    EFI_STATUS (EFIAPI *LocateProtocol)(EFI_GUID* Protocol, VOID* Registration, VOID** Interface);
+    EFI_STATUS (EFIAPI *CalculateCrc32)(VOID* Data, UINTN DataSize, UINT32* Crc32);
+    VOID (EFIAPI *CopyMem)(VOID* Destination, VOID* Source, UINTN Length);
+    VOID (EFIAPI *SetMem)(VOID* Buffer, UINTN Size, UINT8 Value);
+};
+
+struct _EFI_RUNTIME_SERVICES {
+    EFI_TABLE_HEADER Hdr;
+    EFI_STATUS (EFIAPI *GetVariable)(CHAR16* VariableName, EFI_GUID* VendorGuid, UINT32* Attributes,
+                                     UINTN* DataSize, VOID* Data);
+    EFI_STATUS (EFIAPI *SetVariable)(CHAR16* VariableName, EFI_GUID* VendorGuid, UINT32 Attributes,
+                                     UINTN DataSize, VOID* Data);
+    VOID (EFIAPI *ResetSystem)(EFI_RESET_TYPE ResetType, EFI_STATUS ResetStatus, UINTN DataSize, VOID* ResetData);
+};
+
+// --- Loaded image ---
+typedef struct {
+    UINT32            Revision;
+    EFI_HANDLE        ParentHandle;
+    EFI_SYSTEM_TABLE* SystemTable;
+    EFI_HANDLE        DeviceHandle;
+    EFI_DEVICE_PATH*  FilePath;
+    VOID*             Reserved;
+    UINT32            LoadOptionsSize;
+    VOID*             LoadOptions;
+    VOID*             ImageBase;
+    UINT64            ImageSize;
+    EFI_MEMORY_TYPE   ImageCodeType;
+    EFI_MEMORY_TYPE   ImageDataType;
+} EFI_LOADED_IMAGE;
+
+// --- Files ---
+#define EFI_FILE_MODE_READ          0x0000000000000001ULL
+#define EFI_FILE_MODE_WRITE         0x0000000000000002ULL
+#define EFI_FILE_MODE_CREATE        0x8000000000000000ULL
+#define EFI_FILE_READ_ONLY          0x0000000000000001ULL
+#define EFI_FILE_DIRECTORY          0x0000000000000010ULL
+#define EFI_FILE_PROTOCOL_REVISION  0x00010000
+#define EFI_FILE_PROTOCOL_REVISION2 0x00020000
+
+typedef struct {
+    UINT64   Size;
+    UINT64   FileSize;
+    UINT64   PhysicalSize;
+    EFI_TIME CreateTime;
+    EFI_TIME LastAccessTime;
+    EFI_TIME ModificationTime;
+    UINT64   Attribute;
+    CHAR16   FileName[1];
+} EFI_FILE_INFO;
+
+typedef struct {
+    EFI_EVENT  Event;
+    EFI_STATUS Status;
+    UINTN      BufferSize;
+    VOID*      Buffer;
+} EFI_FILE_IO_TOKEN;
+
+typedef struct _EFI_FILE_HANDLE EFI_FILE_PROTOCOL;
+typedef EFI_FILE_PROTOCOL* EFI_FILE_HANDLE;
+typedef EFI_FILE_PROTOCOL EFI_FILE;
+
+struct _EFI_FILE_HANDLE {
+    UINT64 Revision;
+    EFI_STATUS (EFIAPI *Open)(EFI_FILE_PROTOCOL* File, EFI_FILE_PROTOCOL** NewHandle, CHAR16* FileName,
+                              UINT64 OpenMode, UINT64 Attributes);
+    EFI_STATUS (EFIAPI *Close)(EFI_FILE_PROTOCOL* File);
+    EFI_STATUS (EFIAPI *Delete)(EFI_FILE_PROTOCOL* File);
+    EFI_STATUS (EFIAPI *Read)(EFI_FILE_PROTOCOL* File, UINTN* BufferSize, VOID* Buffer);
+    EFI_STATUS (EFIAPI *Write)(EFI_FILE_PROTOCOL* File, UINTN* BufferSize, VOID* Buffer);
+    EFI_STATUS (EFIAPI *GetPosition)(EFI_FILE_PROTOCOL* File, UINT64* Position);
+    EFI_STATUS (EFIAPI *SetPosition)(EFI_FILE_PROTOCOL* File, UINT64 Position);
+    EFI_STATUS (EFIAPI *GetInfo)(EFI_FILE_PROTOCOL* File, EFI_GUID* InformationType, UINTN* BufferSize, VOID* Buffer);
+    EFI_STATUS (EFIAPI *SetInfo)(EFI_FILE_PROTOCOL* File, EFI_GUID* InformationType, UINTN BufferSize, VOID* Buffer);
+    EFI_STATUS (EFIAPI *Flush)(EFI_FILE_PROTOCOL* File);
+    EFI_STATUS (EFIAPI *OpenEx)(EFI_FILE_PROTOCOL* File, EFI_FILE_PROTOCOL** NewHandle, CHAR16* FileName,
+                                UINT64 OpenMode, UINT64 Attributes, EFI_FILE_IO_TOKEN* Token);
+    EFI_STATUS (EFIAPI *ReadEx)(EFI_FILE_PROTOCOL* File, EFI_FILE_IO_TOKEN* Token);
+    EFI_STATUS (EFIAPI *WriteEx)(EFI_FILE_PROTOCOL* File, EFI_FILE_IO_TOKEN* Token);
+    EFI_STATUS (EFIAPI *FlushEx)(EFI_FILE_PROTOCOL* File, EFI_FILE_IO_TOKEN* Token);
+};
+
+typedef struct _EFI_FILE_IO_INTERFACE EFI_SIMPLE_FILE_SYSTEM_PROTOCOL;
+typedef EFI_SIMPLE_FILE_SYSTEM_PROTOCOL EFI_FILE_IO_INTERFACE;
+struct _EFI_FILE_IO_INTERFACE {
+    UINT64 Revision;
+    EFI_STATUS (EFIAPI *OpenVolume)(EFI_SIMPLE_FILE_SYSTEM_PROTOCOL* This, EFI_FILE_PROTOCOL** Root);
+};
+
+// --- Block and disk I/O ---
+typedef struct {
+    UINT32  MediaId;
+    BOOLEAN RemovableMedia;
+    BOOLEAN MediaPresent;
+    BOOLEAN LogicalPartition;
+    BOOLEAN ReadOnly;
+    BOOLEAN WriteCaching;
+    UINT32  BlockSize;
+    UINT32  IoAlign;
+    EFI_LBA LastBlock;
+} EFI_BLOCK_IO_MEDIA;
+
+typedef struct _EFI_BLOCK_IO EFI_BLOCK_IO;
+typedef EFI_BLOCK_IO EFI_BLOCK_IO_PROTOCOL;
+struct _EFI_BLOCK_IO {
+    UINT64              Revision;
+    EFI_BLOCK_IO_MEDIA* Media;
+    EFI_STATUS (EFIAPI *Reset)(EFI_BLOCK_IO* This, BOOLEAN ExtendedVerification);
+    EFI_STATUS (EFIAPI *ReadBlocks)(EFI_BLOCK_IO* This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID* Buffer);
+    EFI_STATUS (EFIAPI *WriteBlocks)(EFI_BLOCK_IO* This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID* Buffer);
+    EFI_STATUS (EFIAPI *FlushBlocks)(EFI_BLOCK_IO* This);
+};
+
+typedef struct _EFI_DISK_IO EFI_DISK_IO;
+typedef EFI_DISK_IO EFI_DISK_IO_PROTOCOL;
+struct _EFI_DISK_IO {
+    UINT64 Revision;
+    EFI_STATUS (EFIAPI *ReadDisk)(EFI_DISK_IO* This, UINT32 MediaId, UINT64 Offset, UINTN BufferSize, VOID* Buffer);
+    EFI_STATUS (EFIAPI *WriteDisk)(EFI_DISK_IO* This, UINT32 MediaId, UINT64 Offset, UINTN BufferSize, VOID* Buffer);
+};
+
+typedef struct {
+    EFI_EVENT  Event;
+    EFI_STATUS TransactionStatus;
+} EFI_DISK_IO2_TOKEN;
+
+typedef struct _EFI_DISK_IO2 EFI_DISK_IO2;
+typedef EFI_DISK_IO2 EFI_DISK_IO2_PROTOCOL;
+struct _EFI_DISK_IO2 {
+    UINT64 Revision;
+    EFI_STATUS (EFIAPI *Cancel)(EFI_DISK_IO2* This);
+    EFI_STATUS (EFIAPI *ReadDiskEx)(EFI_DISK_IO2* This, UINT32 MediaId, UINT64 Offset, EFI_DISK_IO2_TOKEN* Token,
+                                    UINTN BufferSize, VOID* Buffer);
+    EFI_STATUS (EFIAPI *WriteDiskEx)(EFI_DISK_IO2* This, UINT32 MediaId, UINT64 Offset, EFI_DISK_IO2_TOKEN* Token,
+                                     UINTN BufferSize, VOID* Buffer);
+    EFI_STATUS (EFIAPI *FlushDiskEx)(EFI_DISK_IO2* This, EFI_DISK_IO2_TOKEN* Token);
+};
+
+// --- Graphics output ---
+typedef struct {
+    UINT32 RedMask;
+    UINT32 GreenMask;
+    UINT32 BlueMask;
+    UINT32 ReservedMask;
+} EFI_PIXEL_BITMASK;
+
+typedef enum {
+    PixelRedGreenBlueReserved8BitPerColor,
+    PixelBlueGreenRedReserved8BitPerColor,
+    PixelBitMask,
+    PixelBltOnly,
+    PixelFormatMax
+} EFI_GRAPHICS_PIXEL_FORMAT;
+
+typedef struct {
+    UINT32                    Version;
+    UINT32                    HorizontalResolution;
+    UINT32                    VerticalResolution;
+    EFI_GRAPHICS_PIXEL_FORMAT PixelFormat;
+    EFI_PIXEL_BITMASK         PixelInformation;
+    UINT32                    PixelsPerScanLine;
+} EFI_GRAPHICS_OUTPUT_MODE_INFORMATION;
+
+typedef struct {
+    UINT32                                MaxMode;
+    UINT32                                Mode;
+    EFI_GRAPHICS_OUTPUT_MODE_INFORMATION* Info;
+    UINTN                                 SizeOfInfo;
+    EFI_PHYSICAL_ADDRESS                  FrameBufferBase;
+    UINTN                                 FrameBufferSize;
+} EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE;
+
+typedef struct _EFI_GRAPHICS_OUTPUT_PROTOCOL EFI_GRAPHICS_OUTPUT_PROTOCOL;
+struct _EFI_GRAPHICS_OUTPUT_PROTOCOL {
+    EFI_STATUS (EFIAPI *QueryMode)(EFI_GRAPHICS_OUTPUT_PROTOCOL* This, UINT32 ModeNumber, UINTN* SizeOfInfo,
+                                   EFI_GRAPHICS_OUTPUT_MODE_INFORMATION** Info);
+    EFI_STATUS (EFIAPI *SetMode)(EFI_GRAPHICS_OUTPUT_PROTOCOL* This, UINT32 ModeNumber);
+    VOID* Blt;
+    EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE* Mode;
+};
+
+// --- PXE base code (the parts a PXE-booted loader reads back) ---
+#define EFI_PXE_BASE_CODE_PROTOCOL_GUID \
+    { 0x03c4e603, 0xac28, 0x11d3, { 0x9a, 0x2d, 0x00, 0x90, 0x27, 0x3f, 0xc1, 0x4d } }
+
+typedef struct {
+    UINT8  BootpOpcode;
+    UINT8  BootpHwType;
+    UINT8  BootpHwAddrLen;
+    UINT8  BootpGateHops;
+    UINT32 BootpIdent;
+    UINT16 BootpSeconds;
+    UINT16 BootpFlags;
+    UINT8  BootpCiAddr[4];
+    UINT8  BootpYiAddr[4];
+    UINT8  BootpSiAddr[4];
+    UINT8  BootpGiAddr[4];
+    UINT8  BootpHwAddr[16];
+    UINT8  BootpSrvName[64];
+    UINT8  BootpBootFile[128];
+    UINT32 DhcpMagik;
+    UINT8  DhcpOptions[56];
+} EFI_PXE_BASE_CODE_DHCPV4_PACKET;
+
+typedef union {
+    UINT8                           Raw[1472];
+    EFI_PXE_BASE_CODE_DHCPV4_PACKET Dhcpv4;
+} EFI_PXE_BASE_CODE_PACKET;
+
+typedef struct {
+    BOOLEAN                  Started;
+    BOOLEAN                  Ipv6Available;
+    BOOLEAN                  Ipv6Supported;
+    BOOLEAN                  UsingIpv6;
+    BOOLEAN                  BisSupported;
+    BOOLEAN                  BisDetected;
+    BOOLEAN                  AutoArp;
+    BOOLEAN                  SendGUID;
+    BOOLEAN                  DhcpDiscoverValid;
+    BOOLEAN                  DhcpAckReceived;
+    BOOLEAN                  ProxyOfferReceived;
+    BOOLEAN                  PxeDiscoverValid;
+    BOOLEAN                  PxeReplyReceived;
+    BOOLEAN                  PxeBisReplyReceived;
+    BOOLEAN                  IcmpErrorReceived;
+    BOOLEAN                  TftpErrorReceived;
+    BOOLEAN                  MakeCallbacks;
+    UINT8                    TTL;
+    UINT8                    ToS;
+    EFI_IP_ADDRESS           StationIp;
+    EFI_IP_ADDRESS           SubnetMask;
+    EFI_PXE_BASE_CODE_PACKET DhcpDiscover;
+    EFI_PXE_BASE_CODE_PACKET DhcpAck;
+    EFI_PXE_BASE_CODE_PACKET ProxyOffer;
+    EFI_PXE_BASE_CODE_PACKET PxeDiscover;
+    EFI_PXE_BASE_CODE_PACKET PxeReply;
+} EFI_PXE_BASE_CODE_MODE;
+
+typedef struct {
+    UINT64                  Revision;
+    VOID*                   Start;
+    VOID*                   Stop;
+    VOID*                   Dhcp;
+    VOID*                   Discover;
+    VOID*                   Mtftp;
+    VOID*                   UdpWrite;
+    VOID*                   UdpRead;
+    VOID*                   SetIpFilter;
+    VOID*                   Arp;
+    VOID*                   SetParameters;
+    VOID*                   SetStationIp;
+    VOID*                   SetPackets;
+    EFI_PXE_BASE_CODE_MODE* Mode;
+} EFI_PXE_BASE_CODE_PROTOCOL;
+
+#endif // LBL_MOCK_GNU_EFI_H
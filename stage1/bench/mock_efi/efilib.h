@@ -0,0 +1,34 @@
+// Lionbootloader - Stage 1 - Host Benchmark Mock Firmware
+// File: stage1/bench/mock_efi/efilib.h
+//
+// The gnu-efi library calls Stage 1 uses, implemented by lbl_mock_efi.c.
+
+#ifndef LBL_MOCK_GNU_EFILIB_H
+#define LBL_MOCK_GNU_EFILIB_H
+
+#include "efi.h"
+
+extern EFI_GUID gEfiBlockIoProtocolGuid;
+extern EFI_GUID gEfiDiskIoProtocolGuid;
+extern EFI_GUID gEfiFileInfoGuid;
+extern EFI_GUID gEfiGraphicsOutputProtocolGuid;
+extern EFI_GUID gEfiLoadedImageProtocolGuid;
+extern EFI_GUID gEfiSimpleFileSystemProtocolGuid;
+
+VOID InitializeLib(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE* SystemTable);
+UINTN Print(CONST CHAR16* Format, ...);
+UINTN VSPrint(CHAR16* Str, UINTN StrSize, CONST CHAR16* Format, va_list Args);
+INTN CompareMem(CONST VOID* Dest, CONST VOID* Src, UINTN Len);
+INTN CompareGuid(CONST EFI_GUID* Guid1, CONST EFI_GUID* Guid2);
+
+EFI_DEVICE_PATH* DevicePathFromHandle(EFI_HANDLE Handle);
+UINTN DevicePathSize(CONST EFI_DEVICE_PATH* DevPath);
+
+#define DevicePathType(a)           (((a)->Type) & 0x7F)
+#define DevicePathSubType(a)        ((a)->SubType)
+#define DevicePathNodeLength(a)     ((UINTN)(((a)->Length[0]) | ((a)->Length[1] << 8)))
+#define NextDevicePathNode(a)       ((EFI_DEVICE_PATH*)(((UINT8*)(a)) + DevicePathNodeLength(a)))
+#define IsDevicePathEndType(a)      (DevicePathType(a) == END_DEVICE_PATH_TYPE)
+#define IsDevicePathEnd(a)          (IsDevicePathEndType(a) && DevicePathSubType(a) == END_ENTIRE_DEVICE_PATH_SUBTYPE)
+
+#endif // LBL_MOCK_GNU_EFILIB_H
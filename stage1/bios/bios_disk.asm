@@ -0,0 +1,384 @@
+; Lionbootloader - Stage 1 - BIOS Core Reader (bios_disk.asm)
+; File: stage1/bios/bios_disk.asm
+; Purpose: Reads the LBL Core with as few INT 13h extended reads as the BIOS allows
+;          and places it at its final address above 1 MiB. Also the protected-mode
+;          read thunk behind the sector cache (lbl_bios_disk_read).
+;          %included by boot_32.asm: 16-bit code, data addressed through DS = CS.
+;
+; With EDD 3.0 64-bit flat buffer addresses (checked by reading one sector both
+; ways) the BIOS writes straight to the final address. Otherwise each chunk lands
+; in a bounce buffer below 1 MiB and is copied up through unreal mode (FS with a
+; 4 GiB limit). The largest sector count the BIOS accepts per call is found on the
+; first read, by halving on failure, and reused for the rest of the file.
+
+%ifndef LBL_CORE_LOAD_ADDRESS_LIN
+%define LBL_CORE_LOAD_ADDRESS_LIN   0x00100000  ; Final core address (1 MiB)
+%endif
+%ifndef LBL_CORE_SECTOR_COUNT
+%define LBL_CORE_SECTOR_COUNT       LBL_CORE_SECTOR_COUNT_WORD
+%endif
+%ifndef LBL_BIOS_BOUNCE_SEGMENT
+%define LBL_BIOS_BOUNCE_SEGMENT     0x1000      ; Bounce buffer at linear 0x10000
+%endif
+%ifndef LBL_BIOS_THUNK_STACK
+%define LBL_BIOS_THUNK_STACK        0x7C00      ; Real-mode stack of lbl_bios_disk_read (old MBR area)
+%endif
+
+LBL_BIOS_BOUNCE_BYTES   equ 0xFE00  ; 127 * 512: the most many BIOSes move in one call
+LBL_BIOS_FLAT_SECTORS   equ 0x0800  ; First try with flat addressing (1 MiB of 512-byte sectors)
+LBL_BIOS_READ_RETRIES   equ 3       ; Per chunk, with a disk reset in between
+
+; --- load_core_chunked ---
+; In:  DL = BIOS drive. Reads LBL_CORE_SECTOR_COUNT sectors from core_load_lba
+;      to LBL_CORE_LOAD_ADDRESS_LIN. A20 must already be enabled.
+; Out: CF clear on success. All registers preserved.
+load_core_chunked:
+    pushad
+    push ds
+    push cs
+    pop ds
+    mov [disk_drive], dl
+    mov eax, [core_load_lba]
+    mov [disk_lba], eax
+    mov dword [disk_lba + 4], 0
+    mov dword [disk_dest], LBL_CORE_LOAD_ADDRESS_LIN
+    mov dword [disk_remaining], LBL_CORE_SECTOR_COUNT
+
+    call disk_probe
+    jc .fail
+
+.next_chunk:
+    mov ecx, [disk_remaining]
+    test ecx, ecx
+    jz .done
+    movzx eax, word [disk_chunk_limit]
+    cmp ecx, eax
+    jbe .count_ok
+    mov ecx, eax
+.count_ok:
+    call disk_read_chunk        ; ECX = sectors actually read
+    jc .fail
+    add [disk_lba], ecx
+    adc dword [disk_lba + 4], 0
+    sub [disk_remaining], ecx
+    movzx eax, word [disk_sector_size]
+    mul ecx
+    add [disk_dest], eax
+    jmp .next_chunk
+
+.done:
+    pop ds
+    popad
+    clc
+    ret
+.fail:
+    pop ds
+    popad
+    stc
+    ret
+
+; --- disk_probe ---
+; Checks for EDD, reads the sector size (AH=48h) and decides between flat
+; addressing and the bounce buffer. Out: CF set if EDD is missing.
+disk_probe:
+    mov ah, 0x41
+    mov bx, 0x55AA
+    mov dl, [disk_drive]
+    int 0x13
+    jc .no_edd
+    cmp bx, 0xAA55
+    jne .no_edd
+    test cl, 0x01               ; Fixed disk access subset (AH=42h)
+    jz .no_edd
+    mov [disk_edd_version], ah
+
+    mov word [disk_params], 0x1E
+    mov ah, 0x48
+    mov dl, [disk_drive]
+    mov si, disk_params
+    int 0x13
+    jc .sector_size_known       ; Keep 512
+    mov ax, [disk_params + 0x18]
+    cmp ax, 512
+    jb .sector_size_known
+    cmp ax, 4096
+    ja .sector_size_known
+    mov [disk_sector_size], ax
+.sector_size_known:
+    xor dx, dx
+    mov ax, LBL_BIOS_BOUNCE_BYTES
+    div word [disk_sector_size]
+    mov [disk_chunk_limit], ax
+
+    cmp byte [disk_edd_version], 0x30
+    jb .probed
+    call disk_probe_flat
+.probed:
+    clc
+    ret
+.no_edd:
+    mov si, msg_disk_no_edd
+    call print_string_16
+    stc
+    ret
+
+; --- disk_probe_flat ---
+; EDD 3.0 BIOSes may still ignore the 64-bit address, so one sector is read into
+; the bounce buffer, the destination is set to something else, and the flat read
+; must reproduce the bounce copy there.
+disk_probe_flat:
+    mov ecx, 1
+    call disk_issue
+    jc .unsupported
+    call unreal_enter
+    mov esi, LBL_BIOS_BOUNCE_SEGMENT << 4
+    mov edi, [disk_dest]
+    mov eax, [fs:esi]
+    not eax
+    mov [fs:edi], eax           ; Destination now differs from the sector
+
+    mov byte [disk_flat_ok], 1
+    mov ecx, 1
+    call disk_issue
+    jc .unsupported
+    call unreal_enter           ; The BIOS may have reloaded FS
+    movzx ecx, word [disk_sector_size]
+    shr ecx, 2
+    mov esi, LBL_BIOS_BOUNCE_SEGMENT << 4
+    mov edi, [disk_dest]
+.compare:
+    mov eax, [fs:esi]
+    cmp eax, [fs:edi]
+    jne .unsupported
+    add esi, 4
+    add edi, 4
+    dec ecx
+    jnz .compare
+    mov word [disk_chunk_limit], LBL_BIOS_FLAT_SECTORS
+    ret
+.unsupported:
+    mov byte [disk_flat_ok], 0
+    ret
+
+; --- disk_read_chunk ---
+; In:  ECX = sectors to read at disk_lba into disk_dest.
+; Out: CF clear and ECX = sectors read, or CF set after LBL_BIOS_READ_RETRIES.
+; Until one read has succeeded a failure halves the count (and disk_chunk_limit)
+; instead of counting as a retry, so the per-call limit is learned only once.
+disk_read_chunk:
+    mov bp, LBL_BIOS_READ_RETRIES
+.again:
+    call disk_issue
+    jnc .read_ok
+    cmp byte [disk_limit_known], 0
+    jne .retry
+    cmp ecx, 1
+    je .retry
+    shr ecx, 1
+    mov [disk_chunk_limit], cx
+    jmp .again
+.retry:
+    dec bp
+    jz .failed
+    mov ah, 0x00                ; Reset the drive before trying again
+    mov dl, [disk_drive]
+    int 0x13
+    jmp .again
+.failed:
+    mov si, msg_disk_read_fail
+    call print_string_16
+    stc
+    ret
+
+.read_ok:
+    mov byte [disk_limit_known], 1
+    cmp byte [disk_flat_ok], 0
+    jne .placed
+    ; Bounce buffer: copy ECX sectors up to disk_dest.
+    push ecx
+    call unreal_enter
+    movzx eax, word [disk_sector_size]
+    mul ecx
+    mov ecx, eax
+    shr ecx, 2
+    mov esi, LBL_BIOS_BOUNCE_SEGMENT << 4
+    mov edi, [disk_dest]
+.copy:
+    mov eax, [fs:esi]
+    mov [fs:edi], eax
+    add esi, 4
+    add edi, 4
+    dec ecx
+    jnz .copy
+    pop ecx
+.placed:
+    clc
+    ret
+
+; --- disk_issue ---
+; One AH=42h call: ECX sectors at disk_lba, to disk_dest (flat) or the bounce
+; buffer. Out: CF from the BIOS. ECX preserved.
+disk_issue:
+    mov [disk_dap_count], cx
+    mov eax, [disk_lba]
+    mov [disk_dap_lba], eax
+    mov eax, [disk_lba + 4]
+    mov [disk_dap_lba + 4], eax
+    cmp byte [disk_flat_ok], 0
+    je .bounce
+    mov byte [disk_dap], 0x18
+    mov dword [disk_dap_buffer], 0xFFFFFFFF ; FFFF:FFFF selects the 64-bit address
+    mov eax, [disk_dest]
+    mov [disk_dap_flat], eax
+    mov dword [disk_dap_flat + 4], 0
+    jmp .issue
+.bounce:
+    mov byte [disk_dap], 0x10
+    mov word [disk_dap_buffer], 0
+    mov word [disk_dap_buffer + 2], LBL_BIOS_BOUNCE_SEGMENT
+.issue:
+    push ecx
+    mov ah, 0x42
+    mov dl, [disk_drive]
+    mov si, disk_dap
+    int 0x13
+    pop ecx
+    ret
+
+; --- lbl_bios_disk_read ---
+; C-callable from 32-bit protected mode (cdecl), see stage1_loader_utils.h:
+;   int lbl_bios_disk_read(lbl_u32 drive, lbl_u32 lba_low, lbl_u32 lba_high, lbl_u32 count)
+; Drops to real mode for one AH=42h read of `count` sectors into the bounce
+; buffer, then returns to protected mode. Interrupts are on only in real mode.
+; Returns 0 on success.
+BITS 32
+global lbl_bios_disk_read
+lbl_bios_disk_read:
+    push ebp
+    mov ebp, esp
+    push ebx
+    push esi
+    push edi
+    mov eax, [ebp + 8]
+    mov [disk_drive], al
+    mov eax, [ebp + 12]
+    mov [disk_lba], eax
+    mov eax, [ebp + 16]
+    mov [disk_lba + 4], eax
+    mov ecx, [ebp + 20]
+    mov [disk_thunk_esp], esp
+    mov byte [disk_flat_ok], 0  ; The caller copies out of the bounce buffer
+    jmp CODE16_SEG:.pm16
+BITS 16
+.pm16:
+    mov ax, DATA16_SEG          ; Real-mode compatible limits before PE goes off
+    mov ds, ax
+    mov es, ax
+    mov ss, ax
+    mov eax, cr0
+    and al, 0xFE
+    mov cr0, eax
+    jmp 0x0000:.rm
+.rm:
+    xor ax, ax
+    mov ds, ax
+    mov es, ax
+    mov ss, ax
+    mov sp, LBL_BIOS_THUNK_STACK
+    lidt [disk_rm_idtr]
+    sti
+    call disk_issue
+    sbb al, al                  ; 0xFF if the BIOS set CF
+    mov [disk_thunk_status], al
+    cli
+    mov eax, cr0
+    or al, 0x01
+    mov cr0, eax
+    jmp dword CODE_SEG:.pm32
+BITS 32
+.pm32:
+    mov ax, DATA_SEG
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+    mov esp, [disk_thunk_esp]
+    movzx eax, byte [disk_thunk_status]
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret
+BITS 16
+
+; --- unreal_enter ---
+; Gives FS base 0 and a 4 GiB limit while staying in real mode: FS is loaded
+; from gdt_data with CR0.PE set, then PE is cleared again. The descriptor cache
+; keeps the limit until FS is next loaded in protected mode, but a BIOS call may
+; reload it, so callers redo this before each copy.
+unreal_enter:
+    pushfd
+    push eax
+    push ebx
+    cli
+    xor ebx, ebx
+    mov bx, cs
+    shl ebx, 4
+    add ebx, gdt_start
+    mov [unreal_gdtr + 2], ebx
+    lgdt [unreal_gdtr]
+    mov eax, cr0
+    or al, 0x01
+    mov cr0, eax
+    jmp short .pm
+.pm:
+    mov bx, DATA_SEG
+    mov fs, bx
+    and al, 0xFE
+    mov cr0, eax
+    jmp short .rm
+.rm:
+    xor bx, bx
+    mov fs, bx
+    pop ebx
+    pop eax
+    popfd
+    ret
+
+unreal_gdtr:
+    dw gdt_end - gdt_start - 1
+    dd 0                        ; Linear address of gdt_start, set by unreal_enter
+
+; --- Disk Address Packet (EDD 3.0 layout, 0x18 bytes with the flat address) ---
+disk_dap:
+    db 0x10                     ; Packet size: 0x10, or 0x18 with disk_dap_flat
+    db 0
+disk_dap_count:
+    dw 0
+disk_dap_buffer:
+    dw 0, 0                     ; Offset, segment (FFFF:FFFF for flat)
+disk_dap_lba:
+    dq 0
+disk_dap_flat:
+    dq 0
+
+disk_params:        times 0x1E db 0 ; AH=48h result buffer
+disk_lba:           dq 0
+disk_dest:          dd 0
+disk_remaining:     dd 0
+disk_sector_size:   dw 512
+disk_chunk_limit:   dw 0        ; Sectors per AH=42h call
+disk_drive:         db 0
+disk_edd_version:   db 0
+disk_flat_ok:       db 0        ; 1: BIOS honours 64-bit flat buffer addresses
+disk_limit_known:   db 0        ; 1: disk_chunk_limit has been accepted once
+disk_thunk_status:  db 0
+align 4
+disk_thunk_esp:     dd 0        ; Protected-mode ESP across lbl_bios_disk_read
+disk_rm_idtr:
+    dw 0x03FF                   ; Real-mode IVT
+    dd 0
+
+msg_disk_no_edd:    db "INT 13h extensions missing.", 0x0D, 0x0A, 0
+msg_disk_read_fail: db "Core read failed.", 0x0D, 0x0A, 0
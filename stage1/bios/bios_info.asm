@@ -0,0 +1,240 @@
+; Lionbootloader - Stage 1 - BIOS Platform Info (bios_info.asm)
+; File: stage1/bios/bios_info.asm
+; Purpose: Collects what the core needs from the BIOS while real mode is still
+;          available: the E820 memory map, an ACPI RSDP and a VBE linear
+;          framebuffer mode. %included by boot_32.asm: 16-bit code, DS = ES = 0.
+;
+; Everything lands in bios_handoff (LBL_BIOS_HANDOFF in stage1_loader_utils.h).
+; In protected mode lbl_bios_build_boot_info turns it into the LBL_BOOT_INFO the
+; UEFI loader produces, compact memory map record included.
+
+%ifndef LBL_BIOS_BOOT_INFO_LIN
+%define LBL_BIOS_BOOT_INFO_LIN      0x00070000  ; Boot info area, below the PM stack
+%endif
+%ifndef LBL_BIOS_BOOT_INFO_SIZE
+%define LBL_BIOS_BOOT_INFO_SIZE     0x00010000
+%endif
+%ifndef LBL_BIOS_VBE_MAX_PIXELS
+%define LBL_BIOS_VBE_MAX_PIXELS     (1920 * 1200) ; As LBL_GOP_DEFAULT_POLICY
+%endif
+
+LBL_BIOS_E820_MAX       equ 128         ; Keep in step with stage1_loader_utils.h
+LBL_BIOS_E820_ENTRY     equ 24
+LBL_BIOS_VBE_NO_MODE    equ 0xFFFF
+LBL_E820_SMAP           equ 0x534D4150  ; 'SMAP'
+
+; LBL_BIOS_HANDOFF field offsets
+LBL_HANDOFF_E820_ADDR       equ 0
+LBL_HANDOFF_E820_COUNT      equ 4
+LBL_HANDOFF_RSDP            equ 8
+LBL_HANDOFF_VBE_MODE        equ 12
+LBL_HANDOFF_VBE_MODE_INFO   equ 16
+LBL_HANDOFF_VBE_VERSION     equ 20
+LBL_HANDOFF_VBE_MEMORY      equ 24
+LBL_HANDOFF_CORE_ADDR       equ 28
+LBL_HANDOFF_CORE_SIZE       equ 32
+LBL_HANDOFF_STAGE2_BASE     equ 36
+LBL_HANDOFF_STAGE2_SIZE     equ 40
+LBL_HANDOFF_SECTOR_SIZE     equ 44
+LBL_HANDOFF_CHUNK_LIMIT     equ 48
+LBL_HANDOFF_BOOT_DRIVE      equ 52
+LBL_HANDOFF_TSC_ENTRY       equ 56      ; 64-bit TSC values
+LBL_HANDOFF_TSC_CORE_LOADED equ 64
+LBL_HANDOFF_SIZE            equ 72
+
+; --- collect_e820 ---
+; INT 15h E820 into bios_e820_buffer, up to LBL_BIOS_E820_MAX entries. Each call
+; asks for 24 bytes; BIOSes that return 20 leave the preset "enabled" attribute.
+; Zero-length entries are dropped. Out: count in the handoff (0 = no E820).
+collect_e820:
+    pushad
+    mov di, bios_e820_buffer
+    xor ebx, ebx
+    xor bp, bp
+.next:
+    mov dword [di + 20], 1      ; ACPI 3.0 attributes: entry enabled
+    mov eax, 0xE820
+    mov edx, LBL_E820_SMAP
+    mov ecx, LBL_BIOS_E820_ENTRY
+    int 0x15
+    jc .done                    ; Unsupported, or past the last entry
+    cmp eax, LBL_E820_SMAP
+    jne .done
+    mov eax, [di + 8]
+    or eax, [di + 12]
+    jz .skip
+    add di, LBL_BIOS_E820_ENTRY
+    inc bp
+    cmp bp, LBL_BIOS_E820_MAX
+    jae .done
+.skip:
+    test ebx, ebx               ; EBX = 0: that was the last entry
+    jnz .next
+.done:
+    mov dword [bios_handoff + LBL_HANDOFF_E820_ADDR], bios_e820_buffer
+    movzx eax, bp
+    mov [bios_handoff + LBL_HANDOFF_E820_COUNT], eax
+    popad
+    ret
+
+; --- find_rsdp ---
+; ACPI 6.5 5.2.5.1: the RSDP is on a 16-byte boundary in the first KiB of the
+; EBDA or in 0xE0000-0xFFFFF. Only the ACPI 1.0 checksum (first 20 bytes) is
+; checked; that is all every revision carries. Out: handoff RSDP (0 = none).
+find_rsdp:
+    pushad
+    push es
+    mov dword [bios_handoff + LBL_HANDOFF_RSDP], 0
+    mov ax, 0x0040
+    mov es, ax
+    mov ax, [es:0x000E]         ; BDA: EBDA segment
+    test ax, ax
+    jz .bios_area
+    mov es, ax
+    mov cx, 1024 / 16
+    call rsdp_scan
+    jnc .found
+.bios_area:
+    mov ax, 0xE000
+    mov es, ax
+    mov cx, 0x10000 / 16
+    call rsdp_scan
+    jnc .found
+    mov ax, 0xF000
+    mov es, ax
+    mov cx, 0x10000 / 16
+    call rsdp_scan
+    jc .done
+.found:
+    mov [bios_handoff + LBL_HANDOFF_RSDP], eax
+.done:
+    pop es
+    popad
+    ret
+
+; In:  ES = segment, CX = paragraphs to scan from ES:0.
+; Out: CF clear and EAX = linear address of a valid RSDP, else CF set.
+rsdp_scan:
+    xor di, di
+.check:
+    cmp dword [es:di], 'RSD '
+    jne .next
+    cmp dword [es:di + 4], 'PTR '
+    jne .next
+    push cx
+    mov bx, di
+    mov cx, 20
+    xor al, al
+.sum:
+    add al, [es:bx]
+    inc bx
+    loop .sum
+    pop cx
+    test al, al
+    jnz .next
+    xor eax, eax
+    mov ax, es
+    shl eax, 4
+    movzx edx, di
+    add eax, edx
+    clc
+    ret
+.next:
+    add di, 16
+    loop .check
+    stc
+    ret
+
+; --- setup_vbe ---
+; Picks the largest 32 bpp direct-colour mode with a linear framebuffer and at
+; most LBL_BIOS_VBE_MAX_PIXELS, and sets it. Text output through INT 10h stops
+; working afterwards, so boot_32 calls this after its last message.
+; Out: handoff VBE fields (mode LBL_BIOS_VBE_NO_MODE = text mode kept).
+setup_vbe:
+    pushad
+    push fs
+    mov dword [bios_handoff + LBL_HANDOFF_VBE_MODE], LBL_BIOS_VBE_NO_MODE
+    mov dword [bios_vbe_info], 'VBE2' ; Ask for the VBE 2.0+ fields
+    mov ax, 0x4F00
+    mov di, bios_vbe_info
+    int 0x10
+    cmp ax, 0x004F
+    jne .done
+    cmp dword [bios_vbe_info], 'VESA'
+    jne .done
+    movzx eax, word [bios_vbe_info + 0x04] ; VbeVersion
+    mov [bios_handoff + LBL_HANDOFF_VBE_VERSION], eax
+    movzx eax, word [bios_vbe_info + 0x12] ; TotalMemory, 64 KiB blocks
+    shl eax, 16
+    mov [bios_handoff + LBL_HANDOFF_VBE_MEMORY], eax
+    cmp word [bios_vbe_info + 0x04], 0x0200
+    jb .done                    ; Linear framebuffers need VBE 2.0
+
+    mov dword [bios_vbe_best_pixels], 0
+    lfs si, [bios_vbe_info + 0x0E] ; VideoModePtr
+.next_mode:
+    mov cx, [fs:si]
+    cmp cx, 0xFFFF
+    je .chosen
+    add si, 2
+    mov ax, 0x4F01
+    mov di, bios_vbe_mode_info
+    int 0x10
+    cmp ax, 0x004F
+    jne .next_mode
+    mov ax, [bios_vbe_mode_info + 0x00] ; ModeAttributes
+    and ax, 0x0099              ; Supported, colour, graphics, linear framebuffer
+    cmp ax, 0x0099
+    jne .next_mode
+    cmp byte [bios_vbe_mode_info + 0x19], 32 ; BitsPerPixel
+    jne .next_mode
+    cmp byte [bios_vbe_mode_info + 0x1B], 6  ; MemoryModel: direct colour
+    jne .next_mode
+    cmp dword [bios_vbe_mode_info + 0x28], 0 ; PhysBasePtr
+    je .next_mode
+    movzx eax, word [bios_vbe_mode_info + 0x12]
+    movzx edx, word [bios_vbe_mode_info + 0x14]
+    mul edx
+    cmp eax, LBL_BIOS_VBE_MAX_PIXELS
+    ja .next_mode
+    cmp eax, [bios_vbe_best_pixels]
+    jbe .next_mode
+    mov [bios_vbe_best_pixels], eax
+    mov [bios_vbe_best_mode], cx
+    jmp .next_mode
+
+.chosen:
+    cmp dword [bios_vbe_best_pixels], 0
+    je .done
+    mov cx, [bios_vbe_best_mode]
+    mov ax, 0x4F01              ; Reload the winner's ModeInfoBlock for the handoff
+    mov di, bios_vbe_mode_info
+    int 0x10
+    cmp ax, 0x004F
+    jne .done
+    mov ax, 0x4F02
+    mov bx, cx
+    or bx, 0x4000               ; Use the linear framebuffer
+    int 0x10
+    cmp ax, 0x004F
+    jne .done
+    movzx eax, cx
+    mov [bios_handoff + LBL_HANDOFF_VBE_MODE], eax
+    mov dword [bios_handoff + LBL_HANDOFF_VBE_MODE_INFO], bios_vbe_mode_info
+.done:
+    pop fs
+    popad
+    ret
+
+; --- LBL_BIOS_HANDOFF ---
+align 8
+bios_handoff:           times LBL_HANDOFF_SIZE db 0
+bios_vbe_best_pixels:   dd 0
+bios_vbe_best_mode:     dw 0
+
+section .bss
+alignb 16
+bios_e820_buffer:       resb LBL_BIOS_E820_MAX * LBL_BIOS_E820_ENTRY
+bios_vbe_info:          resb 512    ; VbeInfoBlock
+bios_vbe_mode_info:     resb 256    ; ModeInfoBlock of the chosen mode
+section .entry
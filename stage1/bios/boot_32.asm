@@ -3,11 +3,18 @@
 ; Purpose: Switches to 32-bit protected mode, loads LBL Core Engine, and jumps to it.
 
 BITS 16             ; Loaded by MBR in 16-bit mode
-ORG 0x0000          ; Assembled to be loaded at LBL_STAGE2_LOAD_SEGMENT:0x0000
-                    ; Actual load address (e.g. 0x8000) is determined by MBR via lbl_config_bios.inc
+                    ; Assembled as elf32 and linked with the BIOS build of stage1_loader_utils.c
+                    ; by linker_bios.ld at LBL_STAGE2_LOAD_ADDRESS (0x8000): labels are linear
+                    ; addresses, and stage2_start reloads CS = 0 so they work in real mode too.
+SECTION .entry progbits alloc exec write align=16
+global stage2_start
+extern lbl_bios_build_boot_info     ; stage1_loader_utils.c, LBL_BIOS_ENV
+extern lbl_bios_sector_cache_init
+extern lbl_stage2_end               ; linker_bios.ld: end of the image and its .bss
 
 %include "stage1/bios/lbl_config_bios.inc" ; Common build-time configurations
 
+stage2_image_start:
 jmp stage2_start    ; Jump over GDT data
 
 ; --- Global Descriptor Table (GDT) ---
@@ -46,49 +53,58 @@ gdt_data:
     db 0x92         ; Access Byte (P=1, DPL=0, S=1, Type=0010 -> Data, RW)
     db 0xCF
     db 0x00
+
+    ; 16-bit code and data (64 KiB, base 0): lbl_bios_disk_read passes through
+    ; them on its way back to real mode.
+gdt_code16:
+    dw 0xFFFF
+    dw 0x0000
+    db 0x00
+    db 0x9A
+    db 0x00         ; Flags (G=0, D=0): 16-bit, byte granular
+    db 0x00
+gdt_data16:
+    dw 0xFFFF
+    dw 0x0000
+    db 0x00
+    db 0x92
+    db 0x00
+    db 0x00
 gdt_end:
 
 gdt_descriptor:
     dw gdt_end - gdt_start - 1 ; GDT limit (size of table in bytes - 1)
-    dd gdt_start               ; GDT base address (linear address)
-                               ; This needs to be a physical address before paging.
-                               ; Since ORG is 0, this will be LBL_STAGE2_LOAD_SEGMENT << 4 + gdt_start_offset
+    dd gdt_start               ; GDT base address (linear: the image is linked at its load address)
 
 ; Segment selectors (offsets into GDT)
 CODE_SEG equ gdt_code - gdt_start
 DATA_SEG equ gdt_data - gdt_start
+CODE16_SEG equ gdt_code16 - gdt_start
+DATA16_SEG equ gdt_data16 - gdt_start
 
 
 boot_drive_s2   db 0    ; To store boot drive from MBR (if MBR passes it)
 core_load_lba   dd LBL_CORE_START_SECTOR_LBA ; From lbl_config_bios.inc
-core_num_sectors dw LBL_CORE_SECTOR_COUNT_WORD ; From lbl_config_bios.inc
-
-; DAP for loading core engine
-core_dap:
-    db 0x10         ; Size of packet
-    db 0
-core_dap_num_sectors:
-    dw LBL_CORE_SECTOR_COUNT_WORD ; Number of sectors (placeholder, fill at runtime)
-core_dap_buffer_offset:
-    dw 0x0000       ; Buffer offset (e.g. 0 for segment start)
-core_dap_buffer_segment:
-    dw 0x0000       ; Buffer segment (e.g. 0x10000 for 1MB / 0x01000 for 64KB segments if using 0x1000 for segment)
-                    ; This will be LBL_CORE_LOAD_ADDRESS_SEG
-core_dap_lba_low:
-    dd LBL_CORE_START_SECTOR_LBA ; LBA start (placeholder, fill at runtime)
-core_dap_lba_high:
-    dd 0
+                    ; Sector count and load address: see bios_disk.asm
 
 
 stage2_start:
-    ; Assume MBR has set up DS, ES, SS, SP correctly for this stage.
-    ; Stage 2 code itself is loaded at LBL_STAGE2_LOAD_SEGMENT:LBL_STAGE2_LOAD_OFFSET
-    ; The ORG 0 directive means all labels are relative to this load offset.
-    ; So, gdt_start label value needs to be added to the load address (segment << 4 + offset)
-    ; to get its physical address for the GDTR.
+    ; The MBR jumps here as LBL_STAGE2_LOAD_SEGMENT:0. Labels are linear addresses,
+    ; so continue with CS = DS = ES = 0 (the image and its .bss stay below 64 KiB).
+    ; SS:SP is the MBR's.
+    jmp 0x0000:.flat_cs
+.flat_cs:
+    xor ax, ax
+    mov ds, ax
+    mov es, ax
 
     mov [boot_drive_s2], dl ; Save boot drive passed by BIOS (MBR should preserve/pass this)
 
+    ; Stage 2 entry on the boot timeline (LBL_TL_STAGE1_ENTRY)
+    rdtsc
+    mov [bios_handoff + LBL_HANDOFF_TSC_ENTRY], eax
+    mov [bios_handoff + LBL_HANDOFF_TSC_ENTRY + 4], edx
+
     mov si, msg_stage2_init
     call print_string_16
 
@@ -99,71 +115,53 @@ stage2_start:
     mov si, msg_a20_ok
     call print_string_16
 
-    ; --- Detect Memory (Simplified using INT 15h, E820h) ---
-    ; A full E820h loop is complex. Here we'll just note it.
-    ; The memory map would be collected and stored, then passed to core engine.
-    ; For now, assume core engine gets it from UEFI if available, or a simpler map.
+    ; --- Detect Memory and ACPI (INT 15h E820h, RSDP scan) ---
+    ; Raw results go to bios_handoff; lbl_bios_build_boot_info converts them in PM.
     mov si, msg_mem_detect
     call print_string_16
-    ; ... call get_e820_memory_map (complex function not implemented here) ...
-    ; For this stub, we skip full memory map collection by Stage2 BIOS.
-    ; Core engine will have to do it or rely on what Stage 1 can provide.
+    call collect_e820
+    call find_rsdp
+    mov dword [bios_handoff + LBL_HANDOFF_STAGE2_BASE], stage2_image_start
+    mov eax, lbl_stage2_end
+    sub eax, stage2_image_start
+    mov [bios_handoff + LBL_HANDOFF_STAGE2_SIZE], eax
 
     ; --- Load LBL Core Engine ---
     mov si, msg_loading_core
     call print_string_16
 
-    ; Set up DAP for core engine loading
-    mov ax, word [LBL_CORE_LOAD_ADDRESS_SEG]  ; Target segment for core
-    mov word [core_dap_buffer_segment], ax
-    mov ax, word [LBL_CORE_LOAD_ADDRESS_OFF]  ; Target offset for core
-    mov word [core_dap_buffer_offset], ax
-    ; LBA and sector count are already defined or taken from core_load_lba/core_num_sectors above
-    ; If needed, can also copy from core_load_lba and core_num_sectors into DAP here.
-
-    mov ah, 0x42        ; Extended Read
+    ; Large extended reads straight to LBL_CORE_LOAD_ADDRESS_LIN (above 1 MiB),
+    ; through a bounce buffer and unreal mode where the BIOS needs one.
     mov dl, byte [boot_drive_s2]
-    mov si, core_dap    ; Pointer to DAP
-    int 0x13
+    call load_core_chunked
     jc .core_load_error
 
+    mov dword [bios_handoff + LBL_HANDOFF_CORE_ADDR], LBL_CORE_LOAD_ADDRESS_LIN
+    mov eax, [disk_dest]            ; Advanced past the last sector read
+    sub eax, LBL_CORE_LOAD_ADDRESS_LIN
+    mov [bios_handoff + LBL_HANDOFF_CORE_SIZE], eax
+    movzx eax, word [disk_sector_size]
+    mov [bios_handoff + LBL_HANDOFF_SECTOR_SIZE], eax
+    movzx eax, word [disk_chunk_limit]
+    mov [bios_handoff + LBL_HANDOFF_CHUNK_LIMIT], eax
+    movzx eax, byte [boot_drive_s2]
+    mov [bios_handoff + LBL_HANDOFF_BOOT_DRIVE], eax
+    rdtsc                           ; LBL_TL_CORE_READ_END
+    mov [bios_handoff + LBL_HANDOFF_TSC_CORE_LOADED], eax
+    mov [bios_handoff + LBL_HANDOFF_TSC_CORE_LOADED + 4], edx
+
     mov si, msg_core_loaded
     call print_string_16
 
+    ; --- Video Mode (VBE) ---
+    ; Last, because INT 10h teletype output is gone once a graphics mode is set.
+    call setup_vbe
+
     ; --- Transition to 32-bit Protected Mode ---
     cli                 ; 1. Disable interrupts
 
-    ; Load GDT Register (LGDT)
-    ; GDTR needs a linear address. Calculate physical address of gdt_start.
-    ; Assumes this Stage 2 code is loaded at LBL_STAGE2_LOAD_ADDRESS (segment:offset)
-    ; The ORG 0 means gdt_descriptor is relative to where this code is loaded.
-    mov eax, [LBL_STAGE2_LOAD_SEGMENT_LIN] ; Get linear base of Stage2 from config
-                                           ; e.g., if 0x0800:0x0000, then linear is 0x8000
-    add eax, gdt_descriptor_dd_offset_val ; Add offset of `dd gdt_start` within gdt_descriptor
-                                          ; This is tricky; easier if gdt_descriptor structure is fixed
-                                          ; Or, more robustly:
-                                          ; mov ax, cs
-                                          ; shl eax, 4
-                                          ; add eax, gdt_start  (if gdt_start is symbol offset from current CS:0)
-                                          ; mov [gdt_descriptor + 2], eax ; Store base in GDTR
-    ; For simplicity, assume gdt_descriptor's base points correctly relative to load.
-    ; We need to adjust the gdt_descriptor's base address part before lgdt
-    ; if ORG 0x0000. A simple linker script might place GDT at absolute known address.
-    push cs             ; Get current code segment
-    pop ds              ; GDT itself is in current CS, which becomes DS after pop
-                        ; Now, gdt_descriptor.base (dd gdt_start) refers to symbol gdt_start
-                        ; that is an offset from start of this code.
-                        ; We need physical address of gdt_start: (CS << 4) + gdt_start_offset symbol
-    mov ebx, [cs]       ; Current CS value
-    shl ebx, 4          ; EBX = CS linear base address
-    add ebx, gdt_start  ; EBX = physical address of gdt_start label
-    mov [gdt_descriptor_dd_offset_val_ptr], ebx ; Patch the GDTR base address
-
-    lgdt [gdt_descriptor_dd_offset_val_ptr - 2] ; Load GDT, careful with label reference
-                                    ; The label `gdt_descriptor` points to the limit word.
-                                    ; The base dword is 2 bytes after that.
-                                    ; So, [gdt_descriptor] has limit, [gdt_descriptor+2] has base.
-
+    ; Load GDT Register (LGDT). gdt_descriptor already holds the linear base.
+    lgdt [gdt_descriptor]
     ; Enable Protected Mode by setting PE bit (bit 0) in CR0
     mov eax, cr0
     or eax, 0x1         ; Set PE bit
@@ -171,7 +169,7 @@ stage2_start:
 
     ; Far jump to flush CPU pipeline and load CS with new descriptor
     ; This jump is to a 32-bit code segment.
-    jmp CODE_SEG:.pm_entry  ; CODE_SEG is offset from GDT base (e.g., 0x08)
+    jmp dword CODE_SEG:pm_entry ; CODE_SEG is offset from GDT base (e.g., 0x08)
 
 .a20_error:
     mov si, msg_a20_fail
@@ -191,7 +189,7 @@ hang:
 
 ; --- 32-bit Protected Mode Code ---
 BITS 32
-.pm_entry:
+pm_entry:
     ; Now in 32-bit Protected Mode
     ; Set up data segment registers
     mov ax, DATA_SEG    ; DATA_SEG is offset from GDT base (e.g. 0x10)
@@ -200,38 +198,26 @@ BITS 32
     mov fs, ax
     mov gs, ax
     mov ss, ax          ; Stack segment
-    mov esp, 0x0008FFFF ; Set up a new stack in a known-safe high memory area
+    mov esp, 0x00090000 ; Set up a new stack in a known-safe high memory area (16-byte aligned for C)
                         ; (e.g., just under 1MB, ensure it doesn't clash)
                         ; LBL_STACK_TOP_ADDRESS from config
 
-    ; At this point, we are in 32-bit PM. BIOS calls are generally unusable.
-    ; We need to pass information to the Core Engine.
-    ; This info could include: memory map, framebuffer details (if VBE used), boot drive.
-    ; Store it in a known memory location or pass via registers if core ABI defines it.
-
-    ; For LBL, we define a BootInfo struct. Stage2 must populate this.
-    ; LBL_BOOT_INFO_ADDRESS is defined in lbl_config_bios.inc.
-    mov edi, [LBL_BOOT_INFO_ADDRESS] ; EDI points to BootInfo struct
-
-    ; Populate BootInfo (Example fields, actual struct must match core's expectation)
-    mov dword [edi + 0], LBL_BOOT_INFO_MAGIC_VALUE ; magic
-    mov dword [edi + 4], 1                    ; version
-    ; [edi + 8] is memory_map_addr
-    ; [edi + 12] is memory_map_entries
-    ; ... (framebuffer info if VBE was used, etc.)
-    ; For this stub, we fill minimal info. Full memory map and framebuffer
-    ; detection are complex and omitted here for Stage2 BIOS, assuming Core will handle some.
-    ; If MBR found framebuffer info or stage2 did, pass it.
-    ; For now, core might need to rely on UEFI Stage1 for full info, or do its own detection.
-
-    ; For BIOS, we pass very basic info, or core must do more detection.
-    ; Let's assume Framebuffer info is detected via VBE (not shown here)
-    ; and stored starting at known offsets in BootInfo struct in lbl_config_bios.inc
-    ; mov eax, [detected_fb_addr]
-    ; mov [edi + LBL_BOOTINFO_FB_ADDR_OFFSET], eax 
-    ; ... etc for width, height, pitch, bpp
-
-    mov byte [edi + LBL_BOOTINFO_BOOT_DRIVE_OFFSET], [boot_drive_s2_pm] ; Boot drive
+    ; At this point, we are in 32-bit PM. BIOS calls go through lbl_bios_disk_read.
+    ; Warm the sector cache with the boot volume's FAT metadata for the core.
+    push dword bios_handoff
+    call lbl_bios_sector_cache_init
+    add esp, 4
+
+    ; Turn what real mode collected into the same LBL_BOOT_INFO the UEFI loader
+    ; builds (header, framebuffer, RSDP, compact memory map record).
+    push dword LBL_BIOS_BOOT_INFO_SIZE
+    push dword LBL_BIOS_BOOT_INFO_LIN
+    push dword bios_handoff
+    call lbl_bios_build_boot_info    ; cdecl: EAX = boot info, or 0
+    add esp, 12
+    test eax, eax
+    jz hang
+    mov edi, eax
 
     ; Jump to LBL Core Engine entry point
     ; LBL_CORE_ENTRY_POINT is the physical address from lbl_config_bios.inc
@@ -301,6 +287,9 @@ enable_a20_fastgate:
     stc                 ; Set carry flag (failure)
     ret
 
+%include "stage1/bios/bios_disk.asm" ; load_core_chunked and its helpers
+%include "stage1/bios/bios_info.asm" ; collect_e820, find_rsdp, setup_vbe
+
 ; --- Helper Functions (32-bit Protected Mode) ---
 BITS 32
 ; Simple PM string print (writes to VGA buffer 0xB8000 directly)
@@ -371,15 +360,11 @@ BITS 16
 msg_stage2_init:    db "LBL Stage2 BIOS init...", 0x0D, 0x0A, 0
 msg_a20_ok:         db "A20 line enabled.", 0x0D, 0x0A, 0
 msg_a20_fail:       db "A20 enable FAILED!", 0x0D, 0x0A, 0
-msg_mem_detect:     db "Memory detection (stubbed)...", 0x0D, 0x0A, 0
+msg_mem_detect:     db "Reading memory map and ACPI...", 0x0D, 0x0A, 0
 msg_loading_core:   db "Loading LBL Core Engine...", 0x0D, 0x0A, 0
 msg_core_loaded:    db "LBL Core loaded.", 0x0D, 0x0A, 0
 msg_core_fail:      db "LBL Core load FAILED!", 0x0D, 0x0A, 0
 
-; Pointer to GDTR base for patching, assumes gdt_descriptor is at fixed offset early in file
-gdt_descriptor_dd_offset_val: equ gdt_descriptor + 2
-gdt_descriptor_dd_offset_val_ptr: dd gdt_start ; This value is patched at runtime
-
 ; --- Data (32-bit segment, ensure accessible after segments change) ---
 ; If DS is set to cover all 4GB, these can be anywhere.
 ; Otherwise, put them in a segment Stage2 knows how to access.
@@ -0,0 +1,435 @@
+// Lionbootloader - Stage 1 - Framebuffer Text Console
+// File: stage1/common/stage1_fbcon.c
+
+#include "stage1_fbcon.h"
+#include "stage1_mem.h"
+
+#define LBL_FBCON_BOX_GLYPH         (LBL_FBCON_GLYPH_COUNT - 1)
+#define LBL_FBCON_SERIAL_SPIN       100000  // LSR polls per byte before the UART is given up on
+#define LBL_FBCON_ROW_WORDS         (LBL_FBCON_GLYPH_WIDTH * 4 / 8) // 64-bit stores per glyph row
+
+// Light grey on black, like the firmware's own text console.
+#define LBL_FBCON_FOREGROUND_LEVEL  0xC0
+#define LBL_FBCON_BACKGROUND_LEVEL  0x00
+
+// 8x16 glyphs for ' ' to '~' plus the box, one byte per row, most significant
+// bit leftmost. Rasterized from DejaVu Sans Mono (Bitstream Vera license, below)
+// with the dash, underscore and tilde touched up by hand.
+//
+// DejaVu fonts are (c) Bitstream (see below). DejaVu changes are in the public
+// domain.
+//
+// Copyright (c) 2003 by Bitstream, Inc. All Rights Reserved. Bitstream Vera is
+// a trademark of Bitstream, Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of the fonts accompanying this license ("Fonts") and associated
+// documentation files (the "Font Software"), to reproduce and distribute the
+// Font Software, including without limitation the rights to use, copy, merge,
+// publish, distribute, and/or sell copies of the Font Software, and to permit
+// persons to whom the Font Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright and trademark notices and this permission notice shall
+// be included in all copies of one or more of the Font Software typefaces.
+//
+// The Font Software may be modified, altered, or added to, and in particular
+// the designs of glyphs or characters in the Fonts may be modified and
+// additional glyphs or characters may be added to the Fonts, only if the fonts
+// are renamed to names not containing either the words "Bitstream" or the word
+// "Vera".
+//
+// This License becomes null and void to the extent applicable to Fonts or Font
+// Software that has been modified and is distributed under the "Bitstream
+// Vera" names.
+//
+// The Font Software may be sold as part of a larger software package but no
+// copy of one or more of the Font Software typefaces may be sold by itself.
+//
+// THE FONT SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO ANY WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT OF COPYRIGHT, PATENT,
+// TRADEMARK, OR OTHER RIGHT. IN NO EVENT SHALL BITSTREAM OR THE GNOME
+// FOUNDATION BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, INCLUDING ANY
+// GENERAL, SPECIAL, INDIRECT, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, WHETHER IN
+// AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF THE USE OR
+// INABILITY TO USE THE FONT SOFTWARE OR FROM OTHER DEALINGS IN THE FONT
+// SOFTWARE.
+//
+// Except as contained in this notice, the names of Gnome, the Gnome
+// Foundation, and Bitstream Inc., shall not be used in advertising or
+// otherwise to promote the sale, use or other dealings in this Font Software
+// without prior written authorization from the Gnome Foundation or Bitstream
+// Inc., respectively. For further information, contact: fonts at gnome dot org.
+static const lbl_u8 lbl_fbcon_font[LBL_FBCON_GLYPH_COUNT][LBL_FBCON_GLYPH_HEIGHT] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // space
+    { 0x00, 0x00, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00 }, // !
+    { 0x00, 0x24, 0x24, 0x24, 0x24, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "
+    { 0x00, 0x02, 0x12, 0x12, 0x7F, 0x7F, 0x24, 0x24, 0xFE, 0x28, 0x48, 0x48, 0x00, 0x00, 0x00, 0x00 }, // #
+    { 0x00, 0x08, 0x18, 0x3E, 0x68, 0x68, 0x38, 0x1C, 0x0A, 0x0A, 0x4E, 0x3C, 0x08, 0x08, 0x00, 0x00 }, // $
+    { 0x00, 0x00, 0x70, 0x90, 0x90, 0x72, 0x0C, 0x34, 0x0E, 0x09, 0x09, 0x0E, 0x00, 0x00, 0x00, 0x00 }, // %
+    { 0x00, 0x38, 0x20, 0x60, 0x20, 0x30, 0x70, 0x59, 0xCD, 0xC6, 0x46, 0x3F, 0x00, 0x00, 0x00, 0x00 }, // &
+    { 0x00, 0x00, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '
+    { 0x00, 0x08, 0x08, 0x18, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x18, 0x08, 0x0C, 0x00, 0x00 }, // (
+    { 0x00, 0x10, 0x10, 0x18, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x18, 0x10, 0x30, 0x00, 0x00 }, // )
+    { 0x00, 0x00, 0x00, 0x3C, 0x18, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // *
+    { 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x18, 0xFF, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, // +
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x10, 0x10, 0x00, 0x00 }, // ,
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00 }, // .
+    { 0x00, 0x02, 0x06, 0x04, 0x0C, 0x08, 0x08, 0x10, 0x10, 0x30, 0x20, 0x60, 0x40, 0x00, 0x00, 0x00 }, // /
+    { 0x00, 0x18, 0x24, 0x66, 0x42, 0x42, 0x5A, 0x42, 0x42, 0x66, 0x66, 0x3C, 0x00, 0x00, 0x00, 0x00 }, // 0
+    { 0x00, 0x18, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x3E, 0x00, 0x00, 0x00, 0x00 }, // 1
+    { 0x00, 0x38, 0x6C, 0x06, 0x06, 0x06, 0x04, 0x08, 0x10, 0x30, 0x60, 0x7E, 0x00, 0x00, 0x00, 0x00 }, // 2
+    { 0x00, 0x38, 0x6C, 0x06, 0x06, 0x04, 0x1C, 0x06, 0x02, 0x02, 0x06, 0x7C, 0x00, 0x00, 0x00, 0x00 }, // 3
+    { 0x00, 0x04, 0x0C, 0x1C, 0x14, 0x24, 0x24, 0x44, 0x7E, 0x7E, 0x04, 0x04, 0x00, 0x00, 0x00, 0x00 }, // 4
+    { 0x00, 0x3C, 0x7C, 0x60, 0x60, 0x7C, 0x04, 0x06, 0x02, 0x06, 0x06, 0x7C, 0x00, 0x00, 0x00, 0x00 }, // 5
+    { 0x00, 0x1C, 0x34, 0x60, 0x40, 0x5C, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3C, 0x00, 0x00, 0x00, 0x00 }, // 6
+    { 0x00, 0x7E, 0x7E, 0x06, 0x04, 0x0C, 0x08, 0x08, 0x18, 0x10, 0x10, 0x30, 0x00, 0x00, 0x00, 0x00 }, // 7
+    { 0x00, 0x3C, 0x66, 0x42, 0x42, 0x24, 0x3C, 0x66, 0x42, 0x42, 0x66, 0x3C, 0x00, 0x00, 0x00, 0x00 }, // 8
+    { 0x00, 0x38, 0x64, 0x46, 0x42, 0x42, 0x66, 0x3E, 0x02, 0x06, 0x04, 0x3C, 0x00, 0x00, 0x00, 0x00 }, // 9
+    { 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00 }, // :
+    { 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x10, 0x10, 0x00, 0x00 }, // ;
+    { 0x00, 0x00, 0x00, 0x00, 0x03, 0x0E, 0x70, 0xE0, 0x38, 0x0E, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 }, // <
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x7E, 0x7E, 0x00, 0x7E, 0x7E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // =
+    { 0x00, 0x00, 0x00, 0x00, 0xC0, 0x70, 0x0E, 0x07, 0x1C, 0x70, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00 }, // >
+    { 0x00, 0x3C, 0x66, 0x06, 0x06, 0x0C, 0x08, 0x18, 0x18, 0x00, 0x10, 0x18, 0x00, 0x00, 0x00, 0x00 }, // ?
+    { 0x00, 0x00, 0x1C, 0x22, 0x43, 0xCF, 0x93, 0x91, 0x91, 0x93, 0xCF, 0x40, 0x60, 0x3E, 0x00, 0x00 }, // @
+    { 0x00, 0x18, 0x18, 0x18, 0x3C, 0x24, 0x24, 0x66, 0x7E, 0x42, 0x42, 0xC3, 0x00, 0x00, 0x00, 0x00 }, // A
+    { 0x00, 0x78, 0x7E, 0x42, 0x42, 0x66, 0x7C, 0x46, 0x42, 0x42, 0x46, 0x7C, 0x00, 0x00, 0x00, 0x00 }, // B
+    { 0x00, 0x1E, 0x32, 0x60, 0x60, 0x40, 0x40, 0x40, 0x40, 0x60, 0x22, 0x1E, 0x00, 0x00, 0x00, 0x00 }, // C
+    { 0x00, 0x70, 0x7C, 0x46, 0x42, 0x42, 0x42, 0x42, 0x42, 0x46, 0x4C, 0x78, 0x00, 0x00, 0x00, 0x00 }, // D
+    { 0x00, 0x3E, 0x7E, 0x60, 0x60, 0x60, 0x7E, 0x60, 0x60, 0x60, 0x60, 0x7E, 0x00, 0x00, 0x00, 0x00 }, // E
+    { 0x00, 0x3E, 0x7E, 0x60, 0x60, 0x60, 0x7E, 0x60, 0x60, 0x60, 0x60, 0x60, 0x00, 0x00, 0x00, 0x00 }, // F
+    { 0x00, 0x1C, 0x36, 0x60, 0x40, 0x40, 0x46, 0x46, 0x42, 0x42, 0x62, 0x3E, 0x00, 0x00, 0x00, 0x00 }, // G
+    { 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00 }, // H
+    { 0x00, 0x3C, 0x3C, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7E, 0x00, 0x00, 0x00, 0x00 }, // I
+    { 0x00, 0x1C, 0x1C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x4C, 0x78, 0x00, 0x00, 0x00, 0x00 }, // J
+    { 0x00, 0x42, 0x46, 0x4C, 0x48, 0x50, 0x78, 0x68, 0x4C, 0x44, 0x46, 0x43, 0x00, 0x00, 0x00, 0x00 }, // K
+    { 0x00, 0x00, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x7E, 0x00, 0x00, 0x00, 0x00 }, // L
+    { 0x00, 0x42, 0xE7, 0xE7, 0xE7, 0xDB, 0xDB, 0xDB, 0xC3, 0xC3, 0xC3, 0xC3, 0x00, 0x00, 0x00, 0x00 }, // M
+    { 0x00, 0x62, 0x62, 0x62, 0x72, 0x52, 0x5A, 0x4A, 0x4A, 0x4E, 0x46, 0x46, 0x00, 0x00, 0x00, 0x00 }, // N
+    { 0x00, 0x18, 0x24, 0x66, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x66, 0x3C, 0x00, 0x00, 0x00, 0x00 }, // O
+    { 0x00, 0x38, 0x7E, 0x62, 0x62, 0x62, 0x7E, 0x7C, 0x60, 0x60, 0x60, 0x60, 0x00, 0x00, 0x00, 0x00 }, // P
+    { 0x00, 0x18, 0x24, 0x66, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x66, 0x3C, 0x0C, 0x04, 0x00, 0x00 }, // Q
+    { 0x00, 0x78, 0x7C, 0x46, 0x46, 0x46, 0x7C, 0x7C, 0x44, 0x46, 0x42, 0x43, 0x00, 0x00, 0x00, 0x00 }, // R
+    { 0x00, 0x3C, 0x66, 0x40, 0x40, 0x60, 0x3C, 0x06, 0x02, 0x02, 0x46, 0x7C, 0x00, 0x00, 0x00, 0x00 }, // S
+    { 0x00, 0x7E, 0x7E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00 }, // T
+    { 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x66, 0x3C, 0x00, 0x00, 0x00, 0x00 }, // U
+    { 0x00, 0x42, 0x42, 0x42, 0x66, 0x66, 0x24, 0x24, 0x24, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00 }, // V
+    { 0x00, 0x81, 0x81, 0xC3, 0xDB, 0x5A, 0x5A, 0x5A, 0x66, 0x66, 0x66, 0x66, 0x00, 0x00, 0x00, 0x00 }, // W
+    { 0x00, 0x42, 0x62, 0x24, 0x34, 0x18, 0x18, 0x18, 0x34, 0x26, 0x42, 0xC3, 0x00, 0x00, 0x00, 0x00 }, // X
+    { 0x00, 0x42, 0x42, 0x66, 0x24, 0x3C, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00 }, // Y
+    { 0x00, 0x7E, 0x3E, 0x06, 0x04, 0x0C, 0x08, 0x10, 0x30, 0x20, 0x60, 0x7F, 0x00, 0x00, 0x00, 0x00 }, // Z
+    { 0x00, 0x1C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1C, 0x00, 0x00 }, // [
+    { 0x00, 0x40, 0x40, 0x20, 0x20, 0x30, 0x10, 0x18, 0x08, 0x08, 0x04, 0x04, 0x06, 0x00, 0x00, 0x00 }, // backslash
+    { 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x38, 0x00, 0x00 }, // ]
+    { 0x00, 0x18, 0x18, 0x24, 0x42, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00 }, // _
+    { 0x20, 0x10, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // `
+    { 0x00, 0x00, 0x00, 0x00, 0x7C, 0x06, 0x02, 0x3E, 0x62, 0x46, 0x46, 0x3E, 0x00, 0x00, 0x00, 0x00 }, // a
+    { 0x00, 0x60, 0x60, 0x60, 0x7C, 0x66, 0x62, 0x62, 0x62, 0x62, 0x66, 0x7C, 0x00, 0x00, 0x00, 0x00 }, // b
+    { 0x00, 0x00, 0x00, 0x00, 0x1E, 0x20, 0x60, 0x60, 0x60, 0x60, 0x20, 0x1E, 0x00, 0x00, 0x00, 0x00 }, // c
+    { 0x00, 0x06, 0x06, 0x06, 0x3E, 0x66, 0x46, 0x46, 0x46, 0x46, 0x66, 0x3E, 0x00, 0x00, 0x00, 0x00 }, // d
+    { 0x00, 0x00, 0x00, 0x00, 0x3C, 0x66, 0x42, 0x7E, 0x40, 0x40, 0x62, 0x3E, 0x00, 0x00, 0x00, 0x00 }, // e
+    { 0x00, 0x0E, 0x18, 0x10, 0x7E, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00 }, // f
+    { 0x00, 0x00, 0x00, 0x00, 0x3E, 0x66, 0x46, 0x46, 0x46, 0x46, 0x66, 0x3E, 0x06, 0x04, 0x3C, 0x00 }, // g
+    { 0x00, 0x60, 0x60, 0x60, 0x7C, 0x66, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x00, 0x00, 0x00, 0x00 }, // h
+    { 0x00, 0x18, 0x00, 0x00, 0x38, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7E, 0x00, 0x00, 0x00, 0x00 }, // i
+    { 0x00, 0x08, 0x08, 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x18, 0x70, 0x00 }, // j
+    { 0x00, 0x60, 0x60, 0x60, 0x66, 0x6C, 0x68, 0x78, 0x6C, 0x64, 0x66, 0x62, 0x00, 0x00, 0x00, 0x00 }, // k
+    { 0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x18, 0x0E, 0x00, 0x00, 0x00, 0x00 }, // l
+    { 0x00, 0x00, 0x00, 0x00, 0x7E, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A, 0x00, 0x00, 0x00, 0x00 }, // m
+    { 0x00, 0x00, 0x00, 0x00, 0x7C, 0x66, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x00, 0x00, 0x00, 0x00 }, // n
+    { 0x00, 0x00, 0x00, 0x00, 0x3C, 0x66, 0x42, 0x42, 0x42, 0x42, 0x66, 0x3C, 0x00, 0x00, 0x00, 0x00 }, // o
+    { 0x00, 0x00, 0x00, 0x00, 0x7C, 0x66, 0x62, 0x62, 0x62, 0x62, 0x66, 0x7C, 0x60, 0x60, 0x60, 0x00 }, // p
+    { 0x00, 0x00, 0x00, 0x00, 0x3E, 0x66, 0x46, 0x42, 0x42, 0x46, 0x66, 0x3E, 0x02, 0x02, 0x02, 0x00 }, // q
+    { 0x00, 0x00, 0x00, 0x00, 0x3E, 0x38, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00 }, // r
+    { 0x00, 0x00, 0x00, 0x00, 0x3C, 0x60, 0x60, 0x38, 0x0C, 0x06, 0x06, 0x7C, 0x00, 0x00, 0x00, 0x00 }, // s
+    { 0x00, 0x00, 0x10, 0x10, 0x7E, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1E, 0x00, 0x00, 0x00, 0x00 }, // t
+    { 0x00, 0x00, 0x00, 0x00, 0x62, 0x62, 0x62, 0x62, 0x62, 0x66, 0x66, 0x3E, 0x00, 0x00, 0x00, 0x00 }, // u
+    { 0x00, 0x00, 0x00, 0x00, 0x42, 0x42, 0x66, 0x24, 0x24, 0x3C, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00 }, // v
+    { 0x00, 0x00, 0x00, 0x00, 0x81, 0xC3, 0x42, 0x5A, 0x5A, 0x7E, 0x66, 0x24, 0x00, 0x00, 0x00, 0x00 }, // w
+    { 0x00, 0x00, 0x00, 0x00, 0x42, 0x24, 0x3C, 0x18, 0x18, 0x3C, 0x66, 0x42, 0x00, 0x00, 0x00, 0x00 }, // x
+    { 0x00, 0x00, 0x00, 0x00, 0x42, 0x62, 0x26, 0x24, 0x34, 0x1C, 0x18, 0x18, 0x18, 0x10, 0x70, 0x00 }, // y
+    { 0x00, 0x00, 0x00, 0x00, 0x7E, 0x06, 0x0C, 0x08, 0x10, 0x30, 0x20, 0x7E, 0x00, 0x00, 0x00, 0x00 }, // z
+    { 0x00, 0x0C, 0x18, 0x18, 0x18, 0x18, 0x18, 0x30, 0x10, 0x18, 0x18, 0x18, 0x18, 0x0C, 0x00, 0x00 }, // {
+    { 0x00, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00 }, // |
+    { 0x00, 0x30, 0x10, 0x18, 0x18, 0x18, 0x18, 0x0C, 0x08, 0x18, 0x18, 0x18, 0x18, 0x30, 0x00, 0x00 }, // }
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x32, 0x4C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ~
+    { 0x00, 0x00, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x00, 0x00, 0x00 }, // box
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline void lbl_fbcon_outb(lbl_u16 port, lbl_u8 value) {
+    __asm__ __volatile__("outb %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline lbl_u8 lbl_fbcon_inb(lbl_u16 port) {
+    lbl_u8 value;
+    __asm__ __volatile__("inb %1, %0" : "=a"(value) : "Nd"(port));
+    return value;
+}
+
+/**
+ * @brief Checks for a 16550 at `port` through its scratch register.
+ */
+static int lbl_fbcon_serial_present(lbl_u16 port) {
+    lbl_fbcon_outb((lbl_u16)(port + 7), 0x5A);
+    if (lbl_fbcon_inb((lbl_u16)(port + 7)) != 0x5A) {
+        return 0;
+    }
+    lbl_fbcon_outb((lbl_u16)(port + 7), 0xA5);
+    return lbl_fbcon_inb((lbl_u16)(port + 7)) == 0xA5;
+}
+
+/**
+ * @brief 115200 baud, 8N1, FIFOs on, interrupts off.
+ */
+static void lbl_fbcon_serial_start(lbl_u16 port) {
+    lbl_fbcon_outb((lbl_u16)(port + 1), 0x00);  // IER
+    lbl_fbcon_outb((lbl_u16)(port + 3), 0x80);  // LCR: divisor latch
+    lbl_fbcon_outb((lbl_u16)(port + 0), 0x01);  // DLL
+    lbl_fbcon_outb((lbl_u16)(port + 1), 0x00);  // DLM
+    lbl_fbcon_outb((lbl_u16)(port + 3), 0x03);  // LCR: 8N1
+    lbl_fbcon_outb((lbl_u16)(port + 2), 0xC7);  // FCR: enable and clear, 14-byte threshold
+    lbl_fbcon_outb((lbl_u16)(port + 4), 0x03);  // MCR: DTR, RTS
+}
+
+/**
+ * @brief Sends one byte once the transmitter holding register is empty.
+ * @return 0 if the UART never became ready.
+ */
+static int lbl_fbcon_serial_put(lbl_u16 port, lbl_u8 byte) {
+    lbl_u32 spin;
+
+    for (spin = 0; spin < LBL_FBCON_SERIAL_SPIN; spin++) {
+        if (lbl_fbcon_inb((lbl_u16)(port + 5)) & 0x20) { // LSR.THRE
+            lbl_fbcon_outb(port, byte);
+            return 1;
+        }
+    }
+    return 0;
+}
+#else
+static int lbl_fbcon_serial_present(lbl_u16 port) {
+    (void)port;
+    return 0;
+}
+
+static void lbl_fbcon_serial_start(lbl_u16 port) {
+    (void)port;
+}
+
+static int lbl_fbcon_serial_put(lbl_u16 port, lbl_u8 byte) {
+    (void)port;
+    (void)byte;
+    return 0;
+}
+#endif
+
+/**
+ * @brief Places an 8-bit channel level into a channel of `size` bits at `shift`.
+ */
+static lbl_u32 lbl_fbcon_channel(lbl_u32 level, lbl_u8 shift, lbl_u8 size) {
+    if (size == 0 || shift >= 32) {
+        return 0;
+    }
+    if (size < 8) {
+        level >>= 8 - size;
+    } else {
+        level <<= size - 8;
+    }
+    return level << shift;
+}
+
+static lbl_u32 lbl_fbcon_pixel(const LBL_FBCON_MODE* mode, lbl_u32 level) {
+    return lbl_fbcon_channel(level, mode->red_shift, mode->red_size) |
+           lbl_fbcon_channel(level, mode->green_shift, mode->green_size) |
+           lbl_fbcon_channel(level, mode->blue_shift, mode->blue_size);
+}
+
+int lbl_fbcon_init(LBL_FBCON* con, const LBL_FBCON_MODE* mode, void* cache, lbl_usize cache_size) {
+    lbl_u64* pairs = (lbl_u64*)cache;
+    lbl_u32 glyph, y, x;
+
+    lbl_mem_set(con, 0, sizeof(*con));
+    con->version = LBL_FBCON_VERSION;
+
+    if (mode != NULL && mode->base != 0 && mode->bpp == 32 && (mode->pitch & 3) == 0 &&
+        mode->width >= LBL_FBCON_GLYPH_WIDTH && mode->height >= LBL_FBCON_GLYPH_HEIGHT &&
+        mode->pitch >= mode->width * 4 && cache != NULL && cache_size >= LBL_FBCON_CACHE_SIZE) {
+        con->framebuffer = mode->base;
+        con->glyph_cache = (lbl_u64)(lbl_usize)cache;
+        con->pitch = mode->pitch;
+        con->height = mode->height;
+        con->columns = mode->width / LBL_FBCON_GLYPH_WIDTH;
+        con->rows = mode->height / LBL_FBCON_GLYPH_HEIGHT;
+        // Moving the screen reads the framebuffer, which is uncached: scroll a
+        // quarter of it at a time so a long burst of output costs few moves.
+        con->scroll_rows = con->rows >= 4 ? con->rows / 4 : 1;
+        con->foreground = lbl_fbcon_pixel(mode, LBL_FBCON_FOREGROUND_LEVEL);
+        con->background = lbl_fbcon_pixel(mode, LBL_FBCON_BACKGROUND_LEVEL);
+        for (glyph = 0; glyph < LBL_FBCON_GLYPH_COUNT; glyph++) {
+            for (y = 0; y < LBL_FBCON_GLYPH_HEIGHT; y++) {
+                lbl_u8 bits = lbl_fbcon_font[glyph][y];
+                // Written as the lbl_u64 lbl_fbcon_draw reads: the left pixel of
+                // each pair in the low half, which is the lower address.
+                for (x = 0; x < LBL_FBCON_GLYPH_WIDTH; x += 2) {
+                    lbl_u64 left = (bits & (0x80 >> x)) ? con->foreground : con->background;
+                    lbl_u64 right = (bits & (0x40 >> x)) ? con->foreground : con->background;
+                    *pairs++ = left | (right << 32);
+                }
+            }
+        }
+        con->flags |= LBL_FBCON_FLAG_FRAMEBUFFER;
+    }
+
+    if (LBL_FBCON_SERIAL_PORT != 0 && lbl_fbcon_serial_present(LBL_FBCON_SERIAL_PORT)) {
+        con->serial_port = LBL_FBCON_SERIAL_PORT;
+        con->flags |= LBL_FBCON_FLAG_SERIAL;
+    }
+    return (con->flags & (LBL_FBCON_FLAG_FRAMEBUFFER | LBL_FBCON_FLAG_SERIAL)) ? 0 : -1;
+}
+
+/**
+ * @brief First write: takes the screen over from the firmware and programs the UART.
+ */
+static void lbl_fbcon_start(LBL_FBCON* con) {
+    if (con->flags & LBL_FBCON_FLAG_FRAMEBUFFER) {
+        lbl_mem_fill32((void*)(lbl_usize)con->framebuffer, con->background,
+                       (lbl_usize)con->height * con->pitch / 4);
+    }
+    if (con->flags & LBL_FBCON_FLAG_SERIAL) {
+        lbl_fbcon_serial_start(con->serial_port);
+    }
+    con->flags |= LBL_FBCON_FLAG_STARTED;
+}
+
+/**
+ * @brief Copies a glyph's rows from the cache into cell (column, row), eight
+ * pixels (32 bytes) per scan line as four 64-bit stores.
+ */
+static void lbl_fbcon_draw(const LBL_FBCON* con, lbl_u32 glyph, lbl_u32 column, lbl_u32 row) {
+    const lbl_u64* src = (const lbl_u64*)(lbl_usize)con->glyph_cache +
+                         (lbl_usize)glyph * LBL_FBCON_GLYPH_HEIGHT * LBL_FBCON_ROW_WORDS;
+    lbl_u8* line = (lbl_u8*)(lbl_usize)con->framebuffer +
+                   (lbl_usize)row * LBL_FBCON_GLYPH_HEIGHT * con->pitch +
+                   (lbl_usize)column * LBL_FBCON_GLYPH_WIDTH * 4;
+    lbl_u32 y;
+
+    for (y = 0; y < LBL_FBCON_GLYPH_HEIGHT; y++) {
+        volatile lbl_u64* dst = (volatile lbl_u64*)line;
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = src[3];
+        src += LBL_FBCON_ROW_WORDS;
+        line += con->pitch;
+    }
+}
+
+/**
+ * @brief Moves the text up by scroll_rows rows in one memmove and clears the
+ * rows that become free.
+ */
+static void lbl_fbcon_scroll(LBL_FBCON* con) {
+    lbl_u8* base = (lbl_u8*)(lbl_usize)con->framebuffer;
+    lbl_usize row_bytes = (lbl_usize)LBL_FBCON_GLYPH_HEIGHT * con->pitch;
+    lbl_u32 by = con->scroll_rows;
+
+    lbl_mem_move(base, base + by * row_bytes, (con->rows - by) * row_bytes);
+    lbl_mem_fill32(base + (con->rows - by) * row_bytes, con->background, by * row_bytes / 4);
+    con->row -= by;
+}
+
+static void lbl_fbcon_newline(LBL_FBCON* con) {
+    con->column = 0;
+    con->row++;
+    if (con->row >= con->rows) {
+        lbl_fbcon_scroll(con);
+    }
+}
+
+static void lbl_fbcon_serial_byte(LBL_FBCON* con, lbl_u8 byte) {
+    if ((byte == '\n' && !lbl_fbcon_serial_put(con->serial_port, '\r')) ||
+        !lbl_fbcon_serial_put(con->serial_port, byte)) {
+        con->flags &= ~LBL_FBCON_FLAG_SERIAL; // Stuck transmitter: stop paying the timeout per byte
+    }
+}
+
+void lbl_fbcon_write(LBL_FBCON* con, const char* text, lbl_usize length) {
+    lbl_usize i;
+
+    if (con == NULL || text == NULL) {
+        return;
+    }
+    if (!(con->flags & LBL_FBCON_FLAG_STARTED)) {
+        lbl_fbcon_start(con);
+    }
+    for (i = 0; i < length; i++) {
+        lbl_u8 byte = (lbl_u8)text[i];
+
+        if (con->flags & LBL_FBCON_FLAG_SERIAL) {
+            lbl_fbcon_serial_byte(con, byte);
+        }
+        if (!(con->flags & LBL_FBCON_FLAG_FRAMEBUFFER)) {
+            continue;
+        }
+        switch (byte) {
+            case '\n':
+                lbl_fbcon_newline(con);
+                break;
+            case '\r':
+                con->column = 0;
+                break;
+            case '\t':
+                con->column = (con->column + LBL_FBCON_TAB_WIDTH) & ~(lbl_u32)(LBL_FBCON_TAB_WIDTH - 1);
+                if (con->column > con->columns) {
+                    con->column = con->columns; // Wraps with the next character
+                }
+                break;
+            case '\b':
+                if (con->column > 0) {
+                    con->column--;
+                }
+                break;
+            default:
+                if (con->column >= con->columns) {
+                    lbl_fbcon_newline(con);
+                }
+                lbl_fbcon_draw(con,
+                               (byte >= LBL_FBCON_FIRST_GLYPH && byte < LBL_FBCON_FIRST_GLYPH + LBL_FBCON_BOX_GLYPH)
+                                   ? byte - LBL_FBCON_FIRST_GLYPH : LBL_FBCON_BOX_GLYPH,
+                               con->column, con->row);
+                con->column++;
+                break;
+        }
+    }
+}
+
+void lbl_fbcon_puts(LBL_FBCON* con, const char* text) {
+    lbl_usize length = 0;
+
+    if (text == NULL) {
+        return;
+    }
+    while (text[length] != '\0') {
+        length++;
+    }
+    lbl_fbcon_write(con, text, length);
+}
+
+void lbl_fbcon_put_hex(LBL_FBCON* con, lbl_u64 value) {
+    static const char digits[] = "0123456789abcdef";
+    char text[18];
+    lbl_usize start = sizeof(text);
+
+    do {
+        text[--start] = digits[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+    text[--start] = 'x';
+    text[--start] = '0';
+    lbl_fbcon_write(con, text + start, sizeof(text) - start);
+}
@@ -0,0 +1,107 @@
+// Lionbootloader - Stage 1 - Framebuffer Text Console
+// File: stage1/common/stage1_fbcon.h
+//
+// Text output that needs nothing but a linear 32 bpp framebuffer and, on x86, a
+// 16550 UART: it keeps working after ExitBootServices and is handed to the core
+// (LBL_BOOT_RECORD_EARLY_CONSOLE), which prints through the same state until its
+// GUI is up. The 8x16 font is expanded once, at init, into a glyph cache of
+// ready-made pixels in the framebuffer's own format, so a character is sixteen
+// row copies of eight pixels and no per-pixel work is ever done. No allocation
+// and no firmware calls: the caller provides the cache memory.
+
+#ifndef STAGE1_FBCON_H
+#define STAGE1_FBCON_H
+
+#include "stage1_loader_utils.h" // lbl_u8 / lbl_u16 / lbl_u32 / lbl_u64 / lbl_usize
+
+#define LBL_FBCON_VERSION           1
+#define LBL_FBCON_GLYPH_WIDTH       8
+#define LBL_FBCON_GLYPH_HEIGHT      16
+#define LBL_FBCON_FIRST_GLYPH       0x20    // ' '
+#define LBL_FBCON_GLYPH_COUNT       96      // ' ' to '~', then a box drawn for anything else
+#define LBL_FBCON_TAB_WIDTH         8
+
+// Bytes of glyph cache lbl_fbcon_init needs: every glyph row as native pixels,
+// two to a 64-bit word.
+#define LBL_FBCON_CACHE_SIZE \
+    (LBL_FBCON_GLYPH_COUNT * LBL_FBCON_GLYPH_HEIGHT * LBL_FBCON_GLYPH_WIDTH * 4)
+
+// UART the console mirrors to; 0 disables the mirror. Override with -D.
+#ifndef LBL_FBCON_SERIAL_PORT
+#if defined(__x86_64__) || defined(__i386__)
+#define LBL_FBCON_SERIAL_PORT       0x3F8   // COM1
+#else
+#define LBL_FBCON_SERIAL_PORT       0
+#endif
+#endif
+
+// LBL_FBCON.flags
+#define LBL_FBCON_FLAG_FRAMEBUFFER  0x00000001 // Drawing into the framebuffer
+#define LBL_FBCON_FLAG_SERIAL       0x00000002 // Mirroring to the UART at serial_port
+#define LBL_FBCON_FLAG_STARTED      0x00000004 // Screen cleared and UART programmed (first write)
+
+// The framebuffer as the loader describes it (LBL_BOOT_INFO framebuffer_*).
+typedef struct {
+    lbl_u64 base;
+    lbl_u32 width;
+    lbl_u32 height;
+    lbl_u32 pitch;                  // Bytes per scan line
+    lbl_u8  bpp;                    // Only 32 is drawn to
+    lbl_u8  red_shift;
+    lbl_u8  red_size;
+    lbl_u8  green_shift;
+    lbl_u8  green_size;
+    lbl_u8  blue_shift;
+    lbl_u8  blue_size;
+    lbl_u8  reserved;
+} LBL_FBCON_MODE;
+
+// Console state, shared with the core: Stage 1 keeps it inside the boot record,
+// so the core carries on at the same cursor. Same layout on every loader.
+typedef struct {
+    lbl_u32 version;                // LBL_FBCON_VERSION
+    lbl_u32 flags;                  // LBL_FBCON_FLAG_*
+    lbl_u64 framebuffer;            // Framebuffer base; cleared as a whole on the first write
+    lbl_u64 glyph_cache;            // lbl_u64[GLYPH_COUNT][GLYPH_HEIGHT][GLYPH_WIDTH / 2] native pixel pairs
+    lbl_u32 pitch;                  // Bytes per scan line
+    lbl_u32 height;                 // Scan lines
+    lbl_u32 columns;                // Text cells, from the top left corner
+    lbl_u32 rows;
+    lbl_u32 column;                 // Cursor
+    lbl_u32 row;
+    lbl_u32 foreground;             // Native pixel values the cache was expanded with
+    lbl_u32 background;
+    lbl_u32 scroll_rows;            // Text rows one scroll moves the screen by
+    lbl_u16 serial_port;            // 16550 I/O base (0 = no mirror)
+    lbl_u16 reserved;
+} LBL_FBCON;
+
+/**
+ * @brief Sets up a console: expands the font into `cache` for the framebuffer's
+ * pixel format and probes the UART at LBL_FBCON_SERIAL_PORT. Writes nothing to
+ * either, so it may run while the firmware still owns the screen.
+ * @param mode NULL, or a framebuffer that is not 32 bpp, leaves only the UART.
+ * @param cache At least LBL_FBCON_CACHE_SIZE bytes, 8-byte aligned; must stay
+ *        reserved as long as the console is used (NULL: UART only).
+ * @return 0 if at least one output is usable, -1 otherwise.
+ */
+int lbl_fbcon_init(LBL_FBCON* con, const LBL_FBCON_MODE* mode, void* cache, lbl_usize cache_size);
+
+/**
+ * @brief Prints `length` bytes of ASCII. Handles '\n', '\r', '\t' and '\b';
+ * other control and non-ASCII bytes are drawn as a box. The first call clears
+ * the screen. Touches memory and I/O ports only.
+ */
+void lbl_fbcon_write(LBL_FBCON* con, const char* text, lbl_usize length);
+
+/**
+ * @brief Prints a NUL-terminated string.
+ */
+void lbl_fbcon_puts(LBL_FBCON* con, const char* text);
+
+/**
+ * @brief Prints `value` in hexadecimal with a "0x" prefix, without leading zeros.
+ */
+void lbl_fbcon_put_hex(LBL_FBCON* con, lbl_u64 value);
+
+#endif // STAGE1_FBCON_H
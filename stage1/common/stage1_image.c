@@ -0,0 +1,577 @@
+// Lionbootloader - Stage 1 - ELF64 / PE32+ Core Image Layout
+// File: stage1/common/stage1_image.c
+
+#include "stage1_image.h"
+#include "stage1_mem.h"
+
+#define LBL_IMAGE_PAGE_SIZE     0x1000ULL
+
+// Machine numbers and the "relative" relocation of the architecture Stage 1 runs
+// on. The core is always built for the same one, so anything else is refused.
+#if defined(__x86_64__)
+#define LBL_IMAGE_ELF_MACHINE       62      // EM_X86_64
+#define LBL_IMAGE_ELF_R_RELATIVE    8       // R_X86_64_RELATIVE
+#define LBL_IMAGE_PE_MACHINE        0x8664  // IMAGE_FILE_MACHINE_AMD64
+#elif defined(__aarch64__)
+#define LBL_IMAGE_ELF_MACHINE       183     // EM_AARCH64
+#define LBL_IMAGE_ELF_R_RELATIVE    1027    // R_AARCH64_RELATIVE
+#define LBL_IMAGE_PE_MACHINE        0xAA64  // IMAGE_FILE_MACHINE_ARM64
+#elif defined(__riscv) && __riscv_xlen == 64
+#define LBL_IMAGE_ELF_MACHINE       243     // EM_RISCV
+#define LBL_IMAGE_ELF_R_RELATIVE    3       // R_RISCV_RELATIVE
+#define LBL_IMAGE_PE_MACHINE        0x5064  // IMAGE_FILE_MACHINE_RISCV64
+#else
+#define LBL_IMAGE_ELF_MACHINE       0       // No 64-bit core can run here
+#define LBL_IMAGE_ELF_R_RELATIVE    0
+#define LBL_IMAGE_PE_MACHINE        0
+#endif
+
+// ELF64 (System V gABI)
+#define LBL_ELF_EHDR_SIZE       64
+#define LBL_ELF_PHDR_SIZE       56
+#define LBL_ELF_ET_EXEC         2
+#define LBL_ELF_ET_DYN          3
+#define LBL_ELF_PT_LOAD         1
+#define LBL_ELF_PT_DYNAMIC      2
+#define LBL_ELF_PT_INTERP       3
+#define LBL_ELF_PT_NOTE         4
+#define LBL_ELF_PF_X            0x1
+#define LBL_ELF_PF_W            0x2
+#define LBL_ELF_PF_R            0x4
+#define LBL_ELF_DT_NULL         0
+#define LBL_ELF_DT_RELA         7
+#define LBL_ELF_DT_RELASZ       8
+#define LBL_ELF_DT_RELAENT      9
+#define LBL_ELF_DT_RELSZ        18
+#define LBL_ELF_DT_RELRSZ       35
+#define LBL_ELF_DT_RELR         36
+#define LBL_ELF_DT_RELRENT      37
+#define LBL_ELF_RELA_SIZE       24
+
+// PE32+ (PE/COFF specification)
+#define LBL_PE_DOS_LFANEW       0x3C
+#define LBL_PE_COFF_SIZE        20
+#define LBL_PE_OPT_MAGIC_PE32P  0x20B
+#define LBL_PE_OPT_MIN_SIZE     112         // Up to the data directories
+#define LBL_PE_DIR_BASERELOC    5
+#define LBL_PE_SECTION_SIZE     40
+#define LBL_PE_FILE_RELOCS_STRIPPED 0x0001
+#define LBL_PE_SCN_MEM_EXECUTE  0x20000000u
+#define LBL_PE_SCN_MEM_READ     0x40000000u
+#define LBL_PE_SCN_MEM_WRITE    0x80000000u
+#define LBL_PE_REL_BASED_ABSOLUTE 0
+#define LBL_PE_REL_BASED_DIR64  10
+
+// Headers and relocation targets carry no alignment guarantee; constant-size
+// __builtin_memcpy compiles to a plain (unaligned) load/store, as in stage1_lz4.c.
+static lbl_u16 lbl_image_rd16(const lbl_u8* p) {
+    lbl_u16 v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static lbl_u32 lbl_image_rd32(const lbl_u8* p) {
+    lbl_u32 v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static lbl_u64 lbl_image_rd64(const lbl_u8* p) {
+    lbl_u64 v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static void lbl_image_wr64(lbl_u8* p, lbl_u64 v) {
+    __builtin_memcpy(p, &v, sizeof(v));
+}
+
+// [offset, offset + size) lies inside [0, limit), without overflowing.
+static int lbl_image_in_range(lbl_u64 offset, lbl_u64 size, lbl_u64 limit) {
+    return offset <= limit && size <= limit - offset;
+}
+
+static int lbl_image_is_pow2(lbl_u64 v) {
+    return v != 0 && (v & (v - 1)) == 0;
+}
+
+static int lbl_image_bytes_equal(const lbl_u8* a, const char* b, lbl_usize len) {
+    lbl_usize i;
+
+    for (i = 0; i < len; i++) {
+        if (a[i] != (lbl_u8)b[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+lbl_u32 lbl_image_detect(const void* data, lbl_usize len) {
+    const lbl_u8* p = (const lbl_u8*)data;
+
+    if (len >= 4 && p[0] == 0x7F && p[1] == 'E' && p[2] == 'L' && p[3] == 'F') {
+        return LBL_IMAGE_FORMAT_ELF64;
+    }
+    if (len >= 2 && p[0] == 'M' && p[1] == 'Z') {
+        return LBL_IMAGE_FORMAT_PE32PLUS;
+    }
+    return LBL_IMAGE_FORMAT_NONE;
+}
+
+/**
+ * @brief Appends a segment, keeping the layout invariants: each segment starts at
+ * or after the end of the previous one, both in memory and (if it has file data)
+ * in the file. Linkers emit segments and sections in that order.
+ */
+static int lbl_image_add_segment(LBL_IMAGE_LAYOUT* layout, lbl_u64* file_end, lbl_u64 file_offset,
+                                 lbl_u64 file_size, lbl_u64 mem_offset, lbl_u64 mem_size, lbl_u32 flags) {
+    LBL_IMAGE_SEGMENT* seg;
+
+    if (layout->segment_count == LBL_IMAGE_MAX_SEGMENTS || file_size > mem_size ||
+        !lbl_image_in_range(mem_offset, mem_size, LBL_IMAGE_MAX_SIZE)) {
+        return -1;
+    }
+    if (layout->segment_count != 0) {
+        const LBL_IMAGE_SEGMENT* prev = &layout->segments[layout->segment_count - 1];
+        if (mem_offset < prev->mem_offset + prev->mem_size) {
+            return -1;
+        }
+    }
+    if (file_size != 0) {
+        if (file_offset < *file_end) {
+            return -1;
+        }
+        *file_end = file_offset + file_size;
+    }
+
+    seg = &layout->segments[layout->segment_count++];
+    seg->file_offset = file_size ? file_offset : 0;
+    seg->file_size = file_size;
+    seg->mem_offset = mem_offset;
+    seg->mem_size = mem_size;
+    seg->flags = flags;
+    seg->reserved = 0;
+    if (mem_offset + mem_size > layout->memory_size) {
+        layout->memory_size = mem_offset + mem_size;
+    }
+    return 0;
+}
+
+static int lbl_image_parse_elf(const lbl_u8* h, lbl_usize len, lbl_u64 file_size, LBL_IMAGE_LAYOUT* layout) {
+    lbl_u16 type, phnum, i;
+    lbl_u64 phoff, entry;
+    lbl_u64 vbase = 0, pbase = 0;
+    lbl_u64 file_end = 0;
+    lbl_u64 note_vaddr = 0, note_size = 0;
+    int have_base = 0;
+
+    if (len < LBL_ELF_EHDR_SIZE || h[4] != 2 /* ELFCLASS64 */ || h[5] != 1 /* ELFDATA2LSB */ ||
+        h[6] != 1 /* EV_CURRENT */) {
+        return -1;
+    }
+    type = lbl_image_rd16(h + 16);
+    if ((type != LBL_ELF_ET_EXEC && type != LBL_ELF_ET_DYN) || LBL_IMAGE_ELF_MACHINE == 0 ||
+        lbl_image_rd16(h + 18) != LBL_IMAGE_ELF_MACHINE) {
+        return -1;
+    }
+    entry = lbl_image_rd64(h + 24);
+    phoff = lbl_image_rd64(h + 32);
+    phnum = lbl_image_rd16(h + 56);
+    if (lbl_image_rd16(h + 54) != LBL_ELF_PHDR_SIZE || phnum == 0 ||
+        !lbl_image_in_range(phoff, (lbl_u64)phnum * LBL_ELF_PHDR_SIZE, len)) {
+        return -1;
+    }
+
+    layout->format = LBL_IMAGE_FORMAT_ELF64;
+    layout->alignment = LBL_IMAGE_PAGE_SIZE;
+    layout->relocatable = (type == LBL_ELF_ET_DYN);
+
+    for (i = 0; i < phnum; i++) {
+        const lbl_u8* ph = h + phoff + (lbl_u64)i * LBL_ELF_PHDR_SIZE;
+        lbl_u32 p_type = lbl_image_rd32(ph);
+        lbl_u32 p_flags = lbl_image_rd32(ph + 4);
+        lbl_u64 p_offset = lbl_image_rd64(ph + 8);
+        lbl_u64 p_vaddr = lbl_image_rd64(ph + 16);
+        lbl_u64 p_paddr = lbl_image_rd64(ph + 24);
+        lbl_u64 p_filesz = lbl_image_rd64(ph + 32);
+        lbl_u64 p_memsz = lbl_image_rd64(ph + 40);
+        lbl_u64 p_align = lbl_image_rd64(ph + 48);
+        lbl_u32 flags = 0;
+
+        if (p_type == LBL_ELF_PT_INTERP) {
+            return -1; // Wants a dynamic linker
+        }
+        if (p_type == LBL_ELF_PT_DYNAMIC) {
+            layout->reloc_kind = LBL_IMAGE_RELOC_ELF_DYNAMIC;
+            layout->reloc_offset = p_vaddr; // Rebased below, once vbase is known
+            layout->reloc_size = p_memsz;
+            continue;
+        }
+        if (p_type == LBL_ELF_PT_NOTE && note_size == 0) {
+            note_vaddr = p_vaddr;
+            note_size = p_filesz;
+            continue;
+        }
+        if (p_type != LBL_ELF_PT_LOAD || p_memsz == 0) {
+            continue;
+        }
+        if (!lbl_image_in_range(p_offset, p_filesz, file_size)) {
+            return -1;
+        }
+        if (!have_base) {
+            // mem_offset 0 is the page holding the first segment.
+            vbase = p_vaddr & ~(LBL_IMAGE_PAGE_SIZE - 1);
+            pbase = p_paddr & ~(LBL_IMAGE_PAGE_SIZE - 1);
+            have_base = 1;
+        }
+        // One allocation holds the image, so every segment must sit at the same
+        // distance from its link address in physical as in virtual memory.
+        if (p_vaddr < vbase || p_paddr < pbase || p_vaddr - vbase != p_paddr - pbase) {
+            return -1;
+        }
+        if (p_align > layout->alignment) {
+            if (!lbl_image_is_pow2(p_align)) {
+                return -1;
+            }
+            layout->alignment = p_align;
+        }
+        if (p_flags & LBL_ELF_PF_R) flags |= LBL_IMAGE_SEGMENT_READ;
+        if (p_flags & LBL_ELF_PF_W) flags |= LBL_IMAGE_SEGMENT_WRITE;
+        if (p_flags & LBL_ELF_PF_X) flags |= LBL_IMAGE_SEGMENT_EXEC;
+        if (lbl_image_add_segment(layout, &file_end, p_offset, p_filesz, p_vaddr - vbase, p_memsz, flags) != 0) {
+            return -1;
+        }
+    }
+    if (!have_base || entry < vbase) {
+        return -1;
+    }
+
+    layout->preferred_base = pbase;
+    layout->link_base = vbase;
+    layout->entry_offset = entry - vbase;
+    if (layout->reloc_kind != LBL_IMAGE_RELOC_NONE) {
+        if (layout->reloc_offset < vbase) {
+            return -1;
+        }
+        layout->reloc_offset -= vbase;
+    }
+    // The note is only usable if it was loaded along with a segment's file data.
+    if (note_size != 0 && note_vaddr >= vbase) {
+        lbl_u32 s;
+        for (s = 0; s < layout->segment_count; s++) {
+            const LBL_IMAGE_SEGMENT* seg = &layout->segments[s];
+            if (note_vaddr - vbase >= seg->mem_offset &&
+                lbl_image_in_range(note_vaddr - vbase - seg->mem_offset, note_size, seg->file_size)) {
+                layout->note_offset = note_vaddr - vbase;
+                layout->note_size = note_size;
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+static int lbl_image_parse_pe(const lbl_u8* h, lbl_usize len, lbl_u64 file_size, LBL_IMAGE_LAYOUT* layout) {
+    lbl_u32 pe, opt, sections, i;
+    lbl_u16 section_count, opt_size, characteristics;
+    lbl_u32 section_align, image_size, headers_size, dir_count;
+    lbl_u64 file_end = 0;
+
+    if (len < LBL_PE_DOS_LFANEW + 4) {
+        return -1;
+    }
+    pe = lbl_image_rd32(h + LBL_PE_DOS_LFANEW);
+    if (!lbl_image_in_range(pe, 4 + LBL_PE_COFF_SIZE, len) || lbl_image_rd32(h + pe) != 0x00004550 /* "PE\0\0" */) {
+        return -1;
+    }
+    if (LBL_IMAGE_PE_MACHINE == 0 || lbl_image_rd16(h + pe + 4) != LBL_IMAGE_PE_MACHINE) {
+        return -1;
+    }
+    section_count = lbl_image_rd16(h + pe + 6);
+    opt_size = lbl_image_rd16(h + pe + 20);
+    characteristics = lbl_image_rd16(h + pe + 22);
+    opt = pe + 4 + LBL_PE_COFF_SIZE;
+    sections = opt + opt_size;
+    if (opt_size < LBL_PE_OPT_MIN_SIZE || !lbl_image_in_range(opt, opt_size, len) ||
+        !lbl_image_in_range(sections, (lbl_u64)section_count * LBL_PE_SECTION_SIZE, len) ||
+        lbl_image_rd16(h + opt) != LBL_PE_OPT_MAGIC_PE32P) {
+        return -1;
+    }
+
+    section_align = lbl_image_rd32(h + opt + 32);
+    image_size = lbl_image_rd32(h + opt + 56);
+    headers_size = lbl_image_rd32(h + opt + 60);
+    dir_count = lbl_image_rd32(h + opt + 108);
+    if (!lbl_image_is_pow2(section_align) || image_size == 0 || headers_size == 0 ||
+        !lbl_image_in_range(0, headers_size, file_size)) {
+        return -1;
+    }
+
+    layout->format = LBL_IMAGE_FORMAT_PE32PLUS;
+    layout->preferred_base = lbl_image_rd64(h + opt + 24);
+    layout->link_base = layout->preferred_base;
+    layout->alignment = section_align > LBL_IMAGE_PAGE_SIZE ? section_align : LBL_IMAGE_PAGE_SIZE;
+    layout->entry_offset = lbl_image_rd32(h + opt + 16);
+    layout->relocatable = !(characteristics & LBL_PE_FILE_RELOCS_STRIPPED);
+    if (dir_count > LBL_PE_DIR_BASERELOC &&
+        lbl_image_in_range(112 + 8 * (LBL_PE_DIR_BASERELOC + 1), 0, opt_size)) {
+        const lbl_u8* dir = h + opt + 112 + 8 * LBL_PE_DIR_BASERELOC;
+        if (lbl_image_rd32(dir + 4) != 0) {
+            layout->reloc_kind = LBL_IMAGE_RELOC_PE_BASE;
+            layout->reloc_offset = lbl_image_rd32(dir);
+            layout->reloc_size = lbl_image_rd32(dir + 4);
+        }
+    }
+
+    // The headers are part of the image (RVA 0), as the PE loader in firmware does it.
+    if (lbl_image_add_segment(layout, &file_end, 0, headers_size, 0, headers_size, LBL_IMAGE_SEGMENT_READ) != 0) {
+        return -1;
+    }
+    for (i = 0; i < section_count; i++) {
+        const lbl_u8* sh = h + sections + i * LBL_PE_SECTION_SIZE;
+        lbl_u32 vsize = lbl_image_rd32(sh + 8);
+        lbl_u32 rva = lbl_image_rd32(sh + 12);
+        lbl_u32 raw_size = lbl_image_rd32(sh + 16);
+        lbl_u32 raw_ptr = lbl_image_rd32(sh + 20);
+        lbl_u32 scn = lbl_image_rd32(sh + 36);
+        lbl_u64 mem_size = vsize ? vsize : raw_size;
+        lbl_u64 data_size = raw_ptr ? (raw_size < mem_size ? raw_size : mem_size) : 0;
+        lbl_u32 flags = 0;
+
+        if (mem_size == 0) {
+            continue;
+        }
+        // SizeOfRawData is rounded up to FileAlignment and may run past the file.
+        if (data_size != 0 && !lbl_image_in_range(raw_ptr, data_size, file_size)) {
+            return -1;
+        }
+        if (scn & LBL_PE_SCN_MEM_READ) flags |= LBL_IMAGE_SEGMENT_READ;
+        if (scn & LBL_PE_SCN_MEM_WRITE) flags |= LBL_IMAGE_SEGMENT_WRITE;
+        if (scn & LBL_PE_SCN_MEM_EXECUTE) flags |= LBL_IMAGE_SEGMENT_EXEC;
+        if (lbl_image_add_segment(layout, &file_end, raw_ptr, data_size, rva, mem_size, flags) != 0) {
+            return -1;
+        }
+        if (layout->note_size == 0 && data_size != 0 &&
+            lbl_image_bytes_equal(sh, LBL_IMAGE_PE_HEADER_SECTION, 8)) {
+            layout->note_offset = rva;
+            layout->note_size = data_size;
+        }
+    }
+    if (image_size > layout->memory_size) {
+        layout->memory_size = image_size;
+    }
+    return 0;
+}
+
+int lbl_image_parse(const void* headers, lbl_usize headers_len, lbl_u64 file_size,
+                    LBL_IMAGE_LAYOUT* layout) {
+    const lbl_u8* h = (const lbl_u8*)headers;
+    int result = -1;
+
+    lbl_mem_set(layout, 0, sizeof(*layout));
+    if (headers_len > file_size) {
+        return -1;
+    }
+    switch (lbl_image_detect(h, headers_len)) {
+    case LBL_IMAGE_FORMAT_ELF64:
+        result = lbl_image_parse_elf(h, headers_len, file_size, layout);
+        break;
+    case LBL_IMAGE_FORMAT_PE32PLUS:
+        result = lbl_image_parse_pe(h, headers_len, file_size, layout);
+        break;
+    default:
+        break;
+    }
+    if (result != 0) {
+        return -1;
+    }
+
+    layout->memory_size = (layout->memory_size + LBL_IMAGE_PAGE_SIZE - 1) & ~(LBL_IMAGE_PAGE_SIZE - 1);
+    if (layout->memory_size > LBL_IMAGE_MAX_SIZE || layout->entry_offset >= layout->memory_size ||
+        (layout->reloc_kind != LBL_IMAGE_RELOC_NONE &&
+         !lbl_image_in_range(layout->reloc_offset, layout->reloc_size, layout->memory_size))) {
+        return -1;
+    }
+    return 0;
+}
+
+// Adds `delta` to the 64-bit word at link address `where`, if it lies in the image.
+static int lbl_image_patch(lbl_u8* image, lbl_u64 size, lbl_u64 link_base, lbl_u64 where, lbl_u64 value) {
+    lbl_u64 offset = where - link_base;
+
+    if (where < link_base || !lbl_image_in_range(offset, 8, size)) {
+        return -1;
+    }
+    lbl_image_wr64(image + offset, value);
+    return 0;
+}
+
+static int lbl_image_relocate_elf(const LBL_IMAGE_LAYOUT* layout, lbl_u8* image, lbl_u64 delta) {
+    const lbl_u8* dyn = image + layout->reloc_offset;
+    lbl_u64 base = layout->link_base, size = layout->memory_size;
+    lbl_u64 rela = 0, rela_size = 0, rela_ent = LBL_ELF_RELA_SIZE;
+    lbl_u64 relr = 0, relr_size = 0, relr_ent = 8;
+    lbl_u64 i;
+
+    for (i = 0; i + 16 <= layout->reloc_size; i += 16) {
+        lbl_u64 tag = lbl_image_rd64(dyn + i);
+        lbl_u64 val = lbl_image_rd64(dyn + i + 8);
+        if (tag == LBL_ELF_DT_NULL) {
+            break;
+        }
+        switch (tag) {
+        case LBL_ELF_DT_RELA:    rela = val; break;
+        case LBL_ELF_DT_RELASZ:  rela_size = val; break;
+        case LBL_ELF_DT_RELAENT: rela_ent = val; break;
+        case LBL_ELF_DT_RELR:    relr = val; break;
+        case LBL_ELF_DT_RELRSZ:  relr_size = val; break;
+        case LBL_ELF_DT_RELRENT: relr_ent = val; break;
+        case LBL_ELF_DT_RELSZ:
+            if (val != 0) {
+                return -1; // REL tables do not occur on the 64-bit targets
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (rela_size != 0) {
+        if (rela_ent < LBL_ELF_RELA_SIZE || rela < base ||
+            !lbl_image_in_range(rela - base, rela_size, size)) {
+            return -1;
+        }
+        for (i = 0; i + rela_ent <= rela_size; i += rela_ent) {
+            const lbl_u8* r = image + (rela - base) + i;
+            lbl_u64 r_offset = lbl_image_rd64(r);
+            lbl_u32 r_type = (lbl_u32)lbl_image_rd64(r + 8);
+            lbl_u64 r_addend = lbl_image_rd64(r + 16);
+            if (r_type == 0) {
+                continue; // R_*_NONE
+            }
+            if (r_type != LBL_IMAGE_ELF_R_RELATIVE ||
+                lbl_image_patch(image, size, base, r_offset, r_addend + delta) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    // RELR: an even word is an address to patch, an odd word a bitmap of the 63
+    // words following the last address.
+    if (relr_size != 0) {
+        lbl_u64 where = base;
+        if (relr_ent != 8 || relr < base || !lbl_image_in_range(relr - base, relr_size, size)) {
+            return -1;
+        }
+        for (i = 0; i + 8 <= relr_size; i += 8) {
+            lbl_u64 entry = lbl_image_rd64(image + (relr - base) + i);
+            if ((entry & 1) == 0) {
+                if (entry < base || !lbl_image_in_range(entry - base, 8, size)) {
+                    return -1;
+                }
+                lbl_image_wr64(image + (entry - base), lbl_image_rd64(image + (entry - base)) + delta);
+                where = entry + 8;
+            } else {
+                lbl_u32 bit;
+                for (bit = 1; bit < 64; bit++) {
+                    lbl_u64 at = where - base + (lbl_u64)(bit - 1) * 8;
+                    if (!((entry >> bit) & 1)) {
+                        continue;
+                    }
+                    if (!lbl_image_in_range(at, 8, size)) {
+                        return -1;
+                    }
+                    lbl_image_wr64(image + at, lbl_image_rd64(image + at) + delta);
+                }
+                where += 63 * 8;
+            }
+        }
+    }
+    return 0;
+}
+
+static int lbl_image_relocate_pe(const LBL_IMAGE_LAYOUT* layout, lbl_u8* image, lbl_u64 delta) {
+    const lbl_u8* block = image + layout->reloc_offset;
+    lbl_u64 left = layout->reloc_size;
+
+    while (left >= 8) {
+        lbl_u32 page = lbl_image_rd32(block);
+        lbl_u32 block_size = lbl_image_rd32(block + 4);
+        lbl_u32 i;
+
+        if (block_size < 8 || block_size > left) {
+            return -1;
+        }
+        for (i = 8; i + 2 <= block_size; i += 2) {
+            lbl_u16 entry = lbl_image_rd16(block + i);
+            lbl_u64 at = (lbl_u64)page + (entry & 0xFFF);
+            switch (entry >> 12) {
+            case LBL_PE_REL_BASED_ABSOLUTE:
+                break; // Padding
+            case LBL_PE_REL_BASED_DIR64:
+                if (!lbl_image_in_range(at, 8, layout->memory_size)) {
+                    return -1;
+                }
+                lbl_image_wr64(image + at, lbl_image_rd64(image + at) + delta);
+                break;
+            default:
+                return -1;
+            }
+        }
+        block += block_size;
+        left -= block_size;
+    }
+    return 0;
+}
+
+int lbl_image_relocate(const LBL_IMAGE_LAYOUT* layout, lbl_u8* image, lbl_u64 load_addr) {
+    lbl_u64 delta = load_addr - layout->link_base;
+
+    // A fixed-address image runs where it was linked (which may be a higher-half
+    // alias of load_addr); there is nothing to apply.
+    if (!layout->relocatable || delta == 0) {
+        return 0;
+    }
+    switch (layout->reloc_kind) {
+    case LBL_IMAGE_RELOC_ELF_DYNAMIC:
+        return lbl_image_relocate_elf(layout, image, delta);
+    case LBL_IMAGE_RELOC_PE_BASE:
+        return lbl_image_relocate_pe(layout, image, delta);
+    default:
+        return 0;
+    }
+}
+
+const void* lbl_image_core_header(const LBL_IMAGE_LAYOUT* layout, const lbl_u8* image, lbl_usize* size) {
+    const lbl_u8* note = image + layout->note_offset;
+    lbl_u64 left = layout->note_size;
+
+    if (layout->note_size == 0) {
+        return NULL;
+    }
+    if (layout->format == LBL_IMAGE_FORMAT_PE32PLUS) {
+        *size = (lbl_usize)layout->note_size;
+        return note;
+    }
+
+    // ELF notes: namesz, descsz, type, then name and desc, each padded to 4 bytes.
+    while (left >= 12) {
+        lbl_u32 namesz = lbl_image_rd32(note);
+        lbl_u32 descsz = lbl_image_rd32(note + 4);
+        lbl_u32 type = lbl_image_rd32(note + 8);
+        lbl_u64 name_len = ((lbl_u64)namesz + 3) & ~3ULL;
+        lbl_u64 desc_len = ((lbl_u64)descsz + 3) & ~3ULL;
+
+        if (name_len + desc_len > left - 12) {
+            break;
+        }
+        if (type == LBL_IMAGE_NOTE_CORE_HEADER && namesz == sizeof(LBL_IMAGE_NOTE_NAME) &&
+            lbl_image_bytes_equal(note + 12, LBL_IMAGE_NOTE_NAME, sizeof(LBL_IMAGE_NOTE_NAME))) {
+            *size = descsz;
+            return note + 12 + name_len;
+        }
+        note += 12 + name_len + desc_len;
+        left -= 12 + name_len + desc_len;
+    }
+    return NULL;
+}
@@ -0,0 +1,103 @@
+// Lionbootloader - Stage 1 - ELF64 / PE32+ Core Image Layout
+// File: stage1/common/stage1_image.h
+//
+// Freestanding parser for cores stored as ELF64 executables (ET_EXEC / static-pie
+// ET_DYN) or PE32+ images, shared by the BIOS and UEFI loaders. It turns the
+// headers into a list of segments to read straight into place, and applies the
+// image's relative relocations once the segments are loaded. No allocation and
+// no firmware calls: reading the file and obtaining pages is the caller's job.
+
+#ifndef STAGE1_IMAGE_H
+#define STAGE1_IMAGE_H
+
+#include "stage1_loader_utils.h" // lbl_u8 / lbl_u32 / lbl_u64 / lbl_usize
+
+// Bytes at the start of the file that must hold every header the parser looks at
+// (ELF header and program headers; DOS, PE and optional headers and the section
+// table). Linkers put them in the first page.
+#define LBL_IMAGE_HEADERS_MAX       4096
+#define LBL_IMAGE_MAX_SEGMENTS      16
+// Largest memory span accepted, so a corrupt header cannot ask for all of RAM.
+#define LBL_IMAGE_MAX_SIZE          0x40000000ULL   // 1 GiB
+
+#define LBL_IMAGE_FORMAT_NONE       0   // Not an ELF or PE image (flat binary)
+#define LBL_IMAGE_FORMAT_ELF64      1
+#define LBL_IMAGE_FORMAT_PE32PLUS   2
+
+// LBL_IMAGE_SEGMENT.flags
+#define LBL_IMAGE_SEGMENT_READ      0x1
+#define LBL_IMAGE_SEGMENT_WRITE     0x2
+#define LBL_IMAGE_SEGMENT_EXEC      0x4
+
+// An image may embed an LBL_CORE_IMAGE_HEADER (LblUefi.h) for the fields the
+// program headers cannot express (flags, heap size): as the descriptor of an ELF
+// note named LBL_IMAGE_NOTE_NAME, or at the start of a PE section with this name.
+#define LBL_IMAGE_NOTE_NAME         "LBL"
+#define LBL_IMAGE_NOTE_CORE_HEADER  1
+#define LBL_IMAGE_PE_HEADER_SECTION ".lblcore"
+
+// Where the image's relocations live once it is loaded.
+#define LBL_IMAGE_RELOC_NONE        0   // Nothing to apply
+#define LBL_IMAGE_RELOC_ELF_DYNAMIC 1   // PT_DYNAMIC at reloc_offset (DT_RELA / DT_RELR)
+#define LBL_IMAGE_RELOC_PE_BASE     2   // Base relocation directory at reloc_offset
+
+typedef struct {
+    lbl_u64 file_offset;    // Bytes [file_offset, file_offset + file_size) of the file...
+    lbl_u64 file_size;
+    lbl_u64 mem_offset;     // ...go to image + mem_offset; the rest up to mem_size is zeroed
+    lbl_u64 mem_size;
+    lbl_u32 flags;          // LBL_IMAGE_SEGMENT_*
+    lbl_u32 reserved;
+} LBL_IMAGE_SEGMENT;
+
+typedef struct {
+    lbl_u32 format;         // LBL_IMAGE_FORMAT_*
+    lbl_u32 segment_count;
+    // Sorted by mem_offset, which is also file order; neither range overlaps the next.
+    LBL_IMAGE_SEGMENT segments[LBL_IMAGE_MAX_SEGMENTS];
+    lbl_u64 preferred_base; // Physical address of mem_offset 0 (ELF p_paddr, PE ImageBase)
+    lbl_u64 link_base;      // Address mem_offset 0 was linked at (ELF p_vaddr, PE ImageBase)
+    lbl_u64 alignment;      // Largest segment alignment (power of two, >= 4 KiB)
+    lbl_u64 memory_size;    // Span of all segments from mem_offset 0, page rounded
+    lbl_u64 entry_offset;   // Entry point relative to mem_offset 0
+    int relocatable;        // Runs anywhere (static-pie, or PE without RELOCS_STRIPPED)
+    lbl_u32 reloc_kind;     // LBL_IMAGE_RELOC_*
+    lbl_u64 reloc_offset;   // mem_offset of the dynamic section / relocation directory
+    lbl_u64 reloc_size;
+    lbl_u64 note_offset;    // mem_offset of the PT_NOTE data / LBL_IMAGE_PE_HEADER_SECTION
+    lbl_u64 note_size;      // 0 = none loaded
+} LBL_IMAGE_LAYOUT;
+
+/**
+ * @brief Identifies an ELF64 or PE32+ image from its first bytes.
+ * @return LBL_IMAGE_FORMAT_*; LBL_IMAGE_FORMAT_NONE for anything else.
+ */
+lbl_u32 lbl_image_detect(const void* data, lbl_usize len);
+
+/**
+ * @brief Builds the segment layout of an image for the running architecture.
+ * @param headers The first `headers_len` bytes of the file (up to LBL_IMAGE_HEADERS_MAX).
+ * @param file_size Size of the whole file; every segment must lie inside it.
+ * @return 0 on success, -1 for a malformed, foreign-architecture or unsupported image.
+ */
+int lbl_image_parse(const void* headers, lbl_usize headers_len, lbl_u64 file_size,
+                    LBL_IMAGE_LAYOUT* layout);
+
+/**
+ * @brief Applies the image's relative relocations for a load at `load_addr`, in
+ * one pass over the relocation table. Does nothing if the image was loaded where
+ * it was linked. Only relative relocations are accepted (the core is never
+ * linked against anything).
+ * @param image Loaded image, `layout->memory_size` bytes.
+ * @return 0 on success, -1 on a malformed table or an unsupported relocation.
+ */
+int lbl_image_relocate(const LBL_IMAGE_LAYOUT* layout, lbl_u8* image, lbl_u64 load_addr);
+
+/**
+ * @brief Finds the embedded core header of a loaded image (see LBL_IMAGE_NOTE_NAME).
+ * @param size Output: bytes available at the returned address.
+ * @return The header bytes inside `image`, or NULL if the image carries none.
+ */
+const void* lbl_image_core_header(const LBL_IMAGE_LAYOUT* layout, const lbl_u8* image, lbl_usize* size);
+
+#endif // STAGE1_IMAGE_H
@@ -8,6 +8,7 @@
 // For UEFI, they would use EFI Boot Services.
 
 #include "stage1_loader_utils.h" // Corresponding header file
+#include "stage1_mem.h"
 
 // Conditional compilation for BIOS vs UEFI context could be used here,
 // or separate files for truly distinct implementations.
@@ -52,10 +53,136 @@ void lbl_bios_print_string(const char* str) {
 }
 
 
+// --- Sector Cache (BIOS) ---
+
+#define LBL_BIOS_READ_AHEAD_MIN     8   // Sectors fetched on an isolated miss
+#define LBL_BIOS_READ_AHEAD_MAX     64  // Window cap for sequential misses
+#define LBL_BIOS_PREFETCH_FAT       128 // FAT sectors warmed (64 KiB at 512 bytes: ~16k clusters)
+#define LBL_BIOS_PREFETCH_DIR       64  // Root directory sectors warmed at most
+
+static LBL_SECTOR_CACHE_HEADER* lbl_bios_cache;     // NULL until lbl_bios_sector_cache_init
+static lbl_u32 lbl_bios_cache_max_read;             // Sectors per lbl_bios_disk_read
+static lbl_u32 lbl_bios_cache_window;               // Current read-ahead window
+static lbl_u64 lbl_bios_cache_next_lba;             // Sector after the last miss run
+
+static lbl_u32 lbl_bios_rd16(const lbl_u8* p) {
+    return (lbl_u32)p[0] | ((lbl_u32)p[1] << 8);
+}
+
+static lbl_u32 lbl_bios_rd32(const lbl_u8* p) {
+    return lbl_bios_rd16(p) | (lbl_bios_rd16(p + 2) << 16);
+}
+
+/**
+ * @brief Looks a sector up and marks its line as just used.
+ * @return The cached sector, or NULL.
+ */
+static lbl_u8* lbl_bios_cache_lookup(lbl_u64 lba) {
+    LBL_SECTOR_CACHE_TAG* tags = (LBL_SECTOR_CACHE_TAG*)(lbl_usize)lbl_bios_cache->tags_addr;
+    lbl_u32 first = (lbl_u32)(lba & (lbl_bios_cache->sets - 1)) * lbl_bios_cache->ways;
+    lbl_u32 way;
+
+    for (way = 0; way < lbl_bios_cache->ways; way++) {
+        LBL_SECTOR_CACHE_TAG* tag = &tags[first + way];
+        if ((tag->flags & LBL_SECTOR_CACHE_TAG_VALID) && tag->lba == lba) {
+            tag->stamp = ++lbl_bios_cache->stamp;
+            return (lbl_u8*)(lbl_usize)lbl_bios_cache->data_addr + (first + way) * lbl_bios_cache->sector_size;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Stores a sector in its set, in a free way or over the least recently used.
+ */
+static void lbl_bios_cache_insert(lbl_u64 lba, const lbl_u8* data) {
+    LBL_SECTOR_CACHE_TAG* tags = (LBL_SECTOR_CACHE_TAG*)(lbl_usize)lbl_bios_cache->tags_addr;
+    lbl_u32 first = (lbl_u32)(lba & (lbl_bios_cache->sets - 1)) * lbl_bios_cache->ways;
+    lbl_u32 victim = first;
+    lbl_u32 way;
+
+    for (way = 0; way < lbl_bios_cache->ways; way++) {
+        LBL_SECTOR_CACHE_TAG* tag = &tags[first + way];
+        if (!(tag->flags & LBL_SECTOR_CACHE_TAG_VALID)) {
+            victim = first + way;
+            break;
+        }
+        if (tag->lba == lba) {
+            return; // Already cached, same data
+        }
+        if (tag->stamp < tags[victim].stamp) {
+            victim = first + way;
+        }
+    }
+    tags[victim].lba = lba;
+    tags[victim].flags = LBL_SECTOR_CACHE_TAG_VALID;
+    tags[victim].stamp = ++lbl_bios_cache->stamp;
+    lbl_mem_copy((lbl_u8*)(lbl_usize)lbl_bios_cache->data_addr + victim * lbl_bios_cache->sector_size,
+                 data, lbl_bios_cache->sector_size);
+}
+
 /**
- * @brief Loads sectors from disk using BIOS INT 13h (LBA or CHS).
- * !! Only usable in 16-bit Real Mode. !!
- * Assembly is typically used for this in MBR/Stage2 for direct control.
+ * @brief Reads sectors through the cache. A miss fetches at least the read-ahead
+ * window in one BIOS call; misses that continue where the last one ended double
+ * the window (up to LBL_BIOS_READ_AHEAD_MAX), any other miss resets it. If the
+ * longer read fails (e.g. past the end of the disk) only the request is retried.
+ * @param dest Destination, or NULL to only warm the cache.
+ * @return 0 on success.
+ */
+static int lbl_bios_cache_read(lbl_u64 lba, lbl_u32 count, lbl_u8* dest) {
+    const lbl_u8* bounce = (const lbl_u8*)LBL_BIOS_BOUNCE_LIN;
+    lbl_u32 sector_size = lbl_bios_cache->sector_size;
+
+    while (count != 0) {
+        const lbl_u8* line = lbl_bios_cache_lookup(lba);
+        lbl_u32 run, i;
+
+        if (line != NULL) {
+            lbl_bios_cache->hits++;
+            if (dest != NULL) {
+                lbl_mem_copy(dest, line, sector_size);
+                dest += sector_size;
+            }
+            lba++;
+            count--;
+            continue;
+        }
+
+        if (lba == lbl_bios_cache_next_lba && lbl_bios_cache_window < LBL_BIOS_READ_AHEAD_MAX) {
+            lbl_bios_cache_window *= 2;
+        } else if (lba != lbl_bios_cache_next_lba) {
+            lbl_bios_cache_window = LBL_BIOS_READ_AHEAD_MIN;
+        }
+        run = count > lbl_bios_cache_window ? count : lbl_bios_cache_window;
+        if (run > lbl_bios_cache_max_read) {
+            run = lbl_bios_cache_max_read;
+        }
+        if (lbl_bios_disk_read(lbl_bios_cache->drive, (lbl_u32)lba, (lbl_u32)(lba >> 32), run) != 0) {
+            run = count < lbl_bios_cache_max_read ? count : lbl_bios_cache_max_read;
+            if (lbl_bios_disk_read(lbl_bios_cache->drive, (lbl_u32)lba, (lbl_u32)(lba >> 32), run) != 0) {
+                return -1;
+            }
+        }
+        for (i = 0; i < run; i++) {
+            lbl_bios_cache_insert(lba + i, bounce + i * sector_size);
+        }
+        lbl_bios_cache_next_lba = lba + run;
+
+        i = run < count ? run : count; // Requested part of the run
+        lbl_bios_cache->misses += i;
+        lbl_bios_cache->read_ahead += run - i;
+        if (dest != NULL) {
+            lbl_mem_copy(dest, bounce, i * sector_size);
+            dest += i * sector_size;
+        }
+        lba += i;
+        count -= i;
+    }
+    return 0;
+}
+
+/**
+ * @brief Loads sectors through the sector cache, see stage1_loader_utils.h.
  * @param drive Drive number (e.g., 0x80 for first HDD).
  * @param lba Starting Logical Block Address.
  * @param num_sectors Number of sectors to read.
@@ -65,13 +192,532 @@ void lbl_bios_print_string(const char* str) {
  */
 int lbl_bios_read_sectors(unsigned char drive, unsigned long long lba, unsigned short num_sectors,
                            unsigned short target_segment, unsigned short target_offset) {
-    // This function would encapsulate the LBA DAP logic shown in mbr.asm/boot_32.asm
-    // but in C, likely using inline assembly for the INT 13h calls.
-    // This is highly complex to do robustly in C for 16-bit mode linked with 32-bit.
-    // Primarily for demonstration that C *could* do this.
-    (void)drive; (void)lba; (void)num_sectors; (void)target_segment; (void)target_offset; // Mark as used
-    // Return error for stub
-    return -1; // Error, not implemented
+    lbl_u8* dest = (lbl_u8*)(lbl_usize)(((lbl_u32)target_segment << 4) + target_offset);
+
+    if (lbl_bios_cache == NULL || drive != lbl_bios_cache->drive) {
+        return -1; // Not initialized, or not the boot drive
+    }
+    return lbl_bios_cache_read(lba, num_sectors, dest);
+}
+
+/**
+ * @brief Whether a sector is a FAT32 boot sector this cache can serve.
+ */
+static int lbl_bios_is_fat32_boot_sector(const lbl_u8* sector, lbl_u32 sector_size) {
+    static const char fs_type[8] = { 'F', 'A', 'T', '3', '2', ' ', ' ', ' ' };
+    lbl_u32 i;
+
+    if (sector[510] != 0x55 || sector[511] != 0xAA || lbl_bios_rd16(sector + 0x0B) != sector_size ||
+        sector[0x0D] == 0 || sector[0x10] == 0 || lbl_bios_rd32(sector + 0x24) == 0) {
+        return 0;
+    }
+    for (i = 0; i < sizeof(fs_type); i++) {
+        if (sector[0x52 + i] != (lbl_u8)fs_type[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Warms the cache with what the core's FAT32 driver reads first on the boot
+ * volume: the first FAT32 partition of the MBR (types 0Bh, 0Ch, EFh), or sector 0
+ * itself on an unpartitioned disk. GPT disks are left cold.
+ */
+static void lbl_bios_prefetch_boot_volume(void) {
+    lbl_u8 sector[4096];
+    lbl_u32 sector_size = lbl_bios_cache->sector_size;
+    lbl_u64 volume = 0, fat, data;
+    lbl_u32 reserved, fat_size, per_cluster, root, warm, i;
+
+    if (lbl_bios_cache_read(0, 1, sector) != 0) {
+        return;
+    }
+    if (!lbl_bios_is_fat32_boot_sector(sector, sector_size)) {
+        for (i = 0; i < 4 && volume == 0; i++) {
+            const lbl_u8* entry = sector + 0x1BE + i * 16;
+            if (entry[4] == 0x0B || entry[4] == 0x0C || entry[4] == 0xEF) {
+                volume = lbl_bios_rd32(entry + 8);
+            }
+        }
+        if (volume == 0 || lbl_bios_cache_read(volume, 1, sector) != 0 ||
+            !lbl_bios_is_fat32_boot_sector(sector, sector_size)) {
+            return;
+        }
+    }
+
+    per_cluster = sector[0x0D];
+    reserved = lbl_bios_rd16(sector + 0x0E);
+    fat_size = lbl_bios_rd32(sector + 0x24);
+    root = lbl_bios_rd32(sector + 0x2C);
+    i = lbl_bios_rd16(sector + 0x30); // FSInfo
+    if (i != 0 && i < reserved) {
+        lbl_bios_cache_read(volume + i, 1, NULL);
+    }
+    fat = volume + reserved;
+    data = fat + (lbl_u64)sector[0x10] * fat_size;
+    warm = fat_size < LBL_BIOS_PREFETCH_FAT ? fat_size : LBL_BIOS_PREFETCH_FAT;
+    lbl_bios_cache_read(fat, warm, NULL);
+    if (root >= 2) {
+        warm = per_cluster < LBL_BIOS_PREFETCH_DIR ? per_cluster : LBL_BIOS_PREFETCH_DIR;
+        lbl_bios_cache_read(data + (lbl_u64)(root - 2) * per_cluster, warm, NULL);
+    }
+}
+
+void lbl_bios_sector_cache_init(const LBL_BIOS_HANDOFF* handoff) {
+    LBL_SECTOR_CACHE_HEADER* cache = (LBL_SECTOR_CACHE_HEADER*)LBL_BIOS_SECTOR_CACHE_LIN;
+    LBL_SECTOR_CACHE_TAG* tags = (LBL_SECTOR_CACHE_TAG*)(cache + 1);
+    lbl_u32 sector_size = handoff->disk_sector_size;
+    lbl_u32 sets = 1, lines, data, i;
+
+    lbl_bios_cache = NULL;
+    if (sector_size < 512 || sector_size > 4096 || (sector_size & (sector_size - 1)) != 0) {
+        return;
+    }
+    // Largest power-of-two set count whose tags and page-aligned lines fit.
+    for (;;) {
+        lines = sets * 2 * LBL_SECTOR_CACHE_WAYS;
+        data = ((lbl_u32)(lbl_usize)(tags + lines) + 4095) & ~4095u;
+        if (data + lines * sector_size > LBL_BIOS_SECTOR_CACHE_LIN + LBL_BIOS_SECTOR_CACHE_SIZE) {
+            break;
+        }
+        sets *= 2;
+    }
+    lines = sets * LBL_SECTOR_CACHE_WAYS;
+    for (i = 0; i < lines; i++) {
+        tags[i].lba = 0;
+        tags[i].flags = 0;
+        tags[i].stamp = 0;
+    }
+    cache->magic = LBL_SECTOR_CACHE_MAGIC;
+    cache->sector_size = sector_size;
+    cache->sets = sets;
+    cache->ways = LBL_SECTOR_CACHE_WAYS;
+    cache->drive = handoff->boot_drive;
+    cache->stamp = 0;
+    cache->tags_addr = (lbl_usize)tags;
+    cache->data_addr = ((lbl_u32)(lbl_usize)(tags + lines) + 4095) & ~4095u;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->read_ahead = 0;
+
+    lbl_bios_cache_max_read = LBL_BIOS_BOUNCE_BYTES / sector_size;
+    if (handoff->disk_chunk_limit != 0 && handoff->disk_chunk_limit < lbl_bios_cache_max_read) {
+        lbl_bios_cache_max_read = handoff->disk_chunk_limit;
+    }
+    lbl_bios_cache_window = LBL_BIOS_READ_AHEAD_MIN;
+    lbl_bios_cache_next_lba = ~0ULL;
+    lbl_bios_cache = cache;
+    lbl_bios_prefetch_boot_volume();
+}
+
+
+// --- Boot Info (BIOS) ---
+
+#define LBL_BIOS_PAGE_SIZE          4096ULL
+#define LBL_BIOS_MAX_REGIONS        (LBL_BIOS_E820_MAX + 4) // E820 plus the loader ranges
+
+// VBE 3.0 ModeInfoBlock (function 4F01h).
+typedef struct __attribute__((packed)) {
+    lbl_u16 attributes;             // 0x00; bit 7: linear framebuffer available
+    lbl_u8  window_a, window_b;
+    lbl_u16 granularity, window_size, segment_a, segment_b;
+    lbl_u32 window_function;
+    lbl_u16 pitch;                  // 0x10: bytes per scan line, banked modes
+    lbl_u16 width, height;
+    lbl_u8  char_width, char_height, planes, bpp, banks, memory_model, bank_size, image_pages, reserved0;
+    lbl_u8  red_size, red_position, green_size, green_position;     // 0x1F
+    lbl_u8  blue_size, blue_position, rsvd_size, rsvd_position;
+    lbl_u8  direct_color_info;
+    lbl_u32 framebuffer;            // 0x28: physical address of the linear framebuffer
+    lbl_u32 off_screen_offset;
+    lbl_u16 off_screen_size;
+    lbl_u16 linear_pitch;           // 0x32: bytes per scan line in linear modes (VBE 3.0)
+    lbl_u8  banked_image_pages, linear_image_pages;
+    lbl_u8  linear_red_size, linear_red_position, linear_green_size, linear_green_position;
+    lbl_u8  linear_blue_size, linear_blue_position, linear_rsvd_size, linear_rsvd_position;
+    lbl_u32 max_pixel_clock;
+    lbl_u8  reserved1[190];
+} LBL_VBE_MODE_INFO;
+
+typedef struct {
+    lbl_u64 base;                   // Page aligned
+    lbl_u64 end;                    // Exclusive, page aligned
+    lbl_u32 type;                   // LBL_MEM_*
+} LBL_BIOS_REGION;
+
+/**
+ * @brief Maps an E820 type to its LBL_MEM_* class.
+ */
+static lbl_u32 lbl_bios_e820_class(lbl_u32 type) {
+    switch (type) {
+        case 1: return LBL_MEM_USABLE;
+        case 3: return LBL_MEM_ACPI_RECLAIM;
+        case 4: return LBL_MEM_ACPI_NVS;
+        case 7: return LBL_MEM_PERSISTENT;
+        default: return LBL_MEM_RESERVED; // 2 reserved, 5 bad memory, anything newer
+    }
+}
+
+/**
+ * @brief Which type wins where ranges overlap. E820 maps may overlap, and the loader
+ * ranges are laid over usable memory; the more restrictive type always wins.
+ */
+static lbl_u32 lbl_bios_mem_rank(lbl_u32 type) {
+    switch (type) {
+        case LBL_MEM_USABLE:       return 0;
+        case LBL_MEM_LOADER:       return 1;
+        case LBL_MEM_ACPI_RECLAIM: return 2;
+        case LBL_MEM_PERSISTENT:   return 3;
+        case LBL_MEM_ACPI_NVS:     return 4;
+        default:                   return 5;
+    }
+}
+
+/**
+ * @brief Adds a region, page aligned: usable memory shrinks to whole pages inside it,
+ * everything else grows to the pages it touches.
+ */
+static void lbl_bios_add_region(LBL_BIOS_REGION* regions, lbl_u32* count, lbl_u64 base, lbl_u64 length, lbl_u32 type) {
+    lbl_u64 end = base + length;
+
+    if (length == 0 || end < base || *count == LBL_BIOS_MAX_REGIONS) {
+        return;
+    }
+    if (type == LBL_MEM_USABLE) {
+        base = (base + LBL_BIOS_PAGE_SIZE - 1) & ~(LBL_BIOS_PAGE_SIZE - 1);
+        end &= ~(LBL_BIOS_PAGE_SIZE - 1);
+    } else {
+        base &= ~(LBL_BIOS_PAGE_SIZE - 1);
+        end = (end + LBL_BIOS_PAGE_SIZE - 1) & ~(LBL_BIOS_PAGE_SIZE - 1);
+    }
+    if (end <= base) {
+        return;
+    }
+    regions[*count].base = base;
+    regions[*count].end = end;
+    regions[*count].type = type;
+    (*count)++;
+}
+
+/**
+ * @brief Appends the compact memory map record built from the E820 entries.
+ * Every region edge is a boundary; each span between two boundaries takes the
+ * highest-ranked type covering it (holes are left out), and equal neighbours
+ * merge. The result is sorted and non-overlapping, as on UEFI.
+ */
+static void lbl_bios_build_memory_map(LBL_BOOT_INFO* info, lbl_u32 capacity, const LBL_BIOS_HANDOFF* handoff) {
+    LBL_BIOS_REGION regions[LBL_BIOS_MAX_REGIONS];
+    lbl_u64 bounds[2 * LBL_BIOS_MAX_REGIONS];
+    const LBL_BIOS_E820_ENTRY* e820 = (const LBL_BIOS_E820_ENTRY*)(lbl_usize)handoff->e820_addr;
+    LBL_COMPACT_MEMORY_MAP_RECORD* record;
+    LBL_MEMORY_RANGE* ranges;
+    lbl_u32 region_count = 0, bound_count = 0, range_capacity, count = 0;
+    lbl_u32 offset, i, j;
+
+    for (i = 0; i < handoff->e820_count && i < LBL_BIOS_E820_MAX; i++) {
+        if ((e820[i].attributes & 1) == 0) {
+            continue; // ACPI 3.0 "ignore this entry"
+        }
+        lbl_bios_add_region(regions, &region_count, e820[i].base, e820[i].length, lbl_bios_e820_class(e820[i].type));
+    }
+    lbl_bios_add_region(regions, &region_count, handoff->stage2_base, handoff->stage2_size, LBL_MEM_LOADER);
+    lbl_bios_add_region(regions, &region_count, handoff->core_load_addr, handoff->core_size, LBL_MEM_LOADER);
+    lbl_bios_add_region(regions, &region_count, (lbl_usize)info, capacity, LBL_MEM_LOADER);
+    if (lbl_bios_cache != NULL) {
+        lbl_bios_add_region(regions, &region_count, LBL_BIOS_SECTOR_CACHE_LIN, LBL_BIOS_SECTOR_CACHE_SIZE, LBL_MEM_LOADER);
+    }
+
+    for (i = 0; i < region_count; i++) {
+        lbl_u64 edge[2] = { regions[i].base, regions[i].end };
+        lbl_u32 k;
+        for (k = 0; k < 2; k++) {
+            for (j = bound_count; j > 0 && bounds[j - 1] > edge[k]; j--) {
+                bounds[j] = bounds[j - 1];
+            }
+            if (j > 0 && bounds[j - 1] == edge[k]) {
+                for (; j < bound_count; j++) { // Already present: undo the shift
+                    bounds[j] = bounds[j + 1];
+                }
+                continue;
+            }
+            bounds[j] = edge[k];
+            bound_count++;
+        }
+    }
+
+    offset = (info->total_size + LBL_BOOT_RECORD_ALIGN - 1) & ~(lbl_u32)(LBL_BOOT_RECORD_ALIGN - 1);
+    if (offset + sizeof(LBL_COMPACT_MEMORY_MAP_RECORD) > capacity) {
+        return;
+    }
+    range_capacity = (capacity - offset - sizeof(LBL_COMPACT_MEMORY_MAP_RECORD)) / sizeof(LBL_MEMORY_RANGE);
+    if (range_capacity > bound_count) {
+        range_capacity = bound_count; // Spans over 16 TiB are split, so leave a little slack
+    }
+    record = (LBL_COMPACT_MEMORY_MAP_RECORD*)((lbl_u8*)info + offset);
+    ranges = (LBL_MEMORY_RANGE*)(record + 1);
+    record->header.type = LBL_BOOT_RECORD_MEMORY_MAP;
+    record->header.size = sizeof(LBL_COMPACT_MEMORY_MAP_RECORD) + range_capacity * sizeof(LBL_MEMORY_RANGE);
+    record->capacity = range_capacity;
+    record->count = 0;
+    info->total_size = offset + record->header.size;
+
+    for (i = 0; i + 1 < bound_count; i++) {
+        lbl_u64 base = bounds[i];
+        lbl_u64 pages = (bounds[i + 1] - base) / LBL_BIOS_PAGE_SIZE;
+        lbl_u32 type = 0;
+
+        for (j = 0; j < region_count; j++) {
+            if (regions[j].base <= base && regions[j].end >= bounds[i + 1] &&
+                (type == 0 || lbl_bios_mem_rank(regions[j].type) > lbl_bios_mem_rank(type))) {
+                type = regions[j].type;
+            }
+        }
+        if (type == 0) {
+            continue; // Hole in the map
+        }
+        while (pages != 0) {
+            lbl_u32 chunk = pages > 0xFFFFFFFF ? 0xFFFFFFFF : (lbl_u32)pages;
+
+            if (count != 0 && ranges[count - 1].type == type &&
+                ranges[count - 1].base + (lbl_u64)ranges[count - 1].pages * LBL_BIOS_PAGE_SIZE == base &&
+                (lbl_u64)ranges[count - 1].pages + chunk <= 0xFFFFFFFF) {
+                ranges[count - 1].pages += chunk;
+            } else if (count == range_capacity) {
+                return; // Incomplete: leave count at 0, as on UEFI
+            } else {
+                ranges[count].base = base;
+                ranges[count].pages = chunk;
+                ranges[count].type = type;
+                count++;
+            }
+            base += (lbl_u64)chunk * LBL_BIOS_PAGE_SIZE;
+            pages -= chunk;
+        }
+    }
+    record->count = count;
+}
+
+/**
+ * @brief Fills the framebuffer fields from the ModeInfoBlock of the mode boot_32 set.
+ */
+static void lbl_bios_describe_framebuffer(LBL_BOOT_INFO* info, const LBL_BIOS_HANDOFF* handoff) {
+    const LBL_VBE_MODE_INFO* mode = (const LBL_VBE_MODE_INFO*)(lbl_usize)handoff->vbe_mode_info_addr;
+    int vbe3 = handoff->vbe_version >= 0x0300;
+
+    info->framebuffer_pixel_format_info = LBL_FB_FORMAT_NONE;
+    if (handoff->vbe_mode == LBL_BIOS_VBE_NO_MODE || mode == NULL || mode->framebuffer == 0 ||
+        (mode->attributes & 0x80) == 0) {
+        return;
+    }
+    info->framebuffer_addr = mode->framebuffer;
+    info->framebuffer_width = mode->width;
+    info->framebuffer_height = mode->height;
+    info->framebuffer_pitch = vbe3 ? mode->linear_pitch : mode->pitch;
+    info->framebuffer_bpp = mode->bpp;
+    info->framebuffer_size = ((lbl_u64)info->framebuffer_pitch * mode->height + LBL_BIOS_PAGE_SIZE - 1) &
+                             ~(LBL_BIOS_PAGE_SIZE - 1);
+    if (handoff->vbe_memory_bytes != 0 && info->framebuffer_size > handoff->vbe_memory_bytes) {
+        info->framebuffer_size = handoff->vbe_memory_bytes;
+    }
+    info->framebuffer_red_size = vbe3 ? mode->linear_red_size : mode->red_size;
+    info->framebuffer_red_shift = vbe3 ? mode->linear_red_position : mode->red_position;
+    info->framebuffer_green_size = vbe3 ? mode->linear_green_size : mode->green_size;
+    info->framebuffer_green_shift = vbe3 ? mode->linear_green_position : mode->green_position;
+    info->framebuffer_blue_size = vbe3 ? mode->linear_blue_size : mode->blue_size;
+    info->framebuffer_blue_shift = vbe3 ? mode->linear_blue_position : mode->blue_position;
+    info->framebuffer_reserved_size = vbe3 ? mode->linear_rsvd_size : mode->rsvd_size;
+    info->framebuffer_reserved_shift = vbe3 ? mode->linear_rsvd_position : mode->rsvd_position;
+
+    info->framebuffer_pixel_format_info = LBL_FB_FORMAT_BITMASK;
+    if (mode->bpp == 32 && info->framebuffer_red_size == 8 && info->framebuffer_green_size == 8 &&
+        info->framebuffer_blue_size == 8 && info->framebuffer_green_shift == 8) {
+        if (info->framebuffer_red_shift == 0 && info->framebuffer_blue_shift == 16) {
+            info->framebuffer_pixel_format_info = LBL_FB_FORMAT_RGBX8888;
+        } else if (info->framebuffer_red_shift == 16 && info->framebuffer_blue_shift == 0) {
+            info->framebuffer_pixel_format_info = LBL_FB_FORMAT_BGRX8888;
+        }
+    }
+}
+
+// --- Boot Timeline (BIOS) ---
+
+#define LBL_BIOS_PIT_HZ             1193182
+#define LBL_BIOS_PIT_CALIBRATE      1193    // Channel 2 counts: ~1 ms
+#define LBL_BIOS_PIT_SPIN           0x01000000 // Port 0x61 polls before the PIT is given up on
+#define LBL_BIOS_TIMELINE_PORT      0x3F8   // COM1, as LBL_FBCON_SERIAL_PORT
+#define LBL_BIOS_TIMELINE_SPIN      100000  // LSR polls per byte
+
+static inline void lbl_bios_outb(lbl_u16 port, lbl_u8 value) {
+    __asm__ __volatile__("outb %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline lbl_u8 lbl_bios_inb(lbl_u16 port) {
+    lbl_u8 value;
+    __asm__ __volatile__("inb %1, %0" : "=a"(value) : "Nd"(port));
+    return value;
+}
+
+/**
+ * @brief TSC frequency from a one-shot of PIT channel 2 (gated through port
+ * 0x61, speaker off), the way the UEFI loader uses BS->Stall.
+ * @return Ticks per second, or 0 if OUT2 never went high.
+ */
+static lbl_u64 lbl_bios_calibrate_tsc(void) {
+    lbl_u8 saved = lbl_bios_inb(0x61);
+    lbl_u64 start, end;
+    lbl_u32 delta, spin;
+
+    lbl_bios_outb(0x61, (lbl_u8)((saved & ~0x02) | 0x01));
+    lbl_bios_outb(0x43, 0xB0);          // Channel 2, lobyte/hibyte, mode 0
+    lbl_bios_outb(0x42, LBL_BIOS_PIT_CALIBRATE & 0xFF);
+    lbl_bios_outb(0x42, LBL_BIOS_PIT_CALIBRATE >> 8);
+    start = lbl_read_cycle_counter();
+    for (spin = 0; spin < LBL_BIOS_PIT_SPIN && (lbl_bios_inb(0x61) & 0x20) == 0; spin++) {
+    }
+    end = lbl_read_cycle_counter();
+    lbl_bios_outb(0x61, saved);
+    if (spin == LBL_BIOS_PIT_SPIN) {
+        return 0;
+    }
+    // Scale by PIT_HZ / PIT_CALIBRATE = 1000 + 61/400 (to 0.0001%) in 32-bit
+    // arithmetic: an i386 64-bit divide would need libgcc.
+    delta = (lbl_u32)(end - start);
+    return (lbl_u64)delta * 1000 + (delta * 61u) / 400u;
+}
+
+static void lbl_bios_timeline_mark(LBL_TIMELINE_RECORD* timeline, lbl_u32 id, lbl_u32 arg, lbl_u64 ticks) {
+    LBL_TIMELINE_EVENT* event;
+
+    if (timeline->count >= timeline->capacity) {
+        timeline->dropped++;
+        return;
+    }
+    event = &timeline->events[timeline->count++];
+    event->ticks = ticks;
+    event->id = id;
+    event->arg = arg;
+}
+
+#if LBL_TIMELINE_SERIAL
+static void lbl_bios_serial_put(lbl_u8 byte) {
+    lbl_u32 spin;
+
+    for (spin = 0; spin < LBL_BIOS_TIMELINE_SPIN; spin++) {
+        if (lbl_bios_inb(LBL_BIOS_TIMELINE_PORT + 5) & 0x20) { // LSR.THRE
+            lbl_bios_outb(LBL_BIOS_TIMELINE_PORT, byte);
+            return;
+        }
+    }
+}
+
+static void lbl_bios_serial_puts(const char* text) {
+    while (*text != '\0') {
+        if (*text == '\n') {
+            lbl_bios_serial_put('\r');
+        }
+        lbl_bios_serial_put((lbl_u8)*text++);
+    }
+}
+
+static void lbl_bios_serial_put_hex(lbl_u64 value) {
+    static const char digits[] = "0123456789abcdef";
+    char text[19];
+    lbl_u32 start = sizeof(text) - 1;
+
+    text[start] = '\0';
+    do {
+        text[--start] = digits[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+    text[--start] = 'x';
+    text[--start] = '0';
+    lbl_bios_serial_puts(text + start);
+}
+
+/**
+ * @brief Prints the timeline in the LBL_TIMELINE_SERIAL format on COM1, set to
+ * 115200 8N1 as the UEFI console does. A port whose LSR reads 0xFF is absent.
+ */
+static void lbl_bios_timeline_emit(const LBL_TIMELINE_RECORD* timeline) {
+    lbl_u32 i;
+
+    if (lbl_bios_inb(LBL_BIOS_TIMELINE_PORT + 5) == 0xFF) {
+        return;                         // No UART
+    }
+    lbl_bios_outb(LBL_BIOS_TIMELINE_PORT + 1, 0x00);   // IER
+    lbl_bios_outb(LBL_BIOS_TIMELINE_PORT + 3, 0x80);   // LCR: divisor latch
+    lbl_bios_outb(LBL_BIOS_TIMELINE_PORT + 0, 0x01);   // DLL: 115200
+    lbl_bios_outb(LBL_BIOS_TIMELINE_PORT + 1, 0x00);   // DLM
+    lbl_bios_outb(LBL_BIOS_TIMELINE_PORT + 3, 0x03);   // LCR: 8N1
+    lbl_bios_outb(LBL_BIOS_TIMELINE_PORT + 2, 0xC7);   // FCR
+    lbl_bios_outb(LBL_BIOS_TIMELINE_PORT + 4, 0x03);   // MCR: DTR, RTS
+
+    lbl_bios_serial_puts("LBLTL hz ");
+    lbl_bios_serial_put_hex(timeline->ticks_per_second);
+    lbl_bios_serial_puts("\n");
+    for (i = 0; i < timeline->count; i++) {
+        lbl_bios_serial_puts("LBLTL ev ");
+        lbl_bios_serial_put_hex(timeline->events[i].id);
+        lbl_bios_serial_puts(" ");
+        lbl_bios_serial_put_hex(timeline->events[i].arg);
+        lbl_bios_serial_puts(" ");
+        lbl_bios_serial_put_hex(timeline->events[i].ticks);
+        lbl_bios_serial_puts("\n");
+    }
+    lbl_bios_serial_puts("LBLTL end\n");
+}
+#endif
+
+LBL_BOOT_INFO* lbl_bios_build_boot_info(const LBL_BIOS_HANDOFF* handoff, void* area, lbl_u32 capacity) {
+    LBL_BOOT_INFO* info = (LBL_BOOT_INFO*)area;
+    LBL_TIMELINE_RECORD* timeline = NULL;
+
+    if (handoff == NULL || area == NULL || capacity < sizeof(LBL_BOOT_INFO)) {
+        return NULL;
+    }
+    lbl_mem_set(area, 0, capacity);
+    info->magic = LBL_BOOT_INFO_MAGIC_VALUE;
+    info->version = LBL_BOOT_INFO_VERSION;
+    info->header_size = sizeof(LBL_BOOT_INFO);
+    info->total_size = sizeof(LBL_BOOT_INFO);
+
+    info->core_load_addr = handoff->core_load_addr;
+    info->core_size = handoff->core_size;
+    info->core_load_alignment = LBL_BIOS_PAGE_SIZE;
+    info->acpi_rsdp_ptr = handoff->rsdp_addr;
+    lbl_bios_describe_framebuffer(info, handoff);
+
+    if (lbl_bios_cache != NULL && info->total_size + sizeof(LBL_SECTOR_CACHE_RECORD) <= capacity) {
+        LBL_SECTOR_CACHE_RECORD* cache = (LBL_SECTOR_CACHE_RECORD*)((lbl_u8*)info + info->total_size);
+        cache->header.type = LBL_BOOT_RECORD_SECTOR_CACHE;
+        cache->header.size = sizeof(LBL_SECTOR_CACHE_RECORD);
+        cache->region_addr = LBL_BIOS_SECTOR_CACHE_LIN;
+        cache->region_size = LBL_BIOS_SECTOR_CACHE_SIZE;
+        info->total_size += sizeof(LBL_SECTOR_CACHE_RECORD);
+    }
+    // No LBL_BOOT_RECORD_MEM_OPS here: this loader's lbl_mem_* are 32-bit cdecl
+    // code the 64-bit core cannot call, so it keeps to its own fallbacks.
+    if (info->total_size + sizeof(LBL_TIMELINE_RECORD) <= capacity) {
+        timeline = (LBL_TIMELINE_RECORD*)((lbl_u8*)info + info->total_size);
+        timeline->header.type = LBL_BOOT_RECORD_TIMELINE;
+        timeline->header.size = sizeof(LBL_TIMELINE_RECORD);
+        timeline->version = LBL_TIMELINE_VERSION;
+        timeline->capacity = LBL_TIMELINE_CAPACITY;
+        timeline->ticks_per_second = lbl_bios_calibrate_tsc();
+        lbl_bios_timeline_mark(timeline, LBL_TL_STAGE1_ENTRY, 0, handoff->tsc_entry);
+        lbl_bios_timeline_mark(timeline, LBL_TL_CORE_READ_END, 0, handoff->tsc_core_loaded);
+        info->total_size += sizeof(LBL_TIMELINE_RECORD);
+    }
+    lbl_bios_build_memory_map(info, capacity, handoff);
+    if (timeline != NULL) {
+        // boot_32 jumps to the core right after this returns.
+        lbl_bios_timeline_mark(timeline, LBL_TL_CORE_JUMP, 0, lbl_read_cycle_counter());
+#if LBL_TIMELINE_SERIAL
+        lbl_bios_timeline_emit(timeline);
+#endif
+    }
+    return info;
 }
 
 
@@ -113,124 +759,915 @@ void lbl_uefi_print_ascii_string(const char* ascii_str) {
     ST->ConOut->OutputString(ST->ConOut, wide_buffer);
 }
 
+// CHAR16s per OutputString call when flushing (plus room for "\r\n" and NUL).
+#define LBL_UEFI_LOG_FLUSH_CHUNK    1024
+
+static LBL_UEFI_LOG_RING lbl_uefi_log_state = {
+    0, 0, LBL_UEFI_LOG_RING_SIZE, LBL_LOG_COMPILE_LEVEL, LBL_LOG_LEVEL_WARN, 0, { 0 }
+};
+
+static void lbl_uefi_log_put(UINT8 byte) {
+    LBL_UEFI_LOG_RING* ring = &lbl_uefi_log_state;
+    ring->data[ring->written & (LBL_UEFI_LOG_RING_SIZE - 1)] = byte;
+    ring->written++;
+}
 
 /**
- * @brief Locates the LBL Core Engine file on a given device handle and file path.
+ * @brief Formats a message into the log ring, one level byte per line.
+ */
+void lbl_uefi_log(UINT8 level, const CHAR16* fmt, ...) {
+    CHAR16 line[LBL_UEFI_LOG_LINE_MAX];
+    va_list args;
+    UINTN i;
+
+    if (level == LBL_LOG_LEVEL_OFF || level > lbl_uefi_log_state.record_level || fmt == NULL) {
+        return;
+    }
+    va_start(args, fmt);
+    VSPrint(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    lbl_uefi_log_put(level);
+    for (i = 0; line[i] != L'\0'; i++) {
+        CHAR16 c = line[i];
+        if (c == L'\r') {
+            continue;
+        }
+        if (c == L'\n') {
+            lbl_uefi_log_put('\n');
+            if (line[i + 1] != L'\0') {
+                lbl_uefi_log_put(level); // Embedded newline starts another line
+            }
+            continue;
+        }
+        lbl_uefi_log_put(c < 0x80 ? (UINT8)c : (UINT8)'?');
+    }
+    if (i == 0 || line[i - 1] != L'\n') {
+        lbl_uefi_log_put('\n');
+    }
+}
+
+/**
+ * @brief Sets the runtime record/console levels.
+ */
+void lbl_uefi_log_set_levels(UINT8 record_level, UINT8 console_level) {
+    lbl_uefi_log_state.record_level =
+        record_level > LBL_LOG_COMPILE_LEVEL ? LBL_LOG_COMPILE_LEVEL : record_level;
+    lbl_uefi_log_state.console_level = console_level;
+}
+
+/**
+ * @brief Writes pending messages at or below max_level to ConOut in large batches.
+ */
+void lbl_uefi_log_flush(UINT8 max_level) {
+    LBL_UEFI_LOG_RING* ring = &lbl_uefi_log_state;
+    CHAR16 out[LBL_UEFI_LOG_FLUSH_CHUNK + 3];
+    UINTN n = 0;
+    UINT64 pos = ring->flushed;
+    BOOLEAN line_start = TRUE;
+    BOOLEAN emit = FALSE;
+
+    if (ring->written - pos > LBL_UEFI_LOG_RING_SIZE) {
+        // Overwritten before it was flushed: resume at the first whole line.
+        pos = ring->written - LBL_UEFI_LOG_RING_SIZE;
+        while (pos < ring->written && ring->data[pos & (LBL_UEFI_LOG_RING_SIZE - 1)] != '\n') {
+            pos++;
+        }
+        pos++;
+    }
+    while (pos < ring->written) {
+        UINT8 c = ring->data[pos & (LBL_UEFI_LOG_RING_SIZE - 1)];
+        pos++;
+        if (line_start) {
+            emit = (c != LBL_LOG_LEVEL_OFF && c <= max_level);
+            line_start = FALSE;
+            continue;
+        }
+        if (c == '\n') {
+            line_start = TRUE;
+            if (emit) {
+                out[n++] = L'\r';
+                out[n++] = L'\n';
+            }
+        } else if (emit) {
+            out[n++] = (CHAR16)c;
+        }
+        if (n >= LBL_UEFI_LOG_FLUSH_CHUNK) {
+            out[n] = L'\0';
+            lbl_uefi_print_string(out);
+            n = 0;
+        }
+    }
+    if (n != 0) {
+        out[n] = L'\0';
+        lbl_uefi_print_string(out);
+    }
+    ring->flushed = ring->written;
+}
+
+/**
+ * @brief Flushes at the configured console level.
+ */
+void lbl_uefi_log_flush_console(void) {
+    lbl_uefi_log_flush(lbl_uefi_log_state.console_level);
+}
+
+LBL_UEFI_LOG_RING* lbl_uefi_log_ring(void) {
+    return &lbl_uefi_log_state;
+}
+
+
+/**
+ * @brief Returns the size of an open file from its EFI_FILE_INFO.
+ */
+EFI_STATUS lbl_uefi_file_size(EFI_FILE_PROTOCOL* file_handle, UINT64* file_size) {
+    EFI_STATUS status;
+    EFI_FILE_INFO* file_info = NULL;
+    UINTN buffer_size = 0; // Must pass 0 initially to get required size for file_info
+
+    status = file_handle->GetInfo(file_handle, &gEfiFileInfoGuid, &buffer_size, NULL);
+    if (status != EFI_BUFFER_TOO_SMALL) {
+        LBL_LOG_ERROR(L"Error: Could not get file info size.\n");
+        return status == EFI_SUCCESS ? EFI_DEVICE_ERROR : status; // if success, it's weird
+    }
+
+    status = BS->AllocatePool(EfiLoaderData, buffer_size, (VOID**)&file_info);
+    if (EFI_ERROR(status)) {
+        LBL_LOG_ERROR(L"Error: Could not allocate buffer for file info.\n");
+        return status;
+    }
+
+    status = file_handle->GetInfo(file_handle, &gEfiFileInfoGuid, &buffer_size, file_info);
+    if (EFI_ERROR(status)) {
+        LBL_LOG_ERROR(L"Error: Could not get file info.\n");
+    } else {
+        *file_size = file_info->FileSize;
+    }
+    BS->FreePool(file_info); // Free the file_info buffer
+    return status;
+}
+
+#define LBL_UEFI_MAX_PATH 260 // CHAR16s, terminator included
+
+/**
+ * @brief Opens path read-only below root_fs. EFI_FILE_PROTOCOL.Open takes a
+ * non-const CHAR16*, so the path is copied into a local buffer first.
+ * @return EFI_INVALID_PARAMETER if the path does not fit LBL_UEFI_MAX_PATH.
+ */
+static EFI_STATUS lbl_uefi_open_path(EFI_FILE_PROTOCOL* root_fs, CONST CHAR16* path, EFI_FILE_PROTOCOL** file_out) {
+    CHAR16 buffer[LBL_UEFI_MAX_PATH];
+    UINTN i;
+
+    for (i = 0; path[i] != 0; i++) {
+        if (i + 1 >= LBL_UEFI_MAX_PATH) {
+            return EFI_INVALID_PARAMETER;
+        }
+        buffer[i] = path[i];
+    }
+    buffer[i] = 0;
+    return root_fs->Open(root_fs, file_out, buffer, EFI_FILE_MODE_READ, 0);
+}
+
+/**
+ * @brief Opens a file for reading relative to an already opened volume root.
+ * @param root_fs Volume root directory (from OpenVolume).
+ * @param file_path Path of the file on that volume.
+ * @param file_out Receives the opened file.
+ * @param file_size Receives the file size in bytes (from EFI_FILE_INFO).
+ * @return EFI_STATUS code. On failure the file is not left open; root_fs always stays open.
+ */
+EFI_STATUS lbl_uefi_open_file_in_volume(
+    EFI_FILE_PROTOCOL* root_fs,
+    CONST CHAR16* file_path,
+    EFI_FILE_PROTOCOL** file_out,
+    UINT64* file_size
+) {
+    EFI_STATUS status;
+    EFI_FILE_PROTOCOL* file_handle = NULL;
+
+    if (!BS || !root_fs || !file_path || !file_out || !file_size) {
+        return EFI_INVALID_PARAMETER;
+    }
+    *file_out = NULL;
+    *file_size = 0;
+
+    // Open the target file
+    status = lbl_uefi_open_path(root_fs, file_path, &file_handle);
+    if (EFI_ERROR(status)) {
+        LBL_LOG_DEBUG(L"Could not open file: %s (Status: %r)\n", file_path, status); // Often expected (optional files, other volumes)
+        return status;
+    }
+
+    // Get file info to determine its size
+    status = lbl_uefi_file_size(file_handle, file_size);
+    if (EFI_ERROR(status)) {
+        file_handle->Close(file_handle);
+        return status;
+    }
+
+    *file_out = file_handle;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Opens a file for reading on the filesystem of a given device handle.
  * @param device_handle Handle to the block I/O device (partition).
- * @param file_path Path to the LBL Core Engine EFI file (e.g., L"\\LBL\\CORE\\lbl_core.efi")
- *                  or raw binary L"\\LBL\\CORE\\lbl_core.bin".
- * @param file_buffer Pointer to receive allocated buffer with file contents.
- * @param file_size Pointer to receive file size.
- * @return EFI_STATUS code.
+ * @param file_path Path of the file on that filesystem.
+ * @param root_out Receives the opened volume root.
+ * @param file_out Receives the opened file.
+ * @param file_size Receives the file size in bytes (from EFI_FILE_INFO).
+ * @return EFI_STATUS code. On failure nothing is left open.
  */
-EFI_STATUS lbl_uefi_load_file_from_device(
+EFI_STATUS lbl_uefi_open_file(
     EFI_HANDLE device_handle,
-    CHAR16* file_path,
-    VOID** file_buffer,
-    UINTN* file_size
+    CONST CHAR16* file_path,
+    EFI_FILE_PROTOCOL** root_out,
+    EFI_FILE_PROTOCOL** file_out,
+    UINT64* file_size
 ) {
     EFI_STATUS status;
-    EFI_LOADED_IMAGE_PROTOCOL* loaded_image = NULL;
     EFI_SIMPLE_FILE_SYSTEM_PROTOCOL* fs_protocol = NULL;
     EFI_FILE_PROTOCOL* root_fs = NULL;
-    EFI_FILE_PROTOCOL* file_handle = NULL;
-    EFI_FILE_INFO* file_info = NULL;
-    UINTN buffer_size;
 
-    if (!BS || !device_handle || !file_path || !file_buffer || !file_size) {
+    if (!BS || !device_handle || !file_path || !root_out || !file_out || !file_size) {
         return EFI_INVALID_PARAMETER;
     }
-    *file_buffer = NULL;
+    *root_out = NULL;
+    *file_out = NULL;
     *file_size = 0;
 
-    // Get the LoadedImageProtocol for the current image to find its device handle (if file_path is relative to LBL itself)
-    // Or, device_handle can be a specific partition handle found by scanning.
-    // For simplicity, assume device_handle is the correct one for the filesystem.
+    // device_handle is chosen by the caller: either this image's own DeviceHandle
+    // (see FindAndLoadLBLCore) or a partition handle found by scanning.
 
     // Open the filesystem protocol on the device handle
     status = BS->HandleProtocol(device_handle, &gEfiSimpleFileSystemProtocolGuid, (VOID**)&fs_protocol);
     if (EFI_ERROR(status)) {
-        lbl_uefi_print_ascii_string("Error: Could not open FS protocol.\r\n");
+        LBL_LOG_ERROR(L"Error: Could not open FS protocol.\n");
         return status;
     }
 
     // Open the root directory of the filesystem
     status = fs_protocol->OpenVolume(fs_protocol, &root_fs);
     if (EFI_ERROR(status)) {
-        lbl_uefi_print_ascii_string("Error: Could not open FS volume root.\r\n");
+        LBL_LOG_ERROR(L"Error: Could not open FS volume root.\n");
         return status;
     }
 
-    // Open the target file
-    status = root_fs->Open(root_fs, &file_handle, file_path, EFI_FILE_MODE_READ, 0);
+    status = lbl_uefi_open_file_in_volume(root_fs, file_path, file_out, file_size);
     if (EFI_ERROR(status)) {
-        // Optionally print file_path, but it's CHAR16
-        lbl_uefi_print_ascii_string("Error: Could not open file: ");
-        lbl_uefi_print_string(file_path); // Print the wide string path
-        lbl_uefi_print_ascii_string("\r\n");
         root_fs->Close(root_fs); // Close root before returning
         return status;
     }
 
-    // Get file info to determine its size
-    buffer_size = 0; // Must pass 0 initially to get required size for file_info
-    status = file_handle->GetInfo(file_handle, &gEfiFileInfoGuid, &buffer_size, NULL);
-    if (status != EFI_BUFFER_TOO_SMALL) {
-        lbl_uefi_print_ascii_string("Error: Could not get file info size.\r\n");
-        file_handle->Close(file_handle);
-        root_fs->Close(root_fs);
-        return status == EFI_SUCCESS ? EFI_DEVICE_ERROR : status; // if success, it's weird
+    *root_out = root_fs;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Closes a file and its volume root as returned by lbl_uefi_open_file.
+ * Either argument may be NULL.
+ */
+VOID lbl_uefi_close_file(EFI_FILE_PROTOCOL* root_fs, EFI_FILE_PROTOCOL* file_handle) {
+    if (file_handle) file_handle->Close(file_handle);
+    if (root_fs) root_fs->Close(root_fs);
+}
+
+#ifndef EFI_FILE_PROTOCOL_REVISION2
+#define EFI_FILE_PROTOCOL_REVISION2 0x00020000 // ReadEx/WriteEx/OpenEx/FlushEx present
+#endif
+
+/**
+ * @brief Issues one chunk read. With an event the read may complete asynchronously
+ * (ReadEx); without one it is a plain blocking Read.
+ */
+static EFI_STATUS lbl_uefi_issue_chunk_read(
+    EFI_FILE_PROTOCOL* file_handle,
+    EFI_FILE_IO_TOKEN* token,
+    VOID* buffer,
+    UINTN length
+) {
+    token->Status = EFI_SUCCESS;
+    token->BufferSize = length;
+    token->Buffer = buffer;
+    if (token->Event == NULL) {
+        token->Status = file_handle->Read(file_handle, &token->BufferSize, buffer);
+        return token->Status;
     }
+    return file_handle->ReadEx(file_handle, token);
+}
 
-    status = BS->AllocatePool(EfiLoaderData, buffer_size, (VOID**)&file_info);
+/**
+ * @brief Waits for a chunk read issued by lbl_uefi_issue_chunk_read and checks its length.
+ */
+static EFI_STATUS lbl_uefi_complete_chunk_read(EFI_FILE_IO_TOKEN* token, UINTN expected) {
+    UINTN index;
+
+    if (token->Event != NULL) {
+        BS->WaitForEvent(1, &token->Event, &index);
+    }
+    if (EFI_ERROR(token->Status)) {
+        return token->Status;
+    }
+    return token->BufferSize == expected ? EFI_SUCCESS : EFI_END_OF_FILE;
+}
+
+/**
+ * @brief Reads a file in chunks, overlapping the next read with the consumer when possible.
+ */
+EFI_STATUS lbl_uefi_stream_file(
+    EFI_FILE_PROTOCOL* file_handle,
+    UINT64 start_offset,
+    UINT64 length,
+    CONST LBL_UEFI_STREAM* stream
+) {
+    EFI_STATUS status;
+    EFI_FILE_IO_TOKEN token;
+    UINT8* bounce[2] = { NULL, NULL };
+    UINT8* chunk;
+    UINTN chunk_size;
+    UINTN current_length;
+    UINT64 done = 0;
+    UINTN slot = 0;
+
+    if (!BS || !file_handle || !stream) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (stream->destination && stream->destination_size < length) {
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    if (length == 0) {
+        return EFI_SUCCESS;
+    }
+
+    chunk_size = stream->chunk_size ? stream->chunk_size : LBL_UEFI_STREAM_DEFAULT_CHUNK;
+    if ((UINT64)chunk_size > length) {
+        chunk_size = (UINTN)length;
+    }
+
+    // Overlap only pays off when there is work to do between reads.
+    BS->SetMem(&token, sizeof(token), 0);
+    if (stream->consumer && length > chunk_size && file_handle->Revision >= EFI_FILE_PROTOCOL_REVISION2) {
+        if (EFI_ERROR(BS->CreateEvent(0, 0, NULL, NULL, &token.Event))) {
+            token.Event = NULL;
+        }
+    }
+
+    if (!stream->destination) {
+        status = BS->AllocatePool(EfiLoaderData, chunk_size * (token.Event ? 2 : 1), (VOID**)&bounce[0]);
+        if (EFI_ERROR(status)) {
+            if (token.Event) BS->CloseEvent(token.Event);
+            return status;
+        }
+        bounce[1] = token.Event ? bounce[0] + chunk_size : bounce[0];
+    }
+
+#define LBL_STREAM_CHUNK_PTR(at, s) \
+    (stream->destination ? (UINT8*)stream->destination + (at) : bounce[(s)])
+
+    // Prime the pipeline with the first chunk.
+    current_length = chunk_size;
+    chunk = LBL_STREAM_CHUNK_PTR(0, slot);
+    status = lbl_uefi_issue_chunk_read(file_handle, &token, chunk, current_length);
+    if (status == EFI_UNSUPPORTED && token.Event) {
+        BS->CloseEvent(token.Event); // Firmware reports ReadEx but does not implement it
+        token.Event = NULL;
+        status = lbl_uefi_issue_chunk_read(file_handle, &token, chunk, current_length);
+    }
+    if (!EFI_ERROR(status)) {
+        status = lbl_uefi_complete_chunk_read(&token, current_length);
+    }
+
+    while (!EFI_ERROR(status)) {
+        UINT64 next_offset = done + current_length;
+        UINTN next_length = 0;
+        UINT8* next_chunk = NULL;
+
+        // Start reading chunk N+1 before handing chunk N to the consumer.
+        if (next_offset < length) {
+            next_length = (length - next_offset) < chunk_size ? (UINTN)(length - next_offset) : chunk_size;
+            next_chunk = LBL_STREAM_CHUNK_PTR(next_offset, slot ^ 1);
+            if (token.Event) {
+                status = lbl_uefi_issue_chunk_read(file_handle, &token, next_chunk, next_length);
+                if (EFI_ERROR(status)) break;
+            }
+        }
+
+        if (stream->consumer) {
+            status = stream->consumer(stream->consumer_context, start_offset + done, chunk, current_length);
+        }
+
+        if (next_length == 0) {
+            break; // Last chunk consumed
+        }
+        if (!token.Event) {
+            if (EFI_ERROR(status)) break;
+            lbl_uefi_issue_chunk_read(file_handle, &token, next_chunk, next_length);
+        }
+        // Always reap an in-flight read, even if the consumer failed, before
+        // its buffer can be freed.
+        if (EFI_ERROR(status)) {
+            lbl_uefi_complete_chunk_read(&token, next_length);
+            break;
+        }
+        status = lbl_uefi_complete_chunk_read(&token, next_length);
+
+        done = next_offset;
+        current_length = next_length;
+        chunk = next_chunk;
+        slot ^= 1;
+    }
+
+#undef LBL_STREAM_CHUNK_PTR
+
+    if (token.Event) BS->CloseEvent(token.Event);
+    if (bounce[0]) BS->FreePool(bounce[0]);
+    return status;
+}
+
+/**
+ * @brief Opens a file on a device and streams its whole contents.
+ */
+EFI_STATUS lbl_uefi_stream_file_from_device(
+    EFI_HANDLE device_handle,
+    CONST CHAR16* file_path,
+    CONST LBL_UEFI_STREAM* stream,
+    UINT64* file_size
+) {
+    EFI_STATUS status;
+    EFI_FILE_PROTOCOL* root_fs = NULL;
+    EFI_FILE_PROTOCOL* file_handle = NULL;
+
+    if (!stream || !file_size) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    status = lbl_uefi_open_file(device_handle, file_path, &root_fs, &file_handle, file_size);
     if (EFI_ERROR(status)) {
-        lbl_uefi_print_ascii_string("Error: Could not allocate buffer for file info.\r\n");
-        file_handle->Close(file_handle);
-        root_fs->Close(root_fs);
         return status;
     }
 
-    status = file_handle->GetInfo(file_handle, &gEfiFileInfoGuid, &buffer_size, file_info);
+    status = lbl_uefi_stream_file(file_handle, 0, *file_size, stream);
+    if (EFI_ERROR(status)) {
+        LBL_LOG_ERROR(L"Error: Streamed file read failed.\n");
+    }
+    lbl_uefi_close_file(root_fs, file_handle);
+    return status;
+}
+
+/**
+ * @brief Locates the LBL Core Engine file on a given device handle and file path.
+ * Reads the whole file into a pool buffer via lbl_uefi_stream_file.
+ * @param device_handle Handle to the block I/O device (partition).
+ * @param file_path Path to the LBL Core Engine EFI file (e.g., L"\\LBL\\CORE\\lbl_core.efi")
+ *                  or raw binary L"\\LBL\\CORE\\lbl_core.bin".
+ * @param file_buffer Pointer to receive allocated buffer with file contents.
+ * @param file_size Pointer to receive file size.
+ * @return EFI_STATUS code.
+ */
+EFI_STATUS lbl_uefi_load_file_from_device(
+    EFI_HANDLE device_handle,
+    CONST CHAR16* file_path,
+    VOID** file_buffer,
+    UINTN* file_size
+) {
+    EFI_STATUS status;
+    EFI_FILE_PROTOCOL* root_fs = NULL;
+    EFI_FILE_PROTOCOL* file_handle = NULL;
+    LBL_UEFI_STREAM stream;
+    UINT64 size_on_disk;
+
+    if (!file_buffer || !file_size) {
+        return EFI_INVALID_PARAMETER;
+    }
+    *file_buffer = NULL;
+    *file_size = 0;
+
+    status = lbl_uefi_open_file(device_handle, file_path, &root_fs, &file_handle, &size_on_disk);
     if (EFI_ERROR(status)) {
-        lbl_uefi_print_ascii_string("Error: Could not get file info.\r\n");
-        BS->FreePool(file_info);
-        file_handle->Close(file_handle);
-        root_fs->Close(root_fs);
         return status;
     }
-    
-    *file_size = file_info->FileSize;
-    BS->FreePool(file_info); // Free the file_info buffer
+    *file_size = (UINTN)size_on_disk;
 
     // Allocate buffer for the file contents
     status = BS->AllocatePool(EfiLoaderData, *file_size, file_buffer);
     if (EFI_ERROR(status)) {
-        lbl_uefi_print_ascii_string("Error: Could not allocate buffer for file contents.\r\n");
-        file_handle->Close(file_handle);
-        root_fs->Close(root_fs);
+        LBL_LOG_ERROR(L"Error: Could not allocate buffer for file contents.\n");
+        lbl_uefi_close_file(root_fs, file_handle);
         return status;
     }
 
     // Read the file
-    buffer_size = *file_size; // Set to actual size for read
-    status = file_handle->Read(file_handle, &buffer_size, *file_buffer);
-    if (EFI_ERROR(status) || buffer_size != *file_size) {
-        lbl_uefi_print_ascii_string("Error: File read failed or wrong size read.\r\n");
+    BS->SetMem(&stream, sizeof(stream), 0);
+    stream.destination = *file_buffer;
+    stream.destination_size = size_on_disk;
+    status = lbl_uefi_stream_file(file_handle, 0, size_on_disk, &stream);
+    lbl_uefi_close_file(root_fs, file_handle);
+    if (EFI_ERROR(status)) {
+        LBL_LOG_ERROR(L"Error: File read failed or wrong size read.\n");
         BS->FreePool(*file_buffer);
         *file_buffer = NULL;
-        file_handle->Close(file_handle);
-        root_fs->Close(root_fs);
-        return status == EFI_SUCCESS ? EFI_DEVICE_ERROR : status; // Handle partial read as error
+        return status;
+    }
+
+    LBL_LOG_DEBUG(L"Success: File loaded into memory.\n");
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Reads and validates an extent map sidecar from an open volume.
+ * Checks the header, the map CRC32, that the map describes a file of exactly
+ * `file_size` bytes, and coalesces physically adjacent runs.
+ * The caller frees `*map_out` with `BS->FreePool()`.
+ */
+EFI_STATUS lbl_uefi_load_extent_map(
+    EFI_FILE_PROTOCOL* root_fs,
+    CONST CHAR16* map_path,
+    UINT64 file_size,
+    LBL_EXTENT_MAP_HEADER** map_out
+) {
+    EFI_STATUS status;
+    EFI_FILE_PROTOCOL* map_file = NULL;
+    LBL_EXTENT_MAP_HEADER* map = NULL;
+    LBL_EXTENT* extents;
+    UINT64 map_size = 0;
+    UINT64 covered = 0;
+    UINT32 stored_crc, crc = 0;
+    UINTN read_size, i, merged;
+
+    if (!root_fs || !map_path || !map_out) {
+        return EFI_INVALID_PARAMETER;
+    }
+    *map_out = NULL;
+
+    status = lbl_uefi_open_path(root_fs, map_path, &map_file);
+    if (EFI_ERROR(status)) {
+        return status; // No sidecar installed: the normal case, stay quiet
+    }
+    status = lbl_uefi_file_size(map_file, &map_size);
+    if (EFI_ERROR(status) || map_size < sizeof(LBL_EXTENT_MAP_HEADER) ||
+        map_size > sizeof(LBL_EXTENT_MAP_HEADER) + LBL_EXTENT_MAP_MAX_EXTENTS * sizeof(LBL_EXTENT)) {
+        map_file->Close(map_file);
+        return EFI_ERROR(status) ? status : EFI_VOLUME_CORRUPTED;
+    }
+
+    status = BS->AllocatePool(EfiLoaderData, (UINTN)map_size, (VOID**)&map);
+    if (EFI_ERROR(status)) {
+        map_file->Close(map_file);
+        return status;
+    }
+    read_size = (UINTN)map_size;
+    status = map_file->Read(map_file, &read_size, map);
+    map_file->Close(map_file);
+    if (EFI_ERROR(status) || read_size != (UINTN)map_size) {
+        BS->FreePool(map);
+        return EFI_ERROR(status) ? status : EFI_VOLUME_CORRUPTED;
+    }
+
+    // Structural checks.
+    if (map->magic != LBL_EXTENT_MAP_MAGIC || map->header_size != sizeof(LBL_EXTENT_MAP_HEADER) ||
+        map->block_size == 0 || (map->block_size & (map->block_size - 1)) != 0 ||
+        map->extent_count == 0 || map->extent_count > LBL_EXTENT_MAP_MAX_EXTENTS ||
+        map_size != sizeof(LBL_EXTENT_MAP_HEADER) + (UINT64)map->extent_count * sizeof(LBL_EXTENT) ||
+        map->file_size != file_size) {
+        BS->FreePool(map);
+        return EFI_VOLUME_CORRUPTED;
+    }
+    stored_crc = map->map_crc32;
+    map->map_crc32 = 0;
+    BS->CalculateCrc32(map, (UINTN)map_size, &crc);
+    map->map_crc32 = stored_crc;
+    if (crc != stored_crc) {
+        BS->FreePool(map);
+        return EFI_CRC_ERROR;
+    }
+
+    // The runs must cover the file, with at most one partially used block at the end.
+    extents = (LBL_EXTENT*)(map + 1);
+    for (i = 0; i < map->extent_count; i++) {
+        if (extents[i].blocks == 0) {
+            BS->FreePool(map);
+            return EFI_VOLUME_CORRUPTED;
+        }
+        covered += extents[i].blocks * map->block_size;
+    }
+    if (covered < file_size || covered - file_size >= map->block_size) {
+        BS->FreePool(map);
+        return EFI_VOLUME_CORRUPTED;
+    }
+
+    // Coalesce runs that are physically contiguous into single large reads.
+    merged = 0;
+    for (i = 1; i < map->extent_count; i++) {
+        if (extents[merged].lba + extents[merged].blocks == extents[i].lba) {
+            extents[merged].blocks += extents[i].blocks;
+        } else {
+            extents[++merged] = extents[i];
+        }
+    }
+    map->extent_count = (UINT32)(merged + 1);
+
+    *map_out = map;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Reads the file described by an extent map directly from the device,
+ * bypassing the firmware filesystem driver, and verifies its CRC32 unless the
+ * caller checks the data itself.
+ * EFI_DISK_IO_PROTOCOL is preferred (byte granular, no alignment rules);
+ * EFI_BLOCK_IO_PROTOCOL is used otherwise, with a bounce buffer for the last
+ * partial block.
+ * @param device_handle Partition handle the extent LBAs are relative to.
+ * @param map Validated map from lbl_uefi_load_extent_map().
+ * @param destination Buffer of at least map->file_size bytes.
+ */
+EFI_STATUS lbl_uefi_read_extents(
+    EFI_HANDLE device_handle,
+    CONST LBL_EXTENT_MAP_HEADER* map,
+    VOID* destination,
+    BOOLEAN check_crc
+) {
+    EFI_STATUS status;
+    EFI_BLOCK_IO* block_io = NULL;
+    EFI_DISK_IO* disk_io = NULL;
+    CONST LBL_EXTENT* extents = (CONST LBL_EXTENT*)(map + 1);
+    UINT8* dest = (UINT8*)destination;
+    UINT64 remaining = map->file_size;
+    EFI_PHYSICAL_ADDRESS bounce = 0;
+    UINTN bounce_pages = 0;
+    UINT32 media_id, crc = 0;
+    UINTN i;
+
+    status = BS->HandleProtocol(device_handle, &gEfiBlockIoProtocolGuid, (VOID**)&block_io);
+    if (EFI_ERROR(status) || !block_io->Media || !block_io->Media->MediaPresent) {
+        return EFI_ERROR(status) ? status : EFI_NO_MEDIA;
+    }
+    if (block_io->Media->BlockSize != map->block_size) {
+        return EFI_VOLUME_CORRUPTED; // Map was built for different media geometry
+    }
+    media_id = block_io->Media->MediaId;
+    if (EFI_ERROR(BS->HandleProtocol(device_handle, &gEfiDiskIoProtocolGuid, (VOID**)&disk_io))) {
+        disk_io = NULL;
+    }
+
+    for (i = 0; i < map->extent_count && remaining != 0; i++) {
+        UINT64 run_bytes = extents[i].blocks * map->block_size;
+        UINT64 want = run_bytes < remaining ? run_bytes : remaining;
+
+        if (extents[i].lba + extents[i].blocks - 1 > block_io->Media->LastBlock) {
+            status = EFI_VOLUME_CORRUPTED;
+            break;
+        }
+
+        if (disk_io) {
+            status = disk_io->ReadDisk(disk_io, media_id, extents[i].lba * map->block_size, (UINTN)want, dest);
+        } else {
+            UINT64 whole = want - (want % map->block_size);
+            UINT32 io_align = block_io->Media->IoAlign;
+
+            if (io_align > 1 && ((UINTN)dest % io_align) != 0) {
+                status = EFI_UNSUPPORTED; // Let the caller fall back to the FS path
+                break;
+            }
+            status = EFI_SUCCESS;
+            if (whole != 0) {
+                status = block_io->ReadBlocks(block_io, media_id, extents[i].lba, (UINTN)whole, dest);
+            }
+            if (!EFI_ERROR(status) && whole != want) {
+                // Tail of the file ends mid-block: read that block into a page-aligned bounce.
+                if (bounce == 0) {
+                    bounce_pages = EFI_SIZE_TO_PAGES(map->block_size);
+                    status = BS->AllocatePages(AllocateAnyPages, EfiLoaderData, bounce_pages, &bounce);
+                }
+                if (!EFI_ERROR(status)) {
+                    status = block_io->ReadBlocks(block_io, media_id, extents[i].lba + whole / map->block_size,
+                                                  map->block_size, (VOID*)(UINTN)bounce);
+                }
+                if (!EFI_ERROR(status)) {
+                    BS->CopyMem(dest + whole, (VOID*)(UINTN)bounce, (UINTN)(want - whole));
+                }
+            }
+        }
+        if (EFI_ERROR(status)) {
+            break;
+        }
+        dest += want;
+        remaining -= want;
+    }
+
+    if (bounce != 0) {
+        BS->FreePages(bounce, bounce_pages);
+    }
+    if (EFI_ERROR(status)) {
+        return status;
+    }
+    if (remaining != 0) {
+        return EFI_VOLUME_CORRUPTED;
+    }
+    if (!check_crc) {
+        return EFI_SUCCESS;
+    }
+
+    BS->CalculateCrc32(destination, (UINTN)map->file_size, &crc);
+    return crc == map->file_crc32 ? EFI_SUCCESS : EFI_CRC_ERROR;
+}
+
+// Spelled out locally; older gnu-efi releases do not export this GUID.
+static EFI_GUID lbl_disk_io2_protocol_guid =
+    { 0x151c8eae, 0x7f2c, 0x472c, { 0x9e, 0x54, 0x98, 0x28, 0x19, 0x4f, 0x6a, 0x88 } };
+
+/**
+ * @brief Submits every extent of a file as an EFI_DISK_IO2 ReadDiskEx request.
+ */
+EFI_STATUS lbl_uefi_read_extents_async(
+    EFI_HANDLE device_handle,
+    CONST LBL_EXTENT_MAP_HEADER* map,
+    VOID* destination,
+    BOOLEAN check_crc,
+    LBL_UEFI_ASYNC_EXTENT_READ* op
+) {
+    EFI_STATUS status;
+    EFI_BLOCK_IO* block_io = NULL;
+    EFI_DISK_IO2_PROTOCOL* disk_io2 = NULL;
+    CONST LBL_EXTENT* extents = (CONST LBL_EXTENT*)(map + 1);
+    UINT8* dest = (UINT8*)destination;
+    UINT64 remaining = map->file_size;
+    UINT32 media_id;
+    UINTN i;
+
+    BS->SetMem(op, sizeof(*op), 0);
+    op->map = map;
+    op->destination = destination;
+    op->check_crc = check_crc;
+
+    status = BS->HandleProtocol(device_handle, &gEfiBlockIoProtocolGuid, (VOID**)&block_io);
+    if (EFI_ERROR(status) || !block_io->Media || !block_io->Media->MediaPresent ||
+        block_io->Media->BlockSize != map->block_size) {
+        return EFI_UNSUPPORTED;
+    }
+    media_id = block_io->Media->MediaId;
+    status = BS->HandleProtocol(device_handle, &lbl_disk_io2_protocol_guid, (VOID**)&disk_io2);
+    if (EFI_ERROR(status)) {
+        return EFI_UNSUPPORTED;
     }
 
-    // Cleanup
-    file_handle->Close(file_handle);
-    root_fs->Close(root_fs);
+    status = BS->AllocatePool(EfiLoaderData, map->extent_count * sizeof(EFI_DISK_IO2_TOKEN), (VOID**)&op->tokens);
+    if (EFI_ERROR(status)) {
+        return EFI_UNSUPPORTED;
+    }
+    BS->SetMem(op->tokens, map->extent_count * sizeof(EFI_DISK_IO2_TOKEN), 0);
+
+    for (i = 0; i < map->extent_count && remaining != 0; i++) {
+        UINT64 run_bytes = extents[i].blocks * map->block_size;
+        UINT64 want = run_bytes < remaining ? run_bytes : remaining;
+        EFI_DISK_IO2_TOKEN* token = &op->tokens[i];
+
+        if (extents[i].lba + extents[i].blocks - 1 > block_io->Media->LastBlock) {
+            status = EFI_VOLUME_CORRUPTED;
+            break;
+        }
+        status = BS->CreateEvent(0, 0, NULL, NULL, &token->Event);
+        if (EFI_ERROR(status)) {
+            break;
+        }
+        status = disk_io2->ReadDiskEx(disk_io2, media_id, extents[i].lba * map->block_size, token, (UINTN)want, dest);
+        if (EFI_ERROR(status)) {
+            BS->CloseEvent(token->Event);
+            token->Event = NULL;
+            break;
+        }
+        op->submitted++;
+        dest += want;
+        remaining -= want;
+    }
 
-    lbl_uefi_print_ascii_string("Success: File loaded into memory.\r\n");
+    if (op->submitted == 0) {
+        BS->FreePool(op->tokens);
+        op->tokens = NULL;
+        return EFI_UNSUPPORTED; // Caller falls back to a synchronous read
+    }
+    // Runs already in flight must still be reaped; the error surfaces in the wait.
+    op->status = (EFI_ERROR(status) || remaining != 0) ? (EFI_ERROR(status) ? status : EFI_VOLUME_CORRUPTED)
+                                                       : EFI_SUCCESS;
     return EFI_SUCCESS;
 }
 
+/**
+ * @brief Reaps all runs of an asynchronous extent read and verifies the CRC32
+ * if it was asked for.
+ */
+EFI_STATUS lbl_uefi_wait_extents_async(LBL_UEFI_ASYNC_EXTENT_READ* op) {
+    EFI_STATUS status = op->status;
+    UINT32 crc = 0;
+    UINTN i, index;
+
+    for (i = 0; i < op->submitted; i++) {
+        EFI_DISK_IO2_TOKEN* token = &op->tokens[i];
+        BS->WaitForEvent(1, &token->Event, &index);
+        if (!EFI_ERROR(status) && EFI_ERROR(token->TransactionStatus)) {
+            status = token->TransactionStatus;
+        }
+        BS->CloseEvent(token->Event);
+    }
+    if (op->tokens) {
+        BS->FreePool(op->tokens);
+    }
+    op->tokens = NULL;
+    op->submitted = 0;
+
+    if (EFI_ERROR(status) || !op->check_crc) {
+        return status;
+    }
+    BS->CalculateCrc32(op->destination, (UINTN)op->map->file_size, &crc);
+    return crc == op->map->file_crc32 ? EFI_SUCCESS : EFI_CRC_ERROR;
+}
+
+/**
+ * @brief Headroom for a measured map: a fraction of its descriptor count, with a floor.
+ */
+UINTN lbl_uefi_memory_map_headroom(UINTN map_size, UINTN descriptor_size) {
+    UINTN descriptors;
+    UINTN extra;
+
+    if (descriptor_size == 0) {
+        descriptor_size = sizeof(EFI_MEMORY_DESCRIPTOR);
+    }
+    descriptors = map_size / descriptor_size;
+    extra = descriptors * LBL_UEFI_MAP_HEADROOM_PERCENT / 100;
+    if (extra < LBL_UEFI_MAP_HEADROOM_MIN_DESCRIPTORS) {
+        extra = LBL_UEFI_MAP_HEADROOM_MIN_DESCRIPTORS;
+    }
+    return (extra + 2) * descriptor_size; // +2: the buffer's own allocation may split a range
+}
+
+/**
+ * @brief Measures the map, allocates its buffer once and takes a first snapshot.
+ */
+EFI_STATUS lbl_uefi_memory_map_prepare(LBL_UEFI_MEMORY_MAP* map) {
+    EFI_STATUS status;
+    UINTN size = 0;
+
+    BS->SetMem(map, sizeof(*map), 0);
+    status = BS->GetMemoryMap(&size, NULL, &map->map_key, &map->descriptor_size, &map->descriptor_version);
+    if (status != EFI_BUFFER_TOO_SMALL) {
+        return (status == EFI_SUCCESS) ? EFI_DEVICE_ERROR : status;
+    }
+
+    map->buffer_size = size + lbl_uefi_memory_map_headroom(size, map->descriptor_size);
+    status = BS->AllocatePool(EfiLoaderData, map->buffer_size, (VOID**)&map->buffer);
+    if (EFI_ERROR(status)) {
+        map->buffer = NULL;
+        map->buffer_size = 0;
+        return status;
+    }
+
+    status = lbl_uefi_memory_map_snapshot(map);
+    if (EFI_ERROR(status)) {
+        BS->FreePool(map->buffer);
+        map->buffer = NULL;
+        map->buffer_size = 0;
+    }
+    return status;
+}
+
+/**
+ * @brief Refills the preallocated buffer with the current map.
+ */
+EFI_STATUS lbl_uefi_memory_map_snapshot(LBL_UEFI_MEMORY_MAP* map) {
+    map->map_size = map->buffer_size;
+    return BS->GetMemoryMap(&map->map_size, map->buffer, &map->map_key,
+                            &map->descriptor_size, &map->descriptor_version);
+}
+
+/**
+ * @brief Bounded GetMemoryMap -> ExitBootServices loop over one fixed buffer.
+ */
+EFI_STATUS lbl_uefi_exit_boot_services(EFI_HANDLE image_handle, LBL_UEFI_MEMORY_MAP* map, UINTN max_attempts) {
+    EFI_STATUS status = EFI_INVALID_PARAMETER;
+    UINTN attempt;
+
+    map->retries = 0;
+    map->attempts = 0;
+    for (attempt = 0; attempt < max_attempts; attempt++) {
+        // Always re-snapshot: anything that ran since the last one (even console
+        // output) may have changed the map.
+        status = lbl_uefi_memory_map_snapshot(map);
+        if (EFI_ERROR(status)) {
+            return status; // Outgrew the headroom; cannot allocate from here on
+        }
+        if (attempt < LBL_UEFI_EXIT_BOOT_SERVICES_ATTEMPTS) {
+            map->attempt_ticks[attempt] = lbl_read_cycle_counter();
+        }
+        map->attempts++;
+        status = BS->ExitBootServices(image_handle, map->map_key);
+        if (status != EFI_INVALID_PARAMETER) {
+            return status; // EFI_SUCCESS, or a failure a retry will not fix
+        }
+        map->retries++; // Stale key: the map changed between the two calls
+    }
+    return status;
+}
+
 /**
  * @brief Gets the UEFI Memory Map.
  * @param memory_map_ptr Pointer to receive allocated buffer with memory map.
@@ -254,18 +1691,18 @@ EFI_STATUS lbl_uefi_get_memory_map(
     // First call to get the size of the memory map
     status = BS->GetMemoryMap(map_size, *memory_map_ptr, map_key, descriptor_size, descriptor_version);
     if (status != EFI_BUFFER_TOO_SMALL) {
-         lbl_uefi_print_ascii_string("Error: GetMemoryMap did not return EFI_BUFFER_TOO_SMALL on first call.\r\n");
+         LBL_LOG_ERROR(L"Error: GetMemoryMap did not return EFI_BUFFER_TOO_SMALL on first call.\n");
         // This could mean map_size was not 0, or another error.
         return (status == EFI_SUCCESS) ? EFI_DEVICE_ERROR : status;
     }
 
-    // Add some padding to map_size in case the map grows between calls
-    *map_size += (*descriptor_size * 5); 
+    // Room for the map to grow between the two calls (this allocation included)
+    *map_size += lbl_uefi_memory_map_headroom(*map_size, *descriptor_size);
 
     // Allocate pool for the memory map
     status = BS->AllocatePool(EfiLoaderData, *map_size, (VOID**)memory_map_ptr);
     if (EFI_ERROR(status)) {
-        lbl_uefi_print_ascii_string("Error: Could not allocate pool for memory map.\r\n");
+        LBL_LOG_ERROR(L"Error: Could not allocate pool for memory map.\n");
         *memory_map_ptr = NULL;
         return status;
     }
@@ -273,7 +1710,7 @@ EFI_STATUS lbl_uefi_get_memory_map(
     // Second call to actually get the memory map
     status = BS->GetMemoryMap(map_size, *memory_map_ptr, map_key, descriptor_size, descriptor_version);
     if (EFI_ERROR(status)) {
-        lbl_uefi_print_ascii_string("Error: GetMemoryMap failed on second call.\r\n");
+        LBL_LOG_ERROR(L"Error: GetMemoryMap failed on second call.\n");
         BS->FreePool(*memory_map_ptr);
         *memory_map_ptr = NULL;
     }
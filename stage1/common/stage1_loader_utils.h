@@ -22,6 +22,45 @@
 #endif
 
 
+// Fixed-width types for the environment-neutral Stage 1 modules (stage1_lz4.c, ...).
+// Stage 1 is built with -nostdinc for UEFI, so <stdint.h> is not available; the
+// compiler's predefined type macros are used instead.
+typedef __UINT8_TYPE__  lbl_u8;
+typedef __UINT16_TYPE__ lbl_u16;
+typedef __UINT32_TYPE__ lbl_u32;
+typedef __UINT64_TYPE__ lbl_u64;
+typedef __SIZE_TYPE__   lbl_usize;
+
+/**
+ * @brief Reads the free-running CPU cycle counter (TSC on x86, CNTVCT_EL0 on AArch64).
+ * Used to time Stage 1 phases; returns 0 on architectures without one.
+ */
+static inline lbl_u64 lbl_read_cycle_counter(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    lbl_u32 lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((lbl_u64)hi << 32) | lo;
+#elif defined(__aarch64__)
+    lbl_u64 ticks;
+    __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return 0;
+#endif
+}
+
+// Boot timeline on the serial port, for tools/bench_boot.py (make bench_boot).
+// With -DLBL_TIMELINE_SERIAL=1 both loaders print their timeline on COM1 just
+// before the jump to the core, one line per item, values in hex:
+//   LBLTL hz 0x<ticks per second, 0 = unknown>
+//   LBLTL ev 0x<LBL_TL_* id> 0x<arg> 0x<ticks>
+//   LBLTL end
+// Off in normal builds: the UART is slow and may not exist.
+#ifndef LBL_TIMELINE_SERIAL
+#define LBL_TIMELINE_SERIAL         0
+#endif
+
+
 // The Makefile should define LBL_BIOS_ENV or LBL_UEFI_ENV appropriately
 // when compiling stage1_loader_utils.c for different targets.
 
@@ -36,8 +75,9 @@
 void lbl_bios_print_string(const char* str);
 
 /**
- * @brief Loads sectors from disk using BIOS INT 13h (LBA or CHS).
- * !!Only usable in 16-bit Real Mode. Assembly typically used.!!
+ * @brief Loads sectors from disk through the sector cache (see below).
+ * Called from 32-bit protected mode; misses go to INT 13h AH=42h through
+ * lbl_bios_disk_read. Only the boot drive is served, after lbl_bios_sector_cache_init.
  * @param drive Drive number (e.g., 0x80 for first HDD).
  * @param lba Starting Logical Block Address.
  * @param num_sectors Number of sectors to read.
@@ -48,6 +88,244 @@ void lbl_bios_print_string(const char* str);
 int lbl_bios_read_sectors(unsigned char drive, unsigned long long lba, unsigned short num_sectors,
                            unsigned short target_segment, unsigned short target_offset);
 
+// --- Boot Info (BIOS) ---
+// boot_32 hands the core the same LBL_BOOT_INFO as the UEFI loader, so the core
+// has a single init path. LblUefi.h needs efi.h, so its layout is mirrored here
+// with the x86_64 sizes (pointers and UINTN are 8 bytes). i386 aligns 64-bit struct
+// members to 4, hence lbl_bios_u64. Keep this in step with LblUefi.h.
+typedef lbl_u64 lbl_bios_u64 __attribute__((aligned(8)));
+
+#define LBL_BOOT_INFO_MAGIC_VALUE   0x4C424C42494E464FULL // "LBLBINFO"
+#define LBL_BOOT_INFO_VERSION       0x00010001
+
+#define LBL_BOOT_RECORD_ALIGN       8
+#define LBL_BOOT_RECORD_TIMELINE    1   // LBL_TIMELINE_RECORD
+#define LBL_BOOT_RECORD_MEMORY_MAP  2   // LBL_COMPACT_MEMORY_MAP_RECORD
+#define LBL_BOOT_RECORD_SECTOR_CACHE 7  // LBL_SECTOR_CACHE_RECORD
+
+#define LBL_MEM_USABLE              1
+#define LBL_MEM_LOADER              2   // Stage 2, the core and the boot info
+#define LBL_MEM_RESERVED            3
+#define LBL_MEM_ACPI_RECLAIM        4
+#define LBL_MEM_ACPI_NVS            5
+#define LBL_MEM_PERSISTENT          8
+
+#define LBL_FB_FORMAT_NONE          0
+#define LBL_FB_FORMAT_RGBX8888      1
+#define LBL_FB_FORMAT_BGRX8888      2
+#define LBL_FB_FORMAT_BITMASK       3
+
+typedef struct {
+    lbl_bios_u64 magic;
+    lbl_u32 version;
+    lbl_u32 header_size;
+    lbl_u32 total_size;
+
+    lbl_bios_u64 core_load_addr;
+    lbl_bios_u64 core_size;
+    lbl_bios_u64 core_entry_offset;
+    lbl_bios_u64 core_load_alignment;
+    lbl_bios_u64 core_compressed_size;
+    lbl_bios_u64 core_decompress_ticks;
+    lbl_u8  core_sha256[32];
+    lbl_u32 core_verify_flags;
+    lbl_u32 reserved_verify;
+    lbl_bios_u64 core_manifest_addr;
+    lbl_bios_u64 core_manifest_size;
+    lbl_bios_u64 core_heap_addr;
+    lbl_bios_u64 core_heap_size;
+
+    lbl_bios_u64 memory_map_buffer;     // No EFI map on BIOS: 0, the compact record is the map
+    lbl_bios_u64 memory_map_size;
+    lbl_bios_u64 memory_map_key;
+    lbl_bios_u64 memory_descriptor_size;
+    lbl_u32 memory_descriptor_version;
+    lbl_u32 exit_boot_services_retries;
+
+    lbl_bios_u64 framebuffer_addr;
+    lbl_bios_u64 framebuffer_size;
+    lbl_u32 framebuffer_width;
+    lbl_u32 framebuffer_height;
+    lbl_u32 framebuffer_pitch;
+    lbl_u8  framebuffer_bpp;
+    lbl_u8  framebuffer_pixel_format_info;
+    lbl_u16 reserved_graphics;
+    lbl_u8  framebuffer_red_shift;
+    lbl_u8  framebuffer_red_size;
+    lbl_u8  framebuffer_green_shift;
+    lbl_u8  framebuffer_green_size;
+    lbl_u8  framebuffer_blue_shift;
+    lbl_u8  framebuffer_blue_size;
+    lbl_u8  framebuffer_reserved_shift;
+    lbl_u8  framebuffer_reserved_size;
+    lbl_u32 framebuffer_flags;
+    lbl_u32 reserved_graphics2;
+
+    lbl_bios_u64 acpi_rsdp_ptr;
+    lbl_bios_u64 smbios_entry_ptr;
+    lbl_bios_u64 efi_system_table_ptr;  // 0 tells the core it booted from BIOS
+
+    lbl_bios_u64 stage1_log_addr;
+    lbl_u32 stage1_log_size;
+    lbl_u32 reserved_log;
+
+    lbl_bios_u64 page_table_root;
+    lbl_bios_u64 page_table_top;
+    lbl_bios_u64 higher_half_base;
+    lbl_u32 page_table_pages;
+    lbl_u32 page_table_flags;
+
+    lbl_bios_u64 reserved1;
+    lbl_bios_u64 reserved2;
+} LBL_BOOT_INFO;
+
+typedef struct {
+    lbl_u32 type;
+    lbl_u32 size;
+} LBL_BOOT_RECORD_HEADER;
+
+typedef struct {
+    lbl_bios_u64 base;
+    lbl_u32 pages;
+    lbl_u32 type;
+} LBL_MEMORY_RANGE;
+
+// --- Sector Cache (BIOS) ---
+// Set-associative cache of boot drive sectors in a reserved low-memory region,
+// filled by Stage 2 (lbl_bios_read_sectors) and handed to the core, whose block
+// layer looks sectors up here before going through INT 13h thunks of its own.
+// The region starts with the header; tags and line data follow.
+#define LBL_BIOS_SECTOR_CACHE_LIN   0x00020000  // Between the bounce buffer and the boot info
+#define LBL_BIOS_SECTOR_CACHE_SIZE  0x00050000
+#define LBL_SECTOR_CACHE_MAGIC      0x48434353  // "SCCH"
+#define LBL_SECTOR_CACHE_WAYS       4
+#define LBL_SECTOR_CACHE_TAG_VALID  0x00000001
+
+typedef struct {
+    lbl_u32 magic;                  // LBL_SECTOR_CACHE_MAGIC
+    lbl_u32 sector_size;
+    lbl_u32 sets;                   // Power of two: sector `lba` lives in set (lba & (sets - 1))
+    lbl_u32 ways;
+    lbl_u32 drive;                  // BIOS drive every line belongs to
+    lbl_u32 stamp;                  // LRU clock; a tag's stamp is its last use
+    lbl_bios_u64 tags_addr;         // LBL_SECTOR_CACHE_TAG[sets * ways], set by set
+    lbl_bios_u64 data_addr;         // Line of tag i at data_addr + i * sector_size
+    lbl_bios_u64 hits;              // Sectors served from the cache
+    lbl_bios_u64 misses;            // Sectors that had to be read
+    lbl_bios_u64 read_ahead;        // Sectors read beyond what was asked for
+} LBL_SECTOR_CACHE_HEADER;
+
+typedef struct {
+    lbl_bios_u64 lba;
+    lbl_u32 flags;                  // LBL_SECTOR_CACHE_TAG_*
+    lbl_u32 stamp;
+} LBL_SECTOR_CACHE_TAG;
+
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;  // type = LBL_BOOT_RECORD_SECTOR_CACHE
+    lbl_bios_u64 region_addr;       // LBL_SECTOR_CACHE_HEADER; LBL_MEM_LOADER in the memory map
+    lbl_bios_u64 region_size;
+} LBL_SECTOR_CACHE_RECORD;
+
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;
+    lbl_u32 count;
+    lbl_u32 capacity;
+} LBL_COMPACT_MEMORY_MAP_RECORD;
+
+// Boot timeline, as LblUefi.h. Stage 2 has three marks: entry (boot_32's first
+// instruction), the core read and the jump; the core appends behind them.
+#define LBL_TIMELINE_VERSION        1
+#define LBL_TIMELINE_CAPACITY       64
+
+#define LBL_TL_STAGE1_ENTRY         0x0001
+#define LBL_TL_CORE_READ_END        0x0004
+#define LBL_TL_CORE_JUMP            0x0007
+
+typedef struct {
+    lbl_bios_u64 ticks;
+    lbl_u32 id;                     // LBL_TL_*
+    lbl_u32 arg;
+} LBL_TIMELINE_EVENT;
+
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;  // type = LBL_BOOT_RECORD_TIMELINE
+    lbl_u32 version;
+    lbl_u32 capacity;
+    lbl_u32 count;
+    lbl_u32 dropped;
+    lbl_bios_u64 ticks_per_second;  // Calibrated against PIT channel 2 (0 = unknown)
+    LBL_TIMELINE_EVENT events[LBL_TIMELINE_CAPACITY];
+} LBL_TIMELINE_RECORD;
+
+// Bytes of LBL_BOOT_INFO on x86_64; caught here if the mirror drifts.
+typedef char lbl_bios_boot_info_size_check[sizeof(LBL_BOOT_INFO) == 320 ? 1 : -1];
+
+// What bios_info.asm gathers in real mode, at linear addresses below 64 KiB.
+// Field offsets are used by the assembly (LBL_HANDOFF_* there).
+#define LBL_BIOS_E820_MAX           128
+#define LBL_BIOS_VBE_NO_MODE        0xFFFF
+
+typedef struct {
+    lbl_u64 base;
+    lbl_u64 length;
+    lbl_u32 type;                   // 1 usable, 2 reserved, 3 ACPI, 4 NVS, 5 bad, 7 persistent
+    lbl_u32 attributes;             // ACPI 3.0: bit 0 clear = ignore the entry
+} LBL_BIOS_E820_ENTRY;
+
+typedef struct {
+    lbl_u32 e820_addr;              // LBL_BIOS_E820_ENTRY[e820_count]
+    lbl_u32 e820_count;
+    lbl_u32 rsdp_addr;              // From the EBDA or 0xE0000-0xFFFFF scan (0 = none)
+    lbl_u32 vbe_mode;               // Mode set with the linear framebuffer, or LBL_BIOS_VBE_NO_MODE
+    lbl_u32 vbe_mode_info_addr;     // Its 256-byte VBE ModeInfoBlock
+    lbl_u32 vbe_version;            // VbeInfoBlock.VbeVersion (BCD, 0x0300 = 3.0)
+    lbl_u32 vbe_memory_bytes;       // VbeInfoBlock.TotalMemory in bytes
+    lbl_u32 core_load_addr;
+    lbl_u32 core_size;              // Bytes read
+    lbl_u32 stage2_base;            // boot_32 image and its .bss
+    lbl_u32 stage2_size;
+    lbl_u32 disk_sector_size;       // Boot drive, from AH=48h
+    lbl_u32 disk_chunk_limit;       // Sectors one AH=42h call takes
+    lbl_u32 boot_drive;
+    lbl_bios_u64 tsc_entry;         // TSC at stage2_start
+    lbl_bios_u64 tsc_core_loaded;   // ...and once the core is in memory
+} LBL_BIOS_HANDOFF;
+
+// LBL_HANDOFF_SIZE in bios_info.asm.
+typedef char lbl_bios_handoff_size_check[sizeof(LBL_BIOS_HANDOFF) == 72 ? 1 : -1];
+
+#define LBL_BIOS_BOUNCE_LIN         0x00010000  // LBL_BIOS_BOUNCE_SEGMENT in bios_disk.asm
+#define LBL_BIOS_BOUNCE_BYTES       0xFE00
+
+/**
+ * @brief Protected-mode thunk in bios_disk.asm: one INT 13h AH=42h read of `count`
+ * sectors into the bounce buffer at LBL_BIOS_BOUNCE_LIN.
+ * @return 0 on success.
+ */
+int lbl_bios_disk_read(lbl_u32 drive, lbl_u32 lba_low, lbl_u32 lba_high, lbl_u32 count);
+
+/**
+ * @brief Sets up the sector cache in its reserved region and warms it with the
+ * boot volume's metadata: MBR, FAT32 boot sector, FSInfo, the start of the first
+ * FAT and the root directory cluster. Leaves the cache off if the sector size
+ * is unusable. Called from protected mode before lbl_bios_build_boot_info.
+ */
+void lbl_bios_sector_cache_init(const LBL_BIOS_HANDOFF* handoff);
+
+/**
+ * @brief Builds the LBL_BOOT_INFO for the core from what real mode collected: the
+ * header, the VBE framebuffer, the RSDP, the sector cache record, the boot
+ * timeline and a compact memory map record in the UEFI loader's format (sorted,
+ * merged, loader ranges carved out). Marks LBL_TL_CORE_JUMP last.
+ * Runs in 32-bit protected mode; touches memory, the PIT and (LBL_TIMELINE_SERIAL) COM1.
+ * @param handoff Filled in by bios_info.asm.
+ * @param area Zeroed or not; the whole area is cleared first.
+ * @param capacity Size of the area in bytes.
+ * @return area, or NULL if it is too small for the header.
+ */
+LBL_BOOT_INFO* lbl_bios_build_boot_info(const LBL_BIOS_HANDOFF* handoff, void* area, lbl_u32 capacity);
+
 
 #elif defined(LBL_UEFI_ENV)
 // --- Declarations for UEFI Environment ---
@@ -67,8 +345,201 @@ void lbl_uefi_print_string(const CHAR16* str);
  */
 void lbl_uefi_print_ascii_string(const char* ascii_str);
 
+// --- Stage 1 log ---
+// Messages go to an in-memory ring instead of ConOut, which is often a slow serial
+// or SOL console. The ring is written to the console in batches by
+// lbl_uefi_log_flush() and handed to the core (LBL_BOOT_INFO.stage1_log_addr),
+// which replays it after ExitBootServices.
+
+// Verbosity levels; same values as the core's log::LevelFilter.
+#define LBL_LOG_LEVEL_OFF       0
+#define LBL_LOG_LEVEL_ERROR     1
+#define LBL_LOG_LEVEL_WARN      2
+#define LBL_LOG_LEVEL_INFO      3
+#define LBL_LOG_LEVEL_DEBUG     4
+#define LBL_LOG_LEVEL_TRACE     5
+
+// Messages above this level are not compiled in at all.
+#ifndef LBL_LOG_COMPILE_LEVEL
+#define LBL_LOG_COMPILE_LEVEL   LBL_LOG_LEVEL_INFO
+#endif
+
+#define LBL_UEFI_LOG_RING_SIZE  (8 * 1024)  // Power of two
+#define LBL_UEFI_LOG_LINE_MAX   256         // Characters kept per message
+
+// Ring layout shared with the core. Each message is stored as one level byte
+// (LBL_LOG_LEVEL_*), ASCII text and '\n'. Once `written` exceeds `capacity` the
+// oldest bytes are overwritten; readers then skip to the first whole line.
+typedef struct {
+    UINT64 written;                 // Bytes ever appended; next one goes to data[written % capacity]
+    UINT64 flushed;                 // Bytes already passed through lbl_uefi_log_flush()
+    UINT32 capacity;                // LBL_UEFI_LOG_RING_SIZE
+    UINT8 record_level;             // Messages above this runtime level are dropped
+    UINT8 console_level;            // Default flush level (see lbl_uefi_log_flush_console)
+    UINT16 reserved;
+    UINT8 data[LBL_UEFI_LOG_RING_SIZE];
+} LBL_UEFI_LOG_RING;
+
+/**
+ * @brief Formats a message (Print syntax) into the log ring.
+ * Use the LBL_LOG_* macros, which compile out levels above LBL_LOG_COMPILE_LEVEL.
+ * Never touches the console or allocates, so it is cheap on any console.
+ */
+void lbl_uefi_log(UINT8 level, const CHAR16* fmt, ...);
+
+/**
+ * @brief Sets the runtime levels (clamped to LBL_LOG_COMPILE_LEVEL for recording).
+ */
+void lbl_uefi_log_set_levels(UINT8 record_level, UINT8 console_level);
+
+/**
+ * @brief Writes not-yet-flushed messages at or below max_level to ConOut, batching
+ * many lines per OutputString call. Only valid before ExitBootServices.
+ */
+void lbl_uefi_log_flush(UINT8 max_level);
+
+/**
+ * @brief Flushes at the ring's console_level (the normal-exit policy).
+ */
+void lbl_uefi_log_flush_console(void);
+
+/**
+ * @brief The log ring (static storage in the loader image).
+ */
+LBL_UEFI_LOG_RING* lbl_uefi_log_ring(void);
+
+#if LBL_LOG_COMPILE_LEVEL >= LBL_LOG_LEVEL_ERROR
+#define LBL_LOG_ERROR(...)  lbl_uefi_log(LBL_LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LBL_LOG_ERROR(...)  ((void)0)
+#endif
+#if LBL_LOG_COMPILE_LEVEL >= LBL_LOG_LEVEL_WARN
+#define LBL_LOG_WARN(...)   lbl_uefi_log(LBL_LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LBL_LOG_WARN(...)   ((void)0)
+#endif
+#if LBL_LOG_COMPILE_LEVEL >= LBL_LOG_LEVEL_INFO
+#define LBL_LOG_INFO(...)   lbl_uefi_log(LBL_LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LBL_LOG_INFO(...)   ((void)0)
+#endif
+#if LBL_LOG_COMPILE_LEVEL >= LBL_LOG_LEVEL_DEBUG
+#define LBL_LOG_DEBUG(...)  lbl_uefi_log(LBL_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LBL_LOG_DEBUG(...)  ((void)0)
+#endif
+#if LBL_LOG_COMPILE_LEVEL >= LBL_LOG_LEVEL_TRACE
+#define LBL_LOG_TRACE(...)  lbl_uefi_log(LBL_LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+#define LBL_LOG_TRACE(...)  ((void)0)
+#endif
+
+/**
+ * @brief Returns the size in bytes of an open file (from EFI_FILE_INFO).
+ */
+EFI_STATUS lbl_uefi_file_size(EFI_FILE_PROTOCOL* file_handle, UINT64* file_size);
+
+/**
+ * @brief Opens a file for reading relative to an already opened volume root.
+ * Lets several files be opened from one OpenVolume.
+ * @param root_fs Volume root directory.
+ * @param file_path Null-terminated CHAR16 path to the file on that volume.
+ * @param file_out Output: the opened file, positioned at offset 0.
+ * @param file_size Output: size of the file in bytes.
+ * @return EFI_STATUS indicating success or failure. root_fs is never closed.
+ */
+EFI_STATUS lbl_uefi_open_file_in_volume(
+    EFI_FILE_PROTOCOL* root_fs,
+    CONST CHAR16* file_path,
+    EFI_FILE_PROTOCOL** file_out,
+    UINT64* file_size
+);
+
+/**
+ * @brief Opens a file for reading on the filesystem of a given UEFI device handle.
+ * Close both handles with `lbl_uefi_close_file()` when done.
+ * @param device_handle EFI handle of the device/partition containing the filesystem.
+ * @param file_path Null-terminated CHAR16 path to the file on the filesystem.
+ * @param root_out Output: the opened volume root directory.
+ * @param file_out Output: the opened file, positioned at offset 0.
+ * @param file_size Output: size of the file in bytes.
+ * @return EFI_STATUS indicating success or failure. Nothing is left open on failure.
+ */
+EFI_STATUS lbl_uefi_open_file(
+    EFI_HANDLE device_handle,
+    CONST CHAR16* file_path,
+    EFI_FILE_PROTOCOL** root_out,
+    EFI_FILE_PROTOCOL** file_out,
+    UINT64* file_size
+);
+
+/**
+ * @brief Closes handles returned by `lbl_uefi_open_file()`. Either may be NULL.
+ */
+VOID lbl_uefi_close_file(EFI_FILE_PROTOCOL* root_fs, EFI_FILE_PROTOCOL* file_handle);
+
+// Default bytes per Read for streamed loads. Many firmware FAT drivers are much
+// faster with 1-4 MiB reads than with a single read of the whole file.
+#define LBL_UEFI_STREAM_DEFAULT_CHUNK   (2 * 1024 * 1024)
+
+/**
+ * @brief Per-chunk consumer for streamed reads (hashing, decompression, verification).
+ * Called once per chunk, in file order. When the file protocol supports ReadEx,
+ * the read of the next chunk is already in flight while this runs.
+ * @param context Caller-supplied context from LBL_UEFI_STREAM.
+ * @param offset File offset of the first byte of the chunk.
+ * @param chunk Chunk data. Only valid for the duration of the call unless it lies
+ *              in the caller's own destination buffer.
+ * @param length Chunk length in bytes.
+ * @return EFI_SUCCESS to continue; any error aborts the stream and is returned.
+ */
+typedef EFI_STATUS (*LBL_UEFI_CHUNK_CONSUMER)(VOID* context, UINT64 offset, CONST VOID* chunk, UINTN length);
+
+// Parameters for a streamed read.
+typedef struct {
+    UINTN chunk_size;                   // Bytes per Read; 0 selects LBL_UEFI_STREAM_DEFAULT_CHUNK
+    VOID* destination;                  // Optional: chunks are read straight into this buffer
+    UINT64 destination_size;            // Size of destination in bytes
+    LBL_UEFI_CHUNK_CONSUMER consumer;   // Optional: called for every chunk
+    VOID* consumer_context;
+} LBL_UEFI_STREAM;
+
+/**
+ * @brief Reads `length` bytes from an open file in chunks, feeding each to the consumer.
+ * With a destination buffer, data lands at destination + (file offset - start_offset)
+ * and nothing is copied. Without one, two chunk-sized bounce buffers are used so
+ * one can be consumed while the other is being filled.
+ * @param file_handle File positioned at `start_offset`.
+ * @param start_offset Current file position; only used to report chunk offsets.
+ * @param length Number of bytes to read.
+ * @param stream Stream parameters.
+ * @return EFI_STATUS; a short read is reported as EFI_END_OF_FILE.
+ */
+EFI_STATUS lbl_uefi_stream_file(
+    EFI_FILE_PROTOCOL* file_handle,
+    UINT64 start_offset,
+    UINT64 length,
+    CONST LBL_UEFI_STREAM* stream
+);
+
+/**
+ * @brief Opens a file on a device and streams all of it (see `lbl_uefi_stream_file()`).
+ * @param device_handle EFI handle of the device/partition containing the filesystem.
+ * @param file_path Null-terminated CHAR16 path to the file on the filesystem.
+ * @param stream Stream parameters. A destination, if given, must hold the whole file.
+ * @param file_size Output: size of the file in bytes (also set on EFI_BUFFER_TOO_SMALL).
+ * @return EFI_STATUS indicating success or failure.
+ */
+EFI_STATUS lbl_uefi_stream_file_from_device(
+    EFI_HANDLE device_handle,
+    CONST CHAR16* file_path,
+    CONST LBL_UEFI_STREAM* stream,
+    UINT64* file_size
+);
+
 /**
  * @brief Loads a file from a filesystem on a given UEFI device handle.
+ * Thin wrapper over the streaming reader that reads into a pool buffer.
  * The caller is responsible for freeing `*file_buffer` using `BS->FreePool()` if successful.
  * @param device_handle EFI handle of the device/partition containing the filesystem.
  * @param file_path Null-terminated CHAR16 path to the file on the filesystem.
@@ -78,13 +549,158 @@ void lbl_uefi_print_ascii_string(const char* ascii_str);
  */
 EFI_STATUS lbl_uefi_load_file_from_device(
     EFI_HANDLE device_handle,
-    CHAR16* file_path,
+    CONST CHAR16* file_path,
     VOID** file_buffer,
     UINTN* file_size
 );
 
+// --- Extent Map Sidecar ---
+// Written at install time next to a file (e.g. \LBL\CORE\lbl_core.ext for
+// lbl_core.bin). Lists the file's on-disk runs so Stage 1 can read it with a few
+// large Disk/Block I/O reads instead of going through the firmware FAT driver.
+// Layout: LBL_EXTENT_MAP_HEADER followed by extent_count LBL_EXTENT entries.
+#define LBL_EXTENT_MAP_MAGIC        0x4C424C4558544D31 // "LBLEXTM1"
+#define LBL_EXTENT_MAP_MAX_EXTENTS  256                // Fragmented beyond this: use the FS path
+
+typedef struct {
+    UINT64 lba;                     // First block, relative to the start of the partition
+    UINT64 blocks;                  // Run length in blocks
+} LBL_EXTENT;
+
+typedef struct {
+    UINT64 magic;                   // LBL_EXTENT_MAP_MAGIC
+    UINT32 header_size;             // sizeof(LBL_EXTENT_MAP_HEADER)
+    UINT32 block_size;              // Block size the LBAs are in; must match the media
+    UINT64 file_size;               // Size of the mapped file in bytes
+    UINT32 extent_count;            // Number of LBL_EXTENT entries that follow
+    UINT32 file_crc32;              // CRC32 of the file contents
+    UINT32 map_crc32;               // CRC32 of header (with this field 0) and extents
+    UINT32 reserved;
+} LBL_EXTENT_MAP_HEADER;
+
+/**
+ * @brief Reads and validates an extent map sidecar for a file of `file_size` bytes.
+ * The caller is responsible for freeing `*map_out` using `BS->FreePool()` if successful.
+ * @return EFI_NOT_FOUND if there is no sidecar, EFI_VOLUME_CORRUPTED/EFI_CRC_ERROR if it is stale.
+ */
+EFI_STATUS lbl_uefi_load_extent_map(
+    EFI_FILE_PROTOCOL* root_fs,
+    CONST CHAR16* map_path,
+    UINT64 file_size,
+    LBL_EXTENT_MAP_HEADER** map_out
+);
+
+/**
+ * @brief Reads a file through its extent map with Disk I/O (or Block I/O) and checks
+ * the data against the map's file_crc32.
+ * @param device_handle Partition handle that the extent LBAs are relative to.
+ * @param map Map returned by `lbl_uefi_load_extent_map()`.
+ * @param destination Buffer of at least map->file_size bytes.
+ * @param check_crc FALSE skips the CRC pass when the caller verifies the data
+ *        itself (e.g. against a manifest digest).
+ * @return EFI_SUCCESS only if all data was read and (when checked) its CRC matches.
+ */
+EFI_STATUS lbl_uefi_read_extents(
+    EFI_HANDLE device_handle,
+    CONST LBL_EXTENT_MAP_HEADER* map,
+    VOID* destination,
+    BOOLEAN check_crc
+);
+
+// State of an asynchronous extent read started by lbl_uefi_read_extents_async().
+typedef struct {
+    CONST LBL_EXTENT_MAP_HEADER* map;   // Map being read (must outlive the read)
+    VOID* destination;                  // Target buffer
+    EFI_DISK_IO2_TOKEN* tokens;         // One token (and event) per submitted run
+    UINTN submitted;                    // Runs handed to ReadDiskEx
+    EFI_STATUS status;                  // First submission error, if any
+    BOOLEAN check_crc;                  // Verify file_crc32 once the runs are in
+} LBL_UEFI_ASYNC_EXTENT_READ;
+
+/**
+ * @brief Starts reading a file through its extent map with EFI_DISK_IO2_PROTOCOL.
+ * All runs are submitted at once; the caller can do other work while the DMA is
+ * in flight and must then call `lbl_uefi_wait_extents_async()` exactly once.
+ * @param check_crc As for `lbl_uefi_read_extents()`.
+ * @return EFI_UNSUPPORTED if Disk I/O 2 is unavailable or nothing could be
+ *         submitted (nothing is in flight then); EFI_SUCCESS otherwise.
+ */
+EFI_STATUS lbl_uefi_read_extents_async(
+    EFI_HANDLE device_handle,
+    CONST LBL_EXTENT_MAP_HEADER* map,
+    VOID* destination,
+    BOOLEAN check_crc,
+    LBL_UEFI_ASYNC_EXTENT_READ* op
+);
+
+/**
+ * @brief Waits for every run of an asynchronous extent read, releases its events,
+ * and verifies the data against the map's file_crc32 if the read was started so.
+ */
+EFI_STATUS lbl_uefi_wait_extents_async(LBL_UEFI_ASYNC_EXTENT_READ* op);
+
+// --- Memory Map Headroom Policy ---
+// A map buffer is sized for the map as measured just before allocating it, plus headroom
+// for growth before it is filled: the buffer's own allocation can split a free range
+// (+2 descriptors), and firmware keeps allocating from timer/USB/network callbacks
+// until ExitBootServices. Growth scales with map size, so headroom is a fraction of
+// the measured descriptor count with a fixed floor.
+#define LBL_UEFI_MAP_HEADROOM_MIN_DESCRIPTORS   8
+#define LBL_UEFI_MAP_HEADROOM_PERCENT           25
+// GetMemoryMap -> ExitBootServices rounds before giving up on a moving map key.
+#define LBL_UEFI_EXIT_BOOT_SERVICES_ATTEMPTS    8
+
+/**
+ * @brief Returns the headroom, in bytes, to add to a measured memory map size.
+ * @param map_size Measured map size in bytes (as returned by GetMemoryMap).
+ * @param descriptor_size Descriptor stride in bytes.
+ */
+UINTN lbl_uefi_memory_map_headroom(UINTN map_size, UINTN descriptor_size);
+
+// A memory map buffer that is allocated once and then refilled in place, so taking
+// a new snapshot never changes the map key.
+typedef struct {
+    EFI_MEMORY_DESCRIPTOR* buffer;
+    UINTN buffer_size;              // Allocated bytes
+    UINTN map_size;                 // Bytes used by the last snapshot
+    UINTN map_key;
+    UINTN descriptor_size;
+    UINT32 descriptor_version;
+    UINT32 retries;                 // Extra rounds lbl_uefi_exit_boot_services() needed
+    UINT32 attempts;                // ExitBootServices calls made
+    UINT64 attempt_ticks[LBL_UEFI_EXIT_BOOT_SERVICES_ATTEMPTS]; // Cycle counter before each call
+} LBL_UEFI_MEMORY_MAP;
+
+/**
+ * @brief Measures the memory map and allocates a buffer with policy headroom, then
+ * takes a first snapshot into it.
+ * Free with `BS->FreePool(map->buffer)` if ExitBootServices is not reached.
+ */
+EFI_STATUS lbl_uefi_memory_map_prepare(LBL_UEFI_MEMORY_MAP* map);
+
+/**
+ * @brief Refreshes the snapshot in the existing buffer. Never allocates.
+ * @return EFI_BUFFER_TOO_SMALL if the map outgrew the headroom.
+ */
+EFI_STATUS lbl_uefi_memory_map_snapshot(LBL_UEFI_MEMORY_MAP* map);
+
+/**
+ * @brief Hands the machine over: snapshot -> ExitBootServices, retried in the same
+ * buffer while the firmware reports a stale map key (EFI_INVALID_PARAMETER).
+ * Nothing is allocated or printed inside the loop; after a failed attempt only
+ * GetMemoryMap and ExitBootServices may be called.
+ * On success, `map` describes the final map and `map->retries` the extra rounds.
+ * Each attempt is timestamped in `map->attempt_ticks` (the first
+ * LBL_UEFI_EXIT_BOOT_SERVICES_ATTEMPTS of them).
+ * @param image_handle This image's handle.
+ * @param map A buffer from `lbl_uefi_memory_map_prepare()`.
+ * @param max_attempts Upper bound on ExitBootServices calls.
+ */
+EFI_STATUS lbl_uefi_exit_boot_services(EFI_HANDLE image_handle, LBL_UEFI_MEMORY_MAP* map, UINTN max_attempts);
+
 /**
  * @brief Gets the current UEFI Memory Map.
+ * The buffer is sized with `lbl_uefi_memory_map_headroom()`.
  * The caller is responsible for freeing `*memory_map_ptr` using `BS->FreePool()` if successful.
  * @param memory_map_ptr Output: Pointer to receive an allocated buffer containing the memory map.
  * @param map_size In/Out: On input, typically 0 or current buffer size. On output, actual map size.
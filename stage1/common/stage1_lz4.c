@@ -0,0 +1,243 @@
+// Lionbootloader - Stage 1 - LZ4 Block Decoder
+// File: stage1/common/stage1_lz4.c
+
+#include "stage1_lz4.h"
+
+// Bytes the wild-copy loops may write past the end of a copy. They are only taken
+// when this much room is left in both input and output; the tail of a buffer
+// falls back to exact byte copies.
+#define LBL_LZ4_WILD_SLACK  16
+
+// Longest length accepted from one varint-style length field. Larger values
+// cannot come from a sane block and would risk pointer overflow.
+#define LBL_LZ4_MAX_LENGTH  (1u << 30)
+
+static void lbl_lz4_copy_bytes(lbl_u8* dst, const lbl_u8* src, lbl_usize len) {
+    while (len--) {
+        *dst++ = *src++;
+    }
+}
+
+// 16-byte strides; __builtin_memcpy with a constant size compiles to plain
+// loads/stores (no libc call) and lets the compiler use SSE/NEON registers.
+static void lbl_lz4_wild_copy16(lbl_u8* dst, const lbl_u8* src, const lbl_u8* dst_end) {
+    do {
+        __builtin_memcpy(dst, src, 16);
+        dst += 16;
+        src += 16;
+    } while (dst < dst_end);
+}
+
+// For overlapping matches with 8 <= offset < 16: each 8-byte read only covers
+// bytes that are already final.
+static void lbl_lz4_wild_copy8(lbl_u8* dst, const lbl_u8* src, const lbl_u8* dst_end) {
+    do {
+        __builtin_memcpy(dst, src, 8);
+        dst += 8;
+        src += 8;
+    } while (dst < dst_end);
+}
+
+// Non-overlapping exact-length copy: 16-byte strides, then a byte tail.
+static void lbl_lz4_copy(lbl_u8* dst, const lbl_u8* src, lbl_usize len) {
+    while (len >= 16) {
+        __builtin_memcpy(dst, src, 16);
+        dst += 16;
+        src += 16;
+        len -= 16;
+    }
+    lbl_lz4_copy_bytes(dst, src, len);
+}
+
+// Reads the continuation bytes of a length field (each 255 means "more follows").
+static int lbl_lz4_read_length(const lbl_u8** ip, const lbl_u8* iend, lbl_usize* length) {
+    lbl_u8 b;
+    do {
+        if (*ip >= iend) {
+            return -1;
+        }
+        b = *(*ip)++;
+        *length += b;
+        if (*length > LBL_LZ4_MAX_LENGTH) {
+            return -1;
+        }
+    } while (b == 255);
+    return 0;
+}
+
+int lbl_lz4_decode_block(const lbl_u8* src, lbl_usize src_len,
+                         lbl_u8* out, lbl_usize out_pos, lbl_usize out_cap,
+                         lbl_usize* produced) {
+    const lbl_u8* ip = src;
+    const lbl_u8* const iend = src + src_len;
+    lbl_u8* op = out + out_pos;
+    lbl_u8* const ostart = op;
+    lbl_u8* const oend = out + out_cap;
+
+    if (out_pos > out_cap || src_len == 0) {
+        return -1;
+    }
+
+    for (;;) {
+        unsigned token;
+        lbl_usize lit, mlen, offset;
+        const lbl_u8* match;
+
+        token = *ip++;
+
+        // Literals
+        lit = token >> 4;
+        if (lit == 15 && lbl_lz4_read_length(&ip, iend, &lit) != 0) {
+            return -1;
+        }
+        if ((lbl_usize)(iend - ip) < lit || (lbl_usize)(oend - op) < lit) {
+            return -1;
+        }
+        if (lit != 0) {
+            if ((lbl_usize)(iend - ip) >= lit + LBL_LZ4_WILD_SLACK &&
+                (lbl_usize)(oend - op) >= lit + LBL_LZ4_WILD_SLACK) {
+                lbl_lz4_wild_copy16(op, ip, op + lit);
+            } else {
+                lbl_lz4_copy_bytes(op, ip, lit);
+            }
+            op += lit;
+            ip += lit;
+        }
+
+        // The last sequence of a block carries literals only.
+        if (ip == iend) {
+            break;
+        }
+
+        // Match
+        if (iend - ip < 2) {
+            return -1;
+        }
+        offset = (lbl_usize)ip[0] | ((lbl_usize)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (lbl_usize)(op - out)) {
+            return -1;
+        }
+        match = op - offset;
+
+        mlen = token & 15;
+        if (mlen == 15 && lbl_lz4_read_length(&ip, iend, &mlen) != 0) {
+            return -1;
+        }
+        mlen += 4;
+        if ((lbl_usize)(oend - op) < mlen) {
+            return -1;
+        }
+        if ((lbl_usize)(oend - op) >= mlen + LBL_LZ4_WILD_SLACK && offset >= 16) {
+            lbl_lz4_wild_copy16(op, match, op + mlen);
+        } else if ((lbl_usize)(oend - op) >= mlen + LBL_LZ4_WILD_SLACK && offset >= 8) {
+            lbl_lz4_wild_copy8(op, match, op + mlen);
+        } else {
+            lbl_lz4_copy_bytes(op, match, mlen); // Short offsets repeat a pattern byte by byte
+        }
+        op += mlen;
+
+        if (ip >= iend) {
+            return -1; // A block must end with a literal-only sequence
+        }
+    }
+
+    *produced = (lbl_usize)(op - ostart);
+    return 0;
+}
+
+void lbl_lz4_stream_init(LBL_LZ4_STREAM* stream, lbl_u8* out, lbl_usize out_size,
+                         lbl_u8* stage, lbl_usize stage_cap) {
+    stream->out = out;
+    stream->out_size = out_size;
+    stream->out_pos = 0;
+    stream->stage = stage;
+    stream->stage_cap = stage_cap;
+    stream->stage_len = 0;
+}
+
+static lbl_u32 lbl_lz4_read_le32(const lbl_u8* p) {
+    return (lbl_u32)p[0] | ((lbl_u32)p[1] << 8) | ((lbl_u32)p[2] << 16) | ((lbl_u32)p[3] << 24);
+}
+
+// Decodes one complete block whose length word has already been consumed.
+static int lbl_lz4_stream_block(LBL_LZ4_STREAM* stream, lbl_u32 word, const lbl_u8* data) {
+    lbl_usize len = word & ~LBL_LZ4_BLOCK_UNCOMPRESSED;
+    lbl_usize produced = 0;
+
+    if (word & LBL_LZ4_BLOCK_UNCOMPRESSED) {
+        if (stream->out_size - stream->out_pos < len) {
+            return -1;
+        }
+        lbl_lz4_copy(stream->out + stream->out_pos, data, len);
+        produced = len;
+    } else if (lbl_lz4_decode_block(data, len, stream->out, stream->out_pos,
+                                    stream->out_size, &produced) != 0) {
+        return -1;
+    }
+    stream->out_pos += produced;
+    return 0;
+}
+
+int lbl_lz4_stream_update(LBL_LZ4_STREAM* stream, const lbl_u8* in, lbl_usize len) {
+    while (len != 0) {
+        lbl_u32 word;
+        lbl_usize block_len, need;
+
+        // Fast path: a whole block is available in the caller's buffer.
+        if (stream->stage_len == 0 && len >= 4) {
+            word = lbl_lz4_read_le32(in);
+            block_len = word & ~LBL_LZ4_BLOCK_UNCOMPRESSED;
+            if (block_len == 0 || 4 + block_len > stream->stage_cap) {
+                return -1;
+            }
+            if (len - 4 >= block_len) {
+                if (lbl_lz4_stream_block(stream, word, in + 4) != 0) {
+                    return -1;
+                }
+                in += 4 + block_len;
+                len -= 4 + block_len;
+                continue;
+            }
+        }
+
+        // Slow path: accumulate the length word, then the rest of the block.
+        if (stream->stage_len < 4) {
+            need = 4 - stream->stage_len;
+            if (need > len) {
+                need = len;
+            }
+            lbl_lz4_copy_bytes(stream->stage + stream->stage_len, in, need);
+            stream->stage_len += need;
+            in += need;
+            len -= need;
+            if (stream->stage_len < 4) {
+                return 0;
+            }
+        }
+        word = lbl_lz4_read_le32(stream->stage);
+        block_len = word & ~LBL_LZ4_BLOCK_UNCOMPRESSED;
+        if (block_len == 0 || 4 + block_len > stream->stage_cap) {
+            return -1;
+        }
+        need = 4 + block_len - stream->stage_len;
+        if (need > len) {
+            need = len;
+        }
+        lbl_lz4_copy(stream->stage + stream->stage_len, in, need);
+        stream->stage_len += need;
+        in += need;
+        len -= need;
+        if (stream->stage_len == 4 + block_len) {
+            stream->stage_len = 0;
+            if (lbl_lz4_stream_block(stream, word, stream->stage + 4) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int lbl_lz4_stream_finish(const LBL_LZ4_STREAM* stream) {
+    return (stream->stage_len == 0 && stream->out_pos == stream->out_size) ? 0 : -1;
+}
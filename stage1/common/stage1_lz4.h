@@ -0,0 +1,65 @@
+// Lionbootloader - Stage 1 - LZ4 Block Decoder
+// File: stage1/common/stage1_lz4.h
+//
+// Freestanding decoder for the LZ4 block format, shared by the BIOS and UEFI
+// loaders. It has no environment dependencies (no allocation, no firmware calls).
+
+#ifndef STAGE1_LZ4_H
+#define STAGE1_LZ4_H
+
+#include "stage1_loader_utils.h" // lbl_u8 / lbl_u32 / lbl_usize
+
+// Worst-case compressed size of an LZ4 block holding n bytes (LZ4_COMPRESSBOUND).
+#define LBL_LZ4_COMPRESS_BOUND(n)   ((n) + ((n) / 255) + 16)
+
+// Block-length word flag: the block is stored verbatim (same as the LZ4 frame format).
+#define LBL_LZ4_BLOCK_UNCOMPRESSED  0x80000000u
+
+/**
+ * @brief Decodes one LZ4 block into a larger output buffer.
+ * Matches may reach back past `out_pos` into earlier output, so consecutive
+ * blocks can be linked (compressed with the previous blocks as dictionary).
+ * @param src Compressed block.
+ * @param src_len Size of the compressed block in bytes.
+ * @param out Start of the whole output buffer.
+ * @param out_pos Offset in `out` where this block's output starts.
+ * @param out_cap Size of `out`; nothing is ever written at or beyond it.
+ * @param produced Output: number of bytes decoded.
+ * @return 0 on success, -1 on malformed input or output overflow.
+ */
+int lbl_lz4_decode_block(const lbl_u8* src, lbl_usize src_len,
+                         lbl_u8* out, lbl_usize out_pos, lbl_usize out_cap,
+                         lbl_usize* produced);
+
+// Incremental decoder for a sequence of length-prefixed blocks:
+//   repeat { u32 length (little-endian, | LBL_LZ4_BLOCK_UNCOMPRESSED if stored); data }
+// Input may be fed in arbitrary pieces. Blocks that arrive whole are decoded
+// straight from the caller's buffer; only a block split across pieces is staged.
+typedef struct {
+    lbl_u8* out;                // Final buffer the data is decoded into
+    lbl_usize out_size;         // Expected decoded size
+    lbl_usize out_pos;          // Bytes decoded so far
+    lbl_u8* stage;              // Holding area for a split block (caller-provided)
+    lbl_usize stage_cap;        // Must be >= 4 + LBL_LZ4_COMPRESS_BOUND(largest block)
+    lbl_usize stage_len;        // Bytes currently staged (including the length word)
+} LBL_LZ4_STREAM;
+
+/**
+ * @brief Initializes a block stream decoder.
+ */
+void lbl_lz4_stream_init(LBL_LZ4_STREAM* stream, lbl_u8* out, lbl_usize out_size,
+                         lbl_u8* stage, lbl_usize stage_cap);
+
+/**
+ * @brief Feeds the next piece of the block stream.
+ * @return 0 on success, -1 on malformed input.
+ */
+int lbl_lz4_stream_update(LBL_LZ4_STREAM* stream, const lbl_u8* in, lbl_usize len);
+
+/**
+ * @brief Checks that the stream ended on a block boundary with all output produced.
+ * @return 0 if complete, -1 otherwise.
+ */
+int lbl_lz4_stream_finish(const LBL_LZ4_STREAM* stream);
+
+#endif // STAGE1_LZ4_H
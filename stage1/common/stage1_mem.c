@@ -0,0 +1,482 @@
+// Lionbootloader - Stage 1 - Freestanding Memory Operations
+// File: stage1/common/stage1_mem.c
+
+#include "stage1_mem.h"
+
+#define LBL_MEM_DETECTED    0x80000000u // lbl_mem_caps: lbl_mem_detect() has run
+#define LBL_MEM_BLOCK       64          // Bytes per iteration of the vector loops
+
+static lbl_u32 lbl_mem_caps; // LBL_MEM_FEATURE_* | LBL_MEM_DETECTED
+
+// Each architecture below provides:
+//   lbl_mem_detect()          LBL_MEM_FEATURE_* for the running CPU
+//   lbl_mem_copy_forward()    ascending copy (non-temporal if size >= the threshold)
+//   lbl_mem_copy_backward()   descending copy, for lbl_mem_move
+//   lbl_mem_fill()            repeats a 32-bit pattern over `size` bytes
+//   lbl_mem_equal_prefix()    bytes known equal, in whole vectors, before the first difference
+// The scalar loops write through volatile pointers: the compiler would otherwise
+// recognise them and emit a call to memcpy / memset, which no Stage 1 image links.
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#if defined(__x86_64__)
+#define LBL_MEM_REP_MOVSW   "rep movsq"
+#define LBL_MEM_REP_STOSW   "rep stosq"
+#else
+#define LBL_MEM_REP_MOVSW   "rep movsl"
+#define LBL_MEM_REP_STOSW   "rep stosl"
+#endif
+
+typedef char lbl_v16qi __attribute__((vector_size(16)));
+
+static lbl_u32 lbl_mem_detect(void) {
+    lbl_u32 max_leaf, eax, ebx, ecx, edx;
+    lbl_u32 features = 0;
+
+    __asm__ __volatile__("cpuid" : "=a"(max_leaf), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    if (max_leaf < 1) {
+        return 0;
+    }
+    __asm__ __volatile__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1), "c"(0));
+#if defined(__x86_64__)
+    features |= LBL_MEM_FEATURE_SSE2; // Architectural in long mode; UEFI enables it
+#else
+    if (edx & (1u << 26)) {
+        lbl_usize cr4;
+        __asm__ __volatile__("mov %%cr4, %0" : "=r"(cr4));
+        if (cr4 & (1u << 9)) { // CR4.OSFXSR: the BIOS path leaves SSE disabled
+            features |= LBL_MEM_FEATURE_SSE2;
+        }
+    }
+#endif
+    if ((features & LBL_MEM_FEATURE_SSE2) && (ecx & (1u << 27)) && (ecx & (1u << 28))) { // OSXSAVE, AVX
+        lbl_u32 xcr0, xcr0_hi;
+        __asm__ __volatile__("xgetbv" : "=a"(xcr0), "=d"(xcr0_hi) : "c"(0));
+        if ((xcr0 & 0x6) == 0x6) { // XMM and YMM state enabled
+            features |= LBL_MEM_FEATURE_AVX;
+        }
+    }
+    if (max_leaf >= 7) {
+        __asm__ __volatile__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+        if (ebx & (1u << 9)) {
+            features |= LBL_MEM_FEATURE_ERMS;
+        }
+        if (edx & (1u << 4)) {
+            features |= LBL_MEM_FEATURE_FSRM;
+        }
+    }
+    return features;
+}
+
+static void lbl_mem_movsb(lbl_u8* dst, const lbl_u8* src, lbl_usize size) {
+    __asm__ __volatile__("rep movsb" : "+D"(dst), "+S"(src), "+c"(size) : : "memory");
+}
+
+static void lbl_mem_movs_words(lbl_u8* dst, const lbl_u8* src, lbl_usize size) {
+    lbl_usize words = size / sizeof(lbl_usize);
+    lbl_usize rest = size % sizeof(lbl_usize);
+
+    __asm__ __volatile__(LBL_MEM_REP_MOVSW : "+D"(dst), "+S"(src), "+c"(words) : : "memory");
+    __asm__ __volatile__("rep movsb" : "+D"(dst), "+S"(src), "+c"(rest) : : "memory");
+}
+
+// Stores `pattern` from dst on (dst must be 4-byte aligned if size is not a
+// whole number of pattern repeats, as for lbl_mem_fill32).
+static void lbl_mem_stos(lbl_u8* dst, lbl_u32 pattern, lbl_usize size) {
+    lbl_usize wide = pattern;
+    lbl_usize words, dwords, rest;
+
+#if defined(__x86_64__)
+    wide |= wide << 32;
+#endif
+    words = size / sizeof(lbl_usize);
+    dwords = (size % sizeof(lbl_usize)) / 4;
+    rest = size % 4;
+    __asm__ __volatile__(LBL_MEM_REP_STOSW : "+D"(dst), "+c"(words) : "a"(wide) : "memory");
+    __asm__ __volatile__("rep stosl" : "+D"(dst), "+c"(dwords) : "a"(pattern) : "memory");
+    __asm__ __volatile__("rep stosb" : "+D"(dst), "+c"(rest) : "a"(pattern) : "memory");
+}
+
+// Non-temporal loops: dst aligned to the vector size, size a non-zero multiple
+// of LBL_MEM_BLOCK. The sfence orders the weakly-ordered stores before anything
+// that follows (another CPU or a device may read the data next).
+__attribute__((target("sse2")))
+static void lbl_mem_stream_copy_sse2(lbl_u8* dst, const lbl_u8* src, lbl_usize size) {
+    __asm__ __volatile__(
+        "1:\n\t"
+        "movdqu   (%1), %%xmm0\n\t"
+        "movdqu 16(%1), %%xmm1\n\t"
+        "movdqu 32(%1), %%xmm2\n\t"
+        "movdqu 48(%1), %%xmm3\n\t"
+        "movntdq %%xmm0,   (%0)\n\t"
+        "movntdq %%xmm1, 16(%0)\n\t"
+        "movntdq %%xmm2, 32(%0)\n\t"
+        "movntdq %%xmm3, 48(%0)\n\t"
+        "add $64, %0\n\t"
+        "add $64, %1\n\t"
+        "sub $64, %2\n\t"
+        "jnz 1b\n\t"
+        "sfence"
+        : "+r"(dst), "+r"(src), "+r"(size) : : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc");
+}
+
+__attribute__((target("avx")))
+static void lbl_mem_stream_copy_avx(lbl_u8* dst, const lbl_u8* src, lbl_usize size) {
+    __asm__ __volatile__(
+        "1:\n\t"
+        "vmovdqu   (%1), %%ymm0\n\t"
+        "vmovdqu 32(%1), %%ymm1\n\t"
+        "vmovntdq %%ymm0,   (%0)\n\t"
+        "vmovntdq %%ymm1, 32(%0)\n\t"
+        "add $64, %0\n\t"
+        "add $64, %1\n\t"
+        "sub $64, %2\n\t"
+        "jnz 1b\n\t"
+        "sfence\n\t"
+        "vzeroupper" // No AVX-SSE transition penalty in the caller
+        : "+r"(dst), "+r"(src), "+r"(size) : : "xmm0", "xmm1", "memory", "cc");
+}
+
+__attribute__((target("sse2")))
+static void lbl_mem_stream_fill_sse2(lbl_u8* dst, lbl_u32 pattern, lbl_usize size) {
+    __asm__ __volatile__(
+        "movd %2, %%xmm0\n\t"
+        "pshufd $0, %%xmm0, %%xmm0\n\t"
+        "1:\n\t"
+        "movntdq %%xmm0,   (%0)\n\t"
+        "movntdq %%xmm0, 16(%0)\n\t"
+        "movntdq %%xmm0, 32(%0)\n\t"
+        "movntdq %%xmm0, 48(%0)\n\t"
+        "add $64, %0\n\t"
+        "sub $64, %1\n\t"
+        "jnz 1b\n\t"
+        "sfence"
+        : "+r"(dst), "+r"(size) : "r"(pattern) : "xmm0", "memory", "cc");
+}
+
+__attribute__((target("avx")))
+static void lbl_mem_stream_fill_avx(lbl_u8* dst, lbl_u32 pattern, lbl_usize size) {
+    __asm__ __volatile__(
+        "vmovd %2, %%xmm0\n\t"
+        "vpshufd $0, %%xmm0, %%xmm0\n\t"
+        "vinsertf128 $1, %%xmm0, %%ymm0, %%ymm0\n\t"
+        "1:\n\t"
+        "vmovntdq %%ymm0,   (%0)\n\t"
+        "vmovntdq %%ymm0, 32(%0)\n\t"
+        "add $64, %0\n\t"
+        "sub $64, %1\n\t"
+        "jnz 1b\n\t"
+        "sfence\n\t"
+        "vzeroupper"
+        : "+r"(dst), "+r"(size) : "r"(pattern) : "xmm0", "memory", "cc");
+}
+
+// Bytes from dst to the next boundary the stream loops need (at most `size`).
+static lbl_usize lbl_mem_stream_head(const lbl_u8* dst, lbl_usize size, lbl_u32 caps) {
+    lbl_usize align = (caps & LBL_MEM_FEATURE_AVX) ? 32 : 16;
+    lbl_usize head = (0 - (lbl_usize)dst) & (align - 1);
+    return head < size ? head : size;
+}
+
+static void lbl_mem_copy_forward(lbl_u8* dst, const lbl_u8* src, lbl_usize size, lbl_u32 caps) {
+    if (size >= LBL_MEM_STREAM_THRESHOLD && (caps & LBL_MEM_FEATURE_SSE2)) {
+        lbl_usize head = lbl_mem_stream_head(dst, size, caps);
+        lbl_usize body;
+
+        lbl_mem_movsb(dst, src, head);
+        dst += head;
+        src += head;
+        size -= head;
+        body = size & ~(lbl_usize)(LBL_MEM_BLOCK - 1);
+        if (caps & LBL_MEM_FEATURE_AVX) {
+            lbl_mem_stream_copy_avx(dst, src, body);
+        } else {
+            lbl_mem_stream_copy_sse2(dst, src, body);
+        }
+        lbl_mem_movsb(dst + body, src + body, size - body);
+    } else if (caps & (LBL_MEM_FEATURE_ERMS | LBL_MEM_FEATURE_FSRM)) {
+        lbl_mem_movsb(dst, src, size); // Microcoded: picks its own block size and alignment
+    } else {
+        lbl_mem_movs_words(dst, src, size);
+    }
+}
+
+static void lbl_mem_copy_backward(lbl_u8* dst, const lbl_u8* src, lbl_usize size) {
+    dst += size - 1;
+    src += size - 1;
+    __asm__ __volatile__("std\n\trep movsb\n\tcld" : "+D"(dst), "+S"(src), "+c"(size) : : "memory", "cc");
+}
+
+static void lbl_mem_fill(lbl_u8* dst, lbl_u32 pattern, lbl_usize size, lbl_u32 caps, int stream) {
+    if (stream && (caps & LBL_MEM_FEATURE_SSE2)) {
+        lbl_usize head = lbl_mem_stream_head(dst, size, caps);
+        lbl_usize body;
+
+        lbl_mem_stos(dst, pattern, head); // Whole pixels: a 4-byte aligned dst stays in phase
+        dst += head;
+        size -= head;
+        body = size & ~(lbl_usize)(LBL_MEM_BLOCK - 1);
+        if (body == 0) {
+            // Too small for a vector loop
+        } else if (caps & LBL_MEM_FEATURE_AVX) {
+            lbl_mem_stream_fill_avx(dst, pattern, body);
+        } else {
+            lbl_mem_stream_fill_sse2(dst, pattern, body);
+        }
+        dst += body;
+        size -= body;
+    }
+    lbl_mem_stos(dst, pattern, size);
+}
+
+__attribute__((target("sse2")))
+static lbl_usize lbl_mem_equal_prefix_sse2(const lbl_u8* a, const lbl_u8* b, lbl_usize size) {
+    lbl_usize i;
+
+    for (i = 0; size - i >= 16; i += 16) {
+        lbl_v16qi va, vb;
+        __builtin_memcpy(&va, a + i, 16);
+        __builtin_memcpy(&vb, b + i, 16);
+        if (__builtin_ia32_pmovmskb128((lbl_v16qi)(va == vb)) != 0xFFFF) {
+            break;
+        }
+    }
+    return i;
+}
+
+static lbl_usize lbl_mem_equal_prefix(const lbl_u8* a, const lbl_u8* b, lbl_usize size, lbl_u32 caps) {
+    return (caps & LBL_MEM_FEATURE_SSE2) ? lbl_mem_equal_prefix_sse2(a, b, size) : 0;
+}
+
+// --- AArch64: Advanced SIMD, mandatory in ARMv8-A and enabled by UEFI ---
+#elif defined(__aarch64__)
+
+typedef lbl_u64 lbl_v2du __attribute__((vector_size(16)));
+typedef lbl_u8 lbl_v16qu __attribute__((vector_size(16)));
+
+static lbl_u32 lbl_mem_detect(void) {
+    return LBL_MEM_FEATURE_NEON;
+}
+
+// size a non-zero multiple of LBL_MEM_BLOCK. STNP is the non-temporal pair store.
+static void lbl_mem_neon_copy(lbl_u8* dst, const lbl_u8* src, lbl_usize size) {
+    __asm__ __volatile__(
+        "1:\n\t"
+        "ldp q0, q1, [%1]\n\t"
+        "ldp q2, q3, [%1, #32]\n\t"
+        "stp q0, q1, [%0]\n\t"
+        "stp q2, q3, [%0, #32]\n\t"
+        "add %0, %0, #64\n\t"
+        "add %1, %1, #64\n\t"
+        "subs %2, %2, #64\n\t"
+        "b.ne 1b"
+        : "+r"(dst), "+r"(src), "+r"(size) : : "v0", "v1", "v2", "v3", "memory", "cc");
+}
+
+static void lbl_mem_neon_stream_copy(lbl_u8* dst, const lbl_u8* src, lbl_usize size) {
+    __asm__ __volatile__(
+        "1:\n\t"
+        "ldp q0, q1, [%1]\n\t"
+        "ldp q2, q3, [%1, #32]\n\t"
+        "stnp q0, q1, [%0]\n\t"
+        "stnp q2, q3, [%0, #32]\n\t"
+        "add %0, %0, #64\n\t"
+        "add %1, %1, #64\n\t"
+        "subs %2, %2, #64\n\t"
+        "b.ne 1b\n\t"
+        "dmb ishst"
+        : "+r"(dst), "+r"(src), "+r"(size) : : "v0", "v1", "v2", "v3", "memory", "cc");
+}
+
+static void lbl_mem_neon_fill(lbl_u8* dst, lbl_u32 pattern, lbl_usize size, int stream) {
+    if (stream) {
+        __asm__ __volatile__(
+            "dup v0.4s, %w2\n\t"
+            "1:\n\t"
+            "stnp q0, q0, [%0]\n\t"
+            "stnp q0, q0, [%0, #32]\n\t"
+            "add %0, %0, #64\n\t"
+            "subs %1, %1, #64\n\t"
+            "b.ne 1b\n\t"
+            "dmb ishst"
+            : "+r"(dst), "+r"(size) : "r"(pattern) : "v0", "memory", "cc");
+    } else {
+        __asm__ __volatile__(
+            "dup v0.4s, %w2\n\t"
+            "1:\n\t"
+            "stp q0, q0, [%0]\n\t"
+            "stp q0, q0, [%0, #32]\n\t"
+            "add %0, %0, #64\n\t"
+            "subs %1, %1, #64\n\t"
+            "b.ne 1b"
+            : "+r"(dst), "+r"(size) : "r"(pattern) : "v0", "memory", "cc");
+    }
+}
+
+static void lbl_mem_copy_forward(lbl_u8* dst, const lbl_u8* src, lbl_usize size, lbl_u32 caps) {
+    lbl_usize body = size & ~(lbl_usize)(LBL_MEM_BLOCK - 1);
+    volatile lbl_u8* d;
+    lbl_usize i;
+
+    (void)caps;
+    if (body != 0 && size >= LBL_MEM_STREAM_THRESHOLD) {
+        lbl_mem_neon_stream_copy(dst, src, body);
+    } else if (body != 0) {
+        lbl_mem_neon_copy(dst, src, body);
+    }
+    d = dst;
+    for (i = body; i < size; i++) {
+        d[i] = src[i];
+    }
+}
+
+static void lbl_mem_copy_backward(lbl_u8* dst, const lbl_u8* src, lbl_usize size) {
+    volatile lbl_u8* d = dst;
+
+    while (size--) {
+        d[size] = src[size];
+    }
+}
+
+static void lbl_mem_fill(lbl_u8* dst, lbl_u32 pattern, lbl_usize size, lbl_u32 caps, int stream) {
+    lbl_usize body = size & ~(lbl_usize)(LBL_MEM_BLOCK - 1);
+    volatile lbl_u8* d = dst;
+    lbl_usize i;
+
+    (void)caps;
+    if (body != 0) {
+        lbl_mem_neon_fill(dst, pattern, body, stream);
+    }
+    for (i = body; i < size; i++) {
+        d[i] = (lbl_u8)(pattern >> ((i & 3) * 8)); // body is a multiple of 4: still in phase
+    }
+}
+
+static lbl_usize lbl_mem_equal_prefix(const lbl_u8* a, const lbl_u8* b, lbl_usize size, lbl_u32 caps) {
+    lbl_usize i;
+
+    (void)caps;
+    for (i = 0; size - i >= 16; i += 16) {
+        lbl_v16qu va, vb;
+        lbl_v2du eq;
+        __builtin_memcpy(&va, a + i, 16);
+        __builtin_memcpy(&vb, b + i, 16);
+        eq = (lbl_v2du)(va == vb);
+        if ((eq[0] & eq[1]) != ~0ULL) {
+            break;
+        }
+    }
+    return i;
+}
+
+// --- Anything else: byte loops ---
+#else
+
+static lbl_u32 lbl_mem_detect(void) {
+    return 0;
+}
+
+static void lbl_mem_copy_forward(lbl_u8* dst, const lbl_u8* src, lbl_usize size, lbl_u32 caps) {
+    volatile lbl_u8* d = dst;
+    lbl_usize i;
+
+    (void)caps;
+    for (i = 0; i < size; i++) {
+        d[i] = src[i];
+    }
+}
+
+static void lbl_mem_copy_backward(lbl_u8* dst, const lbl_u8* src, lbl_usize size) {
+    volatile lbl_u8* d = dst;
+
+    while (size--) {
+        d[size] = src[size];
+    }
+}
+
+static void lbl_mem_fill(lbl_u8* dst, lbl_u32 pattern, lbl_usize size, lbl_u32 caps, int stream) {
+    volatile lbl_u8* d = dst;
+    lbl_usize i;
+
+    (void)caps;
+    (void)stream;
+    for (i = 0; i < size; i++) {
+        d[i] = (lbl_u8)(pattern >> ((i & 3) * 8));
+    }
+}
+
+static lbl_usize lbl_mem_equal_prefix(const lbl_u8* a, const lbl_u8* b, lbl_usize size, lbl_u32 caps) {
+    (void)a;
+    (void)b;
+    (void)size;
+    (void)caps;
+    return 0;
+}
+
+#endif
+
+static lbl_u32 lbl_mem_current(void) {
+    lbl_u32 caps = lbl_mem_caps;
+
+    if (caps == 0) {
+        // Racing APs would all store the same value.
+        caps = lbl_mem_detect() | LBL_MEM_DETECTED;
+        lbl_mem_caps = caps;
+    }
+    return caps;
+}
+
+lbl_u32 LBL_MEM_ABI lbl_mem_features(void) {
+    return lbl_mem_current() & ~LBL_MEM_DETECTED;
+}
+
+void* LBL_MEM_ABI lbl_mem_copy(void* dst, const void* src, lbl_usize size) {
+    lbl_mem_copy_forward((lbl_u8*)dst, (const lbl_u8*)src, size, lbl_mem_current());
+    return dst;
+}
+
+void* LBL_MEM_ABI lbl_mem_move(void* dst, const void* src, lbl_usize size) {
+    // Unsigned: dst below src wraps to a large distance, which copies forward too.
+    if ((lbl_usize)((const lbl_u8*)dst - (const lbl_u8*)src) >= size) {
+        lbl_mem_copy_forward((lbl_u8*)dst, (const lbl_u8*)src, size, lbl_mem_current());
+    } else if (dst != src) {
+        lbl_mem_copy_backward((lbl_u8*)dst, (const lbl_u8*)src, size);
+    }
+    return dst;
+}
+
+void* LBL_MEM_ABI lbl_mem_set(void* dst, int value, lbl_usize size) {
+    lbl_u32 pattern = (lbl_u32)(lbl_u8)value * 0x01010101u;
+
+    lbl_mem_fill((lbl_u8*)dst, pattern, size, lbl_mem_current(), size >= LBL_MEM_STREAM_THRESHOLD);
+    return dst;
+}
+
+void LBL_MEM_ABI lbl_mem_fill32(void* dst, lbl_u32 pattern, lbl_usize count) {
+    lbl_mem_fill((lbl_u8*)dst, pattern, count * 4, lbl_mem_current(), 1);
+}
+
+int LBL_MEM_ABI lbl_mem_compare(const void* a, const void* b, lbl_usize size) {
+    const lbl_u8* pa = (const lbl_u8*)a;
+    const lbl_u8* pb = (const lbl_u8*)b;
+    lbl_usize i;
+
+    for (i = lbl_mem_equal_prefix(pa, pb, size, lbl_mem_current()); i < size; i++) {
+        if (pa[i] != pb[i]) {
+            return (int)pa[i] - (int)pb[i];
+        }
+    }
+    return 0;
+}
+
+void lbl_mem_describe(LBL_MEM_OPS* ops) {
+    ops->version = LBL_MEM_OPS_VERSION;
+    ops->features = lbl_mem_features();
+    ops->stream_threshold = LBL_MEM_STREAM_THRESHOLD;
+    ops->reserved = 0;
+    ops->copy = (lbl_u64)(lbl_usize)(LBL_MEM_COPY_FN)lbl_mem_copy;
+    ops->move = (lbl_u64)(lbl_usize)(LBL_MEM_COPY_FN)lbl_mem_move;
+    ops->set = (lbl_u64)(lbl_usize)(LBL_MEM_SET_FN)lbl_mem_set;
+    ops->fill32 = (lbl_u64)(lbl_usize)(LBL_MEM_FILL32_FN)lbl_mem_fill32;
+    ops->compare = (lbl_u64)(lbl_usize)(LBL_MEM_COMPARE_FN)lbl_mem_compare;
+}
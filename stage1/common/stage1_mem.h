@@ -0,0 +1,103 @@
+// Lionbootloader - Stage 1 - Freestanding Memory Operations
+// File: stage1/common/stage1_mem.h
+//
+// Copy / fill / compare for code that cannot call BS->CopyMem or BS->SetMem:
+// the BIOS loader, the environment-neutral modules and everything that runs
+// after ExitBootServices. The implementation is picked on first use from CPUID
+// (x86: REP MOVSB/STOSB with ERMS or FSRM, SSE2 / AVX non-temporal stores for
+// blocks too large to keep in the cache) or is fixed at build time (AArch64:
+// NEON). The UEFI loader hands the same entry points to the core (LBL_MEM_OPS),
+// so it does not need a copy of its own before it has probed the CPU.
+
+#ifndef STAGE1_MEM_H
+#define STAGE1_MEM_H
+
+#include "stage1_loader_utils.h" // lbl_u8 / lbl_u32 / lbl_u64 / lbl_usize
+
+// Calling convention of every entry point, so the core can call them through
+// LBL_MEM_OPS whatever the loader was built with (Rust: extern "sysv64" on
+// x86_64, extern "C" elsewhere). Same choice as LBL_MP_JOB_FN.
+#if defined(__x86_64__)
+#define LBL_MEM_ABI __attribute__((sysv_abi))
+#else
+#define LBL_MEM_ABI
+#endif
+
+// LBL_MEM_OPS.features: what the running CPU let lbl_mem_* use.
+#define LBL_MEM_FEATURE_ERMS        0x01    // Enhanced REP MOVSB / STOSB
+#define LBL_MEM_FEATURE_FSRM        0x02    // Fast short REP MOVSB: worth it for any size
+#define LBL_MEM_FEATURE_SSE2        0x04    // 16-byte non-temporal stores (always on x86_64)
+#define LBL_MEM_FEATURE_AVX         0x08    // 32-byte non-temporal stores (OS-enabled YMM state)
+#define LBL_MEM_FEATURE_NEON        0x10    // AArch64 Advanced SIMD (always)
+
+// Copies and fills of at least this many bytes use non-temporal stores: the
+// data is not read back soon (a kernel, an initrd, a cleared buffer) and would
+// otherwise evict everything Stage 1 and the core are working on.
+#define LBL_MEM_STREAM_THRESHOLD    0x100000    // 1 MiB
+
+#define LBL_MEM_OPS_VERSION         1
+
+typedef void* (LBL_MEM_ABI *LBL_MEM_COPY_FN)(void* dst, const void* src, lbl_usize size);
+typedef void* (LBL_MEM_ABI *LBL_MEM_SET_FN)(void* dst, int value, lbl_usize size);
+typedef void (LBL_MEM_ABI *LBL_MEM_FILL32_FN)(void* dst, lbl_u32 pattern, lbl_usize count);
+typedef int (LBL_MEM_ABI *LBL_MEM_COMPARE_FN)(const void* a, const void* b, lbl_usize size);
+
+// Function table for the core, published by the UEFI loader only: the 32-bit
+// BIOS loader's entry points use the i386 cdecl ABI, not the core's. Addresses
+// are 64-bit; the code they point to lives in the Stage 1 image.
+typedef struct {
+    lbl_u32 version;            // LBL_MEM_OPS_VERSION
+    lbl_u32 features;           // LBL_MEM_FEATURE_*
+    lbl_u32 stream_threshold;   // LBL_MEM_STREAM_THRESHOLD
+    lbl_u32 reserved;
+    lbl_u64 copy;               // LBL_MEM_COPY_FN: lbl_mem_copy
+    lbl_u64 move;               // LBL_MEM_COPY_FN: lbl_mem_move
+    lbl_u64 set;                // LBL_MEM_SET_FN: lbl_mem_set
+    lbl_u64 fill32;             // LBL_MEM_FILL32_FN: lbl_mem_fill32
+    lbl_u64 compare;            // LBL_MEM_COMPARE_FN: lbl_mem_compare
+} LBL_MEM_OPS;
+
+/**
+ * @brief LBL_MEM_FEATURE_* for the running CPU (probed once, on first use).
+ */
+lbl_u32 LBL_MEM_ABI lbl_mem_features(void);
+
+/**
+ * @brief memcpy: copies `size` bytes; the ranges must not overlap, except that
+ * `dst` may lie below `src` (a forward copy, as when a block slides down).
+ * @return dst.
+ */
+void* LBL_MEM_ABI lbl_mem_copy(void* dst, const void* src, lbl_usize size);
+
+/**
+ * @brief memmove: copies `size` bytes between ranges that may overlap.
+ * @return dst.
+ */
+void* LBL_MEM_ABI lbl_mem_move(void* dst, const void* src, lbl_usize size);
+
+/**
+ * @brief memset: fills `size` bytes with the low byte of `value`.
+ * @return dst.
+ */
+void* LBL_MEM_ABI lbl_mem_set(void* dst, int value, lbl_usize size);
+
+/**
+ * @brief Fills `count` 32-bit words with `pattern` (a framebuffer clear to one
+ * pixel value). Always uses non-temporal stores where the CPU has them, since
+ * the destination is never read back. `dst` must be 4-byte aligned.
+ */
+void LBL_MEM_ABI lbl_mem_fill32(void* dst, lbl_u32 pattern, lbl_usize count);
+
+/**
+ * @brief memcmp: compares `size` bytes as unsigned chars.
+ * @return <0, 0 or >0 as the first differing byte of `a` is below, equal to or
+ * above that of `b`.
+ */
+int LBL_MEM_ABI lbl_mem_compare(const void* a, const void* b, lbl_usize size);
+
+/**
+ * @brief Fills `ops` with the entry points above, for a boot record.
+ */
+void lbl_mem_describe(LBL_MEM_OPS* ops);
+
+#endif // STAGE1_MEM_H
@@ -0,0 +1,401 @@
+// Lionbootloader - Stage 1 - Application Processor Parking
+// File: stage1/common/stage1_mp.c
+
+#include "stage1_mp.h"
+#include "stage1_mem.h"
+
+void lbl_mp_init_park_block(LBL_MP_PARK_BLOCK* block, const lbl_u32* apic_ids,
+                            const lbl_u8* disabled, lbl_u32 count) {
+    lbl_u32 i;
+
+    block->magic = LBL_MP_PARK_MAGIC;
+    block->count = count;
+    block->use_mwait = 0;
+    block->reserved = 0;
+    block->pat = 0;
+    for (i = 0; i < count; i++) {
+        LBL_AP_MAILBOX* mb = &block->mailboxes[i];
+        lbl_usize b;
+        for (b = 0; b < sizeof(mb->reserved); b++) {
+            mb->reserved[b] = 0;
+        }
+        mb->apic_id = apic_ids[i];
+        mb->job = 0;
+        mb->arg = 0;
+        mb->completed = 0;
+        mb->stack_top = 0;
+        mb->state = (disabled != 0 && disabled[i]) ? LBL_AP_STATE_DISABLED : LBL_AP_STATE_OFFLINE;
+    }
+}
+
+#if defined(__x86_64__)
+
+// --- Trampoline ---
+// Entered in real mode at CS = page >> 4, IP = 0. Switches to protected mode with
+// its own flat GDT, enables PAE + EFER.LME (+ NXE) and paging on the BSP's CR3,
+// takes a stack by ticket and calls lbl_mp_ap_entry(block). On the way it copies
+// the BSP's FPU/SSE controls (CR0 MP/EM/NE and cache bits, CR4 OSFXSR/
+// OSXMMEXCPT/OSXSAVE, XCR0), so jobs may use the same instructions the BSP
+// does; INIT leaves CR0.CD/NW set and CR4/XCR0 at reset values. The data block at
+// lbl_mp_trampoline_data is patched in the copy (LBL_MP_TRAMPOLINE_DATA).
+__asm__(
+    "    .text\n"
+    "    .balign 16\n"
+    "    .globl lbl_mp_trampoline_start\n"
+    "lbl_mp_trampoline_start:\n"
+    "    .code16\n"
+    "    cli\n"
+    "    cld\n"
+    "    mov %cs, %ax\n"
+    "    mov %ax, %ds\n"
+    "    xor %ebx, %ebx\n"
+    "    mov %cs, %bx\n"
+    "    shl $4, %ebx\n"                                    // ebx = linear base of the copy
+    "    lgdtl (lbl_mp_trampoline_gdtr - lbl_mp_trampoline_start)\n"
+    "    mov %cr0, %eax\n"
+    "    or $1, %eax\n"
+    "    mov %eax, %cr0\n"
+    "    ljmpl *(lbl_mp_trampoline_far32 - lbl_mp_trampoline_start)\n"
+    "    .code32\n"
+    "    .globl lbl_mp_trampoline_pm32\n"
+    "lbl_mp_trampoline_pm32:\n"
+    "    mov $0x10, %ax\n"
+    "    mov %ax, %ds\n"
+    "    mov %ax, %es\n"
+    "    mov %ax, %ss\n"
+    "    mov %ax, %fs\n"
+    "    mov %ax, %gs\n"
+    "    mov %cr0, %eax\n"
+    "    and $0x9FFFFFD9, %eax\n"                           // Clear CD, NW, NE, EM, MP
+    "    or (lbl_mp_trampoline_cr0 - lbl_mp_trampoline_start)(%ebx), %eax\n"
+    "    mov %eax, %cr0\n"
+    "    mov %cr4, %eax\n"
+    "    or $0x20, %eax\n"                                  // CR4.PAE
+    "    or (lbl_mp_trampoline_cr4 - lbl_mp_trampoline_start)(%ebx), %eax\n"
+    "    mov %eax, %cr4\n"
+    "    test $0x40000, %eax\n"                             // CR4.OSXSAVE
+    "    jz 2f\n"
+    "    xor %ecx, %ecx\n"
+    "    mov (lbl_mp_trampoline_xcr0 - lbl_mp_trampoline_start)(%ebx), %eax\n"
+    "    mov (lbl_mp_trampoline_xcr0 - lbl_mp_trampoline_start + 4)(%ebx), %edx\n"
+    "    xsetbv\n"
+    "2:\n"
+    "    mov (lbl_mp_trampoline_cr3 - lbl_mp_trampoline_start)(%ebx), %eax\n"
+    "    mov %eax, %cr3\n"
+    "    mov $0xC0000080, %ecx\n"                           // IA32_EFER
+    "    rdmsr\n"
+    "    or (lbl_mp_trampoline_efer - lbl_mp_trampoline_start)(%ebx), %eax\n"
+    "    wrmsr\n"
+    "    mov %cr0, %eax\n"
+    "    or $0x80000000, %eax\n"                            // CR0.PG
+    "    mov %eax, %cr0\n"
+    "    ljmpl *(lbl_mp_trampoline_far64 - lbl_mp_trampoline_start)(%ebx)\n"
+    "    .code64\n"
+    "    .globl lbl_mp_trampoline_lm64\n"
+    "lbl_mp_trampoline_lm64:\n"
+    "    mov %ebx, %ebx\n"                                  // Upper halves are undefined here
+    "    mov $1, %eax\n"
+    "    lock xadd %eax, (lbl_mp_trampoline_ticket - lbl_mp_trampoline_start)(%rbx)\n"
+    "    cmp (lbl_mp_trampoline_count - lbl_mp_trampoline_start)(%rbx), %eax\n"
+    "    jae 1f\n"                                          // More APs than stacks
+    "    inc %eax\n"
+    "    imul (lbl_mp_trampoline_stack_size - lbl_mp_trampoline_start)(%rbx), %rax\n"
+    "    add (lbl_mp_trampoline_stacks - lbl_mp_trampoline_start)(%rbx), %rax\n"
+    "    mov %rax, %rsp\n"
+    "    mov (lbl_mp_trampoline_arg - lbl_mp_trampoline_start)(%rbx), %rdi\n"
+    "    mov %rdi, %rcx\n"
+    "    xor %ebp, %ebp\n"
+    "    call *(lbl_mp_trampoline_entry - lbl_mp_trampoline_start)(%rbx)\n"
+    "1:  cli\n"
+    "    hlt\n"
+    "    jmp 1b\n"
+    "    .balign 8\n"
+    "    .globl lbl_mp_trampoline_data\n"
+    "lbl_mp_trampoline_data:\n"
+    "    .quad 0\n"
+    "    .quad 0x00CF9A000000FFFF\n"                        // 0x08: 32-bit code
+    "    .quad 0x00CF92000000FFFF\n"                        // 0x10: data
+    "    .quad 0x00AF9A000000FFFF\n"                        // 0x18: 64-bit code
+    "lbl_mp_trampoline_gdtr:\n"
+    "    .word 31, 0, 0, 0\n"
+    "lbl_mp_trampoline_far32:\n"
+    "    .long 0\n"
+    "    .word 0x08, 0\n"
+    "lbl_mp_trampoline_far64:\n"
+    "    .long 0\n"
+    "    .word 0x18, 0\n"
+    "lbl_mp_trampoline_cr3:\n"
+    "    .long 0\n"
+    "lbl_mp_trampoline_efer:\n"
+    "    .long 0\n"
+    "lbl_mp_trampoline_cr0:\n"
+    "    .long 0\n"
+    "lbl_mp_trampoline_cr4:\n"
+    "    .long 0\n"
+    "lbl_mp_trampoline_ticket:\n"
+    "    .long 0\n"
+    "lbl_mp_trampoline_count:\n"
+    "    .long 0\n"
+    "lbl_mp_trampoline_xcr0:\n"
+    "    .quad 0\n"
+    "lbl_mp_trampoline_stack_size:\n"
+    "    .quad 0\n"
+    "lbl_mp_trampoline_stacks:\n"
+    "    .quad 0\n"
+    "lbl_mp_trampoline_entry:\n"
+    "    .quad 0\n"
+    "lbl_mp_trampoline_arg:\n"
+    "    .quad 0\n"
+    "    .globl lbl_mp_trampoline_end\n"
+    "lbl_mp_trampoline_end:\n"
+);
+
+extern const lbl_u8 lbl_mp_trampoline_start[];
+extern const lbl_u8 lbl_mp_trampoline_pm32[];
+extern const lbl_u8 lbl_mp_trampoline_lm64[];
+extern const lbl_u8 lbl_mp_trampoline_data[];
+extern const lbl_u8 lbl_mp_trampoline_end[];
+
+// Mirrors the data block above, byte for byte.
+typedef struct {
+    lbl_u64 gdt[4];
+    lbl_u16 gdtr[4];            // limit, base[15:0], base[31:16], pad
+    lbl_u32 far32_offset;
+    lbl_u16 far32_selector;
+    lbl_u16 pad0;
+    lbl_u32 far64_offset;
+    lbl_u16 far64_selector;
+    lbl_u16 pad1;
+    lbl_u32 cr3;
+    lbl_u32 efer_bits;          // ORed into IA32_EFER: LME, plus NXE if the BSP uses it
+    lbl_u32 cr0_bits;           // BSP's CR0 & LBL_MP_CR0_COPY
+    lbl_u32 cr4_bits;           // BSP's CR4 & LBL_MP_CR4_COPY, ORed in with PAE
+    lbl_u32 ticket;
+    lbl_u32 count;              // Stacks available
+    lbl_u64 xcr0;               // Loaded with XSETBV when cr4_bits has OSXSAVE
+    lbl_u64 stack_size;
+    lbl_u64 stacks;
+    lbl_u64 entry;              // lbl_mp_ap_entry
+    lbl_u64 arg;                // LBL_MP_PARK_BLOCK*
+} LBL_MP_TRAMPOLINE_DATA;
+
+#define LBL_MSR_APIC_BASE       0x1B
+#define LBL_MSR_PAT             0x277
+#define LBL_MSR_EFER            0xC0000080
+#define LBL_MSR_X2APIC_ID       0x802
+#define LBL_MSR_X2APIC_ICR      0x830
+#define LBL_APIC_BASE_X2APIC    (1ULL << 10)
+#define LBL_XAPIC_ICR_LOW       0x300
+#define LBL_XAPIC_ICR_HIGH      0x310
+#define LBL_ICR_INIT            0x00004500  // INIT, level assert
+#define LBL_ICR_STARTUP         0x00004600  // Start-up IPI; OR in the vector (page >> 12)
+#define LBL_ICR_PENDING         (1u << 12)
+#define LBL_CR0_MP              (1u << 1)
+#define LBL_CR0_EM              (1u << 2)
+#define LBL_CR0_NE              (1u << 5)
+#define LBL_CR0_NW              (1u << 29)
+#define LBL_CR0_CD              (1u << 30)
+#define LBL_MP_CR0_COPY         (LBL_CR0_MP | LBL_CR0_EM | LBL_CR0_NE | LBL_CR0_NW | LBL_CR0_CD)
+#define LBL_CR4_OSFXSR          (1u << 9)
+#define LBL_CR4_OSXMMEXCPT      (1u << 10)
+#define LBL_CR4_OSXSAVE         (1u << 18)
+#define LBL_MP_CR4_COPY         (LBL_CR4_OSFXSR | LBL_CR4_OSXMMEXCPT | LBL_CR4_OSXSAVE)
+
+static lbl_u64 lbl_mp_rdmsr(lbl_u32 msr) {
+    lbl_u32 lo, hi;
+    __asm__ __volatile__("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((lbl_u64)hi << 32) | lo;
+}
+
+static void lbl_mp_wrmsr(lbl_u32 msr, lbl_u64 value) {
+    __asm__ __volatile__("wrmsr" :: "c"(msr), "a"((lbl_u32)value), "d"((lbl_u32)(value >> 32)) : "memory");
+}
+
+static void lbl_mp_cpuid(lbl_u32 leaf, lbl_u32* eax, lbl_u32* ebx, lbl_u32* ecx, lbl_u32* edx) {
+    __asm__ __volatile__("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(leaf), "c"(0));
+}
+
+static lbl_u32 lbl_mp_own_apic_id(void) {
+    lbl_u32 eax, ebx, ecx, edx;
+
+    if (lbl_mp_rdmsr(LBL_MSR_APIC_BASE) & LBL_APIC_BASE_X2APIC) {
+        return (lbl_u32)lbl_mp_rdmsr(LBL_MSR_X2APIC_ID);
+    }
+    lbl_mp_cpuid(1, &eax, &ebx, &ecx, &edx);
+    return ebx >> 24;
+}
+
+// First C code on an AP: claim the mailbox for this APIC ID and serve jobs forever.
+static void __attribute__((sysv_abi, used)) lbl_mp_ap_entry(LBL_MP_PARK_BLOCK* block) {
+    lbl_u32 id = lbl_mp_own_apic_id();
+    LBL_AP_MAILBOX* mb = 0;
+    lbl_u32 i;
+    lbl_u64 sp;
+
+    for (i = 0; i < block->count; i++) {
+        if (block->mailboxes[i].apic_id == id && block->mailboxes[i].state == LBL_AP_STATE_OFFLINE) {
+            mb = &block->mailboxes[i];
+            break;
+        }
+    }
+    if (mb == 0) {
+        return; // Not ours to run: the trampoline halts it
+    }
+    lbl_mp_wrmsr(LBL_MSR_PAT, block->pat);
+    __asm__ __volatile__("mov %%rsp, %0" : "=r"(sp));
+    mb->stack_top = sp;
+    __atomic_store_n(&mb->state, LBL_AP_STATE_PARKED, __ATOMIC_RELEASE);
+
+    for (;;) {
+        while (__atomic_load_n(&mb->state, __ATOMIC_ACQUIRE) != LBL_AP_STATE_RUN) {
+            if (block->use_mwait) {
+                __asm__ __volatile__("monitor" :: "a"(&mb->state), "c"(0), "d"(0));
+                if (__atomic_load_n(&mb->state, __ATOMIC_ACQUIRE) == LBL_AP_STATE_RUN) {
+                    break;
+                }
+                __asm__ __volatile__("mwait" :: "a"(0), "c"(0));
+            } else {
+                __builtin_ia32_pause();
+            }
+        }
+        __atomic_store_n(&mb->state, LBL_AP_STATE_BUSY, __ATOMIC_RELAXED);
+        ((LBL_MP_JOB_FN)(lbl_usize)mb->job)(mb->arg);
+        mb->completed++;
+        __atomic_store_n(&mb->state, LBL_AP_STATE_PARKED, __ATOMIC_RELEASE);
+    }
+}
+
+lbl_usize lbl_mp_trampoline_size(void) {
+    return (lbl_usize)(lbl_mp_trampoline_end - lbl_mp_trampoline_start);
+}
+
+int lbl_mp_prepare_trampoline(lbl_u8* page, LBL_MP_PARK_BLOCK* block, lbl_u8* stacks) {
+    lbl_u32 base = (lbl_u32)(lbl_usize)page;
+    lbl_usize size = lbl_mp_trampoline_size();
+    LBL_MP_TRAMPOLINE_DATA* data;
+    lbl_u32 eax, ebx, ecx, edx;
+    lbl_u64 cr0, cr3, cr4;
+
+    __asm__ __volatile__("mov %%cr0, %0" : "=r"(cr0));
+    __asm__ __volatile__("mov %%cr3, %0" : "=r"(cr3));
+    __asm__ __volatile__("mov %%cr4, %0" : "=r"(cr4));
+    if ((lbl_usize)page >= 0x100000 || ((lbl_usize)page & 0xFFF) != 0 || size > 0x1000 ||
+        cr3 >= 0x100000000ULL || (cr4 & (1ULL << 12)) != 0) { // LA57 needs a 5-level trampoline
+        return -1;
+    }
+    lbl_mem_copy(page, lbl_mp_trampoline_start, size);
+    data = (LBL_MP_TRAMPOLINE_DATA*)(page + (lbl_mp_trampoline_data - lbl_mp_trampoline_start));
+    data->gdtr[1] = (lbl_u16)(base + (lbl_u32)(lbl_mp_trampoline_data - lbl_mp_trampoline_start));
+    data->gdtr[2] = (lbl_u16)((base + (lbl_u32)(lbl_mp_trampoline_data - lbl_mp_trampoline_start)) >> 16);
+    data->far32_offset = base + (lbl_u32)(lbl_mp_trampoline_pm32 - lbl_mp_trampoline_start);
+    data->far64_offset = base + (lbl_u32)(lbl_mp_trampoline_lm64 - lbl_mp_trampoline_start);
+    data->cr3 = (lbl_u32)cr3;
+    data->efer_bits = (1u << 8) | ((lbl_u32)lbl_mp_rdmsr(LBL_MSR_EFER) & (1u << 11)); // LME | NXE
+    data->cr0_bits = (lbl_u32)cr0 & LBL_MP_CR0_COPY;
+    data->cr4_bits = (lbl_u32)cr4 & LBL_MP_CR4_COPY;
+    data->ticket = 0;
+    data->count = block->count;
+    data->xcr0 = 0;
+    if (cr4 & LBL_CR4_OSXSAVE) {
+        lbl_u32 lo, hi;
+        __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        data->xcr0 = ((lbl_u64)hi << 32) | lo;
+    }
+    data->stack_size = LBL_AP_STACK_SIZE;
+    data->stacks = (lbl_u64)(lbl_usize)stacks;
+    data->entry = (lbl_u64)(lbl_usize)&lbl_mp_ap_entry;
+    data->arg = (lbl_u64)(lbl_usize)block;
+
+    block->pat = lbl_mp_rdmsr(LBL_MSR_PAT);
+    lbl_mp_cpuid(1, &eax, &ebx, &ecx, &edx);
+    block->use_mwait = (ecx >> 3) & 1; // CPUID.01h:ECX.MONITOR
+    return 0;
+}
+
+static void lbl_mp_delay_us(lbl_u64 ticks_per_second, lbl_u32 us) {
+    lbl_u64 start = lbl_read_cycle_counter();
+    lbl_u64 ticks = ticks_per_second / 1000000 * us;
+
+    while (lbl_read_cycle_counter() - start < ticks) {
+        __builtin_ia32_pause();
+    }
+}
+
+static void lbl_mp_send_ipi(lbl_u64 apic_base, lbl_u32 apic_id, lbl_u32 icr) {
+    if (apic_base & LBL_APIC_BASE_X2APIC) {
+        lbl_mp_wrmsr(LBL_MSR_X2APIC_ICR, ((lbl_u64)apic_id << 32) | icr);
+    } else {
+        volatile lbl_u32* mmio = (volatile lbl_u32*)(lbl_usize)(apic_base & ~0xFFFULL);
+        mmio[LBL_XAPIC_ICR_HIGH / 4] = apic_id << 24;
+        mmio[LBL_XAPIC_ICR_LOW / 4] = icr;
+        while (mmio[LBL_XAPIC_ICR_LOW / 4] & LBL_ICR_PENDING) {
+            __builtin_ia32_pause();
+        }
+    }
+}
+
+lbl_u32 lbl_mp_wake_aps(const lbl_u8* page, LBL_MP_PARK_BLOCK* block,
+                        lbl_u64 ticks_per_second, lbl_u32 timeout_us) {
+    lbl_u64 apic_base = lbl_mp_rdmsr(LBL_MSR_APIC_BASE);
+    lbl_u32 vector = (lbl_u32)((lbl_usize)page >> 12);
+    lbl_u32 i, parked = 0, waited;
+    int pass;
+
+    if (ticks_per_second == 0) {
+        ticks_per_second = 4000000000ULL; // Uncalibrated: err on the long side
+    }
+    // INIT all APs, then two rounds of SIPIs, waiting once per step instead of per AP.
+    for (i = 0; i < block->count; i++) {
+        if (block->mailboxes[i].state == LBL_AP_STATE_OFFLINE) {
+            lbl_mp_send_ipi(apic_base, block->mailboxes[i].apic_id, LBL_ICR_INIT);
+        }
+    }
+    lbl_mp_delay_us(ticks_per_second, 10000);
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < block->count; i++) {
+            if (block->mailboxes[i].state == LBL_AP_STATE_OFFLINE) {
+                lbl_mp_send_ipi(apic_base, block->mailboxes[i].apic_id, LBL_ICR_STARTUP | vector);
+            }
+        }
+        lbl_mp_delay_us(ticks_per_second, 200);
+    }
+
+    for (waited = 0; ; waited += 100) {
+        lbl_u32 pending = 0;
+        parked = 0;
+        for (i = 0; i < block->count; i++) {
+            lbl_u32 state = __atomic_load_n(&block->mailboxes[i].state, __ATOMIC_ACQUIRE);
+            parked += (state == LBL_AP_STATE_PARKED);
+            pending += (state == LBL_AP_STATE_OFFLINE);
+        }
+        if (pending == 0 || waited >= timeout_us) {
+            break;
+        }
+        lbl_mp_delay_us(ticks_per_second, 100);
+    }
+    return parked;
+}
+
+#else
+
+lbl_usize lbl_mp_trampoline_size(void) {
+    return 0;
+}
+
+int lbl_mp_prepare_trampoline(lbl_u8* page, LBL_MP_PARK_BLOCK* block, lbl_u8* stacks) {
+    (void)page;
+    (void)block;
+    (void)stacks;
+    return -1;
+}
+
+lbl_u32 lbl_mp_wake_aps(const lbl_u8* page, LBL_MP_PARK_BLOCK* block,
+                        lbl_u64 ticks_per_second, lbl_u32 timeout_us) {
+    (void)page;
+    (void)block;
+    (void)ticks_per_second;
+    (void)timeout_us;
+    return 0;
+}
+
+#endif // __x86_64__
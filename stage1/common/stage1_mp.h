@@ -0,0 +1,79 @@
+// Lionbootloader - Stage 1 - Application Processor Parking
+// File: stage1/common/stage1_mp.h
+//
+// After ExitBootServices the firmware's MP services are gone, so Stage 1 wakes the
+// APs itself (INIT-SIPI-SIPI into a real-mode trampoline below 1 MiB), switches
+// them to long mode on the BSP's page tables and parks each one on its own
+// cache-line mailbox. The core hands work to an AP by filling `job` / `arg` and
+// setting `state` to LBL_AP_STATE_RUN. x86_64 only; elsewhere nothing is woken.
+
+#ifndef STAGE1_MP_H
+#define STAGE1_MP_H
+
+#include "stage1_loader_utils.h" // lbl_u8 / lbl_u32 / lbl_u64 / lbl_usize
+
+#define LBL_MP_PARK_MAGIC       0x4B52504Cu // "LPRK"
+#define LBL_AP_STACK_SIZE       0x10000     // Per-AP stack, 64 KiB
+
+// LBL_AP_MAILBOX.state
+#define LBL_AP_STATE_OFFLINE    0   // Not started (or did not answer the SIPI)
+#define LBL_AP_STATE_PARKED     1   // Waiting for a job
+#define LBL_AP_STATE_RUN        2   // Set by the core: job/arg are valid
+#define LBL_AP_STATE_BUSY       3   // Running the job; back to PARKED when it returns
+#define LBL_AP_STATE_DISABLED   4   // Firmware reported the CPU disabled or unhealthy
+
+// Job signature, called on the AP's 64 KiB stack with interrupts disabled.
+// System V ABI on every target (Rust: extern "sysv64" fn(u64)).
+typedef void (__attribute__((sysv_abi)) *LBL_MP_JOB_FN)(lbl_u64 arg);
+
+typedef struct {
+    _Alignas(64) volatile lbl_u32 state; // LBL_AP_STATE_*
+    lbl_u32 apic_id;
+    volatile lbl_u64 job;       // LBL_MP_JOB_FN
+    volatile lbl_u64 arg;
+    volatile lbl_u64 completed; // Jobs this AP has finished
+    lbl_u64 stack_top;          // Set by the AP when it comes up (diagnostics)
+    lbl_u8 reserved[24];        // One mailbox per cache line: no false sharing
+} LBL_AP_MAILBOX;
+
+typedef struct {
+    _Alignas(64) lbl_u32 magic; // LBL_MP_PARK_MAGIC
+    lbl_u32 count;              // Mailboxes following this header
+    lbl_u32 use_mwait;          // APs wait with MONITOR/MWAIT instead of PAUSE
+    lbl_u32 reserved;
+    lbl_u64 pat;                // IA32_PAT the APs load (matches the BSP)
+    LBL_AP_MAILBOX mailboxes[];
+} LBL_MP_PARK_BLOCK;
+
+/**
+ * @brief Size of the real-mode trampoline copied by lbl_mp_prepare_trampoline().
+ * @return Bytes (<= 4 KiB), or 0 when the target has no AP support.
+ */
+lbl_usize lbl_mp_trampoline_size(void);
+
+/**
+ * @brief Initializes `block` (count mailboxes, all LBL_AP_STATE_OFFLINE) for the
+ * APIC IDs in `apic_ids`. `disabled` may be 0; non-zero entries mark CPUs that
+ * must not be started.
+ */
+void lbl_mp_init_park_block(LBL_MP_PARK_BLOCK* block, const lbl_u32* apic_ids,
+                            const lbl_u8* disabled, lbl_u32 count);
+
+/**
+ * @brief Copies the trampoline to `page` (4 KiB aligned, below 1 MiB, executable)
+ * and points it at `block`, `stacks` (count * LBL_AP_STACK_SIZE bytes) and the
+ * current CR3, which must be below 4 GiB and map all of them 1:1.
+ * @return 0 on success, -1 if the current paging mode or CR3 cannot be used.
+ */
+int lbl_mp_prepare_trampoline(lbl_u8* page, LBL_MP_PARK_BLOCK* block, lbl_u8* stacks);
+
+/**
+ * @brief Sends INIT-SIPI-SIPI to every enabled mailbox's APIC ID and waits up to
+ * `timeout_us` for the APs to park. Call after ExitBootServices, with interrupts
+ * off. Timing uses lbl_read_cycle_counter() at `ticks_per_second`.
+ * @return Number of APs that reached LBL_AP_STATE_PARKED.
+ */
+lbl_u32 lbl_mp_wake_aps(const lbl_u8* page, LBL_MP_PARK_BLOCK* block,
+                        lbl_u64 ticks_per_second, lbl_u32 timeout_us);
+
+#endif // STAGE1_MP_H
@@ -0,0 +1,184 @@
+// Lionbootloader - Stage 1 - x86_64 Page Table Builder
+// File: stage1/common/stage1_paging.c
+
+#include "stage1_paging.h"
+#include "stage1_mem.h"
+
+#define LBL_PTE_PRESENT     0x001ULL
+#define LBL_PTE_WRITABLE    0x002ULL
+#define LBL_PTE_LARGE       0x080ULL    // PS in a PDPTE / PDE
+#define LBL_PTE_PAT_4K      0x080ULL    // PAT bit in a 4 KiB PTE
+#define LBL_PTE_PAT_LARGE   0x1000ULL   // PAT bit in a 1 GiB / 2 MiB leaf
+#define LBL_PTE_ADDR_MASK   0x000FFFFFFFFFF000ULL
+
+#define LBL_PAGING_ENTRIES  512
+
+#if defined(__x86_64__)
+
+static void lbl_paging_cpuid(lbl_u32 leaf, lbl_u32* eax, lbl_u32* ebx, lbl_u32* ecx, lbl_u32* edx) {
+    __asm__ __volatile__("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(leaf), "c"(0));
+}
+
+int lbl_paging_cpu_supported(void) {
+    lbl_u64 cr0, cr4;
+
+    __asm__ __volatile__("mov %%cr0, %0" : "=r"(cr0));
+    __asm__ __volatile__("mov %%cr4, %0" : "=r"(cr4));
+    return (cr0 & (1ULL << 31)) != 0 && (cr4 & (1ULL << 12)) == 0; // CR0.PG set, CR4.LA57 clear
+}
+
+int lbl_paging_cpu_has_1g_pages(void) {
+    lbl_u32 eax, ebx, ecx, edx;
+
+    lbl_paging_cpuid(0x80000000u, &eax, &ebx, &ecx, &edx);
+    if (eax < 0x80000001u) {
+        return 0;
+    }
+    lbl_paging_cpuid(0x80000001u, &eax, &ebx, &ecx, &edx);
+    return (edx >> 26) & 1;
+}
+
+void lbl_paging_activate(lbl_u64 root) {
+    lbl_u64 cr4;
+
+    __asm__ __volatile__("cli" ::: "memory");
+    // Caches must not hold lines under the old memory types when PAT changes.
+    __asm__ __volatile__("wbinvd" ::: "memory");
+    __asm__ __volatile__("wrmsr" :: "c"(0x277u), "a"((lbl_u32)LBL_PAGING_PAT_VALUE),
+                         "d"((lbl_u32)(LBL_PAGING_PAT_VALUE >> 32)) : "memory");
+    __asm__ __volatile__("mov %%cr4, %0" : "=r"(cr4));
+    if (cr4 & (1ULL << 7)) {
+        // Toggling CR4.PGE flushes global entries, which a CR3 load keeps.
+        __asm__ __volatile__("mov %0, %%cr4" :: "r"(cr4 & ~(1ULL << 7)) : "memory");
+    }
+    __asm__ __volatile__("mov %0, %%cr3" :: "r"(root) : "memory");
+    if (cr4 & (1ULL << 7)) {
+        __asm__ __volatile__("mov %0, %%cr4" :: "r"(cr4) : "memory");
+    }
+}
+
+#else
+
+int lbl_paging_cpu_supported(void) {
+    return 0;
+}
+
+int lbl_paging_cpu_has_1g_pages(void) {
+    return 0;
+}
+
+void lbl_paging_activate(lbl_u64 root) {
+    (void)root;
+}
+
+#endif // __x86_64__
+
+lbl_usize lbl_paging_tables_needed(const LBL_PAGING_PLAN* plan) {
+    lbl_u64 gigs = (plan->top + LBL_PAGING_1G - 1) / LBL_PAGING_1G;
+    lbl_usize pages = 1;                                    // PML4
+    pages += (lbl_usize)((gigs + LBL_PAGING_ENTRIES - 1) / LBL_PAGING_ENTRIES); // PDPTs
+    pages += plan->use_1g ? 0 : (lbl_usize)gigs;            // PDs
+    if (plan->wc_size != 0) {
+        pages += 2 + 2; // PDs for the two 1 GiB pages at the WC edges, PTs for the 2 MiB ones
+    }
+    return pages;
+}
+
+static lbl_u64* lbl_paging_alloc_table(LBL_PAGING_PLAN* plan) {
+    lbl_u64* table;
+
+    if (plan->used_pages == plan->pool_pages) {
+        return 0;
+    }
+    table = (lbl_u64*)(plan->pool + plan->used_pages * LBL_PAGING_4K);
+    plan->used_pages++;
+    lbl_mem_set(table, 0, LBL_PAGING_4K);
+    return table;
+}
+
+// Returns the table an entry points to, creating it if the entry is empty.
+static lbl_u64* lbl_paging_next(LBL_PAGING_PLAN* plan, lbl_u64* table, lbl_usize index) {
+    if (!(table[index] & LBL_PTE_PRESENT)) {
+        lbl_u64* next = lbl_paging_alloc_table(plan);
+        if (next == 0) {
+            return 0;
+        }
+        table[index] = (lbl_u64)(lbl_usize)next | LBL_PTE_PRESENT | LBL_PTE_WRITABLE;
+    }
+    return (lbl_u64*)(lbl_usize)(table[index] & LBL_PTE_ADDR_MASK);
+}
+
+// 1 if [addr, addr + size) lies wholly inside the WC range, 0 if wholly outside, -1 if split.
+static int lbl_paging_wc_class(const LBL_PAGING_PLAN* plan, lbl_u64 addr, lbl_u64 size) {
+    lbl_u64 wc_end = plan->wc_base + plan->wc_size;
+
+    if (plan->wc_size == 0 || addr + size <= plan->wc_base || addr >= wc_end) {
+        return 0;
+    }
+    if (addr >= plan->wc_base && addr + size <= wc_end) {
+        return 1;
+    }
+    return -1;
+}
+
+int lbl_paging_build(LBL_PAGING_PLAN* plan) {
+    lbl_u64* pml4;
+    lbl_u64 addr;
+    lbl_usize i, slots;
+
+    plan->top = (plan->top + LBL_PAGING_1G - 1) & ~(LBL_PAGING_1G - 1);
+    if (plan->top == 0 || plan->top > LBL_PAGING_MAX_TOP ||
+        ((lbl_usize)plan->pool & (LBL_PAGING_4K - 1)) != 0 ||
+        ((plan->wc_base | plan->wc_size) & (LBL_PAGING_4K - 1)) != 0) {
+        return -1;
+    }
+    plan->used_pages = 0;
+    pml4 = lbl_paging_alloc_table(plan);
+    if (pml4 == 0) {
+        return -1;
+    }
+
+    for (addr = 0; addr < plan->top; ) {
+        lbl_u64* pdpt = lbl_paging_next(plan, pml4, (lbl_usize)(addr >> 39) & 511);
+        lbl_u64* pd;
+        lbl_u64* pt;
+        int wc;
+
+        if (pdpt == 0) {
+            return -1;
+        }
+        wc = lbl_paging_wc_class(plan, addr, LBL_PAGING_1G);
+        if (plan->use_1g && wc >= 0 && (addr & (LBL_PAGING_1G - 1)) == 0) {
+            pdpt[(addr >> 30) & 511] = addr | LBL_PTE_PRESENT | LBL_PTE_WRITABLE | LBL_PTE_LARGE |
+                                       (wc ? LBL_PTE_PAT_LARGE : 0);
+            addr += LBL_PAGING_1G;
+            continue;
+        }
+        pd = lbl_paging_next(plan, pdpt, (lbl_usize)(addr >> 30) & 511);
+        if (pd == 0) {
+            return -1;
+        }
+        wc = lbl_paging_wc_class(plan, addr, LBL_PAGING_2M);
+        if (wc >= 0 && (addr & (LBL_PAGING_2M - 1)) == 0) {
+            pd[(addr >> 21) & 511] = addr | LBL_PTE_PRESENT | LBL_PTE_WRITABLE | LBL_PTE_LARGE |
+                                     (wc ? LBL_PTE_PAT_LARGE : 0);
+            addr += LBL_PAGING_2M;
+            continue;
+        }
+        pt = lbl_paging_next(plan, pd, (lbl_usize)(addr >> 21) & 511);
+        if (pt == 0) {
+            return -1;
+        }
+        wc = lbl_paging_wc_class(plan, addr, LBL_PAGING_4K);
+        pt[(addr >> 12) & 511] = addr | LBL_PTE_PRESENT | LBL_PTE_WRITABLE | (wc ? LBL_PTE_PAT_4K : 0);
+        addr += LBL_PAGING_4K;
+    }
+
+    // Higher-half alias: same PDPTs, so it costs no extra tables.
+    slots = (lbl_usize)((plan->top + (512 * LBL_PAGING_1G) - 1) / (512 * LBL_PAGING_1G));
+    for (i = 0; i < slots; i++) {
+        pml4[256 + i] = pml4[i];
+    }
+    plan->root = (lbl_u64)(lbl_usize)pml4;
+    return 0;
+}
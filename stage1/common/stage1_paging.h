@@ -0,0 +1,71 @@
+// Lionbootloader - Stage 1 - x86_64 Page Table Builder
+// File: stage1/common/stage1_paging.h
+//
+// Builds 4-level identity page tables (plus a higher-half alias of the same range)
+// using the largest pages the CPU offers: 1 GiB where CPUID reports pdpe1gb,
+// 2 MiB otherwise, 4 KiB only at the edges of the write-combining range.
+// Tables come from a caller-provided pool, so building them needs no firmware
+// services. On anything but x86_64 the functions report "unsupported".
+
+#ifndef STAGE1_PAGING_H
+#define STAGE1_PAGING_H
+
+#include "stage1_loader_utils.h" // lbl_u8 / lbl_u64 / lbl_usize
+
+#define LBL_PAGING_4K       0x1000ULL
+#define LBL_PAGING_2M       0x200000ULL
+#define LBL_PAGING_1G       0x40000000ULL
+
+// Virtual base of the higher-half alias: PML4 slots 256+ repeat the identity slots.
+#define LBL_PAGING_HIGHER_HALF_BASE 0xFFFF800000000000ULL
+// Largest range the alias can cover (PML4 slots 256-511).
+#define LBL_PAGING_MAX_TOP          (256ULL * 512 * LBL_PAGING_1G)
+
+// IA32_PAT programmed by lbl_paging_activate(): the power-on default except
+// PA4 = WC. PA0-PA3 keep their meaning, so PWT/PCD-only mappings are unchanged;
+// the builder selects PA4 (PAT bit set, PWT = PCD = 0) for the WC range.
+#define LBL_PAGING_PAT_VALUE        0x0007040100070406ULL
+
+typedef struct {
+    lbl_u64 top;            // Identity-map [0, top); rounded up to LBL_PAGING_1G
+    lbl_u64 wc_base;        // Range mapped write-combining (framebuffer), page aligned
+    lbl_u64 wc_size;        // 0 = none
+    int use_1g;             // Use 1 GiB leaves (lbl_paging_cpu_has_1g_pages())
+    lbl_u8* pool;           // Page-aligned, identity-mapped memory for the tables
+    lbl_usize pool_pages;
+    lbl_usize used_pages;   // Output: pages taken from the pool
+    lbl_u64 root;           // Output: physical address of the PML4 (value for CR3)
+} LBL_PAGING_PLAN;
+
+/**
+ * @brief Checks that the running CPU is in 4-level long-mode paging (no LA57),
+ * which is what the builder produces.
+ * @return 1 if supported, 0 otherwise (or when not built for x86_64).
+ */
+int lbl_paging_cpu_supported(void);
+
+/**
+ * @brief Reports CPUID.80000001h:EDX.Page1GB.
+ */
+int lbl_paging_cpu_has_1g_pages(void);
+
+/**
+ * @brief Upper bound on the pool pages lbl_paging_build() needs for `plan`
+ * (top, wc_base, wc_size and use_1g must be set).
+ */
+lbl_usize lbl_paging_tables_needed(const LBL_PAGING_PLAN* plan);
+
+/**
+ * @brief Builds the tables into plan->pool and sets plan->root.
+ * @return 0 on success, -1 if the pool is too small or the plan is invalid.
+ */
+int lbl_paging_build(LBL_PAGING_PLAN* plan);
+
+/**
+ * @brief Disables interrupts, programs LBL_PAGING_PAT_VALUE and loads `root`
+ * into CR3 (global TLB entries included). Call after ExitBootServices, with
+ * code, stack and data inside the identity range.
+ */
+void lbl_paging_activate(lbl_u64 root);
+
+#endif // STAGE1_PAGING_H
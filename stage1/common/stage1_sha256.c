@@ -0,0 +1,305 @@
+// Lionbootloader - Stage 1 - Streaming SHA-256
+// File: stage1/common/stage1_sha256.c
+
+#include "stage1_sha256.h"
+
+static const lbl_u32 lbl_sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Hashes `blocks` consecutive 64-byte blocks into state.
+typedef void (*lbl_sha256_blocks_fn)(lbl_u32 state[8], const lbl_u8* data, lbl_usize blocks);
+
+// --- Portable implementation ---
+
+#define LBL_ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void lbl_sha256_blocks_generic(lbl_u32 state[8], const lbl_u8* data, lbl_usize blocks) {
+    lbl_u32 w[64];
+    lbl_u32 a, b, c, d, e, f, g, h;
+    int i;
+
+    while (blocks--) {
+        for (i = 0; i < 16; i++) {
+            w[i] = ((lbl_u32)data[i * 4] << 24) | ((lbl_u32)data[i * 4 + 1] << 16) |
+                   ((lbl_u32)data[i * 4 + 2] << 8) | (lbl_u32)data[i * 4 + 3];
+        }
+        for (i = 16; i < 64; i++) {
+            lbl_u32 s0 = LBL_ROR32(w[i - 15], 7) ^ LBL_ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            lbl_u32 s1 = LBL_ROR32(w[i - 2], 17) ^ LBL_ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        a = state[0]; b = state[1]; c = state[2]; d = state[3];
+        e = state[4]; f = state[5]; g = state[6]; h = state[7];
+        for (i = 0; i < 64; i++) {
+            lbl_u32 s1 = LBL_ROR32(e, 6) ^ LBL_ROR32(e, 11) ^ LBL_ROR32(e, 25);
+            lbl_u32 ch = (e & f) ^ (~e & g);
+            lbl_u32 t1 = h + s1 + ch + lbl_sha256_k[i] + w[i];
+            lbl_u32 s0 = LBL_ROR32(a, 2) ^ LBL_ROR32(a, 13) ^ LBL_ROR32(a, 22);
+            lbl_u32 maj = (a & b) ^ (a & c) ^ (b & c);
+            lbl_u32 t2 = s0 + maj;
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        data += LBL_SHA256_BLOCK_SIZE;
+    }
+}
+
+// --- x86 SHA extensions ---
+// Written with compiler builtins and generic vector shuffles rather than
+// <immintrin.h>, which is not reachable under -nostdinc.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || defined(__GNUC__))
+#define LBL_SHA256_HAVE_X86_SHA 1
+
+typedef int lbl_v4si __attribute__((vector_size(16)));
+typedef unsigned int lbl_v4su __attribute__((vector_size(16)));
+typedef char lbl_v16qi __attribute__((vector_size(16)));
+
+#if defined(__clang__)
+#define LBL_SHUF4(a, b, i0, i1, i2, i3) __builtin_shufflevector((a), (b), i0, i1, i2, i3)
+#define LBL_BSWAP32X4(v) ((lbl_v4su)__builtin_shufflevector((lbl_v16qi)(v), (lbl_v16qi)(v), \
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12))
+#else
+#define LBL_SHUF4(a, b, i0, i1, i2, i3) __builtin_shuffle((a), (b), (lbl_v4su){ i0, i1, i2, i3 })
+#define LBL_BSWAP32X4(v) ((lbl_v4su)__builtin_shuffle((lbl_v16qi)(v), \
+    (lbl_v16qi){ 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 }))
+#endif
+
+#define LBL_RNDS2(cdgh, abef, wk) \
+    ((lbl_v4su)__builtin_ia32_sha256rnds2((lbl_v4si)(cdgh), (lbl_v4si)(abef), (lbl_v4si)(wk)))
+#define LBL_MSG1(a, b) ((lbl_v4su)__builtin_ia32_sha256msg1((lbl_v4si)(a), (lbl_v4si)(b)))
+#define LBL_MSG2(a, b) ((lbl_v4su)__builtin_ia32_sha256msg2((lbl_v4si)(a), (lbl_v4si)(b)))
+
+__attribute__((target("sha,ssse3,sse4.1")))
+static void lbl_sha256_blocks_x86_sha(lbl_u32 state[8], const lbl_u8* data, lbl_usize blocks) {
+    lbl_v4su abcd, efgh, state0, state1;
+    lbl_v4su msg[4];
+
+    __builtin_memcpy(&abcd, &state[0], 16);
+    __builtin_memcpy(&efgh, &state[4], 16);
+    // rnds2 works on the {F,E,B,A} / {H,G,D,C} register layout.
+    state0 = LBL_SHUF4(abcd, efgh, 5, 4, 1, 0);
+    state1 = LBL_SHUF4(abcd, efgh, 7, 6, 3, 2);
+
+    while (blocks--) {
+        lbl_v4su abef_save = state0;
+        lbl_v4su cdgh_save = state1;
+        int g;
+
+        for (g = 0; g < 4; g++) {
+            __builtin_memcpy(&msg[g], data + g * 16, 16);
+            msg[g] = LBL_BSWAP32X4(msg[g]);
+        }
+
+        // 16 groups of 4 rounds; the message schedule runs 1-3 groups ahead.
+        for (g = 0; g < 16; g++) {
+            lbl_v4su k, wk;
+            lbl_v4su w = msg[g & 3];
+
+            __builtin_memcpy(&k, &lbl_sha256_k[g * 4], 16);
+            wk = w + k;
+            state1 = LBL_RNDS2(state1, state0, wk);
+            if (g >= 3 && g <= 14) {
+                lbl_v4su* next = &msg[(g + 1) & 3];
+                *next += LBL_SHUF4(msg[(g - 1) & 3], w, 1, 2, 3, 4);
+                *next = LBL_MSG2(*next, w);
+            }
+            wk = LBL_SHUF4(wk, wk, 2, 3, 0, 1);
+            state0 = LBL_RNDS2(state0, state1, wk);
+            if (g >= 1 && g <= 12) {
+                msg[(g - 1) & 3] = LBL_MSG1(msg[(g - 1) & 3], w);
+            }
+        }
+
+        state0 += abef_save;
+        state1 += cdgh_save;
+        data += LBL_SHA256_BLOCK_SIZE;
+    }
+
+    abcd = LBL_SHUF4(state0, state1, 3, 2, 7, 6);
+    efgh = LBL_SHUF4(state0, state1, 1, 0, 5, 4);
+    __builtin_memcpy(&state[0], &abcd, 16);
+    __builtin_memcpy(&state[4], &efgh, 16);
+}
+
+static int lbl_sha256_cpu_has_accel(void) {
+    lbl_u32 eax, ebx, ecx, edx;
+
+    __asm__ __volatile__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0), "c"(0));
+    if (eax < 7) {
+        return 0;
+    }
+    __asm__ __volatile__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1), "c"(0));
+    if (!(ecx & (1u << 9)) || !(ecx & (1u << 19))) { // SSSE3, SSE4.1
+        return 0;
+    }
+    __asm__ __volatile__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+    return (ebx & (1u << 29)) != 0; // SHA
+}
+
+#define lbl_sha256_blocks_accel lbl_sha256_blocks_x86_sha
+
+// --- ARMv8 Cryptography Extension ---
+#elif defined(__aarch64__)
+#define LBL_SHA256_HAVE_ARM_SHA2 1
+
+typedef lbl_u32 lbl_v4su __attribute__((vector_size(16)));
+
+static void lbl_sha256_blocks_armv8(lbl_u32 state[8], const lbl_u8* data, lbl_usize blocks) {
+    lbl_v4su abcd, efgh;
+    lbl_v4su msg[4];
+
+    __builtin_memcpy(&abcd, &state[0], 16);
+    __builtin_memcpy(&efgh, &state[4], 16);
+
+    while (blocks--) {
+        lbl_v4su abcd_save = abcd;
+        lbl_v4su efgh_save = efgh;
+        int g;
+
+        for (g = 0; g < 4; g++) {
+            __builtin_memcpy(&msg[g], data + g * 16, 16);
+            __asm__("rev32 %0.16b, %0.16b" : "+w"(msg[g]));
+        }
+
+        for (g = 0; g < 16; g++) {
+            lbl_v4su k, wk, abcd_prev;
+
+            __builtin_memcpy(&k, &lbl_sha256_k[g * 4], 16);
+            wk = msg[g & 3] + k;
+            if (g < 12) {
+                __asm__(".arch_extension crypto\n\t"
+                        "sha256su0 %0.4s, %1.4s" : "+w"(msg[g & 3]) : "w"(msg[(g + 1) & 3]));
+            }
+            abcd_prev = abcd;
+            __asm__(".arch_extension crypto\n\t"
+                    "sha256h %q0, %q1, %2.4s" : "+w"(abcd) : "w"(efgh), "w"(wk));
+            __asm__(".arch_extension crypto\n\t"
+                    "sha256h2 %q0, %q1, %2.4s" : "+w"(efgh) : "w"(abcd_prev), "w"(wk));
+            if (g < 12) {
+                __asm__(".arch_extension crypto\n\t"
+                        "sha256su1 %0.4s, %1.4s, %2.4s"
+                        : "+w"(msg[g & 3]) : "w"(msg[(g + 2) & 3]), "w"(msg[(g + 3) & 3]));
+            }
+        }
+
+        abcd += abcd_save;
+        efgh += efgh_save;
+        data += LBL_SHA256_BLOCK_SIZE;
+    }
+
+    __builtin_memcpy(&state[0], &abcd, 16);
+    __builtin_memcpy(&state[4], &efgh, 16);
+}
+
+static int lbl_sha256_cpu_has_accel(void) {
+    lbl_u64 isar0;
+    // Stage 1 runs at EL1/EL2, where the ID registers are directly readable.
+    __asm__ __volatile__("mrs %0, id_aa64isar0_el1" : "=r"(isar0));
+    return ((isar0 >> 12) & 0xF) != 0; // SHA2 field
+}
+
+#define lbl_sha256_blocks_accel lbl_sha256_blocks_armv8
+#endif
+
+static lbl_sha256_blocks_fn lbl_sha256_blocks = 0;
+
+static void lbl_sha256_select(void) {
+#if defined(LBL_SHA256_HAVE_X86_SHA) || defined(LBL_SHA256_HAVE_ARM_SHA2)
+    if (lbl_sha256_cpu_has_accel()) {
+        lbl_sha256_blocks = lbl_sha256_blocks_accel;
+        return;
+    }
+#endif
+    lbl_sha256_blocks = lbl_sha256_blocks_generic;
+}
+
+int lbl_sha256_accelerated(void) {
+    if (!lbl_sha256_blocks) {
+        lbl_sha256_select();
+    }
+    return lbl_sha256_blocks != lbl_sha256_blocks_generic;
+}
+
+void lbl_sha256_init(LBL_SHA256_CTX* ctx) {
+    static const lbl_u32 initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    int i;
+
+    if (!lbl_sha256_blocks) {
+        lbl_sha256_select();
+    }
+    for (i = 0; i < 8; i++) {
+        ctx->state[i] = initial[i];
+    }
+    ctx->length = 0;
+    ctx->block_len = 0;
+}
+
+void lbl_sha256_update(LBL_SHA256_CTX* ctx, const void* data, lbl_usize len) {
+    const lbl_u8* in = (const lbl_u8*)data;
+    lbl_usize whole;
+
+    ctx->length += len;
+
+    if (ctx->block_len != 0) {
+        while (len != 0 && ctx->block_len < LBL_SHA256_BLOCK_SIZE) {
+            ctx->block[ctx->block_len++] = *in++;
+            len--;
+        }
+        if (ctx->block_len < LBL_SHA256_BLOCK_SIZE) {
+            return;
+        }
+        lbl_sha256_blocks(ctx->state, ctx->block, 1);
+        ctx->block_len = 0;
+    }
+
+    whole = len / LBL_SHA256_BLOCK_SIZE;
+    if (whole != 0) {
+        lbl_sha256_blocks(ctx->state, in, whole);
+        in += whole * LBL_SHA256_BLOCK_SIZE;
+        len -= whole * LBL_SHA256_BLOCK_SIZE;
+    }
+    while (len--) {
+        ctx->block[ctx->block_len++] = *in++;
+    }
+}
+
+void lbl_sha256_final(LBL_SHA256_CTX* ctx, lbl_u8 digest[LBL_SHA256_DIGEST_SIZE]) {
+    lbl_u64 bits = ctx->length * 8;
+    int i;
+
+    ctx->block[ctx->block_len++] = 0x80;
+    if (ctx->block_len > LBL_SHA256_BLOCK_SIZE - 8) {
+        while (ctx->block_len < LBL_SHA256_BLOCK_SIZE) {
+            ctx->block[ctx->block_len++] = 0;
+        }
+        lbl_sha256_blocks(ctx->state, ctx->block, 1);
+        ctx->block_len = 0;
+    }
+    while (ctx->block_len < LBL_SHA256_BLOCK_SIZE - 8) {
+        ctx->block[ctx->block_len++] = 0;
+    }
+    for (i = 0; i < 8; i++) {
+        ctx->block[LBL_SHA256_BLOCK_SIZE - 1 - i] = (lbl_u8)(bits >> (i * 8));
+    }
+    lbl_sha256_blocks(ctx->state, ctx->block, 1);
+
+    for (i = 0; i < 8; i++) {
+        digest[i * 4] = (lbl_u8)(ctx->state[i] >> 24);
+        digest[i * 4 + 1] = (lbl_u8)(ctx->state[i] >> 16);
+        digest[i * 4 + 2] = (lbl_u8)(ctx->state[i] >> 8);
+        digest[i * 4 + 3] = (lbl_u8)ctx->state[i];
+    }
+}
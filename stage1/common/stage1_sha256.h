@@ -0,0 +1,45 @@
+// Lionbootloader - Stage 1 - Streaming SHA-256
+// File: stage1/common/stage1_sha256.h
+//
+// Freestanding, incremental SHA-256 shared by the BIOS and UEFI loaders. The block
+// function is picked on first use: x86 SHA extensions (SHA-NI) or the ARMv8
+// Cryptography Extension when the CPU has them, portable C otherwise.
+
+#ifndef STAGE1_SHA256_H
+#define STAGE1_SHA256_H
+
+#include "stage1_loader_utils.h" // lbl_u8 / lbl_u32 / lbl_u64 / lbl_usize
+
+#define LBL_SHA256_DIGEST_SIZE  32
+#define LBL_SHA256_BLOCK_SIZE   64
+
+typedef struct {
+    lbl_u32 state[8];
+    lbl_u64 length;                         // Bytes hashed so far
+    lbl_u8 block[LBL_SHA256_BLOCK_SIZE];    // Partial block carried between updates
+    lbl_usize block_len;
+} LBL_SHA256_CTX;
+
+/**
+ * @brief Starts a new hash.
+ */
+void lbl_sha256_init(LBL_SHA256_CTX* ctx);
+
+/**
+ * @brief Hashes the next `len` bytes. Whole blocks are hashed in place; only a
+ * trailing partial block is copied into the context.
+ */
+void lbl_sha256_update(LBL_SHA256_CTX* ctx, const void* data, lbl_usize len);
+
+/**
+ * @brief Finishes the hash and writes the 32-byte digest.
+ */
+void lbl_sha256_final(LBL_SHA256_CTX* ctx, lbl_u8 digest[LBL_SHA256_DIGEST_SIZE]);
+
+/**
+ * @brief Reports whether a hardware-accelerated block function is in use.
+ * @return 1 for SHA-NI / ARMv8 SHA2, 0 for the portable implementation.
+ */
+int lbl_sha256_accelerated(void);
+
+#endif // STAGE1_SHA256_H
@@ -6,6 +6,13 @@
 
 #include "LblUefi.h" // Own header for this file (if any specific declarations)
 #include "../common/stage1_loader_utils.h" // Shared utilities
+#include "../common/stage1_lz4.h"          // Compressed core container decoder
+#include "../common/stage1_sha256.h"       // Core digest, computed while reading
+#include "../common/stage1_paging.h"       // Page tables the core is entered on
+#include "../common/stage1_mp.h"           // AP trampoline and parking mailboxes
+#include "../common/stage1_image.h"        // ELF64 / PE32+ core segments and relocations
+#include "../common/stage1_mem.h"          // Copy / fill routines usable after ExitBootServices
+#include "../common/stage1_fbcon.h"        // Text console usable after ExitBootServices
 
 // Define global variables for EFI services, initialized in efi_main
 EFI_SYSTEM_TABLE         *ST = NULL;
@@ -13,18 +20,85 @@ EFI_BOOT_SERVICES        *BS = NULL;
 EFI_RUNTIME_SERVICES     *RS = NULL;
 EFI_HANDLE               IH = NULL; // This image's handle
 
+static EFI_GUID LblVendorGuid = LBL_VENDOR_GUID; // Namespace of all LBL_NV_* variables
+
 
 // Configuration for finding LBL Core
 // These should match paths that the LBL installation process would create.
 // Paths are relative to the root of a discovered FAT filesystem (typically ESP).
 #define LBL_CORE_BIN_PATH       L"\\LBL\\CORE\\lbl_core.bin"
+// Optional install-time extent map for the core (see LBL_EXTENT_MAP_HEADER).
+#define LBL_CORE_EXTENT_MAP_PATH    L"\\LBL\\CORE\\lbl_core.ext"
+// Optional signed digest of the core (see LBL_CORE_MANIFEST_HEADER).
+#define LBL_CORE_MANIFEST_PATH      L"\\LBL\\CORE\\lbl_core.man"
+// Optional list of files to preload from the core's volume (see LBL_MODULE_ENTRY).
+#define LBL_PRELOAD_MANIFEST_PATH   L"\\LBL\\CORE\\preload.lst"
+// Bytes per Read when streaming the core (see LBL_UEFI_STREAM_DEFAULT_CHUNK).
+#define LBL_CORE_READ_CHUNK_SIZE    LBL_UEFI_STREAM_DEFAULT_CHUNK
+// LBL_BOOT_INFO plus its appended records, in one LoaderData allocation
+// (64 KiB leaves room for a compact map of ~4000 ranges).
+#define LBL_BOOT_INFO_AREA_PAGES    16
+// Largest load alignment a core header may ask for (one 1 GiB page).
+#define LBL_MAX_LOAD_ALIGNMENT      0x40000000ULL
+// Stall used to estimate the cycle-counter frequency for the boot timeline.
+#define LBL_TIMELINE_CALIBRATION_US 1000
+
+// File names per LBL_CORE_SLOT_*; the last entry is the single-image install above.
+typedef struct {
+    CONST CHAR16* Name;             // For log messages
+    CONST CHAR16* Core;
+    CONST CHAR16* ExtentMap;
+    CONST CHAR16* Manifest;
+} LBL_CORE_SLOT_PATHS;
+
+static CONST LBL_CORE_SLOT_PATHS LblCoreSlotPaths[LBL_CORE_SLOT_COUNT] = {
+    { L"A", L"\\LBL\\CORE\\lbl_core_a.bin", L"\\LBL\\CORE\\lbl_core_a.ext", L"\\LBL\\CORE\\lbl_core_a.man" },
+    { L"B", L"\\LBL\\CORE\\lbl_core_b.bin", L"\\LBL\\CORE\\lbl_core_b.ext", L"\\LBL\\CORE\\lbl_core_b.man" },
+    { L"single", LBL_CORE_BIN_PATH, LBL_CORE_EXTENT_MAP_PATH, LBL_CORE_MANIFEST_PATH },
+};
+
 // If core could also be an EFI app:
 // #define LBL_CORE_EFI_PATH    L"\\EFI\\LBL\\lbl_core.efi"
 
 
 // Forward declaration (if needed, for functions defined later in this file)
-EFI_STATUS FindAndLoadLBLCore(VOID** CoreBuffer, UINTN* CoreSize);
-EFI_STATUS PrepareBootInfoForCore(LBL_BOOT_INFO* BootInfoStructure, VOID* CoreBuffer, UINTN CoreSize);
+EFI_STATUS FindAndLoadLBLCore(LBL_CORE_IMAGE* Core);
+EFI_STATUS PrepareBootInfoForCore(LBL_BOOT_INFO* BootInfoStructure, LBL_CORE_IMAGE* Core,
+                                  LBL_UEFI_MEMORY_MAP* MemoryMap);
+static VOID LblPublishMemoryMap(LBL_BOOT_INFO* BootInfoStructure, CONST LBL_UEFI_MEMORY_MAP* MemoryMap);
+static VOID LblFreeCoreImage(LBL_CORE_IMAGE* Core);
+static VOID LblFreePreloadedModules(VOID);
+static VOID LblPublishModules(LBL_BOOT_INFO* BootInfo);
+static VOID LblPublishCoreSegments(LBL_BOOT_INFO* BootInfo, CONST LBL_CORE_IMAGE* Core);
+static VOID LblPublishMemOps(LBL_BOOT_INFO* BootInfo);
+static VOID LblPublishCoreSlot(LBL_BOOT_INFO* BootInfo, CONST LBL_CORE_IMAGE* Core);
+static VOID LblPublishEarlyConsole(LBL_BOOT_INFO* BootInfo);
+static EFI_STATUS LblAllocateBootInfo(LBL_BOOT_INFO** BootInfo);
+static VOID LblFreeBootInfo(LBL_BOOT_INFO* BootInfo);
+static VOID LblTimelineMark(UINT32 Id, UINT32 Arg);
+static VOID LblTimelineMarkAt(UINT32 Id, UINT32 Arg, UINT64 Ticks);
+#if LBL_TIMELINE_SERIAL
+static VOID LblTimelineEmitSerial(VOID);
+#endif
+static VOID LblLoadLogLevels(VOID);
+static LBL_COMPACT_MEMORY_MAP_RECORD* LblReserveCompactMap(LBL_BOOT_INFO* BootInfo, CONST LBL_UEFI_MEMORY_MAP* MemoryMap);
+static VOID LblBuildCompactMap(LBL_COMPACT_MEMORY_MAP_RECORD* Record, CONST LBL_UEFI_MEMORY_MAP* MemoryMap);
+static VOID LblPreparePageTables(LBL_BOOT_INFO* BootInfo);
+static VOID LblFreePageTables(VOID);
+static VOID LblSelectGopMode(EFI_GRAPHICS_OUTPUT_PROTOCOL* Gop);
+static VOID LblHarvestConfigTables(LBL_BOOT_INFO* BootInfo);
+static VOID LblBuildAcpiIndex(LBL_BOOT_INFO* BootInfo);
+static VOID LblPrepareProcessors(LBL_BOOT_INFO* BootInfo, CONST LBL_CORE_IMAGE* Core);
+static VOID LblStartProcessors(VOID);
+static VOID LblFreeProcessors(VOID);
+static VOID LblDescribeFramebuffer(LBL_BOOT_INFO* BootInfo, EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE* Mode);
+static BOOLEAN LblSetFramebufferWriteCombining(EFI_PHYSICAL_ADDRESS Base, UINT64 Size);
+static EFI_STATUS LblOpenCoreVolume(EFI_HANDLE Device, EFI_FILE_PROTOCOL** Root);
+static BOOLEAN LblIsNetworkVolume(CONST EFI_FILE_PROTOCOL* Root);
+
+// The console handed to the core (inside its boot record), and its glyph cache.
+static LBL_FBCON* LblEarlyConsole = NULL;
+static EFI_PHYSICAL_ADDRESS LblEarlyConsoleCache = 0;
 
 
 /**
@@ -37,9 +111,13 @@ EFIAPI
 efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
 {
     EFI_STATUS Status;
-    VOID* LblCoreBuffer = NULL;
-    UINTN LblCoreSize = 0;
-    LBL_BOOT_INFO BootInfoForCore; // Defined in LblUefi.h or common header
+    LBL_CORE_IMAGE LblCore;
+    LBL_UEFI_MEMORY_MAP LblMemoryMap; // Allocated once, refilled in place until ExitBootServices
+    LBL_BOOT_INFO* BootInfoForCore = NULL; // Defined in LblUefi.h; records follow it in the same pages
+    LBL_COMPACT_MEMORY_MAP_RECORD* CompactMap;
+    UINT32 Attempt;
+
+    LblTimelineMark(LBL_TL_STAGE1_ENTRY, 0);
 
     // Initialize global pointers. This pattern is common with gnu-efi.
     ST = SystemTable;
@@ -53,77 +131,104 @@ efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
     // If not using libefi helpers extensively, direct BS calls are fine.
     InitializeLib(ImageHandle, SystemTable);
 
-    Print(L"Lionbootloader Stage1 UEFI Initializing...\n");
-    lbl_uefi_print_ascii_string("LBL Stage1 UEFI (using utility print)...\r\n");
+    // Messages are buffered from here on and reach ConOut only in batched flushes:
+    // just before ExitBootServices (warnings and errors) or, on failure, everything.
+    LblLoadLogLevels();
+    LBL_LOG_INFO(L"Lionbootloader Stage1 UEFI Initializing...\n");
 
     // 1. Locate and Load LBL Core Engine
     //    This involves finding a suitable FAT partition (usually ESP),
-    //    then loading LBL_CORE_BIN_PATH from it.
-    Status = FindAndLoadLBLCore(&LblCoreBuffer, &LblCoreSize);
+    //    then loading the first usable core slot (A/B, then LBL_CORE_BIN_PATH) from it.
+    Status = FindAndLoadLBLCore(&LblCore);
     if (EFI_ERROR(Status)) {
-        Print(L"Error: Failed to load LBL Core Engine. Status: %r\n", Status);
-        lbl_uefi_print_ascii_string("Halting due to LBL Core load failure.\r\n");
-        BS->Stall(5 * 1000 * 1000); // Stall for 5 seconds before exit
+        // Every slot already failed over; return at once so the firmware moves
+        // on to its next boot option instead of waiting here.
+        LBL_LOG_ERROR(L"Error: Failed to load LBL Core Engine. Status: %r\n", Status);
+        LBL_LOG_ERROR(L"Returning to firmware due to LBL Core load failure.\n");
+        lbl_uefi_log_flush(LBL_LOG_LEVEL_TRACE);
         return Status;
     }
-    Print(L"LBL Core Engine loaded into memory at 0x%lx (Size: %u bytes).\n", LblCoreBuffer, LblCoreSize);
+    LBL_LOG_INFO(L"LBL Core Engine placed at 0x%lx (Size: %lu bytes, Alignment: 0x%lx).\n",
+        LblCore.load_addr, LblCore.file_size, LblCore.alignment);
 
 
     // 2. Prepare Boot Information for the Core Engine
     //    This structure will be passed to the Rust core.
     //    It needs memory map, graphics info, ACPI tables, etc.
-    Status = PrepareBootInfoForCore(&BootInfoForCore, LblCoreBuffer, LblCoreSize);
+    //    If the core is still being read asynchronously, this also waits for it
+    //    (after the GOP/ACPI/SMBIOS gathering, before the memory map snapshot).
+    Status = LblAllocateBootInfo(&BootInfoForCore);
+    if (!EFI_ERROR(Status)) {
+        Status = PrepareBootInfoForCore(BootInfoForCore, &LblCore, &LblMemoryMap);
+    }
     if (EFI_ERROR(Status)) {
-        Print(L"Error: Failed to prepare BootInfo for Core. Status: %r\n", Status);
-        BS->FreePool(LblCoreBuffer); // Free core buffer on error
-        BS->Stall(5 * 1000 * 1000);
-        return Status;
+        LBL_LOG_ERROR(L"Error: Failed to prepare BootInfo for Core. Status: %r\n", Status);
+        LblFreeBootInfo(BootInfoForCore);
+        LblFreeCoreImage(&LblCore); // Free core pages on error
+        lbl_uefi_log_flush(LBL_LOG_LEVEL_TRACE);
+        return Status; // As above: let the firmware try its next boot option now
     }
-    Print(L"BootInfo prepared for LBL Core.\n");
-    Print(L"  Memory Map Key: 0x%lx\n", BootInfoForCore.memory_map_key);
-    Print(L"  Framebuffer: %ux%u @ 0x%lx, Pitch %u, BPP %u\n",
-        BootInfoForCore.framebuffer_width, BootInfoForCore.framebuffer_height,
-        BootInfoForCore.framebuffer_addr, BootInfoForCore.framebuffer_pitch, BootInfoForCore.framebuffer_bpp);
+    LBL_LOG_INFO(L"BootInfo prepared for LBL Core.\n");
+    LBL_LOG_DEBUG(L"  Memory Map Key: 0x%lx\n", BootInfoForCore->memory_map_key);
+    LBL_LOG_DEBUG(L"  Framebuffer: %ux%u @ 0x%lx, Pitch %u, BPP %u\n",
+        BootInfoForCore->framebuffer_width, BootInfoForCore->framebuffer_height,
+        BootInfoForCore->framebuffer_addr, BootInfoForCore->framebuffer_pitch, BootInfoForCore->framebuffer_bpp);
+    LblTimelineMark(LBL_TL_BOOT_INFO_READY, 0);
 
 
     // 3. (Optional, but common) Exit Boot Services before jumping to core.
     //    LBL Core might want to do this itself if it needs Boot Services for a while.
     //    If Stage1 exits boot services, Core must be prepared to run without them.
-    //    The MemoryMapKey from BootInfoForCore.memory_map_key is crucial here.
-    Print(L"Attempting to exit boot services with MapKey: 0x%lx...\n", BootInfoForCore.memory_map_key);
-    Status = BS->ExitBootServices(IH, BootInfoForCore.memory_map_key);
-    if (EFI_ERROR(Status)) {
-        // This is a critical error. The memory map might have changed.
-        // A robust loader would try to GetMemoryMap again and retry ExitBootServices
-        // a few times.
-        Print(L"CRITICAL Error: ExitBootServices failed! Status: %r\n", Status);
-        Print(L"The system may be unstable. Halting.\n");
-        // It's hard to recover here. If core was loaded, it might not be at a valid location anymore.
-        BS->FreePool(LblCoreBuffer); // Attempt to free, might fail if map changed too much.
-                                     // Freeing BootInfo.memory_map_buffer should also happen.
-        BS->FreePool(BootInfoForCore.memory_map_buffer); 
-        while(1) { BS->Stall(100000); } // Infinite stall
-    }
-    Print(L"Successfully exited boot services.\n");
+    //    The map is re-read into the same buffer right before each attempt, and the
+    //    attempt is retried (bounded) while the firmware reports a stale key.
+    // The compact map is built from the final map, after boot services are gone,
+    // so its space has to be reserved now (sized for the map buffer's headroom).
+    CompactMap = LblReserveCompactMap(BootInfoForCore, &LblMemoryMap);
+    LBL_LOG_INFO(L"Exiting boot services...\n");
+    lbl_uefi_log_flush_console(); // Last console output; the core replays the full ring
+    Status = lbl_uefi_exit_boot_services(IH, &LblMemoryMap, LBL_UEFI_EXIT_BOOT_SERVICES_ATTEMPTS);
+    if (EFI_ERROR(Status)) {
+        // Boot services may already be partially torn down, so nothing can be freed
+        // and ConOut cannot be trusted; the early console needs neither.
+        // Runtime services survive: reset instead of hanging.
+        if (LblEarlyConsole != NULL) {
+            lbl_fbcon_puts(LblEarlyConsole, "CRITICAL Error: ExitBootServices failed, status ");
+            lbl_fbcon_put_hex(LblEarlyConsole, Status);
+            lbl_fbcon_puts(LblEarlyConsole, ", retries ");
+            lbl_fbcon_put_hex(LblEarlyConsole, LblMemoryMap.retries);
+            lbl_fbcon_puts(LblEarlyConsole, ". Resetting.\n");
+        }
+        RS->ResetSystem(EfiResetWarm, Status, 0, NULL);
+        while(1) { /* ResetSystem does not return */ }
+    }
+    // The final snapshot (possibly taken on a retry) is the one the core must see.
+    LblPublishMemoryMap(BootInfoForCore, &LblMemoryMap);
+    LblBuildCompactMap(CompactMap, &LblMemoryMap);
+    for (Attempt = 0; Attempt < LblMemoryMap.attempts && Attempt < LBL_UEFI_EXIT_BOOT_SERVICES_ATTEMPTS; Attempt++) {
+        LblTimelineMarkAt(LBL_TL_EXIT_BOOT_SERVICES, Attempt, LblMemoryMap.attempt_ticks[Attempt]);
+    }
     // IMPORTANT: After ExitBootServices, ST, BS, Print(), AllocatePool(), etc. are INVALID.
     // Only RS (Runtime Services) are available. Logging must use direct framebuffer/serial if needed.
     // The Rust core will be running in this post-ExitBootServices environment.
 
     // 4. Jump to LBL Core Engine
-    //    The LBL_CORE_ENTRY_OFFSET is relative to LblCoreBuffer.
+    //    The entry offset (from the core header, or LBL_CORE_ENTRY_OFFSET) is relative to load_addr.
     //    The Core engine expects a pointer to BootInfoForCore in a specific register
     //    (defined by LBL's internal ABI, e.g., RDI/X0).
-    UINT64 CoreEntryPoint = (UINT64)LblCoreBuffer + LBL_CORE_ENTRY_OFFSET;
+    UINT64 CoreEntryPoint = LblCore.load_addr + LblCore.entry_offset;
     
     // Define a function pointer type for the Rust core entry
     // `lbl_core_entry(boot_info_ptr: *const u8)`
     typedef VOID (EFIAPI *LBL_CORE_ENTRY_FN)(LBL_BOOT_INFO* BootInfo);
     LBL_CORE_ENTRY_FN LblCoreEntry = (LBL_CORE_ENTRY_FN)CoreEntryPoint;
 
-    // Pre-jump message (will use raw framebuffer if possible or just be the last UEFI print)
-    // Cannot use Print() here if ExitBootServices was called.
-    // A very raw print:
-    // if (BootInfoForCore.framebuffer_addr != 0) { /* raw_fb_print("Jumping to LBL Core...") */ }
+    // Pre-jump message. Print() is gone with boot services; the early console
+    // only needs the framebuffer and the UART. Quiet boots leave the screen as is.
+    if (LblEarlyConsole != NULL && lbl_uefi_log_ring()->console_level >= LBL_LOG_LEVEL_INFO) {
+        lbl_fbcon_puts(LblEarlyConsole, "Entering LBL Core at ");
+        lbl_fbcon_put_hex(LblEarlyConsole, CoreEntryPoint);
+        lbl_fbcon_puts(LblEarlyConsole, "\n");
+    }
 
 
     // Make the jump.
@@ -131,7 +236,17 @@ efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
     // For x86_64 System V, first arg is in RDI. For AArch64, X0.
     // The Rust core's `_start` or `lbl_core_entry` should be `extern "C"` or `extern "efiapi"`.
     // The cast to `(LBL_BOOT_INFO*)` is important.
-    LblCoreEntry(&BootInfoForCore);
+    // Switch to Stage 1's tables last: from here on only identity-mapped memory
+    // (this image, its stack, the boot info, the core) is touched.
+    if (BootInfoForCore->page_table_root != 0) {
+        lbl_paging_activate(BootInfoForCore->page_table_root);
+    }
+    LblStartProcessors(); // On the final CR3, so the APs share the core's mappings
+    LblTimelineMark(LBL_TL_CORE_JUMP, 0);
+#if LBL_TIMELINE_SERIAL
+    LblTimelineEmitSerial();
+#endif
+    LblCoreEntry(BootInfoForCore);
 
 
     // Should NOT return here. If it does, something went wrong in the Core.
@@ -148,133 +263,3576 @@ efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
 }
 
 
+// Stage 1 marks collect here until the boot info area exists, then move into its
+// timeline record (LblAllocateBootInfo) and are written there directly.
+static LBL_TIMELINE_RECORD LblTimelineBootstrap = {
+    .header = { .type = LBL_BOOT_RECORD_TIMELINE, .size = sizeof(LBL_TIMELINE_RECORD) },
+    .version = LBL_TIMELINE_VERSION,
+    .capacity = LBL_TIMELINE_CAPACITY,
+};
+static LBL_TIMELINE_RECORD* LblTimeline = &LblTimelineBootstrap;
+static UINTN LblBootInfoCapacity;   // Bytes available behind a LblAllocateBootInfo() result
+
 /**
- * @brief Finds a suitable partition (usually ESP), and loads the LBL Core file.
- * This involves iterating through block devices, checking for FAT filesystems.
+ * @brief Records a timeline event with an explicit timestamp.
+ * Touches memory only, so it is safe after ExitBootServices.
+ */
+static VOID LblTimelineMarkAt(UINT32 Id, UINT32 Arg, UINT64 Ticks) {
+    LBL_TIMELINE_EVENT* Event;
+
+    if (LblTimeline->count >= LblTimeline->capacity) {
+        LblTimeline->dropped++;
+        return;
+    }
+    Event = &LblTimeline->events[LblTimeline->count++];
+    Event->ticks = Ticks;
+    Event->id = Id;
+    Event->arg = Arg;
+}
+
+/**
+ * @brief Records a timeline event stamped with the current cycle counter.
+ */
+static VOID LblTimelineMark(UINT32 Id, UINT32 Arg) {
+    LblTimelineMarkAt(Id, Arg, lbl_read_cycle_counter());
+}
+
+#if LBL_TIMELINE_SERIAL
+/**
+ * @brief Prints the timeline in the LBL_TIMELINE_SERIAL format on the UART the
+ * early console mirrors to, through a console of its own without a framebuffer
+ * so the lines stay off the screen. Runs after ExitBootServices.
+ */
+static VOID LblTimelineEmitSerial(VOID) {
+    LBL_FBCON Uart;
+    UINT32 Index;
+
+    if (lbl_fbcon_init(&Uart, NULL, NULL, 0) != 0) {
+        return;
+    }
+    lbl_fbcon_puts(&Uart, "LBLTL hz ");
+    lbl_fbcon_put_hex(&Uart, LblTimeline->ticks_per_second);
+    lbl_fbcon_puts(&Uart, "\n");
+    for (Index = 0; Index < LblTimeline->count; Index++) {
+        lbl_fbcon_puts(&Uart, "LBLTL ev ");
+        lbl_fbcon_put_hex(&Uart, LblTimeline->events[Index].id);
+        lbl_fbcon_puts(&Uart, " ");
+        lbl_fbcon_put_hex(&Uart, LblTimeline->events[Index].arg);
+        lbl_fbcon_puts(&Uart, " ");
+        lbl_fbcon_put_hex(&Uart, LblTimeline->events[Index].ticks);
+        lbl_fbcon_puts(&Uart, "\n");
+    }
+    lbl_fbcon_puts(&Uart, "LBLTL end\n");
+}
+#endif
+
+/**
+ * @brief Applies the LBL_NV_LOG_LEVEL variable, if set: byte 0 is the record
+ * level, byte 1 (optional) the console flush level.
+ */
+static VOID LblLoadLogLevels(VOID) {
+    UINT8 Levels[2];
+    UINTN Size = sizeof(Levels);
+    LBL_UEFI_LOG_RING* Ring = lbl_uefi_log_ring();
+
+    if (EFI_ERROR(RS->GetVariable(LBL_NV_LOG_LEVEL, &LblVendorGuid, NULL, &Size, Levels)) || Size == 0) {
+        return;
+    }
+    lbl_uefi_log_set_levels(Levels[0], Size >= 2 ? Levels[1] : Ring->console_level);
+}
+
+/**
+ * @brief Estimates the cycle-counter frequency against BS->Stall.
+ */
+static UINT64 LblCalibrateCycleCounter(VOID) {
+    UINT64 Start, End;
+
+    Start = lbl_read_cycle_counter();
+    BS->Stall(LBL_TIMELINE_CALIBRATION_US);
+    End = lbl_read_cycle_counter();
+    if (End <= Start) {
+        return 0; // No usable counter on this architecture
+    }
+    return (End - Start) * (1000000 / LBL_TIMELINE_CALIBRATION_US);
+}
+
+/**
+ * @brief Appends a zeroed record to the boot info.
+ * @param Size Record size in bytes, including its LBL_BOOT_RECORD_HEADER.
+ * @return The record with its header filled in, or NULL if the area is full.
+ */
+static VOID* LblAppendBootRecord(LBL_BOOT_INFO* BootInfo, UINT32 Type, UINT32 Size) {
+    UINTN Offset = (BootInfo->total_size + LBL_BOOT_RECORD_ALIGN - 1) & ~(UINTN)(LBL_BOOT_RECORD_ALIGN - 1);
+    LBL_BOOT_RECORD_HEADER* Record;
+
+    if (Size < sizeof(LBL_BOOT_RECORD_HEADER) || Offset + Size > LblBootInfoCapacity) {
+        return NULL;
+    }
+    Record = (LBL_BOOT_RECORD_HEADER*)((UINT8*)BootInfo + Offset);
+    Record->type = Type;
+    Record->size = Size;
+    BootInfo->total_size = (UINT32)(Offset + Size);
+    return Record;
+}
+
+/**
+ * @brief Allocates the boot info area (LoaderData, so it survives ExitBootServices),
+ * fills in the header and moves the boot timeline into it.
  */
-EFI_STATUS FindAndLoadLBLCore(VOID** CoreBuffer, UINTN* CoreSize) {
+static EFI_STATUS LblAllocateBootInfo(LBL_BOOT_INFO** BootInfo) {
     EFI_STATUS Status;
-    UINTN NumHandles = 0;
-    EFI_HANDLE* HandleBuffer = NULL;
-    UINTN i;
+    EFI_PHYSICAL_ADDRESS Address = 0;
+    LBL_BOOT_INFO* Info;
+    LBL_TIMELINE_RECORD* Timeline;
+
+    Status = BS->AllocatePages(AllocateAnyPages, EfiLoaderData, LBL_BOOT_INFO_AREA_PAGES, &Address);
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+    Info = (LBL_BOOT_INFO*)(UINTN)Address;
+    LblBootInfoCapacity = EFI_PAGES_TO_SIZE(LBL_BOOT_INFO_AREA_PAGES);
+    BS->SetMem(Info, LblBootInfoCapacity, 0);
 
-    Print(L"Locating LBL Core: %s\n", LBL_CORE_BIN_PATH);
+    Info->magic = LBL_BOOT_INFO_MAGIC_VALUE; // From LblUefi.h
+    Info->version = LBL_BOOT_INFO_VERSION;   // From LblUefi.h
+    Info->header_size = sizeof(LBL_BOOT_INFO);
+    Info->total_size = sizeof(LBL_BOOT_INFO);
 
-    // Get all handles that support Simple File System Protocol
-    Status = BS->LocateHandleBuffer(ByProtocol, &gEfiSimpleFileSystemProtocolGuid, NULL, &NumHandles, &HandleBuffer);
-    if (EFI_ERROR(Status) || NumHandles == 0) {
-        Print(L"Error: No filesystems found (SimpleFileSystemProtocol). Status: %r\n", Status);
-        return Status == EFI_SUCCESS ? EFI_NOT_FOUND : Status; // If success but no handles
+    Timeline = LblAppendBootRecord(Info, LBL_BOOT_RECORD_TIMELINE, sizeof(LBL_TIMELINE_RECORD));
+    if (Timeline != NULL) {
+        BS->CopyMem(Timeline, &LblTimelineBootstrap, sizeof(LBL_TIMELINE_RECORD));
+        LblTimeline = Timeline;
+    }
+    *BootInfo = Info;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Releases a boot info area that will not be handed to the core, and the
+ * heap arena reserved for it.
+ */
+static VOID LblFreeBootInfo(LBL_BOOT_INFO* BootInfo) {
+    if (BootInfo == NULL) {
+        return;
     }
+    LblTimeline = &LblTimelineBootstrap;
+    if (LblEarlyConsoleCache != 0) {
+        BS->FreePages(LblEarlyConsoleCache, EFI_SIZE_TO_PAGES(LBL_FBCON_CACHE_SIZE));
+        LblEarlyConsoleCache = 0;
+    }
+    LblEarlyConsole = NULL;
+    LblFreePageTables();
+    LblFreeProcessors();
+    if (BootInfo->core_heap_size != 0) {
+        BS->FreePages(BootInfo->core_heap_addr, (UINTN)EFI_SIZE_TO_PAGES(BootInfo->core_heap_size));
+    }
+    BS->FreePages((EFI_PHYSICAL_ADDRESS)(UINTN)BootInfo, LBL_BOOT_INFO_AREA_PAGES);
+}
 
-    Print(L"Found %u filesystem handle(s).\n", NumHandles);
 
-    for (i = 0; i < NumHandles; i++) {
-        Print(L"  Attempting to load core from FS handle [%u]...\n", i);
-        Status = lbl_uefi_load_file_from_device(HandleBuffer[i], LBL_CORE_BIN_PATH, CoreBuffer, CoreSize);
-        if (!EFI_ERROR(Status)) {
-            Print(L"    LBL Core found and loaded from filesystem handle %u.\n", i);
-            BS->FreePool(HandleBuffer);
-            return EFI_SUCCESS; // Found and loaded
-        } else {
-            Print(L"    Failed to load from FS handle [%u]. Status: %r\n", i, Status);
-            // If CoreBuffer was partially allocated by a failed load_file, it should be freed by load_file.
-            if (*CoreBuffer != NULL) { // Defensive: ensure load_file cleans up on error
-                BS->FreePool(*CoreBuffer);
-                *CoreBuffer = NULL;
+/**
+ * @brief Sanity-checks a core header against the file it came from.
+ */
+static BOOLEAN LblCoreHeaderIsValid(CONST LBL_CORE_IMAGE_HEADER* Header, UINT64 FileSize) {
+    UINT64 MemorySize = Header->memory_size ? Header->memory_size : FileSize;
+
+    if (Header->header_size < LBL_CORE_IMAGE_HEADER_MIN_SIZE || Header->header_size > FileSize) {
+        return FALSE;
+    }
+    if ((Header->alignment & (Header->alignment - 1)) != 0 ||
+        (Header->preferred_base & EFI_PAGE_MASK) != 0) {
+        return FALSE;
+    }
+    if (MemorySize < FileSize || Header->entry_offset >= MemorySize) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Heap arena size requested by a core header; 0 if the header predates
+ * the field or leaves it to Stage 1.
+ */
+static UINT64 LblCoreHeaderHeapSize(CONST LBL_CORE_IMAGE_HEADER* Header) {
+    if (Header->header_size < sizeof(LBL_CORE_IMAGE_HEADER)) {
+        return 0; // The bytes at heap_size are image contents, not header
+    }
+    return Header->heap_size;
+}
+
+/**
+ * @brief Allocates Pages of Type at an Align boundary (a power of two from a page
+ * to LBL_MAX_LOAD_ALIGNMENT), ending below Limit if it is non-zero. The allocation
+ * is padded by Align and the unaligned head and tail are returned to the firmware,
+ * so the slack is never kept.
+ * @return EFI_INVALID_PARAMETER for any other Align (it comes from the core header).
+ */
+static EFI_STATUS LblAllocateAlignedPages(EFI_MEMORY_TYPE Type, EFI_PHYSICAL_ADDRESS Limit,
+                                          UINTN Pages, UINT64 Align, EFI_PHYSICAL_ADDRESS* Base) {
+    EFI_STATUS Status;
+    EFI_PHYSICAL_ADDRESS Allocated, Aligned;
+    UINTN SlackPages, HeadPages;
+
+    if (Align < EFI_PAGE_SIZE || Align > LBL_MAX_LOAD_ALIGNMENT || (Align & (Align - 1)) != 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+    SlackPages = (UINTN)EFI_SIZE_TO_PAGES(Align) - 1;
+    if (Pages > (UINTN)-1 - SlackPages) {
+        return EFI_OUT_OF_RESOURCES;
+    }
+    Allocated = Limit;
+    Status = BS->AllocatePages(Limit ? AllocateMaxAddress : AllocateAnyPages, Type,
+                               Pages + SlackPages, &Allocated);
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+
+    Aligned = (Allocated + Align - 1) & ~(Align - 1);
+    HeadPages = (UINTN)EFI_SIZE_TO_PAGES(Aligned - Allocated);
+    if (HeadPages != 0) {
+        BS->FreePages(Allocated, HeadPages);
+    }
+    if (SlackPages - HeadPages != 0) {
+        BS->FreePages(Aligned + EFI_PAGES_TO_SIZE(Pages), SlackPages - HeadPages);
+    }
+    *Base = Aligned;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Allocates Pages of LBL_MEMORY_TYPE_CORE for the core image.
+ * The header's preferred base is tried first (AllocateAddress); otherwise any
+ * range ending below max_address is used (AllocateMaxAddress). Alignments above
+ * a page are obtained by over-allocating and returning the unaligned head and
+ * tail to the firmware, so the slack is never kept.
+ * @param Header Core header, or NULL for a flat image (page alignment, any address).
+ */
+static EFI_STATUS LblAllocateCorePages(CONST LBL_CORE_IMAGE_HEADER* Header, UINTN Pages,
+                                       EFI_PHYSICAL_ADDRESS* Base, UINT64* Alignment) {
+    EFI_STATUS Status;
+    UINT64 Align = EFI_PAGE_SIZE;
+    EFI_PHYSICAL_ADDRESS Limit = 0;
+
+    if (Header != NULL) {
+        if (Header->alignment > Align) {
+            Align = Header->alignment;
+        }
+        if (Align > LBL_MAX_LOAD_ALIGNMENT || (Align & (Align - 1)) != 0) {
+            LBL_LOG_ERROR(L"Error: Core header alignment 0x%lx is not a power of two up to 1 GiB.\n", Align);
+            return EFI_INVALID_PARAMETER;
+        }
+        if (Header->preferred_base != 0) {
+            *Base = Header->preferred_base;
+            if ((*Base & (Align - 1)) == 0) {
+                Status = BS->AllocatePages(AllocateAddress, LBL_MEMORY_TYPE_CORE, Pages, Base);
+                if (!EFI_ERROR(Status)) {
+                    *Alignment = Align;
+                    return EFI_SUCCESS;
+                }
             }
+            if (Header->flags & LBL_CORE_HEADER_FLAG_FIXED_ADDRESS) {
+                LBL_LOG_ERROR(L"Error: Core requires fixed base 0x%lx, which is unavailable.\n", Header->preferred_base);
+                return EFI_OUT_OF_RESOURCES;
+            }
+            LBL_LOG_DEBUG(L"  Preferred core base 0x%lx unavailable, relocating.\n", Header->preferred_base);
         }
+        Limit = Header->max_address;
     }
 
-    Print(L"Error: LBL Core file '%s' not found on any accessible filesystem.\n", LBL_CORE_BIN_PATH);
-    BS->FreePool(HandleBuffer);
-    return EFI_NOT_FOUND;
+    Status = LblAllocateAlignedPages(LBL_MEMORY_TYPE_CORE, Limit, Pages, Align, Base);
+    if (!EFI_ERROR(Status)) {
+        *Alignment = Align;
+    }
+    return Status;
+}
+
+// Raw read of the core that is still in flight when LblLoadCoreImage returns.
+// Only one core is ever loaded, so a single file-scope slot is enough.
+typedef struct {
+    BOOLEAN Active;
+    EFI_HANDLE Device;                 // Volume the core is being read from
+    LBL_EXTENT_MAP_HEADER* Map;        // Kept alive until the read is reaped
+    LBL_UEFI_ASYNC_EXTENT_READ Read;
+} LBL_CORE_PENDING_READ;
+
+static LBL_CORE_PENDING_READ LblCorePending;
+
+// The A/B slot state for this boot, published by LblPublishCoreSlot.
+static LBL_CORE_SLOT_STATE LblCoreSlotState;
+static UINT32 LblCoreSlotOrder[LBL_CORE_SLOT_COUNT];    // Order slots are tried in
+static UINT32 LblCoreSlotFailures[LBL_CORE_SLOT_COUNT]; // LBL_CORE_FAILURE_*
+static UINT32 LblCoreSlotFlags;                         // LBL_CORE_SLOT_FLAG_*
+static UINT32 LblCoreSlotsExcluded;                     // Bit per slot given up on for this boot
+
+// Leading bytes of an ELF/PE core: every header lbl_image_parse() looks at.
+static UINT8 LblCoreHeaders[LBL_IMAGE_HEADERS_MAX];
+
+// Files read by LblPreloadModules, published by LblPublishModules.
+static LBL_MODULE_ENTRY LblModules[LBL_PRELOAD_MAX_MODULES];
+static UINT32 LblModuleCount;
+static UINT32 LblModulesSkipped;
+
+/**
+ * @brief Releases the pages of a loaded core image (no-op if nothing is loaded).
+ */
+static VOID LblFreeCoreImage(LBL_CORE_IMAGE* Core) {
+    if (LblCorePending.Active) {
+        // Never hand pages back with DMA still targeting them.
+        lbl_uefi_wait_extents_async(&LblCorePending.Read);
+        BS->FreePool(LblCorePending.Map);
+        LblCorePending.Active = FALSE;
+    }
+    if (Core->pages != 0) {
+        BS->FreePages(Core->load_addr, Core->pages);
+    }
+    if (Core->manifest != NULL) {
+        BS->FreePool(Core->manifest);
+    }
+    LblFreePreloadedModules(); // Read in the same session as the core, dropped with it
+    BS->SetMem(Core, sizeof(LBL_CORE_IMAGE), 0);
+}
+
+/**
+ * @brief Releases the pages of every preloaded file (no-op if there are none).
+ */
+static VOID LblFreePreloadedModules(VOID) {
+    UINT32 Index;
+
+    for (Index = 0; Index < LblModuleCount; Index++) {
+        if (LblModules[Index].address != 0) {
+            BS->FreePages(LblModules[Index].address, (UINTN)EFI_SIZE_TO_PAGES(LblModules[Index].size));
+        }
+    }
+    BS->SetMem(LblModules, sizeof(LblModules), 0);
+    LblModuleCount = 0;
+    LblModulesSkipped = 0;
 }
 
 /**
- * @brief Gathers system information and prepares the LBL_BOOT_INFO struct.
+ * @brief Raw fast path: reads the whole core via its extent map, bypassing the
+ * firmware FAT driver. With EFI_DISK_IO2_PROTOCOL the runs are only submitted
+ * here and reaped later by LblCompleteCoreLoad, so the DMA overlaps the boot-info
+ * gathering; otherwise they are read synchronously. Any failure (no sidecar,
+ * stale map, CRC mismatch) just means the caller streams the file through
+ * SimpleFileSystem instead. With a manifest the map's file CRC is not checked:
+ * the SHA-256 pass over the same bytes is checked against the manifest instead.
  */
-EFI_STATUS PrepareBootInfoForCore(LBL_BOOT_INFO* BootInfoStructure, VOID* CoreBuffer, UINTN CoreSize) {
+static EFI_STATUS LblReadCoreViaExtentMap(EFI_HANDLE Device, EFI_FILE_PROTOCOL* Root, UINT32 Slot,
+                                          UINT64 FileSize, VOID* Dest, BOOLEAN CheckCrc) {
     EFI_STATUS Status;
-    EFI_GRAPHICS_OUTPUT_PROTOCOL *Gop = NULL;
+    LBL_EXTENT_MAP_HEADER* Map = NULL;
 
-    if (!BootInfoStructure) return EFI_INVALID_PARAMETER;
+    if (LblIsNetworkVolume(Root)) {
+        return EFI_UNSUPPORTED; // No blocks to read raw
+    }
+    Status = lbl_uefi_load_extent_map(Root, LblCoreSlotPaths[Slot].ExtentMap, FileSize, &Map);
+    if (EFI_ERROR(Status)) {
+        if (Status != EFI_NOT_FOUND) {
+            LBL_LOG_WARN(L"  Core extent map rejected (Status: %r), using filesystem path.\n", Status);
+        }
+        return Status;
+    }
 
-    // Zero out the structure first
-    BS->SetMem(BootInfoStructure, sizeof(LBL_BOOT_INFO), 0);
+    Status = lbl_uefi_read_extents_async(Device, Map, Dest, CheckCrc, &LblCorePending.Read);
+    if (!EFI_ERROR(Status)) {
+        LblCorePending.Active = TRUE;
+        LblCorePending.Device = Device;
+        LblCorePending.Map = Map;
+        LBL_LOG_DEBUG(L"  LBL Core read started via Disk I/O 2 (%u run(s)).\n", Map->extent_count);
+        return EFI_SUCCESS;
+    }
+
+    Status = lbl_uefi_read_extents(Device, Map, Dest, CheckCrc);
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_WARN(L"  Raw extent read failed (Status: %r), using filesystem path.\n", Status);
+    } else {
+        LBL_LOG_DEBUG(L"  LBL Core read via extent map (%u run(s)).\n", Map->extent_count);
+    }
+    BS->FreePool(Map);
+    return Status;
+}
 
-    BootInfoStructure->magic = LBL_BOOT_INFO_MAGIC_VALUE; // From LblUefi.h
-    BootInfoStructure->version = LBL_BOOT_INFO_VERSION;   // From LblUefi.h
+/**
+ * @brief Reads and validates the manifest of a slot into Core->manifest.
+ * @return EFI_NOT_FOUND if there is no manifest, EFI_SECURITY_VIOLATION if it is malformed.
+ */
+static EFI_STATUS LblLoadCoreManifest(EFI_FILE_PROTOCOL* Root, UINT32 Slot, LBL_CORE_IMAGE* Core) {
+    EFI_STATUS Status;
+    EFI_FILE_PROTOCOL* File = NULL;
+    LBL_CORE_MANIFEST_HEADER* Manifest = NULL;
+    UINT64 Size = 0;
+    UINTN ReadSize;
 
-    // Store Core Engine load info
-    BootInfoStructure->core_load_addr = (UINT64)CoreBuffer;
-    BootInfoStructure->core_size = CoreSize;
-    BootInfoStructure->core_entry_offset = LBL_CORE_ENTRY_OFFSET; // From LblUefi.h
+    Status = lbl_uefi_open_file_in_volume(Root, LblCoreSlotPaths[Slot].Manifest, &File, &Size);
+    if (EFI_ERROR(Status)) {
+        return EFI_NOT_FOUND;
+    }
+    if (Size < sizeof(LBL_CORE_MANIFEST_HEADER) || Size > LBL_CORE_MANIFEST_MAX_SIZE) {
+        File->Close(File);
+        return EFI_SECURITY_VIOLATION;
+    }
+    ReadSize = (UINTN)Size;
+    Status = BS->AllocatePool(EfiLoaderData, ReadSize, (VOID**)&Manifest);
+    if (!EFI_ERROR(Status)) {
+        Status = File->Read(File, &ReadSize, Manifest);
+    }
+    File->Close(File);
+    if (EFI_ERROR(Status) || ReadSize != (UINTN)Size) {
+        if (Manifest) BS->FreePool(Manifest);
+        return EFI_ERROR(Status) ? Status : EFI_DEVICE_ERROR;
+    }
+    if (Manifest->magic != LBL_CORE_MANIFEST_MAGIC ||
+        Manifest->header_size < sizeof(LBL_CORE_MANIFEST_HEADER) ||
+        (UINT64)Manifest->header_size + Manifest->signature_size != Size) {
+        BS->FreePool(Manifest);
+        return EFI_SECURITY_VIOLATION;
+    }
+    Core->manifest = Manifest;
+    Core->manifest_size = ReadSize;
+    return EFI_SUCCESS;
+}
 
-    // 1. Get Memory Map
-    //    The actual memory map buffer will be pointed to by BootInfoStructure->memory_map_buffer
-    Status = lbl_uefi_get_memory_map(
-        &BootInfoStructure->memory_map_buffer,
-        &BootInfoStructure->memory_map_size,
-        &BootInfoStructure->memory_map_key,
-        &BootInfoStructure->memory_descriptor_size,
-        &BootInfoStructure->memory_descriptor_version
-    );
-    if (EFI_ERROR(Status)) {
-        Print(L"Error: Failed to get UEFI Memory Map. Status: %r\n", Status);
+/**
+ * @brief Finishes the core digest and checks it against the manifest, if there is one.
+ * @return EFI_SECURITY_VIOLATION if the core does not match its manifest.
+ */
+static EFI_STATUS LblCheckCoreDigest(LBL_CORE_IMAGE* Core, LBL_SHA256_CTX* Sha, UINT64 FileSize) {
+    lbl_sha256_final(Sha, Core->sha256);
+    Core->verify_flags = LBL_CORE_VERIFY_DIGEST;
+    if (lbl_sha256_accelerated()) {
+        Core->verify_flags |= LBL_CORE_VERIFY_ACCELERATED;
+    }
+    if (Core->manifest == NULL) {
+        return EFI_SUCCESS;
+    }
+    if (Core->manifest->core_file_size != FileSize ||
+        CompareMem(Core->manifest->core_sha256, Core->sha256, LBL_CORE_DIGEST_SIZE) != 0) {
+        LBL_LOG_ERROR(L"Error: LBL Core does not match its manifest.\n");
+        return EFI_SECURITY_VIOLATION;
+    }
+    Core->verify_flags |= LBL_CORE_VERIFY_MANIFEST_MATCH;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief LBL_UEFI_CHUNK_CONSUMER that hashes each chunk while the next one is read.
+ */
+static EFI_STATUS LblHashChunkConsumer(VOID* Context, UINT64 Offset, CONST VOID* Chunk, UINTN Length) {
+    (VOID)Offset; // Chunks arrive in file order
+    lbl_sha256_update((LBL_SHA256_CTX*)Context, Chunk, Length);
+    return EFI_SUCCESS;
+}
+
+// Decoder state for a compressed core, fed chunk by chunk by the streaming reader.
+typedef struct {
+    LBL_LZ4_STREAM Lz4;
+    LBL_SHA256_CTX* Sha;            // Digest of the container bytes, as on disk
+    UINT64 BlocksOffset;            // File offset of the first block (header_size)
+    UINT64 Ticks;                   // Cycle-counter ticks spent decoding
+} LBL_CORE_LZ4_CONTEXT;
+
+/**
+ * @brief Sanity-checks an LZ4 container header against the file it came from.
+ */
+static BOOLEAN LblLz4HeaderIsValid(CONST LBL_CORE_LZ4_HEADER* Lz4, UINT64 FileSize) {
+    if (Lz4->header_size < LBL_CORE_LZ4_HEADER_MIN_SIZE || Lz4->header_size > FileSize ||
+        Lz4->compressed_size != FileSize - Lz4->header_size) {
+        return FALSE;
+    }
+    if (Lz4->uncompressed_size == 0 || Lz4->block_max_size == 0 ||
+        Lz4->block_max_size > LBL_CORE_LZ4_MAX_BLOCK) {
+        return FALSE;
+    }
+    if (Lz4->image.magic == LBL_CORE_HEADER_MAGIC) {
+        return LblCoreHeaderIsValid(&Lz4->image, Lz4->uncompressed_size);
+    }
+    return Lz4->image.magic == 0;
+}
+
+/**
+ * @brief LBL_UEFI_CHUNK_CONSUMER that hashes each chunk and decodes the container's
+ * block stream into the final pages, while the next chunk is being read (when
+ * ReadEx is available). Bytes before the first block are hashed only.
+ */
+static EFI_STATUS LblLz4ChunkConsumer(VOID* Context, UINT64 Offset, CONST VOID* Chunk, UINTN Length) {
+    LBL_CORE_LZ4_CONTEXT* Lz4Context = (LBL_CORE_LZ4_CONTEXT*)Context;
+    CONST UINT8* Data = (CONST UINT8*)Chunk;
+    UINT64 Start;
+    int Result;
+
+    lbl_sha256_update(Lz4Context->Sha, Chunk, Length);
+    if (Offset < Lz4Context->BlocksOffset) {
+        UINT64 Skip = Lz4Context->BlocksOffset - Offset;
+        if (Skip >= Length) {
+            return EFI_SUCCESS;
+        }
+        Data += Skip;
+        Length -= (UINTN)Skip;
+    }
+
+    Start = lbl_read_cycle_counter();
+    Result = lbl_lz4_stream_update(&Lz4Context->Lz4, Data, Length);
+    Lz4Context->Ticks += lbl_read_cycle_counter() - Start;
+    return Result == 0 ? EFI_SUCCESS : EFI_LOAD_ERROR;
+}
+
+/**
+ * @brief Streams the rest of an LZ4 container from StartOffset (the current file
+ * position, within the header) and decodes it into Dest.
+ */
+static EFI_STATUS LblLoadCompressedCore(EFI_FILE_PROTOCOL* File, CONST LBL_CORE_LZ4_HEADER* Lz4,
+                                        UINT64 StartOffset, UINT8* Dest, LBL_SHA256_CTX* Sha,
+                                        UINT64* Ticks) {
+    EFI_STATUS Status;
+    LBL_CORE_LZ4_CONTEXT Context;
+    LBL_UEFI_STREAM Stream;
+    UINT64 FileSize = Lz4->header_size + Lz4->compressed_size;
+    UINTN StageSize = 4 + LBL_LZ4_COMPRESS_BOUND((UINTN)Lz4->block_max_size);
+    UINT8* Stage = NULL;
+
+    Status = BS->AllocatePool(EfiLoaderData, StageSize, (VOID**)&Stage);
+    if (EFI_ERROR(Status)) {
         return Status;
     }
 
-    // 2. Get Graphics/Framebuffer Information
-    Status = BS->LocateProtocol(&gEfiGraphicsOutputProtocolGuid, NULL, (VOID **)&Gop);
-    if (!EFI_ERROR(Status) && Gop != NULL && Gop->Mode != NULL && Gop->Mode->Info != NULL && Gop->Mode->FrameBufferBase != 0) {
-        BootInfoStructure->framebuffer_addr = Gop->Mode->FrameBufferBase;
-        BootInfoStructure->framebuffer_size = Gop->Mode->FrameBufferSize;
-        BootInfoStructure->framebuffer_width = Gop->Mode->Info->HorizontalResolution;
-        BootInfoStructure->framebuffer_height = Gop->Mode->Info->VerticalResolution;
-        BootInfoStructure->framebuffer_pitch = Gop->Mode->Info->PixelsPerScanLine * 4; // Assuming 4 bytes/pixel (BGRA32)
-                                                                                      // This pitch calculation needs to be accurate based on PixelFormat.
-        BootInfoStructure->framebuffer_bpp = 32; // Assuming 32bpp BGRA8888, common for GOP.
-                                                 // Real BPP should come from Gop->Mode->Info->PixelFormat
-
-        // A more robust way to get BPP and correct pitch:
-        switch (Gop->Mode->Info->PixelFormat) {
-            case PixelRedGreenBlueReserved8BitPerColor: // RGBR
-            case PixelBlueGreenRedReserved8BitPerColor: // BGRR
-                BootInfoStructure->framebuffer_bpp = 32;
-                BootInfoStructure->framebuffer_pitch = Gop->Mode->Info->PixelsPerScanLine * 4;
-                break;
-            // case PixelBitMask: // Requires parsing PixelInformation
-            // case PixelBltOnly: // No direct framebuffer access
-            default: // Minimal assumption
-                BootInfoStructure->framebuffer_bpp = 32; // Fallback assumption
-                BootInfoStructure->framebuffer_pitch = Gop->Mode->Info->PixelsPerScanLine * 4;
-                break;
+    BS->SetMem(&Context, sizeof(Context), 0);
+    lbl_lz4_stream_init(&Context.Lz4, Dest, (lbl_usize)Lz4->uncompressed_size, Stage, StageSize);
+    Context.Sha = Sha;
+    Context.BlocksOffset = Lz4->header_size;
+
+    // No destination: chunks go through the reader's bounce buffers and only the
+    // decoded bytes are written to the final pages.
+    BS->SetMem(&Stream, sizeof(Stream), 0);
+    Stream.chunk_size = LBL_CORE_READ_CHUNK_SIZE;
+    Stream.consumer = LblLz4ChunkConsumer;
+    Stream.consumer_context = &Context;
+    Status = lbl_uefi_stream_file(File, StartOffset, FileSize - StartOffset, &Stream);
+    if (!EFI_ERROR(Status) && lbl_lz4_stream_finish(&Context.Lz4) != 0) {
+        Status = EFI_LOAD_ERROR; // Truncated stream or size mismatch
+    }
+    BS->FreePool(Stage);
+
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_ERROR(L"Error: LBL Core decompression failed. Status: %r\n", Status);
+        return Status;
+    }
+    LBL_LOG_DEBUG(L"  LBL Core decompressed: %lu -> %lu bytes.\n", Lz4->compressed_size, Lz4->uncompressed_size);
+    *Ticks = Context.Ticks;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Expresses an ELF/PE layout as the equivalent core header, so placement
+ * goes through the same LblAllocateCorePages policy as a flat image with a header.
+ * Only a relocatable image may be moved off its preferred base.
+ */
+static VOID LblCoreHeaderFromLayout(CONST LBL_IMAGE_LAYOUT* Layout, LBL_CORE_IMAGE_HEADER* Header) {
+    BS->SetMem(Header, sizeof(LBL_CORE_IMAGE_HEADER), 0);
+    Header->magic = LBL_CORE_HEADER_MAGIC;
+    Header->header_size = sizeof(LBL_CORE_IMAGE_HEADER);
+    Header->flags = Layout->relocatable ? 0 : LBL_CORE_HEADER_FLAG_FIXED_ADDRESS;
+    Header->preferred_base = Layout->preferred_base;
+    Header->alignment = Layout->alignment;
+    Header->entry_offset = Layout->entry_offset;
+    Header->memory_size = Layout->memory_size;
+}
+
+/**
+ * @brief Reads [Offset, Offset + Length) of the core, the current file position,
+ * into Destination (or only through the digest if it is NULL).
+ */
+static EFI_STATUS LblStreamCoreRange(EFI_FILE_PROTOCOL* File, UINT64 Offset, UINT64 Length,
+                                     UINT8* Destination, LBL_SHA256_CTX* Sha) {
+    LBL_UEFI_STREAM Stream;
+
+    BS->SetMem(&Stream, sizeof(Stream), 0);
+    Stream.chunk_size = LBL_CORE_READ_CHUNK_SIZE;
+    Stream.destination = Destination;
+    Stream.destination_size = Destination ? Length : 0;
+    Stream.consumer = LblHashChunkConsumer;
+    Stream.consumer_context = Sha;
+    return lbl_uefi_stream_file(File, Offset, Length, &Stream);
+}
+
+/**
+ * @brief Reads an ELF/PE core segment by segment into its final pages. File data
+ * goes straight to each segment's address; .bss and the gaps between segments are
+ * zeroed in memory instead of being read. Bytes no segment loads (file padding,
+ * section headers) still pass through the digest, so core_sha256 remains the
+ * digest of lbl_core.bin as stored; strip the core to keep them few.
+ * @param File Positioned at HeadersSize; LblCoreHeaders holds the bytes before it.
+ */
+static EFI_STATUS LblReadCoreSegments(EFI_FILE_PROTOCOL* File, CONST LBL_IMAGE_LAYOUT* Layout,
+                                      UINTN HeadersSize, UINT64 FileSize, UINT8* Dest, LBL_SHA256_CTX* Sha) {
+    EFI_STATUS Status = EFI_SUCCESS;
+    UINT64 Position = HeadersSize;  // File position
+    UINT64 Initialized = 0;         // Dest is written up to this offset
+    UINT32 Index;
+
+    for (Index = 0; Index < Layout->segment_count; Index++) {
+        CONST LBL_IMAGE_SEGMENT* Segment = &Layout->segments[Index];
+        UINT64 Offset = Segment->file_offset;
+        UINT64 End = Segment->file_offset + Segment->file_size;
+        UINT8* Target = Dest + Segment->mem_offset;
+
+        if (Segment->mem_offset > Initialized) {
+            BS->SetMem(Dest + Initialized, (UINTN)(Segment->mem_offset - Initialized), 0);
         }
-    } else {
-        Print(L"Warning: Graphics Output Protocol not found or invalid. Framebuffer info unavailable. Status: %r\n", Status);
-        // Core will have to manage without direct framebuffer from Stage1 or use basic VGA if available
-        BootInfoStructure->framebuffer_addr = 0; // Indicate no framebuffer
+        // The first segment usually starts with the headers, which are already here.
+        if (Segment->file_size != 0 && Offset < HeadersSize) {
+            UINT64 Take = (End < HeadersSize ? End : HeadersSize) - Offset;
+            BS->CopyMem(Target, LblCoreHeaders + Offset, (UINTN)Take);
+            Target += Take;
+            Offset += Take;
+        }
+        if (Offset < End) {
+            if (Position < Offset) {
+                Status = LblStreamCoreRange(File, Position, Offset - Position, NULL, Sha);
+                if (EFI_ERROR(Status)) {
+                    return Status;
+                }
+            }
+            Status = LblStreamCoreRange(File, Offset, End - Offset, Target, Sha);
+            if (EFI_ERROR(Status)) {
+                return Status;
+            }
+            Position = End;
+        }
+        if (Segment->mem_size > Segment->file_size) {
+            BS->SetMem(Dest + Segment->mem_offset + Segment->file_size,
+                       (UINTN)(Segment->mem_size - Segment->file_size), 0);
+        }
+        Initialized = Segment->mem_offset + Segment->mem_size;
+    }
+    if (Layout->memory_size > Initialized) {
+        BS->SetMem(Dest + Initialized, (UINTN)(Layout->memory_size - Initialized), 0);
     }
+    if (Position < FileSize) {
+        Status = LblStreamCoreRange(File, Position, FileSize - Position, NULL, Sha);
+    }
+    return Status;
+}
 
-    // 3. Get ACPI Table Pointer (RSDP)
-    //    ACPI 2.0 table GUID: EFI_ACPI_20_TABLE_GUID
-    //    ACPI 1.0 table GUID: ACPI_TABLE_GUID (older)
-    BootInfoStructure->acpi_rsdp_ptr = 0; // Default to not found
-    for (UINTN i = 0; i < ST->NumberOfTableEntries; i++) {
-        EFI_CONFIGURATION_TABLE *ct = &ST->ConfigurationTable[i];
-        if (CompareGuid(&ct->VendorGuid, &gEfiAcpi20TableGuid) ||  // Check for ACPI 2.0+ table
-            CompareGuid(&ct->VendorGuid, &gAcpiTableGuid)) {       // Check for ACPI 1.0 table (legacy)
-            BootInfoStructure->acpi_rsdp_ptr = (UINT64)ct->VendorTable;
-            Print(L"ACPI RSDP found at 0x%lx\n", BootInfoStructure->acpi_rsdp_ptr);
-            break;
+/**
+ * @brief Finishes a loaded ELF/PE core: takes flags and heap size from an embedded
+ * core header, if any, applies the relocations for load_addr and records the
+ * segments for LblPublishCoreSegments.
+ */
+static EFI_STATUS LblFinishSegmentedCore(LBL_CORE_IMAGE* Core, CONST LBL_IMAGE_LAYOUT* Layout,
+                                         LBL_CORE_IMAGE_HEADER* Header) {
+    UINT8* Image = (UINT8*)(UINTN)Core->load_addr;
+    CONST VOID* Embedded;
+    lbl_usize EmbeddedSize = 0;
+    LBL_CORE_IMAGE_HEADER Note;
+    UINT32 Index;
+
+    Embedded = lbl_image_core_header(Layout, Image, &EmbeddedSize);
+    if (Embedded != NULL && EmbeddedSize >= LBL_CORE_IMAGE_HEADER_MIN_SIZE) {
+        BS->SetMem(&Note, sizeof(Note), 0);
+        BS->CopyMem(&Note, (VOID*)Embedded, EmbeddedSize < sizeof(Note) ? EmbeddedSize : sizeof(Note));
+        if (Note.magic == LBL_CORE_HEADER_MAGIC && Note.header_size <= EmbeddedSize) {
+            // Placement is the program headers' business; FIXED_ADDRESS already followed from them.
+            Header->flags |= Note.flags & ~LBL_CORE_HEADER_FLAG_FIXED_ADDRESS;
+            Header->heap_size = LblCoreHeaderHeapSize(&Note);
+        } else {
+            LBL_LOG_WARN(L"  Embedded LBL Core header is invalid, ignored.\n");
         }
     }
-    if (BootInfoStructure->acpi_rsdp_ptr == 0) {
-        Print(L"Warning: ACPI RSDP pointer not found in EFI Configuration Tables.\n");
+
+    if (lbl_image_relocate(Layout, Image, Core->load_addr) != 0) {
+        LBL_LOG_ERROR(L"Error: LBL Core relocations could not be applied.\n");
+        return EFI_LOAD_ERROR;
     }
-    
-    // 4. Other information (e.g., boot drive, command line if LBL EFI app took one) can be added.
+
+    Core->format = Layout->format;
+    Core->segment_count = Layout->segment_count;
+    for (Index = 0; Index < Layout->segment_count; Index++) {
+        Core->segments[Index].offset = Layout->segments[Index].mem_offset;
+        Core->segments[Index].size = Layout->segments[Index].mem_size;
+        Core->segments[Index].flags = Layout->segments[Index].flags;
+    }
+    LBL_LOG_DEBUG(L"  LBL Core %s image: %u segment(s), %lu bytes in memory, entry +0x%lx.\n",
+                  Layout->format == LBL_IMAGE_FORMAT_ELF64 ? L"ELF64" : L"PE32+",
+                  Layout->segment_count, Layout->memory_size, Layout->entry_offset);
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Streams one manifest entry from Root straight into fresh pages (zeroed
+ * past the end of the file) and appends it to LblModules.
+ */
+static EFI_STATUS LblPreloadModule(EFI_FILE_PROTOCOL* Root, CONST CHAR8* Name, UINTN Length) {
+    EFI_STATUS Status = EFI_SUCCESS;
+    EFI_FILE_PROTOCOL* File = NULL;
+    LBL_MODULE_ENTRY* Module = &LblModules[LblModuleCount];
+    CHAR16 Path[LBL_MODULE_NAME_MAX];
+    EFI_PHYSICAL_ADDRESS Address = 0;
+    UINT64 Size = 0;
+    UINTN Pages, Index;
+    LBL_UEFI_STREAM Stream;
+
+    for (Index = 0; Index < Length; Index++) {
+        Path[Index] = (Name[Index] == '/') ? L'\\' : (CHAR16)Name[Index];
+    }
+    Path[Length] = 0;
+
+    Status = lbl_uefi_open_file_in_volume(Root, Path, &File, &Size);
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_WARN(L"  Could not preload %s (Status: %r).\n", Path, Status);
+        return Status;
+    }
+    Pages = (UINTN)EFI_SIZE_TO_PAGES(Size);
+    if (Pages != 0) {
+        Status = BS->AllocatePages(AllocateAnyPages, EfiLoaderData, Pages, &Address);
+        if (!EFI_ERROR(Status)) {
+            BS->SetMem(&Stream, sizeof(Stream), 0);
+            Stream.chunk_size = LBL_CORE_READ_CHUNK_SIZE;
+            Stream.destination = (VOID*)(UINTN)Address;
+            Stream.destination_size = Size;
+            Status = lbl_uefi_stream_file(File, 0, Size, &Stream);
+            if (EFI_ERROR(Status)) {
+                BS->FreePages(Address, Pages);
+            }
+        }
+    }
+    File->Close(File);
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_WARN(L"  Could not preload %s (Status: %r).\n", Path, Status);
+        return Status;
+    }
+    if (Pages != 0) {
+        BS->SetMem((UINT8*)(UINTN)Address + Size, (UINTN)((UINT64)Pages * EFI_PAGE_SIZE - Size), 0);
+    }
+
+    Module->address = Address;
+    Module->size = Size;
+    Module->name_length = (UINT32)Length;
+    BS->CopyMem(Module->name, (VOID*)Name, Length);
+    Module->name[Length] = 0;
+    LblModuleCount++;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Preloads the files listed in LBL_PRELOAD_MANIFEST_PATH through Root, the
+ * volume the core was just read from, so there is one OpenVolume for all of them.
+ * A missing manifest is normal. Entries that cannot be loaded are skipped and
+ * counted; the core reads those through its own filesystem driver.
+ */
+static VOID LblPreloadModules(EFI_FILE_PROTOCOL* Root) {
+    EFI_STATUS Status;
+    EFI_FILE_PROTOCOL* File = NULL;
+    CHAR8* Text = NULL;
+    UINT64 Size = 0;
+    UINTN ReadSize, Start, End, First, Last;
+
+    Status = lbl_uefi_open_file_in_volume(Root, LBL_PRELOAD_MANIFEST_PATH, &File, &Size);
+    if (EFI_ERROR(Status)) {
+        return;
+    }
+    if (Size == 0 || Size > LBL_PRELOAD_MANIFEST_MAX_SIZE) {
+        LBL_LOG_WARN(L"  Preload manifest ignored (%lu bytes).\n", Size);
+        lbl_uefi_close_file(NULL, File);
+        return;
+    }
+    ReadSize = (UINTN)Size;
+    Status = BS->AllocatePool(EfiLoaderData, ReadSize, (VOID**)&Text);
+    if (!EFI_ERROR(Status)) {
+        Status = File->Read(File, &ReadSize, Text);
+    }
+    lbl_uefi_close_file(NULL, File);
+    if (EFI_ERROR(Status) || ReadSize != (UINTN)Size) {
+        LBL_LOG_WARN(L"  Preload manifest unreadable (Status: %r).\n", Status);
+        if (Text) {
+            BS->FreePool(Text);
+        }
+        return;
+    }
+
+    for (Start = 0; Start < ReadSize; Start = End + 1) {
+        End = Start;
+        while (End < ReadSize && Text[End] != '\n') {
+            End++;
+        }
+        First = Start;
+        Last = End;
+        while (First < Last && (Text[First] == ' ' || Text[First] == '\t')) {
+            First++;
+        }
+        while (Last > First && (Text[Last - 1] == ' ' || Text[Last - 1] == '\t' || Text[Last - 1] == '\r')) {
+            Last--;
+        }
+        if (First == Last || Text[First] == '#') {
+            continue;
+        }
+        if (Last - First >= LBL_MODULE_NAME_MAX || LblModuleCount == LBL_PRELOAD_MAX_MODULES) {
+            LBL_LOG_WARN(L"  Preload manifest entry at byte %u skipped (too long or too many).\n", First);
+            LblModulesSkipped++;
+            continue;
+        }
+        if (EFI_ERROR(LblPreloadModule(Root, &Text[First], Last - First))) {
+            LblModulesSkipped++;
+        }
+    }
+    BS->FreePool(Text);
+    LblTimelineMark(LBL_TL_MODULES_LOADED, LblModuleCount);
+    LBL_LOG_DEBUG(L"  Preloaded %u file(s), %u skipped.\n", LblModuleCount, LblModulesSkipped);
+}
+
+/**
+ * @brief Loads the core of one slot from Device directly into its final pages.
+ * The first bytes are read once to look for an LBL_CORE_LZ4_HEADER or an
+ * LBL_CORE_IMAGE_HEADER. A compressed container is decoded block by block into
+ * the pages as it is streamed. An ELF64 / PE32+ image is read segment by segment
+ * to the addresses its headers give, then relocated. A plain image has the probed
+ * bytes copied into place, and the rest of the file is streamed sequentially, in
+ * LBL_CORE_READ_CHUNK_SIZE reads, with no further copies.
+ * On failure nothing stays allocated and *Core is zeroed.
+ */
+static EFI_STATUS LblLoadCoreImage(EFI_HANDLE Device, UINT32 Slot, LBL_CORE_IMAGE* Core) {
+    EFI_STATUS Status;
+    EFI_FILE_PROTOCOL* Root = NULL;
+    EFI_FILE_PROTOCOL* File = NULL;
+    union {
+        LBL_CORE_IMAGE_HEADER Image;
+        LBL_CORE_LZ4_HEADER Lz4;
+    } Probe;
+    LBL_CORE_IMAGE_HEADER Header;
+    LBL_IMAGE_LAYOUT Layout;
+    BOOLEAN HasHeader = FALSE;
+    BOOLEAN Compressed = FALSE;
+    BOOLEAN Segmented = FALSE;
+    UINT64 FileSize = 0;
+    UINT64 ImageSize;
+    UINT64 MemorySize;
+    UINTN Probed, ProbeSize;
+    LBL_UEFI_STREAM Stream;
+    LBL_SHA256_CTX Sha;
+    UINT8* Dest;
+
+    BS->SetMem(Core, sizeof(LBL_CORE_IMAGE), 0);
+
+    Status = LblOpenCoreVolume(Device, &Root);
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+    Status = lbl_uefi_open_file_in_volume(Root, LblCoreSlotPaths[Slot].Core, &File, &FileSize);
+    if (EFI_ERROR(Status)) {
+        Root->Close(Root);
+        return Status;
+    }
+    if (FileSize == 0) {
+        lbl_uefi_close_file(Root, File);
+        return EFI_LOAD_ERROR;
+    }
+    LblTimelineMark(LBL_TL_FS_LOCATED, 0);
+
+    ProbeSize = FileSize < sizeof(Probe) ? (UINTN)FileSize : sizeof(Probe);
+    Probed = ProbeSize;
+    Status = File->Read(File, &Probed, &Probe);
+    if (EFI_ERROR(Status) || Probed != ProbeSize) {
+        lbl_uefi_close_file(Root, File);
+        return EFI_ERROR(Status) ? Status : EFI_DEVICE_ERROR;
+    }
+    // The digest covers the file as stored, so it starts with the probed bytes.
+    lbl_sha256_init(&Sha);
+    lbl_sha256_update(&Sha, &Probe, Probed);
+
+    ImageSize = FileSize;
+    if (Probed >= sizeof(Probe.Lz4) && Probe.Lz4.magic == LBL_CORE_LZ4_MAGIC) {
+        if (!LblLz4HeaderIsValid(&Probe.Lz4, FileSize)) {
+            LBL_LOG_ERROR(L"Error: LBL Core container header is invalid.\n");
+            lbl_uefi_close_file(Root, File);
+            return EFI_LOAD_ERROR;
+        }
+        Compressed = TRUE;
+        ImageSize = Probe.Lz4.uncompressed_size;
+        Header = Probe.Lz4.image;
+        HasHeader = (Header.magic == LBL_CORE_HEADER_MAGIC);
+    } else if (Probed >= sizeof(Probe.Image) && Probe.Image.magic == LBL_CORE_HEADER_MAGIC) {
+        Header = Probe.Image;
+        HasHeader = TRUE;
+        if (!LblCoreHeaderIsValid(&Header, FileSize)) {
+            LBL_LOG_ERROR(L"Error: LBL Core header is invalid.\n");
+            lbl_uefi_close_file(Root, File);
+            return EFI_LOAD_ERROR;
+        }
+    } else if (lbl_image_detect(&Probe, Probed) != LBL_IMAGE_FORMAT_NONE) {
+        // ELF/PE: read the rest of the headers, then lay the segments out from them.
+        UINTN HeadersSize = FileSize < LBL_IMAGE_HEADERS_MAX ? (UINTN)FileSize : LBL_IMAGE_HEADERS_MAX;
+        UINTN Rest = HeadersSize - Probed;
+
+        BS->CopyMem(LblCoreHeaders, &Probe, Probed);
+        Status = File->Read(File, &Rest, LblCoreHeaders + Probed);
+        if (EFI_ERROR(Status) || Rest != HeadersSize - Probed) {
+            lbl_uefi_close_file(Root, File);
+            return EFI_ERROR(Status) ? Status : EFI_DEVICE_ERROR;
+        }
+        lbl_sha256_update(&Sha, LblCoreHeaders + Probed, Rest);
+        Probed = HeadersSize;
+        if (lbl_image_parse(LblCoreHeaders, HeadersSize, FileSize, &Layout) != 0) {
+            LBL_LOG_ERROR(L"Error: LBL Core ELF/PE image is invalid or not built for this CPU.\n");
+            lbl_uefi_close_file(Root, File);
+            return EFI_LOAD_ERROR;
+        }
+        LblCoreHeaderFromLayout(&Layout, &Header);
+        HasHeader = TRUE;
+        Segmented = TRUE;
+        ImageSize = Layout.memory_size; // Already zero-filled by LblReadCoreSegments
+    }
+
+    MemorySize = (HasHeader && Header.memory_size != 0) ? Header.memory_size : ImageSize;
+    Core->pages = (UINTN)EFI_SIZE_TO_PAGES(MemorySize);
+    Status = LblAllocateCorePages(HasHeader ? &Header : NULL, Core->pages, &Core->load_addr, &Core->alignment);
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_ERROR(L"Error: Could not allocate %u pages for LBL Core. Status: %r\n", Core->pages, Status);
+        Core->pages = 0;
+        lbl_uefi_close_file(Root, File);
+        return Status;
+    }
+
+    Dest = (UINT8*)(UINTN)Core->load_addr;
+
+    Status = LblLoadCoreManifest(Root, Slot, Core);
+    if (EFI_ERROR(Status) && Status != EFI_NOT_FOUND) {
+        LBL_LOG_ERROR(L"Error: LBL Core manifest is invalid. Status: %r\n", Status);
+        lbl_uefi_close_file(Root, File);
+        LblFreeCoreImage(Core);
+        return Status;
+    }
+
+    LblTimelineMark(LBL_TL_CORE_READ_START, 0);
+    if (Compressed) {
+        Status = LblLoadCompressedCore(File, &Probe.Lz4, Probed, Dest, &Sha, &Core->decompress_ticks);
+        Core->compressed_size = FileSize;
+    } else if (Segmented) {
+        // File and memory layouts differ, so the extent map (a raw file image) does not apply.
+        Status = LblReadCoreSegments(File, &Layout, Probed, FileSize, Dest, &Sha);
+    } else {
+        // Prefer a few large raw reads through the extent map. The SimpleFileSystem
+        // file position is untouched by this, so falling back just continues below.
+        Status = LblReadCoreViaExtentMap(Device, Root, Slot, FileSize, Dest, Core->manifest == NULL);
+        if (!EFI_ERROR(Status) && !LblCorePending.Active) {
+            lbl_sha256_update(&Sha, Dest + Probed, (UINTN)(FileSize - Probed));
+        } else if (EFI_ERROR(Status)) {
+            BS->CopyMem(Dest, &Probe, Probed);
+
+            // Chunked reads straight into the final pages, hashing chunk N while
+            // chunk N+1 is in flight.
+            BS->SetMem(&Stream, sizeof(Stream), 0);
+            Stream.chunk_size = LBL_CORE_READ_CHUNK_SIZE;
+            Stream.destination = Dest + Probed;
+            Stream.destination_size = FileSize - Probed;
+            Stream.consumer = LblHashChunkConsumer;
+            Stream.consumer_context = &Sha;
+            Status = lbl_uefi_stream_file(File, Probed, FileSize - Probed, &Stream);
+        }
+    }
+    // Same volume session as the core; an extent read, if any, proceeds meanwhile.
+    if (!EFI_ERROR(Status)) {
+        LblPreloadModules(Root);
+    }
+    lbl_uefi_close_file(Root, File);
+    // An asynchronous read is hashed and checked once it completes (LblCompleteCoreLoad).
+    if (!EFI_ERROR(Status) && !LblCorePending.Active) {
+        LblTimelineMark(LBL_TL_CORE_READ_END, 0);
+        Status = LblCheckCoreDigest(Core, &Sha, FileSize);
+    }
+    if (!EFI_ERROR(Status) && Segmented) {
+        Status = LblFinishSegmentedCore(Core, &Layout, &Header);
+    }
+    if (EFI_ERROR(Status)) {
+        LblFreeCoreImage(Core);
+        return Status;
+    }
+    if (MemorySize > ImageSize) {
+        BS->SetMem(Dest + ImageSize, (UINTN)(MemorySize - ImageSize), 0);
+    }
+
+    Core->file_size = ImageSize;
+    Core->entry_offset = HasHeader ? Header.entry_offset : LBL_CORE_ENTRY_OFFSET;
+    Core->heap_size = HasHeader ? LblCoreHeaderHeapSize(&Header) : 0;
+    Core->header_flags = HasHeader ? Header.flags : 0;
+    Core->slot = Slot;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Waits for an asynchronous core read started by LblLoadCoreImage, if any,
+ * then hashes the image and checks it against the manifest.
+ * A failed or corrupt raw read is repaired by streaming the whole file through
+ * SimpleFileSystem into the same pages. No-op when the core was read synchronously.
+ */
+static EFI_STATUS LblCompleteCoreLoad(LBL_CORE_IMAGE* Core) {
+    EFI_STATUS Status;
+    EFI_FILE_PROTOCOL* Root = NULL;
+    EFI_FILE_PROTOCOL* File = NULL;
+    UINT64 FileSize = 0;
+    LBL_UEFI_STREAM Stream;
+    LBL_SHA256_CTX Sha;
+
+    if (!LblCorePending.Active) {
+        return EFI_SUCCESS;
+    }
+    Status = lbl_uefi_wait_extents_async(&LblCorePending.Read);
+    LblTimelineMark(LBL_TL_CORE_READ_END, 1);
+    BS->FreePool(LblCorePending.Map);
+    LblCorePending.Active = FALSE;
+    LblCorePending.Map = NULL;
+    lbl_sha256_init(&Sha);
+    if (!EFI_ERROR(Status)) {
+        lbl_sha256_update(&Sha, (VOID*)(UINTN)Core->load_addr, (UINTN)Core->file_size);
+        return LblCheckCoreDigest(Core, &Sha, Core->file_size);
+    }
+
+    LBL_LOG_WARN(L"  Async core read failed (Status: %r), using filesystem path.\n", Status);
+    Status = lbl_uefi_open_file(LblCorePending.Device, LblCoreSlotPaths[Core->slot].Core, &Root, &File, &FileSize);
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+    if (FileSize != Core->file_size) {
+        lbl_uefi_close_file(Root, File);
+        return EFI_MEDIA_CHANGED;
+    }
+    BS->SetMem(&Stream, sizeof(Stream), 0);
+    Stream.chunk_size = LBL_CORE_READ_CHUNK_SIZE;
+    Stream.destination = (VOID*)(UINTN)Core->load_addr;
+    Stream.destination_size = FileSize;
+    Stream.consumer = LblHashChunkConsumer;
+    Stream.consumer_context = &Sha;
+    Status = lbl_uefi_stream_file(File, 0, FileSize, &Stream);
+    lbl_uefi_close_file(Root, File);
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+    return LblCheckCoreDigest(Core, &Sha, FileSize);
+}
+
+// Scan order for the fallback filesystem search. Lower ranks are probed first.
+// Local ESPs are almost always where LBL is installed; removable and network
+// volumes (USB sticks, BMC virtual media, HTTP-boot RAM disks) are tried last
+// because opening them is slow and they rarely hold the core.
+typedef enum {
+    LblFsRankLocalEsp = 0,  // GPT partition tagged as EFI System Partition on fixed media
+    LblFsRankLocalDisk,     // Any other partition on fixed media
+    LblFsRankUnknown,       // No (recognisable) device path
+    LblFsRankRemovable,     // USB, optical, RemovableMedia block devices
+    LblFsRankNetwork,       // MAC/IP/URI device paths
+    LblFsRankCount
+} LBL_FS_RANK;
+
+#ifndef MSG_URI_DP
+#define MSG_URI_DP 0x18     // Not defined by older gnu-efi headers
+#endif
+
+// PartitionDxe installs this GUID (with a NULL interface) on ESP handles.
+static EFI_GUID LblEspPartitionTypeGuid =
+    { 0xC12A7328, 0xF81F, 0x11D2, { 0xBA, 0x4B, 0x00, 0xA0, 0xC9, 0x3E, 0xC9, 0x3B } };
+
+/**
+ * @brief Classifies a filesystem handle by walking its device path.
+ * Only cheap HandleProtocol lookups are done here; the volume is never opened.
+ */
+static LBL_FS_RANK LblRankFsHandle(EFI_HANDLE Handle) {
+    EFI_DEVICE_PATH* Node = DevicePathFromHandle(Handle);
+    EFI_BLOCK_IO* BlockIo = NULL;
+    VOID* EspMarker = NULL;
+    BOOLEAN IsRemovable = FALSE;
+
+    if (Node == NULL) {
+        return LblFsRankUnknown;
+    }
+
+    for (; !IsDevicePathEnd(Node); Node = NextDevicePathNode(Node)) {
+        UINT8 Type = DevicePathType(Node);
+        UINT8 SubType = DevicePathSubType(Node);
+
+        if (Type == MESSAGING_DEVICE_PATH) {
+            if (SubType == MSG_MAC_ADDR_DP || SubType == MSG_IPv4_DP ||
+                SubType == MSG_IPv6_DP || SubType == MSG_URI_DP) {
+                return LblFsRankNetwork;
+            }
+            if (SubType == MSG_USB_DP || SubType == MSG_USB_CLASS_DP) {
+                IsRemovable = TRUE;
+            }
+        } else if (Type == MEDIA_DEVICE_PATH && SubType == MEDIA_CDROM_DP) {
+            IsRemovable = TRUE;
+        }
+    }
+
+    if (!IsRemovable &&
+        !EFI_ERROR(BS->HandleProtocol(Handle, &gEfiBlockIoProtocolGuid, (VOID**)&BlockIo)) &&
+        BlockIo != NULL && BlockIo->Media != NULL && BlockIo->Media->RemovableMedia) {
+        IsRemovable = TRUE;
+    }
+    if (IsRemovable) {
+        return LblFsRankRemovable;
+    }
+
+    if (!EFI_ERROR(BS->HandleProtocol(Handle, &LblEspPartitionTypeGuid, &EspMarker))) {
+        return LblFsRankLocalEsp;
+    }
+    return LblFsRankLocalDisk;
+}
+
+/**
+ * @brief Returns the device handle this application was loaded from, or NULL.
+ * This is where the installer puts the core, so on a normal boot it is the only
+ * volume that gets opened.
+ */
+static EFI_HANDLE LblBootDeviceHandle(VOID) {
+    EFI_LOADED_IMAGE* LoadedImage = NULL;
+
+    if (EFI_ERROR(BS->HandleProtocol(IH, &gEfiLoadedImageProtocolGuid, (VOID**)&LoadedImage)) ||
+        LoadedImage == NULL) {
+        return NULL;
+    }
+    return LoadedImage->DeviceHandle;
+}
+
+// Result of probing the NVRAM-cached core location.
+typedef enum {
+    LblCoreCacheAbsent = 0, // No (readable) LblCoreDevicePath variable
+    LblCoreCacheHit,        // Core loaded from the cached volume
+    LblCoreCacheStale       // Variable present but no longer leads to the core
+} LBL_CORE_CACHE_RESULT;
+
+/**
+ * @brief Returns the size of a device path (including the end node) if it is
+ * well-formed and fits in MaxSize bytes, or 0 otherwise.
+ * NVRAM contents are untrusted, so node lengths are bounds-checked.
+ */
+static UINTN LblBoundedDevicePathSize(CONST EFI_DEVICE_PATH* Path, UINTN MaxSize) {
+    CONST UINT8* Base = (CONST UINT8*)Path;
+    UINTN Offset = 0;
+
+    while (Offset + sizeof(EFI_DEVICE_PATH) <= MaxSize) {
+        CONST EFI_DEVICE_PATH* Node = (CONST EFI_DEVICE_PATH*)(Base + Offset);
+        UINTN NodeLength = DevicePathNodeLength(Node);
+        if (NodeLength < sizeof(EFI_DEVICE_PATH) || Offset + NodeLength > MaxSize) {
+            return 0;
+        }
+        Offset += NodeLength;
+        if (IsDevicePathEnd(Node)) {
+            return Offset;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Maps a failed LblLoadCoreImage() status to an LBL_CORE_FAILURE_* reason.
+ */
+static UINT32 LblCoreFailureReason(EFI_STATUS Status) {
+    if (Status == EFI_NOT_FOUND) {
+        return LBL_CORE_FAILURE_NOT_FOUND;
+    }
+    if (Status == EFI_LOAD_ERROR || Status == EFI_UNSUPPORTED) {
+        return LBL_CORE_FAILURE_HEADER;
+    }
+    if (Status == EFI_SECURITY_VIOLATION) {
+        return LBL_CORE_FAILURE_DIGEST;
+    }
+    if (Status == EFI_OUT_OF_RESOURCES) {
+        return LBL_CORE_FAILURE_MEMORY;
+    }
+    return LBL_CORE_FAILURE_READ;
+}
+
+/**
+ * @brief Records why Slot could not be used. A real failure on one volume is
+ * kept over the slot merely being absent from another.
+ */
+static VOID LblNoteCoreSlotFailure(UINT32 Slot, EFI_STATUS Status) {
+    UINT32 Reason = LblCoreFailureReason(Status);
+
+    if (LblCoreSlotFailures[Slot] == LBL_CORE_FAILURE_NONE ||
+        LblCoreSlotFailures[Slot] == LBL_CORE_FAILURE_NOT_FOUND) {
+        LblCoreSlotFailures[Slot] = Reason;
+    }
+    if (Reason != LBL_CORE_FAILURE_NOT_FOUND) {
+        LBL_LOG_WARN(L"  Warning: core slot %s failed (Status: %r), trying the next one.\n",
+            LblCoreSlotPaths[Slot].Name, Status);
+        LblTimelineMark(LBL_TL_CORE_SLOT_FAILED, Slot);
+    }
+}
+
+static UINT8 LblCoreSlotMaxAttempts(VOID) {
+    return LblCoreSlotState.max_attempts != 0 ? LblCoreSlotState.max_attempts : LBL_CORE_SLOT_MAX_ATTEMPTS;
+}
+
+/**
+ * @brief Reads LBL_NV_CORE_SLOT and orders the slots: the preferred update slot
+ * (after the other one if it is unconfirmed and has used up its attempts), then
+ * the single image. No variable means slot A with nothing counted yet.
+ */
+static VOID LblSelectCoreSlots(VOID) {
+    UINTN Size = sizeof(LblCoreSlotState);
+    UINT32 Preferred;
+
+    if (EFI_ERROR(RS->GetVariable(LBL_NV_CORE_SLOT, &LblVendorGuid, NULL, &Size, &LblCoreSlotState)) ||
+        Size != sizeof(LblCoreSlotState) || LblCoreSlotState.preferred > LBL_CORE_SLOT_B) {
+        BS->SetMem(&LblCoreSlotState, sizeof(LblCoreSlotState), 0);
+    }
+    Preferred = LblCoreSlotState.preferred;
+    LblCoreSlotOrder[0] = Preferred;
+    LblCoreSlotOrder[1] = Preferred ^ 1;
+    LblCoreSlotOrder[2] = LBL_CORE_SLOT_SINGLE;
+    if (LblCoreSlotState.confirmed) {
+        LblCoreSlotFlags |= LBL_CORE_SLOT_FLAG_CONFIRMED;
+    } else if (LblCoreSlotState.attempts >= LblCoreSlotMaxAttempts()) {
+        LblCoreSlotOrder[0] = Preferred ^ 1;
+        LblCoreSlotOrder[1] = Preferred;
+        LblCoreSlotFlags |= LBL_CORE_SLOT_FLAG_DEMOTED;
+        LBL_LOG_WARN(L"Warning: core slot %s had %u unconfirmed boots, trying slot %s first.\n",
+            LblCoreSlotPaths[Preferred].Name, LblCoreSlotState.attempts, LblCoreSlotPaths[Preferred ^ 1].Name);
+    }
+}
+
+/**
+ * @brief Counts this boot against the preferred slot if that is the one loaded:
+ * one SetVariable per boot until the slot is confirmed or out of attempts, none
+ * after that.
+ */
+static VOID LblCountCoreSlotBoot(UINT32 Slot) {
+    EFI_STATUS Status;
+    LBL_CORE_SLOT_STATE State = LblCoreSlotState;
+
+    if (Slot != State.preferred || State.confirmed || State.attempts >= LblCoreSlotMaxAttempts()) {
+        return;
+    }
+    State.attempts++;
+    Status = RS->SetVariable(LBL_NV_CORE_SLOT, &LblVendorGuid,
+                             EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS |
+                             EFI_VARIABLE_RUNTIME_ACCESS,
+                             sizeof(State), &State);
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_WARN(L"  Warning: could not count the core slot boot in NVRAM. Status: %r\n", Status);
+        return;
+    }
+    LblCoreSlotState = State;
+    LblCoreSlotFlags |= LBL_CORE_SLOT_FLAG_COUNTED;
+}
+
+/**
+ * @brief Loads the first slot, in LblCoreSlotOrder, that Device serves. A read,
+ * digest or header failure moves straight on to the next slot.
+ * @return EFI_NOT_FOUND if Device holds none of them, else the last failure.
+ */
+static EFI_STATUS LblLoadCoreSlots(EFI_HANDLE Device, LBL_CORE_IMAGE* Core) {
+    EFI_STATUS Result = EFI_NOT_FOUND;
+    UINT32 i;
+
+    for (i = 0; i < LBL_CORE_SLOT_COUNT; i++) {
+        UINT32 Slot = LblCoreSlotOrder[i];
+        EFI_STATUS Status;
+
+        if (LblCoreSlotsExcluded & (1u << Slot)) {
+            continue;
+        }
+        Status = LblLoadCoreImage(Device, Slot, Core);
+        if (!EFI_ERROR(Status)) {
+            if (LblCoreSlotFailures[Slot] == LBL_CORE_FAILURE_NOT_FOUND) {
+                LblCoreSlotFailures[Slot] = LBL_CORE_FAILURE_NONE; // Only absent from another volume
+            }
+            LBL_LOG_INFO(L"  Using core slot %s (%s).\n", LblCoreSlotPaths[Slot].Name, LblCoreSlotPaths[Slot].Core);
+            return EFI_SUCCESS;
+        }
+        LblNoteCoreSlotFailure(Slot, Status);
+        if (Status != EFI_NOT_FOUND) {
+            Result = Status;
+        }
+    }
+    return Result;
+}
+
+/**
+ * @brief Tries to load the LBL Core from the volume recorded in LBL_NV_CORE_DEVICE_PATH.
+ * The volume is resolved with LocateDevicePath, so no handle enumeration happens.
+ * A stale variable is not deleted here; the caller either overwrites it with the
+ * new location or deletes it, so a relocation costs a single SetVariable.
+ */
+static LBL_CORE_CACHE_RESULT LblLoadCoreFromCachedDevice(LBL_CORE_IMAGE* Core, EFI_HANDLE* CachedDevice) {
+    EFI_STATUS Status;
+    UINT8 PathBuffer[LBL_NV_DEVICE_PATH_MAX];
+    UINTN PathSize = sizeof(PathBuffer);
+    UINT32 Attributes = 0;
+    EFI_DEVICE_PATH* Remaining = (EFI_DEVICE_PATH*)PathBuffer;
+    EFI_HANDLE Handle = NULL;
+
+    *CachedDevice = NULL;
+    Status = RS->GetVariable(LBL_NV_CORE_DEVICE_PATH, &LblVendorGuid, &Attributes, &PathSize, PathBuffer);
+    if (Status == EFI_NOT_FOUND) {
+        return LblCoreCacheAbsent;
+    }
+    if (EFI_ERROR(Status) || LblBoundedDevicePathSize(Remaining, PathSize) != PathSize) {
+        LBL_LOG_DEBUG(L"  Cached core location is unreadable or malformed. Status: %r\n", Status);
+        return LblCoreCacheStale;
+    }
+
+    // Must resolve to a SimpleFileSystem handle matching the whole path,
+    // not just a parent controller.
+    Status = BS->LocateDevicePath(&gEfiSimpleFileSystemProtocolGuid, &Remaining, &Handle);
+    if (EFI_ERROR(Status) || !IsDevicePathEnd(Remaining)) {
+        LBL_LOG_DEBUG(L"  Cached core volume is no longer present.\n");
+        return LblCoreCacheStale;
+    }
+    *CachedDevice = Handle;
+
+    Status = LblLoadCoreSlots(Handle, Core);
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_DEBUG(L"  Cached core volume did not serve the core. Status: %r\n", Status);
+        return LblCoreCacheStale;
+    }
+    return LblCoreCacheHit;
+}
+
+/**
+ * @brief Records Handle's device path as the last-good core location.
+ * Called only after a cache miss, so this is at most one NVRAM write per relocation.
+ */
+static VOID LblRememberCoreDevice(EFI_HANDLE Handle) {
+    EFI_STATUS Status;
+    EFI_DEVICE_PATH* Path = DevicePathFromHandle(Handle);
+    UINTN PathSize;
+
+    if (Path == NULL) {
+        return;
+    }
+    PathSize = DevicePathSize(Path);
+    if (PathSize > LBL_NV_DEVICE_PATH_MAX) {
+        return; // Would never be accepted back by LblLoadCoreFromCachedDevice
+    }
+    Status = RS->SetVariable(LBL_NV_CORE_DEVICE_PATH, &LblVendorGuid,
+                             EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                             PathSize, Path);
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_WARN(L"  Warning: could not cache core location in NVRAM. Status: %r\n", Status);
+    }
+}
+
+/**
+ * @brief Deletes a stale LBL_NV_CORE_DEVICE_PATH variable.
+ */
+static VOID LblForgetCoreDevice(VOID) {
+    RS->SetVariable(LBL_NV_CORE_DEVICE_PATH, &LblVendorGuid, 0, 0, NULL);
+}
+
+// --- Network Core Source (see LBL_NET_URL_MAX in LblUefi.h) ---
+// The source is presented as a read-only EFI_FILE_PROTOCOL volume, so the core,
+// its manifest and the preloaded modules go through the same code as on disk.
+// Opening a file starts its download into a pool buffer; Read returns as soon
+// as the bytes it asks for have arrived, while the rest keeps streaming in.
+
+static EFI_GUID LblHttpServiceBindingGuid = LBL_HTTP_SERVICE_BINDING_PROTOCOL_GUID;
+static EFI_GUID LblHttpProtocolGuid = LBL_HTTP_PROTOCOL_GUID;
+static EFI_GUID LblMtftp4ServiceBindingGuid = LBL_MTFTP4_SERVICE_BINDING_PROTOCOL_GUID;
+static EFI_GUID LblMtftp4ProtocolGuid = LBL_MTFTP4_PROTOCOL_GUID;
+static EFI_GUID LblPxeBaseCodeProtocolGuid = EFI_PXE_BASE_CODE_PROTOCOL_GUID;
+
+#define LBL_NET_FILE_REVISION       0x00010000 // No ReadEx: reads are served from the download buffer
+
+typedef enum {
+    LblNetHttp = 0,                 // http://
+    LblNetTftp                      // tftp://
+} LBL_NET_TRANSPORT;
+
+typedef enum {
+    LblNetConnIdle = 0,             // Nothing in flight
+    LblNetConnRequest,              // GET submitted
+    LblNetConnHeaders,              // Waiting for the response headers
+    LblNetConnBody                  // Receiving the range into the download buffer
+} LBL_NET_CONN_STATE;
+
+// One HTTP child, i.e. one TCP connection, fetching a byte range at a time.
+typedef struct {
+    EFI_HANDLE Child;
+    LBL_HTTP_PROTOCOL* Http;
+    LBL_HTTP_TOKEN Token;           // Reused for the request and every response call
+    LBL_HTTP_MESSAGE Message;
+    LBL_HTTP_REQUEST_DATA Request;
+    LBL_HTTP_RESPONSE_DATA Response;
+    LBL_HTTP_HEADER Headers[2];     // Host, Range
+    CHAR8 Range[48];                // "bytes=<first>-<last>"
+    LBL_NET_CONN_STATE State;
+    UINT64 Start;                   // Range being fetched
+    UINT64 Length;
+    UINT64 Received;
+} LBL_NET_CONNECTION;
+
+// The volume LblOpenCoreVolume hands out for the network source.
+typedef struct {
+    EFI_FILE_PROTOCOL Root;         // First member: the protocol pointer is the volume
+    EFI_HANDLE Device;              // NIC with the transport's service binding
+    LBL_SERVICE_BINDING_PROTOCOL* Binding;
+    LBL_NET_TRANSPORT Transport;
+    CHAR8 Base[LBL_NET_URL_MAX];    // Base URL, ending in '/'
+    UINTN PathOffset;               // Offset of the path in Base (the '/' after the host)
+    CHAR8 Host[LBL_NET_URL_MAX];    // host[:port], for the Host header
+    EFI_IPv4_ADDRESS Server;        // TFTP server
+    UINT16 Port;
+} LBL_NET_VOLUME;
+
+// A file opened on the network volume.
+typedef struct {
+    EFI_FILE_PROTOCOL File;         // First member: the protocol pointer is the file
+    CHAR16 Url[LBL_NET_URL_MAX];
+    UINT8* Data;                    // Download buffer, Size bytes
+    UINT64 Size;
+    BOOLEAN Sized;                  // Size known: the first response headers are in
+    UINT64 Position;
+    UINT64 Ready;                   // Bytes [0, Ready) have arrived
+    UINT64 NextRange;               // First byte no connection has asked for yet
+    EFI_EVENT Stall;                // Timer, re-armed on every completion
+    UINT32 ConnCount;               // Conns[0, ConnCount) are connected
+    UINT32 ConnLimit;               // Lowered when the firmware refuses another child
+    LBL_NET_CONNECTION Conns[LBL_NET_CONNECTIONS];
+} LBL_NET_FILE;
+
+static LBL_NET_VOLUME LblNetVolume;
+static BOOLEAN LblNetVolumeOpen;    // Only while LblLoadCoreFromNetwork tries the slots
+
+static BOOLEAN LblIsNetworkVolume(CONST EFI_FILE_PROTOCOL* Root) {
+    return Root == &LblNetVolume.Root;
+}
+
+static UINTN LblNetStrLen(CONST CHAR8* Str) {
+    UINTN Length = 0;
+
+    while (Str[Length] != 0) {
+        Length++;
+    }
+    return Length;
+}
+
+static CHAR8 LblNetLower(CHAR8 C) {
+    return (C >= 'A' && C <= 'Z') ? (CHAR8)(C - 'A' + 'a') : C;
+}
+
+/**
+ * @brief Case-insensitive compare of the first LblNetStrLen(Prefix) characters.
+ */
+static BOOLEAN LblNetHasPrefix(CONST CHAR8* Str, CONST CHAR8* Prefix) {
+    for (; *Prefix != 0; Str++, Prefix++) {
+        if (LblNetLower(*Str) != LblNetLower(*Prefix)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Writes Value in decimal, without a terminator.
+ * @return Characters written (at most 20).
+ */
+static UINTN LblNetFormatU64(CHAR8* Dest, UINT64 Value) {
+    CHAR8 Digits[20];
+    UINTN Count = 0;
+    UINTN i;
+
+    do {
+        Digits[Count++] = (CHAR8)('0' + Value % 10);
+        Value /= 10;
+    } while (Value != 0);
+    for (i = 0; i < Count; i++) {
+        Dest[i] = Digits[Count - 1 - i];
+    }
+    return Count;
+}
+
+/**
+ * @brief Parses a decimal number at *Cursor and moves past it.
+ * @return FALSE if there is no digit there or the number overflows.
+ */
+static BOOLEAN LblNetParseU64(CONST CHAR8** Cursor, UINT64* Value) {
+    CONST CHAR8* Str = *Cursor;
+    UINT64 Result = 0;
+
+    if (*Str < '0' || *Str > '9') {
+        return FALSE;
+    }
+    for (; *Str >= '0' && *Str <= '9'; Str++) {
+        if (Result > (0xFFFFFFFFFFFFFFFFULL - 9) / 10) {
+            return FALSE;
+        }
+        Result = Result * 10 + (UINT64)(*Str - '0');
+    }
+    *Cursor = Str;
+    *Value = Result;
+    return TRUE;
+}
+
+/**
+ * @brief Fills LblNetVolume's transport, Base, Host and TFTP server from a base URL.
+ * @return EFI_UNSUPPORTED for another scheme (https:// included), an over-long
+ *         URL, or a tftp:// host that is not a dotted IPv4 address.
+ */
+static EFI_STATUS LblNetParseBase(CONST CHAR8* Url) {
+    UINTN Length = LblNetStrLen(Url);
+    UINTN HostStart, HostEnd, i;
+    CONST CHAR8* Cursor;
+    UINT64 Part;
+
+    BS->SetMem(&LblNetVolume, sizeof(LblNetVolume), 0);
+    if (LblNetHasPrefix(Url, (CONST CHAR8*)"http://")) {
+        LblNetVolume.Transport = LblNetHttp;
+        HostStart = 7;
+    } else if (LblNetHasPrefix(Url, (CONST CHAR8*)"tftp://")) {
+        LblNetVolume.Transport = LblNetTftp;
+        HostStart = 7;
+    } else {
+        return EFI_UNSUPPORTED;
+    }
+    for (HostEnd = HostStart; HostEnd < Length && Url[HostEnd] != '/'; HostEnd++) {
+    }
+    if (HostEnd == HostStart || Length + 2 > LBL_NET_URL_MAX) {
+        return EFI_UNSUPPORTED;
+    }
+    BS->CopyMem(LblNetVolume.Base, (VOID*)Url, Length);
+    if (Url[Length - 1] != '/') {
+        LblNetVolume.Base[Length] = '/';
+    }
+    BS->CopyMem(LblNetVolume.Host, (VOID*)(Url + HostStart), HostEnd - HostStart);
+    LblNetVolume.PathOffset = HostEnd;
+
+    if (LblNetVolume.Transport == LblNetTftp) {
+        Cursor = LblNetVolume.Host;
+        for (i = 0; i < 4; i++) {
+            if ((i != 0 && *Cursor++ != '.') || !LblNetParseU64(&Cursor, &Part) || Part > 255) {
+                return EFI_UNSUPPORTED;
+            }
+            LblNetVolume.Server.Addr[i] = (UINT8)Part;
+        }
+        LblNetVolume.Port = LBL_NET_TFTP_PORT;
+        if (*Cursor == ':') {
+            Cursor++;
+            if (!LblNetParseU64(&Cursor, &Part) || Part == 0 || Part > 0xFFFF) {
+                return EFI_UNSUPPORTED;
+            }
+            LblNetVolume.Port = (UINT16)Part;
+        }
+        if (*Cursor != 0) {
+            return EFI_UNSUPPORTED;
+        }
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Picks the network base URL: LBL_NV_CORE_URL, else the directory of the
+ * URI this loader was HTTP-booted from, else the TFTP server and boot file
+ * directory of a PXE boot.
+ * @param Url Output, LBL_NET_URL_MAX characters.
+ * @return FALSE if this machine has no network source.
+ */
+static BOOLEAN LblNetSourceUrl(CHAR8* Url) {
+    UINTN Size = LBL_NET_URL_MAX - 1;
+    EFI_HANDLE BootDevice;
+    EFI_DEVICE_PATH* Node;
+    EFI_PXE_BASE_CODE_PROTOCOL* Pxe = NULL;
+
+    BS->SetMem(Url, LBL_NET_URL_MAX, 0);
+    if (!EFI_ERROR(RS->GetVariable(LBL_NV_CORE_URL, &LblVendorGuid, NULL, &Size, Url)) && Url[0] != 0) {
+        return TRUE;
+    }
+    BS->SetMem(Url, LBL_NET_URL_MAX, 0);
+    BootDevice = LblBootDeviceHandle();
+    if (BootDevice == NULL) {
+        return FALSE;
+    }
+
+    for (Node = DevicePathFromHandle(BootDevice); Node != NULL && !IsDevicePathEnd(Node);
+         Node = NextDevicePathNode(Node)) {
+        if (DevicePathType(Node) == MESSAGING_DEVICE_PATH && DevicePathSubType(Node) == MSG_URI_DP) {
+            CONST CHAR8* Uri = (CONST CHAR8*)Node + sizeof(EFI_DEVICE_PATH);
+            UINTN Length = DevicePathNodeLength(Node) - sizeof(EFI_DEVICE_PATH);
+
+            while (Length > 0 && Uri[Length - 1] != '/') {
+                Length--; // Directory of the boot file
+            }
+            if (Length == 0 || Length >= LBL_NET_URL_MAX) {
+                return FALSE;
+            }
+            BS->CopyMem(Url, (VOID*)Uri, Length);
+            return TRUE;
+        }
+    }
+
+    if (!EFI_ERROR(BS->HandleProtocol(BootDevice, &LblPxeBaseCodeProtocolGuid, (VOID**)&Pxe)) &&
+        Pxe != NULL && Pxe->Mode != NULL && Pxe->Mode->Started && Pxe->Mode->DhcpAckReceived) {
+        EFI_PXE_BASE_CODE_DHCPV4_PACKET* Reply = &Pxe->Mode->DhcpAck.Dhcpv4;
+        CONST CHAR8* BootFile;
+        UINTN Length = 0;
+        UINTN FileLength, i;
+
+        if (Pxe->Mode->ProxyOfferReceived && Pxe->Mode->ProxyOffer.Dhcpv4.BootpSiAddr[0] != 0) {
+            Reply = &Pxe->Mode->ProxyOffer.Dhcpv4; // The PXE server, not the DHCP one
+        }
+        BS->CopyMem(Url, (VOID*)"tftp://", 7);
+        Length = 7;
+        for (i = 0; i < 4; i++) {
+            Length += LblNetFormatU64(Url + Length, Reply->BootpSiAddr[i]);
+            Url[Length++] = (CHAR8)(i < 3 ? '.' : '/');
+        }
+        BootFile = (CONST CHAR8*)Reply->BootpBootFile;
+        for (FileLength = 0; FileLength < sizeof(Reply->BootpBootFile) && BootFile[FileLength] != 0; FileLength++) {
+        }
+        while (FileLength > 0 && BootFile[FileLength - 1] != '/') {
+            FileLength--; // Directory of the boot file
+        }
+        while (FileLength > 0 && BootFile[0] == '/') {
+            BootFile++;
+            FileLength--;
+        }
+        BS->CopyMem(Url + Length, (VOID*)BootFile, FileLength);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Finds the NIC serving a transport: the one this loader was booted
+ * from, else the first one the firmware lists.
+ */
+static EFI_HANDLE LblNetFindService(EFI_GUID* Binding) {
+    EFI_HANDLE BootDevice = LblBootDeviceHandle();
+    EFI_DEVICE_PATH* Path = BootDevice != NULL ? DevicePathFromHandle(BootDevice) : NULL;
+    EFI_HANDLE Handle = NULL;
+    EFI_HANDLE* Handles = NULL;
+    UINTN Count = 0;
+
+    if (Path != NULL && !EFI_ERROR(BS->LocateDevicePath(Binding, &Path, &Handle))) {
+        return Handle;
+    }
+    if (EFI_ERROR(BS->LocateHandleBuffer(ByProtocol, Binding, NULL, &Count, &Handles)) || Count == 0) {
+        return NULL;
+    }
+    Handle = Handles[0];
+    BS->FreePool(Handles);
+    return Handle;
+}
+
+/**
+ * @brief Returns a connection's response headers to the pool. Until the driver
+ * has answered, Message still points at the request's own Host / Range array
+ * (a failed Request, a timeout, a file closed early): that is only dropped.
+ */
+static VOID LblNetFreeHeaders(LBL_NET_CONNECTION* Conn) {
+    UINTN Index;
+
+    if (Conn->Message.Headers == NULL || Conn->Message.Headers == Conn->Headers) {
+        Conn->Message.Headers = NULL;
+        Conn->Message.HeaderCount = 0;
+        return;
+    }
+    for (Index = 0; Index < Conn->Message.HeaderCount; Index++) {
+        if (Conn->Message.Headers[Index].FieldName != NULL) {
+            BS->FreePool(Conn->Message.Headers[Index].FieldName);
+        }
+        if (Conn->Message.Headers[Index].FieldValue != NULL) {
+            BS->FreePool(Conn->Message.Headers[Index].FieldValue);
+        }
+    }
+    BS->FreePool(Conn->Message.Headers);
+    Conn->Message.Headers = NULL;
+    Conn->Message.HeaderCount = 0;
+}
+
+static CONST CHAR8* LblNetFindHeader(CONST LBL_NET_CONNECTION* Conn, CONST CHAR8* Name) {
+    UINTN Index;
+    UINTN Length = LblNetStrLen(Name);
+
+    for (Index = 0; Index < Conn->Message.HeaderCount; Index++) {
+        CONST CHAR8* Field = Conn->Message.Headers[Index].FieldName;
+        if (Field != NULL && LblNetStrLen(Field) == Length && LblNetHasPrefix(Field, Name)) {
+            return Conn->Message.Headers[Index].FieldValue;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Creates and configures an HTTP child for a file.
+ */
+static EFI_STATUS LblNetConnect(LBL_NET_CONNECTION* Conn) {
+    EFI_STATUS Status;
+    LBL_SERVICE_BINDING_PROTOCOL* Binding = LblNetVolume.Binding;
+    LBL_HTTPV4_ACCESS_POINT Local;
+    LBL_HTTP_CONFIG_DATA Config;
+
+    BS->SetMem(Conn, sizeof(*Conn), 0);
+    Status = Binding->CreateChild(Binding, &Conn->Child);
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+    Status = BS->HandleProtocol(Conn->Child, &LblHttpProtocolGuid, (VOID**)&Conn->Http);
+    if (!EFI_ERROR(Status)) {
+        BS->SetMem(&Local, sizeof(Local), 0);
+        Local.UseDefaultAddress = TRUE; // The address DHCP gave the NIC for the network boot
+        BS->SetMem(&Config, sizeof(Config), 0);
+        Config.HttpVersion = LBL_HTTP_VERSION_11;
+        Config.TimeOutMillisec = LBL_NET_STALL_TIMEOUT_MS;
+        Config.LocalAddressIsIPv6 = FALSE;
+        Config.IPv4Node = &Local;
+        Status = Conn->Http->Configure(Conn->Http, &Config);
+    }
+    if (!EFI_ERROR(Status)) {
+        Status = BS->CreateEvent(0, 0, NULL, NULL, &Conn->Token.Event);
+    }
+    if (EFI_ERROR(Status)) {
+        Binding->DestroyChild(Binding, Conn->Child);
+        BS->SetMem(Conn, sizeof(*Conn), 0);
+        return Status;
+    }
+    Conn->Token.Message = &Conn->Message;
+    Conn->Headers[0].FieldName = (CHAR8*)"Host";
+    Conn->Headers[0].FieldValue = LblNetVolume.Host;
+    Conn->Headers[1].FieldName = (CHAR8*)"Range";
+    Conn->Headers[1].FieldValue = Conn->Range;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Aborts whatever a connection has in flight and destroys its child.
+ */
+static VOID LblNetDisconnect(LBL_NET_CONNECTION* Conn) {
+    if (Conn->Http == NULL) {
+        return;
+    }
+    if (Conn->State != LblNetConnIdle) {
+        Conn->Http->Cancel(Conn->Http, NULL);
+    }
+    LblNetFreeHeaders(Conn);
+    Conn->Http->Configure(Conn->Http, NULL);
+    BS->CloseEvent(Conn->Token.Event);
+    LblNetVolume.Binding->DestroyChild(LblNetVolume.Binding, Conn->Child);
+    BS->SetMem(Conn, sizeof(*Conn), 0);
+}
+
+/**
+ * @brief Sends a ranged GET for [Start, Start + Length) of the file.
+ */
+static EFI_STATUS LblNetRequestRange(LBL_NET_FILE* File, LBL_NET_CONNECTION* Conn, UINT64 Start, UINT64 Length) {
+    EFI_STATUS Status;
+    UINTN Used;
+
+    BS->CopyMem(Conn->Range, (VOID*)"bytes=", 6);
+    Used = 6;
+    Used += LblNetFormatU64(Conn->Range + Used, Start);
+    Conn->Range[Used++] = '-';
+    Used += LblNetFormatU64(Conn->Range + Used, Start + Length - 1);
+    Conn->Range[Used] = 0;
+
+    Conn->Start = Start;
+    Conn->Length = Length;
+    Conn->Received = 0;
+    Conn->Request.Method = LBL_HTTP_METHOD_GET;
+    Conn->Request.Url = File->Url;
+    Conn->Message.Data = &Conn->Request;
+    Conn->Message.HeaderCount = 2;
+    Conn->Message.Headers = Conn->Headers;
+    Conn->Message.BodyLength = 0;
+    Conn->Message.Body = NULL;
+    Status = Conn->Http->Request(Conn->Http, &Conn->Token);
+    if (!EFI_ERROR(Status)) {
+        Conn->State = LblNetConnRequest;
+    }
+    return Status;
+}
+
+static EFI_STATUS LblNetReceiveHeaders(LBL_NET_CONNECTION* Conn) {
+    Conn->Response.StatusCode = 0;
+    Conn->Message.Data = &Conn->Response;
+    Conn->Message.HeaderCount = 0;
+    Conn->Message.Headers = NULL; // Allocated by the driver
+    Conn->Message.BodyLength = 0; // Headers only
+    Conn->Message.Body = NULL;
+    Conn->State = LblNetConnHeaders;
+    return Conn->Http->Response(Conn->Http, &Conn->Token);
+}
+
+/**
+ * @brief Asks for the rest of the connection's range, straight into the
+ * download buffer, or returns the connection to idle once it is complete.
+ */
+static EFI_STATUS LblNetReceiveBody(LBL_NET_FILE* File, LBL_NET_CONNECTION* Conn) {
+    if (Conn->Received >= Conn->Length) {
+        Conn->State = LblNetConnIdle;
+        return EFI_SUCCESS;
+    }
+    Conn->Message.Data = NULL;
+    Conn->Message.HeaderCount = 0;
+    Conn->Message.Headers = NULL;
+    Conn->Message.Body = File->Data + Conn->Start + Conn->Received;
+    Conn->Message.BodyLength = (UINTN)(Conn->Length - Conn->Received);
+    Conn->State = LblNetConnBody;
+    return Conn->Http->Response(Conn->Http, &Conn->Token);
+}
+
+/**
+ * @brief Checks the response headers of a range. The first response of a file
+ * also sizes it and allocates the download buffer; a server that ignores Range
+ * (200) then sends the whole file on this connection.
+ */
+static EFI_STATUS LblNetCheckResponse(LBL_NET_FILE* File, LBL_NET_CONNECTION* Conn) {
+    EFI_STATUS Status = EFI_SUCCESS;
+    CONST CHAR8* Value;
+    UINT64 First = 0, Last = 0, Total = 0;
+
+    if (Conn->Response.StatusCode == LBL_HTTP_STATUS_206_PARTIAL_CONTENT) {
+        Value = LblNetFindHeader(Conn, (CONST CHAR8*)"Content-Range");
+        if (Value == NULL || !LblNetHasPrefix(Value, (CONST CHAR8*)"bytes ")) {
+            Status = EFI_PROTOCOL_ERROR;
+        } else {
+            Value += 6;
+            if (!LblNetParseU64(&Value, &First) || *Value++ != '-' || !LblNetParseU64(&Value, &Last) ||
+                *Value++ != '/' || !LblNetParseU64(&Value, &Total) ||
+                First != Conn->Start || Last < First || Last - First >= Conn->Length || Last >= Total ||
+                (File->Sized && Total != File->Size)) {
+                Status = EFI_PROTOCOL_ERROR;
+            } else {
+                Conn->Length = Last - First + 1;
+            }
+        }
+    } else if (Conn->Response.StatusCode == LBL_HTTP_STATUS_200_OK && !File->Sized) {
+        Value = LblNetFindHeader(Conn, (CONST CHAR8*)"Content-Length");
+        if (Value == NULL || !LblNetParseU64(&Value, &Total)) {
+            Status = EFI_UNSUPPORTED; // Chunked, no size to allocate for
+        } else {
+            Conn->Length = Total;
+        }
+    } else if (Conn->Response.StatusCode == LBL_HTTP_STATUS_404_NOT_FOUND) {
+        Status = EFI_NOT_FOUND;
+    } else {
+        LBL_LOG_DEBUG(L"  HTTP status %u for %s.\n", Conn->Response.StatusCode, File->Url);
+        Status = EFI_PROTOCOL_ERROR;
+    }
+    LblNetFreeHeaders(Conn);
+    if (EFI_ERROR(Status) || File->Sized) {
+        return Status;
+    }
+
+    if (Total > LBL_IMAGE_MAX_SIZE) {
+        return EFI_BAD_BUFFER_SIZE;
+    }
+    if (Total != 0) {
+        Status = BS->AllocatePool(EfiLoaderData, (UINTN)Total, (VOID**)&File->Data);
+        if (EFI_ERROR(Status)) {
+            return Status;
+        }
+    }
+    File->Size = Total;
+    File->Sized = TRUE;
+    File->NextRange = Conn->Length;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Advances every connection of a file by whatever has completed, then
+ * gives each idle connection the next range, so up to LBL_NET_CONNECTIONS
+ * ranges are always in flight until the whole file has been asked for.
+ * @return EFI_TIMEOUT after LBL_NET_STALL_TIMEOUT_MS without progress.
+ */
+static EFI_STATUS LblNetPump(LBL_NET_FILE* File) {
+    EFI_STATUS Status = EFI_SUCCESS;
+    BOOLEAN Progress = FALSE;
+    UINT64 Ready;
+    UINT32 i;
+
+    for (i = 0; i < File->ConnCount; i++) {
+        LBL_NET_CONNECTION* Conn = &File->Conns[i];
+
+        if (Conn->State == LblNetConnIdle) {
+            continue;
+        }
+        Conn->Http->Poll(Conn->Http);
+        if (BS->CheckEvent(Conn->Token.Event) != EFI_SUCCESS) {
+            continue;
+        }
+        Progress = TRUE;
+        if (EFI_ERROR(Conn->Token.Status)) {
+            return Conn->Token.Status;
+        }
+        if (Conn->State == LblNetConnRequest) {
+            Status = LblNetReceiveHeaders(Conn);
+        } else if (Conn->State == LblNetConnHeaders) {
+            Status = LblNetCheckResponse(File, Conn);
+            if (!EFI_ERROR(Status)) {
+                Status = LblNetReceiveBody(File, Conn);
+            }
+        } else {
+            Conn->Received += Conn->Message.BodyLength;
+            Status = LblNetReceiveBody(File, Conn);
+        }
+        if (EFI_ERROR(Status)) {
+            return Status;
+        }
+    }
+
+    for (i = 0; File->Sized && i < File->ConnLimit && File->NextRange < File->Size; i++) {
+        LBL_NET_CONNECTION* Conn = &File->Conns[i];
+        UINT64 Length = File->Size - File->NextRange;
+
+        if (i == File->ConnCount) {
+            if (EFI_ERROR(LblNetConnect(Conn))) {
+                File->ConnLimit = File->ConnCount; // Carry on with the connections there are
+                break;
+            }
+            File->ConnCount++;
+        }
+        if (Conn->State != LblNetConnIdle) {
+            continue;
+        }
+        if (Length > LBL_NET_RANGE_SIZE) {
+            Length = LBL_NET_RANGE_SIZE;
+        }
+        Status = LblNetRequestRange(File, Conn, File->NextRange, Length);
+        if (EFI_ERROR(Status)) {
+            return Status;
+        }
+        File->NextRange += Length;
+    }
+
+    // Ranges are handed out in order and each arrives in order, so the file is
+    // complete up to the first byte any busy connection still owes.
+    Ready = File->NextRange;
+    for (i = 0; i < File->ConnCount; i++) {
+        LBL_NET_CONNECTION* Conn = &File->Conns[i];
+        if (Conn->State != LblNetConnIdle && Conn->Start + Conn->Received < Ready) {
+            Ready = Conn->Start + Conn->Received;
+        }
+    }
+    File->Ready = Ready;
+
+    if (Progress) {
+        BS->SetTimer(File->Stall, TimerRelative, (UINT64)LBL_NET_STALL_TIMEOUT_MS * 10000);
+    } else if (BS->CheckEvent(File->Stall) == EFI_SUCCESS) {
+        return EFI_TIMEOUT;
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Starts the download of a file over HTTP and waits for its size.
+ */
+static EFI_STATUS LblNetHttpOpen(LBL_NET_FILE* File) {
+    EFI_STATUS Status;
+
+    Status = BS->CreateEvent(EVT_TIMER, 0, NULL, NULL, &File->Stall);
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+    BS->SetTimer(File->Stall, TimerRelative, (UINT64)LBL_NET_STALL_TIMEOUT_MS * 10000);
+    Status = LblNetConnect(&File->Conns[0]);
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+    File->ConnCount = 1;
+    Status = LblNetRequestRange(File, &File->Conns[0], 0, LBL_NET_RANGE_SIZE);
+    while (!EFI_ERROR(Status) && !File->Sized) {
+        Status = LblNetPump(File);
+    }
+    return Status;
+}
+
+/**
+ * @brief Reads a whole file over TFTP: its size from the tsize option, then one
+ * transfer with LBL_NET_TFTP_BLKSIZE blocks and LBL_NET_TFTP_WINDOWSIZE blocks
+ * per ACK (retried without windowsize for drivers that lack it).
+ * @param Name Path on the server, without the leading '/'.
+ */
+static EFI_STATUS LblNetTftpFetch(LBL_NET_FILE* File, CONST CHAR8* Name) {
+    EFI_STATUS Status;
+    LBL_SERVICE_BINDING_PROTOCOL* Binding = LblNetVolume.Binding;
+    EFI_HANDLE Child = NULL;
+    LBL_MTFTP4_PROTOCOL* Mtftp = NULL;
+    LBL_MTFTP4_CONFIG_DATA Config;
+    LBL_MTFTP4_OPTION Options[3] = {
+        { (UINT8*)"tsize", (UINT8*)"0" },
+        { (UINT8*)"blksize", (UINT8*)LBL_NET_TFTP_BLKSIZE },
+        { (UINT8*)"windowsize", (UINT8*)LBL_NET_TFTP_WINDOWSIZE },
+    };
+    UINT8 OptionCount = 3;
+    LBL_MTFTP4_OPTION* Parsed = NULL;
+    UINT32 ParsedCount = 0;
+    UINT32 PacketLength = 0;
+    VOID* Packet = NULL;
+    LBL_MTFTP4_TOKEN Token;
+    BOOLEAN HaveSize = FALSE;
+    UINT32 i;
+
+    Status = Binding->CreateChild(Binding, &Child);
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+    Status = BS->HandleProtocol(Child, &LblMtftp4ProtocolGuid, (VOID**)&Mtftp);
+    if (!EFI_ERROR(Status)) {
+        BS->SetMem(&Config, sizeof(Config), 0);
+        Config.UseDefaultSetting = TRUE;
+        Config.ServerIp = LblNetVolume.Server;
+        Config.InitialServerPort = LblNetVolume.Port;
+        Config.TryCount = 3;
+        Config.TimeoutValue = LBL_NET_STALL_TIMEOUT_MS / 1000;
+        Status = Mtftp->Configure(Mtftp, &Config);
+    }
+    if (!EFI_ERROR(Status)) {
+        Status = Mtftp->GetInfo(Mtftp, NULL, (UINT8*)Name, (UINT8*)"octet", OptionCount, Options,
+                                &PacketLength, &Packet);
+        if (Status == EFI_UNSUPPORTED) {
+            OptionCount = 2;
+            Status = Mtftp->GetInfo(Mtftp, NULL, (UINT8*)Name, (UINT8*)"octet", OptionCount, Options,
+                                    &PacketLength, &Packet);
+        }
+    }
+    if (!EFI_ERROR(Status)) {
+        Status = Mtftp->ParseOptions(Mtftp, PacketLength, Packet, &ParsedCount, &Parsed);
+        for (i = 0; !EFI_ERROR(Status) && i < ParsedCount; i++) {
+            CONST CHAR8* Value = (CONST CHAR8*)Parsed[i].ValueStr;
+            if (LblNetStrLen((CONST CHAR8*)Parsed[i].OptionStr) == 5 &&
+                LblNetHasPrefix((CONST CHAR8*)Parsed[i].OptionStr, (CONST CHAR8*)"tsize")) {
+                HaveSize = LblNetParseU64(&Value, &File->Size);
+            }
+        }
+        if (Parsed != NULL) {
+            BS->FreePool(Parsed);
+        }
+        BS->FreePool(Packet);
+        if (!EFI_ERROR(Status) && (!HaveSize || File->Size > LBL_IMAGE_MAX_SIZE)) {
+            Status = EFI_UNSUPPORTED; // Needs tsize to size the buffer
+        }
+    }
+    if (!EFI_ERROR(Status) && File->Size != 0) {
+        Status = BS->AllocatePool(EfiLoaderData, (UINTN)File->Size, (VOID**)&File->Data);
+    }
+    if (!EFI_ERROR(Status) && File->Size != 0) {
+        BS->SetMem(&Token, sizeof(Token), 0);
+        Token.Filename = (UINT8*)Name;
+        Token.ModeStr = (UINT8*)"octet";
+        Token.OptionCount = OptionCount - 1; // tsize is already known
+        Token.OptionList = Options + 1;
+        Token.BufferSize = File->Size;
+        Token.Buffer = File->Data;
+        Status = Mtftp->ReadFile(Mtftp, &Token); // No event: returns when the transfer is done
+        if (!EFI_ERROR(Status)) {
+            Status = Token.Status;
+        }
+    }
+    if (Mtftp != NULL) {
+        Mtftp->Configure(Mtftp, NULL);
+    }
+    Binding->DestroyChild(Binding, Child);
+    if (Status == EFI_TFTP_ERROR) {
+        return EFI_NOT_FOUND; // The server's error packet; nearly always "file not found"
+    }
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+    File->Sized = TRUE;
+    File->Ready = File->Size;
+    File->NextRange = File->Size;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Releases a network file: its connections, timer and download buffer.
+ */
+static VOID LblNetReleaseFile(LBL_NET_FILE* File) {
+    UINT32 i;
+
+    for (i = 0; i < File->ConnCount; i++) {
+        LblNetDisconnect(&File->Conns[i]);
+    }
+    if (File->Stall != NULL) {
+        BS->CloseEvent(File->Stall);
+    }
+    if (File->Data != NULL) {
+        BS->FreePool(File->Data);
+    }
+    BS->FreePool(File);
+}
+
+static EFI_STATUS EFIAPI LblNetOpen(EFI_FILE_PROTOCOL* This, EFI_FILE_PROTOCOL** NewHandle, CHAR16* FileName,
+                                    UINT64 OpenMode, UINT64 Attributes);
+
+static EFI_STATUS EFIAPI LblNetClose(EFI_FILE_PROTOCOL* This) {
+    if (!LblIsNetworkVolume(This)) {
+        LblNetReleaseFile((LBL_NET_FILE*)This);
+    }
+    return EFI_SUCCESS; // The volume itself is static
+}
+
+static EFI_STATUS EFIAPI LblNetDelete(EFI_FILE_PROTOCOL* This) {
+    LblNetClose(This);
+    return EFI_WARN_DELETE_FAILURE;
+}
+
+static EFI_STATUS EFIAPI LblNetRead(EFI_FILE_PROTOCOL* This, UINTN* BufferSize, VOID* Buffer) {
+    LBL_NET_FILE* File = (LBL_NET_FILE*)This;
+    EFI_STATUS Status = EFI_SUCCESS;
+    UINT64 Length;
+
+    if (LblIsNetworkVolume(This)) {
+        return EFI_UNSUPPORTED; // Directories are not listed
+    }
+    Length = File->Position < File->Size ? File->Size - File->Position : 0;
+    if (Length > *BufferSize) {
+        Length = *BufferSize;
+    }
+    while (!EFI_ERROR(Status) && File->Ready < File->Position + Length) {
+        Status = LblNetPump(File);
+    }
+    if (EFI_ERROR(Status)) {
+        *BufferSize = 0;
+        return Status;
+    }
+    if (Length != 0) {
+        BS->CopyMem(Buffer, File->Data + File->Position, (UINTN)Length);
+    }
+    File->Position += Length;
+    *BufferSize = (UINTN)Length;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI LblNetWrite(EFI_FILE_PROTOCOL* This, UINTN* BufferSize, VOID* Buffer) {
+    (VOID)This;
+    (VOID)Buffer;
+    *BufferSize = 0;
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI LblNetGetPosition(EFI_FILE_PROTOCOL* This, UINT64* Position) {
+    *Position = LblIsNetworkVolume(This) ? 0 : ((LBL_NET_FILE*)This)->Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI LblNetSetPosition(EFI_FILE_PROTOCOL* This, UINT64 Position) {
+    LBL_NET_FILE* File = (LBL_NET_FILE*)This;
+
+    if (LblIsNetworkVolume(This)) {
+        return Position == 0 ? EFI_SUCCESS : EFI_UNSUPPORTED;
+    }
+    File->Position = (Position == 0xFFFFFFFFFFFFFFFFULL) ? File->Size : Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI LblNetGetInfo(EFI_FILE_PROTOCOL* This, EFI_GUID* InformationType,
+                                       UINTN* BufferSize, VOID* Buffer) {
+    EFI_FILE_INFO* Info = (EFI_FILE_INFO*)Buffer;
+
+    if (LblIsNetworkVolume(This) || CompareMem(InformationType, &gEfiFileInfoGuid, sizeof(EFI_GUID)) != 0) {
+        return EFI_UNSUPPORTED;
+    }
+    if (Buffer == NULL || *BufferSize < sizeof(EFI_FILE_INFO)) {
+        *BufferSize = sizeof(EFI_FILE_INFO);
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    BS->SetMem(Info, sizeof(EFI_FILE_INFO), 0); // Empty FileName
+    Info->Size = sizeof(EFI_FILE_INFO);
+    Info->FileSize = ((LBL_NET_FILE*)This)->Size;
+    Info->PhysicalSize = Info->FileSize;
+    Info->Attribute = EFI_FILE_READ_ONLY;
+    *BufferSize = sizeof(EFI_FILE_INFO);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI LblNetSetInfo(EFI_FILE_PROTOCOL* This, EFI_GUID* InformationType,
+                                       UINTN BufferSize, VOID* Buffer) {
+    (VOID)This;
+    (VOID)InformationType;
+    (VOID)BufferSize;
+    (VOID)Buffer;
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI LblNetFlush(EFI_FILE_PROTOCOL* This) {
+    (VOID)This;
+    return EFI_WRITE_PROTECTED;
+}
+
+static VOID LblNetInitProtocol(EFI_FILE_PROTOCOL* Protocol) {
+    Protocol->Revision = LBL_NET_FILE_REVISION;
+    Protocol->Open = LblNetOpen;
+    Protocol->Close = LblNetClose;
+    Protocol->Delete = LblNetDelete;
+    Protocol->Read = LblNetRead;
+    Protocol->Write = LblNetWrite;
+    Protocol->GetPosition = LblNetGetPosition;
+    Protocol->SetPosition = LblNetSetPosition;
+    Protocol->GetInfo = LblNetGetInfo;
+    Protocol->SetInfo = LblNetSetInfo;
+    Protocol->Flush = LblNetFlush;
+}
+
+/**
+ * @brief EFI_FILE_PROTOCOL.Open for the network volume: FileName is a volume
+ * path ("\LBL\CORE\lbl_core.bin"), fetched from <base>LBL/CORE/lbl_core.bin.
+ * Returns once the file's size is known; HTTP ranges keep arriving after that.
+ */
+static EFI_STATUS EFIAPI LblNetOpen(EFI_FILE_PROTOCOL* This, EFI_FILE_PROTOCOL** NewHandle, CHAR16* FileName,
+                                    UINT64 OpenMode, UINT64 Attributes) {
+    EFI_STATUS Status;
+    LBL_NET_FILE* File = NULL;
+    CHAR8 Url[LBL_NET_URL_MAX];
+    UINTN Length, i;
+
+    (VOID)This;
+    (VOID)Attributes;
+    if (NewHandle == NULL || FileName == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    *NewHandle = NULL;
+    if (OpenMode != EFI_FILE_MODE_READ) {
+        return EFI_WRITE_PROTECTED;
+    }
+
+    Length = LblNetStrLen(LblNetVolume.Base);
+    BS->CopyMem(Url, LblNetVolume.Base, Length);
+    while (*FileName == L'\\' || *FileName == L'/') {
+        FileName++;
+    }
+    for (; *FileName != 0; FileName++) {
+        if (Length + 1 >= LBL_NET_URL_MAX || *FileName <= L' ' || *FileName > L'~') {
+            return EFI_INVALID_PARAMETER; // Too long, or would need escaping
+        }
+        Url[Length++] = *FileName == L'\\' ? '/' : (CHAR8)*FileName;
+    }
+    Url[Length] = 0;
+
+    Status = BS->AllocatePool(EfiLoaderData, sizeof(LBL_NET_FILE), (VOID**)&File);
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+    BS->SetMem(File, sizeof(LBL_NET_FILE), 0);
+    for (i = 0; i <= Length; i++) {
+        File->Url[i] = Url[i];
+    }
+    File->ConnLimit = LBL_NET_CONNECTIONS;
+    LblNetInitProtocol(&File->File);
+    if (LblNetVolume.Transport == LblNetTftp) {
+        Status = LblNetTftpFetch(File, Url + LblNetVolume.PathOffset + 1);
+    } else {
+        Status = LblNetHttpOpen(File);
+    }
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_DEBUG(L"  Could not fetch %s (Status: %r)\n", File->Url, Status);
+        LblNetReleaseFile(File);
+        return Status;
+    }
+    *NewHandle = &File->File;
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Opens the root of the volume a core slot is read from: the network
+ * source while LblLoadCoreFromNetwork runs, else Device's SimpleFileSystem.
+ * @return EFI_NOT_FOUND if Device is neither.
+ */
+static EFI_STATUS LblOpenCoreVolume(EFI_HANDLE Device, EFI_FILE_PROTOCOL** Root) {
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL* Fs = NULL;
+
+    *Root = NULL;
+    if (LblNetVolumeOpen && Device == LblNetVolume.Device) {
+        *Root = &LblNetVolume.Root;
+        return EFI_SUCCESS;
+    }
+    if (EFI_ERROR(BS->HandleProtocol(Device, &gEfiSimpleFileSystemProtocolGuid, (VOID**)&Fs)) || Fs == NULL) {
+        return EFI_NOT_FOUND;
+    }
+    return Fs->OpenVolume(Fs, Root);
+}
+
+/**
+ * @brief Last resort for diskless machines: tries every slot on the network
+ * source. Unlike a volume, the source is never cached in LBL_NV_CORE_DEVICE_PATH.
+ * @return EFI_NOT_FOUND if there is no usable network source.
+ */
+static EFI_STATUS LblLoadCoreFromNetwork(LBL_CORE_IMAGE* Core) {
+    EFI_STATUS Status;
+    CHAR8 Url[LBL_NET_URL_MAX];
+    EFI_GUID* Binding;
+
+    if (!LblNetSourceUrl(Url)) {
+        return EFI_NOT_FOUND;
+    }
+    // No TLS configuration is done (no EFI_TLS_CA_CERTIFICATE_VARIABLE, no TLS
+    // service check), so an https:// source would not authenticate the server.
+    if (LblNetHasPrefix(Url, (CONST CHAR8*)"https://")) {
+        LBL_LOG_WARN(L"Warning: https:// core URL '%a' refused; TLS is not supported, use http:// or tftp://.\n", Url);
+        return EFI_NOT_FOUND;
+    }
+    if (EFI_ERROR(LblNetParseBase(Url))) {
+        LBL_LOG_WARN(L"Warning: Unsupported network core URL '%a'.\n", Url);
+        return EFI_NOT_FOUND;
+    }
+    Binding = LblNetVolume.Transport == LblNetTftp ? &LblMtftp4ServiceBindingGuid : &LblHttpServiceBindingGuid;
+    LblNetVolume.Device = LblNetFindService(Binding);
+    if (LblNetVolume.Device == NULL ||
+        EFI_ERROR(BS->HandleProtocol(LblNetVolume.Device, Binding, (VOID**)&LblNetVolume.Binding))) {
+        LBL_LOG_WARN(L"Warning: No network interface serves '%a'.\n", LblNetVolume.Base);
+        return EFI_NOT_FOUND;
+    }
+    LblNetInitProtocol(&LblNetVolume.Root);
+
+    LBL_LOG_INFO(L"Locating LBL Core on the network: %a\n", LblNetVolume.Base);
+    LblNetVolumeOpen = TRUE;
+    Status = LblLoadCoreSlots(LblNetVolume.Device, Core);
+    LblNetVolumeOpen = FALSE;
+    if (!EFI_ERROR(Status)) {
+        LBL_LOG_INFO(L"  LBL Core loaded from the network.\n");
+    }
+    return Status;
+}
+
+/**
+ * @brief Finds a suitable partition (usually ESP), and loads the LBL Core file.
+ * Lookup order:
+ *   1. The volume cached in NVRAM by a previous boot (no handle enumeration).
+ *   2. The device this application was loaded from.
+ *   3. All SimpleFileSystem handles, probed in LBL_FS_RANK order.
+ * Each volume is asked for every slot (LblLoadCoreSlots) before the next one.
+ * The NVRAM cache is only written when the serving volume changes.
+ */
+static EFI_STATUS LblLocateCoreOnDisk(LBL_CORE_IMAGE* Core) {
+    EFI_STATUS Status;
+    UINTN NumHandles = 0;
+    EFI_HANDLE* HandleBuffer = NULL;
+    UINT8* Ranks = NULL;
+    EFI_HANDLE CachedDevice = NULL;
+    EFI_HANDLE BootDevice = NULL;
+    LBL_CORE_CACHE_RESULT CacheResult;
+    UINTN i, j;
+
+    LBL_LOG_INFO(L"Locating LBL Core: slot %s first\n", LblCoreSlotPaths[LblCoreSlotOrder[0]].Name);
+
+    // Fastest path: last-good location from NVRAM.
+    CacheResult = LblLoadCoreFromCachedDevice(Core, &CachedDevice);
+    if (CacheResult == LblCoreCacheHit) {
+        LBL_LOG_INFO(L"  LBL Core loaded from cached location.\n");
+        return EFI_SUCCESS;
+    }
+
+    // Fast path: the volume LBL itself was started from.
+    Status = EFI_NOT_FOUND;
+    BootDevice = LblBootDeviceHandle();
+    if (BootDevice != NULL && BootDevice != CachedDevice) {
+        Status = LblLoadCoreSlots(BootDevice, Core);
+        if (!EFI_ERROR(Status)) {
+            LBL_LOG_INFO(L"  LBL Core loaded from boot device.\n");
+            LblRememberCoreDevice(BootDevice);
+            return EFI_SUCCESS;
+        }
+    }
+    LBL_LOG_DEBUG(L"  Boot device does not hold the core (Status: %r), scanning filesystems.\n", Status);
+
+    // Get all handles that support Simple File System Protocol
+    Status = BS->LocateHandleBuffer(ByProtocol, &gEfiSimpleFileSystemProtocolGuid, NULL, &NumHandles, &HandleBuffer);
+    if (EFI_ERROR(Status) || NumHandles == 0) {
+        LBL_LOG_INFO(L"  No filesystems found (SimpleFileSystemProtocol). Status: %r\n", Status);
+        if (CacheResult == LblCoreCacheStale) {
+            LblForgetCoreDevice();
+        }
+        return Status == EFI_SUCCESS ? EFI_NOT_FOUND : Status; // If success but no handles
+    }
+
+    LBL_LOG_DEBUG(L"Found %u filesystem handle(s).\n", NumHandles);
+
+    // Rank every handle, then stable insertion sort (handle counts are small).
+    Status = BS->AllocatePool(EfiLoaderData, NumHandles * sizeof(UINT8), (VOID**)&Ranks);
+    if (EFI_ERROR(Status)) {
+        BS->FreePool(HandleBuffer);
+        return Status;
+    }
+    for (i = 0; i < NumHandles; i++) {
+        EFI_HANDLE Handle = HandleBuffer[i];
+        UINT8 Rank = (UINT8)LblRankFsHandle(Handle);
+        for (j = i; j > 0 && Ranks[j - 1] > Rank; j--) {
+            HandleBuffer[j] = HandleBuffer[j - 1];
+            Ranks[j] = Ranks[j - 1];
+        }
+        HandleBuffer[j] = Handle;
+        Ranks[j] = Rank;
+    }
+
+    for (i = 0; i < NumHandles; i++) {
+        if (HandleBuffer[i] == BootDevice || HandleBuffer[i] == CachedDevice) {
+            continue; // Already tried on a fast path
+        }
+        LBL_LOG_DEBUG(L"  Attempting to load core from FS handle [%u] (rank %u)...\n", i, Ranks[i]);
+        Status = LblLoadCoreSlots(HandleBuffer[i], Core);
+        if (!EFI_ERROR(Status)) {
+            LBL_LOG_INFO(L"    LBL Core found and loaded from filesystem handle %u.\n", i);
+            LblRememberCoreDevice(HandleBuffer[i]);
+            BS->FreePool(Ranks);
+            BS->FreePool(HandleBuffer);
+            return EFI_SUCCESS; // Found and loaded
+        } else {
+            LBL_LOG_DEBUG(L"    Failed to load from FS handle [%u]. Status: %r\n", i, Status);
+            // LblLoadCoreImage releases its pages on failure.
+        }
+    }
+
+    LBL_LOG_INFO(L"  No usable LBL Core slot on any accessible filesystem.\n");
+    if (CacheResult == LblCoreCacheStale) {
+        LblForgetCoreDevice();
+    }
+    BS->FreePool(Ranks);
+    BS->FreePool(HandleBuffer);
+    return EFI_NOT_FOUND;
+}
+
+/**
+ * @brief Loads the core from a local volume (LblLocateCoreOnDisk), or over the
+ * network (LblLoadCoreFromNetwork) when no volume holds a usable slot.
+ */
+static EFI_STATUS LblLocateCore(LBL_CORE_IMAGE* Core) {
+    EFI_STATUS Status;
+
+    Status = LblLocateCoreOnDisk(Core);
+    if (!EFI_ERROR(Status)) {
+        return EFI_SUCCESS;
+    }
+    Status = LblLoadCoreFromNetwork(Core);
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_ERROR(L"Error: No usable LBL Core slot on any filesystem or network source.\n");
+        return EFI_NOT_FOUND;
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * @brief Orders the A/B slots from LBL_NV_CORE_SLOT, loads the first core that
+ * reads and validates (LblLocateCore), and counts the boot against its slot.
+ */
+EFI_STATUS FindAndLoadLBLCore(LBL_CORE_IMAGE* Core) {
+    EFI_STATUS Status;
+
+    LblSelectCoreSlots();
+    Status = LblLocateCore(Core);
+    if (!EFI_ERROR(Status)) {
+        LblCountCoreSlotBoot(Core->slot);
+    }
+    return Status;
+}
+
+/**
+ * @brief Called when the deferred check of an asynchronously read core fails:
+ * gives up on its slot for this boot and loads the next one, until a core
+ * completes or no slot is left.
+ */
+static EFI_STATUS LblFailOverCore(LBL_CORE_IMAGE* Core, EFI_STATUS Status) {
+    while (EFI_ERROR(Status) && Core->pages != 0) {
+        LblNoteCoreSlotFailure(Core->slot, Status);
+        LblCoreSlotsExcluded |= 1u << Core->slot;
+        LblFreeCoreImage(Core);
+        Status = LblLocateCore(Core);
+        if (!EFI_ERROR(Status)) {
+            Status = LblCompleteCoreLoad(Core);
+        }
+    }
+    return Status;
+}
+
+// Configuration tables handed to the core. Where two GUIDs map to one type,
+// the higher version wins regardless of their order in ST->ConfigurationTable.
+typedef struct {
+    EFI_GUID Guid;
+    UINT32   Type;      // LBL_CFG_*
+    UINT32   Version;
+} LBL_CONFIG_TABLE_MATCH;
+
+static LBL_CONFIG_TABLE_MATCH LblConfigTableMatches[] = {
+    { { 0x8868e871, 0xe4f1, 0x11d3, { 0xbc, 0x22, 0x00, 0x80, 0xc7, 0x3c, 0x88, 0x81 } }, LBL_CFG_ACPI, 2 },
+    { { 0xeb9d2d30, 0x2d88, 0x11d3, { 0x9a, 0x16, 0x00, 0x90, 0x27, 0x3f, 0xc1, 0x4d } }, LBL_CFG_ACPI, 1 },
+    { { 0xeb9d2d31, 0x2d88, 0x11d3, { 0x9a, 0x16, 0x00, 0x90, 0x27, 0x3f, 0xc1, 0x4d } }, LBL_CFG_SMBIOS, 2 },
+    { { 0xf2fd1544, 0x9794, 0x4a2c, { 0x99, 0x2e, 0xe5, 0xbb, 0xcf, 0x20, 0xe3, 0x94 } }, LBL_CFG_SMBIOS3, 3 },
+    { { 0xb1b621d5, 0xf19c, 0x41a5, { 0x83, 0x0b, 0xd9, 0x15, 0x2c, 0x69, 0xaa, 0xe0 } }, LBL_CFG_DEVICE_TREE, 1 },
+    { { 0xdcfa911d, 0x26eb, 0x469f, { 0xa2, 0x20, 0x38, 0xb7, 0xdc, 0x46, 0x12, 0x20 } }, LBL_CFG_MEMORY_ATTRIBUTES, 1 },
+};
+
+static EFI_GUID LblRngProtocolGuid = LBL_RNG_PROTOCOL_GUID;
+
+// Sanity limit on one ACPI table; anything longer is treated as a corrupt header.
+#define LBL_ACPI_MAX_TABLE_LENGTH   0x1000000
+
+static BOOLEAN LblAcpiChecksumOk(CONST UINT8* Bytes, UINTN Length) {
+    UINT8 Sum = 0;
+    while (Length--) {
+        Sum = (UINT8)(Sum + *Bytes++);
+    }
+    return Sum == 0;
+}
+
+static UINT32 LblReadUnaligned32(CONST UINT8* Bytes) {
+    UINT32 Value;
+    BS->CopyMem(&Value, (VOID*)Bytes, sizeof(Value));
+    return Value;
+}
+
+static UINT64 LblReadUnaligned64(CONST UINT8* Bytes) {
+    UINT64 Value;
+    BS->CopyMem(&Value, (VOID*)Bytes, sizeof(Value));
+    return Value;
+}
+
+/**
+ * @brief Adds one table to the index after checking its length and checksum.
+ * The FACS has no checksum and is taken on its length alone.
+ */
+static VOID LblAcpiIndexAdd(LBL_ACPI_INDEX_RECORD* Record, UINT32 Capacity, UINT64 Address) {
+    LBL_ACPI_TABLE_ENTRY* Entries = (LBL_ACPI_TABLE_ENTRY*)(Record + 1);
+    CONST UINT8* Table = (CONST UINT8*)(UINTN)Address;
+    UINT32 Signature, Length;
+
+    if (Address == 0 || Record->count == Capacity) {
+        return;
+    }
+    Signature = LblReadUnaligned32(Table);
+    Length = LblReadUnaligned32(Table + 4);
+    if (Length < 8 || Length > LBL_ACPI_MAX_TABLE_LENGTH ||
+        (Signature != 0x53434146 /* "FACS" */ && (Length < 36 || !LblAcpiChecksumOk(Table, Length)))) {
+        Record->dropped++;
+        return;
+    }
+    Entries[Record->count].signature = Signature;
+    Entries[Record->count].length = Length;
+    Entries[Record->count].address = Address;
+    Record->count++;
+}
+
+/**
+ * @brief Indexes the ACPI tables while boot services are still up, so the core
+ * can look tables up by signature without walking or re-checksumming the XSDT.
+ * The RSDP and root table are validated first; nothing is appended if they fail.
+ */
+static VOID LblBuildAcpiIndex(LBL_BOOT_INFO* BootInfo) {
+    CONST UINT8* Rsdp = (CONST UINT8*)(UINTN)BootInfo->acpi_rsdp_ptr;
+    CONST UINT8* Root;
+    LBL_ACPI_INDEX_RECORD* Record;
+    LBL_ACPI_TABLE_ENTRY* Entries;
+    UINT64 RootAddress;
+    UINT32 RootLength, EntrySize, Tables, Capacity, Used;
+    UINTN Fadt = 0;
+
+    if (Rsdp == NULL || !LblAcpiChecksumOk(Rsdp, 20)) {
+        return;
+    }
+    if (Rsdp[15] >= 2 && LblAcpiChecksumOk(Rsdp, 36) && LblReadUnaligned64(Rsdp + 24) != 0) {
+        RootAddress = LblReadUnaligned64(Rsdp + 24); // XSDT
+        EntrySize = 8;
+    } else {
+        RootAddress = LblReadUnaligned32(Rsdp + 16); // RSDT
+        EntrySize = 4;
+    }
+    Root = (CONST UINT8*)(UINTN)RootAddress;
+    if (Root == NULL) {
+        return;
+    }
+    RootLength = LblReadUnaligned32(Root + 4);
+    if (RootLength < 36 || RootLength > LBL_ACPI_MAX_TABLE_LENGTH || !LblAcpiChecksumOk(Root, RootLength)) {
+        LBL_LOG_WARN(L"Warning: ACPI root table at 0x%lx failed validation; no ACPI index.\n", RootAddress);
+        return;
+    }
+    Tables = (RootLength - 36) / EntrySize;
+    Capacity = Tables + 2; // + DSDT and FACS from the FADT
+    Record = LblAppendBootRecord(BootInfo, LBL_BOOT_RECORD_ACPI_INDEX,
+                                 (UINT32)(sizeof(LBL_ACPI_INDEX_RECORD) + Capacity * sizeof(LBL_ACPI_TABLE_ENTRY)));
+    if (Record == NULL) {
+        LBL_LOG_WARN(L"Warning: No room for an index of %u ACPI tables.\n", Tables);
+        return;
+    }
+    Record->root = RootAddress;
+    Entries = (LBL_ACPI_TABLE_ENTRY*)(Record + 1);
+
+    for (UINT32 i = 0; i < Tables; i++) {
+        CONST UINT8* Slot = Root + 36 + i * EntrySize;
+        LblAcpiIndexAdd(Record, Capacity, EntrySize == 8 ? LblReadUnaligned64(Slot) : LblReadUnaligned32(Slot));
+        if (Record->count != 0 && Entries[Record->count - 1].signature == 0x50434146 /* "FACP" */ && Fadt == 0) {
+            Fadt = (UINTN)Entries[Record->count - 1].address;
+        }
+    }
+    if (Fadt != 0) {
+        CONST UINT8* F = (CONST UINT8*)Fadt;
+        UINT32 FadtLength = LblReadUnaligned32(F + 4);
+        UINT64 X;
+        // X_FIRMWARE_CTRL / X_DSDT (ACPI 2.0+) take precedence over the 32-bit fields.
+        X = FadtLength >= 140 ? LblReadUnaligned64(F + 132) : 0;
+        LblAcpiIndexAdd(Record, Capacity, X ? X : (FadtLength >= 40 ? LblReadUnaligned32(F + 36) : 0));
+        X = FadtLength >= 148 ? LblReadUnaligned64(F + 140) : 0;
+        LblAcpiIndexAdd(Record, Capacity, X ? X : (FadtLength >= 44 ? LblReadUnaligned32(F + 40) : 0));
+    }
+
+    // Insertion sort by (signature, address): n is small and mostly grouped already.
+    for (UINT32 i = 1; i < Record->count; i++) {
+        LBL_ACPI_TABLE_ENTRY Key = Entries[i];
+        UINT32 j = i;
+        while (j > 0 && (Entries[j - 1].signature > Key.signature ||
+                         (Entries[j - 1].signature == Key.signature && Entries[j - 1].address > Key.address))) {
+            Entries[j] = Entries[j - 1];
+            j--;
+        }
+        Entries[j] = Key;
+    }
+
+    // Give back the unused slots; this record is the last one appended.
+    Used = (UINT32)(sizeof(LBL_ACPI_INDEX_RECORD) + Record->count * sizeof(LBL_ACPI_TABLE_ENTRY));
+    BootInfo->total_size -= Record->header.size - Used;
+    Record->header.size = Used;
+    LBL_LOG_DEBUG(L"  ACPI index: %u tables (%u dropped)\n", Record->count, Record->dropped);
+}
+
+/**
+ * @brief Collects the configuration tables in LblConfigTableMatches with one pass
+ * over ST->ConfigurationTable and appends them as an LBL_BOOT_RECORD_CONFIG_TABLES
+ * record, together with an EFI_RNG_PROTOCOL seed when the firmware has one.
+ * acpi_rsdp_ptr / smbios_entry_ptr are filled from the same pass.
+ */
+static VOID LblHarvestConfigTables(LBL_BOOT_INFO* BootInfo) {
+    LBL_CONFIG_TABLE_ENTRY Found[LBL_CFG_TYPE_COUNT + 1];
+    LBL_CONFIG_TABLES_RECORD* Record;
+    LBL_RNG_PROTOCOL* Rng = NULL;
+
+    BS->SetMem(Found, sizeof(Found), 0);
+    for (UINTN i = 0; i < ST->NumberOfTableEntries; i++) {
+        EFI_CONFIGURATION_TABLE* Ct = &ST->ConfigurationTable[i];
+        for (UINTN m = 0; m < sizeof(LblConfigTableMatches) / sizeof(LblConfigTableMatches[0]); m++) {
+            LBL_CONFIG_TABLE_MATCH* Match = &LblConfigTableMatches[m];
+            if (CompareGuid(&Ct->VendorGuid, &Match->Guid) &&
+                Match->Version > Found[Match->Type].version) {
+                Found[Match->Type].type = Match->Type;
+                Found[Match->Type].version = Match->Version;
+                Found[Match->Type].address = (UINT64)(UINTN)Ct->VendorTable;
+            }
+        }
+    }
+
+    BootInfo->acpi_rsdp_ptr = Found[LBL_CFG_ACPI].address;
+    BootInfo->smbios_entry_ptr = Found[LBL_CFG_SMBIOS3].address ? Found[LBL_CFG_SMBIOS3].address
+                                                                : Found[LBL_CFG_SMBIOS].address;
+    if (BootInfo->acpi_rsdp_ptr != 0) {
+        LBL_LOG_INFO(L"ACPI %u.0 RSDP found at 0x%lx\n", Found[LBL_CFG_ACPI].version, BootInfo->acpi_rsdp_ptr);
+    } else {
+        LBL_LOG_WARN(L"Warning: ACPI RSDP pointer not found in EFI Configuration Tables.\n");
+    }
+
+    Record = LblAppendBootRecord(BootInfo, LBL_BOOT_RECORD_CONFIG_TABLES, sizeof(LBL_CONFIG_TABLES_RECORD));
+    if (Record == NULL) {
+        return; // The core still has acpi_rsdp_ptr / smbios_entry_ptr
+    }
+    for (UINT32 Type = 1; Type <= LBL_CFG_TYPE_COUNT; Type++) {
+        if (Found[Type].address != 0) {
+            Record->entries[Record->count++] = Found[Type];
+        }
+    }
+    if (!EFI_ERROR(BS->LocateProtocol(&LblRngProtocolGuid, NULL, (VOID**)&Rng)) &&
+        !EFI_ERROR(Rng->GetRNG(Rng, NULL, LBL_RNG_SEED_SIZE, Record->rng_seed))) {
+        Record->rng_seed_size = LBL_RNG_SEED_SIZE;
+    }
+    LBL_LOG_DEBUG(L"  Config tables: %u, RNG seed: %u bytes\n", Record->count, Record->rng_seed_size);
+}
+
+static EFI_GUID LblDxeServicesTableGuid = LBL_DXE_SERVICES_TABLE_GUID;
+static EFI_GUID LblEdidActiveProtocolGuid = LBL_EDID_ACTIVE_PROTOCOL_GUID;
+
+/**
+ * @brief Reads the panel's preferred resolution from the first detailed timing
+ * descriptor of the EDID on the handle that carries Gop.
+ * @return TRUE if *Width / *Height were set.
+ */
+static BOOLEAN LblGopNativeResolution(EFI_GRAPHICS_OUTPUT_PROTOCOL* Gop, UINT32* Width, UINT32* Height) {
+    EFI_HANDLE* Handles = NULL;
+    UINTN HandleCount = 0;
+    BOOLEAN Found = FALSE;
+
+    if (EFI_ERROR(BS->LocateHandleBuffer(ByProtocol, &gEfiGraphicsOutputProtocolGuid, NULL, &HandleCount, &Handles))) {
+        return FALSE;
+    }
+    for (UINTN i = 0; i < HandleCount && !Found; i++) {
+        VOID* Interface = NULL;
+        LBL_EDID_ACTIVE_PROTOCOL* Edid = NULL;
+
+        if (EFI_ERROR(BS->HandleProtocol(Handles[i], &gEfiGraphicsOutputProtocolGuid, &Interface)) ||
+            Interface != Gop ||
+            EFI_ERROR(BS->HandleProtocol(Handles[i], &LblEdidActiveProtocolGuid, (VOID**)&Edid)) ||
+            Edid->SizeOfEdid < 128 || Edid->Edid == NULL) {
+            continue;
+        }
+        // Bytes 54-71: first detailed timing (the preferred mode); 0 pixel clock = not a timing.
+        if (Edid->Edid[54] != 0 || Edid->Edid[55] != 0) {
+            *Width = Edid->Edid[56] | ((UINT32)(Edid->Edid[58] & 0xF0) << 4);
+            *Height = Edid->Edid[59] | ((UINT32)(Edid->Edid[61] & 0xF0) << 4);
+            Found = (*Width != 0 && *Height != 0);
+        }
+    }
+    BS->FreePool(Handles);
+    return Found;
+}
+
+/**
+ * @brief Ranks a mode under the policy: 0 = not allowed, higher is better.
+ * The target tier (exact, then same aspect ratio) dominates; size breaks ties.
+ */
+static UINT64 LblGopModeScore(CONST LBL_GOP_POLICY* Policy, UINT32 TargetWidth, UINT32 TargetHeight,
+                              CONST EFI_GRAPHICS_OUTPUT_MODE_INFORMATION* Info) {
+    UINT64 Pixels = (UINT64)Info->HorizontalResolution * Info->VerticalResolution;
+    UINT64 Tier = 1;
+
+    if (Info->PixelFormat >= PixelBltOnly || Pixels == 0 ||
+        (Policy->max_pixels != 0 && Pixels > Policy->max_pixels)) {
+        return 0;
+    }
+    if (TargetWidth != 0 && TargetHeight != 0) {
+        if (Info->HorizontalResolution == TargetWidth && Info->VerticalResolution == TargetHeight) {
+            Tier = 3;
+        } else if ((UINT64)Info->HorizontalResolution * TargetHeight ==
+                   (UINT64)Info->VerticalResolution * TargetWidth) {
+            Tier = 2;
+        }
+    }
+    return (Tier << 48) | Pixels;
+}
+
+/**
+ * @brief Applies the LBL_NV_GOP_POLICY policy to the GOP before the framebuffer is
+ * described. The choice is cached in LBL_NV_GOP_MODE; when the cache still matches
+ * (same policy, same mode count, same resolution) a single QueryMode replaces the
+ * enumeration. A cached mode that SetMode refuses is deleted and the enumeration
+ * runs instead. SetMode is called only if the mode changes.
+ */
+static VOID LblSelectGopMode(EFI_GRAPHICS_OUTPUT_PROTOCOL* Gop) {
+    LBL_GOP_POLICY Policy = LBL_GOP_DEFAULT_POLICY;
+    LBL_GOP_MODE_CACHE Cache;
+    EFI_GRAPHICS_OUTPUT_MODE_INFORMATION* Info;
+    UINTN Size = sizeof(Policy);
+    UINTN InfoSize;
+    UINT32 TargetWidth = 0, TargetHeight = 0;
+    UINT32 Best = Gop->Mode->Mode;
+    UINT32 BestWidth = 0, BestHeight = 0;
+    UINT64 BestScore = 0;
+    EFI_STATUS Status;
+
+    if (EFI_ERROR(RS->GetVariable(LBL_NV_GOP_POLICY, &LblVendorGuid, NULL, &Size, &Policy)) ||
+        Size != sizeof(Policy)) {
+        LBL_GOP_POLICY Default = LBL_GOP_DEFAULT_POLICY;
+        Policy = Default;
+    }
+    if (Policy.kind == LBL_GOP_POLICY_KEEP || Gop->Mode->MaxMode == 0) {
+        return;
+    }
+
+    // Cached choice: trust it if nothing it depends on has changed.
+    Size = sizeof(Cache);
+    if (!EFI_ERROR(RS->GetVariable(LBL_NV_GOP_MODE, &LblVendorGuid, NULL, &Size, &Cache)) &&
+        Size == sizeof(Cache) && CompareMem(&Cache.policy, &Policy, sizeof(Policy)) == 0 &&
+        Cache.max_mode == Gop->Mode->MaxMode && Cache.mode < Gop->Mode->MaxMode &&
+        !EFI_ERROR(Gop->QueryMode(Gop, Cache.mode, &InfoSize, &Info))) {
+        BOOLEAN Valid = (Info->HorizontalResolution == Cache.width && Info->VerticalResolution == Cache.height);
+        BS->FreePool(Info);
+        if (Valid && (Cache.mode == Gop->Mode->Mode || !EFI_ERROR(Gop->SetMode(Gop, Cache.mode)))) {
+            LBL_LOG_DEBUG(L"  GOP mode %u (%ux%u, cached)\n", Cache.mode, Cache.width, Cache.height);
+            return;
+        }
+        if (Valid) {
+            // A mode the firmware now refuses must not be retried on every boot: drop
+            // it and enumerate, which caches whatever mode does work.
+            LBL_LOG_WARN(L"Warning: Cached GOP mode %u rejected; choosing again.\n", Cache.mode);
+            RS->SetVariable(LBL_NV_GOP_MODE, &LblVendorGuid, 0, 0, NULL);
+        }
+    }
+
+    if (Policy.kind == LBL_GOP_POLICY_PREFERRED) {
+        TargetWidth = Policy.width;
+        TargetHeight = Policy.height;
+    } else if (Policy.kind == LBL_GOP_POLICY_NATIVE) {
+        LblGopNativeResolution(Gop, &TargetWidth, &TargetHeight);
+    }
+    for (UINT32 Mode = 0; Mode < Gop->Mode->MaxMode; Mode++) {
+        UINT64 Score;
+        if (EFI_ERROR(Gop->QueryMode(Gop, Mode, &InfoSize, &Info))) {
+            continue;
+        }
+        Score = LblGopModeScore(&Policy, TargetWidth, TargetHeight, Info);
+        if (Score > BestScore || (Score == BestScore && Score != 0 && Mode == Gop->Mode->Mode)) {
+            BestScore = Score;
+            Best = Mode;
+            BestWidth = Info->HorizontalResolution;
+            BestHeight = Info->VerticalResolution;
+        }
+        BS->FreePool(Info);
+    }
+    if (BestScore == 0) {
+        LBL_LOG_WARN(L"Warning: No GOP mode satisfies the mode policy; keeping mode %u.\n", Gop->Mode->Mode);
+        return;
+    }
+    if (Best != Gop->Mode->Mode) {
+        Status = Gop->SetMode(Gop, Best);
+        if (EFI_ERROR(Status)) {
+            LBL_LOG_WARN(L"Warning: GOP SetMode(%u) failed; keeping mode %u. Status: %r\n", Best, Gop->Mode->Mode, Status);
+            return;
+        }
+    }
+    LBL_LOG_INFO(L"GOP mode %u: %ux%u\n", Best, BestWidth, BestHeight);
+
+    Cache.policy = Policy;
+    Cache.max_mode = Gop->Mode->MaxMode;
+    Cache.mode = Best;
+    Cache.width = BestWidth;
+    Cache.height = BestHeight;
+    Status = RS->SetVariable(LBL_NV_GOP_MODE, &LblVendorGuid,
+                             EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                             sizeof(Cache), &Cache);
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_WARN(L"  Warning: could not cache GOP mode in NVRAM. Status: %r\n", Status);
+    }
+}
+
+/**
+ * @brief Turns one GOP channel mask into a shift and a width.
+ * Masks are contiguous per the UEFI spec; a gap is treated as the end of the channel.
+ */
+static VOID LblDecodePixelMask(UINT32 Mask, UINT8* Shift, UINT8* Size) {
+    UINT8 Bit = 0;
+
+    *Shift = 0;
+    *Size = 0;
+    if (Mask == 0) {
+        return;
+    }
+    while (!(Mask & 1)) {
+        Mask >>= 1;
+        Bit++;
+    }
+    *Shift = Bit;
+    while (Mask & 1) {
+        Mask >>= 1;
+        (*Size)++;
+    }
+}
+
+/**
+ * @brief Fills the framebuffer fields of the boot info from the current GOP mode.
+ * Fixed 32 bpp formats are expressed as masks too, so the channel fields are
+ * always valid; bpp is the highest mask bit rounded up to a whole byte.
+ * PixelBltOnly modes leave framebuffer_addr at 0.
+ */
+static VOID LblDescribeFramebuffer(LBL_BOOT_INFO* BootInfo, EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE* Mode) {
+    EFI_GRAPHICS_OUTPUT_MODE_INFORMATION* Info = Mode->Info;
+    EFI_PIXEL_BITMASK Masks;
+    UINT32 AllBits;
+    UINT8 Top = 0;
+
+    BootInfo->framebuffer_addr = 0;
+    BootInfo->framebuffer_pixel_format_info = LBL_FB_FORMAT_NONE;
+    switch (Info->PixelFormat) {
+        case PixelRedGreenBlueReserved8BitPerColor:
+            Masks.RedMask = 0x000000FF;
+            Masks.GreenMask = 0x0000FF00;
+            Masks.BlueMask = 0x00FF0000;
+            Masks.ReservedMask = 0xFF000000;
+            BootInfo->framebuffer_pixel_format_info = LBL_FB_FORMAT_RGBX8888;
+            break;
+        case PixelBlueGreenRedReserved8BitPerColor:
+            Masks.RedMask = 0x00FF0000;
+            Masks.GreenMask = 0x0000FF00;
+            Masks.BlueMask = 0x000000FF;
+            Masks.ReservedMask = 0xFF000000;
+            BootInfo->framebuffer_pixel_format_info = LBL_FB_FORMAT_BGRX8888;
+            break;
+        case PixelBitMask:
+            Masks = Info->PixelInformation;
+            BootInfo->framebuffer_pixel_format_info = LBL_FB_FORMAT_BITMASK;
+            break;
+        default: // PixelBltOnly: no linear framebuffer to hand over
+            return;
+    }
+    AllBits = Masks.RedMask | Masks.GreenMask | Masks.BlueMask | Masks.ReservedMask;
+    while (AllBits != 0) {
+        AllBits >>= 1;
+        Top++;
+    }
+    if (Top == 0 || Mode->FrameBufferBase == 0) {
+        BootInfo->framebuffer_pixel_format_info = LBL_FB_FORMAT_NONE;
+        return;
+    }
+
+    LblDecodePixelMask(Masks.RedMask, &BootInfo->framebuffer_red_shift, &BootInfo->framebuffer_red_size);
+    LblDecodePixelMask(Masks.GreenMask, &BootInfo->framebuffer_green_shift, &BootInfo->framebuffer_green_size);
+    LblDecodePixelMask(Masks.BlueMask, &BootInfo->framebuffer_blue_shift, &BootInfo->framebuffer_blue_size);
+    LblDecodePixelMask(Masks.ReservedMask, &BootInfo->framebuffer_reserved_shift, &BootInfo->framebuffer_reserved_size);
+    BootInfo->framebuffer_bpp = (UINT8)((Top + 7) & ~7);
+    BootInfo->framebuffer_addr = Mode->FrameBufferBase;
+    BootInfo->framebuffer_size = Mode->FrameBufferSize;
+    BootInfo->framebuffer_width = Info->HorizontalResolution;
+    BootInfo->framebuffer_height = Info->VerticalResolution;
+    BootInfo->framebuffer_pitch = Info->PixelsPerScanLine * (BootInfo->framebuffer_bpp / 8);
+}
+
+/**
+ * @brief Asks the GCD to make the framebuffer write-combining. On x86 this
+ * reprograms the MTRRs, so it also holds under the firmware's page tables (PAT WB).
+ * Other attributes of the range are kept.
+ * @return TRUE if the attribute was applied.
+ */
+static BOOLEAN LblSetFramebufferWriteCombining(EFI_PHYSICAL_ADDRESS Base, UINT64 Size) {
+    LBL_DXE_SERVICES* Dxe = NULL;
+    LBL_GCD_MEMORY_SPACE_DESCRIPTOR Desc;
+    EFI_STATUS Status;
+    UINT64 CacheMask = EFI_MEMORY_UC | EFI_MEMORY_WC | EFI_MEMORY_WT | EFI_MEMORY_WB | EFI_MEMORY_UCE;
+
+    for (UINTN i = 0; i < ST->NumberOfTableEntries; i++) {
+        if (CompareGuid(&ST->ConfigurationTable[i].VendorGuid, &LblDxeServicesTableGuid)) {
+            Dxe = (LBL_DXE_SERVICES*)ST->ConfigurationTable[i].VendorTable;
+            break;
+        }
+    }
+    Size = (Size + EFI_PAGE_SIZE - 1) & ~((UINT64)EFI_PAGE_SIZE - 1);
+    if (Dxe == NULL || Size == 0 || EFI_ERROR(Dxe->GetMemorySpaceDescriptor(Base, &Desc))) {
+        LBL_LOG_DEBUG(L"  Framebuffer: no GCD services, caching left as is\n");
+        return FALSE;
+    }
+    if (Desc.Attributes & EFI_MEMORY_WC) {
+        return TRUE; // Firmware already did it
+    }
+    if (!(Desc.Capabilities & EFI_MEMORY_WC) || Base + Size > Desc.BaseAddress + Desc.Length) {
+        LBL_LOG_DEBUG(L"  Framebuffer: range does not support WC (caps 0x%lx)\n", Desc.Capabilities);
+        return FALSE;
+    }
+    Status = Dxe->SetMemorySpaceAttributes(Base, Size, (Desc.Attributes & ~CacheMask) | EFI_MEMORY_WC);
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_WARN(L"Warning: Could not make the framebuffer write-combining. Status: %r\n", Status);
+        return FALSE;
+    }
+    LBL_LOG_DEBUG(L"  Framebuffer: write-combining, %lu KiB\n", Size / 1024);
+    return TRUE;
+}
+
+/**
+ * @brief Copies a memory map snapshot into the boot info.
+ */
+static VOID LblPublishMemoryMap(LBL_BOOT_INFO* BootInfoStructure, CONST LBL_UEFI_MEMORY_MAP* MemoryMap) {
+    BootInfoStructure->memory_map_buffer = MemoryMap->buffer;
+    BootInfoStructure->memory_map_size = MemoryMap->map_size;
+    BootInfoStructure->memory_map_key = MemoryMap->map_key;
+    BootInfoStructure->memory_descriptor_size = MemoryMap->descriptor_size;
+    BootInfoStructure->memory_descriptor_version = MemoryMap->descriptor_version;
+    BootInfoStructure->exit_boot_services_retries = MemoryMap->retries;
+}
+
+/**
+ * @brief Appends an empty compact map record large enough for any map that fits
+ * the preallocated map buffer (or as much as the boot info area still holds).
+ * @return The record, or NULL if there is no room (the core then uses the raw map).
+ */
+static LBL_COMPACT_MEMORY_MAP_RECORD* LblReserveCompactMap(LBL_BOOT_INFO* BootInfo, CONST LBL_UEFI_MEMORY_MAP* MemoryMap) {
+    LBL_COMPACT_MEMORY_MAP_RECORD* Record;
+    UINTN Capacity = MemoryMap->buffer_size / MemoryMap->descriptor_size;
+    UINTN Available = (LblBootInfoCapacity - BootInfo->total_size - LBL_BOOT_RECORD_ALIGN -
+                       sizeof(LBL_COMPACT_MEMORY_MAP_RECORD)) / sizeof(LBL_MEMORY_RANGE);
+
+    if (LblBootInfoCapacity < BootInfo->total_size + LBL_BOOT_RECORD_ALIGN + sizeof(LBL_COMPACT_MEMORY_MAP_RECORD)) {
+        return NULL;
+    }
+    Capacity += Capacity / 8; // Descriptors longer than UINT32 pages are split
+    if (Capacity > Available) {
+        Capacity = Available;
+    }
+    Record = LblAppendBootRecord(BootInfo, LBL_BOOT_RECORD_MEMORY_MAP,
+                                 (UINT32)(sizeof(LBL_COMPACT_MEMORY_MAP_RECORD) + Capacity * sizeof(LBL_MEMORY_RANGE)));
+    if (Record != NULL) {
+        Record->capacity = (UINT32)Capacity;
+    }
+    return Record;
+}
+
+/**
+ * @brief Maps an EFI memory type to its LBL_MEM_* class as seen after ExitBootServices.
+ */
+static UINT32 LblCompactMemoryType(UINT32 EfiType) {
+    switch (EfiType) {
+        case EfiConventionalMemory:
+        case EfiBootServicesCode:
+        case EfiBootServicesData:
+            return LBL_MEM_USABLE;
+        case EfiLoaderCode:
+        case EfiLoaderData:
+            return LBL_MEM_LOADER;
+        case EfiACPIReclaimMemory:
+            return LBL_MEM_ACPI_RECLAIM;
+        case EfiACPIMemoryNVS:
+            return LBL_MEM_ACPI_NVS;
+        case EfiRuntimeServicesCode:
+        case EfiRuntimeServicesData:
+            return LBL_MEM_RUNTIME;
+        case EfiMemoryMappedIO:
+        case EfiMemoryMappedIOPortSpace:
+            return LBL_MEM_MMIO;
+        case 14: // EfiPersistentMemory (UEFI 2.5, missing from older gnu-efi headers)
+            return LBL_MEM_PERSISTENT;
+        default:
+            break;
+    }
+    if (EfiType == (UINT32)LBL_MEMORY_TYPE_CORE) {
+        return LBL_MEM_LOADER;
+    }
+    if (EfiType == (UINT32)LBL_MEMORY_TYPE_CORE_HEAP) {
+        return LBL_MEM_CORE_HEAP;
+    }
+    return LBL_MEM_RESERVED;
+}
+
+/**
+ * @brief Fills a reserved compact map from the final memory map: convert, sort by
+ * base (insertion sort; firmware maps are nearly sorted), then merge neighbours.
+ * Touches memory only, so it runs after ExitBootServices. On overflow the record
+ * is left with count 0.
+ */
+static VOID LblBuildCompactMap(LBL_COMPACT_MEMORY_MAP_RECORD* Record, CONST LBL_UEFI_MEMORY_MAP* MemoryMap) {
+    LBL_MEMORY_RANGE* Ranges;
+    UINTN Count = 0;
+    UINTN Offset, i, j;
+
+    if (Record == NULL) {
+        return;
+    }
+    Ranges = (LBL_MEMORY_RANGE*)(Record + 1);
+    Record->count = 0;
+
+    for (Offset = 0; Offset + MemoryMap->descriptor_size <= MemoryMap->map_size; Offset += MemoryMap->descriptor_size) {
+        CONST EFI_MEMORY_DESCRIPTOR* Desc = (CONST EFI_MEMORY_DESCRIPTOR*)((CONST UINT8*)MemoryMap->buffer + Offset);
+        UINT64 Base = Desc->PhysicalStart;
+        UINT64 Pages = Desc->NumberOfPages;
+        UINT32 Type = LblCompactMemoryType(Desc->Type);
+
+        while (Pages != 0) {
+            UINT32 Chunk = Pages > 0xFFFFFFFF ? 0xFFFFFFFF : (UINT32)Pages;
+            LBL_MEMORY_RANGE Range;
+
+            if (Count == Record->capacity) {
+                return; // Incomplete: leave count at 0
+            }
+            Range.base = Base;
+            Range.pages = Chunk;
+            Range.type = Type;
+            for (j = Count; j > 0 && Ranges[j - 1].base > Range.base; j--) {
+                Ranges[j] = Ranges[j - 1];
+            }
+            Ranges[j] = Range;
+            Count++;
+            Base += (UINT64)Chunk * EFI_PAGE_SIZE;
+            Pages -= Chunk;
+        }
+    }
+
+    for (i = 0, j = 0; i < Count; i++) {
+        if (j != 0 &&
+            Ranges[j - 1].type == Ranges[i].type &&
+            Ranges[j - 1].base + (UINT64)Ranges[j - 1].pages * EFI_PAGE_SIZE == Ranges[i].base &&
+            (UINT64)Ranges[j - 1].pages + Ranges[i].pages <= 0xFFFFFFFF) {
+            Ranges[j - 1].pages += Ranges[i].pages;
+        } else {
+            Ranges[j++] = Ranges[i];
+        }
+    }
+    Record->count = (UINT32)j;
+}
+
+/**
+ * @brief Reserves the core's heap arena. The size comes from LBL_NV_CORE_HEAP_SIZE,
+ * else the core header, else LBL_CORE_HEAP_DEFAULT_SIZE. If that much contiguous
+ * memory is not free, the request is halved down to LBL_CORE_HEAP_MIN_SIZE.
+ * Without an arena (*Size = 0) the core claims memory from the map itself.
+ */
+static VOID LblAllocateCoreHeap(CONST LBL_CORE_IMAGE* Core, EFI_PHYSICAL_ADDRESS* Base, UINT64* Size) {
+    UINT64 Request = Core->heap_size ? Core->heap_size : LBL_CORE_HEAP_DEFAULT_SIZE;
+    UINT64 Override = 0;
+    UINTN VarSize = sizeof(Override);
+
+    *Base = 0;
+    *Size = 0;
+    if (!EFI_ERROR(RS->GetVariable(LBL_NV_CORE_HEAP_SIZE, &LblVendorGuid, NULL, &VarSize, &Override)) &&
+        VarSize == sizeof(Override)) {
+        Request = Override;
+    }
+    if (Request == 0) {
+        return; // Explicitly disabled
+    }
+    Request = (Request + LBL_CORE_HEAP_ALIGNMENT - 1) & ~(LBL_CORE_HEAP_ALIGNMENT - 1);
+
+    for (; Request >= LBL_CORE_HEAP_MIN_SIZE; Request /= 2) {
+        if (!EFI_ERROR(LblAllocateAlignedPages(LBL_MEMORY_TYPE_CORE_HEAP, 0, (UINTN)EFI_SIZE_TO_PAGES(Request),
+                                               LBL_CORE_HEAP_ALIGNMENT, Base))) {
+            *Size = Request;
+            LBL_LOG_DEBUG(L"  Core heap arena: %lu KiB at 0x%lx\n", Request / 1024, *Base);
+            return;
+        }
+    }
+    LBL_LOG_WARN(L"Warning: No core heap arena reserved; the core will claim its own memory.\n");
+}
+
+// Whole page-table pool as allocated; page_table_pages only counts the used part.
+static EFI_PHYSICAL_ADDRESS LblPageTablePool = 0;
+static UINTN LblPageTablePoolPages = 0;
+
+/**
+ * @brief Builds identity + higher-half page tables for a core that asked for them
+ * (LBL_CORE_HEADER_FLAG_PAGE_TABLES); efi_main loads them right before the jump.
+ * The range covers every memory map entry and at least 4 GiB (LAPIC/IOAPIC MMIO
+ * is often not in the map). The framebuffer is mapped write-combining: a WC PAT
+ * entry overrides the UC MTRR firmware usually puts on it, whereas everything
+ * else stays WB in the PAT and keeps whatever the MTRRs say.
+ * On failure page_table_root stays 0 and the core runs on the firmware's tables.
+ */
+static VOID LblPreparePageTables(LBL_BOOT_INFO* BootInfo) {
+    EFI_MEMORY_DESCRIPTOR* Map = NULL;
+    UINTN MapSize, MapKey, DescriptorSize;
+    UINT32 DescriptorVersion;
+    LBL_PAGING_PLAN Plan;
+    EFI_PHYSICAL_ADDRESS Pool;
+    UINTN Offset;
+
+    if (!lbl_paging_cpu_supported()) {
+        LBL_LOG_WARN(L"Warning: Page tables requested, but the CPU is not in 4-level long mode.\n");
+        return;
+    }
+    BS->SetMem(&Plan, sizeof(Plan), 0);
+    Plan.top = 0x100000000ULL;
+    if (EFI_ERROR(lbl_uefi_get_memory_map(&Map, &MapSize, &MapKey, &DescriptorSize, &DescriptorVersion))) {
+        LBL_LOG_WARN(L"Warning: No memory map for the page tables; mapping 4 GiB.\n");
+    } else {
+        for (Offset = 0; Offset + DescriptorSize <= MapSize; Offset += DescriptorSize) {
+            EFI_MEMORY_DESCRIPTOR* Desc = (EFI_MEMORY_DESCRIPTOR*)((UINT8*)Map + Offset);
+            UINT64 End = Desc->PhysicalStart + EFI_PAGES_TO_SIZE(Desc->NumberOfPages);
+            if (End > Plan.top) {
+                Plan.top = End;
+            }
+        }
+        BS->FreePool(Map);
+    }
+    if (BootInfo->framebuffer_addr != 0 && BootInfo->framebuffer_size != 0) {
+        Plan.wc_base = BootInfo->framebuffer_addr & ~(LBL_PAGING_4K - 1);
+        Plan.wc_size = ((BootInfo->framebuffer_addr + BootInfo->framebuffer_size + LBL_PAGING_4K - 1) &
+                        ~(LBL_PAGING_4K - 1)) - Plan.wc_base;
+        if (Plan.wc_base + Plan.wc_size > Plan.top) {
+            Plan.top = Plan.wc_base + Plan.wc_size;
+        }
+    }
+    Plan.use_1g = lbl_paging_cpu_has_1g_pages();
+    Plan.pool_pages = lbl_paging_tables_needed(&Plan);
+    Pool = 0xFFFFFFFF; // The AP trampoline loads CR3 from 32-bit code
+
+    if (Plan.top > LBL_PAGING_MAX_TOP ||
+        EFI_ERROR(BS->AllocatePages(AllocateMaxAddress, EfiLoaderData, Plan.pool_pages, &Pool))) {
+        LBL_LOG_WARN(L"Warning: Could not allocate page tables for 0x%lx bytes.\n", Plan.top);
+        return;
+    }
+    Plan.pool = (lbl_u8*)(UINTN)Pool;
+    if (lbl_paging_build(&Plan) != 0) {
+        LBL_LOG_WARN(L"Warning: Page table build failed; keeping the firmware's tables.\n");
+        BS->FreePages(Pool, Plan.pool_pages);
+        return;
+    }
+
+    LblPageTablePool = Pool;
+    LblPageTablePoolPages = Plan.pool_pages;
+    BootInfo->page_table_root = Plan.root;
+    BootInfo->page_table_top = Plan.top;
+    BootInfo->higher_half_base = LBL_PAGING_HIGHER_HALF_BASE;
+    BootInfo->page_table_pages = (UINT32)Plan.used_pages;
+    BootInfo->page_table_flags = (Plan.use_1g ? LBL_PAGING_FLAG_1G_PAGES : 0) |
+                                 (Plan.wc_size ? LBL_PAGING_FLAG_WC_FRAMEBUFFER : 0);
+    LBL_LOG_DEBUG(L"  Page tables: %u pages at 0x%lx, top 0x%lx, %s pages\n", (UINT32)Plan.used_pages,
+        Plan.root, Plan.top, Plan.use_1g ? L"1 GiB" : L"2 MiB");
+}
+
+/**
+ * @brief Returns the page-table pool when the boot info is dropped before the jump.
+ */
+static VOID LblFreePageTables(VOID) {
+    if (LblPageTablePoolPages != 0) {
+        BS->FreePages(LblPageTablePool, LblPageTablePoolPages);
+        LblPageTablePool = 0;
+        LblPageTablePoolPages = 0;
+    }
+}
+
+// AP bring-up state carried from LblPrepareProcessors to LblStartProcessors.
+static LBL_MP_RECORD* LblMpRecord = NULL;
+static UINT8* LblMpTrampoline = NULL;
+static UINTN LblMpApCount = 0;
+static EFI_GUID LblMpServicesProtocolGuid = LBL_MP_SERVICES_PROTOCOL_GUID;
+
+// Time the BSP waits for the APs to reach their mailboxes after the SIPIs.
+#define LBL_MP_PARK_TIMEOUT_US      100000
+
+/**
+ * @brief Records every CPU's APIC ID and topology from EFI_MP_SERVICES_PROTOCOL.
+ * For a core with LBL_CORE_HEADER_FLAG_PARK_APS it also allocates what the APs
+ * need after ExitBootServices: a trampoline page below 1 MiB (LoaderCode), one
+ * mailbox per enabled AP and a stack each (LoaderData). The APs are started by
+ * LblStartProcessors; MP services cannot be used for that, since the firmware
+ * resets or re-parks the APs when boot services exit.
+ */
+static VOID LblPrepareProcessors(LBL_BOOT_INFO* BootInfo, CONST LBL_CORE_IMAGE* Core) {
+    LBL_MP_SERVICES_PROTOCOL* Mp = NULL;
+    LBL_CPU_ENTRY* Cpus;
+    UINTN Total = 0, Enabled = 0, Aps = 0;
+    UINT32* ApicIds = NULL;
+    EFI_PHYSICAL_ADDRESS Address;
+    UINTN BlockSize;
+
+    if (EFI_ERROR(BS->LocateProtocol(&LblMpServicesProtocolGuid, NULL, (VOID**)&Mp)) ||
+        EFI_ERROR(Mp->GetNumberOfProcessors(Mp, &Total, &Enabled)) || Total == 0) {
+        LBL_LOG_DEBUG(L"  MP services unavailable; no processor topology\n");
+        return;
+    }
+    LblMpRecord = LblAppendBootRecord(BootInfo, LBL_BOOT_RECORD_MP,
+                                      (UINT32)(sizeof(LBL_MP_RECORD) + Total * sizeof(LBL_CPU_ENTRY)));
+    if (LblMpRecord == NULL) {
+        LBL_LOG_WARN(L"Warning: No room to record %u processors.\n", (UINT32)Total);
+        return;
+    }
+    Cpus = (LBL_CPU_ENTRY*)(LblMpRecord + 1);
+    for (UINTN i = 0; i < Total; i++) {
+        LBL_MP_PROCESSOR_INFORMATION Info;
+        LBL_CPU_ENTRY* Cpu = &Cpus[LblMpRecord->count];
+
+        if (EFI_ERROR(Mp->GetProcessorInfo(Mp, i, &Info))) {
+            continue;
+        }
+        Cpu->apic_id = (UINT32)Info.ProcessorId;
+        Cpu->package = Info.Package;
+        Cpu->core = Info.Core;
+        Cpu->thread = Info.Thread;
+        Cpu->flags = ((Info.StatusFlag & LBL_MP_PROCESSOR_AS_BSP) ? LBL_CPU_FLAG_BSP : 0) |
+                     ((Info.StatusFlag & LBL_MP_PROCESSOR_ENABLED) ? LBL_CPU_FLAG_ENABLED : 0) |
+                     ((Info.StatusFlag & LBL_MP_PROCESSOR_HEALTHY) ? LBL_CPU_FLAG_HEALTHY : 0);
+        Cpu->mailbox = LBL_CPU_NO_MAILBOX;
+        LblMpRecord->count++;
+    }
+    LBL_LOG_INFO(L"Processors: %u (%u enabled)\n", LblMpRecord->count, (UINT32)Enabled);
+
+    if (!(Core->header_flags & LBL_CORE_HEADER_FLAG_PARK_APS) || lbl_mp_trampoline_size() == 0) {
+        return;
+    }
+    // Mailboxes only for APs that are enabled and healthy; nothing else gets a SIPI.
+    if (EFI_ERROR(BS->AllocatePool(EfiLoaderData, LblMpRecord->count * sizeof(UINT32), (VOID**)&ApicIds))) {
+        return;
+    }
+    for (UINT32 i = 0; i < LblMpRecord->count; i++) {
+        UINT32 Want = LBL_CPU_FLAG_ENABLED | LBL_CPU_FLAG_HEALTHY;
+        if (!(Cpus[i].flags & LBL_CPU_FLAG_BSP) && (Cpus[i].flags & Want) == Want) {
+            Cpus[i].mailbox = (UINT32)Aps;
+            ApicIds[Aps++] = Cpus[i].apic_id;
+        }
+    }
+    if (Aps == 0) {
+        BS->FreePool(ApicIds);
+        return;
+    }
+
+    // Trampoline: a SIPI vector names a page below 1 MiB. Page 0 is refused, since
+    // firmware page tables often leave it unmapped to catch NULL dereferences.
+    Address = 0x9FFFF;
+    if (EFI_ERROR(BS->AllocatePages(AllocateMaxAddress, EfiLoaderCode, 1, &Address)) || Address == 0) {
+        LBL_LOG_WARN(L"Warning: No page below 1 MiB for the AP trampoline; APs stay in firmware.\n");
+        BS->FreePool(ApicIds);
+        return; // A page 0 allocation is kept: nothing else should get it either
+    }
+    LblMpTrampoline = (UINT8*)(UINTN)Address;
+
+    BlockSize = sizeof(LBL_MP_PARK_BLOCK) + Aps * sizeof(LBL_AP_MAILBOX);
+    if (!EFI_ERROR(BS->AllocatePages(AllocateAnyPages, EfiLoaderData, EFI_SIZE_TO_PAGES(BlockSize), &Address))) {
+        LblMpRecord->park_block = Address;
+        if (!EFI_ERROR(BS->AllocatePages(AllocateAnyPages, EfiLoaderData,
+                                         EFI_SIZE_TO_PAGES(Aps * LBL_AP_STACK_SIZE), &Address))) {
+            LblMpRecord->stacks = Address;
+            LblMpRecord->stack_size = LBL_AP_STACK_SIZE;
+        } else {
+            BS->FreePages(LblMpRecord->park_block, EFI_SIZE_TO_PAGES(BlockSize));
+            LblMpRecord->park_block = 0;
+        }
+    }
+    if (LblMpRecord->park_block == 0) {
+        LBL_LOG_WARN(L"Warning: Could not allocate AP mailboxes and stacks; APs stay in firmware.\n");
+        for (UINT32 i = 0; i < LblMpRecord->count; i++) {
+            Cpus[i].mailbox = LBL_CPU_NO_MAILBOX;
+        }
+        BS->FreePages((EFI_PHYSICAL_ADDRESS)(UINTN)LblMpTrampoline, 1);
+        LblMpTrampoline = NULL;
+        BS->FreePool(ApicIds);
+        return;
+    }
+    lbl_mp_init_park_block((LBL_MP_PARK_BLOCK*)(UINTN)LblMpRecord->park_block, ApicIds, NULL, (lbl_u32)Aps);
+    BS->FreePool(ApicIds);
+    LblMpApCount = Aps;
+    LBL_LOG_DEBUG(L"  %u AP mailboxes, trampoline at 0x%lx\n", (UINT32)Aps, (UINT64)(UINTN)LblMpTrampoline);
+}
+
+/**
+ * @brief Returns the trampoline, mailbox and stack pages of LblPrepareProcessors
+ * when the boot info is dropped before the jump. The MP record itself lives in
+ * the boot info area and goes with it.
+ */
+static VOID LblFreeProcessors(VOID) {
+    if (LblMpApCount != 0) {
+        BS->FreePages(LblMpRecord->stacks, EFI_SIZE_TO_PAGES(LblMpApCount * LBL_AP_STACK_SIZE));
+        BS->FreePages(LblMpRecord->park_block,
+                      EFI_SIZE_TO_PAGES(sizeof(LBL_MP_PARK_BLOCK) + LblMpApCount * sizeof(LBL_AP_MAILBOX)));
+        BS->FreePages((EFI_PHYSICAL_ADDRESS)(UINTN)LblMpTrampoline, 1);
+        LblMpApCount = 0;
+    }
+    LblMpRecord = NULL;
+    LblMpTrampoline = NULL;
+}
+
+/**
+ * @brief Starts the APs prepared by LblPrepareProcessors and waits for them to
+ * park. Runs after ExitBootServices, on the CR3 the core will get.
+ */
+static VOID LblStartProcessors(VOID) {
+    LBL_MP_PARK_BLOCK* Block;
+
+    if (LblMpRecord == NULL || LblMpRecord->park_block == 0) {
+        return;
+    }
+    Block = (LBL_MP_PARK_BLOCK*)(UINTN)LblMpRecord->park_block;
+    if (lbl_mp_prepare_trampoline(LblMpTrampoline, Block, (lbl_u8*)(UINTN)LblMpRecord->stacks) != 0) {
+        LblMpRecord->park_block = 0; // CR3 above 4 GiB or 5-level paging: leave the APs alone
+        return;
+    }
+    LblMpRecord->parked = lbl_mp_wake_aps(LblMpTrampoline, Block,
+                                          LblTimeline->ticks_per_second,
+                                          LBL_MP_PARK_TIMEOUT_US);
+    LblTimelineMark(LBL_TL_APS_PARKED, LblMpRecord->parked);
+}
+
+/**
+ * @brief Appends the module table for the files LblPreloadModules read, so the
+ * core can serve them from memory instead of mounting the volume again.
+ */
+static VOID LblPublishModules(LBL_BOOT_INFO* BootInfo) {
+    LBL_MODULES_RECORD* Record;
+    UINT32 Size;
+
+    if (LblModuleCount == 0 && LblModulesSkipped == 0) {
+        return; // No manifest
+    }
+    Size = (UINT32)(sizeof(LBL_MODULES_RECORD) + LblModuleCount * sizeof(LBL_MODULE_ENTRY));
+    Record = (LBL_MODULES_RECORD*)LblAppendBootRecord(BootInfo, LBL_BOOT_RECORD_MODULES, Size);
+    if (Record == NULL) {
+        LBL_LOG_WARN(L"Warning: No room for the preloaded module table.\n");
+        return;
+    }
+    Record->count = LblModuleCount;
+    Record->skipped = LblModulesSkipped;
+    BS->CopyMem(Record + 1, LblModules, LblModuleCount * sizeof(LBL_MODULE_ENTRY));
+}
+
+/**
+ * @brief Appends the segment list of an ELF/PE core (flat cores have none), so
+ * the core can give each segment its own page permissions.
+ */
+static VOID LblPublishCoreSegments(LBL_BOOT_INFO* BootInfo, CONST LBL_CORE_IMAGE* Core) {
+    LBL_CORE_SEGMENTS_RECORD* Record;
+    UINT32 Size;
+
+    if (Core->segment_count == 0) {
+        return;
+    }
+    Size = (UINT32)(sizeof(LBL_CORE_SEGMENTS_RECORD) + Core->segment_count * sizeof(LBL_CORE_SEGMENT));
+    Record = (LBL_CORE_SEGMENTS_RECORD*)LblAppendBootRecord(BootInfo, LBL_BOOT_RECORD_CORE_SEGMENTS, Size);
+    if (Record == NULL) {
+        LBL_LOG_WARN(L"Warning: No room for the core segment table.\n");
+        return;
+    }
+    Record->format = Core->format;
+    Record->count = Core->segment_count;
+    BS->CopyMem(Record + 1, (VOID*)Core->segments, Core->segment_count * sizeof(LBL_CORE_SEGMENT));
+}
+
+/**
+ * @brief Appends the table of stage1_mem routines (already dispatched for this
+ * CPU). They stay valid after ExitBootServices: they live in this image.
+ */
+static VOID LblPublishMemOps(LBL_BOOT_INFO* BootInfo) {
+    LBL_MEM_OPS_RECORD* Record;
+
+    Record = (LBL_MEM_OPS_RECORD*)LblAppendBootRecord(BootInfo, LBL_BOOT_RECORD_MEM_OPS,
+                                                      sizeof(LBL_MEM_OPS_RECORD) + sizeof(LBL_MEM_OPS));
+    if (Record == NULL) {
+        LBL_LOG_WARN(L"Warning: No room for the memory routine table.\n");
+        return;
+    }
+    lbl_mem_describe((LBL_MEM_OPS*)(Record + 1));
+    LBL_LOG_DEBUG(L"Memory routines: features 0x%x.\n", ((LBL_MEM_OPS*)(Record + 1))->features);
+}
+
+/**
+ * @brief Appends which slot the core was booted from and why earlier slots were
+ * passed over, for the core to report and to confirm the boot with.
+ */
+static VOID LblPublishCoreSlot(LBL_BOOT_INFO* BootInfo, CONST LBL_CORE_IMAGE* Core) {
+    LBL_CORE_SLOT_RECORD* Record;
+
+    Record = (LBL_CORE_SLOT_RECORD*)LblAppendBootRecord(BootInfo, LBL_BOOT_RECORD_CORE_SLOT,
+                                                        sizeof(LBL_CORE_SLOT_RECORD));
+    if (Record == NULL) {
+        LBL_LOG_WARN(L"Warning: No room for the core slot record.\n");
+        return;
+    }
+    Record->slot = Core->slot;
+    Record->preferred = LblCoreSlotState.preferred;
+    Record->attempts = LblCoreSlotState.attempts;
+    Record->max_attempts = LblCoreSlotMaxAttempts();
+    Record->flags = LblCoreSlotFlags;
+    BS->CopyMem(Record->failures, LblCoreSlotFailures, sizeof(Record->failures));
+}
+
+/**
+ * @brief Appends a text console over the framebuffer described in BootInfo (and
+ * COM1 on x86), for the last Stage 1 messages after ExitBootServices and for the
+ * core until its GUI is up. Nothing is drawn yet: the first write clears the screen.
+ */
+static VOID LblPublishEarlyConsole(LBL_BOOT_INFO* BootInfo) {
+    LBL_EARLY_CONSOLE_RECORD* Record;
+    LBL_FBCON_MODE Mode;
+    LBL_FBCON Console;
+    EFI_PHYSICAL_ADDRESS Cache = 0;
+    EFI_STATUS Status;
+
+    BS->SetMem(&Mode, sizeof(Mode), 0);
+    if (BootInfo->framebuffer_addr != 0) {
+        Mode.base = BootInfo->framebuffer_addr;
+        Mode.width = BootInfo->framebuffer_width;
+        Mode.height = BootInfo->framebuffer_height;
+        Mode.pitch = BootInfo->framebuffer_pitch;
+        Mode.bpp = BootInfo->framebuffer_bpp;
+        Mode.red_shift = BootInfo->framebuffer_red_shift;
+        Mode.red_size = BootInfo->framebuffer_red_size;
+        Mode.green_shift = BootInfo->framebuffer_green_shift;
+        Mode.green_size = BootInfo->framebuffer_green_size;
+        Mode.blue_shift = BootInfo->framebuffer_blue_shift;
+        Mode.blue_size = BootInfo->framebuffer_blue_size;
+        Status = BS->AllocatePages(AllocateAnyPages, EfiLoaderData,
+                                   EFI_SIZE_TO_PAGES(LBL_FBCON_CACHE_SIZE), &Cache);
+        if (EFI_ERROR(Status)) {
+            LBL_LOG_WARN(L"Warning: No memory for the console glyph cache. Status: %r\n", Status);
+            Cache = 0;
+        }
+    }
+
+    if (lbl_fbcon_init(&Console, &Mode, (VOID*)(UINTN)Cache, Cache != 0 ? LBL_FBCON_CACHE_SIZE : 0) != 0) {
+        LBL_LOG_INFO(L"No early console for the core (no 32 bpp framebuffer, no UART).\n");
+        if (Cache != 0) {
+            BS->FreePages(Cache, EFI_SIZE_TO_PAGES(LBL_FBCON_CACHE_SIZE));
+        }
+        return;
+    }
+    if (Cache != 0 && !(Console.flags & LBL_FBCON_FLAG_FRAMEBUFFER)) {
+        BS->FreePages(Cache, EFI_SIZE_TO_PAGES(LBL_FBCON_CACHE_SIZE)); // Framebuffer not usable: UART only
+        Cache = 0;
+    }
+
+    Record = (LBL_EARLY_CONSOLE_RECORD*)LblAppendBootRecord(BootInfo, LBL_BOOT_RECORD_EARLY_CONSOLE,
+                                                            sizeof(LBL_EARLY_CONSOLE_RECORD) + sizeof(LBL_FBCON));
+    if (Record == NULL) {
+        LBL_LOG_WARN(L"Warning: No room for the early console record.\n");
+        if (Cache != 0) {
+            BS->FreePages(Cache, EFI_SIZE_TO_PAGES(LBL_FBCON_CACHE_SIZE));
+        }
+        return;
+    }
+    // The state holds no pointer to itself, so it can move into the record.
+    BS->CopyMem(Record + 1, &Console, sizeof(Console));
+    LblEarlyConsole = (LBL_FBCON*)(Record + 1);
+    LblEarlyConsoleCache = Cache;
+    LBL_LOG_DEBUG(L"Early console: %ux%u cells, flags 0x%x.\n",
+        LblEarlyConsole->columns, LblEarlyConsole->rows, LblEarlyConsole->flags);
+}
+
+/**
+ * @brief Gathers system information into a boot info from LblAllocateBootInfo().
+ * MemoryMap receives the preallocated map buffer later used for ExitBootServices.
+ */
+EFI_STATUS PrepareBootInfoForCore(LBL_BOOT_INFO* BootInfoStructure, LBL_CORE_IMAGE* Core,
+                                  LBL_UEFI_MEMORY_MAP* MemoryMap) {
+    EFI_STATUS Status;
+    EFI_GRAPHICS_OUTPUT_PROTOCOL *Gop = NULL;
+
+    if (!BootInfoStructure) return EFI_INVALID_PARAMETER;
+    // Header fields (magic, version, sizes) were set by LblAllocateBootInfo.
+
+    // Steps 1-2 only read firmware state, so they run while an asynchronous core
+    // read (if any) is still in flight.
+
+    // 1. Get Graphics/Framebuffer Information
+    Status = BS->LocateProtocol(&gEfiGraphicsOutputProtocolGuid, NULL, (VOID **)&Gop);
+    if (!EFI_ERROR(Status) && Gop != NULL && Gop->Mode != NULL && Gop->Mode->Info != NULL) {
+        LblSelectGopMode(Gop);
+        LblDescribeFramebuffer(BootInfoStructure, Gop->Mode);
+    }
+    if (BootInfoStructure->framebuffer_addr == 0) {
+        LBL_LOG_WARN(L"Warning: Graphics Output Protocol not found or invalid. Framebuffer info unavailable. Status: %r\n", Status);
+        // Core will have to manage without direct framebuffer from Stage1 or use basic VGA if available
+    } else if (LblSetFramebufferWriteCombining(BootInfoStructure->framebuffer_addr,
+                                               BootInfoStructure->framebuffer_size)) {
+        BootInfoStructure->framebuffer_flags |= LBL_FB_FLAG_WRITE_COMBINING;
+    }
+
+    // 2. Firmware tables (ACPI, SMBIOS, device tree, ...) and an RNG seed
+    LblHarvestConfigTables(BootInfoStructure);
+    LblBuildAcpiIndex(BootInfoStructure);
+
+    // Calibrate the timeline clock here: the stall overlaps any read still in flight.
+    LblTimeline->ticks_per_second = LblCalibrateCycleCounter();
+
+    // 3. Wait for the core. This is the only point where an asynchronous read
+    //    is waited on; everything from here on needs the image in memory.
+    Status = LblCompleteCoreLoad(Core);
+    if (EFI_ERROR(Status)) {
+        Status = LblFailOverCore(Core, Status);
+    }
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_ERROR(L"Error: LBL Core read did not complete. Status: %r\n", Status);
+        return Status;
+    }
+
+    // Store Core Engine load info
+    BootInfoStructure->core_load_addr = Core->load_addr;
+    BootInfoStructure->core_size = Core->file_size;
+    BootInfoStructure->core_entry_offset = Core->entry_offset; // Header / ELF / PE entry, or LBL_CORE_ENTRY_OFFSET
+    BootInfoStructure->core_load_alignment = Core->alignment;
+    BootInfoStructure->core_compressed_size = Core->compressed_size;
+    BootInfoStructure->core_decompress_ticks = Core->decompress_ticks;
+    BS->CopyMem(BootInfoStructure->core_sha256, Core->sha256, LBL_CORE_DIGEST_SIZE);
+    BootInfoStructure->core_verify_flags = Core->verify_flags;
+    BootInfoStructure->core_manifest_addr = (UINT64)(UINTN)Core->manifest;
+    BootInfoStructure->core_manifest_size = Core->manifest_size;
+
+    LblAllocateCoreHeap(Core, &BootInfoStructure->core_heap_addr, &BootInfoStructure->core_heap_size);
+    if (Core->header_flags & LBL_CORE_HEADER_FLAG_PAGE_TABLES) {
+        LblPreparePageTables(BootInfoStructure); // Needs the framebuffer from step 1
+    }
+    LblPrepareProcessors(BootInfoStructure, Core);
+    LblPublishModules(BootInfoStructure);
+    LblPublishCoreSegments(BootInfoStructure, Core);
+    LblPublishMemOps(BootInfoStructure);
+    LblPublishCoreSlot(BootInfoStructure, Core);
+    LblPublishEarlyConsole(BootInfoStructure);
+
+    // Later messages still land in the ring; the core replays it after taking over.
+    BootInfoStructure->stage1_log_addr = (UINT64)(UINTN)lbl_uefi_log_ring();
+    BootInfoStructure->stage1_log_size = sizeof(LBL_UEFI_LOG_RING);
+
+    // 4. Get Memory Map (last: this allocates the one buffer ExitBootServices reuses)
+    //    The actual memory map buffer will be pointed to by BootInfoStructure->memory_map_buffer
+    Status = lbl_uefi_memory_map_prepare(MemoryMap);
+    if (EFI_ERROR(Status)) {
+        LBL_LOG_ERROR(L"Error: Failed to get UEFI Memory Map. Status: %r\n", Status);
+        return Status;
+    }
+    LblPublishMemoryMap(BootInfoStructure, MemoryMap);
+
+    // 5. Other information (e.g., boot drive, command line if LBL EFI app took one) can be added.
     // BootInfoStructure->boot_drive_signature = ...; // If identifiable
 
     return EFI_SUCCESS;
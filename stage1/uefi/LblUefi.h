@@ -9,27 +9,304 @@
 // This structure is prepared by the UEFI Stage 1 loader (LblUefi.c)
 // and passed to the LBL Core Engine (Rust).
 // The Rust Core Engine must have a compatible #[repr(C)] struct to receive this.
+// boot_32 (BIOS) builds the same layout from stage1_loader_utils.h; change both.
 
 #define LBL_BOOT_INFO_MAGIC_VALUE   0x4C424C42494E464F // "LBLBINFO" (LionBootLoaderBootINFO)
-#define LBL_BOOT_INFO_VERSION       0x00010000       // Version 1.0
+#define LBL_BOOT_INFO_VERSION       0x00010001       // Version 1.1: records appended up to total_size
 
 // Define the offset of the entry point within the loaded LBL Core binary.
 // If lbl_core.bin is a flat binary loaded to run from its start, this is 0.
-// If lbl_core.bin is an ELF and _start is not at offset 0, this would be non-zero.
+// ELF64 and PE32+ cores are entered at their own entry point instead (e_entry /
+// AddressOfEntryPoint, see stage1_image.h).
 // For a flat Rust binary (e.g., from x86_64-unknown-none target), _start is often at 0.
 #define LBL_CORE_ENTRY_OFFSET       0x0
 
+// --- LBL Core Image Header ---
+// Optional header at file offset 0 of lbl_core.bin. When present, Stage 1 allocates
+// pages at (or aligned for) the core's preferred physical base and reads the file
+// straight into its final location. Images without the header are treated as flat
+// binaries entered at LBL_CORE_ENTRY_OFFSET and placed on any page boundary.
+// ELF64 / PE32+ cores get the placement fields from their program headers and may
+// embed this header (as an ELF note or a PE section, see stage1_image.h) for the rest.
+#define LBL_CORE_HEADER_MAGIC       0x4C424C434F524531 // "LBLCORE1"
+
+#define LBL_CORE_HEADER_FLAG_FIXED_ADDRESS  0x00000001 // Fail instead of relocating if preferred_base is taken
+#define LBL_CORE_HEADER_FLAG_PAGE_TABLES    0x00000002 // Enter the core on Stage 1's page tables (x86_64)
+#define LBL_CORE_HEADER_FLAG_PARK_APS       0x00000004 // Start the APs and park them on mailboxes (x86_64)
+
+typedef struct {
+    UINT64 magic;                   // LBL_CORE_HEADER_MAGIC
+    UINT32 header_size;             // sizeof this header as built; newer headers may be larger
+    UINT32 flags;                   // LBL_CORE_HEADER_FLAG_*
+    UINT64 preferred_base;          // Physical address the core wants to run at (0 = anywhere)
+    UINT64 alignment;               // Required load alignment, power of two (0 = EFI_PAGE_SIZE)
+    UINT64 max_address;             // Highest address the image may end at when relocated (0 = no limit)
+    UINT64 entry_offset;            // Entry point, relative to the load address
+    UINT64 memory_size;             // Bytes to reserve (>= file size; the excess is zeroed, e.g. .bss)
+    // Fields below are only valid if header_size covers them.
+    UINT64 heap_size;               // Heap arena Stage 1 should reserve (0 = LBL_CORE_HEAP_DEFAULT_SIZE)
+} LBL_CORE_IMAGE_HEADER;
+
+// Smallest header_size accepted (headers built before heap_size existed).
+#define LBL_CORE_IMAGE_HEADER_MIN_SIZE  56
+
+// --- Core Heap Arena ---
+// One contiguous, 2 MiB-aligned range reserved for the core's global allocator,
+// so it can start allocating before it has looked at the memory map.
+#define LBL_CORE_HEAP_ALIGNMENT     0x200000ULL
+#define LBL_CORE_HEAP_DEFAULT_SIZE  0x4000000ULL    // 64 MiB
+#define LBL_CORE_HEAP_MIN_SIZE      LBL_CORE_HEAP_ALIGNMENT // Smallest arena worth handing over
+
+// --- LBL Compressed Core Container ---
+// lbl_core.bin may instead be an LZ4 container, detected by this magic at offset 0.
+// Layout: LBL_CORE_LZ4_HEADER, then (at header_size) the LZ4 block sequence
+// decoded by stage1_lz4.c: u32 length (| LBL_LZ4_BLOCK_UNCOMPRESSED if stored)
+// followed by the block, repeated. Blocks may be linked. Stage 1 decodes each
+// block straight into the core's final pages as the file is streamed.
+#define LBL_CORE_LZ4_MAGIC          0x4C424C434C5A3431 // "LBLCLZ41"
+#define LBL_CORE_LZ4_MAX_BLOCK      (8 * 1024 * 1024)  // Largest uncompressed block accepted
+
+typedef struct {
+    UINT64 magic;                   // LBL_CORE_LZ4_MAGIC
+    UINT32 header_size;             // Offset of the first block
+    UINT32 block_max_size;          // Largest uncompressed block, <= LBL_CORE_LZ4_MAX_BLOCK
+    UINT64 compressed_size;         // Bytes of block data from header_size on
+    UINT64 uncompressed_size;       // Size of the decoded image
+    LBL_CORE_IMAGE_HEADER image;    // Copy of the decoded image's header (magic 0 for a flat image),
+                                    // so pages can be allocated before decoding starts
+} LBL_CORE_LZ4_HEADER;
+
+// Smallest header_size accepted: `image` may be an older, shorter core header.
+#define LBL_CORE_LZ4_HEADER_MIN_SIZE \
+    (sizeof(LBL_CORE_LZ4_HEADER) - sizeof(LBL_CORE_IMAGE_HEADER) + LBL_CORE_IMAGE_HEADER_MIN_SIZE)
+
+// --- LBL Core Manifest ---
+// Optional \LBL\CORE\lbl_core.man, written by the signing tool. It holds the SHA-256
+// of lbl_core.bin exactly as stored on disk, followed by a detached signature over
+// the header. Stage 1 hashes the core while reading it and refuses a core whose
+// digest differs. It has no public-key code, so the manifest is passed on in
+// LBL_BOOT_INFO and the core checks the signature against its KeyStore.
+#define LBL_CORE_MANIFEST_MAGIC     0x4C424C4D414E4631 // "LBLMANF1"
+#define LBL_CORE_MANIFEST_MAX_SIZE  (64 * 1024)
+#define LBL_CORE_DIGEST_SIZE        32                 // SHA-256
+
+typedef struct {
+    UINT64 magic;                   // LBL_CORE_MANIFEST_MAGIC
+    UINT32 header_size;             // Signed bytes are [0, header_size); the signature follows
+    UINT32 signature_size;          // Bytes of signature after the header
+    UINT64 core_file_size;          // Size of lbl_core.bin on disk
+    UINT8  core_sha256[LBL_CORE_DIGEST_SIZE]; // SHA-256 of lbl_core.bin on disk
+} LBL_CORE_MANIFEST_HEADER;
+
+// LBL_BOOT_INFO.core_verify_flags
+#define LBL_CORE_VERIFY_DIGEST          0x00000001 // core_sha256 is the digest of lbl_core.bin on disk
+#define LBL_CORE_VERIFY_MANIFEST_MATCH  0x00000002 // It matched the manifest at core_manifest_addr
+#define LBL_CORE_VERIFY_ACCELERATED     0x00000004 // Computed with SHA-NI / ARMv8 SHA2
+
+// OS-vendor memory type (0x80000000+) for pages owned by the core image, so the core
+// can find itself in the memory map and never mistakes its own pages for free RAM.
+#define LBL_MEMORY_TYPE_CORE        ((EFI_MEMORY_TYPE)0x80000001)
+#define LBL_MEMORY_TYPE_CORE_HEAP   ((EFI_MEMORY_TYPE)0x80000002)
+
+// Core image formats (LBL_CORE_IMAGE.format, LBL_CORE_SEGMENTS_RECORD.format);
+// the values match LBL_IMAGE_FORMAT_* in stage1_image.h.
+#define LBL_CORE_FORMAT_FLAT        0   // Flat binary, with or without LBL_CORE_IMAGE_HEADER
+#define LBL_CORE_FORMAT_ELF64       1
+#define LBL_CORE_FORMAT_PE32PLUS    2
+
+#define LBL_CORE_MAX_SEGMENTS       16  // LBL_IMAGE_MAX_SEGMENTS
+
+// LBL_CORE_SEGMENT.flags (same values as LBL_IMAGE_SEGMENT_*)
+#define LBL_CORE_SEGMENT_READ       0x1
+#define LBL_CORE_SEGMENT_WRITE      0x2
+#define LBL_CORE_SEGMENT_EXEC       0x4
+
+// One loaded ELF/PE segment, so the core can map its text RX and its data RW.
+typedef struct {
+    UINT64 offset;                  // From core_load_addr
+    UINT64 size;                    // Bytes in memory, zero-filled tail (.bss) included
+    UINT32 flags;                   // LBL_CORE_SEGMENT_*
+    UINT32 reserved;
+} LBL_CORE_SEGMENT;
+
+// --- A/B Core Slots ---
+// Stage 1 looks for the core in up to three files per volume: the two update
+// slots, in the order LBL_NV_CORE_SLOT asks for, then the single image of an
+// install without slots. Every slot has its own extent map and manifest.
+#define LBL_CORE_SLOT_A             0   // \LBL\CORE\lbl_core_a.bin
+#define LBL_CORE_SLOT_B             1   // \LBL\CORE\lbl_core_b.bin
+#define LBL_CORE_SLOT_SINGLE        2   // \LBL\CORE\lbl_core.bin
+#define LBL_CORE_SLOT_COUNT         3
+#define LBL_CORE_SLOT_MAX_ATTEMPTS  3   // Default LBL_CORE_SLOT_STATE.max_attempts
+
+// LBL_CORE_SLOT_RECORD.failures: why a slot was not the one booted.
+#define LBL_CORE_FAILURE_NONE       0   // Not needed (an earlier slot worked), or booted with no copy failing
+#define LBL_CORE_FAILURE_NOT_FOUND  1   // No such file on any volume tried
+#define LBL_CORE_FAILURE_READ       2   // I/O error or short read
+#define LBL_CORE_FAILURE_HEADER     3   // Invalid core, container, ELF or PE header
+#define LBL_CORE_FAILURE_DIGEST     4   // Manifest malformed, or the image does not match it
+#define LBL_CORE_FAILURE_MEMORY     5   // No pages for the image
+
+// LBL_CORE_SLOT_RECORD.flags
+#define LBL_CORE_SLOT_FLAG_DEMOTED  0x00000001 // `preferred` had used up its attempts: tried after the other slot
+#define LBL_CORE_SLOT_FLAG_COUNTED  0x00000002 // This boot incremented LBL_CORE_SLOT_STATE.attempts
+#define LBL_CORE_SLOT_FLAG_CONFIRMED 0x00000004 // LBL_CORE_SLOT_STATE.confirmed was set
+
+// Where and how Stage 1 placed the core image. Filled by FindAndLoadLBLCore.
+typedef struct {
+    EFI_PHYSICAL_ADDRESS load_addr; // Base of the page allocation holding the image
+    UINTN                pages;     // Size of that allocation in pages
+    UINT64               file_size; // Bytes of the core image (decoded size if compressed)
+    UINT64               alignment; // Alignment of load_addr that was requested and honoured
+    UINT64               entry_offset; // Entry point relative to load_addr
+    UINT64               compressed_size; // Bytes read from disk if compressed, else 0
+    UINT64               decompress_ticks; // Cycle-counter ticks spent in the LZ4 decoder
+    UINT8                sha256[LBL_CORE_DIGEST_SIZE]; // Digest of lbl_core.bin as read
+    UINT32               verify_flags; // LBL_CORE_VERIFY_*
+    LBL_CORE_MANIFEST_HEADER* manifest; // Pool copy of lbl_core.man, or NULL
+    UINTN                manifest_size;
+    UINT64               heap_size; // Arena size the core header asked for (0 = default)
+    UINT32               header_flags; // LBL_CORE_HEADER_FLAG_* (0 for flat images)
+    UINT32               format;    // LBL_CORE_FORMAT_*
+    UINT32               segment_count; // Entries in segments (ELF/PE only)
+    LBL_CORE_SEGMENT     segments[LBL_CORE_MAX_SEGMENTS];
+    UINT32               slot;      // LBL_CORE_SLOT_* the image was read from
+} LBL_CORE_IMAGE;
+
+// LBL_BOOT_INFO.page_table_flags
+#define LBL_PAGING_FLAG_1G_PAGES        0x00000001 // Identity map uses 1 GiB leaves
+#define LBL_PAGING_FLAG_WC_FRAMEBUFFER  0x00000002 // Framebuffer mapped write-combining (PAT PA4)
+
+// LBL_BOOT_INFO.framebuffer_pixel_format_info: the GOP format, normalized.
+// Only the two byte-aligned 32 bpp layouts get their own value, so a blitter
+// can switch on this and fall back to the channel fields for LBL_FB_FORMAT_BITMASK.
+#define LBL_FB_FORMAT_NONE          0   // No linear framebuffer (or PixelBltOnly)
+#define LBL_FB_FORMAT_RGBX8888      1   // Bytes R, G, B, X
+#define LBL_FB_FORMAT_BGRX8888      2   // Bytes B, G, R, X
+#define LBL_FB_FORMAT_BITMASK       3   // Anything else: see the channel shift/size fields
+
+// LBL_BOOT_INFO.framebuffer_flags
+#define LBL_FB_FLAG_WRITE_COMBINING 0x00000001 // GCD attribute set to EFI_MEMORY_WC (MTRR-backed)
+
+// --- PI DXE Services (subset) ---
+// gnu-efi does not carry the PI definitions; only the GCD memory calls used to
+// make the framebuffer write-combining are declared. Layout per PI spec vol. 2.
+#define LBL_DXE_SERVICES_TABLE_GUID \
+    { 0x05ad34ba, 0x6f02, 0x4214, { 0x95, 0x2e, 0x4d, 0xa0, 0x39, 0x8e, 0x2b, 0xb9 } }
+
+typedef struct {
+    EFI_PHYSICAL_ADDRESS BaseAddress;
+    UINT64               Length;
+    UINT64               Capabilities;
+    UINT64               Attributes;
+    UINT32               GcdMemoryType;
+    EFI_HANDLE           ImageHandle;
+    EFI_HANDLE           DeviceHandle;
+} LBL_GCD_MEMORY_SPACE_DESCRIPTOR;
+
+typedef struct {
+    EFI_TABLE_HEADER Hdr;
+    VOID*            AddMemorySpace;
+    VOID*            AllocateMemorySpace;
+    VOID*            FreeMemorySpace;
+    VOID*            RemoveMemorySpace;
+    EFI_STATUS (EFIAPI *GetMemorySpaceDescriptor)(EFI_PHYSICAL_ADDRESS BaseAddress,
+                                                  LBL_GCD_MEMORY_SPACE_DESCRIPTOR* Descriptor);
+    EFI_STATUS (EFIAPI *SetMemorySpaceAttributes)(EFI_PHYSICAL_ADDRESS BaseAddress, UINT64 Length,
+                                                  UINT64 Attributes);
+    // Remaining services are not used.
+} LBL_DXE_SERVICES;
+
+// --- LBL NVRAM Variables ---
+// All LBL UEFI variables live under this vendor GUID.
+#define LBL_VENDOR_GUID \
+    { 0x4C424C00, 0x7A3E, 0x4B1F, { 0x9D, 0x2C, 0x5E, 0x1A, 0x6B, 0x0F, 0x3C, 0x11 } }
+
+// Device path of the volume that last served the core. Stage 1 opens it directly
+// via LocateDevicePath on the next boot and only rewrites it when it changes.
+#define LBL_NV_CORE_DEVICE_PATH     L"LblCoreDevicePath"
+#define LBL_NV_DEVICE_PATH_MAX      512   // Upper bound on a cached device path, in bytes
+// UINT64 core heap arena size in bytes; overrides the core header (0 = no arena).
+#define LBL_NV_CORE_HEAP_SIZE       L"LblCoreHeapSize"
+// Stage 1 log verbosity: UINT8 record level, optional UINT8 console level (LBL_LOG_LEVEL_*).
+#define LBL_NV_LOG_LEVEL            L"LblLogLevel"
+// LBL_GOP_POLICY choosing the video mode (absent = LBL_GOP_DEFAULT_POLICY).
+#define LBL_NV_GOP_POLICY           L"LblGopPolicy"
+// LBL_GOP_MODE_CACHE: the mode the policy picked last boot, so enumeration is skipped.
+#define LBL_NV_GOP_MODE             L"LblGopMode"
+// LBL_CORE_SLOT_STATE: the A/B slot to boot and the boots it has had unconfirmed.
+// Runtime-accessible, so the OS can confirm a good boot.
+#define LBL_NV_CORE_SLOT            L"LblCoreSlot"
+// ASCII base URL of the network core source (see LBL_NET_URL_MAX), e.g.
+// "http://10.0.0.1/lbl/"; overrides the URL derived from an HTTP or PXE boot.
+#define LBL_NV_CORE_URL             L"LblCoreUrl"
+
+// An updater writes { the slot it just filled, attempts 0, confirmed 0 }. Stage 1
+// counts every boot of an unconfirmed `preferred` before handing over to it, and
+// tries it only after the other slot once `attempts` reaches `max_attempts`.
+// When the new core is known good, the core or the OS sets `confirmed`.
+typedef struct {
+    UINT8 preferred;                // LBL_CORE_SLOT_A or LBL_CORE_SLOT_B
+    UINT8 attempts;                 // Boots of `preferred` not confirmed yet
+    UINT8 max_attempts;             // 0 = LBL_CORE_SLOT_MAX_ATTEMPTS
+    UINT8 confirmed;                // Non-zero: `preferred` is known good, stop counting
+} LBL_CORE_SLOT_STATE;
+
+// --- GOP Mode Policy ---
+// Bounds the framebuffer the GUI redraws. Modes above max_pixels are never
+// chosen; among the rest the policy's target resolution wins, then the largest.
+#define LBL_GOP_POLICY_KEEP         0   // Keep the mode the firmware set
+#define LBL_GOP_POLICY_MAX_PIXELS   1   // Largest mode within max_pixels
+#define LBL_GOP_POLICY_PREFERRED    2   // width x height, else as MAX_PIXELS
+#define LBL_GOP_POLICY_NATIVE       3   // Panel's EDID resolution, else same aspect ratio, else as MAX_PIXELS
+
+typedef struct {
+    UINT32 kind;                    // LBL_GOP_POLICY_*
+    UINT32 max_pixels;              // Cap on width * height (0 = no cap)
+    UINT32 width;                   // Target for LBL_GOP_POLICY_PREFERRED
+    UINT32 height;
+} LBL_GOP_POLICY;
+
+#define LBL_GOP_DEFAULT_POLICY      { LBL_GOP_POLICY_NATIVE, 1920 * 1200, 0, 0 }
+
+typedef struct {
+    LBL_GOP_POLICY policy;          // Policy the mode was chosen under
+    UINT32 max_mode;                // Gop->Mode->MaxMode at the time (a changed display invalidates)
+    UINT32 mode;                    // Chosen mode number
+    UINT32 width;                   // Its resolution, re-checked with one QueryMode
+    UINT32 height;
+} LBL_GOP_MODE_CACHE;
+
+// EFI_EDID_ACTIVE_PROTOCOL (UEFI spec 12.9), used for the native resolution.
+#define LBL_EDID_ACTIVE_PROTOCOL_GUID \
+    { 0xbd8c1056, 0x9f36, 0x44ec, { 0x92, 0xa8, 0xa6, 0x33, 0x7f, 0x81, 0x79, 0x86 } }
+
+typedef struct {
+    UINT32 SizeOfEdid;
+    UINT8* Edid;
+} LBL_EDID_ACTIVE_PROTOCOL;
+
 typedef struct {
     // --- Header ---
     UINT64 magic;                   // LBL_BOOT_INFO_MAGIC_VALUE
     UINT32 version;                 // LBL_BOOT_INFO_VERSION
-    UINT32 header_size;             // Size of this LBL_BOOT_INFO header part
-    UINT32 total_size;              // Total size of BootInfo + any appended data (e.g. memory map directly after)
+    UINT32 header_size;             // Size of this LBL_BOOT_INFO header part; records start here
+    UINT32 total_size;              // Total size of BootInfo + appended LBL_BOOT_RECORD_HEADER records
 
     // --- LBL Core Engine Info ---
     UINT64 core_load_addr;          // Physical address where LBL Core binary was loaded
-    UINT64 core_size;               // Size of the LBL Core binary in bytes
+    UINT64 core_size;               // Size of the LBL Core image in bytes (decoded size if compressed)
     UINT64 core_entry_offset;       // Offset of the entry point within the loaded core_binary (usually 0)
+    UINT64 core_load_alignment;     // Alignment honoured for core_load_addr (>= 4 KiB, page allocation)
+    UINT64 core_compressed_size;    // Size of the LZ4 container on disk (0 = core was stored uncompressed)
+    UINT64 core_decompress_ticks;   // Time spent decoding, in CPU cycle-counter ticks (TSC / CNTVCT)
+    UINT8  core_sha256[32];         // SHA-256 of lbl_core.bin as read from disk (see core_verify_flags)
+    UINT32 core_verify_flags;       // LBL_CORE_VERIFY_*
+    UINT32 reserved_verify;         // Padding
+    UINT64 core_manifest_addr;      // LBL_CORE_MANIFEST_HEADER + signature in LoaderData (0 = none)
+    UINT64 core_manifest_size;      // Size of that copy in bytes
+    UINT64 core_heap_addr;          // 2 MiB-aligned heap arena for the core (0 = none)
+    UINT64 core_heap_size;          // Size of the arena in bytes
 
     // --- Memory Map (UEFI GetMemoryMap format) ---
     EFI_MEMORY_DESCRIPTOR* memory_map_buffer; // Pointer to the allocated buffer containing the memory map
@@ -37,26 +314,48 @@ typedef struct {
     UINTN memory_map_key;           // Key for the current memory map (used for ExitBootServices)
     UINTN memory_descriptor_size;   // Size of a single EFI_MEMORY_DESCRIPTOR entry
     UINT32 memory_descriptor_version; // Version of the EFI_MEMORY_DESCRIPTOR structure
+    UINT32 exit_boot_services_retries; // Stale-map-key retries ExitBootServices needed (0 = first try)
 
     // --- Graphics/Framebuffer Information (from UEFI GOP) ---
     UINT64 framebuffer_addr;        // Physical address of the linear framebuffer
     UINT64 framebuffer_size;        // Size of the framebuffer in bytes
     UINT32 framebuffer_width;       // Width in pixels
     UINT32 framebuffer_height;      // Height in pixels
-    UINT32 framebuffer_pitch;       // Pixels per scan line (stride in bytes = pitch * bytes_per_pixel)
-                                    // Note: UEFI GOP provides PixelsPerScanLine. Pitch is in bytes.
-                                    // So, this field might better be named 'pixels_per_scan_line'
-                                    // and pitch calculated, or store byte pitch directly.
-                                    // Let's assume this means BYTES per scan line for consistency with BootInfo structure.
-    UINT8  framebuffer_bpp;         // Bits per pixel (e.g., 32 for BGRA8888)
-    UINT8  framebuffer_pixel_format_info; // Could store UEFI GOP PixelFormat enum or custom LBL mapping
+    UINT32 framebuffer_pitch;       // Bytes per scan line (GOP PixelsPerScanLine * bytes per pixel)
+    UINT8  framebuffer_bpp;         // Bits per pixel, from the channel masks (e.g., 32, 24, 16)
+    UINT8  framebuffer_pixel_format_info; // LBL_FB_FORMAT_*
     UINT16 reserved_graphics;       // Padding
+    // Channel layout of one pixel, read as a little-endian integer of bpp bits:
+    // channel = (pixel >> shift) & ((1 << size) - 1). Size 0 = channel absent.
+    UINT8  framebuffer_red_shift;
+    UINT8  framebuffer_red_size;
+    UINT8  framebuffer_green_shift;
+    UINT8  framebuffer_green_size;
+    UINT8  framebuffer_blue_shift;
+    UINT8  framebuffer_blue_size;
+    UINT8  framebuffer_reserved_shift;
+    UINT8  framebuffer_reserved_size;
+    UINT32 framebuffer_flags;       // LBL_FB_FLAG_*
+    UINT32 reserved_graphics2;      // Padding
 
     // --- ACPI Information ---
     UINT64 acpi_rsdp_ptr;           // Physical address of the ACPI RSDP (Root System Description Pointer)
+    UINT64 smbios_entry_ptr;        // SMBIOS 3.x entry point if present, else the 2.x one (0 = none)
 
     // --- Platform/Firmware Information ---
     UINT64 efi_system_table_ptr;    // Physical address of the EFI System Table (for Runtime Services access by Core if needed)
+
+    // --- Stage 1 Log ---
+    UINT64 stage1_log_addr;         // LBL_UEFI_LOG_RING in the loader image (LoaderCode/Data)
+    UINT32 stage1_log_size;         // sizeof(LBL_UEFI_LOG_RING)
+    UINT32 reserved_log;            // Padding
+
+    // --- Paging (x86_64, LBL_CORE_HEADER_FLAG_PAGE_TABLES) ---
+    UINT64 page_table_root;         // PML4 loaded into CR3 before the jump (0 = firmware tables kept)
+    UINT64 page_table_top;          // [0, top) is identity-mapped...
+    UINT64 higher_half_base;        // ...and mapped again at this virtual base
+    UINT32 page_table_pages;        // 4 KiB table pages in use (LoaderData)
+    UINT32 page_table_flags;        // LBL_PAGING_FLAG_*
     // Could add boot drive signature, command line args passed to LBL.efi, etc.
     
     // --- Future Expansion ---
@@ -65,6 +364,398 @@ typedef struct {
 
 } LBL_BOOT_INFO;
 
+// --- Records appended after LBL_BOOT_INFO ---
+// From header_size up to total_size the boot info carries a sequence of records.
+// Each starts on an LBL_BOOT_RECORD_ALIGN boundary with this header; `size`
+// includes the header. Readers skip types they do not know by size.
+typedef struct {
+    UINT32 type;                    // LBL_BOOT_RECORD_*
+    UINT32 size;
+} LBL_BOOT_RECORD_HEADER;
+
+#define LBL_BOOT_RECORD_ALIGN       8
+#define LBL_BOOT_RECORD_TIMELINE    1   // LBL_TIMELINE_RECORD
+#define LBL_BOOT_RECORD_MEMORY_MAP  2   // LBL_COMPACT_MEMORY_MAP_RECORD
+#define LBL_BOOT_RECORD_CONFIG_TABLES 3 // LBL_CONFIG_TABLES_RECORD
+#define LBL_BOOT_RECORD_ACPI_INDEX  4   // LBL_ACPI_INDEX_RECORD
+#define LBL_BOOT_RECORD_MP          5   // LBL_MP_RECORD
+#define LBL_BOOT_RECORD_MODULES     6   // LBL_MODULES_RECORD
+#define LBL_BOOT_RECORD_SECTOR_CACHE 7  // LBL_SECTOR_CACHE_RECORD, BIOS only (stage1_loader_utils.h)
+#define LBL_BOOT_RECORD_CORE_SEGMENTS 8 // LBL_CORE_SEGMENTS_RECORD
+#define LBL_BOOT_RECORD_MEM_OPS     9   // LBL_MEM_OPS_RECORD
+#define LBL_BOOT_RECORD_CORE_SLOT   10  // LBL_CORE_SLOT_RECORD
+#define LBL_BOOT_RECORD_EARLY_CONSOLE 11 // LBL_EARLY_CONSOLE_RECORD
+
+// Boot timeline: cycle-counter timestamps (TSC / CNTVCT) of boot milestones.
+// Stage 1 fills the first events; the core appends its own behind them, up to
+// `capacity`, so a single record covers firmware to kernel.
+#define LBL_TIMELINE_VERSION        1
+#define LBL_TIMELINE_CAPACITY       64
+
+// LBL_TIMELINE_EVENT.id. Stage 1 uses 0x0001-0x0FFF, the core LBL_TL_CORE_FIRST on.
+#define LBL_TL_STAGE1_ENTRY         0x0001
+#define LBL_TL_FS_LOCATED           0x0002  // Core file opened on a volume
+#define LBL_TL_CORE_READ_START      0x0003
+#define LBL_TL_CORE_READ_END        0x0004  // arg: 1 if the read completed asynchronously
+#define LBL_TL_BOOT_INFO_READY      0x0005
+#define LBL_TL_EXIT_BOOT_SERVICES   0x0006  // One per attempt; arg: attempt number from 0
+#define LBL_TL_CORE_JUMP            0x0007
+#define LBL_TL_APS_PARKED           0x0008  // arg: APs that reached their mailbox
+#define LBL_TL_MODULES_LOADED       0x0009  // arg: files preloaded from the manifest
+#define LBL_TL_CORE_SLOT_FAILED     0x000A  // arg: LBL_CORE_SLOT_* given up on
+#define LBL_TL_CORE_FIRST           0x1000
+
+typedef struct {
+    UINT64 ticks;                   // Cycle counter value
+    UINT32 id;                      // LBL_TL_*
+    UINT32 arg;                     // Event-specific
+} LBL_TIMELINE_EVENT;
+
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;  // type = LBL_BOOT_RECORD_TIMELINE
+    UINT32 version;                 // LBL_TIMELINE_VERSION
+    UINT32 capacity;                // Entries in events[]
+    UINT32 count;                   // Entries used
+    UINT32 dropped;                 // Marks lost because events[] was full
+    UINT64 ticks_per_second;        // Counter frequency, calibrated against BS->Stall (0 = unknown)
+    LBL_TIMELINE_EVENT events[LBL_TIMELINE_CAPACITY];
+} LBL_TIMELINE_RECORD;
+
+// Compact memory map: the final (post-ExitBootServices) firmware map reduced to
+// fixed 16-byte ranges sorted by base, with adjacent ranges of the same LBL type
+// merged. The raw map (memory_map_buffer) stays valid for runtime services.
+#define LBL_MEM_USABLE              1   // Conventional and boot-services memory
+#define LBL_MEM_LOADER              2   // Loader code/data: the core, boot info, this image
+#define LBL_MEM_RESERVED            3   // Reserved, unusable, PAL code, unknown types
+#define LBL_MEM_ACPI_RECLAIM        4   // ACPI tables, usable once they are parsed
+#define LBL_MEM_ACPI_NVS            5
+#define LBL_MEM_RUNTIME             6   // Runtime services code/data (keep mapped)
+#define LBL_MEM_MMIO                7   // MMIO and MMIO port space
+#define LBL_MEM_PERSISTENT          8   // NVDIMM / persistent memory
+#define LBL_MEM_CORE_HEAP           9   // The arena at core_heap_addr
+
+typedef struct {
+    UINT64 base;                    // Physical address, page aligned
+    UINT32 pages;                   // 4 KiB pages (long runs are split at UINT32 max)
+    UINT32 type;                    // LBL_MEM_*
+} LBL_MEMORY_RANGE;
+
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;  // type = LBL_BOOT_RECORD_MEMORY_MAP
+    UINT32 count;                   // Ranges used (0 = unavailable, use the raw map)
+    UINT32 capacity;                // Ranges reserved behind this header
+    // LBL_MEMORY_RANGE ranges[capacity] follows
+} LBL_COMPACT_MEMORY_MAP_RECORD;
+
+// --- Firmware Configuration Tables ---
+// Everything the core needs from ST->ConfigurationTable, gathered in one pass, plus
+// a seed from EFI_RNG_PROTOCOL. At most one entry per LBL_CFG_* type.
+#define LBL_CFG_ACPI                1   // RSDP; version 2 (XSDT) preferred over 1
+#define LBL_CFG_SMBIOS              2   // SMBIOS 2.x entry point (version 2)
+#define LBL_CFG_SMBIOS3             3   // SMBIOS 3.x entry point (version 3)
+#define LBL_CFG_DEVICE_TREE         4   // Flattened device tree blob
+#define LBL_CFG_MEMORY_ATTRIBUTES   5   // EFI_MEMORY_ATTRIBUTES_TABLE (runtime W^X)
+#define LBL_CFG_TYPE_COUNT          5
+
+#define LBL_RNG_SEED_SIZE           32
+
+typedef struct {
+    UINT32 type;                    // LBL_CFG_*
+    UINT32 version;                 // Flavour of the table found (see LBL_CFG_*)
+    UINT64 address;                 // Physical address of the table
+} LBL_CONFIG_TABLE_ENTRY;
+
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;  // type = LBL_BOOT_RECORD_CONFIG_TABLES
+    UINT32 count;                   // Entries used
+    UINT32 rng_seed_size;           // Bytes of rng_seed filled by EFI_RNG_PROTOCOL (0 = none)
+    UINT8  rng_seed[LBL_RNG_SEED_SIZE];
+    LBL_CONFIG_TABLE_ENTRY entries[LBL_CFG_TYPE_COUNT];
+} LBL_CONFIG_TABLES_RECORD;
+
+// --- ACPI Table Index ---
+// Every table reachable from the XSDT (RSDT on ACPI 1.0), plus the DSDT and FACS
+// from the FADT, checksummed once by Stage 1 and sorted by (signature, address).
+// signature is the four ASCII bytes read as a little-endian UINT32 ("APIC" =
+// 0x43495041), so a binary search finds the first table of a kind and repeated
+// signatures (SSDTs) follow it in address order.
+typedef struct {
+    UINT32 signature;
+    UINT32 length;                  // Header length field
+    UINT64 address;
+} LBL_ACPI_TABLE_ENTRY;
+
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;  // type = LBL_BOOT_RECORD_ACPI_INDEX
+    UINT32 count;                   // Entries used
+    UINT32 dropped;                 // Tables left out: bad checksum or implausible length
+    UINT64 root;                    // XSDT (or RSDT) the index was built from
+    // LBL_ACPI_TABLE_ENTRY entries[count] follows
+} LBL_ACPI_INDEX_RECORD;
+
+// --- Processors ---
+// Topology of every CPU from EFI_MP_SERVICES_PROTOCOL, BSP included. When the core
+// sets LBL_CORE_HEADER_FLAG_PARK_APS, each enabled AP also owns a mailbox in the
+// LBL_MP_PARK_BLOCK (stage1_mp.h) and waits there for jobs after the handoff.
+#define LBL_CPU_FLAG_BSP            0x00000001
+#define LBL_CPU_FLAG_ENABLED        0x00000002
+#define LBL_CPU_FLAG_HEALTHY        0x00000004
+#define LBL_CPU_NO_MAILBOX          0xFFFFFFFF
+
+typedef struct {
+    UINT32 apic_id;                 // Initial (x2)APIC ID
+    UINT32 package;                 // Socket; NUMA node via the SRAT in the ACPI index
+    UINT32 core;                    // Core within the package
+    UINT32 thread;                  // SMT thread within the core
+    UINT32 flags;                   // LBL_CPU_FLAG_*
+    UINT32 mailbox;                 // Index into LBL_MP_PARK_BLOCK.mailboxes, or LBL_CPU_NO_MAILBOX
+} LBL_CPU_ENTRY;
+
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;  // type = LBL_BOOT_RECORD_MP
+    UINT32 count;                   // CPUs listed, BSP included
+    UINT32 parked;                  // APs waiting on their mailbox at the handoff
+    UINT64 park_block;              // LBL_MP_PARK_BLOCK in LoaderData (0 = APs not started)
+    UINT64 stacks;                  // AP stacks, LBL_AP_STACK_SIZE each, in mailbox order
+    UINT32 stack_size;
+    UINT32 reserved;
+    // LBL_CPU_ENTRY cpus[count] follows
+} LBL_MP_RECORD;
+
+// Preloaded files: the preload manifest (LBL_PRELOAD_MANIFEST_PATH) lists files
+// that Stage 1 reads from the core's volume, in the same open session as the
+// core, so the core can serve them from memory without mounting the volume.
+// Manifest: ASCII text, one path per line ('/' or '\' separators, lines
+// starting with '#' ignored), at most LBL_PRELOAD_MAX_MODULES entries.
+#define LBL_PRELOAD_MANIFEST_MAX_SIZE   4096
+#define LBL_PRELOAD_MAX_MODULES         16
+#define LBL_MODULE_NAME_MAX             96  // Path bytes, NUL included
+
+typedef struct {
+    UINT64 address;                 // Page-aligned LoaderData copy (0 if size is 0)
+    UINT64 size;                    // File size in bytes; the pages past it are zeroed
+    UINT32 flags;                   // Reserved, 0
+    UINT32 name_length;             // Bytes in name, NUL excluded
+    CHAR8 name[LBL_MODULE_NAME_MAX];  // Path as written in the manifest, NUL-terminated
+} LBL_MODULE_ENTRY;
+
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;  // type = LBL_BOOT_RECORD_MODULES
+    UINT32 count;
+    UINT32 skipped;                 // Manifest lines that could not be loaded
+    // LBL_MODULE_ENTRY modules[count] follows
+} LBL_MODULES_RECORD;
+
+// Segments of an ELF64 / PE32+ core as loaded (absent for flat images).
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;  // type = LBL_BOOT_RECORD_CORE_SEGMENTS
+    UINT32 format;                  // LBL_CORE_FORMAT_*
+    UINT32 count;
+    // LBL_CORE_SEGMENT segments[count] follows, in address order
+} LBL_CORE_SEGMENTS_RECORD;
+
+// Stage 1's copy / fill / compare routines, for the core to use before (or
+// instead of) probing the CPU itself. Same record on BIOS.
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;  // type = LBL_BOOT_RECORD_MEM_OPS
+    // LBL_MEM_OPS (stage1_mem.h) follows
+} LBL_MEM_OPS_RECORD;
+
+// Which A/B slot the core came from, and what went wrong with the others.
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;  // type = LBL_BOOT_RECORD_CORE_SLOT
+    UINT32 slot;                    // LBL_CORE_SLOT_* that was booted
+    UINT32 preferred;               // LBL_CORE_SLOT_STATE as read this boot...
+    UINT32 attempts;                // ...with this boot counted if LBL_CORE_SLOT_FLAG_COUNTED
+    UINT32 max_attempts;
+    UINT32 flags;                   // LBL_CORE_SLOT_FLAG_*
+    UINT32 failures[LBL_CORE_SLOT_COUNT]; // LBL_CORE_FAILURE_* per slot
+} LBL_CORE_SLOT_RECORD;
+
+// Framebuffer / serial text console that outlives boot services, for the core
+// to print through (same cursor, same glyph cache) until its GUI is up.
+typedef struct {
+    LBL_BOOT_RECORD_HEADER header;  // type = LBL_BOOT_RECORD_EARLY_CONSOLE
+    // LBL_FBCON (stage1_fbcon.h) follows
+} LBL_EARLY_CONSOLE_RECORD;
+
+// EFI_MP_SERVICES_PROTOCOL (PI spec vol. 2, 13.4); gnu-efi does not define it.
+#define LBL_MP_SERVICES_PROTOCOL_GUID \
+    { 0x3fdda605, 0xa76e, 0x4f46, { 0xad, 0x29, 0x12, 0xf4, 0x53, 0x1b, 0x3d, 0x08 } }
+
+#define LBL_MP_PROCESSOR_AS_BSP     0x00000001 // EFI_PROCESSOR_INFORMATION.StatusFlag
+#define LBL_MP_PROCESSOR_ENABLED    0x00000002
+#define LBL_MP_PROCESSOR_HEALTHY    0x00000004
+
+typedef struct {
+    UINT64 ProcessorId;             // (x2)APIC ID
+    UINT32 StatusFlag;
+    UINT32 Package;
+    UINT32 Core;
+    UINT32 Thread;
+    UINT32 ExtendedInformation[6];  // Only written for CPU_V2_EXTENDED_TOPOLOGY requests
+} LBL_MP_PROCESSOR_INFORMATION;
+
+typedef struct LBL_MP_SERVICES_PROTOCOL LBL_MP_SERVICES_PROTOCOL;
+struct LBL_MP_SERVICES_PROTOCOL {
+    EFI_STATUS (EFIAPI *GetNumberOfProcessors)(LBL_MP_SERVICES_PROTOCOL* This, UINTN* NumberOfProcessors,
+                                               UINTN* NumberOfEnabledProcessors);
+    EFI_STATUS (EFIAPI *GetProcessorInfo)(LBL_MP_SERVICES_PROTOCOL* This, UINTN ProcessorNumber,
+                                          LBL_MP_PROCESSOR_INFORMATION* ProcessorInfoBuffer);
+    // StartupAllAPs, StartupThisAP, SwitchBSP, EnableDisableAP, WhoAmI are not used:
+    // the APs are started after ExitBootServices, when these are gone.
+};
+
+// EFI_RNG_PROTOCOL (UEFI spec 37.5); only GetRNG with the default algorithm is used.
+#define LBL_RNG_PROTOCOL_GUID \
+    { 0x3152bca5, 0xeade, 0x433d, { 0x86, 0x2e, 0xc0, 0x1c, 0xdc, 0x29, 0x1f, 0x44 } }
+
+typedef struct LBL_RNG_PROTOCOL LBL_RNG_PROTOCOL;
+struct LBL_RNG_PROTOCOL {
+    EFI_STATUS (EFIAPI *GetInfo)(LBL_RNG_PROTOCOL* This, UINTN* AlgorithmListSize, EFI_GUID* AlgorithmList);
+    EFI_STATUS (EFIAPI *GetRNG)(LBL_RNG_PROTOCOL* This, EFI_GUID* Algorithm, UINTN ValueLength, UINT8* Value);
+};
+
+
+// --- Network Core Source ---
+// Diskless machines read the same slot files from a server. Paths are appended
+// to the base URL with '\' turned into '/', so the server mirrors the ESP
+// (<base>LBL/CORE/lbl_core.bin). The base is LBL_NV_CORE_URL, else the directory
+// this loader was HTTP-booted from, else tftp://<server>/<boot file directory>
+// after a PXE boot. http:// fetches each file with ranged GETs over several
+// connections at once; tftp:// asks for large blocks and windows. https:// is
+// refused: no TLS is configured, so the server could not be authenticated.
+#define LBL_NET_URL_MAX             256     // Characters of a URL, terminator included
+#define LBL_NET_CONNECTIONS         4       // HTTP children fetching one file in parallel
+#define LBL_NET_RANGE_SIZE          (4 * 1024 * 1024) // Bytes per ranged GET
+#define LBL_NET_STALL_TIMEOUT_MS    5000    // A transfer with no progress for this long fails
+#define LBL_NET_TFTP_PORT           69
+#define LBL_NET_TFTP_BLKSIZE        "1468"  // Largest block a 1500-byte MTU carries unfragmented
+#define LBL_NET_TFTP_WINDOWSIZE     "64"    // Blocks per ACK (RFC 7440)
+
+// EFI_SERVICE_BINDING_PROTOCOL (UEFI spec 11.6), as installed for HTTP and MTFTP4.
+typedef struct LBL_SERVICE_BINDING_PROTOCOL LBL_SERVICE_BINDING_PROTOCOL;
+struct LBL_SERVICE_BINDING_PROTOCOL {
+    EFI_STATUS (EFIAPI *CreateChild)(LBL_SERVICE_BINDING_PROTOCOL* This, EFI_HANDLE* ChildHandle);
+    EFI_STATUS (EFIAPI *DestroyChild)(LBL_SERVICE_BINDING_PROTOCOL* This, EFI_HANDLE ChildHandle);
+};
+
+// EFI_HTTP_PROTOCOL (UEFI spec 29.6); gnu-efi does not define it.
+#define LBL_HTTP_SERVICE_BINDING_PROTOCOL_GUID \
+    { 0xbdc8e6af, 0xd9bc, 0x4379, { 0xa7, 0x2a, 0xe0, 0xc4, 0xe7, 0x5d, 0xae, 0x1c } }
+#define LBL_HTTP_PROTOCOL_GUID \
+    { 0x7a59b29b, 0x910b, 0x4171, { 0x82, 0x42, 0xa8, 0x5a, 0x0d, 0xf2, 0x5b, 0x5b } }
+
+#define LBL_HTTP_VERSION_11         1       // EFI_HTTP_VERSION HttpVersion11
+#define LBL_HTTP_METHOD_GET         0       // EFI_HTTP_METHOD HttpMethodGet
+// EFI_HTTP_STATUS_CODE is an enum of its own, not the numeric HTTP status.
+#define LBL_HTTP_STATUS_200_OK      3
+#define LBL_HTTP_STATUS_206_PARTIAL_CONTENT 9
+#define LBL_HTTP_STATUS_404_NOT_FOUND 21
+
+typedef struct {
+    BOOLEAN UseDefaultAddress;
+    EFI_IPv4_ADDRESS LocalAddress;
+    EFI_IPv4_ADDRESS LocalSubnet;
+    UINT16 LocalPort;
+} LBL_HTTPV4_ACCESS_POINT;
+
+typedef struct {
+    UINT32 HttpVersion;             // LBL_HTTP_VERSION_*
+    UINT32 TimeOutMillisec;
+    BOOLEAN LocalAddressIsIPv6;
+    LBL_HTTPV4_ACCESS_POINT* IPv4Node; // Union with the (unused) IPv6 access point
+} LBL_HTTP_CONFIG_DATA;
+
+typedef struct {
+    UINT32 Method;                  // LBL_HTTP_METHOD_*
+    CHAR16* Url;
+} LBL_HTTP_REQUEST_DATA;
+
+typedef struct {
+    UINT32 StatusCode;              // LBL_HTTP_STATUS_*
+} LBL_HTTP_RESPONSE_DATA;
+
+typedef struct {
+    CHAR8* FieldName;
+    CHAR8* FieldValue;
+} LBL_HTTP_HEADER;
+
+typedef struct {
+    VOID* Data;                     // LBL_HTTP_REQUEST_DATA* or LBL_HTTP_RESPONSE_DATA*
+    UINTN HeaderCount;
+    LBL_HTTP_HEADER* Headers;       // Response headers are pool memory for the caller to free
+    UINTN BodyLength;
+    VOID* Body;
+} LBL_HTTP_MESSAGE;
+
+typedef struct {
+    EFI_EVENT Event;
+    EFI_STATUS Status;
+    LBL_HTTP_MESSAGE* Message;
+} LBL_HTTP_TOKEN;
+
+typedef struct LBL_HTTP_PROTOCOL LBL_HTTP_PROTOCOL;
+struct LBL_HTTP_PROTOCOL {
+    VOID* GetModeData;
+    EFI_STATUS (EFIAPI *Configure)(LBL_HTTP_PROTOCOL* This, LBL_HTTP_CONFIG_DATA* HttpConfigData);
+    EFI_STATUS (EFIAPI *Request)(LBL_HTTP_PROTOCOL* This, LBL_HTTP_TOKEN* Token);
+    EFI_STATUS (EFIAPI *Cancel)(LBL_HTTP_PROTOCOL* This, LBL_HTTP_TOKEN* Token);
+    EFI_STATUS (EFIAPI *Response)(LBL_HTTP_PROTOCOL* This, LBL_HTTP_TOKEN* Token);
+    EFI_STATUS (EFIAPI *Poll)(LBL_HTTP_PROTOCOL* This);
+};
+
+// EFI_MTFTP4_PROTOCOL (UEFI spec 30.3), used for tftp:// sources.
+#define LBL_MTFTP4_SERVICE_BINDING_PROTOCOL_GUID \
+    { 0x2e800be, 0x8f01, 0x4aa6, { 0x94, 0x6b, 0xd7, 0x13, 0x88, 0xe1, 0x83, 0x3f } }
+#define LBL_MTFTP4_PROTOCOL_GUID \
+    { 0x78247c57, 0x63db, 0x4708, { 0x99, 0xc2, 0xa8, 0xb4, 0xa9, 0xa6, 0x1f, 0x6b } }
+
+typedef struct {
+    BOOLEAN UseDefaultSetting;      // Station address from the NIC's DHCP configuration
+    EFI_IPv4_ADDRESS StationIp;
+    EFI_IPv4_ADDRESS SubnetMask;
+    UINT16 LocalPort;
+    EFI_IPv4_ADDRESS GatewayIp;
+    EFI_IPv4_ADDRESS ServerIp;
+    UINT16 InitialServerPort;
+    UINT16 TryCount;
+    UINT16 TimeoutValue;            // Seconds
+} LBL_MTFTP4_CONFIG_DATA;
+
+typedef struct {
+    UINT8* OptionStr;
+    UINT8* ValueStr;
+} LBL_MTFTP4_OPTION;
+
+typedef struct {
+    EFI_STATUS Status;
+    EFI_EVENT Event;                // NULL: ReadFile blocks until the transfer ends
+    VOID* OverrideData;
+    UINT8* Filename;
+    UINT8* ModeStr;
+    UINT32 OptionCount;
+    LBL_MTFTP4_OPTION* OptionList;
+    UINT64 BufferSize;
+    VOID* Buffer;
+    VOID* Context;
+    VOID* CheckPacket;              // Callbacks are not used
+    VOID* TimeoutCallback;
+    VOID* PacketNeeded;
+} LBL_MTFTP4_TOKEN;
+
+typedef struct LBL_MTFTP4_PROTOCOL LBL_MTFTP4_PROTOCOL;
+struct LBL_MTFTP4_PROTOCOL {
+    VOID* GetModeData;
+    EFI_STATUS (EFIAPI *Configure)(LBL_MTFTP4_PROTOCOL* This, LBL_MTFTP4_CONFIG_DATA* MtftpConfigData);
+    EFI_STATUS (EFIAPI *GetInfo)(LBL_MTFTP4_PROTOCOL* This, VOID* OverrideData, UINT8* Filename,
+                                 UINT8* ModeStr, UINT8 OptionCount, LBL_MTFTP4_OPTION* OptionList,
+                                 UINT32* PacketLength, VOID** Packet);
+    EFI_STATUS (EFIAPI *ParseOptions)(LBL_MTFTP4_PROTOCOL* This, UINT32 PacketLen, VOID* Packet,
+                                      UINT32* OptionCount, LBL_MTFTP4_OPTION** OptionList);
+    EFI_STATUS (EFIAPI *ReadFile)(LBL_MTFTP4_PROTOCOL* This, LBL_MTFTP4_TOKEN* Token);
+    // WriteFile, ReadDirectory and Poll are not used.
+};
 
 // Globals defined in LblUefi.c that might be referenced by other C files
 // in this stage1/uefi module (if any were added).
@@ -0,0 +1,537 @@
+#!/usr/bin/env python3
+# Lionbootloader - Tools - Boot-Time Benchmark (bench_boot.py)
+# File: tools/bench_boot.py
+# Purpose: Boots Stage 1 under QEMU, with SeaBIOS for the BIOS loader and OVMF
+#          for the UEFI one, on virtual disks of several sizes and handle
+#          counts, and reports median / p99 time to LblCoreEntry per scenario.
+#
+# Stage 1 must be built with -DLBL_TIMELINE_SERIAL=1 (`make bench_boot` does):
+# both loaders then print their boot timeline on COM1 right before the jump to
+# the core (format in stage1/common/stage1_loader_utils.h). The run ends at the
+# "LBLTL end" line; the core is never entered for real, the default one is a
+# stub that halts.
+#
+# Time to LblCoreEntry is the LBL_TL_CORE_JUMP timestamp over the calibrated
+# counter frequency. Under KVM the guest TSC starts at 0 at VM reset, so that
+# covers firmware plus Stage 1 ("tsc" clock). Under TCG the TSC is not reset
+# with the VM, and the host time from QEMU start to the end line is used
+# instead ("wall" clock, which includes QEMU start-up).
+#
+# Exit status: 0 when every scenario booted and is within its thresholds,
+# 1 on a regression or a failed boot, 2 on a setup error.
+
+import argparse
+import json
+import math
+import os
+import selectors
+import shutil
+import statistics
+import struct
+import subprocess
+import sys
+import time
+import uuid
+import zlib
+
+SECTOR = 512
+MIB = 1024 * 1024
+
+LBL_TL_STAGE1_ENTRY = 0x0001
+LBL_TL_CORE_JUMP = 0x0007
+
+ESP_TYPE = uuid.UUID("C12A7328-F81F-11D2-BA4B-00A0C93EC93B")
+BASIC_DATA_TYPE = uuid.UUID("EBD0A0A2-B9E5-4433-87C0-68B6B72699C7")
+GPT_ENTRIES = 128
+GPT_ENTRY_SIZE = 128
+GPT_ENTRY_SECTORS = GPT_ENTRIES * GPT_ENTRY_SIZE // SECTOR
+ESP_FIRST_LBA = 2048
+
+FILLER_DISK_MIB = 16
+
+# name: firmware, boot disk size, extra disks (each adds block/partition/
+# filesystem handles on UEFI and a drive on BIOS), core size, and for UEFI
+# whether NVRAM is kept from a priming boot (the boot-device cache hits).
+SCENARIOS = [
+    {"name": "bios-64m",             "firmware": "bios", "disk_mib": 64,   "extra_disks": 0, "core_kib": 256},
+    {"name": "bios-2g",              "firmware": "bios", "disk_mib": 2048, "extra_disks": 0, "core_kib": 256},
+    {"name": "bios-2g-8disks",       "firmware": "bios", "disk_mib": 2048, "extra_disks": 8, "core_kib": 256},
+    {"name": "uefi-64m",             "firmware": "uefi", "disk_mib": 64,   "extra_disks": 0, "core_kib": 256},
+    {"name": "uefi-64m-core8m",      "firmware": "uefi", "disk_mib": 64,   "extra_disks": 0, "core_kib": 8192},
+    {"name": "uefi-2g",              "firmware": "uefi", "disk_mib": 2048, "extra_disks": 0, "core_kib": 256},
+    {"name": "uefi-2g-8disks",       "firmware": "uefi", "disk_mib": 2048, "extra_disks": 8, "core_kib": 256},
+    {"name": "uefi-2g-8disks-warm",  "firmware": "uefi", "disk_mib": 2048, "extra_disks": 8, "core_kib": 256,
+     "warm_nvram": True},
+]
+
+# Where distributions install OVMF, as (code, vars) pairs.
+OVMF_CANDIDATES = [
+    ("/usr/share/OVMF/OVMF_CODE_4M.fd", "/usr/share/OVMF/OVMF_VARS_4M.fd"),
+    ("/usr/share/OVMF/OVMF_CODE.fd", "/usr/share/OVMF/OVMF_VARS.fd"),
+    ("/usr/share/edk2/ovmf/OVMF_CODE.fd", "/usr/share/edk2/ovmf/OVMF_VARS.fd"),
+    ("/usr/share/edk2/x64/OVMF_CODE.4m.fd", "/usr/share/edk2/x64/OVMF_VARS.4m.fd"),
+    ("/usr/share/edk2-ovmf/x64/OVMF_CODE.fd", "/usr/share/edk2-ovmf/x64/OVMF_VARS.fd"),
+    ("/usr/share/qemu/edk2-x86_64-code.fd", "/usr/share/qemu/edk2-i386-vars.fd"),
+]
+
+
+class SetupError(Exception):
+    pass
+
+
+def log(message):
+    print("bench_boot: " + message, file=sys.stderr, flush=True)
+
+
+# --- Disk images ---
+
+def run_tool(args, env=None):
+    try:
+        subprocess.run(args, check=True, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, env=env)
+    except FileNotFoundError:
+        raise SetupError("%s not found (dosfstools and mtools are needed for UEFI images)" % args[0])
+    except subprocess.CalledProcessError as error:
+        raise SetupError("%s failed: %s" % (" ".join(args), error.stderr.decode(errors="replace").strip()))
+
+
+def make_sparse(path, size):
+    with open(path, "wb") as image:
+        image.truncate(size)
+
+
+def stub_core(size):
+    """A flat core that halts at its entry (offset 0), padded with incompressible
+    bytes so the read costs what a real core of that size would."""
+    entry = bytes([0xFA, 0xF4, 0xEB, 0xFD])  # cli; hlt; jmp $-1
+    pad = bytearray()
+    seed = 0x4C424C42
+    while len(pad) < size - len(entry):
+        seed = (seed * 6364136223846793005 + 1442695040888963407) & 0xFFFFFFFFFFFFFFFF
+        pad += struct.pack("<Q", seed)
+    return entry + bytes(pad[:size - len(entry)])
+
+
+def write_gpt(path, total_sectors, partitions, seed):
+    """Protective MBR, primary and backup GPT. partitions: (type, first, last, name)."""
+    disk_guid = uuid.uuid5(uuid.NAMESPACE_URL, "lbl-bench/" + seed)
+    entries = bytearray(GPT_ENTRIES * GPT_ENTRY_SIZE)
+    for index, (part_type, first, last, name) in enumerate(partitions):
+        unique = uuid.uuid5(disk_guid, str(index))
+        entry = part_type.bytes_le + unique.bytes_le + struct.pack("<QQQ", first, last, 0)
+        entry += name.encode("utf-16-le").ljust(72, b"\0")
+        entries[index * GPT_ENTRY_SIZE:(index + 1) * GPT_ENTRY_SIZE] = entry
+    entries_crc = zlib.crc32(entries) & 0xFFFFFFFF
+    first_usable = 2 + GPT_ENTRY_SECTORS
+    last_usable = total_sectors - 2 - GPT_ENTRY_SECTORS
+
+    def header(my_lba, alternate_lba, entries_lba):
+        fields = struct.pack("<8sIIIIQQQQ16sQIII", b"EFI PART", 0x00010000, 92, 0, 0,
+                             my_lba, alternate_lba, first_usable, last_usable,
+                             disk_guid.bytes_le, entries_lba, GPT_ENTRIES, GPT_ENTRY_SIZE, entries_crc)
+        crc = zlib.crc32(fields) & 0xFFFFFFFF
+        return (fields[:16] + struct.pack("<I", crc) + fields[20:]).ljust(SECTOR, b"\0")
+
+    mbr = bytearray(SECTOR)
+    mbr[446:462] = struct.pack("<B3sB3sII", 0, b"\x00\x02\x00", 0xEE, b"\xFF\xFF\xFF",
+                               1, min(total_sectors - 1, 0xFFFFFFFF))
+    mbr[510:512] = b"\x55\xAA"
+    with open(path, "r+b") as image:
+        image.write(mbr)
+        image.write(header(1, total_sectors - 1, 2))
+        image.write(entries)
+        image.seek((total_sectors - 1 - GPT_ENTRY_SECTORS) * SECTOR)
+        image.write(entries)
+        image.write(header(total_sectors - 1, 1, total_sectors - 1 - GPT_ENTRY_SECTORS))
+
+
+def make_fat_disk(path, size_mib, part_type, name, files):
+    """GPT disk with one FAT partition from ESP_FIRST_LBA holding `files`
+    ({"EFI/BOOT/BOOTX64.EFI": host path or bytes})."""
+    total = size_mib * MIB // SECTOR
+    last = total - 2 - GPT_ENTRY_SECTORS
+    make_sparse(path, total * SECTOR)
+    write_gpt(path, total, [(part_type, ESP_FIRST_LBA, last, name)], os.path.basename(path))
+    part_kib = (last - ESP_FIRST_LBA + 1) * SECTOR // 1024
+    # One-sector clusters keep a small partition FAT32; large ones get mkfs's default.
+    fat = ["-F", "16"] if size_mib < 64 else ["-F", "32", "-s", "1"] if size_mib < 512 else ["-F", "32"]
+    run_tool(["mkfs.fat", *fat, "-S", str(SECTOR), "--offset", str(ESP_FIRST_LBA), "-n", name[:11].upper(),
+              path, str(part_kib)])
+    target = "%s@@%d" % (path, ESP_FIRST_LBA * SECTOR)
+    env = dict(os.environ, MTOOLS_SKIP_CHECK="1")
+    made = set()
+    for dest, source in files.items():
+        parts = dest.split("/")
+        for depth in range(1, len(parts)):
+            directory = "/".join(parts[:depth])
+            if directory not in made:
+                run_tool(["mmd", "-i", target, "::/" + directory], env)
+                made.add(directory)
+        if isinstance(source, bytes):
+            staged = path + ".file"
+            with open(staged, "wb") as out:
+                out.write(source)
+            source = staged
+        run_tool(["mcopy", "-i", target, source, "::/" + dest], env)
+    if os.path.exists(path + ".file"):
+        os.remove(path + ".file")
+
+
+def make_bios_disk(path, size_mib, mbr, stage2, core, stage2_lba, core_lba):
+    """Raw disk laid out as lbl_config_bios.inc expects: MBR at LBA 0, boot_32 at
+    stage2_lba, the core at core_lba."""
+    with open(mbr, "rb") as f:
+        mbr_data = f.read()
+    with open(stage2, "rb") as f:
+        stage2_data = f.read()
+    if len(mbr_data) != SECTOR:
+        raise SetupError("%s is %d bytes, not one sector" % (mbr, len(mbr_data)))
+    if stage2_lba + (len(stage2_data) + SECTOR - 1) // SECTOR > core_lba:
+        raise SetupError("boot_32 (%d bytes at LBA %d) runs into the core at LBA %d"
+                         % (len(stage2_data), stage2_lba, core_lba))
+    if core_lba * SECTOR + len(core) > size_mib * MIB:
+        raise SetupError("core does not fit on a %d MiB disk" % size_mib)
+    make_sparse(path, size_mib * MIB)
+    with open(path, "r+b") as image:
+        image.write(mbr_data)
+        image.seek(stage2_lba * SECTOR)
+        image.write(stage2_data)
+        image.seek(core_lba * SECTOR)
+        image.write(core)
+
+
+def prepare_scenario(scenario, args, work):
+    directory = os.path.join(work, scenario["name"])
+    os.makedirs(directory, exist_ok=True)
+    if args.core:
+        with open(args.core, "rb") as f:
+            core = f.read()
+    else:
+        core = stub_core(scenario["core_kib"] * 1024)
+
+    boot = os.path.join(directory, "boot.img")
+    if scenario["firmware"] == "bios":
+        make_bios_disk(boot, scenario["disk_mib"], args.mbr, args.stage2, core, args.stage2_lba, args.core_lba)
+    else:
+        make_fat_disk(boot, scenario["disk_mib"], ESP_TYPE, "LBL ESP",
+                      {"EFI/BOOT/BOOTX64.EFI": args.efi, "LBL/CORE/lbl_core.bin": core})
+
+    extras = []
+    for index in range(scenario["extra_disks"]):
+        extra = os.path.join(directory, "extra%d.img" % index)
+        if scenario["firmware"] == "bios":
+            make_sparse(extra, FILLER_DISK_MIB * MIB)
+        else:
+            make_fat_disk(extra, FILLER_DISK_MIB, BASIC_DATA_TYPE, "DATA%d" % index, {"README.TXT": b"filler\n"})
+        extras.append(extra)
+    return boot, extras
+
+
+# --- QEMU ---
+
+def find_ovmf(args):
+    if args.ovmf_code or args.ovmf_vars:
+        if not (args.ovmf_code and args.ovmf_vars):
+            raise SetupError("--ovmf-code and --ovmf-vars go together")
+        return args.ovmf_code, args.ovmf_vars
+    for code, variables in OVMF_CANDIDATES:
+        if os.path.exists(code) and os.path.exists(variables):
+            return code, variables
+    raise SetupError("OVMF not found; pass --ovmf-code and --ovmf-vars (OVMF_CODE= OVMF_VARS= for make)")
+
+
+def qemu_command(args, scenario, boot, extras, vars_copy):
+    command = [args.qemu, "-machine", "q35", "-accel", args.accel, "-m", str(args.memory_mib),
+               "-smp", str(args.cpus), "-display", "none", "-vga", "std", "-monitor", "none",
+               "-serial", "stdio", "-no-reboot",
+               "-drive", "if=none,id=boot,format=raw,file=" + boot,
+               "-device", "virtio-blk-pci,drive=boot,bootindex=0"]
+    if args.accel == "kvm":
+        command += ["-cpu", "host"]
+    for index, extra in enumerate(extras):
+        command += ["-drive", "if=none,id=extra%d,format=raw,file=%s" % (index, extra),
+                    "-device", "virtio-blk-pci,drive=extra%d" % index]
+    if scenario["firmware"] == "uefi":
+        command += ["-drive", "if=pflash,format=raw,readonly=on,file=" + args.ovmf_code,
+                    "-drive", "if=pflash,format=raw,file=" + vars_copy]
+    elif args.seabios:
+        command += ["-bios", args.seabios]
+    return command
+
+
+def parse_hex(text):
+    return int(text, 16)
+
+
+def boot_once(command, timeout):
+    """Runs QEMU until "LBLTL end". Returns (hz, events, wall seconds) or raises
+    RuntimeError with the tail of the serial output."""
+    started = time.monotonic()
+    process = subprocess.Popen(command, stdin=subprocess.DEVNULL, stdout=subprocess.PIPE,
+                               stderr=subprocess.STDOUT)
+    selector = selectors.DefaultSelector()
+    selector.register(process.stdout, selectors.EVENT_READ)
+    buffer = b""
+    tail = []
+    hz = None
+    events = []
+    try:
+        while True:
+            remaining = timeout - (time.monotonic() - started)
+            if remaining <= 0:
+                raise RuntimeError("timed out after %ds" % timeout)
+            if not selector.select(remaining):
+                continue
+            chunk = os.read(process.stdout.fileno(), 4096)
+            if not chunk:
+                raise RuntimeError("QEMU exited with %s before the timeline" % process.wait())
+            buffer += chunk
+            while b"\n" in buffer:
+                raw, buffer = buffer.split(b"\n", 1)
+                line = raw.decode("ascii", errors="replace").strip()
+                tail = (tail + [line])[-8:]
+                fields = line[line.find("LBLTL"):].split() if "LBLTL" in line else []
+                if fields[1:2] == ["hz"] and len(fields) == 3:
+                    hz = parse_hex(fields[2])
+                    events = []
+                elif fields[1:2] == ["ev"] and len(fields) == 5:
+                    events.append((parse_hex(fields[2]), parse_hex(fields[3]), parse_hex(fields[4])))
+                elif fields[1:2] == ["end"]:
+                    return hz, events, time.monotonic() - started
+    except RuntimeError as error:
+        raise RuntimeError("%s; serial tail: %s" % (error, " | ".join(tail) or "(empty)"))
+    finally:
+        selector.close()
+        process.kill()
+        process.wait()
+        process.stdout.close()
+
+
+def first_tick(events, event_id):
+    for ident, _, ticks in events:
+        if ident == event_id:
+            return ticks
+    return None
+
+
+def measure(args, scenario, boot, extras, work, fallback_hz):
+    """One scenario: optional priming boot, then args.runs measured boots."""
+    vars_copy = None
+    if scenario["firmware"] == "uefi":
+        vars_copy = os.path.join(work, scenario["name"], "vars.fd")
+        if scenario.get("warm_nvram"):
+            shutil.copyfile(args.ovmf_vars, vars_copy)
+            boot_once(qemu_command(args, scenario, boot, extras, vars_copy), args.timeout)
+
+    runs = []
+    for _ in range(args.runs):
+        if vars_copy and not scenario.get("warm_nvram"):
+            shutil.copyfile(args.ovmf_vars, vars_copy)
+        hz, events, wall = boot_once(qemu_command(args, scenario, boot, extras, vars_copy), args.timeout)
+        entry = first_tick(events, LBL_TL_STAGE1_ENTRY)
+        jump = first_tick(events, LBL_TL_CORE_JUMP)
+        if jump is None:
+            raise RuntimeError("no LBL_TL_CORE_JUMP in the timeline")
+        if not hz:
+            hz = fallback_hz
+        if args.clock == "tsc" and not hz:
+            raise RuntimeError("counter frequency unknown (calibration failed); pass --tsc-hz")
+        run = {"wall_ms": wall * 1000.0, "ticks_per_second": hz, "events": len(events)}
+        if hz:
+            run["tsc_core_entry_ms"] = jump * 1000.0 / hz
+            if entry is not None:
+                run["stage1_ms"] = (jump - entry) * 1000.0 / hz
+        run["core_entry_ms"] = run["tsc_core_entry_ms"] if args.clock == "tsc" else run["wall_ms"]
+        runs.append(run)
+    return runs
+
+
+# --- Statistics and thresholds ---
+
+def p99(values):
+    ordered = sorted(values)
+    return ordered[max(0, math.ceil(0.99 * len(ordered)) - 1)]
+
+
+def summarize(runs, key):
+    values = [run[key] for run in runs if key in run]
+    if not values:
+        return None
+    return {"median_ms": round(statistics.median(values), 3), "p99_ms": round(p99(values), 3),
+            "min_ms": round(min(values), 3), "max_ms": round(max(values), 3)}
+
+
+def check_thresholds(report, thresholds):
+    """Marks each scenario "ok", "regressed" or "no-threshold"; returns the regressions."""
+    regressions = []
+    limits = thresholds.get("scenarios", {})
+    for name, result in report["scenarios"].items():
+        limit = limits.get(name)
+        summary = result.get("core_entry")
+        if summary is None:
+            continue
+        if limit is None:
+            result["threshold"] = "no-threshold"
+            continue
+        over = [key for key in ("median_ms", "p99_ms") if key in limit and summary[key] > limit[key]]
+        result["threshold"] = "regressed" if over else "ok"
+        result["limits"] = limit
+        for key in over:
+            regressions.append("%s: %s %.1f ms > %.1f ms" % (name, key, summary[key], limit[key]))
+    return regressions
+
+
+def updated_thresholds(report, thresholds, margin):
+    scenarios = dict(thresholds.get("scenarios", {}))
+    for name, result in report["scenarios"].items():
+        summary = result.get("core_entry")
+        if summary is not None:
+            scenarios[name] = {key: round(summary[key] * (1.0 + margin), 1) for key in ("median_ms", "p99_ms")}
+    updated = {"clock": report["clock"], "accel": report["accel"], "runs": report["runs"], "scenarios": scenarios}
+    if "comment" in thresholds:
+        updated["comment"] = thresholds["comment"]
+    return updated
+
+
+# --- Main ---
+
+def parse_args(argv):
+    parser = argparse.ArgumentParser(description="QEMU boot-time benchmark for Lionbootloader Stage 1.")
+    parser.add_argument("scenarios", nargs="*", help="Scenario names or prefixes (default: all)")
+    parser.add_argument("--list", action="store_true", help="List scenarios and exit")
+    parser.add_argument("--firmware", choices=("bios", "uefi", "all"), default="all")
+    parser.add_argument("--mbr", help="mbr.bin built with LBL_TIMELINE_SERIAL")
+    parser.add_argument("--stage2", help="boot_32.bin built with LBL_TIMELINE_SERIAL")
+    parser.add_argument("--efi", help="BOOTX64.EFI built with LBL_TIMELINE_SERIAL")
+    parser.add_argument("--stage2-lba", type=int, default=1, help="As LBL_STAGE2_START_SECTOR_LBA_LOW")
+    parser.add_argument("--core-lba", type=int, default=64, help="As LBL_CORE_START_SECTOR_LBA")
+    parser.add_argument("--core", help="Core binary to boot instead of the halting stub")
+    parser.add_argument("--runs", type=int, default=10, help="Measured boots per scenario")
+    parser.add_argument("--qemu", default="qemu-system-x86_64")
+    parser.add_argument("--accel", choices=("auto", "kvm", "tcg"), default="auto")
+    parser.add_argument("--clock", choices=("auto", "tsc", "wall"), default="auto",
+                        help="How time to LblCoreEntry is taken (auto: tsc with KVM, else wall)")
+    parser.add_argument("--tsc-hz", type=int, default=0, help="Counter frequency when a run reports none")
+    parser.add_argument("--memory-mib", type=int, default=512)
+    parser.add_argument("--cpus", type=int, default=2)
+    parser.add_argument("--ovmf-code")
+    parser.add_argument("--ovmf-vars")
+    parser.add_argument("--seabios", help="SeaBIOS image for -bios (default: QEMU's own)")
+    parser.add_argument("--timeout", type=int, default=60, help="Seconds per boot")
+    parser.add_argument("--work-dir", default="bench_boot_work", help="Disk images go here")
+    parser.add_argument("--report", default="bench_boot.json")
+    parser.add_argument("--thresholds", help="JSON with per-scenario median_ms / p99_ms limits")
+    parser.add_argument("--update-thresholds", action="store_true",
+                        help="Rewrite --thresholds from this run (plus --margin) instead of checking")
+    parser.add_argument("--margin", type=float, default=0.2, help="Headroom for --update-thresholds")
+    return parser.parse_args(argv)
+
+
+def select_scenarios(args):
+    chosen = []
+    for scenario in SCENARIOS:
+        if args.firmware != "all" and scenario["firmware"] != args.firmware:
+            continue
+        if args.scenarios and not any(scenario["name"].startswith(prefix) for prefix in args.scenarios):
+            continue
+        chosen.append(scenario)
+    if not chosen:
+        raise SetupError("no scenario matches")
+    return chosen
+
+
+def main(argv):
+    args = parse_args(argv)
+    if args.list:
+        for scenario in SCENARIOS:
+            print("%-22s %s, %d MiB disk, %d extra disks, %d KiB core%s" % (
+                scenario["name"], scenario["firmware"], scenario["disk_mib"], scenario["extra_disks"],
+                scenario["core_kib"], ", warm NVRAM" if scenario.get("warm_nvram") else ""))
+        return 0
+
+    try:
+        scenarios = select_scenarios(args)
+        firmwares = {scenario["firmware"] for scenario in scenarios}
+        for needed, option in (("bios", "mbr"), ("bios", "stage2"), ("uefi", "efi")):
+            path = getattr(args, option)
+            if needed in firmwares and not (path and os.path.exists(path)):
+                raise SetupError("--%s is needed for the %s scenarios (got %s)" % (option, needed, path))
+        if args.core and not os.path.exists(args.core):
+            raise SetupError("core %s not found" % args.core)
+        if shutil.which(args.qemu) is None:
+            raise SetupError("%s not found" % args.qemu)
+        if "uefi" in firmwares:
+            args.ovmf_code, args.ovmf_vars = find_ovmf(args)
+        if args.accel == "auto":
+            args.accel = "kvm" if os.access("/dev/kvm", os.R_OK | os.W_OK) else "tcg"
+        if args.clock == "auto":
+            args.clock = "tsc" if args.accel == "kvm" else "wall"
+        os.makedirs(args.work_dir, exist_ok=True)
+    except SetupError as error:
+        log(str(error))
+        return 2
+
+    thresholds = {}
+    if args.thresholds and os.path.exists(args.thresholds):
+        with open(args.thresholds) as f:
+            thresholds = json.load(f)
+
+    # The UEFI scenarios run first: their Stall-calibrated frequency stands in
+    # for a BIOS run whose PIT calibration failed.
+    scenarios.sort(key=lambda scenario: scenario["firmware"] != "uefi")
+    fallback_hz = args.tsc_hz
+    report = {"accel": args.accel, "clock": args.clock, "runs": args.runs,
+              "core": args.core or "stub", "scenarios": {}}
+    failures = []
+    for scenario in scenarios:
+        name = scenario["name"]
+        log("%s: building disks" % name)
+        result = {key: value for key, value in scenario.items() if key != "name"}
+        try:
+            boot, extras = prepare_scenario(scenario, args, args.work_dir)
+            log("%s: %d boots (%s, %s clock)" % (name, args.runs, args.accel, args.clock))
+            runs = measure(args, scenario, boot, extras, args.work_dir, fallback_hz)
+        except (SetupError, RuntimeError, OSError) as error:
+            result["error"] = str(error)
+            failures.append("%s: %s" % (name, error))
+            report["scenarios"][name] = result
+            log("%s: FAILED: %s" % (name, error))
+            continue
+        if not fallback_hz:
+            fallback_hz = next((run["ticks_per_second"] for run in runs if run["ticks_per_second"]), 0)
+        result["core_entry"] = summarize(runs, "core_entry_ms")
+        result["stage1"] = summarize(runs, "stage1_ms")
+        result["wall"] = summarize(runs, "wall_ms")
+        result["samples_ms"] = [round(run["core_entry_ms"], 3) for run in runs]
+        report["scenarios"][name] = result
+        log("%s: median %.1f ms, p99 %.1f ms to LblCoreEntry" % (
+            name, result["core_entry"]["median_ms"], result["core_entry"]["p99_ms"]))
+
+    regressions = []
+    if args.update_thresholds:
+        if not args.thresholds:
+            log("--update-thresholds needs --thresholds")
+            return 2
+        with open(args.thresholds, "w") as f:
+            json.dump(updated_thresholds(report, thresholds, args.margin), f, indent=2, sort_keys=True)
+            f.write("\n")
+        log("thresholds written to %s" % args.thresholds)
+    elif thresholds:
+        if thresholds.get("clock", args.clock) != args.clock:
+            log("thresholds are for the %s clock, this run used %s: not compared" %
+                (thresholds.get("clock"), args.clock))
+        else:
+            regressions = check_thresholds(report, thresholds)
+
+    report["regressions"] = regressions
+    report["failures"] = failures
+    with open(args.report, "w") as f:
+        json.dump(report, f, indent=2, sort_keys=True)
+        f.write("\n")
+    log("report written to %s" % args.report)
+    for line in regressions:
+        log("REGRESSION " + line)
+    return 1 if regressions or failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+# Lionbootloader - Tools - Core Manifest Writer (make_core_manifest.py)
+# File: tools/make_core_manifest.py
+# Purpose: Writes the lbl_core.man manifest (or lbl_core_a.man / _b.man) that
+#          the UEFI Stage 1 checks the core against while reading it.
+#
+# Manifest layout (LBL_CORE_MANIFEST_HEADER in stage1/uefi/LblUefi.h):
+#   u64 magic "LBLMANF1", u32 header_size, u32 signature_size,
+#   u64 core_file_size, u8 core_sha256[32];
+# then signature_size bytes of detached signature over bytes [0, header_size).
+#
+# The digest is taken over the core file exactly as it will be stored on the
+# ESP: the LZ4 container when the core is packed, not the flat image. Stage 1
+# refuses a core whose size or SHA-256 differs, and the core checks the
+# signature against its KeyStore.
+#
+# Signing is done outside this tool. signature_size is one of the signed
+# fields, so give the length the signature will have, write the header with
+# --signed-out, sign that file with the platform key, then run again with the
+# signature (which must have that length):
+#   make_core_manifest.py lbl_core.bin lbl_core.man --signature-size 256 --signed-out lbl_core.tbs
+#   <sign lbl_core.tbs into lbl_core.sig>
+#   make_core_manifest.py lbl_core.bin lbl_core.man --signature lbl_core.sig
+# Without --signature the manifest is unsigned (signature_size 0): Stage 1
+# still enforces the digest, and the core reports it as unverified.
+#
+# Exit status: 0 on success, 2 on a bad input.
+
+import argparse
+import hashlib
+import struct
+import sys
+
+LBL_CORE_MANIFEST_MAGIC = 0x4C424C4D414E4631  # "LBLMANF1"
+LBL_CORE_MANIFEST_MAX_SIZE = 64 * 1024
+
+MANIFEST_HEADER = struct.Struct("<QIIQ32s")
+
+
+class SetupError(Exception):
+    pass
+
+
+def log(message):
+    print("make_core_manifest: " + message, file=sys.stderr, flush=True)
+
+
+def core_digest(path):
+    sha = hashlib.sha256()
+    size = 0
+    with open(path, "rb") as core:
+        for chunk in iter(lambda: core.read(1024 * 1024), b""):
+            sha.update(chunk)
+            size += len(chunk)
+    if size == 0:
+        raise SetupError("%s is empty" % path)
+    return size, sha.digest()
+
+
+def signed_header(size, digest, signature_size):
+    return MANIFEST_HEADER.pack(LBL_CORE_MANIFEST_MAGIC, MANIFEST_HEADER.size, signature_size, size, digest)
+
+
+def parse_args(argv):
+    parser = argparse.ArgumentParser(description="Write the SHA-256 manifest of a Lionbootloader core.")
+    parser.add_argument("core", help="Core file as installed (flat, ELF/PE or LZ4 container)")
+    parser.add_argument("output", help="Manifest to write, e.g. lbl_core.man")
+    parser.add_argument("--signature", help="Detached signature over the header, appended as is")
+    parser.add_argument("--signature-size", type=int,
+                        help="Length of the signature to come (default: that of --signature, else 0)")
+    parser.add_argument("--signed-out", help="Also write the bytes to be signed to this file")
+    return parser.parse_args(argv)
+
+
+def main(argv):
+    args = parse_args(argv)
+    try:
+        size, digest = core_digest(args.core)
+        signature = b""
+        if args.signature:
+            with open(args.signature, "rb") as f:
+                signature = f.read()
+        signature_size = len(signature) if args.signature_size is None else args.signature_size
+        if args.signature and signature_size != len(signature):
+            raise SetupError("signature is %d bytes, --signature-size says %d" % (len(signature), signature_size))
+        if signature_size < 0 or MANIFEST_HEADER.size + signature_size > LBL_CORE_MANIFEST_MAX_SIZE:
+            raise SetupError("a %d-byte signature does not fit the %d-byte manifest limit" % (
+                signature_size, LBL_CORE_MANIFEST_MAX_SIZE))
+        if signature_size and not args.signature and not args.signed_out:
+            raise SetupError("--signature-size without --signature needs --signed-out")
+    except (SetupError, OSError) as error:
+        log(str(error))
+        return 2
+
+    header = signed_header(size, digest, signature_size)
+    if args.signed_out:
+        with open(args.signed_out, "wb") as f:
+            f.write(header)
+    if not args.signature and signature_size:
+        # Header only: a manifest without its signature would fail Stage 1's size check.
+        log("%s: header for a %d-byte signature written to %s" % (args.core, signature_size, args.signed_out))
+        return 0
+    with open(args.output, "wb") as f:
+        f.write(header + signature)
+    log("%s: %d-byte core, sha256 %s, %s" % (
+        args.output, size, digest.hex(), "%d-byte signature" % len(signature) if signature else "unsigned"))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,310 @@
+#!/usr/bin/env python3
+# Lionbootloader - Tools - Extent Map Writer (make_extent_map.py)
+# File: tools/make_extent_map.py
+# Purpose: Writes the .ext sidecar (e.g. \LBL\CORE\lbl_core.ext) that lets the
+#          UEFI Stage 1 read the core with a few Disk I/O reads instead of the
+#          firmware FAT driver. The runs are taken from the file's cluster chain
+#          on the installed FAT12/16/32 volume, not from a local copy.
+#
+# Map layout (LBL_EXTENT_MAP_HEADER in stage1/common/stage1_loader_utils.h):
+#   u64 magic "LBLEXTM1", u32 header_size (40), u32 block_size, u64 file_size,
+#   u32 extent_count, u32 file_crc32, u32 map_crc32, u32 reserved;
+# then extent_count x { u64 lba, u64 blocks }, partition-relative, in units of
+# block_size (the media block size: 512, or 4096 on 4Kn disks). The runs cover
+# the file with less than one block of slack. map_crc32 is the CRC32 of the
+# header (with map_crc32 0) and the extents, file_crc32 that of the file.
+#
+# The map describes where the file lies at the time it is built. Run this after
+# the core (or slot) file is copied to the volume, and again whenever that file
+# is rewritten, replaced, moved or defragmented. Writing other files, including
+# the .ext itself, does not move it. A stale map is not trusted: Stage 1
+# rejects it on the size or CRC checks and reads the file through the
+# filesystem instead, which is slower but correct.
+#
+#   make_extent_map.py esp.img /LBL/CORE/lbl_core.bin lbl_core.ext
+#   make_extent_map.py disk.img /LBL/CORE/lbl_core_a.bin lbl_core_a.ext --partition 1
+#   make_extent_map.py /dev/sdb1 /LBL/CORE/lbl_core.bin lbl_core.ext
+#
+# Exit status: 0 on success, 2 on a bad input, a missing file or a file too
+# fragmented to map (more than 256 runs; Stage 1 then uses the FS path).
+
+import argparse
+import struct
+import sys
+import zlib
+
+LBL_EXTENT_MAP_MAGIC = 0x4C424C4558544D31  # "LBLEXTM1"
+LBL_EXTENT_MAP_MAX_EXTENTS = 256
+
+EXTENT_MAP_HEADER = struct.Struct("<QIIQIIII")
+EXTENT = struct.Struct("<QQ")
+
+ATTR_VOLUME_ID = 0x08
+ATTR_DIRECTORY = 0x10
+ATTR_LONG_NAME = 0x0F
+
+
+class SetupError(Exception):
+    pass
+
+
+def log(message):
+    print("make_extent_map: " + message, file=sys.stderr, flush=True)
+
+
+# --- Partition lookup ---
+
+def partition_offset(disk, index, block_size):
+    """Byte offset of partition `index` (1-based) in a GPT or MBR disk image."""
+    disk.seek(block_size)
+    gpt = disk.read(block_size)
+    if gpt[:8] == b"EFI PART":
+        entries_lba, count, entry_size = struct.unpack_from("<QII", gpt, 72)
+        if not 1 <= index <= count:
+            raise SetupError("GPT has no partition %d" % index)
+        disk.seek(entries_lba * block_size + (index - 1) * entry_size)
+        first_lba = struct.unpack_from("<16s16sQ", disk.read(48))[2]
+        if first_lba == 0:
+            raise SetupError("GPT partition %d is unused" % index)
+        return first_lba * block_size
+    disk.seek(0)
+    mbr = disk.read(512)
+    if mbr[510:512] != b"\x55\xAA" or not 1 <= index <= 4:
+        raise SetupError("no GPT or MBR partition %d" % index)
+    part_type, first_lba = struct.unpack_from("<4xB3xI", mbr, 446 + (index - 1) * 16)
+    if part_type == 0:
+        raise SetupError("MBR partition %d is unused" % index)
+    return first_lba * 512
+
+
+# --- FAT ---
+
+class FatVolume:
+    def __init__(self, disk, offset):
+        self.disk = disk
+        self.offset = offset
+        bpb = self.read(0, 512)
+        if bpb[510:512] != b"\x55\xAA":
+            raise SetupError("no FAT boot sector at offset %d" % offset)
+        self.sector_size, self.cluster_sectors, reserved, fats, root_entries, total16 = \
+            struct.unpack_from("<HBHBHH", bpb, 11)
+        fat_size16 = struct.unpack_from("<H", bpb, 22)[0]
+        total32, fat_size32 = struct.unpack_from("<II", bpb, 32)
+        self.root_cluster = struct.unpack_from("<I", bpb, 44)[0]
+        if self.sector_size not in (512, 1024, 2048, 4096) or self.cluster_sectors == 0 or fats == 0:
+            raise SetupError("boot sector at offset %d is not a FAT BPB" % offset)
+        fat_size = fat_size16 or fat_size32
+        total = total16 or total32
+        root_sectors = (root_entries * 32 + self.sector_size - 1) // self.sector_size
+        self.fat_sector = reserved
+        self.root_sector = reserved + fats * fat_size
+        self.data_sector = self.root_sector + root_sectors
+        self.root_bytes = root_sectors * self.sector_size
+        self.cluster_count = (total - self.data_sector) // self.cluster_sectors
+        if self.cluster_count < 4085:
+            self.bits = 12
+        elif self.cluster_count < 65525:
+            self.bits = 16
+        else:
+            self.bits = 32
+        self.cluster_bytes = self.cluster_sectors * self.sector_size
+        self.fat = self.read(self.fat_sector * self.sector_size, fat_size * self.sector_size)
+
+    def read(self, position, length):
+        self.disk.seek(self.offset + position)
+        data = self.disk.read(length)
+        if len(data) != length:
+            raise SetupError("volume is truncated at byte %d" % (position + len(data)))
+        return data
+
+    def next_cluster(self, cluster):
+        if self.bits == 32:
+            value = struct.unpack_from("<I", self.fat, cluster * 4)[0] & 0x0FFFFFFF
+            end = 0x0FFFFFF8
+        elif self.bits == 16:
+            value = struct.unpack_from("<H", self.fat, cluster * 2)[0]
+            end = 0xFFF8
+        else:
+            pair = struct.unpack_from("<H", self.fat, cluster * 3 // 2)[0]
+            value = pair >> 4 if cluster & 1 else pair & 0xFFF
+            end = 0xFF8
+        if value >= end:
+            return None
+        if value < 2 or value >= self.cluster_count + 2:
+            raise SetupError("FAT chain has a free or bad entry after cluster %d" % cluster)
+        return value
+
+    def chain(self, first):
+        clusters = []
+        cluster = first
+        while cluster is not None:
+            if len(clusters) > self.cluster_count:
+                raise SetupError("FAT chain from cluster %d loops" % first)
+            clusters.append(cluster)
+            cluster = self.next_cluster(cluster)
+        return clusters
+
+    def cluster_sector(self, cluster):
+        return self.data_sector + (cluster - 2) * self.cluster_sectors
+
+    def directory(self, first_cluster):
+        if first_cluster == 0:  # The FAT12/16 root directory has its own region
+            return self.read(self.root_sector * self.sector_size, self.root_bytes)
+        return b"".join(self.read(self.cluster_sector(cluster) * self.sector_size, self.cluster_bytes)
+                        for cluster in self.chain(first_cluster))
+
+    def entries(self, first_cluster):
+        """(names, attributes, first cluster, size) of each entry, names being the
+        long name (if any) and the 8.3 name."""
+        data = self.directory(first_cluster)
+        long_parts = {}
+        for position in range(0, len(data), 32):
+            entry = data[position:position + 32]
+            if entry[0] == 0x00:
+                break
+            if entry[0] == 0xE5:
+                long_parts = {}
+                continue
+            attributes = entry[11]
+            if attributes & 0x3F == ATTR_LONG_NAME:
+                raw = entry[1:11] + entry[14:26] + entry[28:32]
+                long_parts[entry[0] & 0x1F] = (raw.decode("utf-16-le"), entry[13])
+                continue
+            if attributes & ATTR_VOLUME_ID:
+                long_parts = {}
+                continue
+            names = [short_name(entry)]
+            checksum = short_name_checksum(entry[:11])
+            if long_parts and all(part[1] == checksum for part in long_parts.values()):
+                text = "".join(long_parts[order][0] for order in sorted(long_parts))
+                names.insert(0, text.split("\x00")[0])
+            long_parts = {}
+            cluster_high, cluster_low, size = struct.unpack_from("<H4xHI", entry, 20)
+            yield names, attributes, (cluster_high << 16) | cluster_low, size
+
+    def find(self, path):
+        cluster = 0 if self.bits != 32 else self.root_cluster
+        parts = [part for part in path.replace("\\", "/").split("/") if part]
+        if not parts:
+            raise SetupError("no file name in %r" % path)
+        for depth, part in enumerate(parts):
+            for names, attributes, first, size in self.entries(cluster):
+                if part.upper() in (name.upper() for name in names):
+                    break
+            else:
+                raise SetupError("%s not found on the volume" % "/".join(parts[:depth + 1]))
+            last = depth == len(parts) - 1
+            if bool(attributes & ATTR_DIRECTORY) == last:
+                raise SetupError("%s is %sa directory" % ("/".join(parts[:depth + 1]), "" if last else "not "))
+            cluster = first
+        return first, size
+
+
+def short_name(entry):
+    base = entry[0:8].decode("ascii", "replace").rstrip()
+    ext = entry[8:11].decode("ascii", "replace").rstrip()
+    if base[:1] == "\x05":
+        base = "\xE5" + base[1:]
+    return base + "." + ext if ext else base
+
+
+def short_name_checksum(name):
+    checksum = 0
+    for byte in name:
+        checksum = (((checksum & 1) << 7) + (checksum >> 1) + byte) & 0xFF
+    return checksum
+
+
+# --- Map ---
+
+def file_runs(volume, first, size, block_size):
+    """Partition-relative runs of the file in block_size units, merged where
+    contiguous and trimmed to the blocks the file uses."""
+    if size == 0 or first < 2:
+        raise SetupError("file is empty; there is nothing to map")
+    if volume.cluster_bytes % block_size:
+        raise SetupError("%d-byte clusters are not whole %d-byte blocks" % (volume.cluster_bytes, block_size))
+    clusters = volume.chain(first)
+    if len(clusters) * volume.cluster_bytes < size:
+        raise SetupError("cluster chain is shorter than the file size")
+
+    runs = []
+    remaining = (size + block_size - 1) // block_size
+    for cluster in clusters:
+        start = volume.cluster_sector(cluster) * volume.sector_size
+        if start % block_size:
+            raise SetupError("cluster %d does not start on a %d-byte block" % (cluster, block_size))
+        lba = start // block_size
+        blocks = min(volume.cluster_bytes // block_size, remaining)
+        if runs and runs[-1][0] + runs[-1][1] == lba:
+            runs[-1][1] += blocks
+        else:
+            runs.append([lba, blocks])
+        remaining -= blocks
+        if remaining == 0:
+            break
+    return clusters, runs
+
+
+def file_crc32(volume, clusters, size):
+    crc = 0
+    for cluster in clusters:
+        if size == 0:
+            break
+        length = min(volume.cluster_bytes, size)
+        crc = zlib.crc32(volume.read(volume.cluster_sector(cluster) * volume.sector_size, length), crc)
+        size -= length
+    return crc
+
+
+def build_map(block_size, size, runs, data_crc):
+    extents = b"".join(EXTENT.pack(lba, blocks) for lba, blocks in runs)
+    header = EXTENT_MAP_HEADER.pack(LBL_EXTENT_MAP_MAGIC, EXTENT_MAP_HEADER.size, block_size, size,
+                                    len(runs), data_crc, 0, 0)
+    map_crc = zlib.crc32(header + extents)
+    header = EXTENT_MAP_HEADER.pack(LBL_EXTENT_MAP_MAGIC, EXTENT_MAP_HEADER.size, block_size, size,
+                                    len(runs), data_crc, map_crc, 0)
+    return header + extents
+
+
+def parse_args(argv):
+    parser = argparse.ArgumentParser(description="Write the extent map sidecar of a file on a FAT volume.")
+    parser.add_argument("volume", help="FAT partition (image or device), or a whole disk with --partition")
+    parser.add_argument("path", help="File on the volume, e.g. /LBL/CORE/lbl_core.bin")
+    parser.add_argument("output", help="Map to write, e.g. lbl_core.ext (then copy it next to the file)")
+    parser.add_argument("--partition", type=int, help="1-based GPT/MBR partition when VOLUME is a whole disk")
+    parser.add_argument("--offset", type=int, default=0, help="Byte offset of the partition in VOLUME")
+    parser.add_argument("--block-size", type=int, default=512, help="Media block size the LBAs are in")
+    return parser.parse_args(argv)
+
+
+def main(argv):
+    args = parse_args(argv)
+    try:
+        if args.block_size <= 0 or args.block_size & (args.block_size - 1):
+            raise SetupError("--block-size must be a power of two")
+        with open(args.volume, "rb") as disk:
+            offset = args.offset
+            if args.partition is not None:
+                offset += partition_offset(disk, args.partition, args.block_size)
+            volume = FatVolume(disk, offset)
+            first, size = volume.find(args.path)
+            clusters, runs = file_runs(volume, first, size, args.block_size)
+            if len(runs) > LBL_EXTENT_MAP_MAX_EXTENTS:
+                raise SetupError("%s has %d runs, more than the %d a map may hold; defragment it" % (
+                    args.path, len(runs), LBL_EXTENT_MAP_MAX_EXTENTS))
+            data_crc = file_crc32(volume, clusters, size)
+    except (SetupError, OSError) as error:
+        log(str(error))
+        return 2
+
+    with open(args.output, "wb") as f:
+        f.write(build_map(args.block_size, size, runs, data_crc))
+    log("%s: %s, %d bytes in %d run%s (FAT%d, %d-byte blocks), crc32 %08x" % (
+        args.output, args.path, size, len(runs), "" if len(runs) == 1 else "s",
+        volume.bits, args.block_size, data_crc))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+# Lionbootloader - Tools - Compressed Core Packer (pack_core_lz4.py)
+# File: tools/pack_core_lz4.py
+# Purpose: Packs a flat lbl_core.bin into the LBLCLZ41 container that the UEFI
+#          Stage 1 decodes while streaming the file into the core's pages.
+#
+# Container layout (LBL_CORE_LZ4_HEADER in stage1/uefi/LblUefi.h):
+#   u64 magic "LBLCLZ41", u32 header_size, u32 block_max_size,
+#   u64 compressed_size, u64 uncompressed_size,
+#   64 bytes: the first 64 bytes of the image when it starts with an
+#             LBL_CORE_IMAGE_HEADER ("LBLCORE1"), zeroes otherwise;
+# then at header_size the block stream read by stage1/common/stage1_lz4.c:
+#   repeat { u32 length (| 0x80000000 if stored); LZ4 block or raw bytes }.
+#
+# The image is cut into frames of --block-kib. Each frame is one LZ4 block;
+# its matches may reach back into the previous frames (linked blocks, 64 KiB
+# window), which the decoder allows. A frame that does not shrink is stored.
+# The container has no checksum of its own: the .man manifest digest covers
+# the file as written here, so run make_core_manifest.py on the output.
+#
+# Only flat images can be packed. Stage 1 rejects an ELF64 or PE32+ core
+# inside the container, so those are refused here too.
+#
+# Exit status: 0 on success, 2 on a bad input or option.
+
+import argparse
+import struct
+import sys
+
+KIB = 1024
+
+LBL_CORE_LZ4_MAGIC = 0x4C424C434C5A3431     # "LBLCLZ41"
+LBL_CORE_HEADER_MAGIC = 0x4C424C434F524531  # "LBLCORE1"
+LBL_CORE_LZ4_MAX_BLOCK = 8 * 1024 * KIB
+LBL_LZ4_BLOCK_UNCOMPRESSED = 0x80000000
+
+LZ4_HEADER_FIXED = struct.Struct("<QIIQQ")
+IMAGE_HEADER_SIZE = 64                      # sizeof(LBL_CORE_IMAGE_HEADER)
+CONTAINER_HEADER_SIZE = LZ4_HEADER_FIXED.size + IMAGE_HEADER_SIZE
+
+# LZ4 block format limits: a match is at least 4 bytes, lies within 64 KiB,
+# no match starts in the last 12 bytes of a block and the last 5 are literals.
+MIN_MATCH = 4
+MAX_OFFSET = 0xFFFF
+MF_LIMIT = 12
+LAST_LITERALS = 5
+
+
+class SetupError(Exception):
+    pass
+
+
+def log(message):
+    print("pack_core_lz4: " + message, file=sys.stderr, flush=True)
+
+
+# --- LZ4 block encoder ---
+
+def put_length(out, length):
+    """Continuation bytes of a length field whose nibble is 15."""
+    length -= 15
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def put_sequence(out, data, anchor, pos, offset, match_len):
+    literals = pos - anchor
+    extra = match_len - MIN_MATCH
+    out.append((min(literals, 15) << 4) | min(extra, 15))
+    if literals >= 15:
+        put_length(out, literals)
+    out += data[anchor:pos]
+    out += struct.pack("<H", offset)
+    if extra >= 15:
+        put_length(out, extra)
+
+
+def put_last_literals(out, data, anchor, end):
+    literals = end - anchor
+    out.append(min(literals, 15) << 4)
+    if literals >= 15:
+        put_length(out, literals)
+    out += data[anchor:end]
+
+
+def compress_block(data, start, end, table):
+    """LZ4 block for data[start:end]. Matches may reference data[:start] within
+    the window; `table` maps 4-byte sequences to their last position and is
+    carried from block to block."""
+    out = bytearray()
+    anchor = start
+    pos = start
+    match_limit = end - LAST_LITERALS
+    misses = 0
+    while pos + MF_LIMIT <= end:
+        sequence = data[pos:pos + MIN_MATCH]
+        ref = table.get(sequence)
+        table[sequence] = pos
+        if ref is None or pos - ref > MAX_OFFSET:
+            misses += 1
+            pos += 1 + (misses >> 6)    # Skip faster through incompressible data
+            continue
+        misses = 0
+        while pos > anchor and ref > 0 and data[pos - 1] == data[ref - 1]:
+            pos -= 1
+            ref -= 1
+        length = MIN_MATCH
+        while pos + length + 32 <= match_limit and \
+                data[pos + length:pos + length + 32] == data[ref + length:ref + length + 32]:
+            length += 32
+        while pos + length < match_limit and data[pos + length] == data[ref + length]:
+            length += 1
+        put_sequence(out, data, anchor, pos, pos - ref, length)
+        pos += length
+        anchor = pos
+        if pos - 2 >= start:
+            table[data[pos - 2:pos + 2]] = pos - 2
+    put_last_literals(out, data, anchor, end)
+    return out
+
+
+# --- Container ---
+
+def image_header(image):
+    if len(image) >= 8 and struct.unpack_from("<Q", image)[0] == LBL_CORE_HEADER_MAGIC:
+        if len(image) < IMAGE_HEADER_SIZE:
+            raise SetupError("image is shorter than its LBLCORE1 header")
+        return image[:IMAGE_HEADER_SIZE]
+    if image[:4] == b"\x7fELF" or image[:2] == b"MZ":
+        raise SetupError("only flat cores can be packed (Stage 1 rejects ELF/PE inside the container)")
+    return bytes(IMAGE_HEADER_SIZE)
+
+
+def pack(image, block_size):
+    header = image_header(image)
+    blocks = bytearray()
+    table = {}
+    stored = 0
+    for start in range(0, len(image), block_size):
+        end = min(start + block_size, len(image))
+        body = compress_block(image, start, end, table)
+        if len(body) >= end - start:
+            blocks += struct.pack("<I", (end - start) | LBL_LZ4_BLOCK_UNCOMPRESSED)
+            blocks += image[start:end]
+            stored += 1
+        else:
+            blocks += struct.pack("<I", len(body))
+            blocks += body
+    fixed = LZ4_HEADER_FIXED.pack(LBL_CORE_LZ4_MAGIC, CONTAINER_HEADER_SIZE, block_size,
+                                  len(blocks), len(image))
+    return fixed + header + blocks, stored
+
+
+def parse_args(argv):
+    parser = argparse.ArgumentParser(description="Pack a flat Lionbootloader core into an LBLCLZ41 container.")
+    parser.add_argument("input", help="Flat lbl_core.bin")
+    parser.add_argument("output", help="Container to write (installed as lbl_core.bin)")
+    parser.add_argument("--block-kib", type=int, default=1024,
+                        help="Uncompressed frame size; Stage 1 stages one compressed frame (max 8192)")
+    return parser.parse_args(argv)
+
+
+def main(argv):
+    args = parse_args(argv)
+    block_size = args.block_kib * KIB
+    try:
+        if block_size <= 0 or block_size > LBL_CORE_LZ4_MAX_BLOCK:
+            raise SetupError("--block-kib must be 1..%d" % (LBL_CORE_LZ4_MAX_BLOCK // KIB))
+        with open(args.input, "rb") as f:
+            image = f.read()
+        if not image:
+            raise SetupError("%s is empty" % args.input)
+        container, stored = pack(image, block_size)
+    except (SetupError, OSError) as error:
+        log(str(error))
+        return 2
+
+    with open(args.output, "wb") as f:
+        f.write(container)
+    log("%s: %d -> %d bytes (%.1f%%), %d KiB frames, %d stored" % (
+        args.output, len(image), len(container), 100.0 * len(container) / len(image),
+        args.block_kib, stored))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))